@@ -8,6 +8,8 @@ varying vec4 ShadowCoord0;
 varying vec4 ShadowCoord1;
 uniform mat4 shadowMatrix0;
 uniform mat4 shadowMatrix1;
+uniform vec4 shadowRect0;
+uniform vec4 shadowRect1;
 
 
 float calculateAttenuation(in int i, in float dist)
@@ -47,13 +49,14 @@ void pointLight(in int i, in vec3 normal, in vec4 pos, inout vec4 diffuse, inout
 }
 
 
-void spotLight(in int i, in vec3 normal, in vec4 pos, inout vec4 diffuse, inout vec4 specular, sampler2D shadowMap, vec4 ShadowCoord) {
+void spotLight(in int i, in vec3 normal, in vec4 pos, inout vec4 diffuse, inout vec4 specular, sampler2D shadowMap, vec4 ShadowCoord, vec4 shadowRect) {
 	
 	vec4 shadowCoordinateWdivide = ShadowCoord / ShadowCoord.w;
 	shadowCoordinateWdivide.z -= 0.000005;
-	float distanceFromLight = texture2D(shadowMap,shadowCoordinateWdivide.st).z;
+	// shadowRect is this light's tile in the shadow map atlas, lookups must not leave it
+	float distanceFromLight = texture2D(shadowMap, clamp(shadowCoordinateWdivide.st, shadowRect.xy, shadowRect.zw)).z;
 	float shadow = 1.0;
-	if (shadowCoordinateWdivide.x > 0.01 && shadowCoordinateWdivide.y > 0.01 && shadowCoordinateWdivide.x < 0.99 && shadowCoordinateWdivide.y < 0.99)
+	if (shadowCoordinateWdivide.x > shadowRect.x && shadowCoordinateWdivide.y > shadowRect.y && shadowCoordinateWdivide.x < shadowRect.z && shadowCoordinateWdivide.y < shadowRect.w)
 		shadow = distanceFromLight < shadowCoordinateWdivide.z ? 0.0 : 1.0 ;
 	
 	vec4 color = gl_FrontMaterial.diffuse;
@@ -99,10 +102,10 @@ void doLights(in int numLights, in vec3 normal, in vec4 pos, inout vec4 diffuse,
 				pointLight(i, normal, pos, diffuse, specular);
 		}  else {
             	if(spot == 0) {
-					spotLight(i, normal, pos, diffuse, specular,shadowMap0, ShadowCoord0);            		                 
+					spotLight(i, normal, pos, diffuse, specular,shadowMap0, ShadowCoord0, shadowRect0);            		                 
 					spot = 1;
             	} else {
-					spotLight(i, normal, pos, diffuse, specular,shadowMap1, ShadowCoord1);            		
+					spotLight(i, normal, pos, diffuse, specular,shadowMap1, ShadowCoord1, shadowRect1);            		
             	}
         }
     } 
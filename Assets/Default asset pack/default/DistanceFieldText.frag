@@ -0,0 +1,11 @@
+uniform sampler2D diffuse;
+varying vec4 vertexColor;
+
+void main()
+{
+	// the alpha channel holds the distance to the glyph edge, which is at 0.5
+	float distance = texture2D(diffuse, gl_TexCoord[0].st).a;
+	float smoothing = fwidth(distance) * 0.7;
+	float alpha = smoothstep(0.5 - smoothing, 0.5 + smoothing, distance);
+	gl_FragColor = vec4(vertexColor.rgb, vertexColor.a * alpha);
+}
@@ -0,0 +1,145 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#pragma once
+
+#include "Polycode.h"
+#include <vector>
+
+using namespace Polycode;
+
+extern unsigned long benchmarkAllocationCount;
+extern unsigned long benchmarkAllocationBytes;
+
+/**
+* Microsecond timer used to time frames and subsystems.
+*/
+class BenchmarkTimer {
+	public:
+		static double now();
+};
+
+/**
+* Settings shared by all scenarios in a run.
+*/
+class BenchmarkContext {
+	public:
+		/** Root of the Polycode source tree, used to find fonts, themes and example assets. */
+		String sourcePath;
+		/** Seed passed to srand() before each scenario. */
+		unsigned int seed;
+		int xRes;
+		int yRes;
+};
+
+/**
+* A scripted, deterministic benchmark scenario. setup() builds the scene, update() is called once per frame before the engine frame runs and teardown() destroys everything setup() created.
+*/
+class BenchmarkScenario {
+	public:
+		virtual ~BenchmarkScenario() {}
+		
+		virtual String getName() const = 0;
+		virtual String getDescription() const = 0;
+		
+		/**
+		* Builds the scenario. Returns false if it can not run, for example because an asset is missing.
+		*/
+		virtual bool setup(const BenchmarkContext &context) = 0;
+		virtual void update(unsigned int frame) = 0;
+		virtual void teardown() = 0;
+};
+
+/**
+* Timings of the engine subsystems for one frame, in milliseconds.
+*/
+class BenchmarkFrameTimings {
+	public:
+		BenchmarkFrameTimings();
+		
+		double script;
+		double timers;
+		double materials;
+		double sceneUpdate;
+		double sceneRender;
+		double screens;
+		double frame;
+};
+
+/**
+* Headless core that runs the engine frame step by step so each subsystem can be timed. Ticks always advance by a fixed timestep.
+*/
+class BenchmarkCore : public HeadlessCore {
+	public:
+		BenchmarkCore(int xRes, int yRes, unsigned int timestep);
+		
+		bool Update();
+		
+		const BenchmarkFrameTimings& getLastFrameTimings() const;
+		
+	protected:
+		BenchmarkFrameTimings lastFrameTimings;
+};
+
+/**
+* Results of one scenario.
+*/
+class BenchmarkResult {
+	public:
+		String name;
+		bool skipped;
+		double setupTime;
+		double teardownTime;
+		std::vector<double> frameTimes;
+		std::vector<BenchmarkFrameTimings> frameTimings;
+		unsigned long allocationCount;
+		unsigned long allocationBytes;
+		unsigned long drawCalls;
+		unsigned long verticesDrawn;
+};
+
+/**
+* Runs scenarios for a fixed number of frames and writes the results as JSON.
+*/
+class BenchmarkRunner {
+	public:
+		BenchmarkRunner(BenchmarkCore *core, const BenchmarkContext &context, unsigned int warmupFrames, unsigned int frames);
+		~BenchmarkRunner();
+		
+		void addScenario(BenchmarkScenario *scenario);
+		unsigned int getNumScenarios() const;
+		BenchmarkScenario *getScenario(unsigned int index);
+		
+		BenchmarkResult runScenario(BenchmarkScenario *scenario);
+		
+		String resultsToJSON(const std::vector<BenchmarkResult> &results, unsigned int timestep) const;
+		
+	protected:
+		String statsToJSON(std::vector<double> values) const;
+		
+		BenchmarkCore *core;
+		BenchmarkContext context;
+		unsigned int warmupFrames;
+		unsigned int frames;
+		std::vector<BenchmarkScenario*> scenarios;
+};
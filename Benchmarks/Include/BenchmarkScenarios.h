@@ -0,0 +1,234 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+ 
+
+#pragma once
+
+#include "BenchmarkRunner.h"
+#include "PolycodeUI.h"
+
+#ifdef POLYBENCH_3DPHYSICS
+#include "Polycode3DPhysics.h"
+#endif
+
+#ifdef POLYBENCH_LUA
+#include "PolycodeLUA.h"
+#endif
+
+/**
+* Thousands of scene meshes viewed by an orbiting camera, with a share of them rotating every frame.
+*/
+class SceneMeshesScenario : public BenchmarkScenario {
+	public:
+		String getName() const { return "scene_meshes"; }
+		String getDescription() const { return "2000 scene primitives, orbiting camera, 10% of entities rotating"; }
+		bool setup(const BenchmarkContext &context);
+		void update(unsigned int frame);
+		void teardown();
+		
+	protected:
+		Scene *scene;
+		std::vector<ScenePrimitive*> primitives;
+};
+
+/**
+* Animated skinned characters.
+*/
+class SkinnedCharactersScenario : public BenchmarkScenario {
+	public:
+		String getName() const { return "skinned_characters"; }
+		String getDescription() const { return "50 skinned ninja meshes playing a run animation"; }
+		bool setup(const BenchmarkContext &context);
+		void update(unsigned int frame);
+		void teardown();
+		
+	protected:
+		Scene *scene;
+};
+
+/**
+* Many continuous screen particle emitters moving around the screen.
+*/
+class ParticleStormScenario : public BenchmarkScenario {
+	public:
+		String getName() const { return "particle_storm"; }
+		String getDescription() const { return "16 screen emitters with 400 particles each, moving every frame"; }
+		bool setup(const BenchmarkContext &context);
+		void update(unsigned int frame);
+		void teardown();
+		
+	protected:
+		Screen *screen;
+		std::vector<ScreenParticleEmitter*> emitters;
+};
+
+#ifdef POLYBENCH_3DPHYSICS
+/**
+* A pile of rigid boxes dropped onto a plane.
+*/
+class PhysicsPileScenario : public BenchmarkScenario {
+	public:
+		String getName() const { return "physics_pile"; }
+		String getDescription() const { return "500 rigid boxes falling onto a static plane"; }
+		bool setup(const BenchmarkContext &context);
+		void update(unsigned int frame);
+		void teardown();
+		
+	protected:
+		PhysicsScene *scene;
+};
+#endif
+
+/**
+* A UITree with thousands of nodes, with one group expanded or collapsed every frame.
+*/
+class UITreeScenario : public BenchmarkScenario {
+	public:
+		String getName() const { return "ui_tree"; }
+		String getDescription() const { return "UITree with 40 groups of 75 nodes, toggling one group per frame"; }
+		bool setup(const BenchmarkContext &context);
+		void update(unsigned int frame);
+		void teardown();
+		
+	protected:
+		Screen *screen;
+		UITree *tree;
+};
+
+/**
+* Data source for UIVirtualTreeScenario. Nodes are encoded as integers.
+*/
+class BenchmarkTreeDataSource : public UITreeDataSource {
+	public:
+		int getNumChildren(void *node);
+		void *getChild(void *node, int index);
+		String getLabel(void *node);
+		
+		static const int NUM_GROUPS = 1000;
+		static const int NUM_CHILDREN = 100;
+};
+
+/**
+* A virtualized tree over 100000 nodes, scrolled and expanded every frame.
+*/
+class UIVirtualTreeScenario : public BenchmarkScenario {
+	public:
+		String getName() const { return "ui_virtual_tree"; }
+		String getDescription() const { return "UIVirtualTree over 1000 groups of 100 nodes, scrolling and expanding every frame"; }
+		bool setup(const BenchmarkContext &context);
+		void update(unsigned int frame);
+		void teardown();
+		
+	protected:
+		Screen *screen;
+		UIVirtualTree *tree;
+		BenchmarkTreeDataSource dataSource;
+};
+
+/**
+* Screen labels whose text changes every frame.
+*/
+class LabelChurnScenario : public BenchmarkScenario {
+	public:
+		String getName() const { return "label_churn"; }
+		String getDescription() const { return "400 screen labels, a third of them changing text every frame"; }
+		bool setup(const BenchmarkContext &context);
+		void update(unsigned int frame);
+		void teardown();
+		
+	protected:
+		Screen *screen;
+		std::vector<ScreenLabel*> labels;
+};
+
+/**
+* Loads a mesh from disk and adds it to a scene every frame.
+*/
+class MeshLoadScenario : public BenchmarkScenario {
+	public:
+		String getName() const { return "mesh_load"; }
+		String getDescription() const { return "loading a 64x64 sphere mesh from disk into a scene 4 times per frame"; }
+		bool setup(const BenchmarkContext &context);
+		void update(unsigned int frame);
+		void teardown();
+		
+	protected:
+		Scene *scene;
+		std::vector<SceneMesh*> meshes;
+		String meshFile;
+};
+
+/**
+* Parses an XML object file every frame.
+*/
+class ResourceParseScenario : public BenchmarkScenario {
+	public:
+		String getName() const { return "resource_parse"; }
+		String getDescription() const { return "parsing a 2000 entry XML object file every frame"; }
+		bool setup(const BenchmarkContext &context);
+		void update(unsigned int frame);
+		void teardown();
+		
+	protected:
+		String objectFile;
+};
+
+/**
+* Loads a mesh, a skeleton with an animation and a WAV file every frame through the binary loaders. Runs once with the default OSFILE buffering and once with buffering disabled to show the cost of unbuffered small reads.
+*/
+class AssetLoadScenario : public BenchmarkScenario {
+	public:
+		AssetLoadScenario(bool buffered);
+		
+		String getName() const { return buffered ? "asset_load" : "asset_load_unbuffered"; }
+		String getDescription() const { return buffered ? "loading a 32x32 sphere mesh, the ninja skeleton and run animation, and a 1 second WAV every frame" : "same as asset_load with OSFILE buffering disabled"; }
+		bool setup(const BenchmarkContext &context);
+		void update(unsigned int frame);
+		void teardown();
+		
+	protected:
+		bool buffered;
+		size_t previousBufferSize;
+		String meshFile;
+		String soundFile;
+		String skeletonFile;
+		String animationFile;
+};
+
+#ifdef POLYBENCH_LUA
+/**
+* Calls into the Lua bindings from a script, to measure the per call overhead of the generated glue. Every frame runs a loop of common entity, vector, color and matrix calls, including ones that return value types.
+*/
+class LuaCallsScenario : public BenchmarkScenario {
+	public:
+		String getName() const { return "lua_calls"; }
+		String getDescription() const { return "2000 iterations of 8 Lua binding calls per frame, half of them returning Vector3, Quaternion or Matrix4"; }
+		bool setup(const BenchmarkContext &context);
+		void update(unsigned int frame);
+		void teardown();
+		
+	protected:
+		bool runString(const String &script);
+		
+		lua_State *L;
+};
+#endif
@@ -0,0 +1,294 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#include "BenchmarkRunner.h"
+#include "PolyScreenManager.h"
+#include "PolyTimerManager.h"
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef _WINDOWS
+#include <windows.h>
+#else
+#include <sys/time.h>
+#endif
+
+double BenchmarkTimer::now() {
+#ifdef _WINDOWS
+	LARGE_INTEGER frequency, counter;
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&counter);
+	return ((double)counter.QuadPart * 1000.0) / (double)frequency.QuadPart;
+#else
+	struct timeval time;
+	gettimeofday(&time, NULL);
+	return time.tv_sec * 1000.0 + time.tv_usec / 1000.0;
+#endif
+}
+
+BenchmarkFrameTimings::BenchmarkFrameTimings() {
+	script = 0;
+	timers = 0;
+	materials = 0;
+	sceneUpdate = 0;
+	sceneRender = 0;
+	screens = 0;
+	frame = 0;
+}
+
+BenchmarkCore::BenchmarkCore(int xRes, int yRes, unsigned int timestep) : HeadlessCore(xRes, yRes) {
+	setFixedTimestep(timestep);
+}
+
+const BenchmarkFrameTimings& BenchmarkCore::getLastFrameTimings() const {
+	return lastFrameTimings;
+}
+
+bool BenchmarkCore::Update() {
+	if(!running)
+		return false;
+	
+	// Same steps as Core::updateCore() and CoreServices::Update(), timed one by one.
+	// The benchmarks install no update modules, so those are not run.
+	simulatedTicks += fixedTimestep;
+	
+	double frameStart = BenchmarkTimer::now();
+	renderer->BeginRender();
+	
+	frames++;
+	frameTicks = getTicks();
+	elapsed = frameTicks - lastFrameTicks;
+	if(elapsed > 1000)
+		elapsed = 1000;
+	
+	double start = BenchmarkTimer::now();
+	services->getTimerManager()->Update();
+	services->getTweenManager()->Update();
+	double end = BenchmarkTimer::now();
+	lastFrameTimings.timers = end - start;
+	
+	start = end;
+	services->getMaterialManager()->Update(elapsed);
+	services->getSoundManager()->Update(elapsed);
+	end = BenchmarkTimer::now();
+	lastFrameTimings.materials = end - start;
+	
+	start = end;
+	renderer->setPerspectiveMode();
+	services->getSceneManager()->UpdateVirtual();
+	renderer->clearScreen();
+	end = BenchmarkTimer::now();
+	lastFrameTimings.sceneUpdate = end - start;
+	
+	start = end;
+	services->getSceneManager()->Update();
+	end = BenchmarkTimer::now();
+	lastFrameTimings.sceneRender = end - start;
+	
+	start = end;
+	services->getScreenManager()->Update();
+	end = BenchmarkTimer::now();
+	lastFrameTimings.screens = end - start;
+	
+	if(frameTicks-lastFPSTicks >= 1000) {
+		fps = frames;
+		frames = 0;
+		lastFPSTicks = frameTicks;
+	}
+	lastFrameTicks = frameTicks;
+	
+	renderer->EndRender();
+	lastFrameTimings.frame = BenchmarkTimer::now() - frameStart;
+	
+	frameCount++;
+	return running;
+}
+
+BenchmarkRunner::BenchmarkRunner(BenchmarkCore *core, const BenchmarkContext &context, unsigned int warmupFrames, unsigned int frames) {
+	this->core = core;
+	this->context = context;
+	this->warmupFrames = warmupFrames;
+	this->frames = frames;
+}
+
+BenchmarkRunner::~BenchmarkRunner() {
+	for(int i=0; i < scenarios.size(); i++) {
+		delete scenarios[i];
+	}
+}
+
+void BenchmarkRunner::addScenario(BenchmarkScenario *scenario) {
+	scenarios.push_back(scenario);
+}
+
+unsigned int BenchmarkRunner::getNumScenarios() const {
+	return scenarios.size();
+}
+
+BenchmarkScenario *BenchmarkRunner::getScenario(unsigned int index) {
+	return scenarios[index];
+}
+
+BenchmarkResult BenchmarkRunner::runScenario(BenchmarkScenario *scenario) {
+	BenchmarkResult result;
+	result.name = scenario->getName();
+	result.skipped = false;
+	result.setupTime = 0;
+	result.teardownTime = 0;
+	result.allocationCount = 0;
+	result.allocationBytes = 0;
+	result.drawCalls = 0;
+	result.verticesDrawn = 0;
+	
+	srand(context.seed);
+	
+	double start = BenchmarkTimer::now();
+	if(!scenario->setup(context)) {
+		result.skipped = true;
+		return result;
+	}
+	result.setupTime = BenchmarkTimer::now() - start;
+	
+	unsigned int frame = 0;
+	for(unsigned int i=0; i < warmupFrames; i++) {
+		scenario->update(frame++);
+		core->Update();
+	}
+	
+	unsigned long startAllocationCount = benchmarkAllocationCount;
+	unsigned long startAllocationBytes = benchmarkAllocationBytes;
+	
+	for(unsigned int i=0; i < frames; i++) {
+		start = BenchmarkTimer::now();
+		scenario->update(frame++);
+		double script = BenchmarkTimer::now() - start;
+		core->Update();
+		
+		BenchmarkFrameTimings timings = core->getLastFrameTimings();
+		timings.script = script;
+		result.frameTimings.push_back(timings);
+		result.frameTimes.push_back(script + timings.frame);
+		
+		const RendererStats &stats = core->getNullRenderer()->getLastFrameStats();
+		result.drawCalls += stats.drawCalls;
+		result.verticesDrawn += stats.verticesDrawn;
+	}
+	
+	result.allocationCount = benchmarkAllocationCount - startAllocationCount;
+	result.allocationBytes = benchmarkAllocationBytes - startAllocationBytes;
+	
+	start = BenchmarkTimer::now();
+	scenario->teardown();
+	result.teardownTime = BenchmarkTimer::now() - start;
+	
+	return result;
+}
+
+String BenchmarkRunner::statsToJSON(std::vector<double> values) const {
+	if(values.size() == 0)
+		return "{}";
+	
+	std::sort(values.begin(), values.end());
+	
+	double sum = 0;
+	for(int i=0; i < values.size(); i++) {
+		sum += values[i];
+	}
+	double mean = sum / values.size();
+	
+	double variance = 0;
+	for(int i=0; i < values.size(); i++) {
+		variance += (values[i] - mean) * (values[i] - mean);
+	}
+	variance /= values.size();
+	
+	char buffer[512];
+	snprintf(buffer, sizeof(buffer), "{\"min\": %.4f, \"max\": %.4f, \"mean\": %.4f, \"median\": %.4f, \"p90\": %.4f, \"p99\": %.4f, \"stddev\": %.4f}",
+		values[0], values[values.size()-1], mean,
+		values[values.size() / 2],
+		values[std::min(values.size()-1, (size_t)(values.size() * 0.9))],
+		values[std::min(values.size()-1, (size_t)(values.size() * 0.99))],
+		sqrt(variance));
+	return String(buffer);
+}
+
+String BenchmarkRunner::resultsToJSON(const std::vector<BenchmarkResult> &results, unsigned int timestep) const {
+	char buffer[512];
+	
+	String json = "{\n";
+	snprintf(buffer, sizeof(buffer), "\t\"seed\": %u,\n\t\"timestep_ms\": %u,\n\t\"warmup_frames\": %u,\n\t\"frames\": %u,\n\t\"resolution\": [%d, %d],\n",
+		context.seed, timestep, warmupFrames, frames, context.xRes, context.yRes);
+	json += String(buffer);
+	json += "\t\"scenarios\": [\n";
+	
+	for(int i=0; i < results.size(); i++) {
+		const BenchmarkResult &result = results[i];
+		json += "\t\t{\n";
+		json += "\t\t\t\"name\": \"" + result.name + "\",\n";
+		
+		if(result.skipped) {
+			json += "\t\t\t\"skipped\": true\n";
+		} else {
+			snprintf(buffer, sizeof(buffer), "\t\t\t\"skipped\": false,\n\t\t\t\"setup_ms\": %.4f,\n\t\t\t\"teardown_ms\": %.4f,\n", result.setupTime, result.teardownTime);
+			json += String(buffer);
+			json += "\t\t\t\"frame_ms\": " + statsToJSON(result.frameTimes) + ",\n";
+			
+			std::vector<double> script, timers, materials, sceneUpdate, sceneRender, screens;
+			for(int j=0; j < result.frameTimings.size(); j++) {
+				script.push_back(result.frameTimings[j].script);
+				timers.push_back(result.frameTimings[j].timers);
+				materials.push_back(result.frameTimings[j].materials);
+				sceneUpdate.push_back(result.frameTimings[j].sceneUpdate);
+				sceneRender.push_back(result.frameTimings[j].sceneRender);
+				screens.push_back(result.frameTimings[j].screens);
+			}
+			json += "\t\t\t\"subsystems_ms\": {\n";
+			json += "\t\t\t\t\"script\": " + statsToJSON(script) + ",\n";
+			json += "\t\t\t\t\"timers_and_tweens\": " + statsToJSON(timers) + ",\n";
+			json += "\t\t\t\t\"materials\": " + statsToJSON(materials) + ",\n";
+			json += "\t\t\t\t\"scene_update\": " + statsToJSON(sceneUpdate) + ",\n";
+			json += "\t\t\t\t\"scene_render\": " + statsToJSON(sceneRender) + ",\n";
+			json += "\t\t\t\t\"screens\": " + statsToJSON(screens) + "\n";
+			json += "\t\t\t},\n";
+			
+			unsigned int numFrames = std::max((size_t)1, result.frameTimes.size());
+			snprintf(buffer, sizeof(buffer), "\t\t\t\"allocations\": {\"count\": %lu, \"bytes\": %lu, \"count_per_frame\": %.2f, \"bytes_per_frame\": %.2f},\n",
+				result.allocationCount, result.allocationBytes, (double)result.allocationCount / numFrames, (double)result.allocationBytes / numFrames);
+			json += String(buffer);
+			snprintf(buffer, sizeof(buffer), "\t\t\t\"renderer\": {\"draw_calls_per_frame\": %.2f, \"vertices_per_frame\": %.2f}\n",
+				(double)result.drawCalls / numFrames, (double)result.verticesDrawn / numFrames);
+			json += String(buffer);
+		}
+		
+		if(i < results.size()-1) {
+			json += "\t\t},\n";
+		} else {
+			json += "\t\t}\n";
+		}
+	}
+	
+	json += "\t]\n}\n";
+	return json;
+}
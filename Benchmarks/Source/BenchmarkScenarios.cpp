@@ -0,0 +1,462 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+ 
+
+#include "BenchmarkScenarios.h"
+#include "OSBasics.h"
+
+static Number benchmarkRandom(Number range) {
+	return ((Number)rand() / (Number)RAND_MAX) * range;
+}
+
+static bool benchmarkFileExists(const String &path) {
+	OSFILE *file = OSBasics::open(path, "rb");
+	if(!file) {
+		return false;
+	}
+	OSBasics::close(file);
+	return true;
+}
+
+static void benchmarkLoadUITheme(const BenchmarkContext &context) {
+	String themeDir = context.sourcePath + "/IDE/Contents/Resources/UIThemes/default/";
+	CoreServices::getInstance()->getConfig()->loadConfig("Polycode", themeDir + "theme.xml");
+	CoreServices::getInstance()->getResourceManager()->addDirResource(themeDir, false);
+}
+
+bool SceneMeshesScenario::setup(const BenchmarkContext &context) {
+	scene = new Scene();
+	scene->ownsChildren = true;
+	
+	for(int i=0; i < 2000; i++) {
+		ScenePrimitive *primitive;
+		if(i % 4 == 0) {
+			primitive = new ScenePrimitive(ScenePrimitive::TYPE_SPHERE, 0.5, 10, 10);
+		} else {
+			primitive = new ScenePrimitive(ScenePrimitive::TYPE_BOX, 0.8, 0.8, 0.8);
+		}
+		primitive->setPosition(benchmarkRandom(60.0) - 30.0, benchmarkRandom(20.0) - 10.0, benchmarkRandom(60.0) - 30.0);
+		primitive->setColor(benchmarkRandom(1.0), benchmarkRandom(1.0), benchmarkRandom(1.0), 1.0);
+		scene->addEntity(primitive);
+		primitives.push_back(primitive);
+	}
+	return true;
+}
+
+void SceneMeshesScenario::update(unsigned int frame) {
+	Number angle = ((Number)frame) * 0.01;
+	scene->getDefaultCamera()->setPosition(sin(angle) * 50.0, 15.0, cos(angle) * 50.0);
+	scene->getDefaultCamera()->lookAt(Vector3(0,0,0));
+	
+	for(int i=0; i < primitives.size(); i += 10) {
+		primitives[i]->setYaw(((Number)frame) * 2.0);
+	}
+}
+
+void SceneMeshesScenario::teardown() {
+	delete scene;
+	primitives.clear();
+}
+
+bool SkinnedCharactersScenario::setup(const BenchmarkContext &context) {
+	String resources = context.sourcePath + "/Examples/C++/Resources/";
+	if(!benchmarkFileExists(resources + "ninja.mesh") || !benchmarkFileExists(resources + "ninja.skeleton") || !benchmarkFileExists(resources + "run.anim")) {
+		return false;
+	}
+	
+	scene = new Scene();
+	scene->ownsChildren = true;
+	scene->getDefaultCamera()->setPosition(0, 40, 120);
+	scene->getDefaultCamera()->lookAt(Vector3(0,10,0));
+	
+	for(int i=0; i < 50; i++) {
+		SceneMesh *ninja = new SceneMesh(resources + "ninja.mesh");
+		ninja->loadTexture(resources + "ninja.png");
+		ninja->loadSkeleton(resources + "ninja.skeleton");
+		ninja->getSkeleton()->addAnimation("Run", resources + "run.anim");
+		ninja->getSkeleton()->playAnimation("Run");
+		ninja->setScale(0.1, 0.1, 0.1);
+		ninja->setPosition(((Number)(i % 10)) * 12.0 - 54.0, 0, ((Number)(i / 10)) * 12.0 - 24.0);
+		scene->addEntity(ninja);
+	}
+	return true;
+}
+
+void SkinnedCharactersScenario::update(unsigned int frame) {
+}
+
+void SkinnedCharactersScenario::teardown() {
+	delete scene;
+}
+
+bool ParticleStormScenario::setup(const BenchmarkContext &context) {
+	String particleImage = context.sourcePath + "/Examples/C++/Resources/particle.png";
+	if(!benchmarkFileExists(particleImage)) {
+		return false;
+	}
+	
+	screen = new Screen();
+	screen->ownsChildren = true;
+	
+	for(int i=0; i < 16; i++) {
+		ScreenParticleEmitter *emitter = new ScreenParticleEmitter(particleImage, screen, Particle::BILLBOARD_PARTICLE, ParticleEmitter::CONTINUOUS_EMITTER, 2.0, 400, Vector3(0.0,-60.0,0.0), Vector3(0.0,40.0,0.0), Vector3(30.0,20.0,0.0), Vector3(10.0,10.0,0.0));
+		emitter->setPosition(benchmarkRandom(context.xRes), benchmarkRandom(context.yRes));
+		screen->addChild(emitter);
+		emitters.push_back(emitter);
+	}
+	return true;
+}
+
+void ParticleStormScenario::update(unsigned int frame) {
+	for(int i=0; i < emitters.size(); i++) {
+		Number angle = ((Number)(frame + i * 20)) * 0.05;
+		emitters[i]->setPosition(emitters[i]->getPosition().x + cos(angle) * 2.0, emitters[i]->getPosition().y + sin(angle) * 2.0);
+	}
+}
+
+void ParticleStormScenario::teardown() {
+	for(int i=0; i < emitters.size(); i++) {
+		screen->removeChild(emitters[i]);
+		delete emitters[i];
+	}
+	emitters.clear();
+	delete screen;
+}
+
+#ifdef POLYBENCH_3DPHYSICS
+
+bool PhysicsPileScenario::setup(const BenchmarkContext &context) {
+	scene = new PhysicsScene();
+	scene->ownsChildren = true;
+	scene->getDefaultCamera()->setPosition(0, 25, 40);
+	scene->getDefaultCamera()->lookAt(Vector3(0,5,0));
+	
+	ScenePrimitive *ground = new ScenePrimitive(ScenePrimitive::TYPE_PLANE, 40, 40);
+	scene->addPhysicsChild(ground, PhysicsSceneEntity::SHAPE_PLANE, 0.0);
+	
+	for(int i=0; i < 500; i++) {
+		ScenePrimitive *box = new ScenePrimitive(ScenePrimitive::TYPE_BOX, 0.8, 0.8, 0.8);
+		box->setPosition(benchmarkRandom(8.0) - 4.0, 2.0 + ((Number)i) * 0.5, benchmarkRandom(8.0) - 4.0);
+		box->setYaw(benchmarkRandom(90.0));
+		scene->addPhysicsChild(box, PhysicsSceneEntity::SHAPE_BOX, 1.0);
+	}
+	return true;
+}
+
+void PhysicsPileScenario::update(unsigned int frame) {
+}
+
+void PhysicsPileScenario::teardown() {
+	delete scene;
+}
+
+#endif
+
+bool UITreeScenario::setup(const BenchmarkContext &context) {
+	benchmarkLoadUITheme(context);
+	
+	screen = new Screen();
+	screen->ownsChildren = true;
+	
+	tree = new UITree("boxIcon.png", "Root", 300);
+	for(int i=0; i < 40; i++) {
+		UITree *group = tree->addTreeChild("folder.png", "Group " + String::IntToString(i));
+		for(int j=0; j < 75; j++) {
+			group->addTreeChild("file.png", "Node " + String::IntToString(i) + "." + String::IntToString(j));
+		}
+	}
+	screen->addChild(tree);
+	return true;
+}
+
+void UITreeScenario::update(unsigned int frame) {
+	tree->getTreeChild(frame % tree->getNumTreeChildren())->toggleCollapsed();
+}
+
+void UITreeScenario::teardown() {
+	delete screen;
+}
+
+int BenchmarkTreeDataSource::getNumChildren(void *node) {
+	if(node == NULL) {
+		return NUM_GROUPS;
+	}
+	if((intptr_t)node <= NUM_GROUPS) {
+		return NUM_CHILDREN;
+	}
+	return 0;
+}
+
+void *BenchmarkTreeDataSource::getChild(void *node, int index) {
+	if(node == NULL) {
+		return (void*)(intptr_t)(index + 1);
+	}
+	return (void*)(intptr_t)(NUM_GROUPS + 1 + (((intptr_t)node) - 1) * NUM_CHILDREN + index);
+}
+
+String BenchmarkTreeDataSource::getLabel(void *node) {
+	intptr_t id = (intptr_t)node;
+	if(id <= NUM_GROUPS) {
+		return "Group " + String::IntToString(id - 1);
+	}
+	return "Node " + String::IntToString(id - NUM_GROUPS - 1);
+}
+
+bool UIVirtualTreeScenario::setup(const BenchmarkContext &context) {
+	benchmarkLoadUITheme(context);
+	
+	screen = new Screen();
+	screen->ownsChildren = true;
+	
+	tree = new UIVirtualTree(&dataSource, "file.png", 300, context.yRes);
+	tree->reloadData();
+	screen->addChild(tree);
+	return true;
+}
+
+void UIVirtualTreeScenario::update(unsigned int frame) {
+	if(frame % 10 == 0) {
+		tree->expandRow((frame * 7) % 500);
+	}
+	tree->scrollToRow((frame * 37) % 1000);
+}
+
+void UIVirtualTreeScenario::teardown() {
+	delete screen;
+}
+
+bool LabelChurnScenario::setup(const BenchmarkContext &context) {
+	screen = new Screen();
+	screen->ownsChildren = true;
+	
+	for(int i=0; i < 400; i++) {
+		ScreenLabel *label = new ScreenLabel("Label " + String::IntToString(i), 12 + (i % 4) * 2);
+		label->setPosition((i % 10) * (context.xRes / 10), (i / 10) * (context.yRes / 40));
+		screen->addChild(label);
+		labels.push_back(label);
+	}
+	return true;
+}
+
+void LabelChurnScenario::update(unsigned int frame) {
+	for(int i=frame % 3; i < labels.size(); i += 3) {
+		labels[i]->setText("Score: " + String::IntToString(frame * 13 + i));
+	}
+}
+
+void LabelChurnScenario::teardown() {
+	delete screen;
+	labels.clear();
+}
+
+bool MeshLoadScenario::setup(const BenchmarkContext &context) {
+	meshFile = "polybench_mesh_load.mesh";
+	
+	Mesh *mesh = new Mesh(Mesh::TRI_MESH);
+	mesh->createSphere(1.0, 64, 64);
+	mesh->saveToFile(meshFile);
+	delete mesh;
+	
+	scene = new Scene();
+	scene->ownsChildren = true;
+	return true;
+}
+
+void MeshLoadScenario::update(unsigned int frame) {
+	for(int i=0; i < meshes.size(); i++) {
+		scene->removeEntity(meshes[i]);
+		delete meshes[i];
+	}
+	meshes.clear();
+	
+	for(int i=0; i < 4; i++) {
+		SceneMesh *sceneMesh = new SceneMesh(meshFile);
+		sceneMesh->setPosition(((Number)i) * 3.0 - 4.5, 0, 0);
+		scene->addEntity(sceneMesh);
+		meshes.push_back(sceneMesh);
+	}
+}
+
+void MeshLoadScenario::teardown() {
+	delete scene;
+	meshes.clear();
+	OSBasics::removeItem(meshFile);
+}
+
+bool ResourceParseScenario::setup(const BenchmarkContext &context) {
+	objectFile = "polybench_resource_parse.xml";
+	
+	Object object;
+	object.root.name = "resources";
+	for(int i=0; i < 2000; i++) {
+		ObjectEntry *entry = object.root.addChild("resource");
+		entry->addChild("name", "resource_" + String::IntToString(i));
+		entry->addChild("type", i % 5);
+		entry->addChild("weight", benchmarkRandom(100.0));
+		entry->addChild("enabled", (i % 2) == 0);
+	}
+	object.saveToXML(objectFile);
+	return true;
+}
+
+void ResourceParseScenario::update(unsigned int frame) {
+	Object object;
+	object.loadFromXML(objectFile);
+}
+
+void ResourceParseScenario::teardown() {
+	OSBasics::removeItem(objectFile);
+}
+
+AssetLoadScenario::AssetLoadScenario(bool buffered) : buffered(buffered) {
+}
+
+bool AssetLoadScenario::setup(const BenchmarkContext &context) {
+	String resources = context.sourcePath + "/Examples/C++/Resources/";
+	skeletonFile = resources + "ninja.skeleton";
+	animationFile = resources + "run.anim";
+	if(!benchmarkFileExists(skeletonFile) || !benchmarkFileExists(animationFile)) {
+		return false;
+	}
+	
+	meshFile = "polybench_asset_load.mesh";
+	Mesh *mesh = new Mesh(Mesh::TRI_MESH);
+	mesh->createSphere(1.0, 32, 32);
+	mesh->saveToFile(meshFile);
+	delete mesh;
+	
+	// 1 second of 16 bit mono PCM
+	soundFile = "polybench_asset_load.wav";
+	unsigned int sampleRate = 44100;
+	std::vector<short> samples(sampleRate);
+	for(int i=0; i < samples.size(); i++) {
+		samples[i] = (short)(sin(((Number)i) * 0.05) * 16000.0);
+	}
+	unsigned int dataSize = samples.size() * sizeof(short);
+	unsigned int header[] = {36 + dataSize, 16, 1 | (1 << 16), sampleRate, sampleRate * 2, 2 | (16 << 16)};
+	
+	OSFILE *outFile = OSBasics::open(soundFile, "wb");
+	if(!outFile) {
+		return false;
+	}
+	OSBasics::write("RIFF", 1, 4, outFile);
+	OSBasics::writeValue(header[0], outFile);
+	OSBasics::write("WAVEfmt ", 1, 8, outFile);
+	OSBasics::writeArray(header + 1, 5, outFile);
+	OSBasics::write("data", 1, 4, outFile);
+	OSBasics::writeValue(dataSize, outFile);
+	OSBasics::writeArray(&samples[0], samples.size(), outFile);
+	OSBasics::close(outFile);
+	
+	previousBufferSize = OSBasics::getDefaultBufferSize();
+	if(!buffered) {
+		OSBasics::setDefaultBufferSize(0);
+	}
+	return true;
+}
+
+void AssetLoadScenario::update(unsigned int frame) {
+	Mesh *mesh = new Mesh(meshFile);
+	delete mesh;
+	
+	Skeleton *skeleton = new Skeleton(skeletonFile);
+	skeleton->addAnimation("Run", animationFile);
+	delete skeleton;
+	
+	Sound *sound = new Sound(soundFile);
+	delete sound;
+}
+
+void AssetLoadScenario::teardown() {
+	OSBasics::setDefaultBufferSize(previousBufferSize);
+	OSBasics::removeItem(meshFile);
+	OSBasics::removeItem(soundFile);
+}
+
+#ifdef POLYBENCH_LUA
+
+static int benchmarkLuaPrint(lua_State *L) {
+	const char *msg = lua_tostring(L, 1);
+	Logger::log("%s\n", msg ? msg : "nil");
+	return 0;
+}
+
+// Runs once per frame. The entity, vectors and color are created in setup so the loop only measures calls.
+static const char *luaCallsScript =
+	"local entity = SceneEntity()\n"
+	"local a = Vector3(1, 2, 3)\n"
+	"local b = Vector3(4, 5, 6)\n"
+	"local color = Color(1, 0.5, 0.25, 1)\n"
+	"function benchmarkFrame(frame)\n"
+	"	local sum = 0\n"
+	"	for i = 1, 2000 do\n"
+	"		entity:setPosition(i, frame, 0)\n"
+	"		local position = entity:getPosition()\n"
+	"		local rotation = entity:getRotationQuat()\n"
+	"		local matrix = entity:getTransformMatrix()\n"
+	"		local cross = a:crossProduct(b)\n"
+	"		sum = sum + cross:length() + position.x + rotation.w\n"
+	"		a.x = sum * 0.0001\n"
+	"		color:setColor(a.x, 0.5, 0.25, 1)\n"
+	"	end\n"
+	"	return sum\n"
+	"end\n";
+
+bool LuaCallsScenario::runString(const String &script) {
+	if(luaL_loadstring(L, script.c_str()) || lua_pcall(L, 0, 0, 0)) {
+		Logger::log("lua_calls: %s\n", lua_tostring(L, -1));
+		lua_pop(L, 1);
+		return false;
+	}
+	return true;
+}
+
+bool LuaCallsScenario::setup(const BenchmarkContext &context) {
+	String apiPath = context.sourcePath + "/Bindings/Contents/LUA/API/";
+	if(!benchmarkFileExists(apiPath + "Polycode.lua")) {
+		Logger::log("lua_calls: generated Lua API not found in %s\n", apiPath.c_str());
+		return false;
+	}
+	
+	L = lua_open();
+	luaL_openlibs(L);
+	luaopen_Polycode(L);
+	lua_register(L, "debugPrint", benchmarkLuaPrint);
+	
+	if(!runString("package.path = \"" + apiPath + "?.lua;\" .. package.path") || !runString("require \"class\" require \"Polycode\" require \"defaults\"") || !runString(luaCallsScript)) {
+		lua_close(L);
+		return false;
+	}
+	return true;
+}
+
+void LuaCallsScenario::update(unsigned int frame) {
+	lua_getfield(L, LUA_GLOBALSINDEX, "benchmarkFrame");
+	lua_pushinteger(L, frame);
+	lua_call(L, 1, 0);
+}
+
+void LuaCallsScenario::teardown() {
+	lua_close(L);
+}
+
+#endif
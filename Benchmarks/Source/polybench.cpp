@@ -0,0 +1,172 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+ 
+
+#include "BenchmarkScenarios.h"
+#include <algorithm>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef POLYBENCH_SOURCE_DIR
+#define POLYBENCH_SOURCE_DIR "."
+#endif
+
+unsigned long benchmarkAllocationCount = 0;
+unsigned long benchmarkAllocationBytes = 0;
+
+// Every allocation made through new is counted, so scenarios can report allocations per frame.
+void *operator new(size_t size) {
+	benchmarkAllocationCount++;
+	benchmarkAllocationBytes += size;
+	void *ptr = malloc(size ? size : 1);
+	if(!ptr)
+		throw std::bad_alloc();
+	return ptr;
+}
+
+void *operator new[](size_t size) {
+	return operator new(size);
+}
+
+void operator delete(void *ptr) throw() {
+	free(ptr);
+}
+
+void operator delete[](void *ptr) throw() {
+	free(ptr);
+}
+
+static void printUsage() {
+	printf("Usage: polybench [options]\n");
+	printf("  --frames N        measured frames per scenario (default 600)\n");
+	printf("  --warmup N        warmup frames per scenario (default 60)\n");
+	printf("  --seed N          random seed (default 1234)\n");
+	printf("  --timestep MS     fixed frame timestep in milliseconds (default 16)\n");
+	printf("  --resolution W H  framebuffer size (default 1280 720)\n");
+	printf("  --scenario NAME   only run the named scenario (can be repeated)\n");
+	printf("  --source PATH     Polycode source tree, used to find assets\n");
+	printf("  --output FILE     write JSON results to FILE instead of stdout\n");
+	printf("  --list            list scenarios and exit\n");
+}
+
+int main(int argc, char **argv) {
+	unsigned int frames = 600;
+	unsigned int warmupFrames = 60;
+	unsigned int timestep = 16;
+	bool listOnly = false;
+	String outputFile;
+	std::vector<String> selectedScenarios;
+	
+	BenchmarkContext context;
+	context.sourcePath = POLYBENCH_SOURCE_DIR;
+	context.seed = 1234;
+	context.xRes = 1280;
+	context.yRes = 720;
+	
+	for(int i=1; i < argc; i++) {
+		if(strcmp(argv[i], "--frames") == 0 && i+1 < argc) {
+			frames = atoi(argv[++i]);
+		} else if(strcmp(argv[i], "--warmup") == 0 && i+1 < argc) {
+			warmupFrames = atoi(argv[++i]);
+		} else if(strcmp(argv[i], "--seed") == 0 && i+1 < argc) {
+			context.seed = atoi(argv[++i]);
+		} else if(strcmp(argv[i], "--timestep") == 0 && i+1 < argc) {
+			timestep = atoi(argv[++i]);
+		} else if(strcmp(argv[i], "--resolution") == 0 && i+2 < argc) {
+			context.xRes = atoi(argv[++i]);
+			context.yRes = atoi(argv[++i]);
+		} else if(strcmp(argv[i], "--scenario") == 0 && i+1 < argc) {
+			selectedScenarios.push_back(String(argv[++i]));
+		} else if(strcmp(argv[i], "--source") == 0 && i+1 < argc) {
+			context.sourcePath = String(argv[++i]);
+		} else if(strcmp(argv[i], "--output") == 0 && i+1 < argc) {
+			outputFile = String(argv[++i]);
+		} else if(strcmp(argv[i], "--list") == 0) {
+			listOnly = true;
+		} else {
+			printUsage();
+			return 1;
+		}
+	}
+	
+	BenchmarkCore *core = new BenchmarkCore(context.xRes, context.yRes, timestep);
+	
+	String fontDir = context.sourcePath + "/Assets/Default asset pack/default/";
+	CoreServices::getInstance()->getFontManager()->registerFont("sans", fontDir + "sans.ttf");
+	CoreServices::getInstance()->getFontManager()->registerFont("mono", fontDir + "mono.ttf");
+	CoreServices::getInstance()->getFontManager()->registerFont("serif", fontDir + "serif.ttf");
+	
+	BenchmarkRunner runner(core, context, warmupFrames, frames);
+	runner.addScenario(new SceneMeshesScenario());
+	runner.addScenario(new SkinnedCharactersScenario());
+	runner.addScenario(new ParticleStormScenario());
+#ifdef POLYBENCH_3DPHYSICS
+	runner.addScenario(new PhysicsPileScenario());
+#endif
+	runner.addScenario(new UITreeScenario());
+	runner.addScenario(new UIVirtualTreeScenario());
+	runner.addScenario(new LabelChurnScenario());
+	runner.addScenario(new MeshLoadScenario());
+	runner.addScenario(new ResourceParseScenario());
+	runner.addScenario(new AssetLoadScenario(true));
+	runner.addScenario(new AssetLoadScenario(false));
+#ifdef POLYBENCH_LUA
+	runner.addScenario(new LuaCallsScenario());
+#endif
+	
+	if(listOnly) {
+		for(int i=0; i < runner.getNumScenarios(); i++) {
+			printf("%-20s %s\n", runner.getScenario(i)->getName().c_str(), runner.getScenario(i)->getDescription().c_str());
+		}
+		delete core;
+		return 0;
+	}
+	
+	std::vector<BenchmarkResult> results;
+	for(int i=0; i < runner.getNumScenarios(); i++) {
+		BenchmarkScenario *scenario = runner.getScenario(i);
+		if(selectedScenarios.size() > 0 && std::find(selectedScenarios.begin(), selectedScenarios.end(), scenario->getName()) == selectedScenarios.end()) {
+			continue;
+		}
+		fprintf(stderr, "polybench: running %s\n", scenario->getName().c_str());
+		results.push_back(runner.runScenario(scenario));
+	}
+	
+	String json = runner.resultsToJSON(results, timestep);
+	if(outputFile == "") {
+		printf("%s", json.c_str());
+	} else {
+		FILE *file = fopen(outputFile.c_str(), "w");
+		if(!file) {
+			fprintf(stderr, "polybench: could not write %s\n", outputFile.c_str());
+			delete core;
+			return 1;
+		}
+		fwrite(json.c_str(), 1, json.length(), file);
+		fclose(file);
+	}
+	
+	delete core;
+	return 0;
+}
@@ -28,9 +28,9 @@ end
 
 local assert = u.assert
 
-function u.fwrongarg(...)
+function u.fwrongarg(n,expected,got)
   return function()
-    return wrongarg(unpack(arg))
+    return wrongarg(n,expected,got)
   end
 end
 
@@ -71,7 +71,7 @@ local metatable = {}
 for _, name in ipairs(METAMETHODS) do
   local name = name
   metatable[name] = function(...)
-    local a, b = unpack(arg)
+    local a, b = ...
     local f
     if isobject(a) then
       f = a[name]
@@ -93,7 +93,7 @@ for _, name in ipairs(METAMETHODS) do
                  local cname = rawget(class,INFO).__name
                  return 'meta-method not found: '..cname..':'..name
                end)
-    return f(unpack(arg))
+    return f(...)
   end
 end
 
@@ -140,11 +140,24 @@ function setclass(o,class)
   rawget(o,INFO).__class = class
 end
 
+-- Method lookups are cached per method table, including misses. Storing a
+-- method or changing a superclass drops every cache.
+local NOTFOUND = {}
+local methodcache
+
+local
+function clearmethodcache()
+  methodcache = setmetatable({},{__mode='k'})
+end
+
+clearmethodcache()
+
 local
 function setsuper(class,superclass)
   assert(isobject(class), fwrongarg(1,'object',class))
   assert(isobject(superclass), fwrongarg(2,'object',superclass))
   rawget(class,INFO).__super = superclass
+  clearmethodcache()
 end
 
 local
@@ -158,11 +171,10 @@ function object2class(o,name)
 end
 
 local
-function findmethod(class,name,iscmethod)
-  local storage = iscmethod and '__cmethods' or '__methods'
+function lookupmethod(class,name,storage)
   while class do
     local info = rawget(class,INFO)
-    value = info[storage][name]
+    local value = info[storage][name]
     if value ~= nil then
       return value
     end
@@ -170,6 +182,31 @@ function findmethod(class,name,iscmethod)
   end
 end
 
+local
+function findmethod(class,name,iscmethod)
+  if not class then
+    return nil
+  end
+  local storage = iscmethod and '__cmethods' or '__methods'
+  local methods = rawget(class,INFO)[storage]
+  local cache = methodcache[methods]
+  if cache == nil then
+    cache = {}
+    methodcache[methods] = cache
+  end
+  local value = cache[name]
+  if value == nil then
+    value = lookupmethod(class,name,storage)
+    if value == nil then
+      value = NOTFOUND
+    end
+    cache[name] = value
+  end
+  if value ~= NOTFOUND then
+    return value
+  end
+end
+
 
 
 function metatable:__index(name)
@@ -230,12 +267,18 @@ function makesupermethod(self,name,iscmethod)
       method = findmethod(super,name,iscmethod)
     end
     assert(method, "no super method for "..classinfo.__name..":"..name)
-    return method(self,unpack(arg))
+    return method(self,...)
   end
 end
 
 local methodsmeta = {}
 
+local
+function restorefenv(f,env,...)
+  setfenv(f,env)
+  return ...
+end
+
 function methodsmeta:__call(object,...)
   local env = getfenv(self.__f)
   local metafenv = {
@@ -247,14 +290,21 @@ function methodsmeta:__call(object,...)
   }
   setmetatable(fenv,metafenv)
   setfenv(self.__f,fenv)
-  local result = {self.__f(object,unpack(arg))}
-  setfenv(self.__f,env)
-  return unpack(result)
+  return restorefenv(self.__f,env,self.__f(object,...))
+end
+
+-- Only methods that refer to 'super' need their environment swapped on every
+-- call, everything else (all of the generated bindings) is stored as is.
+local
+function usessuper(f)
+  local ok, code = pcall(string.dump,f)
+  return not ok or string.find(code,'super',1,true) ~= nil
 end
 
 local
 function storemethod(storage,name,iscmethod,method)
-  if type(method) == 'function' then
+  clearmethodcache()
+  if type(method) == 'function' and usessuper(method) then
     local t = {
       __name = name,
       __f = method,
@@ -274,12 +324,12 @@ rawget(Class,INFO).__methods.__newindex =
 
 
 function Class:__call__(...)
-  local instance = self:new(unpack(arg))
-  instance:initialize(unpack(arg))
+  local instance = self:new(...)
+  instance:initialize(...)
   instance.__cbody = nil
   local constructor = instance[rawget(self,INFO).__name]
   if constructor ~= nil then
-  	constructor(instance, unpack(arg))
+  	constructor(instance, ...)
   	constructor = nil
   end
   return instance
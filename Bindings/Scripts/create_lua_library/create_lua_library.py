@@ -12,6 +12,10 @@ def mkdir_p(path): # Same effect as mkdir -p, create dir and all necessary paren
 			pass
 		else: raise
 
+# Small classes that are copied around by value. Lua-side instances of these live in
+# full userdata owned by the Lua garbage collector instead of on the C++ heap.
+valueTypes = ["Vector2", "Vector3", "Color", "Quaternion", "Matrix4", "Rectangle"]
+
 def createLUABindings(inputPath, prefix, mainInclude, libSmallName, libName, apiPath, apiClassPath, includePath, sourcePath, inheritInModuleFiles):
 	out = ""
 	sout = ""
@@ -36,17 +40,88 @@ def createLUABindings(inputPath, prefix, mainInclude, libSmallName, libName, api
 	out += "#include \"lualib.h\"\n"
 	out += "#include \"lauxlib.h\"\n"
 	out += "} // extern \"C\" \n\n"
+	out += "#include <new>\n\n"
 
 	files = os.listdir(inputPath)
 	filteredFiles = []
 	for fileName in files:
-		ignore = ["PolyGLSLProgram", "PolyGLSLShader", "PolyGLSLShaderModule", "PolyWinCore", "PolyCocoaCore", "PolyAGLCore", "PolySDLCore", "Poly_iPhone", "PolyGLES1Renderer", "PolyGLRenderer", "tinyxml", "tinystr", "OpenGLCubemap", "PolyiPhoneCore", "PolyGLES1Texture", "PolyGLTexture", "PolyGLVertexBuffer", "PolyThreaded", "PolyGLHeaders", "GLee"]
+		ignore = ["PolyGLSLProgram", "PolyGLSLShader", "PolyGLSLShaderModule", "PolyWinCore", "PolyCocoaCore", "PolyAGLCore", "PolySDLCore", "Poly_iPhone", "PolyGLES1Renderer", "PolyGLRenderer", "tinyxml", "tinystr", "OpenGLCubemap", "PolyiPhoneCore", "PolyGLES1Texture", "PolyGLTexture", "PolyGLVertexBuffer", "PolyThreaded", "PolySoundStream", "PolyGLHeaders", "GLee"]
 		if fileName.split(".")[1] == "h" and fileName.split(".")[0] not in ignore:
 			filteredFiles.append(fileName)
 			out += "#include \"%s\"\n" % (fileName)
 
 	out += "\nusing namespace std;\n\n"
 	out += "\nnamespace Polycode {\n\n"
+
+	# Every wrapper header gets these, the guard keeps them from clashing when several are included together.
+	out += "#ifndef POLYCODE_LUA_WRAPPER_HELPERS\n"
+	out += "#define POLYCODE_LUA_WRAPPER_HELPERS\n\n"
+	out += "// Returns the object behind a light or full userdata argument.\n"
+	out += "static inline void *polycodeLuaCheckPointer(lua_State *L, int idx) {\n"
+	out += "\tvoid *ptr = lua_touserdata(L, idx);\n"
+	out += "\tif(ptr == NULL) {\n"
+	out += "\t\tluaL_typerror(L, idx, \"userdata\");\n"
+	out += "\t}\n"
+	out += "\treturn ptr;\n"
+	out += "}\n\n"
+	out += "template<class T> static int polycodeLuaDestroyValue(lua_State *L) {\n"
+	out += "\t((T*)lua_touserdata(L, 1))->~T();\n"
+	out += "\treturn 0;\n"
+	out += "}\n\n"
+	out += "// Pushes uninitialized storage for a T owned by the Lua garbage collector. The metatable that destroys it is created once per type and kept in the registry.\n"
+	out += "template<class T> static void *polycodeLuaNewValue(lua_State *L) {\n"
+	out += "\tstatic char metatableKey;\n"
+	out += "\tvoid *storage = lua_newuserdata(L, sizeof(T));\n"
+	out += "\tlua_pushlightuserdata(L, &metatableKey);\n"
+	out += "\tlua_rawget(L, LUA_REGISTRYINDEX);\n"
+	out += "\tif(lua_isnil(L, -1)) {\n"
+	out += "\t\tlua_pop(L, 1);\n"
+	out += "\t\tlua_createtable(L, 0, 1);\n"
+	out += "\t\tlua_pushcfunction(L, polycodeLuaDestroyValue<T>);\n"
+	out += "\t\tlua_setfield(L, -2, \"__gc\");\n"
+	out += "\t\tlua_pushlightuserdata(L, &metatableKey);\n"
+	out += "\t\tlua_pushvalue(L, -2);\n"
+	out += "\t\tlua_rawset(L, LUA_REGISTRYINDEX);\n"
+	out += "\t}\n"
+	out += "\tlua_setmetatable(L, -2);\n"
+	out += "\treturn storage;\n"
+	out += "}\n\n"
+	out += "// Anchors a garbage collected value that was passed by pointer to the object it was given to, in case the object keeps the pointer (BezierPathTween, QuaternionTween). Each owner keeps one value per argument slot, so passing a new value releases the old one.\n"
+	out += "static inline void polycodeLuaRetainValue(lua_State *L, void *owner, int idx) {\n"
+	out += "\tif(lua_type(L, idx) != LUA_TUSERDATA) {\n"
+	out += "\t\treturn;\n"
+	out += "\t}\n"
+	out += "\tlua_getfield(L, LUA_REGISTRYINDEX, \"polycodeLuaRetained\");\n"
+	out += "\tif(lua_isnil(L, -1)) {\n"
+	out += "\t\tlua_pop(L, 1);\n"
+	out += "\t\tlua_newtable(L);\n"
+	out += "\t\tlua_pushvalue(L, -1);\n"
+	out += "\t\tlua_setfield(L, LUA_REGISTRYINDEX, \"polycodeLuaRetained\");\n"
+	out += "\t}\n"
+	out += "\tlua_pushlightuserdata(L, owner);\n"
+	out += "\tlua_rawget(L, -2);\n"
+	out += "\tif(lua_isnil(L, -1)) {\n"
+	out += "\t\tlua_pop(L, 1);\n"
+	out += "\t\tlua_newtable(L);\n"
+	out += "\t\tlua_pushlightuserdata(L, owner);\n"
+	out += "\t\tlua_pushvalue(L, -2);\n"
+	out += "\t\tlua_rawset(L, -4);\n"
+	out += "\t}\n"
+	out += "\tlua_pushvalue(L, idx);\n"
+	out += "\tlua_rawseti(L, -2, idx);\n"
+	out += "\tlua_pop(L, 2);\n"
+	out += "}\n\n"
+	out += "// Lets the collector reclaim the values anchored to an object that is being deleted.\n"
+	out += "static inline void polycodeLuaReleaseValues(lua_State *L, void *owner) {\n"
+	out += "\tlua_getfield(L, LUA_REGISTRYINDEX, \"polycodeLuaRetained\");\n"
+	out += "\tif(!lua_isnil(L, -1)) {\n"
+	out += "\t\tlua_pushlightuserdata(L, owner);\n"
+	out += "\t\tlua_pushnil(L);\n"
+	out += "\t\tlua_rawset(L, -3);\n"
+	out += "\t}\n"
+	out += "\tlua_pop(L, 1);\n"
+	out += "}\n\n"
+	out += "#endif\n\n"
 	
 	if prefix == "Polycode":
 		out += "class LuaEventHandler : public EventHandler {\n"
@@ -126,43 +201,39 @@ def createLUABindings(inputPath, prefix, mainInclude, libSmallName, libName, api
 						#else:
 						#	print(">>> Skipping %s[%s %s]" % (ckey, pp["type"], pp["name"]))
 
-				pidx = 0
-
 				# hack to fix the lack of multiple inheritance
 				#if ckey == "ScreenParticleEmitter" or ckey == "SceneParticleEmitter":
 				#		pps.append({"name": "emitter", "type": "ParticleEmitter"})
 
+				# Properties are dispatched through tables of accessors local to the class file instead of string comparison chains.
 				if len(pps) > 0:
-					lout += "function %s:__index__(name)\n" % ckey
+					lout += "local __getters = {}\n\n"
 					for pp in pps:
 						pp["type"] = pp["type"].replace("Polycode::", "")
 						pp["type"] = pp["type"].replace("std::", "")
-						if pidx == 0:
-							lout += "\tif name == \"%s\" then\n" % (pp["name"])
-						else:
-							lout += "\telseif name == \"%s\" then\n" % (pp["name"])
+						lout += "function __getters.%s(self)\n" % (pp["name"])
 
 						if pp["type"] == "Number" or  pp["type"] == "String" or pp["type"] == "int" or pp["type"] == "bool":
-							lout += "\t\treturn %s.%s_get_%s(self.__ptr)\n" % (libName, ckey, pp["name"])
+							lout += "\treturn %s.%s_get_%s(self.__ptr)\n" % (libName, ckey, pp["name"])
 						elif (ckey == "ScreenParticleEmitter" or ckey == "SceneParticleEmitter") and pp["name"] == "emitter":
-							lout += "\t\tlocal ret = %s(\"__skip_ptr__\")\n" % (pp["type"])
-							lout += "\t\tret.__ptr = self.__ptr\n"
-							lout += "\t\treturn ret\n"
+							lout += "\tlocal ret = %s(\"__skip_ptr__\")\n" % (pp["type"])
+							lout += "\tret.__ptr = self.__ptr\n"
+							lout += "\treturn ret\n"
 						else:
-							lout += "\t\tretVal = %s.%s_get_%s(self.__ptr)\n" % (libName, ckey, pp["name"])
-							lout += "\t\tif Polycore.__ptr_lookup[retVal] ~= nil then\n"
-							lout += "\t\t\treturn Polycore.__ptr_lookup[retVal]\n"
-							lout += "\t\telse\n"
-							lout += "\t\t\tPolycore.__ptr_lookup[retVal] = %s(\"__skip_ptr__\")\n" % (pp["type"])
-							lout += "\t\t\tPolycore.__ptr_lookup[retVal].__ptr = retVal\n"
-							lout += "\t\t\treturn Polycore.__ptr_lookup[retVal]\n"
-							lout += "\t\tend\n"
+							lout += "\tlocal retVal = %s.%s_get_%s(self.__ptr)\n" % (libName, ckey, pp["name"])
+							lout += "\tlocal ret = Polycore.__ptr_lookup[retVal]\n"
+							lout += "\tif ret == nil then\n"
+							lout += "\t\tret = %s(\"__skip_ptr__\")\n" % (pp["type"])
+							lout += "\t\tret.__ptr = retVal\n"
+							lout += "\t\tPolycore.__ptr_lookup[retVal] = ret\n"
+							lout += "\tend\n"
+							lout += "\treturn ret\n"
+						lout += "end\n\n"
 
 						if not ((ckey == "ScreenParticleEmitter" or ckey == "SceneParticleEmitter") and pp["name"] == "emitter"):
 							sout += "\t\t{\"%s_get_%s\", %s_%s_get_%s},\n" % (ckey, pp["name"], libName, ckey, pp["name"])
 							out += "static int %s_%s_get_%s(lua_State *L) {\n" % (libName, ckey, pp["name"])
-							out += "\tluaL_checktype(L, 1, LUA_TLIGHTUSERDATA);\n"
-							out += "\t%s *inst = (%s*)lua_topointer(L, 1);\n" % (ckey, ckey)
+							out += "\t%s *inst = (%s*)polycodeLuaCheckPointer(L, 1);\n" % (ckey, ckey)
 
 							outfunc = "lua_pushlightuserdata"
 							retFunc = ""
@@ -182,30 +253,29 @@ def createLUABindings(inputPath, prefix, mainInclude, libSmallName, libName, api
 								out += "\t%s(L, &inst->%s%s);\n" % (outfunc, pp["name"], retFunc)
 							out += "\treturn 1;\n"
 							out += "}\n\n"
-						pidx = pidx + 1
 
+					lout += "function %s:__index__(name)\n" % ckey
+					lout += "\tlocal getter = __getters[name]\n"
+					lout += "\tif getter ~= nil then\n"
+					lout += "\t\treturn getter(self)\n"
 					lout += "\tend\n"
 					lout += "end\n"
 
 				lout += "\n\n"
 				pidx = 0
 				if len(pps) > 0:
-					lout += "function %s:__set_callback(name,value)\n" % ckey
+					setters = ""
 					for pp in pps:
 						pp["type"] = pp["type"].replace("Polycode::", "")
 						pp["type"] = pp["type"].replace("std::", "")
 						if pp["type"] == "Number" or  pp["type"] == "String" or pp["type"] == "int" or pp["type"] == "bool":
-							if pidx == 0:
-								lout += "\tif name == \"%s\" then\n" % (pp["name"])
-							else:
-								lout += "\telseif name == \"%s\" then\n" % (pp["name"])
-							lout += "\t\t%s.%s_set_%s(self.__ptr, value)\n" % (libName, ckey, pp["name"])
-							lout += "\t\treturn true\n"
+							setters += "function __setters.%s(self, value)\n" % (pp["name"])
+							setters += "\t%s.%s_set_%s(self.__ptr, value)\n" % (libName, ckey, pp["name"])
+							setters += "end\n\n"
 
 							sout += "\t\t{\"%s_set_%s\", %s_%s_set_%s},\n" % (ckey, pp["name"], libName, ckey, pp["name"])
 							out += "static int %s_%s_set_%s(lua_State *L) {\n" % (libName, ckey, pp["name"])
-							out += "\tluaL_checktype(L, 1, LUA_TLIGHTUSERDATA);\n"
-							out += "\t%s *inst = (%s*)lua_topointer(L, 1);\n" % (ckey, ckey)
+							out += "\t%s *inst = (%s*)polycodeLuaCheckPointer(L, 1);\n" % (ckey, ckey)
 
 							outfunc = "lua_topointer"
 							if pp["type"] == "Number":
@@ -224,11 +294,18 @@ def createLUABindings(inputPath, prefix, mainInclude, libSmallName, libName, api
 							out += "}\n\n"
 							pidx = pidx + 1
 					if pidx != 0:
+						lout += "local __setters = {}\n\n"
+						lout += setters
+					lout += "function %s:__set_callback(name,value)\n" % ckey
+					if pidx != 0:
+						lout += "\tlocal setter = __setters[name]\n"
+						lout += "\tif setter ~= nil then\n"
+						lout += "\t\tsetter(self, value)\n"
+						lout += "\t\treturn true\n"
 						lout += "\tend\n"
 					lout += "\treturn false\n"
 					lout += "end\n"
 
-
 				lout += "\n\n"
 				for pm in c["methods"]["public"]:
 					if pm["name"] in parsed_methods or pm["name"].find("operator") > -1 or pm["name"] in ignore_methods:
@@ -248,11 +325,12 @@ def createLUABindings(inputPath, prefix, mainInclude, libSmallName, libName, api
 							out += "static int %s_%s_%s(lua_State *L) {\n" % (libName, ckey, pm["name"])
 
 							if pm["rtnType"].find("static ") == -1:
-								out += "\tluaL_checktype(L, 1, LUA_TLIGHTUSERDATA);\n"
-								out += "\t%s *inst = (%s*)lua_topointer(L, 1);\n" % (ckey, ckey)
+								out += "\t%s *inst = (%s*)polycodeLuaCheckPointer(L, 1);\n" % (ckey, ckey)
 							idx = 2
 						paramlist = []
 						lparamlist = []
+						# Value types passed by pointer may be kept by the callee, so they are anchored to the instance
+						retainedParams = []
 						for param in pm["parameters"]:
 							if not param.has_key("type"):
 								continue
@@ -268,14 +346,17 @@ def createLUABindings(inputPath, prefix, mainInclude, libSmallName, libName, api
 
 							param["name"] = param["name"].replace("end", "_end").replace("repeat", "_repeat")
 							if"type" in param:
-								luatype = "LUA_TLIGHTUSERDATA"
-								checkfunc = "lua_islightuserdata"
+								# Objects can arrive as light userdata or, for value types, as full userdata
+								luatype = "LUA_TUSERDATA"
+								checkfunc = "lua_isuserdata"
 								if param["type"].find("*") > -1:
-									luafunc = "(%s)lua_topointer" % (param["type"].replace("Polygon", "Polycode::Polygon").replace("Rectangle", "Polycode::Rectangle"))
+									luafunc = "(%s)polycodeLuaCheckPointer" % (param["type"].replace("Polygon", "Polycode::Polygon").replace("Rectangle", "Polycode::Rectangle"))
+									if param["type"].replace("*", "") in valueTypes:
+										retainedParams.append(idx)
 								elif param["type"].find("&") > -1:
-									luafunc = "*(%s*)lua_topointer" % (param["type"].replace("const", "").replace("&", "").replace("Polygon", "Polycode::Polygon").replace("Rectangle", "Polycode::Rectangle"))
+									luafunc = "*(%s*)polycodeLuaCheckPointer" % (param["type"].replace("const", "").replace("&", "").replace("Polygon", "Polycode::Polygon").replace("Rectangle", "Polycode::Rectangle"))
 								else:
-									luafunc = "*(%s*)lua_topointer" % (param["type"].replace("Polygon", "Polycode::Polygon").replace("Rectangle", "Polycode::Rectangle"))
+									luafunc = "*(%s*)polycodeLuaCheckPointer" % (param["type"].replace("Polygon", "Polycode::Polygon").replace("Rectangle", "Polycode::Rectangle"))
 								lend = ".__ptr"
 								if param["type"] == "int" or param["type"] == "unsigned int":
 									luafunc = "lua_tointeger"
@@ -301,7 +382,7 @@ def createLUABindings(inputPath, prefix, mainInclude, libSmallName, libName, api
 								param["type"] = param["type"].replace("Polygon", "Polycode::Polygon").replace("Rectangle", "Polycode::Rectangle")
 
 								if "defaltValue" in param:
-									if checkfunc != "lua_islightuserdata" or (checkfunc == "lua_islightuserdata" and param["defaltValue"] == "NULL"):
+									if checkfunc != "lua_isuserdata" or (checkfunc == "lua_isuserdata" and param["defaltValue"] == "NULL"):
 										#param["defaltValue"] = param["defaltValue"].replace(" 0f", ".0f")
 										param["defaltValue"] = param["defaltValue"].replace(": :", "::")
 										#param["defaltValue"] = param["defaltValue"].replace("0 ", "0.")
@@ -314,13 +395,15 @@ def createLUABindings(inputPath, prefix, mainInclude, libSmallName, libName, api
 										out += "\t\t%s = %s;\n" % (param["name"], param["defaltValue"])
 										out += "\t}\n"
 									else:
-										out += "\tluaL_checktype(L, %d, %s);\n" % (idx, luatype);
+										if luatype != "LUA_TUSERDATA":
+											out += "\tluaL_checktype(L, %d, %s);\n" % (idx, luatype);
 										if param["type"] == "String":
 											out += "\t%s %s = String(%s(L, %d));\n" % (param["type"], param["name"], luafunc, idx)
 										else:
 											out += "\t%s %s = %s(L, %d);\n" % (param["type"], param["name"], luafunc, idx)
 								else:
-									out += "\tluaL_checktype(L, %d, %s);\n" % (idx, luatype);
+									if luatype != "LUA_TUSERDATA":
+										out += "\tluaL_checktype(L, %d, %s);\n" % (idx, luatype);
 									if param["type"] == "String":
 										out += "\t%s %s = String(%s(L, %d));\n" % (param["type"], param["name"], luafunc, idx)
 									else:
@@ -335,11 +418,19 @@ def createLUABindings(inputPath, prefix, mainInclude, libSmallName, libName, api
 								out += "\tLuaEventHandler *inst = new LuaEventHandler();\n"
 								out += "\tinst->wrapperIndex = luaL_ref(L, LUA_REGISTRYINDEX );\n"
 								out += "\tinst->L = L;\n"
+								out += "\tlua_pushlightuserdata(L, (void*)inst);\n"
+							elif ckey in valueTypes:
+								out += "\tnew (polycodeLuaNewValue<%s>(L)) %s(%s);\n" % (ckey, ckey, ", ".join(paramlist))
 							else:
 								out += "\t%s *inst = new %s(%s);\n" % (ckey, ckey, ", ".join(paramlist))
-							out += "\tlua_pushlightuserdata(L, (void*)inst);\n"
+								for retainedIdx in retainedParams:
+									out += "\tpolycodeLuaRetainValue(L, (void*)inst, %d);\n" % (retainedIdx)
+								out += "\tlua_pushlightuserdata(L, (void*)inst);\n"
 							out += "\treturn 1;\n"
 						else:
+							if pm["rtnType"].find("static ") == -1 and ckey not in valueTypes:
+								for retainedIdx in retainedParams:
+									out += "\tpolycodeLuaRetainValue(L, (void*)inst, %d);\n" % (retainedIdx)
 							if pm["rtnType"].find("static ") == -1:
 								call = "inst->%s(%s)" % (pm["name"], ", ".join(paramlist))
 							else:
@@ -377,22 +468,23 @@ def createLUABindings(inputPath, prefix, mainInclude, libSmallName, libName, api
 								elif basicType == True:
 									out += "\t%s(L, %s%s);\n" % (outfunc, call, retFunc)
 								else:
-									className = pm["rtnType"].replace("const", "").replace("&", "").replace("inline", "").replace("virtual", "").replace("static", "")
+									className = pm["rtnType"].replace("const", "").replace("&", "").replace("inline", "").replace("virtual", "").replace("static", "").strip()
 									if className == "Polygon":
 										className = "Polycode::Polygon"
 									if className == "Rectangle":
 										className = "Polycode::Rectangle"
-									out += "\t%s *retInst = new %s();\n" % (className, className)
-									out += "\t*retInst = %s;\n" % (call)
-									out += "\t%s(L, retInst);\n" % (outfunc)
+									# Returned by value, the copy is owned by the Lua garbage collector
+									out += "\tnew (polycodeLuaNewValue<%s>(L)) %s(%s);\n" % (className, className, call)
 								out += "\treturn 1;\n"
 						out += "}\n\n"
 
 						if pm["name"] == ckey:
 							lout += "function %s:%s(...)\n" % (ckey, ckey)
+							lout += "\tif ... == \"__skip_ptr__\" then return end\n"
+							lout += "\tlocal arg = {...}\n"
 							if inherits:
 								lout += "\tif type(arg[1]) == \"table\" and count(arg) == 1 then\n"
-								lout += "\t\tif \"\"..arg[1]:class() == \"%s\" then\n" % (c["inherits"][0]["class"])
+								lout += "\t\tif arg[1]:class() == %s then\n" % (c["inherits"][0]["class"])
 								lout += "\t\t\tself.__ptr = arg[1].__ptr\n"
 								lout += "\t\t\treturn\n"
 								lout += "\t\tend\n"
@@ -404,12 +496,13 @@ def createLUABindings(inputPath, prefix, mainInclude, libSmallName, libName, api
 							lout += "\t\t\tend\n"
 							lout += "\t\tend\n"
 							lout += "\tend\n"
-							lout += "\tif self.__ptr == nil and arg[1] ~= \"__skip_ptr__\" then\n"
+							lout += "\tif self.__ptr == nil then\n"
 							if ckey == "EventHandler":
 								lout += "\t\tself.__ptr = %s.%s(self)\n" % (libName, ckey)
 							else:
 								lout += "\t\tself.__ptr = %s.%s(unpack(arg))\n" % (libName, ckey)
-							lout += "\t\tPolycore.__ptr_lookup[self.__ptr] = self\n"
+							if ckey not in valueTypes:
+								lout += "\t\tPolycore.__ptr_lookup[self.__ptr] = self\n"
 							lout += "\tend\n"
 							lout += "end\n\n"
 						else:
@@ -431,13 +524,19 @@ def createLUABindings(inputPath, prefix, mainInclude, libSmallName, libName, api
 								else:
 									className = pm["rtnType"].replace("const", "").replace("&", "").replace("inline", "").replace("virtual", "").replace("static", "").replace("*","").replace(" ", "")
 									lout += "\tif retVal == nil then return nil end\n"
-									lout += "\tif Polycore.__ptr_lookup[retVal] ~= nil then\n"
-									lout += "\t\treturn Polycore.__ptr_lookup[retVal]\n"
-									lout += "\telse\n"
-									lout += "\t\tPolycore.__ptr_lookup[retVal] = %s(\"__skip_ptr__\")\n" % (className)
-									lout += "\t\tPolycore.__ptr_lookup[retVal].__ptr = retVal\n"
-									lout += "\t\treturn Polycore.__ptr_lookup[retVal]\n"
-									lout += "\tend\n"
+									if pm["rtnType"].find("*") == -1:
+										# a fresh copy every call, nothing to look up
+										lout += "\tlocal __c = %s(\"__skip_ptr__\")\n" % (className)
+										lout += "\trawset(__c, \"__ptr\", retVal)\n"
+										lout += "\treturn __c\n"
+									else:
+										lout += "\tlocal __c = Polycore.__ptr_lookup[retVal]\n"
+										lout += "\tif __c == nil then\n"
+										lout += "\t\t__c = %s(\"__skip_ptr__\")\n" % (className)
+										lout += "\t\t__c.__ptr = retVal\n"
+										lout += "\t\tPolycore.__ptr_lookup[retVal] = __c\n"
+										lout += "\tend\n"
+										lout += "\treturn __c\n"
 							lout += "end\n\n"
 
 					parsed_methods.append(pm["name"])
@@ -445,9 +544,12 @@ def createLUABindings(inputPath, prefix, mainInclude, libSmallName, libName, api
 				#cleanup
 				sout += "\t\t{\"delete_%s\", %s_delete_%s},\n" % (ckey, libName, ckey)
 				out += "static int %s_delete_%s(lua_State *L) {\n" % (libName, ckey)
-				out += "\tluaL_checktype(L, 1, LUA_TLIGHTUSERDATA);\n"
-				out += "\t%s *inst = (%s*)lua_topointer(L, 1);\n" % (ckey, ckey)
-				out += "\tdelete inst;\n"
+				out += "\t%s *inst = (%s*)polycodeLuaCheckPointer(L, 1);\n" % (ckey, ckey)
+				out += "\t// full userdata values are destroyed by the garbage collector\n"
+				out += "\tif(lua_islightuserdata(L, 1)) {\n"
+				out += "\t\tpolycodeLuaReleaseValues(L, (void*)inst);\n"
+				out += "\t\tdelete inst;\n"
+				out += "\t}\n"
 				out += "\treturn 0;\n"
 				out += "}\n\n"
 
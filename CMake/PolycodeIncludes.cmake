@@ -39,4 +39,5 @@ INCLUDE_DIRECTORIES(
     ${PNG_INCLUDE_DIR}
     ${OPENGLEXT_INCLUDE_DIR}
     ${LUA_INCLUDE_DIR}
+    ${ZLIB_INCLUDE_DIR}
 )
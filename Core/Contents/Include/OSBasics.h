@@ -44,17 +44,48 @@ class _PolyExport OSFileEntry {
 		static const int TYPE_FOLDER = 1;
 };
 
+/**
+* Read only view of a whole file's contents. The data either points straight into a memory mapping or into a buffer owned by the view. Create views with OSBasics::openView() and release them with OSBasics::closeView().
+*/
+class _PolyExport OSFileView {
+public:
+	OSFileView();
+	
+	/** Contents of the file. */
+	const char *data;
+	/** Size of the contents in bytes. */
+	size_t size;
+	
+	char *buffer;
+	char *mapping;
+	size_t mappingSize;
+	void *mappingHandle;
+};
+
 class _PolyExport OSFILE {
 public:
-	OSFILE(){}
+	OSFILE();
 	
 	void debugDump();
 	
 	int fileType;
 	FILE *file;	
 	PHYSFS_File *physFSFile;
+	OSFileView *view;
+	size_t viewOffset;
 	static const int TYPE_FILE = 0;
 	static const int TYPE_ARCHIVE_FILE = 1;	
+	static const int TYPE_VIEW_FILE = 2;
+	
+	/** Read-ahead or write-behind buffer, allocated on first use. */
+	char *buffer;
+	size_t bufferSize;
+	size_t bufferPosition;
+	size_t bufferLength;
+	int bufferMode;
+	static const int BUFFER_NONE = 0;
+	static const int BUFFER_READ = 1;
+	static const int BUFFER_WRITE = 2;
 };
 
 class _PolyExport OSBasics {
@@ -66,6 +97,64 @@ class _PolyExport OSBasics {
 		static size_t write( const void * ptr, size_t size, size_t count, OSFILE * stream );
 		static int seek(OSFILE * stream, long int offset, int origin );
 		static long tell(OSFILE * stream);
+		
+		/**
+		* Writes out any buffered data and drops any read-ahead data.
+		*/
+		static int flush(OSFILE * stream);
+		
+		/**
+		* Sets the size of the read-ahead/write-behind buffer of an open file. A size of 0 disables buffering and every call goes straight to stdio or PhysFS.
+		*/
+		static void setBufferSize(OSFILE * stream, size_t size);
+		
+		/**
+		* Sets the buffer size used by files opened after this call. Defaults to 16KB.
+		*/
+		static void setDefaultBufferSize(size_t size);
+		static size_t getDefaultBufferSize();
+		
+		/**
+		* Reads count words of wordSize bytes stored little endian, swapping them on big endian machines. Returns the number of words read.
+		*/
+		static size_t readLittleEndian(void * ptr, size_t wordSize, size_t count, OSFILE * stream);
+		
+		/**
+		* Writes count words of wordSize bytes little endian. Returns the number of words written.
+		*/
+		static size_t writeLittleEndian(const void * ptr, size_t wordSize, size_t count, OSFILE * stream);
+		
+		/**
+		* Reads an array of POD values or structs in one call. Structs are swapped field by field on big endian machines, so all their fields need to be wordSize bytes.
+		* @param values Array to read into.
+		* @param count Number of values to read.
+		* @param stream File to read from.
+		* @param wordSize Size of each field of T. Defaults to the size of T, for plain numbers.
+		* @return Number of whole values read.
+		*/
+		template <class T> static size_t readArray(T *values, size_t count, OSFILE * stream, size_t wordSize = sizeof(T)) {
+			size_t words = sizeof(T) / wordSize;
+			return readLittleEndian(values, wordSize, count * words, stream) / words;
+		}
+		
+		/**
+		* Writes an array of POD values or structs in one call. See readArray().
+		*/
+		template <class T> static size_t writeArray(const T *values, size_t count, OSFILE * stream, size_t wordSize = sizeof(T)) {
+			size_t words = sizeof(T) / wordSize;
+			return writeLittleEndian(values, wordSize, count * words, stream) / words;
+		}
+		
+		template <class T> static bool readValue(T *value, OSFILE * stream) {
+			return readArray(value, 1, stream) == 1;
+		}
+		
+		template <class T> static bool writeValue(const T &value, OSFILE * stream) {
+			return writeArray(&value, 1, stream) == 1;
+		}
+		
+		static bool isBigEndian();
+		static void swapEndian(void *data, size_t wordSize, size_t count);
 	
 		static std::vector<OSFileEntry> parsePhysFSFolder(const Polycode::String& pathString, bool showHidden);
 		static std::vector<OSFileEntry> parseFolder(const Polycode::String& pathString, bool showHidden);
@@ -73,6 +162,32 @@ class _PolyExport OSBasics {
 		static void createFolder(const Polycode::String& pathString);
 		static void removeItem(const Polycode::String& pathString);
 		
+		/**
+		* Returns the whole contents of a file. Files from indexed archives (see addMappedArchive()) are used in place if they are stored, and files on disk are memory mapped. Returns NULL if the file can't be read.
+		*/
+		static OSFileView *openView(const Polycode::String& filename);
+		static void closeView(OSFileView *view);
+		
+		/**
+		* Memory maps an archive written by polybuild so that open() and openView() can read its files through its index instead of going through PhysFS. The archive must also be on the PhysFS search path. A file is only read through the index when PhysFS resolves it to this archive, so the search order does not change. Returns false if the archive has no index.
+		*/
+		static bool addMappedArchive(const Polycode::String& archivePath);
+		
+		/**
+		* Maps a regular file read only. Returns NULL if the file is empty or can't be mapped.
+		*/
+		static char *mapFile(const Polycode::String& filename, size_t *size, void **handle);
+		static void unmapFile(char *data, size_t size, void *handle);
+		
 	private:
 	
+		static OSFileView *openArchiveView(const Polycode::String& filename);
+		
+		static size_t rawRead(void * ptr, size_t size, size_t count, OSFILE * stream);
+		static size_t rawWrite(const void * ptr, size_t size, size_t count, OSFILE * stream);
+		static int rawSeek(OSFILE * stream, long int offset, int origin);
+		static long rawTell(OSFILE * stream);
+		
+		static size_t defaultBufferSize;
+	
 };
@@ -0,0 +1,121 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+ 
+
+#pragma once
+#include "PolyGlobals.h"
+#include "PolyString.h"
+#include "PolyVector3.h"
+#include "PolyQuaternion.h"
+#include <vector>
+
+namespace Polycode {
+
+	/**
+	* Local transform of one bone. A pose buffer is a vector of these with one entry per bone, in the same order as Skeleton::getBone().
+	*/
+	class _PolyExport BonePose {
+		public:
+			BonePose();
+			BonePose(const Vector3 &position, const Quaternion &rotation, const Vector3 &scale = Vector3(1,1,1));
+			
+			Vector3 position;
+			Quaternion rotation;
+			/** Clips don't animate scale, it is kept from the pose the clip is sampled into. */
+			Vector3 scale;
+	};
+	
+	/**
+	* Baked keyframes of one bone, sampled at the clip's sample rate. Rotations are stored as four 16 bit fixed point components and positions as three 16 bit steps between the track's minimum and maximum position.
+	*/
+	class _PolyExport AnimationClipTrack {
+		public:
+			AnimationClipTrack();
+			
+			unsigned int boneIndex;
+			Vector3 positionMin;
+			Vector3 positionStep;
+			std::vector<unsigned short> positions;
+			std::vector<short> rotations;
+	};
+
+	/**
+	* A skeletal animation baked into uniformly sampled, quantized keyframes. Sampling a clip is a direct index into the keyframe arrays followed by a lerp of the positions and an nlerp of the rotations, so it doesn't need curves or tweens. Clips write into pose buffers, which lets several clips be blended together before the pose is applied to a skeleton.
+	*/
+	class _PolyExport AnimationClip {
+		public:
+			/**
+			* Creates an empty clip.
+			* @param name Name of the clip.
+			* @param duration Length of the clip in seconds.
+			* @param sampleRate Keyframes per second.
+			*/
+			AnimationClip(const String& name, Number duration, Number sampleRate = DEFAULT_SAMPLE_RATE);
+			virtual ~AnimationClip();
+			
+			/**
+			* Adds the keyframes of one bone. Both arrays must have getNumSamples() entries, evenly spaced from the start to the end of the clip.
+			* @param boneIndex Index of the bone in the skeleton.
+			* @param positions Bone position at every keyframe.
+			* @param rotations Bone rotation at every keyframe.
+			*/
+			void addTrack(unsigned int boneIndex, const std::vector<Vector3> &positions, const std::vector<Quaternion> &rotations);
+			
+			/**
+			* Writes the clip's pose at the given time into a pose buffer. Bones the clip has no track for are left untouched.
+			* @param time Time in seconds.
+			* @param loop If true, the time wraps around at the end of the clip, otherwise it is clamped.
+			* @param pose Pose buffer to write to.
+			*/
+			void samplePose(Number time, bool loop, std::vector<BonePose> &pose) const;
+			
+			/**
+			* Blends the clip's pose at the given time into a pose buffer. Positions are interpolated linearly and rotations with a normalized lerp, by the given weight (0 leaves the pose as is, 1 is the same as samplePose()).
+			*/
+			void blendPose(Number time, bool loop, Number weight, std::vector<BonePose> &pose) const;
+			
+			/**
+			* Returns the position and rotation of one track at the given time.
+			*/
+			void sampleTrack(unsigned int trackIndex, Number time, bool loop, BonePose *bonePose) const;
+			
+			const String& getName() const;
+			Number getDuration() const;
+			Number getSampleRate() const;
+			unsigned int getNumSamples() const;
+			unsigned int getNumTracks() const;
+			const AnimationClipTrack& getTrack(unsigned int index) const;
+			
+			static const int DEFAULT_SAMPLE_RATE = 30;
+			
+		protected:
+		
+			void getSamplePosition(Number time, bool loop, unsigned int *index, Number *fraction) const;
+			void sampleTrackAt(const AnimationClipTrack &track, unsigned int index, Number fraction, BonePose *bonePose) const;
+		
+			String name;
+			Number duration;
+			Number sampleRate;
+			unsigned int numSamples;
+			std::vector<AnimationClipTrack> tracks;
+	};
+}
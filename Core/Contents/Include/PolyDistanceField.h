@@ -0,0 +1,58 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+ 
+
+#pragma once
+#include "PolyGlobals.h"
+
+namespace Polycode {
+
+	/**
+	* Generates signed distance fields from coverage bitmaps. A distance field stores, for every pixel, the distance to the nearest edge of the shape instead of its coverage, so a shader can reconstruct a sharp edge at any scale or rotation from a small texture. Generation runs entirely on the CPU and doesn't need a renderer.
+	*/
+	class _PolyExport DistanceField {
+		public:
+		
+			/**
+			* Returns the size of a distance field generated from a source of the given size.
+			* @param sourceSize Width or height of the source bitmap in pixels.
+			* @param spread Distance in output pixels encoded on each side of the edge. The output is padded by this many pixels on each side.
+			* @param downsample Factor by which the source is larger than the output.
+			*/
+			static unsigned int getOutputSize(unsigned int sourceSize, unsigned int spread, unsigned int downsample);
+		
+			/**
+			* Generates a distance field from a coverage bitmap.
+			* @param coverage Source bitmap with one byte per pixel, rows top down. Pixels of 128 and above are inside the shape.
+			* @param width Width of the source bitmap in pixels.
+			* @param height Height of the source bitmap in pixels.
+			* @param spread Distance in output pixels encoded on each side of the edge.
+			* @param downsample Factor by which the source is larger than the output. Rendering the source at a higher resolution and downsampling gives more accurate distances.
+			* @param output Buffer of getOutputSize(width) * getOutputSize(height) bytes that receives the distance field, rows top down. 128 is on the edge, higher values are inside the shape and 0 and 255 are spread pixels or more away from it.
+			*/
+			static void generate(const unsigned char *coverage, unsigned int width, unsigned int height, unsigned int spread, unsigned int downsample, unsigned char *output);
+			
+		protected:
+		
+			static void computeDistances(const unsigned char *seeds, int width, int height, Number *distances);
+	};
+}
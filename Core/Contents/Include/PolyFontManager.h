@@ -29,6 +29,8 @@ THE SOFTWARE.
 namespace Polycode {
 
 	class Font;
+	class GlyphCache;
+	class TextureAtlas;
 
 	class FontEntry {
 	public:
@@ -58,9 +60,30 @@ namespace Polycode {
 		*/		
 		Font *getFontByName(const String& fontName);
 		
+		/**
+		* Returns the glyph cache for a font at a pixel size and anti-aliasing mode, creating it on first use. All glyph caches share one texture atlas.
+		* @param font Font to return the cache for.
+		* @param size Size in pixels.
+		* @param antiAliasMode Anti-aliasing mode. See Label for possible values.
+		*/
+		GlyphCache *getGlyphCache(Font *font, int size, int antiAliasMode);
+		
+		/**
+		* Returns the signed distance field glyph cache for a font, creating it on first use. There is one distance field cache per font, which labels of every size share.
+		* @param font Font to return the cache for.
+		*/
+		GlyphCache *getDistanceFieldCache(Font *font);
+		
+		/**
+		* Returns the texture atlas glyphs are rasterized into.
+		*/
+		TextureAtlas *getGlyphAtlas();
+		
 	private:
 		
 		std::vector <FontEntry> fonts;
+		std::vector <GlyphCache*> glyphCaches;
+		TextureAtlas *glyphAtlas;
 		
 	};
 	
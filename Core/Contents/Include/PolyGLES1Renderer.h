@@ -50,6 +50,8 @@ namespace Polycode {
 		
 		Cubemap *createCubemap(Texture *t0, Texture *t1, Texture *t2, Texture *t3, Texture *t4, Texture *t5);
 		Texture *createTexture(unsigned int width, unsigned int height, char *textureData, bool clamp, int type=Image::IMAGE_RGBA);
+		Texture *createTextureFromContainer(TextureContainer *container, bool clamp);
+		void updateTextureRegion(Texture *texture, unsigned int x, unsigned int y, unsigned int width, unsigned int height);
 		Texture *createFramebufferTexture(unsigned int width, unsigned int height);
 		void createRenderTextures(Texture **colorBuffer, Texture **depthBuffer, int width, int height);
 		
@@ -59,6 +61,8 @@ namespace Polycode {
 		void drawVertexBuffer(VertexBuffer *buffer);		
 		
 		void bindFrameBufferTexture(Texture *texture);
+		void bindFrameBufferTextureRegion(Texture *texture, int x, int y, int width, int height, int border = 0);
+		void bindFrameBufferTextureClipped(Texture *texture, int x, int y, int width, int height);
 		void unbindFramebuffers();
 		
 		void setOrthoMode();
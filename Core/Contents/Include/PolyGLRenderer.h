@@ -106,7 +106,9 @@ namespace Polycode {
 		
 		Cubemap *createCubemap(Texture *t0, Texture *t1, Texture *t2, Texture *t3, Texture *t4, Texture *t5);
 		Texture *createTexture(unsigned int width, unsigned int height, char *textureData, bool clamp, bool createMipmaps, int type = Image::IMAGE_RGBA);
+		Texture *createTextureFromContainer(TextureContainer *container, bool clamp);
 		void destroyTexture(Texture *texture);		
+		void updateTextureRegion(Texture *texture, unsigned int x, unsigned int y, unsigned int width, unsigned int height);
 		Texture *createFramebufferTexture(unsigned int width, unsigned int height);
 		void createRenderTextures(Texture **colorBuffer, Texture **depthBuffer, int width, int height, bool floatingPointBuffer);
 		
@@ -115,6 +117,8 @@ namespace Polycode {
 		void createVertexBufferForMesh(Mesh *mesh);
 		void drawVertexBuffer(VertexBuffer *buffer, bool enableColorBuffer);						
 		void bindFrameBufferTexture(Texture *texture);
+		void bindFrameBufferTextureRegion(Texture *texture, int x, int y, int width, int height, int border = 0);
+		void bindFrameBufferTextureClipped(Texture *texture, int x, int y, int width, int height);
 		void unbindFramebuffers();
 		
 		void cullFrontFaces(bool val);
@@ -124,6 +128,7 @@ namespace Polycode {
 		RenderDataArray *createRenderDataArray(int arrayType);
 		void setRenderArrayData(RenderDataArray *array, Number *arrayData);
 		void drawArrays(int drawType);		
+		void drawIndexedArrays(int drawType, const unsigned int *indices, unsigned int indexCount);
 				
 		void setOrthoMode(Number xSize=0.0f, Number ySize=0.0f);
 		void _setOrthoMode();
@@ -195,6 +200,7 @@ namespace Polycode {
 		
 	protected:
 
+		GLenum getDrawMode(int drawType);
 		
 		Number nearPlane;
 		Number farPlane;
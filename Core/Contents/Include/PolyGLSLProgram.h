@@ -25,6 +25,7 @@ THE SOFTWARE.
 #include "PolyGlobals.h"
 #include "PolyString.h"
 #include "PolyResource.h"
+#include <map>
 
 namespace Polycode {
 
@@ -95,8 +96,24 @@ class _PolyExport GLSLProgramParam {
 			virtual ~GLSLProgram();
 			
 			void addParam(const String& name, bool isAuto, int autoID, int paramType, void *defaultData);
-		
-			unsigned int program;
+			
+			/**
+			* Sets the program source. Permutations compiled from the previous source are deleted.
+			*/
+			void setSource(const String& source);
+			const String& getSource() const;
+			
+			/**
+			* Returns the shader object for a permutation of the program, compiling it the first time it is requested. The defines are inserted after the #version line, if there is one, so the same source can be compiled for different light counts and features.
+			* @param defines Preprocessor lines to prepend to the source.
+			*/
+			unsigned int getShaderObject(const String& defines);
+			
+			/**
+			* Deletes all compiled permutations.
+			*/
+			void clearShaderObjects();
+			
 //			GLSLparameter modelViewProjection;
 	
 			static const int TYPE_VERT = 0;
@@ -105,5 +122,9 @@ class _PolyExport GLSLProgramParam {
 			int type;
 			
 			std::vector<GLSLProgramParam> params;
+			
+		protected:
+			String source;
+			std::map<std::string, unsigned int> shaderObjects;
 	};
 }
@@ -0,0 +1,82 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+ 
+
+#pragma once
+
+#include "PolyGlobals.h"
+#include "PolyString.h"
+
+namespace Polycode {
+
+	/**
+	* Caches linked GLSL programs on disk using GL_ARB_get_program_binary. Programs are keyed by a hash of their vertex and fragment sources, their permutation defines and the GL vendor, renderer and version strings, so a driver update or a source change simply misses the cache. Cached binaries are validated when loaded and a program that fails to load is compiled from source as usual.
+	*/
+	class _PolyExport GLSLProgramCache {
+		public:
+			GLSLProgramCache();
+			virtual ~GLSLProgramCache();
+			
+			/**
+			* Returns the shared program cache.
+			*/
+			static GLSLProgramCache *getInstance();
+			
+			/**
+			* Sets the folder cached programs are stored in. Defaults to .polycode/shadercache in the user's home directory. Set to an empty string to disable the cache.
+			*/
+			void setCacheDirectory(const String& path);
+			const String& getCacheDirectory() const;
+			
+			/**
+			* Returns true if the cache is enabled and the driver supports program binaries. Requires a current GL context.
+			*/
+			bool isAvailable();
+			
+			/**
+			* Must be called before linking a program that will be saved to the cache.
+			*/
+			void prepareProgram(unsigned int program);
+			
+			/**
+			* Loads a cached binary into a program.
+			* @return True if the program was loaded and linked successfully.
+			*/
+			bool loadProgram(unsigned int program, const String& vertexSource, const String& fragmentSource, const String& defines);
+			
+			/**
+			* Saves a linked program to the cache.
+			*/
+			void saveProgram(unsigned int program, const String& vertexSource, const String& fragmentSource, const String& defines);
+			
+		protected:
+		
+			String getCacheFileName(const String& vertexSource, const String& fragmentSource, const String& defines, unsigned int *hash);
+		
+			String cacheDirectory;
+			String driverString;
+			bool checkedSupport;
+			bool supported;
+			
+			static GLSLProgramCache *instance;
+	};
+}
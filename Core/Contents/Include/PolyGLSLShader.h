@@ -34,28 +34,96 @@ namespace Polycode {
 	typedef struct {
 		Texture *texture;
 		String name;
+		int slot;
 	} GLSLTextureBinding;
 
 	typedef struct {
 		Cubemap *cubemap;
 		String name;
+		int slot;
 	} GLSLCubemapBinding;
 	
+	/**
+	* A uniform of a linked GLSL shader. Keeps the uniform location and the last value uploaded to it.
+	*/
+	class _PolyExport GLSLUniform {
+		public:
+			String name;
+			int location;
+			bool hasValue;
+			int intValue;
+			int floatCount;
+			float floatValues[16];
+	};
 	
 	class _PolyExport GLSLShader : public Shader {
 		public:
-			GLSLShader(GLSLProgram *vp, GLSLProgram *fp);
+			/**
+			* Constructor. The shader is linked the first time it is used, so only permutations that are actually rendered with get compiled.
+			* @param vp Vertex program.
+			* @param fp Fragment program.
+			* @param defines Preprocessor lines inserted into both programs' sources to select a permutation.
+			*/
+			GLSLShader(GLSLProgram *vp, GLSLProgram *fp, const String& defines = "");
 			virtual ~GLSLShader();
 
 			ShaderBinding *createBinding();
 			virtual void reload();
+			
+			/**
+			* Links the shader if it has not been linked yet, loading it from the program cache if possible.
+			*/
+			void ensureLinked();
+		
+			/**
+			* Returns the uniform slot for a uniform name, looking up its location the first time the name is requested. Slots stay valid until the shader is relinked.
+			*/
+			int getUniformSlot(const String& name);
+			
+			/**
+			* Uploads an integer uniform if it differs from the last value uploaded to the slot. The shader must be bound.
+			*/
+			void setUniformInt(int slot, int value);
+			
+			/**
+			* Uploads a 1 to 4 component float uniform if it differs from the last value uploaded to the slot. The shader must be bound.
+			*/
+			void setUniformFloats(int slot, const float *values, int count);
+			
+			/**
+			* Uploads a 4x4 matrix uniform if it differs from the last value uploaded to the slot. The shader must be bound.
+			*/
+			void setUniformMatrix(int slot, const float *values);
+			
+			/**
+			* Resolves slots for program parameters added since the last call.
+			*/
+			void updateProgramParamSlots();
 		
 			unsigned int shader_id;		
 			GLSLProgram *vp;
 			GLSLProgram *fp;			
+			String defines;
+			
+			/**
+			* Changes every time the shader is linked. Bindings use it to tell when their slots are stale.
+			*/
+			unsigned int linkID;
+			
+			std::vector<int> vpParamSlots;
+			std::vector<int> fpParamSlots;
+			int shadowMapSlots[4];
+			int shadowMatrixSlots[4];
+			int shadowRectSlots[4];
+			int modelMatrixSlot;
 			
 		protected:
 			void linkProgram();
+			bool setUniformValue(int slot, const float *values, int count);
+			
+			std::vector<GLSLUniform> uniforms;
+			
+			static unsigned int nextLinkID;
 	};
 	
 	class _PolyExport GLSLShaderBinding : public ShaderBinding {
@@ -68,9 +136,21 @@ namespace Polycode {
 			void clearTexture(const String& name);
 			void addParam(const String& type, const String& name, const String& value);
 			
+			/**
+			* Resolves texture slots and program parameter overrides against a shader. Does nothing if they are already resolved for the shader's current link.
+			*/
+			void resolveSlots(GLSLShader *shader);
+			
 			std::vector<GLSLTextureBinding> textures;
 			std::vector<GLSLCubemapBinding> cubemaps;
 		
+			std::vector<LocalShaderParam*> vpParamOverrides;
+			std::vector<LocalShaderParam*> fpParamOverrides;
+		
 			GLSLShader *glslShader;
+			
+		protected:
+			unsigned int resolvedLinkID;
+			unsigned int resolvedLocalParamCount;
 	};
 }
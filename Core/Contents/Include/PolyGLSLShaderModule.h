@@ -29,6 +29,7 @@ namespace Polycode {
 	class GLSLProgram;
 	class GLSLProgramParam;
 	class GLSLShader;
+	class LocalShaderParam;
 
 	class _PolyExport GLSLShaderModule : public PolycodeShaderModule {
 		public:
@@ -46,9 +47,10 @@ namespace Polycode {
 	protected:
 
 		void addParamToProgram(GLSLProgram *program,TiXmlNode *node);		
+		String createShaderDefines(TiXmlNode *node);
 		void recreateGLSLProgram(GLSLProgram *prog, const String& fileName, int type);
 		GLSLProgram *createGLSLProgram(const String& fileName, int type);
-		void updateGLSLParam(Renderer *renderer, GLSLShader *glslShader, GLSLProgramParam &param, ShaderBinding *materialOptions, ShaderBinding *localOptions);		
+		void updateGLSLParam(Renderer *renderer, GLSLShader *glslShader, GLSLProgramParam &param, int slot, LocalShaderParam *materialParam, LocalShaderParam *localParam);		
 			
 		void setGLSLAreaLightPositionParameter(Renderer *renderer, GLSLProgramParam &param, int lightIndex);
 		void setGLSLAreaLightColorParameter(Renderer *renderer, GLSLProgramParam &param, int lightIndex);	
@@ -42,13 +42,25 @@ THE SOFTWARE.
 
 namespace Polycode {
 
+	class TextureContainer;
+
 	class _PolyExport OpenGLTexture : public Texture {
 		public:
 			OpenGLTexture(unsigned int width, unsigned int height);
 			OpenGLTexture(unsigned int width, unsigned int height, char *textureData, bool clamp, bool createMipmaps, int filteringMode, int type);
+			
+			/**
+			* Creates a texture from baked mip levels. Compressed levels are uploaded as is if the driver supports S3TC and are decoded on the CPU otherwise. The texture takes ownership of the container. If the container was loaded from a file, its level data is freed after upload and read back from the file when the texture is recreated.
+			*/
+			OpenGLTexture(TextureContainer *container, bool clamp, int filteringMode);
 			virtual ~OpenGLTexture();
 			
 			void recreateFromImageData();
+			
+			/**
+			* Uploads a rectangle of the texture data to the GPU.
+			*/
+			void updateRegion(unsigned int x, unsigned int y, unsigned int width, unsigned int height);
 
 			GLuint getTextureID();
 			GLuint getFrameBufferID();
@@ -59,6 +71,9 @@ namespace Polycode {
 			
 		private:
 			
+			void uploadContainerLevels();
+			
+			TextureContainer *container;
 			bool glTextureLoaded;
 			GLenum glTextureType;
 			GLuint glTextureFormat;
@@ -0,0 +1,160 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+ 
+
+#pragma once
+#include "PolyGlobals.h"
+#include "PolyString.h"
+#include <map>
+#include <vector>
+
+namespace Polycode {
+
+	class Font;
+	class Image;
+	class TextureAtlas;
+	class TextureAtlasRegion;
+
+	/**
+	* Metrics and atlas location of a cached glyph.
+	*/
+	class _PolyExport GlyphInfo {
+		public:
+			GlyphInfo();
+			
+			unsigned int glyphIndex;
+			int advance;
+			int bitmapLeft;
+			int bitmapTop;
+			unsigned int width;
+			unsigned int height;
+			
+			/**
+			* Region of the glyph bitmap in the atlas. NULL until the glyph is rasterized or if the glyph has no pixels.
+			*/
+			TextureAtlasRegion *region;
+			bool rasterized;
+	};
+
+	/**
+	* A positioned glyph produced by GlyphCache::layoutText. Positions are in pixels from the top left of the text, texture coordinates are those of the top left (u1, v1) and bottom right (u2, v2) corners.
+	*/
+	class _PolyExport GlyphQuad {
+		public:
+			Number x;
+			Number y;
+			Number width;
+			Number height;
+			Number u1;
+			Number v1;
+			Number u2;
+			Number v2;
+			unsigned int page;
+			
+			/**
+			* Index of the character in the laid out text the quad was created for.
+			*/
+			int character;
+	};
+
+	/**
+	* Caches the glyphs of a font at one pixel size and anti-aliasing mode. Glyph metrics and kerning are looked up from FreeType once, and glyph bitmaps are rasterized once into a texture atlas shared by all glyph caches, so measuring and laying out text afterwards doesn't touch FreeType at all. Get glyph caches from FontManager::getGlyphCache().
+	*
+	* In Label::ANTIALIAS_DISTANCE_FIELD mode glyphs are stored as signed distance fields instead of coverage, padded by DISTANCE_FIELD_SPREAD pixels on each side. One such cache per font at DISTANCE_FIELD_SIZE (see FontManager::getDistanceFieldCache()) can draw text at any size by scaling its quads.
+	*/
+	class _PolyExport GlyphCache {
+		public:
+			GlyphCache(Font *font, int size, int antiAliasMode, TextureAtlas *atlas);
+			virtual ~GlyphCache();
+			
+			/**
+			* Returns the cached glyph for a character, loading its metrics on first use.
+			* @param character Character to look up.
+			* @param rasterize If true, the glyph bitmap is also rasterized into the atlas if it isn't already.
+			*/
+			GlyphInfo *getGlyph(wchar_t character, bool rasterize);
+			
+			/**
+			* Returns the horizontal kerning between two glyphs, in pixels.
+			*/
+			int getKerning(unsigned int previousGlyph, unsigned int glyph);
+			
+			/**
+			* Returns the width of a line of text in pixels. Tabs are four spaces wide.
+			*/
+			int getTextWidth(const String& text);
+			
+			/**
+			* Returns the horizontal position of every character boundary in a line of text, as used to place a caret or find the character under the mouse. The result has one more entry than the text has characters, the last one being the width of the text.
+			* @param text Text to measure.
+			* @param offsets Vector to fill with the offsets, in pixels.
+			*/
+			void getCharacterOffsets(const String& text, std::vector<int> *offsets);
+			
+			/**
+			* Returns the highest glyph top above the baseline in a line of text, in pixels.
+			*/
+			int getTextHeight(const String& text);
+			
+			/**
+			* Lays out a line of text as glyph quads referencing the atlas, rasterizing any glyphs that are not cached yet. The baseline is placed at the font size from the top.
+			* @param text Text to lay out.
+			* @param quads Vector to fill with one quad per visible glyph.
+			* @return Width of the text in pixels.
+			*/
+			int layoutText(const String& text, std::vector<GlyphQuad> *quads);
+			
+			Font *getFont() const;
+			int getSize() const;
+			int getAntiAliasMode() const;
+			TextureAtlas *getAtlas() const;
+			
+			/**
+			* Pixel size distance field glyphs are generated at.
+			*/
+			static const int DISTANCE_FIELD_SIZE = 32;
+			
+			/**
+			* Distance in pixels encoded on each side of a distance field glyph's edge.
+			*/
+			static const int DISTANCE_FIELD_SPREAD = 4;
+			
+			/**
+			* Factor by which glyph outlines are rendered larger than DISTANCE_FIELD_SIZE before being downsampled into a distance field.
+			*/
+			static const int DISTANCE_FIELD_DOWNSAMPLE = 4;
+			
+		protected:
+		
+			void rasterizeGlyph(wchar_t character, GlyphInfo *glyph);
+			void rasterizeDistanceField(wchar_t character, GlyphInfo *glyph);
+			void addGlyphImage(wchar_t character, GlyphInfo *glyph, Image *glyphImage);
+			
+			Font *font;
+			int size;
+			int antiAliasMode;
+			TextureAtlas *atlas;
+			
+			std::map<wchar_t, GlyphInfo> glyphs;
+			std::map<unsigned int, std::map<unsigned int, int> > kernings;
+	};
+}
@@ -0,0 +1,133 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+ 
+
+#pragma once
+#include "PolyGlobals.h"
+#include "PolyCore.h"
+#include <vector>
+
+#ifdef _WINDOWS
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+namespace Polycode {
+
+	class NullRenderer;
+
+	class _PolyExport HeadlessCoreMutex : public CoreMutex {
+	public:
+#ifdef _WINDOWS
+		HANDLE winMutex;
+#else
+		pthread_mutex_t pMutex;
+#endif
+	};
+
+	/**
+	* A core that runs frames without opening a window. It renders with a NullRenderer, so scenes, screens and UI can be updated and drawn on machines without a display or a GPU, which is what automated tests and benchmarks need. By default each call to Update() runs one frame as fast as possible using real time. Call setFixedTimestep() to make every frame advance the clock by the same amount, which makes runs reproducible. Input can be simulated through the CoreInput returned by getInput().
+	*/
+	class _PolyExport HeadlessCore : public Core {
+		
+	public:
+		
+		/**
+		* Constructor.
+		* @param xRes Horizontal resolution of the virtual screen.
+		* @param yRes Vertical resolution of the virtual screen.
+		* @param frameRate Frame rate used when throttling is on.
+		* @param rasterize If true, the renderer draws into a framebuffer that can be read back with Renderer::renderScreenToImage().
+		*/
+		HeadlessCore(int xRes, int yRes, int frameRate=60, bool rasterize=false);
+		~HeadlessCore();
+		
+		bool Update();
+		unsigned int getTicks();
+		
+		void setVideoMode(int xRes, int yRes, bool fullScreen, bool vSync, int aaLevel, int anisotropyLevel);
+		void resizeTo(int xRes, int yRes);
+		std::vector<Rectangle> getVideoModes();
+		
+		void createThread(Threaded *target);
+		void lockMutex(CoreMutex *mutex);
+		void unlockMutex(CoreMutex *mutex);
+		CoreMutex *createMutex();
+		
+		void setCursor(int cursorType);
+		void copyStringToClipboard(const String& str);
+		String getClipboardString();
+		void createFolder(const String& folderPath);
+		void copyDiskItem(const String& itemPath, const String& destItemPath);
+		void moveDiskItem(const String& itemPath, const String& destItemPath);
+		void removeDiskItem(const String& itemPath);
+		String openFolderPicker();
+		std::vector<String> openFilePicker(std::vector<CoreFileExtension> extensions, bool allowMultiple);
+		void openURL(String url);
+		
+		/**
+		* If set to a non-zero value, every frame advances getTicks() by exactly this many milliseconds instead of using the real time. Defaults to 0.
+		*/
+		void setFixedTimestep(unsigned int milliseconds);
+		unsigned int getFixedTimestep() const;
+		
+		/**
+		* If true, Update() sleeps to keep to the frame rate passed to the constructor. Off by default so frames run back to back.
+		*/
+		void setThrottled(bool val);
+		
+		/**
+		* If set to a non-zero value, Update() returns false once this many frames have run. Defaults to 0 (no limit).
+		*/
+		void setFrameLimit(unsigned int frames);
+		
+		/**
+		* Returns the number of frames run so far.
+		*/
+		unsigned int getFrameCount() const;
+		
+		/**
+		* Returns the renderer created by the core.
+		*/
+		NullRenderer *getNullRenderer();
+		
+	protected:
+	
+		unsigned int getRealTicks() const;
+	
+		NullRenderer *nullRenderer;
+		
+		unsigned int fixedTimestep;
+		unsigned int simulatedTicks;
+		bool throttled;
+		unsigned int frameLimit;
+		unsigned int frameCount;
+		String clipboard;
+		
+#ifdef _WINDOWS
+		DWORD startTicks;
+#else
+		double startTime;
+#endif
+	};
+}
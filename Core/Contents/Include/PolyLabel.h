@@ -37,6 +37,12 @@ namespace Polycode {
 			Label(Font *font, const String& text, int size, int antiAliasMode);
 			virtual ~Label();
 			void setText(const String& text);
+			
+			/**
+			* Changes the text and measures it with the font's glyph cache, without rasterizing it into the label image. Used by labels that draw cached glyphs directly. The image keeps its previous contents until setText() is called.
+			*/
+			void setTextWithoutRendering(const String& text);
+			
 			const String& getText() const;
 			
 			static int getTextWidth(Font *font, const String& text, int size);
@@ -46,10 +52,17 @@ namespace Polycode {
 			Number getTextHeight() const;
 		
 			Font *getFont() const;
+			int getSize() const;
+			int getAntiAliasMode() const;
 					
 			static const int ANTIALIAS_FULL = 0;
 			static const int ANTIALIAS_NONE = 1;
 			
+			/**
+			* Text is drawn from a signed distance field atlas generated once per font, which stays sharp at any size, scale or rotation. Only ScreenLabel and SceneLabel draw distance field text; a Label image rasterized in this mode is fully anti-aliased.
+			*/
+			static const int ANTIALIAS_DISTANCE_FIELD = 2;
+			
 		protected:
 
 			Number currentTextWidth;
@@ -0,0 +1,119 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+ 
+
+#pragma once
+#include "PolyGlobals.h"
+#include "PolyString.h"
+
+namespace Polycode {
+
+	/**
+	* Location of a file inside a MappedArchive. The fields mirror one record of the archive index.
+	*/
+	class _PolyExport MappedArchiveEntry {
+		public:
+			MappedArchiveEntry();
+			
+			unsigned int hash;
+			unsigned int nameOffset;
+			unsigned int nameLength;
+			/** Offset of the file data from the start of the archive. */
+			unsigned int dataOffset;
+			/** Size of the file once decompressed. */
+			unsigned int size;
+			/** Size of the data stored in the archive. Same as size for stored files. */
+			unsigned int compressedSize;
+			/** MappedArchive::METHOD_STORED or MappedArchive::METHOD_DEFLATED. */
+			unsigned int method;
+			unsigned int crc;
+	};
+
+	/**
+	* A read only, memory mapped .polyapp archive with a prebuilt hashed directory. The archive is a regular zip file whose first entry is an index written by polybuild, so files are found with one hash lookup and stored (uncompressed) files can be used straight from the mapping without copying. Archives without an index are left to PhysFS.
+	*/
+	class _PolyExport MappedArchive {
+		public:
+			~MappedArchive();
+			
+			/**
+			* Maps an archive. Returns NULL if the file can't be mapped or doesn't start with an index.
+			*/
+			static MappedArchive *open(const String& fileName);
+			
+			/**
+			* Looks up a file by its path in the archive.
+			* @param path Path of the file inside the archive.
+			* @param entry Filled in if the file is found.
+			* @return True if the file is in the archive.
+			*/
+			bool findEntry(const String& path, MappedArchiveEntry *entry) const;
+			
+			/**
+			* Returns the stored data of an entry. For deflated entries this is the compressed data.
+			*/
+			const char *getEntryData(const MappedArchiveEntry& entry) const;
+			
+			unsigned int getNumEntries() const;
+			const String& getFileName() const;
+			
+			/**
+			* FNV-1a hash of a path, used to place entries in the index.
+			*/
+			static unsigned int hashPath(const char *path);
+			
+			static unsigned int readUInt(const char *data);
+			static void writeUInt(unsigned int value, char *data);
+			
+			/** Name of the index entry, always the first file in the archive. */
+			static const char *INDEX_NAME;
+			
+			static const unsigned int INDEX_MAGIC = 0x58444950;
+			static const unsigned int INDEX_VERSION = 1;
+			static const unsigned int INDEX_HEADER_SIZE = 16;
+			static const unsigned int INDEX_RECORD_SIZE = 32;
+			static const unsigned int EMPTY_BUCKET = 0xFFFFFFFF;
+			
+			static const unsigned int METHOD_STORED = 0;
+			static const unsigned int METHOD_DEFLATED = 8;
+			
+		protected:
+		
+			MappedArchive();
+			
+			bool readIndex();
+			void readEntry(unsigned int index, MappedArchiveEntry *entry) const;
+			
+			String fileName;
+			
+			char *data;
+			size_t size;
+			void *mappingHandle;
+			
+			const char *buckets;
+			unsigned int bucketCount;
+			const char *records;
+			unsigned int entryCount;
+			const char *names;
+			unsigned int namesSize;
+	};
+}
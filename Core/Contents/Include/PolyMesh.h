@@ -110,6 +110,19 @@ namespace Polycode {
 		float y;
 	} Vector2_struct;
 	
+	/** One vertex as stored in a .mesh file, read and written in one call. */
+	typedef struct {
+		Vector3_struct pos;
+		Vector3_struct nor;
+		Vector4_struct col;
+		Vector2_struct tex;
+	} MeshFileVertex_struct;
+	
+	typedef struct {
+		unsigned int boneID;
+		float weight;
+	} MeshFileBoneWeight_struct;
+	
 	/**
 	* A polygonal mesh. The mesh is assembled from Polygon instances, which in turn contain Vertex instances. This structure is provided for convenience and when the mesh is rendered, it is cached into vertex arrays with no notions of separate polygons. When data in the mesh changes, arrayDirtyMap must be set to true for the appropriate array types (color, position, normal, etc). Available types are defined in RenderDataArray.
 	*/
@@ -0,0 +1,338 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+ 
+
+#pragma once
+#include "PolyGlobals.h"
+#include "PolyRenderer.h"
+#include "PolyTexture.h"
+#include "PolyCubemap.h"
+#include "PolyMesh.h"
+#include <vector>
+
+namespace Polycode {
+
+	/**
+	* Texture used by the null renderer. Keeps its pixels in system memory so the software rasterizer can sample from and render into it.
+	*/
+	class _PolyExport NullTexture : public Texture {
+		public:
+			NullTexture(unsigned int width, unsigned int height, char *textureData, bool clamp, bool createMipmaps, int type=Image::IMAGE_RGBA);
+			virtual ~NullTexture();
+			
+			void setTextureData(char *data);
+			void recreateFromImageData();
+			
+			int getPixelSize() const { return pixelSize; }
+			
+			/**
+			* Returns the depth buffer used when this texture is a render target, creating it on first use.
+			*/
+			Number *getDepthBuffer();
+			
+		protected:
+			Number *depthBuffer;
+	};
+	
+	/**
+	* Cubemap used by the null renderer.
+	*/
+	class _PolyExport NullCubemap : public Cubemap {
+		public:
+			NullCubemap(Texture *t0, Texture *t1, Texture *t2, Texture *t3, Texture *t4, Texture *t5);
+			virtual ~NullCubemap();
+	};
+	
+	/**
+	* Vertex buffer used by the null renderer. Keeps a copy of the mesh positions, texture coordinates and colors in system memory.
+	*/
+	class _PolyExport NullVertexBuffer : public VertexBuffer {
+		public:
+			NullVertexBuffer(Mesh *mesh);
+			virtual ~NullVertexBuffer();
+			
+			std::vector<float> positions;
+			std::vector<float> texCoords;
+			std::vector<float> colors;
+	};
+	
+	/**
+	* Counters collected by the null renderer over one frame.
+	*/
+	class _PolyExport RendererStats {
+		public:
+			RendererStats();
+			
+			void reset();
+			
+			/** Number of drawArrays() and drawVertexBuffer() calls. */
+			unsigned int drawCalls;
+			/** Number of vertices submitted by draw calls. */
+			unsigned int verticesDrawn;
+			/** Number of triangles the rasterizer filled. Always zero when rasterizing is off. */
+			unsigned int trianglesRasterized;
+			/** Number of times a different texture was bound. */
+			unsigned int textureBinds;
+			/** Number of setBlendingMode() calls that changed the mode. */
+			unsigned int blendingModeChanges;
+			/** Number of applyMaterial() calls. */
+			unsigned int materialApplications;
+			/** Number of depth, culling, alpha test, lighting and fog state changes. */
+			unsigned int stateChanges;
+			/** Number of pushMatrix() calls. */
+			unsigned int matrixPushes;
+			/** Number of framebuffer texture binds. */
+			unsigned int framebufferBinds;
+			/** Number of clears. */
+			unsigned int clears;
+			/** Number of render data arrays pushed. */
+			unsigned int arraysPushed;
+			/** Number of updateTextureRegion() calls. */
+			unsigned int textureUploads;
+	};
+	
+	/**
+	* A single draw call recorded by the null renderer.
+	*/
+	class _PolyExport NullDrawCall {
+		public:
+			/** Mesh type of the draw, such as Mesh::QUAD_MESH. */
+			int meshType;
+			int vertexCount;
+			Texture *texture;
+			Material *material;
+			Texture *renderTarget;
+			int blendingMode;
+			bool orthoMode;
+			bool depthTest;
+			bool depthWrite;
+			/** Modelview matrix at the time of the draw. */
+			Matrix4 modelview;
+	};
+	
+	/**
+	* A renderer that does not need a display or a GL context. By default it only tracks matrices and state and counts draw calls and state changes, which makes it possible to benchmark and test scene traversal, culling, batching and UI layout on machines without a GPU. Draw calls can optionally be recorded one by one, and an optional software rasterizer draws textured, vertex colored geometry into a system memory framebuffer so renderScreenToImage() can be used for image comparisons. Shader modules are never invoked; materials with module shaders render untextured. Use it with HeadlessCore.
+	*/
+	class _PolyExport NullRenderer : public Renderer {
+		
+	public:
+		
+		NullRenderer();
+		virtual ~NullRenderer();
+		
+		void Resize(int xRes, int yRes);
+		void BeginRender();
+		void EndRender();
+		
+		Cubemap *createCubemap(Texture *t0, Texture *t1, Texture *t2, Texture *t3, Texture *t4, Texture *t5);
+		Texture *createTexture(unsigned int width, unsigned int height, char *textureData, bool clamp, bool createMipmaps, int type = Image::IMAGE_RGBA);
+		Texture *createTextureFromContainer(TextureContainer *container, bool clamp);
+		void destroyTexture(Texture *texture);
+		void updateTextureRegion(Texture *texture, unsigned int x, unsigned int y, unsigned int width, unsigned int height);
+		Texture *createFramebufferTexture(unsigned int width, unsigned int height);
+		void createRenderTextures(Texture **colorBuffer, Texture **depthBuffer, int width, int height, bool floatingPointBuffer);
+		
+		void enableAlphaTest(bool val);
+		
+		void createVertexBufferForMesh(Mesh *mesh);
+		void drawVertexBuffer(VertexBuffer *buffer, bool enableColorBuffer);
+		void bindFrameBufferTexture(Texture *texture);
+		void bindFrameBufferTextureRegion(Texture *texture, int x, int y, int width, int height, int border = 0);
+		void bindFrameBufferTextureClipped(Texture *texture, int x, int y, int width, int height);
+		void unbindFramebuffers();
+		
+		void cullFrontFaces(bool val);
+		
+		void pushRenderDataArray(RenderDataArray *array);
+		RenderDataArray *createRenderDataArrayForMesh(Mesh *mesh, int arrayType);
+		RenderDataArray *createRenderDataArray(int arrayType);
+		void setRenderArrayData(RenderDataArray *array, Number *arrayData);
+		void drawArrays(int drawType);
+		void drawIndexedArrays(int drawType, const unsigned int *indices, unsigned int indexCount);
+		
+		void setOrthoMode(Number xSize=0.0f, Number ySize=0.0f);
+		void _setOrthoMode();
+		void setPerspectiveMode();
+		
+		void enableBackfaceCulling(bool val);
+		void resetViewport();
+		
+		void setLineSmooth(bool val);
+		
+		void loadIdentity();
+		void setClearColor(Number r, Number g, Number b);
+		
+		void setTexture(Texture *texture);
+		
+		Image *renderScreenToImage();
+		void clearScreen();
+		
+		void translate2D(Number x, Number y);
+		void rotate2D(Number angle);
+		void scale2D(Vector2 *scale);
+		
+		void enableDepthTest(bool val);
+		void enableDepthWrite(bool val);
+		
+		void setClippingPlanes(Number nearPlane_, Number farPlane_);
+		
+		void setVertexColor(Number r, Number g, Number b, Number a);
+		
+		void setLineSize(Number lineSize);
+		
+		void translate3D(Vector3 *position);
+		void translate3D(Number x, Number y, Number z);
+		void scale3D(Vector3 *scale);
+		
+		Matrix4 getProjectionMatrix();
+		Matrix4 getModelviewMatrix();
+		void setModelviewMatrix(Matrix4 m);
+		void multModelviewMatrix(Matrix4 m);
+		
+		void enableLighting(bool enable);
+		void enableFog(bool enable);
+		void setFogProperties(int fogMode, Color color, Number density, Number startDepth, Number endDepth);
+		
+		void setDepthFunction(int depthFunction);
+		
+		void clearBuffer(bool colorBuffer, bool depthBuffer);
+		void drawToColorBuffer(bool val);
+		
+		void drawScreenQuad(Number qx, Number qy);
+		
+		void pushMatrix();
+		void popMatrix();
+		
+		bool test2DCoordinate(Number x, Number y, Polygon *poly, const Matrix4 &matrix, bool billboardMode);
+		
+		Vector3 Unproject(Number x, Number y);
+		Vector3 projectRayFrom2DCoordinate(Number x, Number y);
+		
+		void setBlendingMode(int blendingMode);
+		
+		void applyMaterial(Material *material, ShaderBinding *localOptions, unsigned int shaderIndex);
+		void clearShader();
+		
+		/**
+		* Turns the software rasterizer on or off. When off (the default), draw calls are only counted and no framebuffer is allocated.
+		*/
+		void setRasterizingEnabled(bool val);
+		bool getRasterizingEnabled() const;
+		
+		/**
+		* If true, every draw call is stored and can be inspected with getDrawCall() until the next BeginRender(). Off by default.
+		*/
+		void setRecordDrawCalls(bool val);
+		
+		unsigned int getNumDrawCalls() const;
+		const NullDrawCall& getDrawCall(unsigned int index) const;
+		
+		/**
+		* Counters for the frame currently being rendered.
+		*/
+		const RendererStats& getFrameStats() const;
+		
+		/**
+		* Counters for the last completed frame.
+		*/
+		const RendererStats& getLastFrameStats() const;
+		
+		/**
+		* Returns the RGBA framebuffer written by the rasterizer, bottom row first like glReadPixels, or NULL if rasterizing is off.
+		*/
+		const unsigned char *getFramebuffer() const;
+		
+	protected:
+	
+		class RasterVertex {
+			public:
+				Number x, y, z, w;
+				Number u, v;
+				Number r, g, b, a;
+		};
+	
+		Matrix4 &currentMatrix();
+		void setCurrentMatrix(const Matrix4 &m);
+		Matrix4 perspectiveMatrix(Number fovY, Number aspect, Number zNear, Number zFar) const;
+		Matrix4 orthoMatrix(Number left, Number right, Number bottom, Number top, Number zNear, Number zFar) const;
+		Vector3 unprojectPoint(Number winX, Number winY, Number winZ, const Matrix4 &modelview, const Matrix4 &projection) const;
+		
+		void countStateChange(bool *state, bool val);
+		void recordDraw(int meshType, int vertexCount);
+		
+		void allocateFramebuffer();
+		void clearTarget(bool colorBuffer, bool depthBuffer, bool useClearColor);
+		void getTarget(unsigned char **color, Number **depth, int *width, int *height);
+		
+		void rasterize(int meshType, int vertexCount, const float *positions, int positionSize, const float *texCoords, const float *colors);
+		void rasterizePolygon(RasterVertex *vertices, int count);
+		void rasterizeTriangle(const RasterVertex &v0, const RasterVertex &v1, const RasterVertex &v2);
+		void rasterizeLine(const RasterVertex &v0, const RasterVertex &v1);
+		void toWindow(const RasterVertex &in, RasterVertex *out) const;
+		void shadePixel(unsigned char *color, Number *depth, int index, Number z, Number u, Number v, Number r, Number g, Number b, Number a);
+		
+		std::vector<Matrix4> modelviewStack;
+		Matrix4 projectionMatrix;
+		std::vector<Matrix4> projectionStack;
+		Matrix4 sceneProjection;
+		
+		Number nearPlane;
+		Number farPlane;
+		
+		int viewportX;
+		int viewportY;
+		int viewportW;
+		int viewportH;
+		bool scissorEnabled;
+		int scissorX;
+		int scissorY;
+		int scissorW;
+		int scissorH;
+		
+		bool depthTest;
+		bool depthWrite;
+		int depthFunction;
+		bool backfaceCulling;
+		bool alphaTest;
+		bool fogEnabled;
+		bool colorWrite;
+		int blendingMode;
+		bool texturingEnabled;
+		Color vertexColor;
+		
+		RenderDataArray *vertexArray;
+		RenderDataArray *texCoordArray;
+		RenderDataArray *colorArray;
+		
+		bool rasterizing;
+		unsigned char *framebuffer;
+		Number *depthBuffer;
+		int framebufferWidth;
+		int framebufferHeight;
+		
+		bool recordDrawCalls;
+		std::vector<NullDrawCall> drawCalls;
+		
+		RendererStats frameStats;
+		RendererStats lastFrameStats;
+	};
+}
@@ -0,0 +1,99 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+ 
+
+#pragma once
+#include "PolyGlobals.h"
+#include <vector>
+
+namespace Polycode {
+
+	/**
+	* A rectangle placed by a RectPacker.
+	*/
+	class _PolyExport PackedRect {
+		public:
+			PackedRect() : x(0), y(0), width(0), height(0), rotated(false) {}
+			
+			unsigned int x;
+			unsigned int y;
+			
+			/**
+			* Size of the rectangle as placed. If the rectangle was rotated, this is the requested size with width and height swapped.
+			*/
+			unsigned int width;
+			unsigned int height;
+			
+			/**
+			* True if the rectangle was turned by 90 degrees to fit.
+			*/
+			bool rotated;
+	};
+	
+	/**
+	* Packs rectangles into a fixed size area using the MaxRects algorithm. The packer keeps every maximal free rectangle and places each new rectangle where it leaves the shortest leftover side. Inserting rectangles sorted from largest to smallest gives the tightest packing.
+	*/
+	class _PolyExport RectPacker {
+		public:
+			/**
+			* Constructor.
+			* @param width Width of the area to pack into.
+			* @param height Height of the area to pack into.
+			* @param allowRotation If true, rectangles may be turned by 90 degrees when that fits better.
+			*/
+			RectPacker(unsigned int width, unsigned int height, bool allowRotation = false);
+			
+			/**
+			* Places a rectangle.
+			* @param width Width of the rectangle.
+			* @param height Height of the rectangle.
+			* @param result Receives the placement.
+			* @return False if there is no room for the rectangle.
+			*/
+			bool insert(unsigned int width, unsigned int height, PackedRect *result);
+			
+			/**
+			* Removes all placed rectangles.
+			*/
+			void reset();
+			
+			/**
+			* Returns the fraction of the area covered by placed rectangles.
+			*/
+			Number getOccupancy() const;
+			
+			unsigned int getWidth() const;
+			unsigned int getHeight() const;
+			
+		protected:
+			bool findPosition(unsigned int width, unsigned int height, PackedRect *result, unsigned int *bestShortSide, unsigned int *bestLongSide) const;
+			bool splitFreeRect(const PackedRect &freeRect, const PackedRect &usedRect);
+			void pruneFreeRects();
+			
+			unsigned int width;
+			unsigned int height;
+			bool allowRotation;
+			unsigned long usedArea;
+			std::vector<PackedRect> freeRects;
+			std::vector<PackedRect> newFreeRects;
+	};
+}
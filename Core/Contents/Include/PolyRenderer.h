@@ -30,6 +30,7 @@ THE SOFTWARE.
 namespace Polycode {
 	
 	class Cubemap;
+	class Entity;
 	class Material;
 	class Mesh;
 	class PolycodeShaderBinding;
@@ -38,6 +39,7 @@ namespace Polycode {
 	class RenderDataArray;
 	class ShaderBinding;
 	class Texture;
+	class TextureContainer;
 	class VertexBuffer;
 
 	class _PolyExport LightInfo {
@@ -57,6 +59,21 @@ namespace Polycode {
 			Matrix4 textureMatrix;
 			Texture* shadowMapTexture;
 			int lightImportance;
+			Number range;
+			Vector2 shadowMapRectMin;
+			Vector2 shadowMapRectMax;
+	};
+	
+	class _PolyExport LightCandidate {
+		public:
+			const LightInfo *light;
+			Number distance;
+			
+			bool operator<(const LightCandidate &other) const {
+				if(light->lightImportance != other.light->lightImportance)
+					return light->lightImportance > other.light->lightImportance;
+				return distance < other.distance;
+			}
 	};
 
 	class _PolyExport LightSorter {
@@ -87,11 +104,31 @@ namespace Polycode {
 		
 		virtual Cubemap *createCubemap(Texture *t0, Texture *t1, Texture *t2, Texture *t3, Texture *t4, Texture *t5) = 0;		
 		virtual Texture *createTexture(unsigned int width, unsigned int height, char *textureData, bool clamp, bool createMipmaps, int type=Image::IMAGE_RGBA) = 0;
+		
+		/**
+		* Creates a texture from a baked mip chain. The texture takes ownership of the container.
+		*/
+		virtual Texture *createTextureFromContainer(TextureContainer *container, bool clamp) = 0;
 		virtual void destroyTexture(Texture *texture) = 0;
+		
+		/**
+		* Uploads a rectangle of a texture's image data to the GPU, leaving the rest of the texture untouched. Use this after editing part of the data returned by Texture::getTextureData() instead of recreating the whole texture.
+		*/
+		virtual void updateTextureRegion(Texture *texture, unsigned int x, unsigned int y, unsigned int width, unsigned int height) = 0;
 		virtual void createRenderTextures(Texture **colorBuffer, Texture **depthBuffer, int width, int height, bool floatingPointBuffer) = 0;
 		
 		virtual Texture *createFramebufferTexture(unsigned int width, unsigned int height) = 0;
 		virtual void bindFrameBufferTexture(Texture *texture) = 0;
+		
+		/**
+		* Binds a framebuffer texture and restricts rendering and clearing to a region of it. Used to render into a tile of a texture atlas without touching the rest of the texture. The whole region is cleared, but the viewport is inset by border pixels on every side so the edge of the region keeps the cleared value.
+		*/
+		virtual void bindFrameBufferTextureRegion(Texture *texture, int x, int y, int width, int height, int border = 0) = 0;
+		
+		/**
+		* Binds a framebuffer texture without changing the viewport, and restricts drawing and clearing to a rectangle of it. The rectangle is in pixels from the top left and is cleared to transparent black. Used to redraw only the changed part of a cached render.
+		*/
+		virtual void bindFrameBufferTextureClipped(Texture *texture, int x, int y, int width, int height) = 0;
 		virtual void unbindFramebuffers() = 0;
 
 		virtual Image *renderScreenToImage() = 0;
@@ -131,6 +168,13 @@ namespace Polycode {
 		virtual void setRenderArrayData(RenderDataArray *array, Number *arrayData) = 0;
 		virtual void drawArrays(int drawType) = 0;
 		
+		/**
+		* Draws the pushed render data arrays through an index list, so vertices can be shared between primitives.
+		* @param drawType Mesh type of the primitives.
+		* @param indices Vertex indices, indexCount of them.
+		*/
+		virtual void drawIndexedArrays(int drawType, const unsigned int *indices, unsigned int indexCount) = 0;
+		
 		virtual void translate3D(Vector3 *position) = 0;
 		virtual void translate3D(Number x, Number y, Number z) = 0;
 		virtual void scale3D(Vector3 *scale) = 0;
@@ -152,7 +196,17 @@ namespace Polycode {
 		void setCurrentModelMatrix(Matrix4 m) { currentModelMatrix = m; }
 		Matrix4 getCurrentModelMatrix() { return currentModelMatrix; }
 		
+		/**
+		* Sets the entity being rendered. Used by selectLights() to skip lights that cannot reach the entity's bounding sphere.
+		*/
+		void setCurrentObject(Entity *entity) { currentObject = entity; }
+		
 		virtual void setBlendingMode(int blendingMode) = 0;	
+		
+		/**
+		* If set to true, blending also accumulates destination alpha correctly, so the render target ends up holding premultiplied color that can be drawn over other content with BLEND_MODE_PREMULTIPLIED. Set this while rendering into a texture that is composited later.
+		*/
+		void setPremultipliedAlphaTarget(bool val);
 			
 		virtual void applyMaterial(Material *material, ShaderBinding *localOptions, unsigned int shaderIndex) = 0;
 		virtual void clearShader() = 0;
@@ -182,6 +236,11 @@ namespace Polycode {
 		
 		const Matrix4& getCameraMatrix() const;
 		void setCameraMatrix(const Matrix4& matrix);
+		
+		/**
+		* Returns the inverse of the camera matrix. It is computed once when the camera matrix is set.
+		*/
+		const Matrix4& getViewMatrix() const { return viewMatrix; }
 		void setCameraPosition(Vector3 pos);
 		
 		virtual void drawScreenQuad(Number qx, Number qy) = 0;
@@ -195,7 +254,7 @@ namespace Polycode {
 		virtual void cullFrontFaces(bool val) = 0;
 		
 		void clearLights();
-		void addLight(int lightImportance, Vector3 position, Vector3 direction, int type, Color color, Color specularColor, Number constantAttenuation, Number linearAttenuation, Number quadraticAttenuation, Number intensity, Number spotlightCutoff, Number spotlightExponent, bool shadowsEnabled, Matrix4 *textureMatrix, Texture *shadowMapTexture);
+		void addLight(int lightImportance, Vector3 position, Vector3 direction, int type, Color color, Color specularColor, Number constantAttenuation, Number linearAttenuation, Number quadraticAttenuation, Number intensity, Number spotlightCutoff, Number spotlightExponent, bool shadowsEnabled, Matrix4 *textureMatrix, Texture *shadowMapTexture, Number range = -1, Vector2 shadowMapRectMin = Vector2(0,0), Vector2 shadowMapRectMax = Vector2(1,1));
 		
 		void setExposureLevel(Number level);
 		
@@ -204,6 +263,7 @@ namespace Polycode {
 		virtual Vector3 projectRayFrom2DCoordinate(Number x, Number y) = 0;
 		
 		void enableShaders(bool flag);
+		bool getShadersEnabled() const;
 		
 		Number getViewportWidth();
 		Number getViewportHeight();			
@@ -223,6 +283,7 @@ namespace Polycode {
 		static const int BLEND_MODE_NORMAL = 0;
 		static const int BLEND_MODE_LIGHTEN = 1;
 		static const int BLEND_MODE_COLOR = 2;
+		static const int BLEND_MODE_PREMULTIPLIED = 3;
 		
 		static const int FOG_LINEAR = 0;
 		static const int FOG_EXP = 1;
@@ -253,10 +314,28 @@ namespace Polycode {
 		std::vector<LightInfo> getAreaLights() { return areaLights; }
 		std::vector<LightInfo> getSpotLights() { return spotLights;	}
 		
+		/**
+		* Picks the most relevant lights for the object currently being rendered. Lights whose range does not reach the object's bounding sphere are skipped, the rest are ordered by importance and then by distance. Only the closest maxAreaLights area lights and maxSpotLights spot lights are kept.
+		*/
+		void selectLights(unsigned int maxAreaLights, unsigned int maxSpotLights);
+		
+		/**
+		* Area lights picked by the last call to selectLights().
+		*/
+		const std::vector<LightInfo>& getSelectedAreaLights() const { return selectedAreaLights; }
+		
+		/**
+		* Spot lights picked by the last call to selectLights().
+		*/
+		const std::vector<LightInfo>& getSelectedSpotLights() const { return selectedSpotLights; }
+		
 	protected:
 	
+		void selectLightsOfType(const std::vector<LightInfo> &sourceLights, std::vector<LightInfo> &targetLights, const Vector3 &objectPosition, Number objectRadius, unsigned int maxLights);
+	
 		Number anisotropy;
 		Matrix4 currentModelMatrix;
+		Entity *currentObject;
 		LightSorter sorter;	
 	
 		Number viewportWidth;
@@ -276,6 +355,7 @@ namespace Polycode {
 		int renderMode;
 		
 		Matrix4 cameraMatrix;
+		Matrix4 viewMatrix;
 	
 		PolycodeShaderModule* currentShaderModule;
 		std::vector <PolycodeShaderModule*> shaderModules;
@@ -283,11 +363,15 @@ namespace Polycode {
 		std::vector<LightInfo> lights;
 		std::vector<LightInfo> areaLights;
 		std::vector<LightInfo> spotLights;
+		std::vector<LightInfo> selectedAreaLights;
+		std::vector<LightInfo> selectedSpotLights;
+		std::vector<LightCandidate> lightCandidates;
 		int numLights;
 		int numAreaLights;
 		int numSpotLights;
 		
 		bool shadersEnabled;
+		bool premultipliedAlphaTarget;
 		Number fov;
 		
 		bool lightingEnabled;
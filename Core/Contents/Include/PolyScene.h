@@ -37,6 +37,7 @@ namespace Polycode {
 	class SceneEntity;
 	class SceneLight;
 	class SceneMesh;
+	class ShadowMapAtlas;
 	
 	/**
 	* 3D rendering container. The Scene class is the main container for all 3D rendering in Polycode. Scenes are automatically rendered and need only be instantiated to immediately add themselves to the rendering pipeline. A Scene is created with a camera automatically.
@@ -79,6 +80,11 @@ namespace Polycode {
 		*/						
 		Camera *getActiveCamera();
 		
+		/**
+		* Returns the camera the scene is being rendered from while Render() or RenderDepthOnly() runs, and NULL otherwise. Its frustum planes are up to date, so entities made of many parts, like terrain, can use it to cull their parts.
+		*/
+		Camera *getRenderCamera();
+		
 		/**
 		* Sets the scene's active camera.
 		* @param camera New camera to set as the active camera.
@@ -146,6 +152,18 @@ namespace Polycode {
 		
 		SceneLight *getNearestLight(Vector3 pos);
 		
+		/**
+		* Returns the atlas that the shadow maps of the scene's lights are packed into, creating it on first use.
+		*/
+		ShadowMapAtlas *getShadowMapAtlas();
+		
+		/**
+		* Sets the size of the shadow map atlas and the smallest shadow map tile it hands out. Must be called before shadows are enabled on any of the scene's lights. Defaults to a 2048x2048 atlas with tiles down to 128x128.
+		* @param atlasSize Width and height of the atlas texture.
+		* @param minTileSize Smallest shadow map resolution.
+		*/
+		void setShadowMapAtlasSize(unsigned int atlasSize, unsigned int minTileSize);
+		
 		void writeEntityMatrix(SceneEntity *entity, OSFILE *outFile);
 		void writeString(const String& str, OSFILE *outFile);
 		void saveScene(const String& fileName);
@@ -207,6 +225,9 @@ namespace Polycode {
 		bool hasLightmaps;
 		
 		std::vector <SceneLight*> lights;
+		ShadowMapAtlas *shadowMapAtlas;
+		unsigned int shadowMapAtlasSize;
+		unsigned int shadowMapMinTileSize;
 		std::vector <SceneMesh*> staticGeometry;
 		std::vector <SceneMesh*> collisionGeometry;
 		std::vector <SceneEntity*> customEntities;
@@ -216,6 +237,7 @@ namespace Polycode {
 		
 		Camera *defaultCamera;
 		Camera *activeCamera;
+		Camera *renderCamera;
 		std::vector <SceneEntity*> entities;
 		
 		bool lightingEnabled;
@@ -43,6 +43,11 @@ namespace Polycode {
 			*/
 			virtual bool testMouseCollision(Number x, Number y) { return false;}
 			
+			/**
+			* Returns true if the entity's geometry can change without its transform changing, for example a skinned mesh. Cached shadow maps that contain such an entity are re-rendered every frame.
+			*/
+			virtual bool hasDynamicGeometry() const { return false; }
+			
 			/**
 			* If set to true, will cast shadows (Defaults to true).
 			*/
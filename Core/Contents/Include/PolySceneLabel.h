@@ -33,7 +33,7 @@ namespace Polycode {
 	class ShaderBinding;
 
 	/**
-	* 3D text label. Creates a 3D text label.
+	* 3D text label. Creates a 3D text label. Like ScreenLabel, the text is built from glyph quads referencing the font's glyph cache, so changing it doesn't rasterize the text or create a texture. With Label::ANTIALIAS_DISTANCE_FIELD the label uses the font's distance field glyphs and the DistanceFieldText material, so it stays sharp at any scale or viewing distance.
 	*/
 	class _PolyExport SceneLabel : public ScenePrimitive {
 		public:
@@ -59,7 +59,12 @@ namespace Polycode {
 			
 		protected:
 			
+			bool buildGlyphMesh(const String& text);
+			void buildImageMesh();
+			
 			Number scale;
 			Label *label;
+			Texture *labelTexture;
+			Material *distanceFieldMaterial;
 	};
 }
@@ -24,6 +24,8 @@ THE SOFTWARE.
 #pragma once
 #include "PolyGlobals.h"
 #include "PolySceneEntity.h"
+#include "PolyShadowMapAtlas.h"
+#include <vector>
 
 namespace Polycode {
 
@@ -33,6 +35,16 @@ namespace Polycode {
 	class Texture;
 //	class ScenePrimitive;
 	
+	/**
+	* State of a shadow caster when a light's shadow map was last rendered.
+	*/
+	class _PolyExport ShadowCasterState {
+		public:
+			SceneEntity *entity;
+			Matrix4 transform;
+			bool visible;
+	};
+	
 	/**
 	* 3D light source. Lights can be area or spot lights and can be set to different colors. 
 	*/
@@ -74,14 +86,49 @@ namespace Polycode {
 			Number getConstantAttenuation() const { return constantAttenuation; }
 			Number getLinearAttenuation() const { return linearAttenuation; }
 			Number getQuadraticAttenuation() const { return quadraticAttenuation; }
+			
+			/**
+			* Returns the distance at which the light's attenuated intensity drops below the range cutoff, or -1 if the attenuation never gets that low.
+			*/
+			Number getRange() const;
+			
+			/**
+			* Sets the attenuated intensity below which the light is considered to have no effect. Lights are culled and skipped for objects beyond the resulting range. Defaults to 1/256. Set to 0 to never cull the light.
+			* @param cutoff New cutoff value.
+			*/
+			void setRangeCutoff(Number cutoff);
 									
 			/*
 			* Returns the light's type.
 			*/			
 			int getType() const;
 			
+			/**
+			* Renders the light's shadow map into its tile of the scene's shadow map atlas.
+			*/
 			void renderDepthMap(Scene *scene);
 			
+			/**
+			* Renders the shadow map only if it is out of date. The shadow map is out of date if the light moved, if it was invalidated or if the set of shadow casters inside the light's frustum changed (casters were added, removed, moved or hidden, or a caster has dynamic geometry).
+			* @return True if the shadow map was rendered.
+			*/
+			bool updateDepthMap(Scene *scene);
+			
+			/**
+			* Forces the shadow map to be rendered on the next frame. Call this if a caster changed in a way the light cannot detect, such as a child entity of a caster moving or a caster's mesh being edited.
+			*/
+			void invalidateShadowMap();
+			
+			/**
+			* Frees the light's shadow map tile and disables its shadows. Called by the scene when the light is removed from it or the scene is destroyed. The light can no longer cast shadows afterwards.
+			*/
+			void detachFromScene();
+			
+			/**
+			* Returns the region of the scene's shadow map atlas used by this light.
+			*/
+			const ShadowMapTile &getShadowMapTile() const;
+			
 			void Render();
 
 			const Matrix4& getLightViewMatrix() const;
@@ -155,7 +202,7 @@ namespace Polycode {
 			/**
 			* If this is called with 'true', the light will generate a shadow map.
 			* @param val If set to true, enables this light to cast shadows.
-			* @param resolution Resolution of the shadow map. (defaults to 256x256).
+			* @param resolution Resolution of the shadow map. (defaults to 256x256). The shadow map is packed into the scene's shadow map atlas, so the resolution is rounded down to one of the atlas tile sizes.
 			*/
 			void enableShadows(bool val, Number resolution=256);
 			
@@ -195,6 +242,7 @@ namespace Polycode {
 			Number constantAttenuation;
 			Number linearAttenuation;
 			Number quadraticAttenuation;
+			Number rangeCutoff;
 		
 			int type;
 			Number intensity;
@@ -205,6 +253,14 @@ namespace Polycode {
 			Scene *parentScene;
 			
 			Matrix4 lightViewMatrix;
+			
+			void getShadowCasters(Scene *scene, std::vector<ShadowCasterState> &casters);
+			
+			ShadowMapTile shadowMapTile;
+			bool shadowMapDirty;
+			Matrix4 shadowMapLightMatrix;
+			std::vector<ShadowCasterState> shadowCasters;
+			std::vector<ShadowCasterState> currentShadowCasters;
 		
 			Number shadowMapRes;
 			Number shadowMapFOV;	
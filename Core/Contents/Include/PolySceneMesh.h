@@ -122,6 +122,11 @@ namespace Polycode {
 			* Returns the skeleton applied to this scene mesh.
 			*/
 			Skeleton *getSkeleton();
+			
+			/**
+			* Returns true if the mesh has a skeleton applied to it.
+			*/
+			bool hasDynamicGeometry() const;
 		
 			void renderMeshLocally();
 			
@@ -23,8 +23,10 @@ THE SOFTWARE.
 
 #pragma once
 #include "PolyGlobals.h"
+#include "PolyMatrix4.h"
 #include "PolyVector2.h"
 #include "PolyEventDispatcher.h"
+#include "PolyScreenEntity.h"
 #include <vector>
 
 namespace Polycode {
@@ -34,8 +36,31 @@ namespace Polycode {
 	class Material;
 	class Texture;
 	class ScreenEntity;
+	class ScreenSpatialHash;
+	class ScreenSpriteBatch;
 	class ShaderBinding;
 
+	/**
+	* Cached state of a top level screen child in retained rendering mode.
+	*/
+	class _PolyExport RetainedScreenLayer {
+		public:
+			RetainedScreenLayer();
+			
+			ScreenEntity *entity;
+			
+			/**
+			* The child and its descendants as they were last rendered, with bounds in pixels.
+			*/
+			std::vector<ScreenRenderNode> nodes;
+			
+			/**
+			* Bounds of everything the child drew when it was last rendered, in pixels.
+			*/
+			Vector2 boundsMin;
+			Vector2 boundsMax;
+	};
+
 	/**
 	* 2D rendering base. The Screen is the container for all 2D rendering in Polycode. Screens are automatically rendered and need only be instantiated to immediately add themselves to the rendering pipeline. Each screen has a root entity.
 	*/	
@@ -156,8 +181,63 @@ namespace Polycode {
 		 */
 		bool ownsChildren;
 		
+		/**
+		* If enabled, consecutive screen meshes that share a texture and blending mode are drawn together in one draw call. Pack images into a TextureAtlas to get the most out of this. Disabled by default.
+		*/
+		void setSpriteBatchingEnabled(bool enabled);
+		
+		/**
+		* Returns the screen's sprite batch, which can be queried for draw call statistics, or NULL if batching is disabled.
+		*/
+		ScreenSpriteBatch *getSpriteBatch() const { return spriteBatch; }
+		
+		/**
+		* Enables retained rendering. In retained mode the screen keeps its last render in a screen sized texture and composites that every frame. Each frame it compares the render state of every entity (see ScreenEntity::hashRenderState()) with the previous frame and only redraws the region covered by entities that changed, before and after the change. This saves most of the drawing for mostly static interfaces. Screens with a screen shader are always rendered immediately. Disabled by default.
+		*/
+		void setRetainedRenderingEnabled(bool enabled);
+		
+		/**
+		* Returns true if retained rendering is enabled.
+		*/
+		bool getRetainedRenderingEnabled() const { return retainedRendering; }
+		
+		/**
+		* Makes a retained screen redraw everything on the next frame. Call this after changing something the screen can't detect, such as what a custom entity draws in its Render().
+		*/
+		void invalidateRetainedRender();
+		
+		/**
+		* Returns the number of frames on which a retained screen had to redraw part of its cached render.
+		*/
+		unsigned int getRetainedRedrawCount() const { return retainedRedrawCount; }
+		
+		/**
+		* Returns the fraction of the screen that was redrawn on the last retained frame that redrew anything.
+		*/
+		Number getLastRetainedRedrawArea() const { return lastRetainedRedrawArea; }
+		
+		/**
+		* If enabled, the screen keeps the entities that process input in a ScreenSpatialHash and delivers mouse moves only to the entities under the cursor, the entities the cursor just left and the entities being dragged, in the usual order. On screens with many entities this makes mouse moves much cheaper. Entities that are not involved in a mouse move don't get onMouseMove() calls. The hash is rebuilt after frames on which entities moved or changed. Disabled by default.
+		*/
+		void setSpatialHashEnabled(bool enabled);
+		
+		/**
+		* Returns the screen's spatial hash, or NULL if it's disabled.
+		*/
+		ScreenSpatialHash *getSpatialHash() const { return spatialHash; }
+		
 	protected:
 		
+		void updateSpatialHash();
+		void rebuildSpatialHash();
+		void addToSpatialHash(ScreenEntity *entity, unsigned int *order);
+		bool isEntityInputActive(ScreenEntity *entity) const;
+		void routeMouseMove(Number x, Number y, int timestamp);
+		
+		void updateChild(ScreenEntity *child);
+		void renderRetained();
+		Matrix4 getBaseMatrix() const;
+		
 		bool useNormalizedCoordinates;
 		Number yCoordinateSize;		
 		
@@ -172,5 +252,23 @@ namespace Polycode {
 		Texture *originalSceneTexture;			
 		std::vector<ShaderBinding*> localShaderOptions;
 		bool _hasFilterShader;
+		
+		ScreenSpriteBatch *spriteBatch;
+		
+		bool retainedRendering;
+		bool retainedInvalid;
+		Texture *retainedTexture;
+		Texture *retainedDepthTexture;
+		unsigned int retainedScreenState;
+		std::vector<RetainedScreenLayer> retainedLayers;
+		std::vector<ScreenRenderNode> retainedNodes;
+		unsigned int retainedRedrawCount;
+		Number lastRetainedRedrawArea;
+		
+		ScreenSpatialHash *spatialHash;
+		bool spatialHashDirty;
+		unsigned int spatialHashDeletedCount;
+		std::vector<unsigned int> spatialHashStates;
+		std::vector<ScreenEntity*> hoveredEntities;
 	};
 }
@@ -32,6 +32,23 @@ THE SOFTWARE.
 
 namespace Polycode {
 
+class ScreenEntity;
+
+/**
+* Render state of a single screen entity, as recorded by ScreenEntity::addRenderNodes().
+*/
+class _PolyExport ScreenRenderNode {
+	public:
+		ScreenEntity *entity;
+		unsigned int renderState;
+		
+		/**
+		* Area the entity itself draws into, in screen coordinates. Empty if it draws nothing.
+		*/
+		Vector2 boundsMin;
+		Vector2 boundsMax;
+};
+
 /**
 * 2D Entity base. The ScreenEntity is the base class for all 2D elements in Polycode. They can be added to a screen or to other ScreenEntities and are rendered automatically. If you want to create custom screen objects, subclass this. ScreenEntity subclasses Entity, which use 3d positioning and tranformation, but provides some 2d-only versions of the transformation functions for convenience.
 */
@@ -87,6 +104,11 @@ class _PolyExport ScreenEntity : public Entity, public EventDispatcher {
 		bool _onMouseDown(Number x, Number y, int mouseButton, int timestamp, Vector2 parentAdjust = Vector2(0,0));
 		bool _onMouseUp(Number x, Number y, int mouseButton, int timestamp);
 		void _onMouseMove(Number x, Number y, int timestamp);
+		
+		/**
+		* Handles a mouse move for this entity only, without passing it on to its children. Used by screens that route mouse moves through a ScreenSpatialHash.
+		*/
+		void _processMouseMove(Number x, Number y, int timestamp);
 		void _onMouseWheelUp(Number x, Number y, int timestamp);
 		void _onMouseWheelDown(Number x, Number y, int timestamp);
 	
@@ -103,6 +125,11 @@ class _PolyExport ScreenEntity : public Entity, public EventDispatcher {
 		virtual void onKeyUp(PolyKEY key, wchar_t charCode){}
 		
 		bool hitTest(Number x, Number y) const;
+		
+		/**
+		* Returns the axis aligned bounds of the area hitTest() tests against, in screen coordinates.
+		*/
+		void getScreenHitBounds(Vector2 *min, Vector2 *max) const;
 	
 		Matrix4 buildPositionMatrix();
 		void adjustMatrixForChildren();
@@ -135,6 +162,21 @@ class _PolyExport ScreenEntity : public Entity, public EventDispatcher {
 		
 		void startDrag(Number xOffset, Number yOffset);
 		void stopDrag();
+		
+		/**
+		* Returns true if the mouse was over the entity on the last mouse move it received.
+		*/
+		bool isMouseOver() const { return mouseOver; }
+		
+		/**
+		* Returns all screen entities that are currently being dragged.
+		*/
+		static const std::vector<ScreenEntity*>& getDraggedEntities() { return draggedEntities; }
+		
+		/**
+		* Returns the number of screen entities deleted so far. Screens use it to notice that cached entity pointers may have gone stale.
+		*/
+		static unsigned int getDeletedEntityCount() { return deletedEntityCount; }
 				
 		void setBlendingMode(int newBlendingMode);
 		
@@ -171,6 +213,35 @@ class _PolyExport ScreenEntity : public Entity, public EventDispatcher {
 		bool snapToPixels;
 
 		bool processInputEvents;
+		
+		/**
+		* Combines the state that affects how this entity itself is drawn into a running hash. Children are not included. Screens in retained rendering mode compare these hashes between frames to find out which entities need to be redrawn. Subclasses that draw something the base state doesn't cover should override this and hash that state too.
+		* @param hash Hash to combine the state into.
+		* @return The combined hash.
+		*/
+		virtual unsigned int hashRenderState(unsigned int hash);
+		
+		/**
+		* Combines the state that affects where this entity and its children can be hit by the mouse into a running hash. Screens use it to find out when their ScreenSpatialHash has to be rebuilt.
+		*/
+		unsigned int hashInputState(unsigned int hash);
+		
+		/**
+		* Appends the render state and drawn area of this entity and each of its drawn children to a list, in render order.
+		* @param parentMatrix Matrix the entity is drawn with relative to the screen.
+		* @param nodes List to append to.
+		*/
+		void addRenderNodes(const Matrix4 &parentMatrix, std::vector<ScreenRenderNode> *nodes);
+		
+		/**
+		* Returns the area this entity draws into, in its own coordinates. By default this is its width and height around the origin.
+		*/
+		virtual void getLocalRenderBounds(Vector2 *min, Vector2 *max);
+		
+		/**
+		* Combines raw data into a hash. Used by hashRenderState().
+		*/
+		static unsigned int hashData(unsigned int hash, const void *data, unsigned int size);
 
 	protected:
 	
@@ -196,6 +267,14 @@ class _PolyExport ScreenEntity : public Entity, public EventDispatcher {
 		
 		int lastClickTicks;
 		ScreenEntity *focusedChild;
+		
+		static std::vector<ScreenEntity*> draggedEntities;
+		static unsigned int deletedEntityCount;
+		
+		/**
+		* Draws any quads waiting in the active ScreenSpriteBatch and restores this entity's color and blending mode. Call this before drawing directly in Render().
+		*/
+		void flushSpriteBatch();
 
 };
 
@@ -26,6 +26,9 @@ THE SOFTWARE.
 
 namespace Polycode {
 
+	class TextureAtlas;
+	class TextureAtlasRegion;
+
 	/**
 	* 2D screen image display. This ScreenEntity can load and display and image.
 	*/
@@ -42,6 +45,13 @@ namespace Polycode {
 		* @param image Image to create from.
 		*/		
 		ScreenImage(Image *image);		
+		
+		/**
+		* Create screen image from a region of a texture atlas. Images that share an atlas page can be drawn together by the ScreenSpriteBatch. The page texture is uploaded when the image is created, so add all images to the atlas first.
+		* @param atlas Atlas the region belongs to.
+		* @param region Region to display.
+		*/
+		ScreenImage(TextureAtlas *atlas, TextureAtlasRegion *region);
 		virtual ~ScreenImage();
 		
 		/**
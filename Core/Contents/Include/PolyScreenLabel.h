@@ -23,14 +23,20 @@ THE SOFTWARE.
 #pragma once
 #include "PolyGlobals.h"
 #include "PolyScreenShape.h"
+#include "PolyColor.h"
+#include <vector>
 
 namespace Polycode {
 
 	class Label;
+	class Material;
 	class ScreenImage;
+	class ShaderBinding;
 
 	/**
-	* 2D screen label display. Displays 2d text in a specified font.
+	* 2D screen label display. Displays 2d text in a specified font. The text is drawn as one quad per glyph from the font's glyph cache, so changing it only rebuilds the label's vertices. Labels on the same glyph atlas page can be drawn together by the ScreenSpriteBatch.
+	*
+	* Labels created with Label::ANTIALIAS_DISTANCE_FIELD draw from the font's distance field cache with the DistanceFieldText material instead, so labels of any size share one set of glyphs and stay sharp when scaled or rotated.
 	*/ 
 	class _PolyExport ScreenLabel : public ScreenShape {
 		public:
@@ -65,12 +71,32 @@ namespace Polycode {
 			* @return The label's text.
 			*/
 			const String& getText() const;
+			
+			/**
+			* Sets a color for each character of the text, for example for syntax coloring. The colors replace the label's color and are kept when the text changes, until they are cleared by passing an empty vector. Characters past the end of the vector use its last color. Labels that fall back to a rendered image (see Label::ANTIALIAS_DISTANCE_FIELD and glyphs that don't fit on one atlas page) ignore the colors.
+			* @param colors Color of each character.
+			*/
+			void setCharacterColors(const std::vector<Color>& colors);
 		
 			Label *getLabel() const;
 			
+			void Render();
+			
 		protected:
 			
+			bool buildGlyphMesh(const String& text);
+			void buildImageMesh();
+			void applyCharacterColors();
+			
 			Label *label;
+			Texture *labelTexture;
+			
+			Material *distanceFieldMaterial;
+			ShaderBinding *distanceFieldBinding;
+			bool distanceFieldMesh;
 			ScreenImage *dropShadowImage;
+			
+			std::vector<Color> characterColors;
+			std::vector<int> glyphCharacters;
 	};
 }
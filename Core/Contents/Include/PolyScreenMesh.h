@@ -84,6 +84,9 @@ namespace Polycode {
 			*/						
 			void setTexture(Texture *texture);
 			
+			unsigned int hashRenderState(unsigned int hash);
+			void getLocalRenderBounds(Vector2 *min, Vector2 *max);
+			
 			/**
 			* If this is set to true, the lines in wireframe meshes will be anti-aliased if the support is available in the renderer.
 			*/			
@@ -94,6 +97,12 @@ namespace Polycode {
 			
 		protected:
 		
+			/**
+			* Hands the mesh to the active ScreenSpriteBatch if there is one and the mesh can be batched, which requires a quad mesh and default depth, alpha test and render mode settings.
+			* @return True if the mesh was batched and doesn't need to be drawn.
+			*/
+			bool addToSpriteBatch();
+		
 			Mesh *mesh;
 			Texture *texture;
 	};
@@ -45,6 +45,8 @@ namespace Polycode {
 			ScreenShape(int shapeType, Number option1=0, Number option2=0, Number option3=0, Number option4=0);
 			virtual ~ScreenShape();
 			void Render();
+			
+			unsigned int hashRenderState(unsigned int hash);
 
 			/**
 			* Sets the color of the shape stroke if it's enabled.
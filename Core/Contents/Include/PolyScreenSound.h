@@ -44,7 +44,7 @@ namespace Polycode {
 	*/	
 	class _PolyExport ScreenSound : public ScreenEntity {
 		public:
-			ScreenSound(const String& fileName, Number referenceDistance, Number maxDistance);
+			ScreenSound(const String& fileName, Number referenceDistance, Number maxDistance, bool streamed = false);
 			virtual ~ScreenSound();			
 			void Update();
 			
@@ -0,0 +1,111 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+ 
+
+#pragma once
+#include "PolyGlobals.h"
+#include "PolyVector2.h"
+#include <map>
+#include <vector>
+
+namespace Polycode {
+
+	class ScreenEntity;
+
+	/**
+	* An entity stored in a ScreenSpatialHash.
+	*/
+	class _PolyExport ScreenSpatialHashEntry {
+		public:
+			ScreenEntity *entity;
+			
+			/**
+			* Position of the entity in the order input events are delivered in.
+			*/
+			unsigned int order;
+			
+			Vector2 boundsMin;
+			Vector2 boundsMax;
+	};
+
+	/**
+	* Uniform grid of screen entities keyed by the screen area they can be hit in. A point query only looks at the entities in the grid cell under the point, so finding what's under the mouse doesn't depend on how many entities the screen has. Entities that cover many cells are kept in a separate list that every query checks, so large backgrounds don't fill the grid.
+	*/
+	class _PolyExport ScreenSpatialHash {
+		public:
+			/**
+			* Constructor.
+			* @param cellSize Size of a grid cell in screen coordinates.
+			*/
+			ScreenSpatialHash(Number cellSize = 64.0);
+			virtual ~ScreenSpatialHash();
+			
+			/**
+			* Removes all entities.
+			*/
+			void clear();
+			
+			/**
+			* Adds an entity using the bounds of its hit area. See ScreenEntity::getScreenHitBounds().
+			* @param entity Entity to add.
+			* @param order Position of the entity in the input event order. Query results are sorted by it.
+			*/
+			void addEntity(ScreenEntity *entity, unsigned int order);
+			
+			/**
+			* Records the input order of an entity without making it hittable, so it can be sorted with query results when it receives input for another reason, such as being dragged.
+			*/
+			void addEntityOrder(ScreenEntity *entity, unsigned int order);
+			
+			/**
+			* Returns the entities whose hit bounds contain a point, sorted by their order.
+			* @param x Horizontal position in screen coordinates.
+			* @param y Vertical position in screen coordinates.
+			* @param entries Vector to add the entries to.
+			*/
+			void getEntitiesAt(Number x, Number y, std::vector<ScreenSpatialHashEntry> *entries) const;
+			
+			/**
+			* Returns the input order of an entity or -1 if it's not in the grid.
+			*/
+			int getEntityOrder(ScreenEntity *entity) const;
+			
+			unsigned int getNumEntities() const;
+			Number getCellSize() const;
+			
+			static bool cmpOrder(const ScreenSpatialHashEntry &left, const ScreenSpatialHashEntry &right);
+			
+			/**
+			* Entities covering more cells than this are kept in the list of large entities instead of the grid.
+			*/
+			static const int MAX_ENTITY_CELLS = 64;
+			
+		protected:
+		
+			long long cellKey(int x, int y) const;
+		
+			Number cellSize;
+			std::map<long long, std::vector<ScreenSpatialHashEntry> > cells;
+			std::vector<ScreenSpatialHashEntry> largeEntities;
+			std::map<ScreenEntity*, unsigned int> orders;
+	};
+}
@@ -0,0 +1,135 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+ 
+
+#pragma once
+#include "PolyGlobals.h"
+#include "PolyVector2.h"
+#include "PolyVector3.h"
+#include "PolyColor.h"
+#include "PolyMatrix4.h"
+#include <vector>
+
+namespace Polycode {
+
+	class RenderDataArray;
+	class Renderer;
+	class Texture;
+
+	/**
+	* Merges screen quads into as few draw calls as possible. While a batch is active, batchable ScreenMesh instances hand their quads to it, already transformed into view space, instead of drawing them. The batch keeps its own copy of the entity transform stack, so quads are transformed on the CPU without reading the modelview matrix back from the renderer. Consecutive quads that use the same texture and blending mode are drawn together with one dynamic vertex array, so screens built from many images that share a TextureAtlas page render in a handful of draw calls.
+	*
+	* Screens drive their own batch, see Screen::setSpriteBatchingEnabled(). Anything that draws directly while a batch is active must call flushCurrent() first to keep the drawing order.
+	*/
+	class _PolyExport ScreenSpriteBatch {
+		public:
+			ScreenSpriteBatch();
+			virtual ~ScreenSpriteBatch();
+			
+			/**
+			* Makes this the active batch and resets the statistics.
+			* @param baseMatrix Modelview matrix the screen's entities are rendered under.
+			*/
+			void begin(const Matrix4 &baseMatrix);
+			
+			/**
+			* Draws the remaining quads and deactivates the batch.
+			*/
+			void end();
+			
+			/**
+			* Adds a quad to the batch, drawing the quads collected so far if the texture or blending mode changed.
+			* @param texture Texture to draw with. Can be NULL.
+			* @param blendingMode Blending mode to draw with.
+			* @param positions Four corners in view space.
+			* @param texCoords Texture coordinates of the four corners.
+			* @param colors Colors of the four corners.
+			*/
+			void addQuad(Texture *texture, int blendingMode, const Vector3 *positions, const Vector2 *texCoords, const Color *colors);
+			
+			/**
+			* Pushes an entity's transform on top of the batch's transform stack. Called by entities as they are rendered, mirroring the renderer's matrix stack.
+			*/
+			void pushMatrix(const Matrix4 &matrix);
+			
+			/**
+			* Applies a transform to the top of the batch's transform stack.
+			*/
+			void multMatrix(const Matrix4 &matrix);
+			
+			void popMatrix();
+			
+			/**
+			* Returns the current modelview transform.
+			*/
+			const Matrix4 &getMatrix() const;
+			
+			/**
+			* Draws the collected quads.
+			* @return True if anything was drawn.
+			*/
+			bool flush();
+			
+			/**
+			* Number of draw calls issued since begin().
+			*/
+			unsigned int getNumDrawCalls() const;
+			
+			/**
+			* Number of quads added since begin().
+			*/
+			unsigned int getNumQuads() const;
+			
+			/**
+			* Returns the active batch or NULL if no batch is active.
+			*/
+			static ScreenSpriteBatch *getCurrent();
+			
+			/**
+			* Flushes the active batch, if there is one.
+			* @return True if anything was drawn.
+			*/
+			static bool flushCurrent();
+			
+		protected:
+		
+			void reserve(unsigned int numVertices);
+			
+			Renderer *renderer;
+			RenderDataArray *vertexArray;
+			RenderDataArray *texCoordArray;
+			RenderDataArray *colorArray;
+			
+			unsigned int vertexCapacity;
+			unsigned int numVertices;
+			
+			Texture *batchTexture;
+			int batchBlendingMode;
+			
+			unsigned int numDrawCalls;
+			unsigned int numQuads;
+			
+			std::vector<Matrix4> matrixStack;
+			
+			static ScreenSpriteBatch *current;
+	};
+}
@@ -0,0 +1,126 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+ 
+
+#pragma once
+#include "PolyGlobals.h"
+#include "PolyMatrix4.h"
+#include "PolyVector2.h"
+#include <vector>
+
+namespace Polycode {
+
+	class Texture;
+
+	/**
+	* A square region of a ShadowMapAtlas.
+	*/
+	class _PolyExport ShadowMapTile {
+		public:
+			ShadowMapTile();
+			
+			/**
+			* Returns true if the tile refers to an allocated region of the atlas.
+			*/
+			bool isValid() const { return size > 0; }
+		
+			unsigned int x;
+			unsigned int y;
+			unsigned int size;
+			
+			int nodeIndex;
+	};
+
+	/**
+	* Packs the shadow maps of all shadow casting lights in a scene into a single depth texture. The atlas is split into square power of two tiles, from the full atlas size down to the minimum tile size, which act as the available shadow map resolution tiers. Requested resolutions are rounded down to the nearest tier and, if the atlas is full at that tier, to the next smaller tier that still has room.
+	*/
+	class _PolyExport ShadowMapAtlas {
+		public:
+			/**
+			* Constructor.
+			* @param atlasSize Width and height of the atlas texture. Rounded down to a power of two.
+			* @param minTileSize Smallest tile that will be handed out. Rounded down to a power of two.
+			* @param tileBorder Pixels on each side of a tile that are left cleared to the far depth, so filtered shadow lookups near a tile's edge never read a neighbouring tile.
+			*/
+			ShadowMapAtlas(unsigned int atlasSize = 2048, unsigned int minTileSize = 128, unsigned int tileBorder = 2);
+			virtual ~ShadowMapAtlas();
+			
+			/**
+			* Allocates a tile for a shadow map.
+			* @param resolution Requested shadow map resolution.
+			* @param tile Tile to fill in.
+			* @return True if a tile was allocated, false if the atlas is full.
+			*/
+			bool allocateTile(unsigned int resolution, ShadowMapTile *tile);
+			
+			/**
+			* Returns a tile to the atlas and resets it.
+			*/
+			void freeTile(ShadowMapTile *tile);
+			
+			/**
+			* Returns the matrix that maps 0-1 shadow map texture coordinates into the tile's region of the atlas, inside its border. Multiply a light's texture matrix by this to sample its tile.
+			*/
+			Matrix4 getTileTextureMatrix(const ShadowMapTile &tile) const;
+			
+			/**
+			* Returns the atlas texture coordinates that lookups into the tile should be clamped to. The rectangle is the rendered part of the tile, inset by half a texel.
+			*/
+			void getTileTextureRect(const ShadowMapTile &tile, Vector2 *rectMin, Vector2 *rectMax) const;
+			
+			/**
+			* Returns the atlas depth texture, creating it on first use.
+			*/
+			Texture *getTexture();
+			
+			unsigned int getAtlasSize() const;
+			unsigned int getMinTileSize() const;
+			unsigned int getTileBorder() const;
+			
+		protected:
+		
+			class AtlasNode {
+				public:
+					unsigned int x;
+					unsigned int y;
+					unsigned int size;
+					int parent;
+					int firstChild;
+					int state;
+			};
+			
+			static const int NODE_FREE = 0;
+			static const int NODE_SPLIT = 1;
+			static const int NODE_USED = 2;
+			
+			int findNode(int nodeIndex, unsigned int size);
+			void splitNode(int nodeIndex);
+			
+			std::vector<AtlasNode> nodes;
+			std::vector<int> freeChildBlocks;
+			
+			unsigned int atlasSize;
+			unsigned int minTileSize;
+			unsigned int tileBorder;
+			Texture *texture;
+	};
+}
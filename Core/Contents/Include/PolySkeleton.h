@@ -28,24 +28,31 @@ THE SOFTWARE.
 #include "PolyVector3.h"
 #include "PolyQuaternion.h"
 #include "PolySceneEntity.h"
+#include "PolyAnimationClip.h"
 #include <vector>
 
 namespace Polycode {
 	
 	class BezierCurve;
 	class Bone;
-	class QuaternionTween;
-	class BezierPathTween;
 	
+	/**
+	* Animation curves of one bone, as loaded from an animation file. Tracks are only used to bake an AnimationClip and are not played back directly.
+	*/
 	class _PolyExport BoneTrack {
 		public:
 			BoneTrack(Bone *bone, Number length);
 			virtual ~BoneTrack();
-			void Play(bool once=false);
-			void Stop();
-			void Update();
-		
-			void setSpeed(Number speed);
+			
+			/**
+			* Samples the curves at evenly spaced times from the start to the end of the track. Missing location curves use the bone's base position and missing rotation curves the identity rotation.
+			* @param numSamples Number of samples to take.
+			* @param positions Filled with the bone position at each sample.
+			* @param rotations Filled with the bone rotation at each sample.
+			*/
+			void bake(unsigned int numSamples, std::vector<Vector3> &positions, std::vector<Quaternion> &rotations);
+			
+			Bone *getBone() const;
 			
 			BezierCurve *scaleX;
 			BezierCurve *scaleY;
@@ -58,37 +65,14 @@ namespace Polycode {
 			BezierCurve *LocY;
 			BezierCurve *LocZ;
 			
-			Vector3 LocXVec;
-			Vector3 LocYVec;
-			Vector3 LocZVec;						
-
-			Vector3 ScaleXVec;
-			Vector3 ScaleYVec;
-			Vector3 ScaleZVec;						
-		
-		
-			Quaternion boneQuat;
-			QuaternionTween *quatTween;
-			
-			Vector3 QuatWVec;
-			Vector3 QuatXVec;
-			Vector3 QuatYVec;			
-			Vector3 QuatZVec;		
-		
-			
 		protected:
 		
 			Number length;
-		
-			bool initialized;
-		
 			Bone *targetBone;
-			std::vector <BezierPathTween*> pathTweens;
-		
 	};
 
 	/**
-	* Skeleton animation.
+	* Skeleton animation. The animation's bone tracks are baked into an AnimationClip when they are added, and playing the animation samples the clip instead of running tweens.
 	*/ 
 	class _PolyExport SkeletonAnimation {
 		public:
@@ -97,10 +81,11 @@ namespace Polycode {
 			virtual ~SkeletonAnimation();		
 			
 			/**
-			* Adds a new bone track
+			* Bakes a bone track into the animation's clip. The track is deleted once it's baked.
 			* @param boneTrack New bone track to add.
+			* @param boneIndex Index of the track's bone in the skeleton.
 			*/
-			void addBoneTrack(BoneTrack *boneTrack);
+			void addBoneTrack(BoneTrack *boneTrack, unsigned int boneIndex);
 			
 			/**
 			* Returns the animation name.
@@ -108,14 +93,24 @@ namespace Polycode {
 			const String& getName() const;
 			
 			/**
-			* Plays the animation.
+			* Plays the animation from the start.
 			*/
 			void Play(bool once);			
 			/**
 			* Stops the animation.
 			*/			
 			void Stop();
+			
+			/**
+			* Advances the animation by the frame's elapsed time.
+			*/
 			void Update();
+			
+			/**
+			* Writes the animation's current pose into a pose buffer, blended by the given weight.
+			* @see AnimationClip::blendPose()
+			*/
+			void applyToPose(std::vector<BonePose> &pose, Number weight = 1.0) const;
 
 			/**
 			* Sets the animation multiplier speed.
@@ -123,11 +118,31 @@ namespace Polycode {
 			*/					
 			void setSpeed(Number speed);
 			
+			/**
+			* Returns the current playback time in seconds.
+			*/
+			Number getTime() const;
+			
+			/**
+			* Returns true if the animation is playing.
+			*/
+			bool isPlaying() const;
+			
+			/**
+			* Returns the baked clip of the animation.
+			*/
+			AnimationClip *getClip() const;
+			
 		protected:
 			
 			String name;
 			Number duration;
-			std::vector<BoneTrack*> boneTracks;
+			AnimationClip *clip;
+			
+			Number time;
+			Number speed;
+			bool once;
+			bool playing;
 	};
 
 	/**
@@ -160,6 +175,14 @@ namespace Polycode {
 						
 			void playAnimationByIndex(int index, bool once = false);		
 			
+			/**
+			* Blends from the current animation to another one. Both animations keep playing until the fade is over.
+			* @param animName Name of animation to fade to.
+			* @param fadeTime Length of the fade in seconds.
+			* @param once If true, will only play the animation once.
+			*/
+			void fadeToAnimation(const String& animName, Number fadeTime, bool once = false);
+			
 			/**
 			* Loads in a new animation from a file and adds it to the skeleton.
 			* @param name Name of the new animation.
@@ -210,12 +233,35 @@ namespace Polycode {
 			* Returns the current animation.
 			*/
 			SkeletonAnimation *getCurrentAnimation() const { return currentAnimation; }
+			
+			/**
+			* Returns the pose buffer of the skeleton, with one entry per bone. Animations are sampled into it every update before it is applied to the bones, and it can also be written directly and applied with applyPose().
+			*/
+			std::vector<BonePose> &getPose();
+			
+			/**
+			* Resets the pose buffer to the pose the skeleton was loaded in.
+			*/
+			void resetPose();
+			
+			/**
+			* Sets the bone matrices from the pose buffer.
+			*/
+			void applyPose();
 		
 		protected:
 		
+			void setCurrentAnimation(SkeletonAnimation *anim, bool once, Number fadeTime);
+		
 			SceneEntity *bonesEntity;
 		
 			SkeletonAnimation *currentAnimation;
+			SkeletonAnimation *previousAnimation;
+			Number fadeTime;
+			Number fadeElapsed;
+			
+			std::vector<BonePose> bindPose;
+			std::vector<BonePose> pose;
 			std::vector<Bone*> bones;
 			std::vector<SkeletonAnimation*> animations;
 	};
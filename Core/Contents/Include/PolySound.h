@@ -40,9 +40,13 @@
 namespace Polycode {
 	
 	class String;
+	class SoundStream;
+	class SoundSample;
 
 	/**
 	* Loads and plays a sound. This class can load and play an OGG or WAV sound file.
+	*
+	* Sounds are lightweight handles: the decoded data is shared through the SoundManager's sample cache and an OpenAL source is only borrowed from the SoundManager's voice pool while the sound is audible. Streamed sounds decode their file while playing and keep a source of their own.
 	*/
 	class _PolyExport Sound {
 	public:
@@ -50,8 +54,9 @@ namespace Polycode {
 		/**
 		* Constructor.
 		* @param fileName Path to an OGG or WAV file to load.
+		* @param streamed If this is true, the file is decoded in small chunks on a background thread while it plays instead of being loaded into memory. Use this for music and other long sounds.
 		*/ 
-		Sound(const String& fileName);
+		Sound(const String& fileName, bool streamed = false);
 		Sound(const char *data, int size, int channels = 1, ALsizei freq = 44100, int bps = 16);
 		virtual ~Sound();
 		
@@ -114,6 +119,50 @@ namespace Polycode {
 		*/
 		int getSampleLength();
 		
+		/**
+		* Returns true if the sound is streamed from its file.
+		*/
+		bool isStreamed() const;
+		
+		/**
+		* Sets the priority of this sound. When there are more sounds playing than voices, sounds with a lower priority lose their voice first. Defaults to 0.
+		*/
+		void setPriority(int priority);
+		int getPriority() const;
+		
+		/**
+		* Returns true if the sound is playing without a voice, either because it is out of earshot or because all voices are taken by more important sounds.
+		*/
+		bool isVirtual() const;
+		
+		/**
+		* Returns an estimate of how loud the sound is at the listener position, from 0 to its volume. Used to decide which sounds keep their voices.
+		*/
+		Number getAudibility() const;
+		
+		/**
+		* Gives this sound an OpenAL source to play through, or takes it away if source is 0. Used by SoundManager.
+		* @param source Source to play through.
+		* @param offset Playback time in seconds to start the source at.
+		*/
+		void setVoice(ALuint source, Number offset);
+		ALuint getVoice() const;
+		
+		/**
+		* Advances the playback time of a virtual sound. Returns false once a sound that does not loop has finished. Used by SoundManager.
+		*/
+		bool updateVirtual(Number elapsed);
+		
+		/**
+		* Returns true if the sound is supposed to be playing, with or without a voice.
+		*/
+		bool isActive() const;
+		
+		/**
+		* Marks the sound as stopped. Used by SoundManager.
+		*/
+		void setInactive();
+		
 		void setPositionalProperties(Number referenceDistance, Number maxDistance);
 		
 		ALuint loadBytes(const char *data, int size, int channels = 1, ALsizei freq = 44100, int bps = 16);
@@ -131,9 +180,27 @@ namespace Polycode {
 
 	protected:
 	
+		void initSound();
+		void applySourceProperties();
+	
 		bool isPositional;
 		ALuint soundSource;
 		int sampleLength;
+		SoundStream *stream;
+		SoundSample *sample;
+		
+		Number volume;
+		Number pitch;
+		bool looping;
+		bool active;
+		int priority;
+		Number virtualTime;
+		
+		Vector3 position;
+		Vector3 velocity;
+		Vector3 direction;
+		Number referenceDistance;
+		Number maxDistance;
 		
 	};
 }
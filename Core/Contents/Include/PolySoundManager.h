@@ -22,15 +22,34 @@
 
 #pragma once
 #include "PolyGlobals.h"
+#include "PolyString.h"
 #include "PolyVector3.h"
 
 #include "al.h"
 #include "alc.h"
+#include <map>
+#include <vector>
 
 namespace Polycode {
 	
+	class Sound;
+	
+	/**
+	* A decoded sound file shared by every Sound that plays it.
+	*/
+	class _PolyExport SoundSample {
+	public:
+		SoundSample();
+		
+		String fileName;
+		ALuint buffer;
+		int sampleLength;
+		Number duration;
+		unsigned int refCount;
+	};
+	
 	/**
-	* Controls global sound settings.
+	* Controls global sound settings. The sound manager also owns the decoded samples and the OpenAL sources used to play sounds. Samples are cached by file name and shared between sounds. Sources come from a fixed pool of voices: when every voice is busy, the least important playing sound (by priority, then by how loud it is at the listener's position) loses its voice and keeps playing virtually, without a source, until a voice frees up. Positional sounds that move out of earshot are virtualized the same way.
 	*/
 	class _PolyExport SoundManager {
 	public:
@@ -41,15 +60,92 @@ namespace Polycode {
 		void setListenerOrientation(Vector3 orientation);	
 		void initAL();
 		
+		/**
+		* Reopens OpenAL on a named device and rebuilds the voice pool. Buffers and sources belong to the device they were created on, so this fails while any sound is loaded. Call it before loading sounds. Useful for running on OpenAL Soft's "No Output" device when there is no sound card.
+		* @param deviceName Name of the device to open. An empty string opens the default device.
+		* @return True if the device was opened, false if it could not be opened or sounds are still loaded.
+		*/
+		bool openDevice(const String& deviceName);
+		
 		/**
 		* Sets the global sound volume.
 		*/ 
 		void setGlobalVolume(Number globalVolume);
 		
+		/**
+		* Updates voice assignment. Called every frame by CoreServices.
+		* @param elapsed Milliseconds since the last update.
+		*/
+		void Update(int elapsed);
+		
+		/**
+		* Returns the cached sample for a file and adds a reference to it, or NULL if the file has not been loaded yet.
+		*/
+		SoundSample *getSample(const String& fileName);
+		
+		/**
+		* Adds a decoded buffer to the cache with one reference. Samples with an empty file name are not shared.
+		*/
+		SoundSample *addSample(const String& fileName, ALuint buffer, int sampleLength);
+		
+		/**
+		* Releases a reference to a sample. The buffer is deleted when the last reference is released.
+		*/
+		void releaseSample(SoundSample *sample);
+		
+		/**
+		* Called by streamed sounds when they are created and destroyed, so the manager knows whether the device is in use.
+		*/
+		void registerStream();
+		void unregisterStream();
+		
+		/**
+		* Starts or restarts a sound, giving it a voice if one is available.
+		*/
+		void playSound(Sound *sound);
+		
+		/**
+		* Stops a sound and frees its voice.
+		*/
+		void stopSound(Sound *sound);
+		
+		/**
+		* Sets the number of voices in the pool. Takes effect the next time a device is opened. Defaults to 32.
+		*/
+		void setMaxVoices(unsigned int maxVoices);
+		
+		unsigned int getNumVoices() const;
+		unsigned int getNumFreeVoices() const;
+		unsigned int getNumPlayingSounds() const;
+		unsigned int getNumVirtualSounds() const;
+		unsigned int getNumCachedSamples() const;
+		
+		/**
+		* Returns the listener position last set with setListenerPosition().
+		*/
+		Vector3 getListenerPosition() const;
 		
 	protected:
 		
+		void closeDevice();
+		void createVoices();
+		
+		bool assignVoice(Sound *sound);
+		void freeVoice(Sound *sound);
+		void virtualizeSound(Sound *sound);
+		void removePlayingSound(Sound *sound);
+		
 		ALCdevice* device;
-		ALCcontext* context;		
+		ALCcontext* context;
+		
+		Vector3 listenerPosition;
+		unsigned int maxVoices;
+		
+		std::vector<ALuint> voices;
+		std::vector<ALuint> freeVoices;
+		std::vector<Sound*> playingSounds;
+		std::map<std::string, SoundSample*> samples;
+		unsigned int numSamples;
+		unsigned int numStreams;
 	};
 }
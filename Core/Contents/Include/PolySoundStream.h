@@ -0,0 +1,196 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+ 
+
+#pragma once
+#include "PolyGlobals.h"
+#include "PolyString.h"
+#include "PolyThreaded.h"
+
+#include "al.h"
+#include "alc.h"
+#include <vorbis/vorbisfile.h>
+
+class OSFILE;
+
+namespace Polycode {
+
+	class CoreMutex;
+	
+	/**
+	* Decodes a sound file in small chunks for streaming playback.
+	*/
+	class _PolyExport SoundStreamDecoder {
+		public:
+			SoundStreamDecoder();
+			virtual ~SoundStreamDecoder() {}
+			
+			/**
+			* Opens the file and reads its header. Returns false if the file can not be decoded.
+			*/
+			virtual bool open(const String& fileName) = 0;
+			
+			/**
+			* Decodes up to size bytes of 16 or 8 bit PCM data into buffer.
+			* @return Number of bytes decoded. Returns 0 at the end of the stream.
+			*/
+			virtual long read(char *buffer, long size) = 0;
+			
+			/**
+			* Seeks to a time in seconds.
+			*/
+			virtual bool seek(Number time) = 0;
+			
+			/**
+			* Returns the length of the stream in samples per channel, or -1 if it is not known.
+			*/
+			virtual long getSampleLength() = 0;
+			
+			/**
+			* Returns the OpenAL buffer format of the decoded data.
+			*/
+			ALenum getFormat() const;
+			
+			Number getDuration();
+			
+			int channels;
+			int frequency;
+			int bitsPerSample;
+	};
+	
+	/**
+	* Streams Ogg Vorbis files.
+	*/
+	class _PolyExport OGGSoundStreamDecoder : public SoundStreamDecoder {
+		public:
+			OGGSoundStreamDecoder();
+			virtual ~OGGSoundStreamDecoder();
+			
+			bool open(const String& fileName);
+			long read(char *buffer, long size);
+			bool seek(Number time);
+			long getSampleLength();
+			
+		protected:
+			OggVorbis_File oggFile;
+			bool fileOpen;
+	};
+	
+	/**
+	* Streams PCM WAV files.
+	*/
+	class _PolyExport WAVSoundStreamDecoder : public SoundStreamDecoder {
+		public:
+			WAVSoundStreamDecoder();
+			virtual ~WAVSoundStreamDecoder();
+			
+			bool open(const String& fileName);
+			long read(char *buffer, long size);
+			bool seek(Number time);
+			long getSampleLength();
+			
+		protected:
+			OSFILE *file;
+			long dataStart;
+			long dataSize;
+			long dataPosition;
+			int blockAlign;
+	};
+	
+	/**
+	* Plays a long sound file through a source without loading it into memory. A background thread decodes the file into a small ring of OpenAL buffers queued on the source and refills them as they finish playing, so memory use stays constant regardless of the length of the file. Used by Sound when it is created as streamed.
+	*/
+	class _PolyExport SoundStream : public Threaded {
+		public:
+			/**
+			* Constructor.
+			* @param fileName Path to an OGG or WAV file.
+			* @param source OpenAL source to queue buffers on. The source is not deleted by the stream.
+			*/
+			SoundStream(const String& fileName, ALuint source);
+			virtual ~SoundStream();
+			
+			/**
+			* Returns true if the file was opened and can be played.
+			*/
+			bool isValid() const;
+			
+			/**
+			* Starts playback. The first buffer is decoded before this returns, the rest are decoded by the streaming thread.
+			*/
+			void Play(bool loop);
+			void Stop();
+			bool isPlaying();
+			
+			void seekTo(Number time);
+			Number getPlaybackTime();
+			Number getPlaybackDuration();
+			
+			void setOffset(int off);
+			int getOffset();
+			int getSampleLength();
+			
+			/**
+			* Refills finished buffers. Called by the streaming thread.
+			*/
+			void update();
+			
+			void runThread();
+			void updateThread();
+			
+			/**
+			* Number of buffers in the ring.
+			*/
+			static const int NUM_BUFFERS = 4;
+			
+			/**
+			* Size of each buffer in bytes.
+			*/
+			static const int STREAM_BUFFER_SIZE = 32768;
+			
+		protected:
+		
+			bool fillBuffer(int index);
+			void queueFreeBuffers();
+			void clearQueue();
+			void startQueue(Number time);
+			
+			SoundStreamDecoder *decoder;
+			CoreMutex *streamMutex;
+			
+			ALuint source;
+			ALuint buffers[NUM_BUFFERS];
+			Number bufferDurations[NUM_BUFFERS];
+			bool bufferQueued[NUM_BUFFERS];
+			
+			char *decodeBuffer;
+			
+			Number playbackStart;
+			Number startOffset;
+			bool looping;
+			bool playing;
+			bool endOfStream;
+			
+			bool valid;
+			volatile bool threadFinished;
+	};
+}
@@ -0,0 +1,127 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+ 
+
+#pragma once
+#include "PolyGlobals.h"
+#include "PolyString.h"
+#include "PolyRectPacker.h"
+#include <map>
+#include <string>
+#include <vector>
+
+namespace Polycode {
+
+	class Image;
+	class Texture;
+
+	/**
+	* A packed image inside a TextureAtlas page.
+	*/
+	class _PolyExport TextureAtlasRegion {
+		public:
+			/**
+			* Index of the page the image was packed into.
+			*/
+			unsigned int page;
+			
+			/**
+			* Position and size of the image in the page, in pixels.
+			*/
+			unsigned int x;
+			unsigned int y;
+			unsigned int width;
+			unsigned int height;
+			
+			/**
+			* Texture coordinates of the image's corners in the page texture.
+			*/
+			Number left;
+			Number top;
+			Number right;
+			Number bottom;
+	};
+
+	/**
+	* Packs many small images into a few large textures at runtime. Screen entities that use regions of the same page share a texture, which lets the ScreenSpriteBatch draw them together. Images are padded by repeating their edge pixels so filtering doesn't bleed neighbouring images in.
+	*/
+	class _PolyExport TextureAtlas {
+		public:
+			/**
+			* Constructor.
+			* @param pageSize Width and height of each page texture.
+			* @param padding Number of pixels added around each image.
+			*/
+			TextureAtlas(unsigned int pageSize = 1024, unsigned int padding = 1);
+			virtual ~TextureAtlas();
+			
+			/**
+			* Packs an image into the atlas. A new page is started if the image does not fit in the existing ones.
+			* @param name Name to look the region up by.
+			* @param image Image to pack. Must be IMAGE_RGB or IMAGE_RGBA.
+			* @return The packed region or NULL if the image is larger than a page.
+			*/
+			TextureAtlasRegion *addImage(const String& name, Image *image);
+			
+			/**
+			* Loads an image file and packs it into the atlas, using the file name as the region name. If the file was already added, the existing region is returned.
+			*/
+			TextureAtlasRegion *addImageFromFile(const String& fileName);
+			
+			/**
+			* Returns a region by name or NULL if there isn't one.
+			*/
+			TextureAtlasRegion *getRegion(const String& name);
+			
+			/**
+			* Returns the texture for a page. Only the part of the page covering images packed since the last call is uploaded.
+			*/
+			Texture *getPageTexture(unsigned int page);
+			
+			unsigned int getNumPages() const;
+			unsigned int getPageSize() const;
+			
+		protected:
+		
+			class AtlasPage {
+				public:
+					Image *image;
+					Texture *texture;
+					RectPacker *packer;
+					bool dirty;
+					
+					// bounds of everything packed since the last upload
+					unsigned int dirtyMinX;
+					unsigned int dirtyMinY;
+					unsigned int dirtyMaxX;
+					unsigned int dirtyMaxY;
+			};
+			
+			void copyImage(Image *image, const PackedRect &rect, AtlasPage *page);
+			
+			std::vector<AtlasPage> pages;
+			std::map<std::string, TextureAtlasRegion*> regions;
+			
+			unsigned int pageSize;
+			unsigned int padding;
+	};
+}
@@ -0,0 +1,151 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+ 
+
+#pragma once
+#include "PolyGlobals.h"
+#include "PolyString.h"
+#include <vector>
+
+namespace Polycode {
+
+	class Image;
+
+	/**
+	* A single mip level of a TextureContainer.
+	*/
+	class _PolyExport TextureLevel {
+		public:
+			unsigned int width;
+			unsigned int height;
+			unsigned int dataSize;
+			char *data;
+	};
+
+	/**
+	* Baked texture data. A texture container holds a complete mip chain, either as raw RGB/RGBA pixels or as S3TC (DXT1/DXT5) compressed blocks, so textures can be uploaded level by level without any processing at load time. Containers are saved as .ptex files, which can be baked from PNGs with the polytexture tool and loaded with MaterialManager::createTextureFromFile.
+	*/
+	class _PolyExport TextureContainer {
+		public:
+			TextureContainer();
+			virtual ~TextureContainer();
+			
+			/**
+			* Builds the container from an image.
+			* @param image Source image. Must be IMAGE_RGB or IMAGE_RGBA.
+			* @param format Format to store the levels in.
+			* @param createMipmaps If true, a full mip chain down to 1x1 is generated with a box filter.
+			* @return True if successful.
+			*/
+			bool createFromImage(Image *image, int format, bool createMipmaps);
+			
+			/**
+			* Loads a .ptex file. The header and every level are checked against each other, so a truncated or malformed file is rejected instead of being uploaded.
+			* @return True if successful.
+			*/
+			bool loadFromFile(const String& fileName);
+			
+			/**
+			* Saves the container to a .ptex file.
+			* @return True if successful.
+			*/
+			bool saveToFile(const String& fileName);
+			
+			/**
+			* Decodes a level back into an image on the CPU. Compressed levels are decompressed to RGBA. The caller owns the returned image.
+			*/
+			Image *decodeLevel(unsigned int level) const;
+			
+			unsigned int getWidth() const;
+			unsigned int getHeight() const;
+			int getFormat() const;
+			
+			/**
+			* Returns true if the levels are S3TC compressed.
+			*/
+			bool isCompressed() const;
+			
+			unsigned int getNumLevels() const;
+			const TextureLevel& getLevel(unsigned int index) const;
+			
+			/**
+			* Frees the pixel data of every level, keeping only the header. Used once the levels are uploaded to the GPU. If the container was loaded from a file, reloadLevelData() reads the levels back.
+			*/
+			void releaseLevelData();
+			
+			/**
+			* Reads the levels back from the file the container was loaded from, if they were released.
+			* @return True if the level data is available.
+			*/
+			bool reloadLevelData();
+			
+			/**
+			* Returns true if the levels' pixel data is in memory.
+			*/
+			bool hasLevelData() const;
+			
+			/**
+			* Returns the file the container was loaded from, or an empty string if it was created from an image.
+			*/
+			const String& getFileName() const;
+			
+			/**
+			* Returns the number of bytes a level of the given size takes in a format, or 0 if the format is unknown.
+			*/
+			static unsigned int getLevelDataSize(int format, unsigned int width, unsigned int height);
+			
+			/**
+			* Returns a half size copy of an image, averaging 2x2 pixel blocks. Used to build mip chains.
+			*/
+			static Image *createMipLevel(Image *source);
+			
+			/**
+			* Returns the format constant for a name ("rgba", "rgb", "dxt1" or "dxt5"), or -1 if the name is unknown.
+			*/
+			static int formatFromName(const String& name);
+			
+			static const int FORMAT_RGBA = 0;
+			static const int FORMAT_RGB = 1;
+			static const int FORMAT_DXT1 = 2;
+			static const int FORMAT_DXT5 = 3;
+			
+			/**
+			* Largest width or height accepted when loading a container.
+			*/
+			static const unsigned int MAX_SIZE = 16384;
+			
+		protected:
+		
+			void clear();
+			void addLevel(Image *image);
+			
+			static void compressBlock(const unsigned char *rgba, bool compressAlpha, unsigned char *block);
+			static void decompressBlock(const unsigned char *block, bool hasAlpha, unsigned char *rgba);
+			
+			unsigned int width;
+			unsigned int height;
+			int format;
+			std::vector<TextureLevel> levels;
+			String fileName;
+			bool levelDataReleased;
+	};
+}
@@ -29,6 +29,7 @@
 #include "PolyLogger.h"
 #include "PolyConfig.h"
 #include "PolyPerlin.h"
+#include "PolyDistanceField.h"
 #include "PolyEntity.h"
 #include "PolyPolygon.h"
 #include "PolyEvent.h"
@@ -38,7 +39,9 @@
 #include "PolyTween.h"
 #include "PolyTweenManager.h"
 #include "PolyResourceManager.h"
+#include "PolyMappedArchive.h"
 #include "PolyCore.h"
+#include "PolyHeadlessCore.h"
 #include "PolyCoreInput.h"
 #include "PolyInputKeys.h"
 #include "PolyInputEvent.h"
@@ -46,7 +49,9 @@
 #include "PolyBezierCurve.h"
 #include "PolyQuaternionCurve.h"
 #include "PolyRectangle.h"
+#include "PolyRectPacker.h"
 #include "PolyRenderer.h"
+#include "PolyNullRenderer.h"
 #include "PolyCoreServices.h"
 #include "PolyScreen.h"
 #include "PolyScreenEntity.h"
@@ -57,11 +62,16 @@
 #include "PolyLabel.h"
 #include "PolyFont.h"
 #include "PolyFontManager.h"
+#include "PolyGlyphCache.h"
 #include "PolyScreenImage.h"
 #include "PolyScreenSprite.h"
+#include "PolyScreenSpriteBatch.h"
+#include "PolyScreenSpatialHash.h"
 #include "PolyScreenLabel.h"
 #include "PolyScreenCurve.h"
 #include "PolyTexture.h"
+#include "PolyTextureAtlas.h"
+#include "PolyTextureContainer.h"
 #include "PolyMaterial.h"
 #include "PolyMesh.h"
 #include "PolyShader.h"
@@ -74,6 +84,8 @@
 #include "PolySceneMesh.h"
 #include "PolySceneLine.h"
 #include "PolySceneLight.h"
+#include "PolyShadowMapAtlas.h"
+#include "PolyAnimationClip.h"
 #include "PolySkeleton.h"
 #include "PolyBone.h"
 #include "PolyScenePrimitive.h"
@@ -86,6 +98,7 @@
 #include "PolyThreaded.h"
 #include "PolySound.h"
 #include "PolySoundManager.h"
+#include "PolySoundStream.h"
 #include "PolySceneSound.h"
 #include "PolyScreenSound.h"
 #ifdef _WINDOWS
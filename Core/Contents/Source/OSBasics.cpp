@@ -21,21 +21,32 @@
 */
 
 #include "OSBasics.h"
+#include "PolyMappedArchive.h"
 #ifdef _WINDOWS
 	#include <windows.h>
 #else
 	#include <dirent.h>
 	#include <sys/types.h>
 	#include <sys/stat.h>
+	#include <sys/mman.h>
+	#include <fcntl.h>
+	#include <unistd.h>
 #endif
 
 #include <vector>
 #include <string>
+#include <string.h>
+#include <stdlib.h>
 #include "physfs.h"
+#include "zlib.h"
 
 using namespace std;
 using namespace Polycode;
 
+static vector<MappedArchive*> mappedArchives;
+
+size_t OSBasics::defaultBufferSize = 16384;
+
 
 #ifdef _WINDOWS
 
@@ -75,6 +86,12 @@ OSFileEntry::OSFileEntry(const String& path, const String& name, int type) {
 	}
 }
 
+OSFileView::OSFileView() : data(NULL), size(0), buffer(NULL), mapping(NULL), mappingSize(0), mappingHandle(NULL) {
+}
+
+OSFILE::OSFILE() : fileType(TYPE_FILE), file(NULL), physFSFile(NULL), view(NULL), viewOffset(0), buffer(NULL), bufferSize(0), bufferPosition(0), bufferLength(0), bufferMode(BUFFER_NONE) {
+}
+
 void OSFILE::debugDump() {
 	long tellval = OSBasics::tell(this);
 	OSBasics::seek(this, 0, SEEK_SET);
@@ -89,6 +106,18 @@ void OSFILE::debugDump() {
 
 OSFILE *OSBasics::open(const String& filename, const String& opts) {
 	OSFILE *retFile = NULL;
+	
+	if(opts.find("w") == string::npos && opts.find("a") == string::npos && opts.find("+") == string::npos) {
+		OSFileView *view = openArchiveView(filename);
+		if(view) {
+			retFile = new OSFILE;
+			retFile->fileType = OSFILE::TYPE_VIEW_FILE;
+			retFile->view = view;
+			retFile->viewOffset = 0;
+			return retFile;
+		}
+	}
+	
 	if(PHYSFS_exists(filename.c_str())) {
 		if(!PHYSFS_isDirectory(filename.c_str())) {
 			retFile = new OSFILE;
@@ -112,6 +141,7 @@ OSFILE *OSBasics::open(const String& filename, const String& opts) {
 					return NULL;		
 				}
 			}
+			retFile->bufferSize = defaultBufferSize;
 			return retFile;
 		}
 	} else {
@@ -123,6 +153,7 @@ OSFILE *OSBasics::open(const String& filename, const String& opts) {
 		retFile = new OSFILE;
 		retFile->fileType = OSFILE::TYPE_FILE;
 		retFile->file = file;		
+		retFile->bufferSize = defaultBufferSize;
 		return retFile;
 	}
 	
@@ -131,19 +162,32 @@ OSFILE *OSBasics::open(const String& filename, const String& opts) {
 
 int OSBasics::close(OSFILE *file) {
 	int result = 0;
+	if(file->bufferMode == OSFILE::BUFFER_WRITE) {
+		result = flush(file);
+	}
+	// unread read-ahead is dropped, seeking back would make PhysFS inflate compressed entries again
+	free(file->buffer);
 	switch(file->fileType) {
 		case OSFILE::TYPE_FILE:
-			result = fclose(file->file);
+			if(fclose(file->file) != 0) {
+				result = EOF;
+			}
 			break;
 		case OSFILE::TYPE_ARCHIVE_FILE:
-			result = PHYSFS_close(file->physFSFile);
+			// PHYSFS_close returns zero on failure
+			if(PHYSFS_close(file->physFSFile) == 0) {
+				result = EOF;
+			}
 			break;			
+		case OSFILE::TYPE_VIEW_FILE:
+			closeView(file->view);
+			break;
 	}
 	delete file;
 	return result;
 }
 
-long OSBasics::tell(OSFILE * stream) {
+long OSBasics::rawTell(OSFILE * stream) {
 	switch(stream->fileType) {
 		case OSFILE::TYPE_FILE:
 			return ftell(stream->file);
@@ -151,35 +195,55 @@ long OSBasics::tell(OSFILE * stream) {
 		case OSFILE::TYPE_ARCHIVE_FILE:
 			return PHYSFS_tell(stream->physFSFile);
 			break;			
+		case OSFILE::TYPE_VIEW_FILE:
+			return stream->viewOffset;
+			break;
 	}
 	return 0;
 }
 
-size_t OSBasics::read( void * ptr, size_t size, size_t count, OSFILE * stream ) {
+size_t OSBasics::rawRead( void * ptr, size_t size, size_t count, OSFILE * stream ) {
 	switch(stream->fileType) {
 		case OSFILE::TYPE_FILE:
 			return fread(ptr, size, count, stream->file);
 		break;
-		case OSFILE::TYPE_ARCHIVE_FILE:
-			return PHYSFS_read(stream->physFSFile, ptr, size, count);
+		case OSFILE::TYPE_ARCHIVE_FILE: {
+			PHYSFS_sint64 itemsRead = PHYSFS_read(stream->physFSFile, ptr, size, count);
+			return itemsRead > 0 ? itemsRead : 0;
+		}
 		break;			
+		case OSFILE::TYPE_VIEW_FILE: {
+			if(size == 0) {
+				return 0;
+			}
+			size_t available = (stream->view->size - stream->viewOffset) / size;
+			if(count > available) {
+				count = available;
+			}
+			memcpy(ptr, stream->view->data + stream->viewOffset, size * count);
+			stream->viewOffset += size * count;
+			return count;
+		}
+		break;
 	}
 	return 0;
 }
 
-size_t OSBasics::write( const void * ptr, size_t size, size_t count, OSFILE * stream ) {
+size_t OSBasics::rawWrite( const void * ptr, size_t size, size_t count, OSFILE * stream ) {
 	switch(stream->fileType) {
 		case OSFILE::TYPE_FILE:
-			fwrite(ptr, size, count, stream->file);
+			return fwrite(ptr, size, count, stream->file);
 			break;
-		case OSFILE::TYPE_ARCHIVE_FILE:
-			PHYSFS_write(stream->physFSFile, ptr, size, count);
+		case OSFILE::TYPE_ARCHIVE_FILE: {
+			PHYSFS_sint64 written = PHYSFS_write(stream->physFSFile, ptr, size, count);
+			return written > 0 ? written : 0;
+		}
 		break;			
 	}
 	return 0;
 }
 
-int OSBasics::seek(OSFILE * stream, long int offset, int origin ) {
+int OSBasics::rawSeek(OSFILE * stream, long int offset, int origin ) {
 	switch(stream->fileType) {
 		case OSFILE::TYPE_FILE:
 			return fseek(stream->file, offset, origin);
@@ -201,10 +265,398 @@ int OSBasics::seek(OSFILE * stream, long int offset, int origin ) {
 				break;
 			}
 			break;			
+		case OSFILE::TYPE_VIEW_FILE: {
+			long base = 0;
+			switch(origin) {
+				case SEEK_CUR:
+					base = stream->viewOffset;
+				break;
+				case SEEK_END:
+					base = stream->view->size;
+				break;
+			}
+			if(base + offset < 0 || base + offset > (long)stream->view->size) {
+				return -1;
+			}
+			stream->viewOffset = base + offset;
+		}
+		break;
 	}
 	return 0;	
 }
 
+// Reads and writes smaller than the buffer go through it, so loaders issuing thousands of 4 byte reads only hit stdio or PhysFS once per buffer. Views are already in memory and skip it.
+size_t OSBasics::read( void * ptr, size_t size, size_t count, OSFILE * stream ) {
+	if(stream->bufferSize == 0 || stream->fileType == OSFILE::TYPE_VIEW_FILE || size == 0) {
+		return rawRead(ptr, size, count, stream);
+	}
+	if(stream->bufferMode == OSFILE::BUFFER_WRITE) {
+		flush(stream);
+	}
+	
+	size_t total = size * count;
+	size_t available = stream->bufferLength - stream->bufferPosition;
+	if(total <= available) {
+		memcpy(ptr, stream->buffer + stream->bufferPosition, total);
+		stream->bufferPosition += total;
+		return count;
+	}
+	
+	char *output = (char*)ptr;
+	if(available > 0) {
+		memcpy(output, stream->buffer + stream->bufferPosition, available);
+	}
+	size_t copied = available;
+	stream->bufferPosition = 0;
+	stream->bufferLength = 0;
+	stream->bufferMode = OSFILE::BUFFER_NONE;
+	
+	if(total - copied >= stream->bufferSize) {
+		copied += rawRead(output + copied, 1, total - copied, stream);
+	} else {
+		if(!stream->buffer) {
+			stream->buffer = (char*)malloc(stream->bufferSize);
+		}
+		stream->bufferLength = rawRead(stream->buffer, 1, stream->bufferSize, stream);
+		stream->bufferMode = OSFILE::BUFFER_READ;
+		
+		size_t bytes = total - copied;
+		if(bytes > stream->bufferLength) {
+			bytes = stream->bufferLength;
+		}
+		memcpy(output + copied, stream->buffer, bytes);
+		stream->bufferPosition = bytes;
+		copied += bytes;
+	}
+	return copied / size;
+}
+
+size_t OSBasics::write( const void * ptr, size_t size, size_t count, OSFILE * stream ) {
+	if(stream->bufferSize == 0 || stream->fileType == OSFILE::TYPE_VIEW_FILE || size == 0) {
+		return rawWrite(ptr, size, count, stream);
+	}
+	if(stream->bufferMode == OSFILE::BUFFER_READ) {
+		flush(stream);
+	}
+	
+	size_t total = size * count;
+	if(stream->bufferLength + total > stream->bufferSize) {
+		if(flush(stream) != 0) {
+			return 0;
+		}
+		if(total >= stream->bufferSize) {
+			return rawWrite(ptr, size, count, stream);
+		}
+	}
+	if(!stream->buffer) {
+		stream->buffer = (char*)malloc(stream->bufferSize);
+	}
+	memcpy(stream->buffer + stream->bufferLength, ptr, total);
+	stream->bufferLength += total;
+	stream->bufferMode = OSFILE::BUFFER_WRITE;
+	return count;
+}
+
+int OSBasics::seek(OSFILE * stream, long int offset, int origin ) {
+	if(stream->bufferMode == OSFILE::BUFFER_READ) {
+		long unread = stream->bufferLength - stream->bufferPosition;
+		if(origin == SEEK_CUR) {
+			// short skips, like the ones in the WAV header, stay inside the buffer
+			if(offset >= -(long)stream->bufferPosition && offset <= unread) {
+				stream->bufferPosition += offset;
+				return 0;
+			}
+			offset -= unread;
+		}
+		stream->bufferPosition = 0;
+		stream->bufferLength = 0;
+		stream->bufferMode = OSFILE::BUFFER_NONE;
+	} else if(flush(stream) != 0) {
+		return -1;
+	}
+	return rawSeek(stream, offset, origin);
+}
+
+long OSBasics::tell(OSFILE * stream) {
+	long position = rawTell(stream);
+	switch(stream->bufferMode) {
+		case OSFILE::BUFFER_READ:
+			return position - (long)(stream->bufferLength - stream->bufferPosition);
+		break;
+		case OSFILE::BUFFER_WRITE:
+			return position + (long)stream->bufferLength;
+		break;
+	}
+	return position;
+}
+
+int OSBasics::flush(OSFILE * stream) {
+	int result = 0;
+	switch(stream->bufferMode) {
+		case OSFILE::BUFFER_WRITE:
+			if(rawWrite(stream->buffer, 1, stream->bufferLength, stream) != stream->bufferLength) {
+				result = EOF;
+			}
+		break;
+		case OSFILE::BUFFER_READ: {
+			// put the file back where the caller thinks it is
+			long unread = stream->bufferLength - stream->bufferPosition;
+			if(unread > 0) {
+				rawSeek(stream, -unread, SEEK_CUR);
+			}
+		}
+		break;
+	}
+	stream->bufferPosition = 0;
+	stream->bufferLength = 0;
+	stream->bufferMode = OSFILE::BUFFER_NONE;
+	return result;
+}
+
+void OSBasics::setBufferSize(OSFILE * stream, size_t size) {
+	flush(stream);
+	free(stream->buffer);
+	stream->buffer = NULL;
+	stream->bufferSize = size;
+}
+
+void OSBasics::setDefaultBufferSize(size_t size) {
+	defaultBufferSize = size;
+}
+
+size_t OSBasics::getDefaultBufferSize() {
+	return defaultBufferSize;
+}
+
+bool OSBasics::isBigEndian() {
+	const unsigned int one = 1;
+	return *((const unsigned char*)&one) == 0;
+}
+
+void OSBasics::swapEndian(void *data, size_t wordSize, size_t count) {
+	unsigned char *bytes = (unsigned char*)data;
+	for(size_t i=0; i < count; i++) {
+		for(size_t j=0; j < wordSize / 2; j++) {
+			unsigned char tmp = bytes[j];
+			bytes[j] = bytes[wordSize - 1 - j];
+			bytes[wordSize - 1 - j] = tmp;
+		}
+		bytes += wordSize;
+	}
+}
+
+size_t OSBasics::readLittleEndian(void * ptr, size_t wordSize, size_t count, OSFILE * stream) {
+	size_t wordsRead = read(ptr, wordSize, count, stream);
+	if(wordSize > 1 && isBigEndian()) {
+		swapEndian(ptr, wordSize, wordsRead);
+	}
+	return wordsRead;
+}
+
+size_t OSBasics::writeLittleEndian(const void * ptr, size_t wordSize, size_t count, OSFILE * stream) {
+	if(wordSize <= 1 || !isBigEndian()) {
+		return write(ptr, wordSize, count, stream);
+	}
+	// swap a chunk at a time so the caller's data is left alone
+	char swapped[1024];
+	size_t chunkWords = sizeof(swapped) / wordSize;
+	size_t written = 0;
+	const char *input = (const char*)ptr;
+	while(written < count) {
+		size_t words = count - written < chunkWords ? count - written : chunkWords;
+		memcpy(swapped, input + written * wordSize, words * wordSize);
+		swapEndian(swapped, wordSize, words);
+		size_t result = write(swapped, wordSize, words, stream);
+		written += result;
+		if(result != words) {
+			break;
+		}
+	}
+	return written;
+}
+
+bool OSBasics::addMappedArchive(const String& archivePath) {
+	for(int i=0; i < mappedArchives.size(); i++) {
+		if(mappedArchives[i]->getFileName() == archivePath) {
+			return true;
+		}
+	}
+	MappedArchive *archive = MappedArchive::open(archivePath);
+	if(!archive) {
+		return false;
+	}
+	mappedArchives.push_back(archive);
+	return true;
+}
+
+OSFileView *OSBasics::openArchiveView(const String& filename) {
+	if(mappedArchives.size() == 0) {
+		return NULL;
+	}
+	
+	// only take the file from an index if PhysFS would have found it in that archive, so search order stays PhysFS's
+	const char *realDir = PHYSFS_getRealDir(filename.c_str());
+	if(!realDir) {
+		return NULL;
+	}
+	MappedArchiveEntry entry;
+	MappedArchive *archive = NULL;
+	for(int i=0; i < mappedArchives.size(); i++) {
+		if(mappedArchives[i]->getFileName() == realDir) {
+			if(mappedArchives[i]->findEntry(filename, &entry)) {
+				archive = mappedArchives[i];
+			}
+			break;
+		}
+	}
+	if(!archive) {
+		return NULL;
+	}
+	
+	OSFileView *view = new OSFileView();
+	const char *entryData = archive->getEntryData(entry);
+	
+	if(entry.method == MappedArchive::METHOD_STORED) {
+		view->data = entryData;
+		view->size = entry.size;
+		return view;
+	}
+	
+	view->buffer = (char*)malloc(entry.size > 0 ? entry.size : 1);
+	
+	z_stream stream;
+	memset(&stream, 0, sizeof(z_stream));
+	inflateInit2(&stream, -MAX_WBITS);
+	stream.next_in = (Bytef*)entryData;
+	stream.avail_in = entry.compressedSize;
+	stream.next_out = (Bytef*)view->buffer;
+	stream.avail_out = entry.size;
+	int result = inflate(&stream, Z_FINISH);
+	inflateEnd(&stream);
+	
+	if(result != Z_STREAM_END || stream.total_out != entry.size) {
+		printf("Error inflating file from archive (%s)\n", filename.c_str());
+		closeView(view);
+		return NULL;
+	}
+	
+	view->data = view->buffer;
+	view->size = entry.size;
+	return view;
+}
+
+OSFileView *OSBasics::openView(const String& filename) {
+	OSFileView *view = openArchiveView(filename);
+	if(view) {
+		return view;
+	}
+	
+	if(PHYSFS_exists(filename.c_str())) {
+		if(PHYSFS_isDirectory(filename.c_str())) {
+			return NULL;
+		}
+		PHYSFS_File *file = PHYSFS_openRead(filename.c_str());
+		if(!file) {
+			return NULL;
+		}
+		view = new OSFileView();
+		view->size = PHYSFS_fileLength(file);
+		view->buffer = (char*)malloc(view->size > 0 ? view->size : 1);
+		PHYSFS_read(file, view->buffer, 1, view->size);
+		PHYSFS_close(file);
+		view->data = view->buffer;
+		return view;
+	}
+	
+	view = new OSFileView();
+	view->mapping = mapFile(filename, &view->mappingSize, &view->mappingHandle);
+	if(view->mapping) {
+		view->data = view->mapping;
+		view->size = view->mappingSize;
+		return view;
+	}
+	
+	// empty files and files that can't be mapped are read normally
+	FILE *file = fopen(filename.c_str(), "rb");
+	if(!file) {
+		delete view;
+		return NULL;
+	}
+	fseek(file, 0, SEEK_END);
+	view->size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	view->buffer = (char*)malloc(view->size > 0 ? view->size : 1);
+	view->size = fread(view->buffer, 1, view->size, file);
+	fclose(file);
+	view->data = view->buffer;
+	return view;
+}
+
+void OSBasics::closeView(OSFileView *view) {
+	if(!view) {
+		return;
+	}
+	if(view->mapping) {
+		unmapFile(view->mapping, view->mappingSize, view->mappingHandle);
+	}
+	free(view->buffer);
+	delete view;
+}
+
+char *OSBasics::mapFile(const String& filename, size_t *size, void **handle) {
+#ifdef _WINDOWS
+	HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if(file == INVALID_HANDLE_VALUE) {
+		return NULL;
+	}
+	LARGE_INTEGER fileSize;
+	if(!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+		CloseHandle(file);
+		return NULL;
+	}
+	HANDLE mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(file);
+	if(!mapping) {
+		return NULL;
+	}
+	void *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if(!data) {
+		CloseHandle(mapping);
+		return NULL;
+	}
+	*size = (size_t)fileSize.QuadPart;
+	*handle = mapping;
+	return (char*)data;
+#else
+	int fd = ::open(filename.c_str(), O_RDONLY);
+	if(fd < 0) {
+		return NULL;
+	}
+	struct stat fileStat;
+	if(fstat(fd, &fileStat) != 0 || !S_ISREG(fileStat.st_mode) || fileStat.st_size == 0) {
+		::close(fd);
+		return NULL;
+	}
+	void *data = mmap(NULL, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if(data == MAP_FAILED) {
+		return NULL;
+	}
+	*size = fileStat.st_size;
+	*handle = NULL;
+	return (char*)data;
+#endif
+}
+
+void OSBasics::unmapFile(char *data, size_t size, void *handle) {
+#ifdef _WINDOWS
+	UnmapViewOfFile(data);
+	CloseHandle((HANDLE)handle);
+#else
+	munmap(data, size);
+#endif
+}
+
 vector<OSFileEntry> OSBasics::parsePhysFSFolder(const String& pathString, bool showHidden) {
 	vector<OSFileEntry> returnVector;
 	
@@ -0,0 +1,224 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+ 
+
+#include "PolyAnimationClip.h"
+#include <math.h>
+
+using namespace Polycode;
+
+BonePose::BonePose() : scale(1,1,1) {
+}
+
+BonePose::BonePose(const Vector3 &position, const Quaternion &rotation, const Vector3 &scale) : position(position), rotation(rotation), scale(scale) {
+}
+
+AnimationClipTrack::AnimationClipTrack() : boneIndex(0) {
+}
+
+static Quaternion nlerpQuaternion(const Quaternion &from, Quaternion to, Number t) {
+	// take the shortest path, q and -q are the same rotation
+	if(from.Dot(to) < 0.0) {
+		to = -to;
+	}
+	Quaternion result(from.w + (to.w - from.w) * t, from.x + (to.x - from.x) * t, from.y + (to.y - from.y) * t, from.z + (to.z - from.z) * t);
+	Number length = sqrt(result.Norm());
+	if(length > 0.0) {
+		result = result * (1.0 / length);
+	}
+	return result;
+}
+
+AnimationClip::AnimationClip(const String& name, Number duration, Number sampleRate) {
+	this->name = name;
+	this->duration = duration;
+	this->sampleRate = sampleRate;
+	
+	numSamples = 1;
+	if(duration > 0.0 && sampleRate > 0.0) {
+		numSamples = ((unsigned int)ceil(duration * sampleRate)) + 1;
+	}
+}
+
+AnimationClip::~AnimationClip() {
+}
+
+void AnimationClip::addTrack(unsigned int boneIndex, const std::vector<Vector3> &positions, const std::vector<Quaternion> &rotations) {
+	AnimationClipTrack track;
+	track.boneIndex = boneIndex;
+	if(positions.size() < numSamples || rotations.size() < numSamples) {
+		return;
+	}
+	
+	Vector3 positionMax = positions[0];
+	track.positionMin = positions[0];
+	for(int i=1; i < numSamples; i++) {
+		track.positionMin.x = positions[i].x < track.positionMin.x ? positions[i].x : track.positionMin.x;
+		track.positionMin.y = positions[i].y < track.positionMin.y ? positions[i].y : track.positionMin.y;
+		track.positionMin.z = positions[i].z < track.positionMin.z ? positions[i].z : track.positionMin.z;
+		positionMax.x = positions[i].x > positionMax.x ? positions[i].x : positionMax.x;
+		positionMax.y = positions[i].y > positionMax.y ? positions[i].y : positionMax.y;
+		positionMax.z = positions[i].z > positionMax.z ? positions[i].z : positionMax.z;
+	}
+	track.positionStep = (positionMax - track.positionMin) / 65535.0;
+	
+	track.positions.resize(numSamples * 3);
+	track.rotations.resize(numSamples * 4);
+	for(int i=0; i < numSamples; i++) {
+		Vector3 offset = positions[i] - track.positionMin;
+		track.positions[i*3] = track.positionStep.x > 0.0 ? (unsigned short)(offset.x / track.positionStep.x + 0.5) : 0;
+		track.positions[i*3+1] = track.positionStep.y > 0.0 ? (unsigned short)(offset.y / track.positionStep.y + 0.5) : 0;
+		track.positions[i*3+2] = track.positionStep.z > 0.0 ? (unsigned short)(offset.z / track.positionStep.z + 0.5) : 0;
+		
+		Quaternion rotation = rotations[i];
+		Number length = sqrt(rotation.Norm());
+		if(length > 0.0) {
+			rotation = rotation * (1.0 / length);
+		}
+		track.rotations[i*4] = (short)floor(rotation.w * 32767.0 + 0.5);
+		track.rotations[i*4+1] = (short)floor(rotation.x * 32767.0 + 0.5);
+		track.rotations[i*4+2] = (short)floor(rotation.y * 32767.0 + 0.5);
+		track.rotations[i*4+3] = (short)floor(rotation.z * 32767.0 + 0.5);
+	}
+	
+	tracks.push_back(track);
+}
+
+void AnimationClip::getSamplePosition(Number time, bool loop, unsigned int *index, Number *fraction) const {
+	*index = 0;
+	*fraction = 0.0;
+	if(numSamples < 2) {
+		return;
+	}
+	
+	if(loop) {
+		time = fmod(time, duration);
+		if(time < 0.0) {
+			time += duration;
+		}
+	}
+	if(time <= 0.0) {
+		return;
+	}
+	if(time >= duration) {
+		*index = numSamples - 2;
+		*fraction = 1.0;
+		return;
+	}
+	
+	Number position = time / duration * ((Number)(numSamples - 1));
+	*index = (unsigned int)position;
+	if(*index > numSamples - 2) {
+		*index = numSamples - 2;
+	}
+	*fraction = position - ((Number)*index);
+}
+
+void AnimationClip::sampleTrackAt(const AnimationClipTrack &track, unsigned int index, Number fraction, BonePose *bonePose) const {
+	const unsigned short *p1 = &track.positions[index * 3];
+	const short *r1 = &track.rotations[index * 4];
+	
+	Vector3 position1(p1[0] * track.positionStep.x, p1[1] * track.positionStep.y, p1[2] * track.positionStep.z);
+	Quaternion rotation1(r1[0] / 32767.0, r1[1] / 32767.0, r1[2] / 32767.0, r1[3] / 32767.0);
+	
+	if(fraction <= 0.0) {
+		bonePose->position = track.positionMin + position1;
+		bonePose->rotation = rotation1;
+		return;
+	}
+	
+	const unsigned short *p2 = p1 + 3;
+	const short *r2 = r1 + 4;
+	Vector3 position2(p2[0] * track.positionStep.x, p2[1] * track.positionStep.y, p2[2] * track.positionStep.z);
+	Quaternion rotation2(r2[0] / 32767.0, r2[1] / 32767.0, r2[2] / 32767.0, r2[3] / 32767.0);
+	
+	bonePose->position = track.positionMin + position1 + (position2 - position1) * fraction;
+	bonePose->rotation = nlerpQuaternion(rotation1, rotation2, fraction);
+}
+
+void AnimationClip::sampleTrack(unsigned int trackIndex, Number time, bool loop, BonePose *bonePose) const {
+	unsigned int index;
+	Number fraction;
+	getSamplePosition(time, loop, &index, &fraction);
+	sampleTrackAt(tracks[trackIndex], index, fraction, bonePose);
+}
+
+void AnimationClip::samplePose(Number time, bool loop, std::vector<BonePose> &pose) const {
+	unsigned int index;
+	Number fraction;
+	getSamplePosition(time, loop, &index, &fraction);
+	
+	for(int i=0; i < tracks.size(); i++) {
+		if(tracks[i].boneIndex < pose.size()) {
+			sampleTrackAt(tracks[i], index, fraction, &pose[tracks[i].boneIndex]);
+		}
+	}
+}
+
+void AnimationClip::blendPose(Number time, bool loop, Number weight, std::vector<BonePose> &pose) const {
+	if(weight <= 0.0) {
+		return;
+	}
+	if(weight >= 1.0) {
+		samplePose(time, loop, pose);
+		return;
+	}
+	
+	unsigned int index;
+	Number fraction;
+	getSamplePosition(time, loop, &index, &fraction);
+	
+	BonePose sample;
+	for(int i=0; i < tracks.size(); i++) {
+		if(tracks[i].boneIndex >= pose.size()) {
+			continue;
+		}
+		sampleTrackAt(tracks[i], index, fraction, &sample);
+		BonePose &bonePose = pose[tracks[i].boneIndex];
+		bonePose.position = bonePose.position + (sample.position - bonePose.position) * weight;
+		bonePose.rotation = nlerpQuaternion(bonePose.rotation, sample.rotation, weight);
+	}
+}
+
+const String& AnimationClip::getName() const {
+	return name;
+}
+
+Number AnimationClip::getDuration() const {
+	return duration;
+}
+
+Number AnimationClip::getSampleRate() const {
+	return sampleRate;
+}
+
+unsigned int AnimationClip::getNumSamples() const {
+	return numSamples;
+}
+
+unsigned int AnimationClip::getNumTracks() const {
+	return tracks.size();
+}
+
+const AnimationClipTrack& AnimationClip::getTrack(unsigned int index) const {
+	return tracks[index];
+}
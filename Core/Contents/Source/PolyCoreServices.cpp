@@ -144,6 +144,8 @@ CoreServices::CoreServices() : EventDispatcher() {
 }
 
 CoreServices::~CoreServices() {
+	// the font manager's glyph atlas releases its textures through the material manager
+	delete fontManager;
 	delete materialManager;
 	delete screenManager;
 	delete sceneManager;
@@ -151,7 +153,6 @@ CoreServices::~CoreServices() {
 	delete tweenManager;
 	delete resourceManager;
 	delete soundManager;
-	delete fontManager;
 	instanceMap.clear();
 	overrideInstance = NULL;
 	
@@ -220,6 +221,7 @@ void CoreServices::Update(int elapsed) {
 	timerManager->Update();
 	tweenManager->Update();
 	materialManager->Update(elapsed);
+	soundManager->Update(elapsed);
 	renderer->setPerspectiveMode();
 	sceneManager->UpdateVirtual();
 	renderer->clearScreen();
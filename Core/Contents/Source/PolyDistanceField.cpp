@@ -0,0 +1,148 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+ 
+
+#include "PolyDistanceField.h"
+#include <math.h>
+#include <vector>
+
+using namespace Polycode;
+
+unsigned int DistanceField::getOutputSize(unsigned int sourceSize, unsigned int spread, unsigned int downsample) {
+	if(downsample == 0)
+		downsample = 1;
+	return (sourceSize + downsample - 1) / downsample + spread * 2;
+}
+
+// 8SSEDT: propagates the offset to the nearest seed pixel in two passes over the grid.
+void DistanceField::computeDistances(const unsigned char *seeds, int width, int height, Number *distances) {
+	const int far = 1 << 14;
+	std::vector<int> offsetX(width * height);
+	std::vector<int> offsetY(width * height);
+	for(int i=0; i < width * height; i++) {
+		offsetX[i] = seeds[i] ? 0 : far;
+		offsetY[i] = seeds[i] ? 0 : far;
+	}
+	
+	#define COMPARE_OFFSET(x, y, dx, dy) { \
+		int nx = x + dx; \
+		int ny = y + dy; \
+		if(nx >= 0 && ny >= 0 && nx < width && ny < height) { \
+			int p = y * width + x; \
+			int n = ny * width + nx; \
+			int cx = offsetX[n] + dx; \
+			int cy = offsetY[n] + dy; \
+			if(cx * cx + cy * cy < offsetX[p] * offsetX[p] + offsetY[p] * offsetY[p]) { \
+				offsetX[p] = cx; \
+				offsetY[p] = cy; \
+			} \
+		} \
+	}
+	
+	for(int y=0; y < height; y++) {
+		for(int x=0; x < width; x++) {
+			COMPARE_OFFSET(x, y, -1, 0);
+			COMPARE_OFFSET(x, y, 0, -1);
+			COMPARE_OFFSET(x, y, -1, -1);
+			COMPARE_OFFSET(x, y, 1, -1);
+		}
+		for(int x=width-1; x >= 0; x--) {
+			COMPARE_OFFSET(x, y, 1, 0);
+		}
+	}
+	
+	for(int y=height-1; y >= 0; y--) {
+		for(int x=width-1; x >= 0; x--) {
+			COMPARE_OFFSET(x, y, 1, 0);
+			COMPARE_OFFSET(x, y, 0, 1);
+			COMPARE_OFFSET(x, y, -1, 1);
+			COMPARE_OFFSET(x, y, 1, 1);
+		}
+		for(int x=0; x < width; x++) {
+			COMPARE_OFFSET(x, y, -1, 0);
+		}
+	}
+	
+	#undef COMPARE_OFFSET
+	
+	for(int i=0; i < width * height; i++) {
+		distances[i] = sqrt((Number)(offsetX[i] * offsetX[i] + offsetY[i] * offsetY[i]));
+	}
+}
+
+void DistanceField::generate(const unsigned char *coverage, unsigned int width, unsigned int height, unsigned int spread, unsigned int downsample, unsigned char *output) {
+	if(downsample == 0)
+		downsample = 1;
+	if(spread == 0)
+		spread = 1;
+	
+	unsigned int outputWidth = getOutputSize(width, spread, downsample);
+	unsigned int outputHeight = getOutputSize(height, spread, downsample);
+	
+	// the source is padded so that every output pixel maps to a full block of source pixels
+	int paddedWidth = outputWidth * downsample;
+	int paddedHeight = outputHeight * downsample;
+	int padding = spread * downsample;
+	
+	std::vector<unsigned char> inside(paddedWidth * paddedHeight, 0);
+	std::vector<unsigned char> outside(paddedWidth * paddedHeight, 1);
+	for(unsigned int y=0; y < height; y++) {
+		for(unsigned int x=0; x < width; x++) {
+			if(coverage[y * width + x] >= 128) {
+				int p = (y + padding) * paddedWidth + x + padding;
+				inside[p] = 1;
+				outside[p] = 0;
+			}
+		}
+	}
+	
+	std::vector<Number> distanceToInside(paddedWidth * paddedHeight);
+	std::vector<Number> distanceToOutside(paddedWidth * paddedHeight);
+	computeDistances(&inside[0], paddedWidth, paddedHeight, &distanceToInside[0]);
+	computeDistances(&outside[0], paddedWidth, paddedHeight, &distanceToOutside[0]);
+	
+	Number blockArea = (Number)(downsample * downsample);
+	for(unsigned int oy=0; oy < outputHeight; oy++) {
+		for(unsigned int ox=0; ox < outputWidth; ox++) {
+			// average the signed distance of the block, measuring from pixel edges rather than centers
+			Number sum = 0;
+			for(unsigned int by=0; by < downsample; by++) {
+				for(unsigned int bx=0; bx < downsample; bx++) {
+					int p = (oy * downsample + by) * paddedWidth + ox * downsample + bx;
+					if(inside[p]) {
+						sum += distanceToOutside[p] - 0.5;
+					} else {
+						sum -= distanceToInside[p] - 0.5;
+					}
+				}
+			}
+			Number distance = sum / blockArea / (Number)downsample;
+			
+			Number value = 128.0 + (distance / (Number)spread) * 127.0;
+			if(value < 0.0)
+				value = 0.0;
+			if(value > 255.0)
+				value = 255.0;
+			output[oy * outputWidth + ox] = (unsigned char)(value + 0.5);
+		}
+	}
+}
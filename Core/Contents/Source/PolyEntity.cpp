@@ -21,6 +21,7 @@
 */
 #include "PolyEntity.h"
 #include "PolyRenderer.h"
+#include "PolyScreenSpriteBatch.h"
 
 using namespace Polycode;
 
@@ -289,6 +290,11 @@ void Entity::clearMask() {
 void Entity::transformAndRender() {
 	if(!renderer || !enabled)
 		return;
+	
+	// masks rely on depth state that batched screen quads don't preserve
+	if(hasMask || depthOnly) {
+		ScreenSpriteBatch::flushCurrent();
+	}
 
 	if(depthOnly) {
 		renderer->drawToColorBuffer(false);
@@ -302,14 +308,21 @@ void Entity::transformAndRender() {
 		renderer->setDepthFunction(Renderer::DEPTH_FUNCTION_GREATER);
 	}
 	
+	ScreenSpriteBatch *spriteBatch = ScreenSpriteBatch::getCurrent();
+	
 	renderer->pushMatrix();
 	if(ignoreParentMatrix && parentEntity) {
 		renderer->multModelviewMatrix(parentEntity->getConcatenatedMatrix().inverse());
 		renderer->setCurrentModelMatrix(parentEntity->getConcatenatedMatrix().inverse());
+		if(spriteBatch)
+			spriteBatch->pushMatrix(parentEntity->getConcatenatedMatrix().inverse());
 	}else {
 		renderer->multModelviewMatrix(transformMatrix);
 		renderer->setCurrentModelMatrix(transformMatrix);
+		if(spriteBatch)
+			spriteBatch->pushMatrix(transformMatrix);
 	}
+	renderer->setCurrentObject(this);
 	renderer->setVertexColor(color.r,color.g,color.b,color.a);
 	if(billboardMode) {
 		renderer->billboardMatrixWithScale(getCompoundScale());
@@ -358,8 +371,11 @@ void Entity::transformAndRender() {
 				
 	renderer->setRenderMode(mode);	
 	renderer->popMatrix();
+	if(spriteBatch)
+		spriteBatch->popMatrix();
 	
 	if(hasMask) {
+		ScreenSpriteBatch::flushCurrent();
 		renderer->clearBuffer(false, true);
 	}
 	
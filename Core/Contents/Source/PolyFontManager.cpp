@@ -22,14 +22,23 @@
 
 #include "PolyFontManager.h"
 #include "PolyFont.h"
+#include "PolyGlyphCache.h"
+#include "PolyLabel.h"
+#include "PolyTextureAtlas.h"
 
 using namespace Polycode;
 
 FontManager::FontManager() {
-	
+	glyphAtlas = NULL;
 }
 
 FontManager::~FontManager() {
+	for(int i=0; i < glyphCaches.size(); i++) {
+		delete glyphCaches[i];
+	}
+	glyphCaches.clear();
+	delete glyphAtlas;
+	
 	for(int i=0; i < fonts.size(); i++) {
 		FontEntry entry = fonts[i];
 		delete entry.font;
@@ -63,3 +72,25 @@ Font *FontManager::getFontByName(const String& fontName) {
 	
 	return NULL;
 }
+
+TextureAtlas *FontManager::getGlyphAtlas() {
+	if(!glyphAtlas) {
+		glyphAtlas = new TextureAtlas(1024, 1);
+	}
+	return glyphAtlas;
+}
+
+GlyphCache *FontManager::getGlyphCache(Font *font, int size, int antiAliasMode) {
+	for(int i=0; i < glyphCaches.size(); i++) {
+		if(glyphCaches[i]->getFont() == font && glyphCaches[i]->getSize() == size && glyphCaches[i]->getAntiAliasMode() == antiAliasMode)
+			return glyphCaches[i];
+	}
+	
+	GlyphCache *glyphCache = new GlyphCache(font, size, antiAliasMode, getGlyphAtlas());
+	glyphCaches.push_back(glyphCache);
+	return glyphCache;
+}
+
+GlyphCache *FontManager::getDistanceFieldCache(Font *font) {
+	return getGlyphCache(font, GlyphCache::DISTANCE_FIELD_SIZE, Label::ANTIALIAS_DISTANCE_FIELD);
+}
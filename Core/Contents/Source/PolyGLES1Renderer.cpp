@@ -248,6 +248,9 @@ void OpenGLES1Renderer::setBlendingMode(int blendingMode) {
 		case BLEND_MODE_COLOR:
 			glBlendFunc (GL_DST_COLOR, GL_ONE);
 			break;
+		case BLEND_MODE_PREMULTIPLIED:
+			glBlendFunc (GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+			break;
 		default:
 			glBlendFunc (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 			break;
@@ -383,6 +386,12 @@ void OpenGLES1Renderer::bindFrameBufferTexture(Texture *texture) {
 	 */
 }
 
+void OpenGLES1Renderer::bindFrameBufferTextureRegion(Texture *texture, int x, int y, int width, int height, int border) {
+}
+
+void OpenGLES1Renderer::bindFrameBufferTextureClipped(Texture *texture, int x, int y, int width, int height) {
+}
+
 void OpenGLES1Renderer::unbindFramebuffers() {
 	/*
 	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, 0);	
@@ -479,6 +488,16 @@ Texture *OpenGLES1Renderer::createTexture(unsigned int width, unsigned int heigh
 	return newTexture;
 }
 
+Texture *OpenGLES1Renderer::createTextureFromContainer(TextureContainer *container, bool clamp) {
+	return NULL;
+}
+
+void OpenGLES1Renderer::updateTextureRegion(Texture *texture, unsigned int x, unsigned int y, unsigned int width, unsigned int height) {
+	// ES1 has no unpack row length, so whole rows are uploaded
+	glBindTexture(GL_TEXTURE_2D, ((OpenGLES1Texture*)texture)->getTextureID());
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y, texture->getWidth(), height, GL_RGBA, GL_UNSIGNED_BYTE, texture->getTextureData() + y * texture->getWidth() * 4);
+}
+
 void OpenGLES1Renderer::clearScreen() {
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 }
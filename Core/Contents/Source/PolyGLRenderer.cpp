@@ -40,6 +40,8 @@
 PFNGLACTIVETEXTUREPROC   glActiveTexture;
 PFNGLMULTITEXCOORD2FPROC glMultiTexCoord2f;
 PFNGLMULTITEXCOORD3FPROC glMultiTexCoord3f;
+PFNGLCOMPRESSEDTEXIMAGE2DPROC glCompressedTexImage2D;
+PFNGLBLENDFUNCSEPARATEPROC glBlendFuncSeparate;
 
 
 // ARB_vertex_buffer_object
@@ -100,6 +102,8 @@ void OpenGLRenderer::initOSSpecific(){
 	glActiveTexture   = (PFNGLACTIVETEXTUREPROC)wglGetProcAddress("glActiveTexture");
 	glMultiTexCoord2f = (PFNGLMULTITEXCOORD2FPROC)wglGetProcAddress("glMultiTexCoord2f");
 	glMultiTexCoord3f = (PFNGLMULTITEXCOORD3FPROC)wglGetProcAddress("glMultiTexCoord3f");
+	glCompressedTexImage2D = (PFNGLCOMPRESSEDTEXIMAGE2DPROC)wglGetProcAddress("glCompressedTexImage2D");
+	glBlendFuncSeparate = (PFNGLBLENDFUNCSEPARATEPROC)wglGetProcAddress("glBlendFuncSeparate");
 
    // ARB_vertex_buffer_object
         glBindBufferARB = (PFNGLBINDBUFFERARBPROC)wglGetProcAddress("glBindBufferARB");
@@ -430,14 +434,23 @@ void OpenGLRenderer::enableFog(bool enable) {
 void OpenGLRenderer::setBlendingMode(int blendingMode) {
 	switch(blendingMode) {
 		case BLEND_MODE_NORMAL:
+			if(premultipliedAlphaTarget)
+				glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+			else
 				glBlendFunc (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 		break;
 		case BLEND_MODE_LIGHTEN:
+			if(premultipliedAlphaTarget)
+				glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE, GL_ZERO, GL_ONE);
+			else
 				glBlendFunc (GL_SRC_ALPHA, GL_ONE);
 		break;
 		case BLEND_MODE_COLOR:
 				glBlendFunc (GL_SRC_ALPHA_SATURATE, GL_ONE);
 		break;
+		case BLEND_MODE_PREMULTIPLIED:
+				glBlendFunc (GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+		break;
 		default:
 			glBlendFunc (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 		break;
@@ -584,7 +597,41 @@ void OpenGLRenderer::bindFrameBufferTexture(Texture *texture) {
 	currentFrameBufferTexture = texture;
 }
 
+void OpenGLRenderer::bindFrameBufferTextureRegion(Texture *texture, int x, int y, int width, int height, int border) {
+	if(currentFrameBufferTexture) {
+		previousFrameBufferTexture = currentFrameBufferTexture;
+	}
+	OpenGLTexture *glTexture = (OpenGLTexture*)texture;
+
+	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, glTexture->getFrameBufferID());
+	glScissor(x, y, width, height);
+	glEnable(GL_SCISSOR_TEST);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	
+	glViewport(x + border, y + border, width - border * 2, height - border * 2);
+	glScissor(x + border, y + border, width - border * 2, height - border * 2);
+
+	currentFrameBufferTexture = texture;
+}
+
+void OpenGLRenderer::bindFrameBufferTextureClipped(Texture *texture, int x, int y, int width, int height) {
+	if(currentFrameBufferTexture) {
+		previousFrameBufferTexture = currentFrameBufferTexture;
+	}
+	OpenGLTexture *glTexture = (OpenGLTexture*)texture;
+
+	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, glTexture->getFrameBufferID());
+	glScissor(x, texture->getHeight() - y - height, width, height);
+	glEnable(GL_SCISSOR_TEST);
+	glClearColor(0.0, 0.0, 0.0, 0.0);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	glClearColor(clearColor.r, clearColor.g, clearColor.b, clearColor.a);
+
+	currentFrameBufferTexture = texture;
+}
+
 void OpenGLRenderer::unbindFramebuffers() {
+	glDisable(GL_SCISSOR_TEST);
 	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, 0);	
 	currentFrameBufferTexture = NULL;
 	if(previousFrameBufferTexture) {
@@ -683,6 +730,15 @@ Texture *OpenGLRenderer::createTexture(unsigned int width, unsigned int height,
 	return newTexture;
 }
 
+Texture *OpenGLRenderer::createTextureFromContainer(TextureContainer *container, bool clamp) {
+	OpenGLTexture *newTexture = new OpenGLTexture(container, clamp, textureFilteringMode);
+	return newTexture;
+}
+
+void OpenGLRenderer::updateTextureRegion(Texture *texture, unsigned int x, unsigned int y, unsigned int width, unsigned int height) {
+	((OpenGLTexture*)texture)->updateRegion(x, y, width, height);
+}
+
 void OpenGLRenderer::destroyTexture(Texture *texture) {
 	OpenGLTexture *glTex = (OpenGLTexture*)texture;
 	delete glTex;
@@ -998,8 +1054,7 @@ void OpenGLRenderer::setRenderArrayData(RenderDataArray *array, Number *arrayDat
 	
 }
 
-void OpenGLRenderer::drawArrays(int drawType) {
-	
+GLenum OpenGLRenderer::getDrawMode(int drawType) {
 	GLenum mode = GL_TRIANGLES;
 	
 	switch(drawType) {
@@ -1041,6 +1096,13 @@ void OpenGLRenderer::drawArrays(int drawType) {
 		break;
 	}
 	
+	return mode;
+}
+
+void OpenGLRenderer::drawArrays(int drawType) {
+	
+	GLenum mode = getDrawMode(drawType);
+	
 	glDrawArrays( mode, 0, verticesToDraw);	
 	
 	verticesToDraw = 0;
@@ -1051,6 +1113,20 @@ void OpenGLRenderer::drawArrays(int drawType) {
 	glDisableClientState( GL_COLOR_ARRAY );		
 }
 
+void OpenGLRenderer::drawIndexedArrays(int drawType, const unsigned int *indices, unsigned int indexCount) {
+	
+	GLenum mode = getDrawMode(drawType);
+	
+	glDrawElements(mode, indexCount, GL_UNSIGNED_INT, indices);
+	
+	verticesToDraw = 0;
+		
+	glDisableClientState( GL_VERTEX_ARRAY);	
+	glDisableClientState( GL_TEXTURE_COORD_ARRAY );		
+	glDisableClientState( GL_NORMAL_ARRAY );
+	glDisableClientState( GL_COLOR_ARRAY );		
+}
+
 /*
 void OpenGLRenderer::draw3DVertex2UV(Vertex *vertex, Vector2 *faceUV1, Vector2 *faceUV2) {
 	if(vertex->useVertexColor)
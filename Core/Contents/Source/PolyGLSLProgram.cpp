@@ -47,6 +47,8 @@ extern PFNGLLINKPROGRAMPROC glLinkProgram;
 extern PFNGLDETACHSHADERPROC glDetachShader;
 extern PFNGLDELETESHADERPROC glDeleteShader;
 extern PFNGLDELETEPROGRAMPROC glDeleteProgram;
+extern PFNGLGETSHADERIVPROC glGetShaderiv;
+extern PFNGLGETSHADERINFOLOGPROC glGetShaderInfoLog;
 #ifndef _MINGW
 extern PFNGLGETUNIFORMLOCATIONARBPROC glGetUniformLocation;
 #endif
@@ -59,7 +61,68 @@ GLSLProgram::GLSLProgram(int type) : Resource(Resource::RESOURCE_PROGRAM) {
 }
 
 GLSLProgram::~GLSLProgram() {
-	glDeleteShader(program);
+	clearShaderObjects();
+}
+
+void GLSLProgram::setSource(const String& source) {
+	this->source = source;
+	clearShaderObjects();
+}
+
+const String& GLSLProgram::getSource() const {
+	return source;
+}
+
+void GLSLProgram::clearShaderObjects() {
+	for(std::map<std::string, unsigned int>::iterator it = shaderObjects.begin(); it != shaderObjects.end(); it++) {
+		glDeleteShader(it->second);
+	}
+	shaderObjects.clear();
+}
+
+unsigned int GLSLProgram::getShaderObject(const String& defines) {
+	std::map<std::string, unsigned int>::iterator it = shaderObjects.find(defines.getSTLString());
+	if(it != shaderObjects.end()) {
+		return it->second;
+	}
+	
+	// #version has to stay the first statement, so the defines go right after it
+	std::string body = source.getSTLString();
+	std::string versionLine;
+	size_t start = body.find_first_not_of(" \t\r\n");
+	if(start != std::string::npos && body.compare(start, 8, "#version") == 0) {
+		size_t lineEnd = body.find('\n', start);
+		lineEnd = (lineEnd == std::string::npos) ? body.length() : lineEnd + 1;
+		versionLine = body.substr(0, lineEnd);
+		body = body.substr(lineEnd);
+	}
+	std::string fullSource = versionLine + defines.getSTLString() + body;
+	const GLchar *sourcePtr = fullSource.c_str();
+	
+	unsigned int shaderObject;
+	if(type == GLSLProgram::TYPE_VERT) {
+		shaderObject = glCreateShader(GL_VERTEX_SHADER);
+	} else {
+		shaderObject = glCreateShader(GL_FRAGMENT_SHADER);
+	}
+	
+	glShaderSource(shaderObject, 1, &sourcePtr, 0);
+	glCompileShader(shaderObject);
+	
+	GLint compiled = true;
+	glGetShaderiv(shaderObject, GL_COMPILE_STATUS, &compiled);
+	if(!compiled) {
+		GLint length;
+		GLchar* log;
+		glGetShaderiv(shaderObject, GL_INFO_LOG_LENGTH, &length);
+		log = (GLchar*)malloc(length);
+		glGetShaderInfoLog(shaderObject, length, &length, log);
+		printf("GLSL ERROR (%s): %s\n", getResourcePath().c_str(), log);
+		free(log);
+	}
+	
+	shaderObjects[defines.getSTLString()] = shaderObject;
+	return shaderObject;
 }
 
 void GLSLProgram::addParam(const String& name, bool isAuto, int autoID, int paramType, void *defaultData) {
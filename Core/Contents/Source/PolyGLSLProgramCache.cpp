@@ -0,0 +1,238 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+ 
+
+#include "PolyGLSLProgramCache.h"
+#include "PolyCore.h"
+#include "PolyCoreServices.h"
+#include "PolyLogger.h"
+#include "OSBasics.h"
+#include <string.h>
+
+#ifdef _WINDOWS
+#include <windows.h>
+#endif
+
+#include "PolyGLHeaders.h"
+
+// program binaries need GL 4.1 or GL_ARB_get_program_binary, which the Windows extension loader does not expose
+#if defined(GL_PROGRAM_BINARY_LENGTH) && !defined(_WINDOWS)
+#define POLY_GL_PROGRAM_BINARY
+#endif
+
+using std::vector;
+
+using namespace Polycode;
+
+#define PROGRAM_CACHE_MAGIC "PGPB"
+#define PROGRAM_CACHE_VERSION 1
+
+typedef struct {
+	char magic[4];
+	unsigned int version;
+	unsigned int hash[2];
+	unsigned int sourceLength;
+	unsigned int binaryFormat;
+	unsigned int binaryLength;
+} ProgramCacheHeader;
+
+GLSLProgramCache *GLSLProgramCache::instance = NULL;
+
+GLSLProgramCache::GLSLProgramCache() {
+	checkedSupport = false;
+	supported = false;
+	if(CoreServices::getInstance()->getCore()) {
+		String homeDirectory = CoreServices::getInstance()->getCore()->getUserHomeDirectory();
+		if(homeDirectory != "") {
+			cacheDirectory = homeDirectory + "/.polycode/shadercache";
+		}
+	}
+}
+
+GLSLProgramCache::~GLSLProgramCache() {
+
+}
+
+GLSLProgramCache *GLSLProgramCache::getInstance() {
+	if(!instance) {
+		instance = new GLSLProgramCache();
+	}
+	return instance;
+}
+
+void GLSLProgramCache::setCacheDirectory(const String& path) {
+	cacheDirectory = path;
+}
+
+const String& GLSLProgramCache::getCacheDirectory() const {
+	return cacheDirectory;
+}
+
+bool GLSLProgramCache::isAvailable() {
+	if(cacheDirectory == "")
+		return false;
+	
+	if(!checkedSupport) {
+		checkedSupport = true;
+#ifdef POLY_GL_PROGRAM_BINARY
+		const char *extensions = (const char*)glGetString(GL_EXTENSIONS);
+		GLint numFormats = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+		if(extensions && strstr(extensions, "GL_ARB_get_program_binary") && numFormats > 0) {
+			supported = true;
+			driverString = String((const char*)glGetString(GL_VENDOR)) + String((const char*)glGetString(GL_RENDERER)) + String((const char*)glGetString(GL_VERSION));
+		}
+#endif
+		if(!supported) {
+			Logger::log("GLSL program binaries not supported, shader cache disabled.\n");
+		}
+	}
+	return supported;
+}
+
+static unsigned int hashString(unsigned int hash, const String& str) {
+	const std::string& data = str.getSTLString();
+	for(size_t i=0; i < data.length(); i++) {
+		hash ^= (unsigned char)data[i];
+		hash *= 16777619;
+	}
+	// separator so that moving text between the strings changes the hash
+	hash ^= 0xff;
+	hash *= 16777619;
+	return hash;
+}
+
+String GLSLProgramCache::getCacheFileName(const String& vertexSource, const String& fragmentSource, const String& defines, unsigned int *hash) {
+	// two FNV-1a hashes with different offsets, giving a 64 bit key
+	unsigned int offsets[2] = {2166136261u, 3735928559u};
+	for(int i=0; i < 2; i++) {
+		hash[i] = offsets[i];
+		hash[i] = hashString(hash[i], vertexSource);
+		hash[i] = hashString(hash[i], fragmentSource);
+		hash[i] = hashString(hash[i], defines);
+		hash[i] = hashString(hash[i], driverString);
+	}
+	
+	char fileName[32];
+	sprintf(fileName, "%08x%08x.glslbin", hash[0], hash[1]);
+	return cacheDirectory + "/" + String(fileName);
+}
+
+void GLSLProgramCache::prepareProgram(unsigned int program) {
+#ifdef POLY_GL_PROGRAM_BINARY
+	if(isAvailable()) {
+		glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+#endif
+}
+
+bool GLSLProgramCache::loadProgram(unsigned int program, const String& vertexSource, const String& fragmentSource, const String& defines) {
+#ifdef POLY_GL_PROGRAM_BINARY
+	if(!isAvailable())
+		return false;
+	
+	unsigned int hash[2];
+	String fileName = getCacheFileName(vertexSource, fragmentSource, defines, hash);
+	
+	OSFILE *file = OSBasics::open(fileName, "rb");
+	if(!file)
+		return false;
+	
+	ProgramCacheHeader header;
+	bool valid = OSBasics::read(&header, sizeof(ProgramCacheHeader), 1, file) == 1;
+	valid = valid && memcmp(header.magic, PROGRAM_CACHE_MAGIC, 4) == 0 && header.version == PROGRAM_CACHE_VERSION;
+	valid = valid && header.hash[0] == hash[0] && header.hash[1] == hash[1];
+	valid = valid && header.sourceLength == vertexSource.length() + fragmentSource.length() + defines.length();
+	valid = valid && header.binaryLength > 0;
+	
+	char *binary = NULL;
+	if(valid) {
+		binary = (char*)malloc(header.binaryLength);
+		valid = OSBasics::read(binary, header.binaryLength, 1, file) == 1;
+	}
+	OSBasics::close(file);
+	
+	if(valid) {
+		glProgramBinary(program, header.binaryFormat, binary, header.binaryLength);
+		GLint linked = GL_FALSE;
+		glGetProgramiv(program, GL_LINK_STATUS, &linked);
+		valid = (linked == GL_TRUE);
+	}
+	free(binary);
+	
+	if(!valid) {
+		Logger::log("Discarding invalid GLSL program cache file %s\n", fileName.c_str());
+		OSBasics::removeItem(fileName);
+	}
+	return valid;
+#else
+	return false;
+#endif
+}
+
+void GLSLProgramCache::saveProgram(unsigned int program, const String& vertexSource, const String& fragmentSource, const String& defines) {
+#ifdef POLY_GL_PROGRAM_BINARY
+	if(!isAvailable())
+		return;
+	
+	GLint linked = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	GLint binaryLength = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+	if(linked != GL_TRUE || binaryLength <= 0)
+		return;
+	
+	ProgramCacheHeader header;
+	memcpy(header.magic, PROGRAM_CACHE_MAGIC, 4);
+	header.version = PROGRAM_CACHE_VERSION;
+	header.sourceLength = vertexSource.length() + fragmentSource.length() + defines.length();
+	String fileName = getCacheFileName(vertexSource, fragmentSource, defines, header.hash);
+	
+	char *binary = (char*)malloc(binaryLength);
+	GLenum binaryFormat;
+	GLsizei length = 0;
+	glGetProgramBinary(program, binaryLength, &length, &binaryFormat, binary);
+	header.binaryFormat = binaryFormat;
+	header.binaryLength = length;
+	
+	// create every missing folder on the way to the cache directory
+	vector<String> folders = cacheDirectory.split("/");
+	String path = "";
+	for(int i=0; i < folders.size(); i++) {
+		if(i > 0)
+			path += "/";
+		path += folders[i];
+		if(folders[i] != "" && !OSBasics::isFolder(path))
+			OSBasics::createFolder(path);
+	}
+	
+	OSFILE *file = OSBasics::open(fileName, "wb");
+	if(file) {
+		OSBasics::write(&header, sizeof(ProgramCacheHeader), 1, file);
+		OSBasics::write(binary, length, 1, file);
+		OSBasics::close(file);
+	} else {
+		Logger::log("Could not write GLSL program cache file %s\n", fileName.c_str());
+	}
+	free(binary);
+#endif
+}
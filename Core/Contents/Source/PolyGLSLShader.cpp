@@ -26,6 +26,7 @@ THE SOFTWARE.
 #include "PolyLogger.h"
 #include "PolyShader.h"
 #include "PolyGLSLProgram.h"
+#include "PolyGLSLProgramCache.h"
 #include "PolyTexture.h"
 #include "PolyCubemap.h"
 
@@ -40,6 +41,10 @@ using std::vector;
 #ifdef _WINDOWS
 extern PFNGLUSEPROGRAMPROC glUseProgram;
 extern PFNGLUNIFORM1IPROC glUniform1i;
+extern PFNGLUNIFORM1FPROC glUniform1f;
+extern PFNGLUNIFORM2FPROC glUniform2f;
+extern PFNGLUNIFORM3FPROC glUniform3f;
+extern PFNGLUNIFORMMATRIX4FVPROC glUniformMatrix4fv;
 extern PFNGLACTIVETEXTUREPROC glActiveTexture;
 extern PFNGLCREATESHADERPROC glCreateShader;
 extern PFNGLSHADERSOURCEPROC glShaderSource;
@@ -58,8 +63,12 @@ extern PFNGLGETUNIFORMLOCATIONARBPROC glGetUniformLocation;
 
 using namespace Polycode;
 
+unsigned int GLSLShader::nextLinkID = 1;
+
 GLSLShaderBinding::GLSLShaderBinding(GLSLShader *shader) : ShaderBinding(shader) {
 	glslShader = shader;
+	resolvedLinkID = 0;
+	resolvedLocalParamCount = 0;
 }
 
 GLSLShaderBinding::~GLSLShaderBinding() {
@@ -71,16 +80,20 @@ void GLSLShaderBinding::addTexture(const String& name, Texture *texture) {
 	GLSLTextureBinding binding;
 	binding.name = name;
 	binding.texture = texture;
+	binding.slot = -1;
 //	binding.vpParam = GLSLGetNamedParameter(glslShader->fp->program, name.c_str());
 	textures.push_back(binding);
+	resolvedLinkID = 0;
 }
 
 void GLSLShaderBinding::addCubemap(const String& name, Cubemap *cubemap) {
 	GLSLCubemapBinding binding;
 	binding.cubemap = cubemap;
 	binding.name = name;
+	binding.slot = -1;
 //	binding.vpParam = GLSLGetNamedParameter(GLSLShader->fp->program, name.c_str());
 	cubemaps.push_back(binding);
+	resolvedLinkID = 0;
 }
 
 void GLSLShaderBinding::clearTexture(const String& name) {
@@ -102,32 +115,182 @@ void GLSLShaderBinding::addParam(const String& type, const String& name, const S
 	localParams.push_back(newParam);
 }
 
+void GLSLShaderBinding::resolveSlots(GLSLShader *shader) {
+	if(resolvedLinkID == shader->linkID && resolvedLocalParamCount == localParams.size() && vpParamOverrides.size() == shader->vp->params.size() && fpParamOverrides.size() == shader->fp->params.size()) {
+		return;
+	}
+	
+	for(int i=0; i < textures.size(); i++) {
+		textures[i].slot = shader->getUniformSlot(textures[i].name);
+	}
+	for(int i=0; i < cubemaps.size(); i++) {
+		cubemaps[i].slot = shader->getUniformSlot(cubemaps[i].name);
+	}
+	
+	vpParamOverrides.resize(shader->vp->params.size());
+	for(int i=0; i < shader->vp->params.size(); i++) {
+		vpParamOverrides[i] = getLocalParamByName(shader->vp->params[i].name);
+	}
+	fpParamOverrides.resize(shader->fp->params.size());
+	for(int i=0; i < shader->fp->params.size(); i++) {
+		fpParamOverrides[i] = getLocalParamByName(shader->fp->params[i].name);
+	}
+	
+	resolvedLinkID = shader->linkID;
+	resolvedLocalParamCount = localParams.size();
+}
+
 void GLSLShader::linkProgram() {
 	shader_id = glCreateProgram();
-    glAttachShader(shader_id, fp->program);
-    glAttachShader(shader_id, vp->program);
 	
-	glBindAttribLocation(shader_id, 6, "vTangent");
+	GLSLProgramCache *programCache = GLSLProgramCache::getInstance();
+	if(!programCache->loadProgram(shader_id, vp->getSource(), fp->getSource(), defines)) {
+		unsigned int fpObject = fp->getShaderObject(defines);
+		unsigned int vpObject = vp->getShaderObject(defines);
+		glAttachShader(shader_id, fpObject);
+		glAttachShader(shader_id, vpObject);
+		
+		glBindAttribLocation(shader_id, 6, "vTangent");
+		
+		programCache->prepareProgram(shader_id);
+		glLinkProgram(shader_id);
+		
+		// the shader objects belong to the programs and may be shared with other permutations
+		glDetachShader(shader_id, fpObject);
+		glDetachShader(shader_id, vpObject);
+		
+		programCache->saveProgram(shader_id, vp->getSource(), fp->getSource(), defines);
+	}
+	
+	linkID = nextLinkID++;
+	
+	// locations are only valid for this link, so look everything up again
+	uniforms.clear();
+	vpParamSlots.clear();
+	fpParamSlots.clear();
+	
+	char name[32];
+	for(int i=0; i < 4; i++) {
+		sprintf(name, "shadowMap%d", i);
+		shadowMapSlots[i] = getUniformSlot(name);
+		sprintf(name, "shadowMatrix%d", i);
+		shadowMatrixSlots[i] = getUniformSlot(name);
+		sprintf(name, "shadowRect%d", i);
+		shadowRectSlots[i] = getUniformSlot(name);
+	}
+	modelMatrixSlot = getUniformSlot("modelMatrix");
+	updateProgramParamSlots();
+}
+
+void GLSLShader::updateProgramParamSlots() {
+	// programs can be shared between shaders, so params may be added after this shader was linked
+	for(int i=vpParamSlots.size(); i < vp->params.size(); i++) {
+		vpParamSlots.push_back(getUniformSlot(vp->params[i].name));
+	}
+	for(int i=fpParamSlots.size(); i < fp->params.size(); i++) {
+		fpParamSlots.push_back(getUniformSlot(fp->params[i].name));
+	}
+}
+
+int GLSLShader::getUniformSlot(const String& name) {
+	for(int i=0; i < uniforms.size(); i++) {
+		if(uniforms[i].name == name) {
+			return i;
+		}
+	}
 	
-    glLinkProgram(shader_id);
+	GLSLUniform uniform;
+	uniform.name = name;
+	uniform.location = glGetUniformLocation(shader_id, name.c_str());
+	uniform.hasValue = false;
+	uniform.intValue = 0;
+	uniform.floatCount = 0;
+	uniforms.push_back(uniform);
+	return uniforms.size()-1;
+}
+
+bool GLSLShader::setUniformValue(int slot, const float *values, int count) {
+	GLSLUniform &uniform = uniforms[slot];
+	if(uniform.location == -1) {
+		return false;
+	}
+	if(uniform.hasValue && uniform.floatCount == count && memcmp(uniform.floatValues, values, sizeof(float) * count) == 0) {
+		return false;
+	}
+	memcpy(uniform.floatValues, values, sizeof(float) * count);
+	uniform.floatCount = count;
+	uniform.hasValue = true;
+	return true;
 }
 
-GLSLShader::GLSLShader(GLSLProgram *vp, GLSLProgram *fp) : Shader(Shader::MODULE_SHADER) {
+void GLSLShader::setUniformInt(int slot, int value) {
+	GLSLUniform &uniform = uniforms[slot];
+	if(uniform.location == -1) {
+		return;
+	}
+	if(uniform.hasValue && uniform.floatCount == 0 && uniform.intValue == value) {
+		return;
+	}
+	uniform.intValue = value;
+	uniform.floatCount = 0;
+	uniform.hasValue = true;
+	glUniform1i(uniform.location, value);
+}
+
+void GLSLShader::setUniformFloats(int slot, const float *values, int count) {
+	if(!setUniformValue(slot, values, count)) {
+		return;
+	}
+	int location = uniforms[slot].location;
+	switch(count) {
+		case 1:
+			glUniform1f(location, values[0]);
+		break;
+		case 2:
+			glUniform2f(location, values[0], values[1]);
+		break;
+		case 3:
+			glUniform3f(location, values[0], values[1], values[2]);
+		break;
+		case 4:
+			glUniform4f(location, values[0], values[1], values[2], values[3]);
+		break;
+	}
+}
+
+void GLSLShader::setUniformMatrix(int slot, const float *values) {
+	if(!setUniformValue(slot, values, 16)) {
+		return;
+	}
+	glUniformMatrix4fv(uniforms[slot].location, 1, false, values);
+}
+
+GLSLShader::GLSLShader(GLSLProgram *vp, GLSLProgram *fp, const String& defines) : Shader(Shader::MODULE_SHADER) {
 	this->vp = vp;
 	this->fp = fp;
-	
-	linkProgram();
+	this->defines = defines;
+	shader_id = 0;
+	linkID = 0;
+	modelMatrixSlot = -1;
+}
+
+void GLSLShader::ensureLinked() {
+	if(shader_id == 0) {
+		linkProgram();
+	}
 }
 
 void GLSLShader::reload() {
-	glDeleteProgram(shader_id);
-	linkProgram();
+	if(shader_id != 0) {
+		glDeleteProgram(shader_id);
+		linkProgram();
+	}
 }
 
 GLSLShader::~GLSLShader() {
-	glDetachShader(shader_id, fp->program);
-    glDetachShader(shader_id, vp->program);
-	glDeleteProgram(shader_id);	
+	if(shader_id != 0) {
+		glDeleteProgram(shader_id);	
+	}
 }
 
 ShaderBinding *GLSLShader::createBinding() {
@@ -148,7 +148,7 @@ Shader *GLSLShaderModule::createShader(TiXmlNode *node) {
 		
 	}
 	if(vp != NULL && fp != NULL) {
-		GLSLShader *cgShader = new GLSLShader(vp,fp);
+		GLSLShader *cgShader = new GLSLShader(vp,fp,createShaderDefines(node));
 		cgShader->setName(String(node->ToElement()->Attribute("name")));
 		retShader = cgShader;
 		shaders.push_back((Shader*)cgShader);
@@ -157,13 +157,39 @@ Shader *GLSLShaderModule::createShader(TiXmlNode *node) {
 
 }
 
+String GLSLShaderModule::createShaderDefines(TiXmlNode *node) {
+	String defines;
+	if(node->ToElement()->Attribute("numAreaLights")) {
+		defines += "#define POLY_NUM_AREA_LIGHTS " + String(node->ToElement()->Attribute("numAreaLights")) + "\n";
+	}
+	if(node->ToElement()->Attribute("numSpotLights")) {
+		defines += "#define POLY_NUM_SPOT_LIGHTS " + String(node->ToElement()->Attribute("numSpotLights")) + "\n";
+	}
+	
+	// extra defines are a space separated list of NAME or NAME=VALUE
+	if(node->ToElement()->Attribute("defines")) {
+		vector<String> names = String(node->ToElement()->Attribute("defines")).split(" ");
+		for(int i=0; i < names.size(); i++) {
+			if(names[i] == "")
+				continue;
+			vector<String> nameValue = names[i].split("=");
+			if(nameValue.size() == 2) {
+				defines += "#define " + nameValue[0] + " " + nameValue[1] + "\n";
+			} else {
+				defines += "#define " + names[i] + "\n";
+			}
+		}
+	}
+	return defines;
+}
+
 void GLSLShaderModule::clearShader() {
 	glUseProgram(0);
 }
 
 void GLSLShaderModule::setGLSLAreaLightPositionParameter(Renderer *renderer, GLSLProgramParam &param, int lightIndex) {
-	if(renderer->getNumAreaLights() > lightIndex) {
-		vector<LightInfo> areaLights = renderer->getAreaLights();			
+	if(renderer->getSelectedAreaLights().size() > lightIndex) {
+		const vector<LightInfo> &areaLights = renderer->getSelectedAreaLights();			
 		Vector3 lPos(areaLights[lightIndex].position.x,areaLights[lightIndex].position.y,areaLights[lightIndex].position.z);
 		GLfloat LightPosition[] = {lPos.x, lPos.y, lPos.z, 1};		
 		
@@ -177,10 +203,10 @@ void GLSLShaderModule::setGLSLAreaLightPositionParameter(Renderer *renderer, GLS
 }
 
 void GLSLShaderModule::setGLSLSpotLightPositionParameter(Renderer *renderer, GLSLProgramParam &param, int lightIndex) {
-	if(renderer->getNumSpotLights() > lightIndex) {
-		vector<LightInfo> spotLights = renderer->getSpotLights();		
+	if(renderer->getSelectedSpotLights().size() > lightIndex) {
+		const vector<LightInfo> &spotLights = renderer->getSelectedSpotLights();		
 		Vector3 lPos(spotLights[lightIndex].position.x,spotLights[lightIndex].position.y,spotLights[lightIndex].position.z);
-		lPos = renderer->getCameraMatrix().inverse() * lPos;
+		lPos = renderer->getViewMatrix() * lPos;
 //		cgGLSetParameter4f(param.cgParam, lPos.x,lPos.y,lPos.z, spotLights[lightIndex].distance);
 	} else {
 //		cgGLSetParameter4f(param.cgParam, 0,0,0,0);
@@ -188,10 +214,10 @@ void GLSLShaderModule::setGLSLSpotLightPositionParameter(Renderer *renderer, GLS
 }
 
 void GLSLShaderModule::setGLSLSpotLightDirectionParameter(Renderer *renderer, GLSLProgramParam &param, int lightIndex) {
-	if(renderer->getNumSpotLights() > lightIndex) {
-		vector<LightInfo> spotLights = renderer->getSpotLights();		
+	if(renderer->getSelectedSpotLights().size() > lightIndex) {
+		const vector<LightInfo> &spotLights = renderer->getSelectedSpotLights();		
 		Vector3 lPos(spotLights[lightIndex].dir.x,spotLights[lightIndex].dir.y,spotLights[lightIndex].dir.z);
-		lPos = renderer->getCameraMatrix().inverse().rotateVector(lPos);
+		lPos = renderer->getViewMatrix().rotateVector(lPos);
 //		cgGLSetParameter3f(param.cgParam, lPos.x,lPos.y,lPos.z);
 	} else {
 //		cgGLSetParameter3f(param.cgParam, 0.0f,0.0f,0.0f);
@@ -199,8 +225,8 @@ void GLSLShaderModule::setGLSLSpotLightDirectionParameter(Renderer *renderer, GL
 }
 
 void GLSLShaderModule::setGLSLAreaLightColorParameter(Renderer *renderer, GLSLProgramParam &param, int lightIndex) {
-	if(renderer->getNumAreaLights() > lightIndex) {
-		vector<LightInfo> areaLights = renderer->getAreaLights();		
+	if(renderer->getSelectedAreaLights().size() > lightIndex) {
+		const vector<LightInfo> &areaLights = renderer->getSelectedAreaLights();		
 		
 		GLfloat DiffuseLight[] = {areaLights[lightIndex].color.x, areaLights[lightIndex].color.y, areaLights[lightIndex].color.z};
 		glLightfv (GL_LIGHT0+lightIndex, GL_DIFFUSE, DiffuseLight);
@@ -212,8 +238,7 @@ void GLSLShaderModule::setGLSLAreaLightColorParameter(Renderer *renderer, GLSLPr
 }
 
 void GLSLShaderModule::setGLSLSpotLightColorParameter(Renderer *renderer, GLSLProgramParam &param, int lightIndex) {
-	if(renderer->getNumSpotLights() > lightIndex) {
-		vector<LightInfo> spotLights = renderer->getSpotLights();			
+	if(renderer->getSelectedSpotLights().size() > lightIndex) {
 //		cgGLSetParameter4f(param.cgParam, spotLights[lightIndex].color.x,spotLights[lightIndex].color.y,spotLights[lightIndex].color.z, spotLights[lightIndex].intensity);
 	} else {
 //		cgGLSetParameter4f(param.cgParam, 0,0,0,0);
@@ -221,8 +246,8 @@ void GLSLShaderModule::setGLSLSpotLightColorParameter(Renderer *renderer, GLSLPr
 }
 
 void GLSLShaderModule::setGLSLSpotLightTextureMatrixParameter(Renderer *renderer, GLSLProgramParam &param, int lightIndex) {
-	if(renderer->getNumLights() > lightIndex) {
-		vector<LightInfo> spotLights = renderer->getSpotLights();			
+	if(renderer->getSelectedSpotLights().size() > lightIndex) {
+		const vector<LightInfo> &spotLights = renderer->getSelectedSpotLights();			
 		glMatrixMode(GL_MODELVIEW);
 		glPushMatrix();
 		glLoadMatrixd(spotLights[lightIndex].textureMatrix.ml);				
@@ -233,7 +258,7 @@ void GLSLShaderModule::setGLSLSpotLightTextureMatrixParameter(Renderer *renderer
 
 
 
-void GLSLShaderModule::updateGLSLParam(Renderer *renderer, GLSLShader *glslShader, GLSLProgramParam &param, ShaderBinding *materialOptions, ShaderBinding *localOptions) {
+void GLSLShaderModule::updateGLSLParam(Renderer *renderer, GLSLShader *glslShader, GLSLProgramParam &param, int slot, LocalShaderParam *materialParam, LocalShaderParam *localParam) {
 	if(param.isAuto) {
 		switch(param.autoID) {
 			case GLSLProgramParam::POLY_MODELVIEWPROJ_MATRIX:
@@ -362,34 +387,36 @@ void GLSLShaderModule::updateGLSLParam(Renderer *renderer, GLSLShader *glslShade
 		}
 	} else {
 		void *paramData = param.defaultData;
-		LocalShaderParam *localParam = materialOptions->getLocalParamByName(param.name);
-		if(localParam)
-			paramData = localParam->data;
-		localParam = localOptions->getLocalParamByName(param.name);
+		if(materialParam)
+			paramData = materialParam->data;
 		if(localParam)
 			paramData = localParam->data;
 		
-		Number *fval;
+		GLfloat values[3];
 		
 		switch(param.paramType) {
 			case GLSLProgramParam::PARAM_Number:
 			{
-				fval = (Number*)paramData;
-				int paramLocation = glGetUniformLocation(glslShader->shader_id, param.name.c_str());
-				glUniform1f(paramLocation, *fval);
+				Number *fval = (Number*)paramData;
+				values[0] = *fval;
+				glslShader->setUniformFloats(slot, values, 1);
 				break;
 			}
 			case GLSLProgramParam::PARAM_Number2:
 			{
 				Vector2 *fval2 = (Vector2*)paramData;
-				int paramLocation = glGetUniformLocation(glslShader->shader_id, param.name.c_str());
-				glUniform2f(paramLocation, fval2->x, fval2->y);				break;				
+				values[0] = fval2->x;
+				values[1] = fval2->y;
+				glslShader->setUniformFloats(slot, values, 2);
+				break;				
 			}			
 			case GLSLProgramParam::PARAM_Number3:
 			{
 				Vector3 *fval3 = (Vector3*)paramData;
-				int paramLocation = glGetUniformLocation(glslShader->shader_id, param.name.c_str());
-				glUniform3f(paramLocation, fval3->x,fval3->y,fval3->z);
+				values[0] = fval3->x;
+				values[1] = fval3->y;
+				values[2] = fval3->z;
+				glslShader->setUniformFloats(slot, values, 3);
 				break;				
 			}
 		}
@@ -404,15 +431,17 @@ bool GLSLShaderModule::applyShaderMaterial(Renderer *renderer, Material *materia
 	glLoadIdentity();
 	
 	
-	int numRendererAreaLights = renderer->getNumAreaLights();
-	int numRendererSpotLights = renderer->getNumSpotLights();
-	
 	int numTotalLights = glslShader->numAreaLights + glslShader->numSpotLights;
 	
 	if(numTotalLights > 0) {
-		renderer->sortLights();	
+		renderer->selectLights(glslShader->numAreaLights, glslShader->numSpotLights);
 	}
 	
+	const vector<LightInfo> &areaLights = renderer->getSelectedAreaLights();
+	const vector<LightInfo> &spotLights = renderer->getSelectedSpotLights();
+	int numRendererAreaLights = numTotalLights > 0 ? areaLights.size() : 0;
+	int numRendererSpotLights = numTotalLights > 0 ? spotLights.size() : 0;
+	
 	for(int i=0 ; i < numTotalLights; i++) {
 		GLfloat resetData[] = {0.0, 0.0, 0.0, 0.0};				
 		glLightfv (GL_LIGHT0+i, GL_DIFFUSE, resetData);	
@@ -427,8 +456,6 @@ bool GLSLShaderModule::applyShaderMaterial(Renderer *renderer, Material *materia
 	
 	int lightIndex = 0;
 	
-	vector<LightInfo> areaLights = renderer->getAreaLights();
-	
 //	printf("Applying {\n");
 //	for(int z=0;z < areaLights.size(); z++) {
 //		LightInfo light = areaLights[z];		
@@ -441,7 +468,7 @@ bool GLSLShaderModule::applyShaderMaterial(Renderer *renderer, Material *materia
 		LightInfo light;
 		if(i < numRendererAreaLights) {
 			light = areaLights[i];
-			light.position = renderer->getCameraMatrix().inverse() * light.position;
+			light.position = renderer->getViewMatrix() * light.position;
 			ambientVal[0] = renderer->ambientColor.r;
 			ambientVal[1] = renderer->ambientColor.g;
 			ambientVal[2] = renderer->ambientColor.b;										
@@ -474,12 +501,10 @@ bool GLSLShaderModule::applyShaderMaterial(Renderer *renderer, Material *materia
 		lightIndex++;
 	}
 
-	vector<LightInfo> spotLights = renderer->getSpotLights();
 //	vector<Texture*> shadowMapTextures = renderer->getShadowMapTextures();	
-	char texName[32];
-	char matName[32];	
 	int shadowMapTextureIndex = 0;
 					
+	glslShader->ensureLinked();
 	glUseProgram(glslShader->shader_id);	
 	int textureIndex = 0;					
 					
@@ -491,8 +516,8 @@ bool GLSLShaderModule::applyShaderMaterial(Renderer *renderer, Material *materia
 			light = spotLights[i];
 			pos = light.position;
 			dir = light.dir;						
-			pos = renderer->getCameraMatrix().inverse() * pos;
-			dir = renderer->getCameraMatrix().inverse().rotateVector(dir);
+			pos = renderer->getViewMatrix() * pos;
+			dir = renderer->getViewMatrix().rotateVector(dir);
 			
 			ambientVal[0] = renderer->ambientColor.r;
 			ambientVal[1] = renderer->ambientColor.g;
@@ -531,27 +556,7 @@ bool GLSLShaderModule::applyShaderMaterial(Renderer *renderer, Material *materia
 		
 		if(light.shadowsEnabled) {		
 			if(shadowMapTextureIndex < 4) {
-				switch(shadowMapTextureIndex) {
-					case 0:
-						strcpy(texName, "shadowMap0");
-						strcpy(matName, "shadowMatrix0");						
-					break;
-					case 1:
-						strcpy(texName, "shadowMap1");
-						strcpy(matName, "shadowMatrix1");												
-					break;
-					case 2:
-						strcpy(texName, "shadowMap2");
-						strcpy(matName, "shadowMatrix2");																		
-					break;
-					case 3:
-						strcpy(texName, "shadowMap3");
-						strcpy(matName, "shadowMatrix3");																		
-					break;							
-				}
-			
-				int texture_location = glGetUniformLocation(glslShader->shader_id, texName);
-				glUniform1i(texture_location, textureIndex);
+				glslShader->setUniformInt(glslShader->shadowMapSlots[shadowMapTextureIndex], textureIndex);
 				glActiveTexture(GL_TEXTURE0 + textureIndex);		
 				glBindTexture(GL_TEXTURE_2D, ((OpenGLTexture*)light.shadowMapTexture)->getTextureID());	
 				textureIndex++;
@@ -559,17 +564,15 @@ bool GLSLShaderModule::applyShaderMaterial(Renderer *renderer, Material *materia
 //				glMatrixMode(GL_MODELVIEW);
 //				glPushMatrix();
 //				glLoadMatrixd(light.textureMatrix.ml);			
-				int mloc = glGetUniformLocation(glslShader->shader_id, matName);				
-				
-				
-				light.textureMatrix = light.textureMatrix;
-				
 			
 				GLfloat mat[16];
 				for(int z=0; z < 16; z++) {
 					mat[z] = light.textureMatrix.ml[z];
 				}
-				glUniformMatrix4fv(mloc, 1, false, mat);
+				glslShader->setUniformMatrix(glslShader->shadowMatrixSlots[shadowMapTextureIndex], mat);
+				
+				GLfloat rect[4] = {(GLfloat)light.shadowMapRectMin.x, (GLfloat)light.shadowMapRectMin.y, (GLfloat)light.shadowMapRectMax.x, (GLfloat)light.shadowMapRectMax.y};
+				glslShader->setUniformFloats(glslShader->shadowRectSlots[shadowMapTextureIndex], rect, 4);
 		
 						
 	//			glPopMatrix();
@@ -589,29 +592,30 @@ bool GLSLShaderModule::applyShaderMaterial(Renderer *renderer, Material *materia
 	glEnable(GL_TEXTURE_2D);
 		
 	Matrix4 modelMatrix = renderer->getCurrentModelMatrix();
-	int mloc = glGetUniformLocation(glslShader->shader_id, "modelMatrix");				
 	GLfloat mat[16];
 	for(int z=0; z < 16; z++) {
 		mat[z] = modelMatrix.ml[z];
 	}
-	glUniformMatrix4fv(mloc, 1, false, mat);
+	glslShader->setUniformMatrix(glslShader->modelMatrixSlot, mat);
 		
 		
 	GLSLShaderBinding *cgBinding = (GLSLShaderBinding*)material->getShaderBinding(shaderIndex);
+	GLSLShaderBinding *localBinding = (GLSLShaderBinding*)localOptions;
+	
+	glslShader->updateProgramParamSlots();
+	cgBinding->resolveSlots(glslShader);
+	localBinding->resolveSlots(glslShader);
 	
 	for(int i=0; i < glslShader->vp->params.size(); i++) {
-		GLSLProgramParam param = glslShader->vp->params[i];
-		updateGLSLParam(renderer, glslShader, param, material->getShaderBinding(shaderIndex), localOptions);
+		updateGLSLParam(renderer, glslShader, glslShader->vp->params[i], glslShader->vpParamSlots[i], cgBinding->vpParamOverrides[i], localBinding->vpParamOverrides[i]);
 	}
 	
 	for(int i=0; i < glslShader->fp->params.size(); i++) {
-		GLSLProgramParam param = glslShader->fp->params[i];
-		updateGLSLParam(renderer, glslShader, param, material->getShaderBinding(shaderIndex), localOptions);
+		updateGLSLParam(renderer, glslShader, glslShader->fp->params[i], glslShader->fpParamSlots[i], cgBinding->fpParamOverrides[i], localBinding->fpParamOverrides[i]);
 	}	
 	
 	for(int i=0; i < cgBinding->textures.size(); i++) {
-		int texture_location = glGetUniformLocation(glslShader->shader_id, cgBinding->textures[i].name.c_str());
-		glUniform1i(texture_location, textureIndex);
+		glslShader->setUniformInt(cgBinding->textures[i].slot, textureIndex);
 		glActiveTexture(GL_TEXTURE0 + textureIndex);		
 		glBindTexture(GL_TEXTURE_2D, ((OpenGLTexture*)cgBinding->textures[i].texture)->getTextureID());	
 		textureIndex++;
@@ -619,8 +623,7 @@ bool GLSLShaderModule::applyShaderMaterial(Renderer *renderer, Material *materia
 	
 		
 	for(int i=0; i < cgBinding->cubemaps.size(); i++) {
-		int texture_location = glGetUniformLocation(glslShader->shader_id, cgBinding->cubemaps[i].name.c_str());
-		glUniform1i(texture_location, textureIndex);
+		glslShader->setUniformInt(cgBinding->cubemaps[i].slot, textureIndex);
 		
 		glActiveTexture(GL_TEXTURE0 + textureIndex);	
 			
@@ -628,12 +631,10 @@ bool GLSLShaderModule::applyShaderMaterial(Renderer *renderer, Material *materia
 		textureIndex++;
 	}	
 	
-	cgBinding = (GLSLShaderBinding*)localOptions;
-	for(int i=0; i < cgBinding->textures.size(); i++) {
-		int texture_location = glGetUniformLocation(glslShader->shader_id, cgBinding->textures[i].name.c_str());
-		glUniform1i(texture_location, textureIndex);
+	for(int i=0; i < localBinding->textures.size(); i++) {
+		glslShader->setUniformInt(localBinding->textures[i].slot, textureIndex);
 		glActiveTexture(GL_TEXTURE0 + textureIndex);		
-		glBindTexture(GL_TEXTURE_2D, ((OpenGLTexture*)cgBinding->textures[i].texture)->getTextureID());	
+		glBindTexture(GL_TEXTURE_2D, ((OpenGLTexture*)localBinding->textures[i].texture)->getTextureID());	
 		textureIndex++;
 	}		
 
@@ -823,27 +824,8 @@ void GLSLShaderModule::recreateGLSLProgram(GLSLProgram *prog, const String& file
 	OSBasics::read(buffer, progsize, 1, file);
 	OSBasics::close(file);
 	
-	if(type == GLSLProgram::TYPE_VERT) {
-		prog->program =  glCreateShader(GL_VERTEX_SHADER);
-	} else {
-		prog->program =  glCreateShader(GL_FRAGMENT_SHADER);
-	}
-	
-	glShaderSource(prog->program, 1, (const GLchar**)&buffer, 0);
-	glCompileShader(prog->program);	
-	
-	GLint compiled = true;
-    glGetShaderiv(prog->program, GL_COMPILE_STATUS, &compiled);
-    if(!compiled) {
-        GLint length;
-        GLchar* log;
-        glGetShaderiv(prog->program, GL_INFO_LOG_LENGTH, &length);
-        log = (GLchar*)malloc(length);
-        glGetShaderInfoLog(prog->program, length, &length, log);
-		printf("GLSL ERROR: %s\n", log);
-        free(log);
-    }		
-		
+	// permutations are compiled when a shader using them is first linked
+	prog->setSource(String(buffer));
 	
 	free(buffer);		
 	
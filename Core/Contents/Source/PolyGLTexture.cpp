@@ -25,6 +25,8 @@
 #include "PolyGLTexture.h"
 #include "PolyCoreServices.h"
 #include "PolyRenderer.h"
+#include "PolyTextureContainer.h"
+#include <string.h>
 
 #define FRAMEBUFFER_NULL 999999
 
@@ -34,8 +36,13 @@ using namespace Polycode;
 extern PFNGLDELETEFRAMEBUFFERSEXTPROC glDeleteFramebuffersEXT;
 #endif
 
+#if defined(_WINDOWS) && !defined(_MINGW)
+extern PFNGLCOMPRESSEDTEXIMAGE2DPROC glCompressedTexImage2D;
+#endif
+
 OpenGLTexture::OpenGLTexture(unsigned int width, unsigned int height, char *textureData, bool clamp, bool createMipmaps, int filteringMode, int type) : Texture(width, height, textureData,clamp, createMipmaps, type) {
 	this->filteringMode = filteringMode;
+	container = NULL;
 	glTextureLoaded = false;
 	frameBufferID = FRAMEBUFFER_NULL;
 	
@@ -60,6 +67,57 @@ OpenGLTexture::OpenGLTexture(unsigned int width, unsigned int height, char *text
 	recreateFromImageData();
 }
 
+OpenGLTexture::OpenGLTexture(TextureContainer *container, bool clamp, int filteringMode) : Texture(container->getWidth(), container->getHeight(), container->isCompressed() ? NULL : container->getLevel(0).data, clamp, container->getNumLevels() > 1, container->getFormat() == TextureContainer::FORMAT_RGB ? Image::IMAGE_RGB : Image::IMAGE_RGBA) {
+	this->container = container;
+	this->filteringMode = filteringMode;
+	glTextureLoaded = false;
+	frameBufferID = FRAMEBUFFER_NULL;
+	glTextureType = container->getFormat() == TextureContainer::FORMAT_RGB ? GL_RGB : GL_RGBA;
+	glTextureFormat = glTextureType;
+	pixelType = GL_UNSIGNED_BYTE;
+	
+	recreateFromImageData();
+}
+
+void OpenGLTexture::uploadContainerLevels() {
+	if(!container->reloadLevelData()) {
+		return;
+	}
+	
+	bool compressed = container->isCompressed();
+	bool uploadCompressed = false;
+	if(compressed) {
+		const char *extensions = (const char*)glGetString(GL_EXTENSIONS);
+		uploadCompressed = extensions && strstr(extensions, "GL_EXT_texture_compression_s3tc");
+	}
+	
+	GLint unpackAlignment;
+	glGetIntegerv(GL_UNPACK_ALIGNMENT, &unpackAlignment);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	
+	for(unsigned int i=0; i < container->getNumLevels(); i++) {
+		const TextureLevel &level = container->getLevel(i);
+		if(uploadCompressed) {
+			GLenum compressedFormat = container->getFormat() == TextureContainer::FORMAT_DXT1 ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+			glCompressedTexImage2D(GL_TEXTURE_2D, i, compressedFormat, level.width, level.height, 0, level.dataSize, level.data);
+		} else if(compressed) {
+			Image *decoded = container->decodeLevel(i);
+			glTexImage2D(GL_TEXTURE_2D, i, GL_RGBA, level.width, level.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, decoded->getPixels());
+			delete decoded;
+		} else {
+			glTexImage2D(GL_TEXTURE_2D, i, glTextureFormat, level.width, level.height, 0, glTextureType, pixelType, level.data);
+		}
+	}
+	
+	glPixelStorei(GL_UNPACK_ALIGNMENT, unpackAlignment);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, container->getNumLevels() - 1);
+	
+	// containers loaded from a file can read their levels again if the texture has to be recreated
+	if(container->getFileName() != "") {
+		container->releaseLevelData();
+	}
+}
+
 void OpenGLTexture::recreateFromImageData() {
 	
 	Number anisotropy = CoreServices::getInstance()->getRenderer()->getAnisotropyAmount();
@@ -77,6 +135,23 @@ void OpenGLTexture::recreateFromImageData() {
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);	
 	}
+	
+	if(container) {
+		if(filteringMode == Renderer::TEX_FILTERING_NEAREST) {
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, createMipmaps ? GL_NEAREST_MIPMAP_NEAREST : GL_NEAREST);
+		} else {
+			if(anisotropy > 0) {
+				glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, anisotropy);
+			}
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, createMipmaps ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+		}
+		uploadContainerLevels();
+		glTextureLoaded = true;
+		return;
+	}
+	
 	switch(filteringMode) {
 		case Renderer::TEX_FILTERING_LINEAR:
 		
@@ -110,7 +185,29 @@ void OpenGLTexture::recreateFromImageData() {
 	glTextureLoaded = true;
 }
 
+void OpenGLTexture::updateRegion(unsigned int x, unsigned int y, unsigned int width, unsigned int height) {
+	if(!glTextureLoaded || !textureData)
+		return;
+	
+	glBindTexture(GL_TEXTURE_2D, textureID);
+	
+	GLint unpackAlignment;
+	glGetIntegerv(GL_UNPACK_ALIGNMENT, &unpackAlignment);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, this->width);
+	glPixelStorei(GL_UNPACK_SKIP_PIXELS, x);
+	glPixelStorei(GL_UNPACK_SKIP_ROWS, y);
+	
+	glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, glTextureType, pixelType, textureData);
+	
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+	glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, unpackAlignment);
+}
+
 OpenGLTexture::OpenGLTexture(unsigned int width, unsigned int height) : Texture(width, height, NULL ,true, true) {
+	container = NULL;
 
 }
 
@@ -128,6 +225,7 @@ void OpenGLTexture::setTextureData(char *data) {
 }
 
 OpenGLTexture::~OpenGLTexture() {
+	delete container;
 	glDeleteTextures(1, &textureID);
 	if(frameBufferID != FRAMEBUFFER_NULL) {
 		glDeleteFramebuffersEXT(1, &frameBufferID);
@@ -0,0 +1,306 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+ 
+
+#include "PolyGlyphCache.h"
+#include "PolyDistanceField.h"
+#include "PolyFont.h"
+#include "PolyImage.h"
+#include "PolyLabel.h"
+#include "PolyTextureAtlas.h"
+#include <stdio.h>
+#include <string.h>
+
+using namespace Polycode;
+
+GlyphInfo::GlyphInfo() {
+	glyphIndex = 0;
+	advance = 0;
+	bitmapLeft = 0;
+	bitmapTop = 0;
+	width = 0;
+	height = 0;
+	region = NULL;
+	rasterized = false;
+}
+
+GlyphCache::GlyphCache(Font *font, int size, int antiAliasMode, TextureAtlas *atlas) {
+	this->font = font;
+	this->size = size;
+	this->antiAliasMode = antiAliasMode;
+	this->atlas = atlas;
+}
+
+GlyphCache::~GlyphCache() {
+
+}
+
+Font *GlyphCache::getFont() const {
+	return font;
+}
+
+int GlyphCache::getSize() const {
+	return size;
+}
+
+int GlyphCache::getAntiAliasMode() const {
+	return antiAliasMode;
+}
+
+TextureAtlas *GlyphCache::getAtlas() const {
+	return atlas;
+}
+
+void GlyphCache::addGlyphImage(wchar_t character, GlyphInfo *glyph, Image *glyphImage) {
+	char regionName[128];
+	sprintf(regionName, "%p_%d_%d_%d", (void*)font, size, antiAliasMode, (int)character);
+	glyph->region = atlas->addImage(regionName, glyphImage);
+}
+
+void GlyphCache::rasterizeDistanceField(wchar_t character, GlyphInfo *glyph) {
+	FT_Face face = font->getFace();
+	FT_GlyphSlot slot = face->glyph;
+	
+	// metrics come from the cache size, the outline is rendered larger and downsampled into the distance field
+	FT_Set_Pixel_Sizes(face, 0, size);
+	FT_Load_Glyph(face, glyph->glyphIndex, FT_LOAD_TARGET_LIGHT);
+	glyph->advance = slot->advance.x >> 6;
+	glyph->bitmapLeft = 0;
+	glyph->bitmapTop = 0;
+	glyph->width = 0;
+	glyph->height = 0;
+	glyph->rasterized = true;
+	
+	FT_Set_Pixel_Sizes(face, 0, size * DISTANCE_FIELD_DOWNSAMPLE);
+	FT_Load_Glyph(face, glyph->glyphIndex, FT_LOAD_NO_HINTING);
+	FT_Render_Glyph(slot, FT_RENDER_MODE_NORMAL);
+	
+	if(!atlas || slot->bitmap.width == 0 || slot->bitmap.rows == 0)
+		return;
+	
+	// shift the bitmap so its left and top edges fall on the downsampled pixel grid
+	int gridLeft = slot->bitmap_left >= 0 ? slot->bitmap_left / DISTANCE_FIELD_DOWNSAMPLE : -((-slot->bitmap_left + DISTANCE_FIELD_DOWNSAMPLE - 1) / DISTANCE_FIELD_DOWNSAMPLE);
+	int gridTop = slot->bitmap_top >= 0 ? (slot->bitmap_top + DISTANCE_FIELD_DOWNSAMPLE - 1) / DISTANCE_FIELD_DOWNSAMPLE : -(-slot->bitmap_top / DISTANCE_FIELD_DOWNSAMPLE);
+	unsigned int offsetX = slot->bitmap_left - gridLeft * DISTANCE_FIELD_DOWNSAMPLE;
+	unsigned int offsetY = gridTop * DISTANCE_FIELD_DOWNSAMPLE - slot->bitmap_top;
+	
+	unsigned int sourceWidth = slot->bitmap.width + offsetX;
+	unsigned int sourceHeight = slot->bitmap.rows + offsetY;
+	std::vector<unsigned char> coverage(sourceWidth * sourceHeight, 0);
+	for(unsigned int y=0; y < slot->bitmap.rows; y++) {
+		memcpy(&coverage[(y + offsetY) * sourceWidth + offsetX], slot->bitmap.buffer + y * slot->bitmap.pitch, slot->bitmap.width);
+	}
+	
+	glyph->width = DistanceField::getOutputSize(sourceWidth, DISTANCE_FIELD_SPREAD, DISTANCE_FIELD_DOWNSAMPLE);
+	glyph->height = DistanceField::getOutputSize(sourceHeight, DISTANCE_FIELD_SPREAD, DISTANCE_FIELD_DOWNSAMPLE);
+	glyph->bitmapLeft = gridLeft - DISTANCE_FIELD_SPREAD;
+	glyph->bitmapTop = gridTop + DISTANCE_FIELD_SPREAD;
+	
+	std::vector<unsigned char> distances(glyph->width * glyph->height);
+	DistanceField::generate(&coverage[0], sourceWidth, sourceHeight, DISTANCE_FIELD_SPREAD, DISTANCE_FIELD_DOWNSAMPLE, &distances[0]);
+	
+	Image *glyphImage = new Image(glyph->width, glyph->height, Image::IMAGE_RGBA);
+	unsigned char *pixels = (unsigned char*)glyphImage->getPixels();
+	for(unsigned int i=0; i < glyph->width * glyph->height; i++) {
+		pixels[i*4] = 255;
+		pixels[i*4+1] = 255;
+		pixels[i*4+2] = 255;
+		pixels[i*4+3] = distances[i];
+	}
+	addGlyphImage(character, glyph, glyphImage);
+	delete glyphImage;
+}
+
+void GlyphCache::rasterizeGlyph(wchar_t character, GlyphInfo *glyph) {
+	if(antiAliasMode == Label::ANTIALIAS_DISTANCE_FIELD) {
+		rasterizeDistanceField(character, glyph);
+		return;
+	}
+	
+	FT_Face face = font->getFace();
+	FT_GlyphSlot slot = face->glyph;
+	FT_Set_Pixel_Sizes(face, 0, size);
+	FT_Load_Glyph(face, glyph->glyphIndex, FT_LOAD_TARGET_LIGHT);
+	
+	switch(antiAliasMode) {
+		case Label::ANTIALIAS_FULL:
+			FT_Render_Glyph(slot, FT_RENDER_MODE_LIGHT);
+		break;
+		case Label::ANTIALIAS_NONE:
+			FT_Render_Glyph(slot, FT_RENDER_MODE_MONO);
+		break;
+	}
+	
+	glyph->advance = slot->advance.x >> 6;
+	glyph->bitmapLeft = slot->bitmap_left;
+	glyph->bitmapTop = slot->bitmap_top;
+	glyph->width = slot->bitmap.width;
+	glyph->height = slot->bitmap.rows;
+	glyph->rasterized = true;
+	
+	if(!atlas || glyph->width == 0 || glyph->height == 0)
+		return;
+	
+	// glyph rows are copied top down, so the top of the glyph has the smaller v coordinate
+	Image *glyphImage = new Image(glyph->width, glyph->height, Image::IMAGE_RGBA);
+	unsigned char *pixels = (unsigned char*)glyphImage->getPixels();
+	for(unsigned int y=0; y < glyph->height; y++) {
+		unsigned char *src = slot->bitmap.buffer + y * slot->bitmap.pitch;
+		for(unsigned int x=0; x < glyph->width; x++) {
+			unsigned char *dst = pixels + (y * glyph->width + x) * 4;
+			dst[0] = 255;
+			dst[1] = 255;
+			dst[2] = 255;
+			if(antiAliasMode == Label::ANTIALIAS_NONE) {
+				dst[3] = (src[x / 8] & (0x80 >> (x % 8))) ? 255 : 0;
+			} else {
+				dst[3] = src[x];
+			}
+		}
+	}
+	
+	addGlyphImage(character, glyph, glyphImage);
+	delete glyphImage;
+}
+
+GlyphInfo *GlyphCache::getGlyph(wchar_t character, bool rasterize) {
+	std::map<wchar_t, GlyphInfo>::iterator it = glyphs.find(character);
+	GlyphInfo *glyph;
+	if(it == glyphs.end()) {
+		glyph = &glyphs[character];
+		glyph->glyphIndex = FT_Get_Char_Index(font->getFace(), (FT_ULong)character);
+		if(!rasterize) {
+			FT_Set_Pixel_Sizes(font->getFace(), 0, size);
+			FT_Load_Glyph(font->getFace(), glyph->glyphIndex, FT_LOAD_TARGET_LIGHT);
+			FT_Render_Glyph(font->getFace()->glyph, FT_RENDER_MODE_MONO);
+			glyph->advance = font->getFace()->glyph->advance.x >> 6;
+			glyph->bitmapTop = font->getFace()->glyph->bitmap_top;
+			return glyph;
+		}
+	} else {
+		glyph = &it->second;
+	}
+	
+	if(rasterize && !glyph->rasterized) {
+		rasterizeGlyph(character, glyph);
+	}
+	return glyph;
+}
+
+int GlyphCache::getKerning(unsigned int previousGlyph, unsigned int glyph) {
+	if(!previousGlyph || !glyph || !FT_HAS_KERNING(font->getFace()))
+		return 0;
+	
+	std::map<unsigned int, int> &previousKernings = kernings[previousGlyph];
+	std::map<unsigned int, int>::iterator it = previousKernings.find(glyph);
+	if(it != previousKernings.end())
+		return it->second;
+	
+	FT_Vector delta;
+	FT_Set_Pixel_Sizes(font->getFace(), 0, size);
+	FT_Get_Kerning(font->getFace(), previousGlyph, glyph, FT_KERNING_DEFAULT, &delta);
+	previousKernings[glyph] = delta.x >> 6;
+	return delta.x >> 6;
+}
+
+int GlyphCache::getTextWidth(const String& text) {
+	int width = 0;
+	unsigned int previous = 0;
+	for(int i=0; i < text.length(); i++) {
+		if(text[i] == '\t') {
+			GlyphInfo *space = getGlyph(' ', false);
+			width += space->advance * 4;
+			previous = space->glyphIndex;
+		} else {
+			GlyphInfo *glyph = getGlyph(text[i], false);
+			width += getKerning(previous, glyph->glyphIndex);
+			width += glyph->advance;
+			previous = glyph->glyphIndex;
+		}
+	}
+	return width;
+}
+
+void GlyphCache::getCharacterOffsets(const String& text, std::vector<int> *offsets) {
+	offsets->resize(text.length()+1);
+	int width = 0;
+	unsigned int previous = 0;
+	for(int i=0; i < text.length(); i++) {
+		(*offsets)[i] = width;
+		if(text[i] == '\t') {
+			GlyphInfo *space = getGlyph(' ', false);
+			width += space->advance * 4;
+			previous = space->glyphIndex;
+		} else {
+			GlyphInfo *glyph = getGlyph(text[i], false);
+			width += getKerning(previous, glyph->glyphIndex);
+			width += glyph->advance;
+			previous = glyph->glyphIndex;
+		}
+	}
+	(*offsets)[text.length()] = width;
+}
+
+int GlyphCache::getTextHeight(const String& text) {
+	int height = 0;
+	for(int i=0; i < text.length(); i++) {
+		GlyphInfo *glyph = getGlyph(text[i], false);
+		if(glyph->bitmapTop > height)
+			height = glyph->bitmapTop;
+	}
+	return height;
+}
+
+int GlyphCache::layoutText(const String& text, std::vector<GlyphQuad> *quads) {
+	int penX = 0;
+	unsigned int previous = 0;
+	for(int i=0; i < text.length(); i++) {
+		if(text[i] == '\t') {
+			GlyphInfo *space = getGlyph(' ', false);
+			penX += space->advance * 4;
+			previous = space->glyphIndex;
+			continue;
+		}
+		
+		GlyphInfo *glyph = getGlyph(text[i], true);
+		penX += getKerning(previous, glyph->glyphIndex);
+		
+		if(glyph->region) {
+			GlyphQuad quad;
+			quad.x = penX + glyph->bitmapLeft;
+			quad.y = size - glyph->bitmapTop;
+			quad.width = glyph->width;
+			quad.height = glyph->height;
+			quad.u1 = glyph->region->left;
+			quad.v1 = glyph->region->bottom;
+			quad.u2 = glyph->region->right;
+			quad.v2 = glyph->region->top;
+			quad.page = glyph->region->page;
+			quad.character = i;
+			quads->push_back(quad);
+		}
+		
+		penX += glyph->advance;
+		previous = glyph->glyphIndex;
+	}
+	return penX;
+}
@@ -0,0 +1,271 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+ 
+
+#include "PolyHeadlessCore.h"
+#include "PolyNullRenderer.h"
+#include "PolyCoreServices.h"
+#include "PolyCoreInput.h"
+#include "PolyThreaded.h"
+#include "PolyRectangle.h"
+#include "PolyLogger.h"
+#include "OSBasics.h"
+#include <stdio.h>
+
+#ifndef _WINDOWS
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+using namespace Polycode;
+using std::vector;
+
+#ifdef _WINDOWS
+DWORD WINAPI HeadlessLaunchThread(LPVOID data) {
+	Threaded *threaded = (Threaded*)data;
+	threaded->runThread();
+	return 1;
+}
+#else
+void *HeadlessLaunchThread(void *data) {
+	Threaded *threaded = (Threaded*)data;
+	threaded->runThread();
+	return NULL;
+}
+#endif
+
+HeadlessCore::HeadlessCore(int xRes, int yRes, int frameRate, bool rasterize) : Core(xRes, yRes, false, false, 0, 0, frameRate, -1) {
+#ifdef _WINDOWS
+	startTicks = GetTickCount();
+#else
+	struct timeval now;
+	gettimeofday(&now, NULL);
+	startTime = now.tv_sec * 1000.0 + now.tv_usec / 1000.0;
+	if(getenv("HOME")) {
+		userHomeDirectory = String(getenv("HOME"));
+	}
+#endif
+	
+	fixedTimestep = 0;
+	simulatedTicks = 0;
+	throttled = false;
+	frameLimit = 0;
+	frameCount = 0;
+	
+	nullRenderer = new NullRenderer();
+	renderer = nullRenderer;
+	services->setRenderer(renderer);
+	nullRenderer->Resize(xRes, yRes);
+	nullRenderer->setRasterizingEnabled(rasterize);
+}
+
+HeadlessCore::~HeadlessCore() {
+}
+
+NullRenderer *HeadlessCore::getNullRenderer() {
+	return nullRenderer;
+}
+
+void HeadlessCore::setFixedTimestep(unsigned int milliseconds) {
+	fixedTimestep = milliseconds;
+	simulatedTicks = getTicks();
+}
+
+unsigned int HeadlessCore::getFixedTimestep() const {
+	return fixedTimestep;
+}
+
+void HeadlessCore::setThrottled(bool val) {
+	throttled = val;
+}
+
+void HeadlessCore::setFrameLimit(unsigned int frames) {
+	frameLimit = frames;
+}
+
+unsigned int HeadlessCore::getFrameCount() const {
+	return frameCount;
+}
+
+unsigned int HeadlessCore::getRealTicks() const {
+#ifdef _WINDOWS
+	return GetTickCount() - startTicks;
+#else
+	struct timeval now;
+	gettimeofday(&now, NULL);
+	return (unsigned int)((now.tv_sec * 1000.0 + now.tv_usec / 1000.0) - startTime);
+#endif
+}
+
+unsigned int HeadlessCore::getTicks() {
+	if(fixedTimestep)
+		return simulatedTicks;
+	return getRealTicks();
+}
+
+bool HeadlessCore::Update() {
+	if(!running)
+		return false;
+	
+	if(fixedTimestep) {
+		simulatedTicks += fixedTimestep;
+	}
+	
+	renderer->BeginRender();
+	updateCore();
+	renderer->EndRender();
+	
+	frameCount++;
+	if(frameLimit && frameCount >= frameLimit) {
+		running = false;
+	}
+	
+	if(throttled) {
+		doSleep();
+	}
+	return running;
+}
+
+void HeadlessCore::setVideoMode(int xRes, int yRes, bool fullScreen, bool vSync, int aaLevel, int anisotropyLevel) {
+	this->xRes = xRes;
+	this->yRes = yRes;
+	this->aaLevel = aaLevel;
+	renderer->setAnisotropyAmount(anisotropyLevel);
+	renderer->Resize(xRes, yRes);
+	dispatchEvent(new Event(), EVENT_CORE_RESIZE);
+}
+
+void HeadlessCore::resizeTo(int xRes, int yRes) {
+	this->xRes = xRes;
+	this->yRes = yRes;
+	renderer->Resize(xRes, yRes);
+	dispatchEvent(new Event(), EVENT_CORE_RESIZE);
+}
+
+vector<Polycode::Rectangle> HeadlessCore::getVideoModes() {
+	vector<Polycode::Rectangle> retVector;
+	Rectangle res;
+	res.w = xRes;
+	res.h = yRes;
+	retVector.push_back(res);
+	return retVector;
+}
+
+void HeadlessCore::createThread(Threaded *target) {
+#ifdef _WINDOWS
+	DWORD threadID;
+	CreateThread(NULL, 0, HeadlessLaunchThread, target, 0, &threadID);
+#else
+	pthread_t thread;
+	if(pthread_create(&thread, NULL, HeadlessLaunchThread, (void*)target) == 0) {
+		pthread_detach(thread);
+	} else {
+		Logger::log("Error creating thread\n");
+	}
+#endif
+}
+
+void HeadlessCore::lockMutex(CoreMutex *mutex) {
+	HeadlessCoreMutex *hMutex = (HeadlessCoreMutex*)mutex;
+#ifdef _WINDOWS
+	WaitForSingleObject(hMutex->winMutex, INFINITE);
+#else
+	pthread_mutex_lock(&hMutex->pMutex);
+#endif
+}
+
+void HeadlessCore::unlockMutex(CoreMutex *mutex) {
+	HeadlessCoreMutex *hMutex = (HeadlessCoreMutex*)mutex;
+#ifdef _WINDOWS
+	ReleaseMutex(hMutex->winMutex);
+#else
+	pthread_mutex_unlock(&hMutex->pMutex);
+#endif
+}
+
+CoreMutex *HeadlessCore::createMutex() {
+	HeadlessCoreMutex *mutex = new HeadlessCoreMutex();
+#ifdef _WINDOWS
+	mutex->winMutex = CreateMutex(NULL, FALSE, NULL);
+#else
+	pthread_mutex_init(&mutex->pMutex, NULL);
+#endif
+	return mutex;
+}
+
+void HeadlessCore::setCursor(int cursorType) {
+}
+
+void HeadlessCore::copyStringToClipboard(const String& str) {
+	clipboard = str;
+}
+
+String HeadlessCore::getClipboardString() {
+	return clipboard;
+}
+
+void HeadlessCore::createFolder(const String& folderPath) {
+	OSBasics::createFolder(folderPath);
+}
+
+void HeadlessCore::copyDiskItem(const String& itemPath, const String& destItemPath) {
+	OSFILE *inFile = OSBasics::open(itemPath, "rb");
+	if(!inFile) {
+		Logger::log("Error copying %s\n", itemPath.c_str());
+		return;
+	}
+	OSFILE *outFile = OSBasics::open(destItemPath, "wb");
+	if(!outFile) {
+		Logger::log("Error copying to %s\n", destItemPath.c_str());
+		OSBasics::close(inFile);
+		return;
+	}
+	
+	char buffer[4096];
+	size_t bytesRead;
+	while((bytesRead = OSBasics::read(buffer, 1, sizeof(buffer), inFile)) > 0) {
+		OSBasics::write(buffer, 1, bytesRead, outFile);
+	}
+	
+	OSBasics::close(inFile);
+	OSBasics::close(outFile);
+}
+
+void HeadlessCore::moveDiskItem(const String& itemPath, const String& destItemPath) {
+	rename(itemPath.c_str(), destItemPath.c_str());
+}
+
+void HeadlessCore::removeDiskItem(const String& itemPath) {
+	OSBasics::removeItem(itemPath);
+}
+
+String HeadlessCore::openFolderPicker() {
+	return "";
+}
+
+vector<String> HeadlessCore::openFilePicker(vector<CoreFileExtension> extensions, bool allowMultiple) {
+	vector<String> retVector;
+	return retVector;
+}
+
+void HeadlessCore::openURL(String url) {
+}
@@ -22,6 +22,9 @@
 
 #include "PolyLabel.h"
 #include "PolyFont.h"
+#include "PolyCoreServices.h"
+#include "PolyFontManager.h"
+#include "PolyGlyphCache.h"
 
 using namespace Polycode;
 
@@ -44,64 +47,15 @@ Label::~Label() {
 }
 
 int Label::getTextWidth(Font *font, const String& text, int size) {
-	FT_Vector delta;
-	FT_UInt previous = 0;
-	FT_UInt glyph_index;
-	FT_GlyphSlot slot = font->getFace()->glyph;
-	FT_Set_Pixel_Sizes(font->getFace(), 0,  size);
-	int width = 0;
-	
-	String actualString = text; //StringUtil::replace(text, "\t", TAB_REPLACE);
+	GlyphCache *glyphCache = CoreServices::getInstance()->getFontManager()->getGlyphCache(font, size, ANTIALIAS_FULL);
 	
-	for(int i=0; i< actualString.length();i++)
-	{
-		if(actualString[i] == '\t') {
-			glyph_index = FT_Get_Char_Index( font->getFace(), ' ');			
-			FT_Load_Glyph( font->getFace(), glyph_index, NORMAL_FT_FLAGS );
-			for(int k=0 ; k < 4; k++) {
-					FT_Render_Glyph(slot, FT_RENDER_MODE_MONO);		
-					width += slot->advance.x >> 6;				
-			}
-			
-		} else {
-			glyph_index = FT_Get_Char_Index( font->getFace(), actualString[i] );
-			if(previous && glyph_index) {
-				FT_Get_Kerning(font->getFace(), previous, glyph_index, FT_KERNING_DEFAULT, &delta);
-				width += delta.x >> 6;
-			}
-			FT_Load_Glyph( font->getFace(), glyph_index, NORMAL_FT_FLAGS );
-			
-			FT_Render_Glyph(slot, FT_RENDER_MODE_MONO);
-
-		width += slot->advance.x >> 6;
-		}
-	}
-
 	// +5 pixels safety zone :)
-	return width+5;
+	return glyphCache->getTextWidth(text)+5;
 }
 
 int Label::getTextHeight(Font *font, const String& text, int size) {
-	
-	String actualString = text; //StringUtil::replace(text, "\t", TAB_REPLACE);
-	
-	int height = 0;
-	
-	FT_UInt glyph_index;
-	FT_GlyphSlot slot = font->getFace()->glyph;
-	FT_Set_Pixel_Sizes(font->getFace(), 0,  size);
-	
-	for(int i=0; i< actualString.length();i++)
-	{
-		glyph_index = FT_Get_Char_Index( font->getFace(), actualString[i] );
-		FT_Load_Glyph(font->getFace(), glyph_index, NORMAL_FT_FLAGS );
-		FT_Render_Glyph(slot, FT_RENDER_MODE_MONO);
-		
-		if(slot->bitmap_top > height)
-			height = slot->bitmap_top;
-	}
-		
-	return height;
+	GlyphCache *glyphCache = CoreServices::getInstance()->getFontManager()->getGlyphCache(font, size, ANTIALIAS_FULL);
+	return glyphCache->getTextHeight(text);
 }
 
 Number Label::getTextWidth() const {
@@ -116,6 +70,30 @@ Font *Label::getFont() const {
 	return font;
 }
 
+int Label::getSize() const {
+	return size;
+}
+
+int Label::getAntiAliasMode() const {
+	return antiAliasMode;
+}
+
+void Label::setTextWithoutRendering(const String& text) {
+	this->text = text;
+	
+	if(!font)
+		return;
+	
+	if(!font->isValid())
+		return;
+	
+	// metrics don't depend on the anti-aliasing mode, so distance field labels measure with the regular cache
+	int metricsMode = antiAliasMode == ANTIALIAS_DISTANCE_FIELD ? ANTIALIAS_FULL : antiAliasMode;
+	GlyphCache *glyphCache = CoreServices::getInstance()->getFontManager()->getGlyphCache(font, size, metricsMode);
+	currentTextWidth = glyphCache->getTextWidth(text);
+	currentTextHeight = glyphCache->getTextHeight(text);
+}
+
 const String& Label::getText() const {
 	return text;
 }
@@ -170,6 +148,7 @@ void Label::setText(const String& text) {
 		FT_Load_Glyph(font->getFace(), glyph_index, NORMAL_FT_FLAGS);
 		switch(antiAliasMode) {
 			case ANTIALIAS_FULL:
+			case ANTIALIAS_DISTANCE_FIELD:
 				FT_Render_Glyph(slot, FT_RENDER_MODE_LIGHT );			
 			break;
 			case ANTIALIAS_NONE:
@@ -182,6 +161,7 @@ void Label::setText(const String& text) {
 		
 		switch(antiAliasMode) {
 			case ANTIALIAS_FULL:
+			case ANTIALIAS_DISTANCE_FIELD:
 				for(int j = 0; j < ((slot->bitmap.width * slot->bitmap.rows)); j++) {
 					if(!(j%slot->bitmap.width) && j !=0)
 						lineoffset += (textWidth*4)-(slot->bitmap.width * 4);
@@ -0,0 +1,189 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+ 
+
+#include "PolyMappedArchive.h"
+#include "OSBasics.h"
+#include <string.h>
+
+using namespace Polycode;
+
+const char *MappedArchive::INDEX_NAME = "__polyapp.idx";
+
+MappedArchiveEntry::MappedArchiveEntry() : hash(0), nameOffset(0), nameLength(0), dataOffset(0), size(0), compressedSize(0), method(0), crc(0) {
+}
+
+MappedArchive::MappedArchive() {
+	data = NULL;
+	size = 0;
+	mappingHandle = NULL;
+	buckets = NULL;
+	bucketCount = 0;
+	records = NULL;
+	entryCount = 0;
+	names = NULL;
+	namesSize = 0;
+}
+
+MappedArchive::~MappedArchive() {
+	if(data) {
+		OSBasics::unmapFile(data, size, mappingHandle);
+	}
+}
+
+MappedArchive *MappedArchive::open(const String& fileName) {
+	MappedArchive *archive = new MappedArchive();
+	archive->fileName = fileName;
+	archive->data = OSBasics::mapFile(fileName, &archive->size, &archive->mappingHandle);
+	if(!archive->data || !archive->readIndex()) {
+		delete archive;
+		return NULL;
+	}
+	return archive;
+}
+
+unsigned int MappedArchive::readUInt(const char *data) {
+	const unsigned char *bytes = (const unsigned char*)data;
+	return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((unsigned int)bytes[3] << 24);
+}
+
+void MappedArchive::writeUInt(unsigned int value, char *data) {
+	data[0] = value & 0xFF;
+	data[1] = (value >> 8) & 0xFF;
+	data[2] = (value >> 16) & 0xFF;
+	data[3] = (value >> 24) & 0xFF;
+}
+
+unsigned int MappedArchive::hashPath(const char *path) {
+	unsigned int hash = 2166136261U;
+	while(*path) {
+		hash ^= (unsigned char)*path;
+		hash *= 16777619U;
+		path++;
+	}
+	return hash;
+}
+
+bool MappedArchive::readIndex() {
+	// The index is the first zip entry: a 30 byte local file header, the entry name, padding in the extra field and then the index itself.
+	if(size < 30 || readUInt(data) != 0x04034b50) {
+		return false;
+	}
+	unsigned int nameLength = (unsigned char)data[26] | ((unsigned char)data[27] << 8);
+	unsigned int extraLength = (unsigned char)data[28] | ((unsigned char)data[29] << 8);
+	unsigned int indexSize = readUInt(data + 18);
+	unsigned int indexOffset = 30 + nameLength + extraLength;
+	
+	if(nameLength != strlen(INDEX_NAME) || memcmp(data + 30, INDEX_NAME, nameLength) != 0) {
+		return false;
+	}
+	// bounds are checked by subtracting from what is left, so corrupt sizes can't wrap around
+	if(indexOffset > size || indexSize > size - indexOffset || indexSize < INDEX_HEADER_SIZE) {
+		return false;
+	}
+	
+	const char *index = data + indexOffset;
+	if(readUInt(index) != INDEX_MAGIC || readUInt(index + 4) != INDEX_VERSION) {
+		return false;
+	}
+	entryCount = readUInt(index + 8);
+	bucketCount = readUInt(index + 12);
+	
+	// the bucket count is a power of two so lookups can mask instead of divide
+	if(bucketCount == 0 || (bucketCount & (bucketCount - 1)) != 0 || bucketCount < entryCount) {
+		return false;
+	}
+	
+	unsigned int tablesLeft = indexSize - INDEX_HEADER_SIZE;
+	if(bucketCount > tablesLeft / 4) {
+		return false;
+	}
+	tablesLeft -= bucketCount * 4;
+	if(entryCount > tablesLeft / INDEX_RECORD_SIZE) {
+		return false;
+	}
+	unsigned int tablesSize = INDEX_HEADER_SIZE + bucketCount * 4 + entryCount * INDEX_RECORD_SIZE;
+	
+	buckets = index + INDEX_HEADER_SIZE;
+	records = buckets + bucketCount * 4;
+	names = records + entryCount * INDEX_RECORD_SIZE;
+	namesSize = indexSize - tablesSize;
+	
+	for(unsigned int i=0; i < entryCount; i++) {
+		MappedArchiveEntry entry;
+		readEntry(i, &entry);
+		if(entry.nameOffset > namesSize || entry.nameLength > namesSize - entry.nameOffset) {
+			return false;
+		}
+		if(entry.dataOffset > size || entry.compressedSize > size - entry.dataOffset) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void MappedArchive::readEntry(unsigned int index, MappedArchiveEntry *entry) const {
+	const char *record = records + index * INDEX_RECORD_SIZE;
+	entry->hash = readUInt(record);
+	entry->nameOffset = readUInt(record + 4);
+	entry->nameLength = readUInt(record + 8);
+	entry->dataOffset = readUInt(record + 12);
+	entry->size = readUInt(record + 16);
+	entry->compressedSize = readUInt(record + 20);
+	entry->method = readUInt(record + 24);
+	entry->crc = readUInt(record + 28);
+}
+
+bool MappedArchive::findEntry(const String& path, MappedArchiveEntry *entry) const {
+	const char *name = path.c_str();
+	unsigned int nameLength = path.length();
+	unsigned int hash = hashPath(name);
+	unsigned int mask = bucketCount - 1;
+	
+	// open addressing with linear probing, there is always at least one empty bucket
+	for(unsigned int i=0; i < bucketCount; i++) {
+		unsigned int index = readUInt(buckets + ((hash + i) & mask) * 4);
+		if(index == EMPTY_BUCKET || index >= entryCount) {
+			return false;
+		}
+		if(readUInt(records + index * INDEX_RECORD_SIZE) != hash) {
+			continue;
+		}
+		readEntry(index, entry);
+		if(entry->nameLength == nameLength && memcmp(names + entry->nameOffset, name, nameLength) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+const char *MappedArchive::getEntryData(const MappedArchiveEntry& entry) const {
+	return data + entry.dataOffset;
+}
+
+unsigned int MappedArchive::getNumEntries() const {
+	return entryCount;
+}
+
+const String& MappedArchive::getFileName() const {
+	return fileName;
+}
@@ -28,6 +28,7 @@
 #include "PolyRenderer.h"
 #include "PolyResourceManager.h"
 #include "PolyFixedShader.h"
+#include "PolyTextureContainer.h"
 
 #include "tinyxml.h"
 
@@ -96,6 +97,25 @@ Texture *MaterialManager::createTextureFromFile(const String& fileName, bool cla
 		return newTexture;
 	}
 	
+	vector<String> bits = fileName.split("/");
+	
+	if(fileName.length() > 5 && fileName.substr(fileName.length()-5, 5).toLowerCase() == ".ptex") {
+		TextureContainer *container = new TextureContainer();
+		if(!container->loadFromFile(fileName)) {
+			delete container;
+			Logger::log("Error loading texture container, using default texture.\n");
+			return getTextureByResourcePath("default.png");
+		}
+		newTexture = CoreServices::getInstance()->getRenderer()->createTextureFromContainer(container, clamp);
+		if(!newTexture) {
+			delete container;
+			return getTextureByResourcePath("default.png");
+		}
+		textures.push_back(newTexture);
+		newTexture->setResourcePath(bits[bits.size()-1]);
+		return newTexture;
+	}
+	
 	Image *image = new Image(fileName);
 	if(image->isLoaded()) {
 		newTexture = createTexture(image->getWidth(), image->getHeight(), image->getPixels(), clamp, createMipmaps);
@@ -107,8 +127,6 @@ Texture *MaterialManager::createTextureFromFile(const String& fileName, bool cla
 	}
 		
 	delete image;
-
-	vector<String> bits = fileName.split("/");
 	
 	newTexture->setResourcePath(bits[bits.size()-1]);
 	return newTexture;
@@ -107,46 +107,41 @@ namespace Polycode {
 	void Mesh::saveToFile(OSFILE *outFile) {				
 		unsigned int numFaces = polygons.size();
 
-		OSBasics::write(&meshType, sizeof(unsigned int), 1, outFile);		
-		OSBasics::write(&numFaces, sizeof(unsigned int), 1, outFile);
+		OSBasics::writeValue(meshType, outFile);		
+		OSBasics::writeValue(numFaces, outFile);
 		for(int i=0; i < polygons.size(); i++) {
 			
-			Vector3_struct pos;
-			Vector3_struct nor;
-			Vector4_struct col;			
-			Vector2_struct tex;
+			MeshFileVertex_struct vert;
 			
 			for(int j=0; j <  polygons[i]->getVertexCount(); j++) {
+				Vertex *vertex = polygons[i]->getVertex(j);
 				
-				pos.x =  polygons[i]->getVertex(j)->x;
-				pos.y =  polygons[i]->getVertex(j)->y;
-				pos.z =  polygons[i]->getVertex(j)->z;
-
-				nor.x =  polygons[i]->getVertex(j)->normal.x;
-				nor.y =  polygons[i]->getVertex(j)->normal.y;
-				nor.z =  polygons[i]->getVertex(j)->normal.z;
-
-				col.x =  polygons[i]->getVertex(j)->vertexColor.r;
-				col.y =  polygons[i]->getVertex(j)->vertexColor.g;
-				col.z =  polygons[i]->getVertex(j)->vertexColor.b;
-				col.w =  polygons[i]->getVertex(j)->vertexColor.a;
+				vert.pos.x = vertex->x;
+				vert.pos.y = vertex->y;
+				vert.pos.z = vertex->z;
+
+				vert.nor.x = vertex->normal.x;
+				vert.nor.y = vertex->normal.y;
+				vert.nor.z = vertex->normal.z;
+
+				vert.col.x = vertex->vertexColor.r;
+				vert.col.y = vertex->vertexColor.g;
+				vert.col.z = vertex->vertexColor.b;
+				vert.col.w = vertex->vertexColor.a;
 				
-				tex.x = polygons[i]->getVertex(j)->getTexCoord().x;
-				tex.y = polygons[i]->getVertex(j)->getTexCoord().y;
+				vert.tex.x = vertex->getTexCoord().x;
+				vert.tex.y = vertex->getTexCoord().y;
 				
-				OSBasics::write(&pos, sizeof(Vector3_struct), 1, outFile);
-				OSBasics::write(&nor, sizeof(Vector3_struct), 1, outFile);
-				OSBasics::write(&col, sizeof(Vector4_struct), 1, outFile);				
-				OSBasics::write(&tex, sizeof(Vector2_struct), 1, outFile);								
+				OSBasics::writeArray(&vert, 1, outFile, sizeof(float));
 				
-				unsigned int numBoneWeights = polygons[i]->getVertex(j)->getNumBoneAssignments();
-				OSBasics::write(&numBoneWeights, sizeof(unsigned int), 1, outFile);					
+				unsigned int numBoneWeights = vertex->getNumBoneAssignments();
+				OSBasics::writeValue(numBoneWeights, outFile);					
 				for(int b=0; b < numBoneWeights; b++) {
-					BoneAssignment *a = polygons[i]->getVertex(j)->getBoneAssignment(b);
-					unsigned int boneID = a->boneID;
-					float weight = a->weight;
-					OSBasics::write(&boneID, sizeof(unsigned int), 1, outFile);
-					OSBasics::write(&weight, sizeof(float), 1, outFile);												
+					BoneAssignment *a = vertex->getBoneAssignment(b);
+					MeshFileBoneWeight_struct boneWeight;
+					boneWeight.boneID = a->boneID;
+					boneWeight.weight = a->weight;
+					OSBasics::writeArray(&boneWeight, 1, outFile, sizeof(float));
 				}
 			}
 			
@@ -157,7 +152,7 @@ namespace Polycode {
 	void Mesh::loadFromFile(OSFILE *inFile) {
 
 		unsigned int meshType;		
-		OSBasics::read(&meshType, sizeof(unsigned int), 1, inFile);				
+		OSBasics::readValue(&meshType, inFile);				
 		setMeshType(meshType);
 		
 		int verticesPerFace;
@@ -174,36 +169,32 @@ namespace Polycode {
 		}
 		
 		unsigned int numFaces;		
-		OSBasics::read(&numFaces, sizeof(unsigned int), 1, inFile);
+		OSBasics::readValue(&numFaces, inFile);
 		
-		Vector3_struct pos;
-		Vector3_struct nor;
-		Vector4_struct col;			
-		Vector2_struct tex;
+		MeshFileVertex_struct vert;
+		MeshFileBoneWeight_struct boneWeights[16];
 		
 		for(int i=0; i < numFaces; i++) {	
 			Polygon *poly = new Polygon();			
 			
 			for(int j=0; j < verticesPerFace; j++) {
-				OSBasics::read(&pos, sizeof(Vector3_struct), 1, inFile);
-				OSBasics::read(&nor, sizeof(Vector3_struct), 1, inFile);
-				OSBasics::read(&col, sizeof(Vector4_struct), 1, inFile);						
-				OSBasics::read(&tex, sizeof(Vector2_struct), 1, inFile);						
+				OSBasics::readArray(&vert, 1, inFile, sizeof(float));
 				
-				Vertex *vertex = new Vertex(pos.x, pos.y, pos.z);
-				vertex->setNormal(nor.x,nor.y, nor.z);
-				vertex->restNormal.set(nor.x,nor.y, nor.z);
-				vertex->vertexColor.setColor(col.x,col.y, col.z, col.w);
-				vertex->setTexCoord(tex.x, tex.y);
+				Vertex *vertex = new Vertex(vert.pos.x, vert.pos.y, vert.pos.z);
+				vertex->setNormal(vert.nor.x, vert.nor.y, vert.nor.z);
+				vertex->restNormal.set(vert.nor.x, vert.nor.y, vert.nor.z);
+				vertex->vertexColor.setColor(vert.col.x, vert.col.y, vert.col.z, vert.col.w);
+				vertex->setTexCoord(vert.tex.x, vert.tex.y);
 				
-				unsigned int numBoneWeights;
-				OSBasics::read(&numBoneWeights, sizeof(unsigned int), 1, inFile);								
-				for(int b=0; b < numBoneWeights; b++) {
-					float weight;
-					unsigned int boneID;
-					OSBasics::read(&boneID, sizeof(unsigned int), 1, inFile);													
-					OSBasics::read(&weight, sizeof(float), 1, inFile);																		
-					vertex->addBoneAssignment(boneID, weight);
+				unsigned int numBoneWeights = 0;
+				OSBasics::readValue(&numBoneWeights, inFile);								
+				while(numBoneWeights > 0) {
+					unsigned int batch = numBoneWeights < 16 ? numBoneWeights : 16;
+					unsigned int numRead = OSBasics::readArray(boneWeights, batch, inFile, sizeof(float));
+					for(int b=0; b < numRead; b++) {
+						vertex->addBoneAssignment(boneWeights[b].boneID, boneWeights[b].weight);
+					}
+					numBoneWeights = numRead == batch ? numBoneWeights - batch : 0;
 				}
 				
 				Number totalWeight = 0;				
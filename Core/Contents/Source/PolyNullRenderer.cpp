@@ -0,0 +1,1295 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+ 
+
+#include "PolyNullRenderer.h"
+#include "PolyLogger.h"
+#include "PolyTextureContainer.h"
+#include "PolyFixedShader.h"
+#include "PolyMaterial.h"
+#include "PolyPolygon.h"
+#include <math.h>
+#include <string.h>
+#include <stdlib.h>
+#include <algorithm>
+
+using namespace Polycode;
+
+#define NULL_RENDERER_MAX_CLIP_VERTICES 16
+
+NullTexture::NullTexture(unsigned int width, unsigned int height, char *textureData, bool clamp, bool createMipmaps, int type) : Texture(width, height, textureData, clamp, createMipmaps, type) {
+	depthBuffer = NULL;
+}
+
+NullTexture::~NullTexture() {
+	free(depthBuffer);
+}
+
+void NullTexture::setTextureData(char *data) {
+	memcpy(textureData, data, width*height*pixelSize);
+}
+
+void NullTexture::recreateFromImageData() {
+}
+
+Number *NullTexture::getDepthBuffer() {
+	if(!depthBuffer) {
+		depthBuffer = (Number*)malloc(width*height*sizeof(Number));
+		for(int i=0; i < width*height; i++) {
+			depthBuffer[i] = 1.0;
+		}
+	}
+	return depthBuffer;
+}
+
+NullCubemap::NullCubemap(Texture *t0, Texture *t1, Texture *t2, Texture *t3, Texture *t4, Texture *t5) : Cubemap(t0, t1, t2, t3, t4, t5) {
+}
+
+NullCubemap::~NullCubemap() {
+}
+
+NullVertexBuffer::NullVertexBuffer(Mesh *mesh) : VertexBuffer() {
+	if(mesh->getMeshType() == Mesh::QUAD_MESH) {
+		verticesPerFace = 4;
+	} else {
+		verticesPerFace = 3;
+	}
+	meshType = mesh->getMeshType();
+	vertexCount = 0;
+	
+	for(int i=0; i < mesh->getPolygonCount(); i++) {
+		Polygon *polygon = mesh->getPolygon(i);
+		for(int j=0; j < polygon->getVertexCount(); j++) {
+			Vertex *vertex = polygon->getVertex(j);
+			positions.push_back(vertex->x);
+			positions.push_back(vertex->y);
+			positions.push_back(vertex->z);
+			texCoords.push_back(vertex->getTexCoord().x);
+			texCoords.push_back(vertex->getTexCoord().y);
+			colors.push_back(vertex->vertexColor.r);
+			colors.push_back(vertex->vertexColor.g);
+			colors.push_back(vertex->vertexColor.b);
+			colors.push_back(vertex->vertexColor.a);
+			vertexCount++;
+		}
+	}
+}
+
+NullVertexBuffer::~NullVertexBuffer() {
+}
+
+RendererStats::RendererStats() {
+	reset();
+}
+
+void RendererStats::reset() {
+	drawCalls = 0;
+	verticesDrawn = 0;
+	trianglesRasterized = 0;
+	textureBinds = 0;
+	blendingModeChanges = 0;
+	materialApplications = 0;
+	stateChanges = 0;
+	matrixPushes = 0;
+	framebufferBinds = 0;
+	clears = 0;
+	arraysPushed = 0;
+	textureUploads = 0;
+}
+
+NullRenderer::NullRenderer() : Renderer() {
+	nearPlane = 0.1f;
+	farPlane = 100.0f;
+	
+	modelviewStack.push_back(Matrix4());
+	
+	viewportX = 0;
+	viewportY = 0;
+	viewportW = 0;
+	viewportH = 0;
+	scissorEnabled = false;
+	scissorX = 0;
+	scissorY = 0;
+	scissorW = 0;
+	scissorH = 0;
+	
+	depthTest = true;
+	depthWrite = true;
+	depthFunction = DEPTH_FUNCTION_LEQUAL;
+	backfaceCulling = false;
+	alphaTest = false;
+	fogEnabled = false;
+	colorWrite = true;
+	blendingMode = BLEND_MODE_NORMAL;
+	texturingEnabled = false;
+	vertexColor.setColor(1.0, 1.0, 1.0, 1.0);
+	
+	vertexArray = NULL;
+	texCoordArray = NULL;
+	colorArray = NULL;
+	
+	rasterizing = false;
+	framebuffer = NULL;
+	depthBuffer = NULL;
+	framebufferWidth = 0;
+	framebufferHeight = 0;
+	
+	recordDrawCalls = false;
+}
+
+NullRenderer::~NullRenderer() {
+	free(framebuffer);
+	free(depthBuffer);
+}
+
+void NullRenderer::setRasterizingEnabled(bool val) {
+	rasterizing = val;
+	if(rasterizing) {
+		allocateFramebuffer();
+	} else {
+		free(framebuffer);
+		free(depthBuffer);
+		framebuffer = NULL;
+		depthBuffer = NULL;
+		framebufferWidth = 0;
+		framebufferHeight = 0;
+	}
+}
+
+bool NullRenderer::getRasterizingEnabled() const {
+	return rasterizing;
+}
+
+void NullRenderer::setRecordDrawCalls(bool val) {
+	recordDrawCalls = val;
+	drawCalls.clear();
+}
+
+unsigned int NullRenderer::getNumDrawCalls() const {
+	return drawCalls.size();
+}
+
+const NullDrawCall& NullRenderer::getDrawCall(unsigned int index) const {
+	return drawCalls[index];
+}
+
+const RendererStats& NullRenderer::getFrameStats() const {
+	return frameStats;
+}
+
+const RendererStats& NullRenderer::getLastFrameStats() const {
+	return lastFrameStats;
+}
+
+const unsigned char *NullRenderer::getFramebuffer() const {
+	return framebuffer;
+}
+
+void NullRenderer::allocateFramebuffer() {
+	if(framebuffer && framebufferWidth == xRes && framebufferHeight == yRes)
+		return;
+	
+	free(framebuffer);
+	free(depthBuffer);
+	framebufferWidth = xRes;
+	framebufferHeight = yRes;
+	framebuffer = (unsigned char*)malloc(framebufferWidth * framebufferHeight * 4 + 4);
+	depthBuffer = (Number*)malloc(framebufferWidth * framebufferHeight * sizeof(Number) + sizeof(Number));
+	clearTarget(true, true, true);
+}
+
+Matrix4 &NullRenderer::currentMatrix() {
+	return modelviewStack[modelviewStack.size()-1];
+}
+
+void NullRenderer::setCurrentMatrix(const Matrix4 &m) {
+	modelviewStack[modelviewStack.size()-1] = m;
+}
+
+Matrix4 NullRenderer::perspectiveMatrix(Number fovY, Number aspect, Number zNear, Number zFar) const {
+	Number f = 1.0 / tan(fovY * PI / 360.0);
+	Matrix4 m;
+	m.m[0][0] = f / aspect;
+	m.m[1][1] = f;
+	m.m[2][2] = (zFar + zNear) / (zNear - zFar);
+	m.m[2][3] = -1.0;
+	m.m[3][2] = (2.0 * zFar * zNear) / (zNear - zFar);
+	m.m[3][3] = 0.0;
+	return m;
+}
+
+Matrix4 NullRenderer::orthoMatrix(Number left, Number right, Number bottom, Number top, Number zNear, Number zFar) const {
+	Matrix4 m;
+	m.m[0][0] = 2.0 / (right - left);
+	m.m[1][1] = 2.0 / (top - bottom);
+	m.m[2][2] = -2.0 / (zFar - zNear);
+	m.m[3][0] = -(right + left) / (right - left);
+	m.m[3][1] = -(top + bottom) / (top - bottom);
+	m.m[3][2] = -(zFar + zNear) / (zFar - zNear);
+	return m;
+}
+
+void NullRenderer::Resize(int xRes, int yRes) {
+	this->xRes = xRes;
+	this->yRes = yRes;
+	viewportWidth = xRes;
+	viewportHeight = yRes;
+	
+	projectionMatrix = perspectiveMatrix(fov, (Number)xRes/(Number)yRes, nearPlane, farPlane);
+	viewportX = 0;
+	viewportY = 0;
+	viewportW = xRes;
+	viewportH = yRes;
+	
+	setBlendingMode(BLEND_MODE_NORMAL);
+	depthFunction = DEPTH_FUNCTION_LEQUAL;
+	depthTest = true;
+	
+	if(rasterizing) {
+		allocateFramebuffer();
+	}
+}
+
+void NullRenderer::resetViewport() {
+	projectionMatrix = perspectiveMatrix(fov, viewportWidth/viewportHeight, nearPlane, farPlane);
+	viewportX = 0;
+	viewportY = 0;
+	viewportW = viewportWidth;
+	viewportH = viewportHeight;
+}
+
+void NullRenderer::setClippingPlanes(Number nearPlane_, Number farPlane_) {
+	nearPlane = nearPlane_;
+	farPlane = farPlane_;
+	Resize(xRes, yRes);
+}
+
+void NullRenderer::BeginRender() {
+	frameStats.reset();
+	drawCalls.clear();
+	clearBuffer(true, true);
+	loadIdentity();
+	currentTexture = NULL;
+}
+
+void NullRenderer::EndRender() {
+	lastFrameStats = frameStats;
+}
+
+void NullRenderer::countStateChange(bool *state, bool val) {
+	if(*state != val) {
+		frameStats.stateChanges++;
+		*state = val;
+	}
+}
+
+void NullRenderer::setDepthFunction(int depthFunction) {
+	if(this->depthFunction != depthFunction)
+		frameStats.stateChanges++;
+	this->depthFunction = depthFunction;
+}
+
+void NullRenderer::enableAlphaTest(bool val) {
+	countStateChange(&alphaTest, val);
+}
+
+void NullRenderer::setLineSmooth(bool val) {
+}
+
+void NullRenderer::setLineSize(Number lineSize) {
+}
+
+void NullRenderer::enableDepthWrite(bool val) {
+	countStateChange(&depthWrite, val);
+}
+
+void NullRenderer::enableDepthTest(bool val) {
+	countStateChange(&depthTest, val);
+}
+
+void NullRenderer::enableBackfaceCulling(bool val) {
+	countStateChange(&backfaceCulling, val);
+}
+
+void NullRenderer::cullFrontFaces(bool val) {
+	countStateChange(&cullingFrontFaces, val);
+}
+
+void NullRenderer::enableLighting(bool enable) {
+	lightingEnabled = enable;
+}
+
+void NullRenderer::enableFog(bool enable) {
+	countStateChange(&fogEnabled, enable);
+}
+
+void NullRenderer::setFogProperties(int fogMode, Color color, Number density, Number startDepth, Number endDepth) {
+}
+
+void NullRenderer::drawToColorBuffer(bool val) {
+	colorWrite = val;
+}
+
+void NullRenderer::setBlendingMode(int blendingMode) {
+	if(this->blendingMode != blendingMode)
+		frameStats.blendingModeChanges++;
+	this->blendingMode = blendingMode;
+}
+
+void NullRenderer::setClearColor(Number r, Number g, Number b) {
+	clearColor.setColor(r,g,b,1.0f);
+}
+
+void NullRenderer::setVertexColor(Number r, Number g, Number b, Number a) {
+	vertexColor.setColor(r,g,b,a);
+}
+
+void NullRenderer::loadIdentity() {
+	setCurrentMatrix(Matrix4());
+}
+
+void NullRenderer::pushMatrix() {
+	modelviewStack.push_back(currentMatrix());
+	frameStats.matrixPushes++;
+}
+
+void NullRenderer::popMatrix() {
+	if(modelviewStack.size() > 1)
+		modelviewStack.pop_back();
+}
+
+void NullRenderer::setModelviewMatrix(Matrix4 m) {
+	setCurrentMatrix(m);
+}
+
+void NullRenderer::multModelviewMatrix(Matrix4 m) {
+	setCurrentMatrix(m * currentMatrix());
+}
+
+Matrix4 NullRenderer::getModelviewMatrix() {
+	return currentMatrix();
+}
+
+Matrix4 NullRenderer::getProjectionMatrix() {
+	return projectionMatrix;
+}
+
+void NullRenderer::translate2D(Number x, Number y) {
+	translate3D(x, y, 0.0);
+}
+
+void NullRenderer::translate3D(Vector3 *position) {
+	translate3D(position->x, position->y, position->z);
+}
+
+void NullRenderer::translate3D(Number x, Number y, Number z) {
+	Matrix4 t;
+	t.setPosition(x, y, z);
+	setCurrentMatrix(t * currentMatrix());
+}
+
+void NullRenderer::rotate2D(Number angle) {
+	Number radians = angle * TORADIANS;
+	Matrix4 r;
+	r.m[0][0] = cos(radians);
+	r.m[0][1] = sin(radians);
+	r.m[1][0] = -sin(radians);
+	r.m[1][1] = cos(radians);
+	setCurrentMatrix(r * currentMatrix());
+}
+
+void NullRenderer::scale2D(Vector2 *scale) {
+	Vector3 scale3D(scale->x, scale->y, 1.0);
+	this->scale3D(&scale3D);
+}
+
+void NullRenderer::scale3D(Vector3 *scale) {
+	Matrix4 s;
+	s.m[0][0] = scale->x;
+	s.m[1][1] = scale->y;
+	s.m[2][2] = scale->z;
+	setCurrentMatrix(s * currentMatrix());
+}
+
+void NullRenderer::_setOrthoMode() {
+	if(!orthoMode) {
+		projectionStack.push_back(projectionMatrix);
+		projectionMatrix = orthoMatrix(-1, 1, -1, 1, nearPlane, farPlane);
+		orthoMode = true;
+	}
+	loadIdentity();
+}
+
+void NullRenderer::setOrthoMode(Number xSize, Number ySize) {
+	if(xSize == 0)
+		xSize = xRes;
+	if(ySize == 0)
+		ySize = yRes;
+	
+	setBlendingMode(BLEND_MODE_NORMAL);
+	if(!orthoMode) {
+		backfaceCulling = false;
+		projectionStack.push_back(projectionMatrix);
+		projectionMatrix = orthoMatrix(0.0, xSize, ySize, 0.0, -1.0, 1.0);
+		orthoMode = true;
+	}
+	loadIdentity();
+}
+
+void NullRenderer::setPerspectiveMode() {
+	setBlendingMode(BLEND_MODE_NORMAL);
+	if(orthoMode) {
+		depthTest = true;
+		backfaceCulling = true;
+		if(projectionStack.size() > 0) {
+			projectionMatrix = projectionStack[projectionStack.size()-1];
+			projectionStack.pop_back();
+		}
+		orthoMode = false;
+	}
+	loadIdentity();
+	sceneProjection = projectionMatrix;
+	currentTexture = NULL;
+}
+
+Vector3 NullRenderer::unprojectPoint(Number winX, Number winY, Number winZ, const Matrix4 &modelview, const Matrix4 &projection) const {
+	Matrix4 inverse = (modelview * projection).inverse();
+	Number in[4];
+	in[0] = 2.0 * (winX - viewportX) / viewportW - 1.0;
+	in[1] = 2.0 * (winY - viewportY) / viewportH - 1.0;
+	in[2] = 2.0 * winZ - 1.0;
+	in[3] = 1.0;
+	
+	Number out[4];
+	for(int i=0; i < 4; i++) {
+		out[i] = in[0] * inverse.m[0][i] + in[1] * inverse.m[1][i] + in[2] * inverse.m[2][i] + in[3] * inverse.m[3][i];
+	}
+	if(out[3] == 0.0)
+		return Vector3(0,0,0);
+	return Vector3(out[0]/out[3], out[1]/out[3], out[2]/out[3]);
+}
+
+Vector3 NullRenderer::Unproject(Number x, Number y) {
+	Number winY = viewportH - y;
+	Number winZ = 1.0;
+	if(depthBuffer && x >= 0 && x < framebufferWidth && winY >= 0 && winY < framebufferHeight) {
+		winZ = depthBuffer[((int)winY) * framebufferWidth + (int)x];
+	}
+	return unprojectPoint(x, winY, winZ, currentMatrix(), projectionMatrix);
+}
+
+Vector3 NullRenderer::projectRayFrom2DCoordinate(Number x, Number y) {
+	Matrix4 camInverse = cameraMatrix.inverse();
+	Vector3 nearVec = unprojectPoint(x, yRes - y, 0.0, camInverse, sceneProjection);
+	Vector3 farVec = unprojectPoint(x, yRes - y, 1.0, camInverse, sceneProjection);
+	
+	Vector3 dirVec = farVec - nearVec;
+	dirVec.Normalize();
+	return dirVec;
+}
+
+bool NullRenderer::test2DCoordinate(Number x, Number y, Polycode::Polygon *poly, const Matrix4 &matrix, bool billboardMode) {
+	Vector3 dirVec = projectRayFrom2DCoordinate(x, y);
+	Vector3 hitPoint;
+	
+	if(poly->getVertexCount() == 3) {
+		return rayTriangleIntersect(Vector3(0,0,0), dirVec, matrix * (*poly->getVertex(0)), matrix * (*poly->getVertex(1)), matrix * (*poly->getVertex(2)), &hitPoint);
+	} else if(poly->getVertexCount() == 4) {
+		return (rayTriangleIntersect(Vector3(0,0,0), dirVec, matrix * (*poly->getVertex(2)), matrix * (*poly->getVertex(1)), matrix * (*poly->getVertex(0)), &hitPoint) ||
+				rayTriangleIntersect(Vector3(0,0,0), dirVec, matrix * (*poly->getVertex(0)), matrix * (*poly->getVertex(3)), matrix * (*poly->getVertex(2)), &hitPoint));
+	} else {
+		return false;
+	}
+}
+
+Cubemap *NullRenderer::createCubemap(Texture *t0, Texture *t1, Texture *t2, Texture *t3, Texture *t4, Texture *t5) {
+	return new NullCubemap(t0, t1, t2, t3, t4, t5);
+}
+
+Texture *NullRenderer::createTexture(unsigned int width, unsigned int height, char *textureData, bool clamp, bool createMipmaps, int type) {
+	return new NullTexture(width, height, textureData, clamp, createMipmaps, type);
+}
+
+Texture *NullRenderer::createTextureFromContainer(TextureContainer *container, bool clamp) {
+	Image *image = container->decodeLevel(0);
+	if(!image) {
+		NullTexture *newTexture = new NullTexture(container->getWidth(), container->getHeight(), NULL, clamp, false);
+		delete container;
+		return newTexture;
+	}
+	NullTexture *newTexture = new NullTexture(image->getWidth(), image->getHeight(), image->getPixels(), clamp, container->getNumLevels() > 1, image->getType());
+	delete image;
+	delete container;
+	return newTexture;
+}
+
+Texture *NullRenderer::createFramebufferTexture(unsigned int width, unsigned int height) {
+	return new NullTexture(width, height, NULL, true, false);
+}
+
+void NullRenderer::createRenderTextures(Texture **colorBuffer, Texture **depthBuffer, int width, int height, bool floatingPointBuffer) {
+	if(colorBuffer) {
+		*colorBuffer = new NullTexture(width, height, NULL, true, false);
+	}
+	if(depthBuffer) {
+		*depthBuffer = new NullTexture(width, height, NULL, true, false);
+	}
+}
+
+void NullRenderer::updateTextureRegion(Texture *texture, unsigned int x, unsigned int y, unsigned int width, unsigned int height) {
+	frameStats.textureUploads++;
+}
+
+void NullRenderer::destroyTexture(Texture *texture) {
+	delete texture;
+}
+
+void NullRenderer::bindFrameBufferTexture(Texture *texture) {
+	if(currentFrameBufferTexture) {
+		previousFrameBufferTexture = currentFrameBufferTexture;
+	}
+	currentFrameBufferTexture = texture;
+	frameStats.framebufferBinds++;
+	clearTarget(true, true, true);
+}
+
+void NullRenderer::bindFrameBufferTextureRegion(Texture *texture, int x, int y, int width, int height, int border) {
+	if(currentFrameBufferTexture) {
+		previousFrameBufferTexture = currentFrameBufferTexture;
+	}
+	currentFrameBufferTexture = texture;
+	frameStats.framebufferBinds++;
+	scissorEnabled = true;
+	scissorX = x;
+	scissorY = y;
+	scissorW = width;
+	scissorH = height;
+	clearTarget(true, true, true);
+	
+	viewportX = x + border;
+	viewportY = y + border;
+	viewportW = width - border * 2;
+	viewportH = height - border * 2;
+	scissorX = viewportX;
+	scissorY = viewportY;
+	scissorW = viewportW;
+	scissorH = viewportH;
+}
+
+void NullRenderer::bindFrameBufferTextureClipped(Texture *texture, int x, int y, int width, int height) {
+	if(currentFrameBufferTexture) {
+		previousFrameBufferTexture = currentFrameBufferTexture;
+	}
+	currentFrameBufferTexture = texture;
+	frameStats.framebufferBinds++;
+	scissorEnabled = true;
+	scissorX = x;
+	scissorY = texture->getHeight() - y - height;
+	scissorW = width;
+	scissorH = height;
+	clearTarget(true, true, false);
+}
+
+void NullRenderer::unbindFramebuffers() {
+	scissorEnabled = false;
+	currentFrameBufferTexture = NULL;
+	if(previousFrameBufferTexture) {
+		bindFrameBufferTexture(previousFrameBufferTexture);
+		previousFrameBufferTexture = NULL;
+	}
+}
+
+void NullRenderer::getTarget(unsigned char **color, Number **depth, int *width, int *height) {
+	*color = NULL;
+	*depth = NULL;
+	*width = 0;
+	*height = 0;
+	
+	if(currentFrameBufferTexture) {
+		NullTexture *texture = (NullTexture*)currentFrameBufferTexture;
+		if(texture->getPixelSize() != 4)
+			return;
+		*color = (unsigned char*)texture->getTextureData();
+		*depth = texture->getDepthBuffer();
+		*width = texture->getWidth();
+		*height = texture->getHeight();
+	} else if(framebuffer) {
+		*color = framebuffer;
+		*depth = depthBuffer;
+		*width = framebufferWidth;
+		*height = framebufferHeight;
+	}
+}
+
+void NullRenderer::clearTarget(bool colorBuffer, bool depthBuffer, bool useClearColor) {
+	frameStats.clears++;
+	if(!rasterizing)
+		return;
+	
+	unsigned char *color;
+	Number *depth;
+	int width, height;
+	getTarget(&color, &depth, &width, &height);
+	if(!color)
+		return;
+	
+	int minX = 0, minY = 0, maxX = width, maxY = height;
+	if(scissorEnabled) {
+		minX = std::max(minX, scissorX);
+		minY = std::max(minY, scissorY);
+		maxX = std::min(maxX, scissorX + scissorW);
+		maxY = std::min(maxY, scissorY + scissorH);
+	}
+	
+	unsigned char clearPixel[4] = {0, 0, 0, 0};
+	if(useClearColor) {
+		clearPixel[0] = (unsigned char)(clearColor.r * 255.0);
+		clearPixel[1] = (unsigned char)(clearColor.g * 255.0);
+		clearPixel[2] = (unsigned char)(clearColor.b * 255.0);
+		clearPixel[3] = (unsigned char)(clearColor.a * 255.0);
+	}
+	
+	for(int y=minY; y < maxY; y++) {
+		for(int x=minX; x < maxX; x++) {
+			int index = y * width + x;
+			if(colorBuffer) {
+				memcpy(color + index * 4, clearPixel, 4);
+			}
+			if(depthBuffer) {
+				depth[index] = 1.0;
+			}
+		}
+	}
+}
+
+void NullRenderer::clearScreen() {
+	clearTarget(true, true, true);
+}
+
+void NullRenderer::clearBuffer(bool colorBuffer, bool depthBuffer) {
+	clearTarget(colorBuffer, depthBuffer, true);
+}
+
+Image *NullRenderer::renderScreenToImage() {
+	Image *retImage;
+	if(framebuffer) {
+		retImage = new Image((char*)framebuffer, framebufferWidth, framebufferHeight, Image::IMAGE_RGBA);
+	} else {
+		retImage = new Image(xRes, yRes, Image::IMAGE_RGBA);
+	}
+	return retImage;
+}
+
+void NullRenderer::setTexture(Texture *texture) {
+	if(texture == NULL) {
+		texturingEnabled = false;
+		return;
+	}
+	
+	if(renderMode == RENDER_MODE_NORMAL) {
+		texturingEnabled = true;
+		if(currentTexture != texture) {
+			frameStats.textureBinds++;
+		}
+	} else {
+		texturingEnabled = false;
+	}
+	currentTexture = texture;
+}
+
+void NullRenderer::applyMaterial(Material *material, ShaderBinding *localOptions, unsigned int shaderIndex) {
+	frameStats.materialApplications++;
+	if(!material->getShader(shaderIndex) || !shadersEnabled) {
+		setTexture(NULL);
+		return;
+	}
+	
+	switch(material->getShader(shaderIndex)->getType()) {
+		case Shader::FIXED_SHADER:
+		{
+			FixedShaderBinding *fBinding = (FixedShaderBinding*)material->getShaderBinding(shaderIndex);
+			setTexture(fBinding->getDiffuseTexture());
+		}
+		break;
+		case Shader::MODULE_SHADER:
+			currentMaterial = material;
+			setTexture(NULL);
+		break;
+	}
+}
+
+void NullRenderer::clearShader() {
+	texturingEnabled = false;
+	fogEnabled = false;
+	currentMaterial = NULL;
+}
+
+void NullRenderer::createVertexBufferForMesh(Mesh *mesh) {
+	NullVertexBuffer *buffer = new NullVertexBuffer(mesh);
+	mesh->setVertexBuffer(buffer);
+}
+
+void NullRenderer::drawVertexBuffer(VertexBuffer *buffer, bool enableColorBuffer) {
+	NullVertexBuffer *nullBuffer = (NullVertexBuffer*)buffer;
+	recordDraw(buffer->meshType, buffer->getVertexCount());
+	if(rasterizing && buffer->getVertexCount() > 0) {
+		rasterize(buffer->meshType, buffer->getVertexCount(), &nullBuffer->positions[0], 3, &nullBuffer->texCoords[0], enableColorBuffer ? &nullBuffer->colors[0] : NULL);
+	}
+}
+
+void NullRenderer::pushRenderDataArray(RenderDataArray *array) {
+	frameStats.arraysPushed++;
+	switch(array->arrayType) {
+		case RenderDataArray::VERTEX_DATA_ARRAY:
+			vertexArray = array;
+		break;
+		case RenderDataArray::COLOR_DATA_ARRAY:
+			colorArray = array;
+		break;
+		case RenderDataArray::TEXCOORD_DATA_ARRAY:
+			texCoordArray = array;
+		break;
+	}
+}
+
+RenderDataArray *NullRenderer::createRenderDataArrayForMesh(Mesh *mesh, int arrayType) {
+	RenderDataArray *newArray = createRenderDataArray(arrayType);
+	
+	int numVertices = 0;
+	for(int i=0; i < mesh->getPolygonCount(); i++) {
+		numVertices += mesh->getPolygon(i)->getVertexCount();
+	}
+	
+	free(newArray->arrayPtr);
+	float *buffer = (float*)malloc(numVertices * newArray->size * sizeof(float) + sizeof(float));
+	newArray->arrayPtr = buffer;
+	
+	int offset = 0;
+	for(int i=0; i < mesh->getPolygonCount(); i++) {
+		Polygon *polygon = mesh->getPolygon(i);
+		for(int j=0; j < polygon->getVertexCount(); j++) {
+			Vertex *vertex = polygon->getVertex(j);
+			switch(arrayType) {
+				case RenderDataArray::VERTEX_DATA_ARRAY:
+					buffer[offset+0] = vertex->x;
+					buffer[offset+1] = vertex->y;
+					buffer[offset+2] = vertex->z;
+					newArray->count++;
+				break;
+				case RenderDataArray::COLOR_DATA_ARRAY:
+					buffer[offset+0] = vertex->vertexColor.r;
+					buffer[offset+1] = vertex->vertexColor.g;
+					buffer[offset+2] = vertex->vertexColor.b;
+					buffer[offset+3] = vertex->vertexColor.a;
+				break;
+				case RenderDataArray::NORMAL_DATA_ARRAY:
+					if(polygon->useVertexNormals) {
+						buffer[offset+0] = vertex->normal.x;
+						buffer[offset+1] = vertex->normal.y;
+						buffer[offset+2] = vertex->normal.z;
+					} else {
+						buffer[offset+0] = polygon->getFaceNormal().x;
+						buffer[offset+1] = polygon->getFaceNormal().y;
+						buffer[offset+2] = polygon->getFaceNormal().z;
+					}
+				break;
+				case RenderDataArray::TANGENT_DATA_ARRAY:
+					buffer[offset+0] = vertex->tangent.x;
+					buffer[offset+1] = vertex->tangent.y;
+					buffer[offset+2] = vertex->tangent.z;
+				break;
+				case RenderDataArray::TEXCOORD_DATA_ARRAY:
+					buffer[offset+0] = vertex->getTexCoord().x;
+					buffer[offset+1] = vertex->getTexCoord().y;
+				break;
+			}
+			offset += newArray->size;
+		}
+	}
+	return newArray;
+}
+
+RenderDataArray *NullRenderer::createRenderDataArray(int arrayType) {
+	RenderDataArray *newArray = new RenderDataArray();
+	newArray->arrayType = arrayType;
+	newArray->arrayPtr = malloc(1);
+	newArray->stride = 0;
+	newArray->count = 0;
+	newArray->rendererData = NULL;
+	
+	switch (arrayType) {
+		case RenderDataArray::COLOR_DATA_ARRAY:
+			newArray->size = 4;
+		break;
+		case RenderDataArray::TEXCOORD_DATA_ARRAY:
+			newArray->size = 2;
+		break;
+		default:
+			newArray->size = 3;
+		break;
+	}
+	return newArray;
+}
+
+void NullRenderer::setRenderArrayData(RenderDataArray *array, Number *arrayData) {
+}
+
+void NullRenderer::drawArrays(int drawType) {
+	int vertexCount = vertexArray ? vertexArray->count : 0;
+	recordDraw(drawType, vertexCount);
+	
+	if(rasterizing && vertexCount > 0) {
+		rasterize(drawType, vertexCount, (float*)vertexArray->arrayPtr, vertexArray->size,
+			texCoordArray ? (float*)texCoordArray->arrayPtr : NULL,
+			colorArray ? (float*)colorArray->arrayPtr : NULL);
+	}
+	
+	vertexArray = NULL;
+	texCoordArray = NULL;
+	colorArray = NULL;
+}
+
+void NullRenderer::drawIndexedArrays(int drawType, const unsigned int *indices, unsigned int indexCount) {
+	recordDraw(drawType, indexCount);
+	
+	if(rasterizing && vertexArray && indexCount > 0) {
+		// The rasterizer walks vertices in order, so expand the indexed vertices first.
+		int positionSize = vertexArray->size;
+		std::vector<float> positions(indexCount * positionSize);
+		std::vector<float> texCoords(texCoordArray ? indexCount * 2 : 0);
+		std::vector<float> colors(colorArray ? indexCount * 4 : 0);
+		
+		for(unsigned int i=0; i < indexCount; i++) {
+			unsigned int index = indices[i];
+			for(int j=0; j < positionSize; j++) {
+				positions[i*positionSize+j] = ((float*)vertexArray->arrayPtr)[index*positionSize+j];
+			}
+			if(texCoordArray) {
+				texCoords[i*2] = ((float*)texCoordArray->arrayPtr)[index*2];
+				texCoords[i*2+1] = ((float*)texCoordArray->arrayPtr)[index*2+1];
+			}
+			if(colorArray) {
+				for(int j=0; j < 4; j++) {
+					colors[i*4+j] = ((float*)colorArray->arrayPtr)[index*4+j];
+				}
+			}
+		}
+		
+		rasterize(drawType, indexCount, &positions[0], positionSize,
+			texCoordArray ? &texCoords[0] : NULL,
+			colorArray ? &colors[0] : NULL);
+	}
+	
+	vertexArray = NULL;
+	texCoordArray = NULL;
+	colorArray = NULL;
+}
+
+void NullRenderer::drawScreenQuad(Number qx, Number qy) {
+	setOrthoMode();
+	
+	Number xscale = qx/((Number)viewportWidth) * 2.0f;
+	Number yscale = qy/((Number)viewportHeight) * 2.0f;
+	
+	float positions[12] = {
+		-1, (float)(-1 + yscale), 0,
+		-1, -1, 0,
+		(float)(-1 + xscale), -1, 0,
+		(float)(-1 + xscale), (float)(-1 + yscale), 0};
+	float texCoords[8] = {0, 1, 0, 0, 1, 0, 1, 1};
+	
+	vertexColor.setColor(1.0, 1.0, 1.0, 1.0);
+	recordDraw(Mesh::QUAD_MESH, 4);
+	if(rasterizing) {
+		rasterize(Mesh::QUAD_MESH, 4, positions, 3, texCoords, NULL);
+	}
+	
+	setPerspectiveMode();
+}
+
+void NullRenderer::recordDraw(int meshType, int vertexCount) {
+	frameStats.drawCalls++;
+	frameStats.verticesDrawn += vertexCount;
+	
+	if(!recordDrawCalls)
+		return;
+	
+	NullDrawCall drawCall;
+	drawCall.meshType = meshType;
+	drawCall.vertexCount = vertexCount;
+	drawCall.texture = texturingEnabled ? currentTexture : NULL;
+	drawCall.material = currentMaterial;
+	drawCall.renderTarget = currentFrameBufferTexture;
+	drawCall.blendingMode = blendingMode;
+	drawCall.orthoMode = orthoMode;
+	drawCall.depthTest = depthTest;
+	drawCall.depthWrite = depthWrite;
+	drawCall.modelview = currentMatrix();
+	drawCalls.push_back(drawCall);
+}
+
+void NullRenderer::rasterize(int meshType, int vertexCount, const float *positions, int positionSize, const float *texCoords, const float *colors) {
+	Matrix4 mvp = currentMatrix() * projectionMatrix;
+	
+	std::vector<RasterVertex> vertices(vertexCount);
+	for(int i=0; i < vertexCount; i++) {
+		Number x = positions[i * positionSize];
+		Number y = positions[i * positionSize + 1];
+		Number z = positionSize > 2 ? positions[i * positionSize + 2] : 0.0;
+		
+		RasterVertex &v = vertices[i];
+		v.x = x * mvp.m[0][0] + y * mvp.m[1][0] + z * mvp.m[2][0] + mvp.m[3][0];
+		v.y = x * mvp.m[0][1] + y * mvp.m[1][1] + z * mvp.m[2][1] + mvp.m[3][1];
+		v.z = x * mvp.m[0][2] + y * mvp.m[1][2] + z * mvp.m[2][2] + mvp.m[3][2];
+		v.w = x * mvp.m[0][3] + y * mvp.m[1][3] + z * mvp.m[2][3] + mvp.m[3][3];
+		
+		if(texCoords) {
+			v.u = texCoords[i * 2];
+			v.v = texCoords[i * 2 + 1];
+		} else {
+			v.u = 0.0;
+			v.v = 0.0;
+		}
+		
+		if(colors) {
+			v.r = colors[i * 4];
+			v.g = colors[i * 4 + 1];
+			v.b = colors[i * 4 + 2];
+			v.a = colors[i * 4 + 3];
+		} else {
+			v.r = vertexColor.r;
+			v.g = vertexColor.g;
+			v.b = vertexColor.b;
+			v.a = vertexColor.a;
+		}
+	}
+	
+	RasterVertex polygon[4];
+	
+	if(meshType == Mesh::LINE_MESH || renderMode == RENDER_MODE_WIREFRAME) {
+		RasterVertex w0, w1;
+		for(int i=0; i+1 < vertexCount; i++) {
+			if(vertices[i].w <= 0.0 || vertices[i+1].w <= 0.0)
+				continue;
+			toWindow(vertices[i], &w0);
+			toWindow(vertices[i+1], &w1);
+			rasterizeLine(w0, w1);
+		}
+		if(meshType != Mesh::LINE_MESH && vertexCount > 2 && vertices[0].w > 0.0 && vertices[vertexCount-1].w > 0.0) {
+			toWindow(vertices[vertexCount-1], &w0);
+			toWindow(vertices[0], &w1);
+			rasterizeLine(w0, w1);
+		}
+		return;
+	}
+	
+	switch(meshType) {
+		case Mesh::QUAD_MESH:
+			for(int i=0; i+3 < vertexCount; i += 4) {
+				for(int j=0; j < 4; j++) {
+					polygon[j] = vertices[i+j];
+				}
+				rasterizePolygon(polygon, 4);
+			}
+		break;
+		case Mesh::TRIFAN_MESH:
+			for(int i=1; i+1 < vertexCount; i++) {
+				polygon[0] = vertices[0];
+				polygon[1] = vertices[i];
+				polygon[2] = vertices[i+1];
+				rasterizePolygon(polygon, 3);
+			}
+		break;
+		case Mesh::POINT_MESH:
+		{
+			unsigned char *color;
+			Number *depth;
+			int width, height;
+			getTarget(&color, &depth, &width, &height);
+			if(!color)
+				return;
+			
+			RasterVertex point;
+			for(int i=0; i < vertexCount; i++) {
+				if(vertices[i].w <= 0.0)
+					continue;
+				toWindow(vertices[i], &point);
+				int x = (int)point.x;
+				int y = (int)point.y;
+				if(x >= 0 && y >= 0 && x < width && y < height) {
+					shadePixel(color, depth, y * width + x, point.z, point.u, point.v, point.r, point.g, point.b, point.a);
+				}
+			}
+		}
+		break;
+		default:
+			for(int i=0; i+2 < vertexCount; i += 3) {
+				for(int j=0; j < 3; j++) {
+					polygon[j] = vertices[i+j];
+				}
+				rasterizePolygon(polygon, 3);
+			}
+		break;
+	}
+}
+
+void NullRenderer::rasterizePolygon(RasterVertex *vertices, int count) {
+	// clip against the near plane (z >= -w) before the perspective divide
+	RasterVertex clipped[NULL_RENDERER_MAX_CLIP_VERTICES];
+	int clippedCount = 0;
+	
+	for(int i=0; i < count; i++) {
+		const RasterVertex &a = vertices[i];
+		const RasterVertex &b = vertices[(i+1) % count];
+		Number da = a.z + a.w;
+		Number db = b.z + b.w;
+		
+		if(da >= 0.0) {
+			clipped[clippedCount++] = a;
+		}
+		if((da >= 0.0) != (db >= 0.0)) {
+			Number t = da / (da - db);
+			RasterVertex &v = clipped[clippedCount++];
+			v.x = a.x + (b.x - a.x) * t;
+			v.y = a.y + (b.y - a.y) * t;
+			v.z = a.z + (b.z - a.z) * t;
+			v.w = a.w + (b.w - a.w) * t;
+			v.u = a.u + (b.u - a.u) * t;
+			v.v = a.v + (b.v - a.v) * t;
+			v.r = a.r + (b.r - a.r) * t;
+			v.g = a.g + (b.g - a.g) * t;
+			v.b = a.b + (b.b - a.b) * t;
+			v.a = a.a + (b.a - a.a) * t;
+		}
+	}
+	
+	if(clippedCount < 3)
+		return;
+	
+	RasterVertex windowVertices[NULL_RENDERER_MAX_CLIP_VERTICES];
+	for(int i=0; i < clippedCount; i++) {
+		if(clipped[i].w <= 0.0)
+			return;
+		toWindow(clipped[i], &windowVertices[i]);
+	}
+	
+	for(int i=1; i+1 < clippedCount; i++) {
+		rasterizeTriangle(windowVertices[0], windowVertices[i], windowVertices[i+1]);
+	}
+}
+
+void NullRenderer::toWindow(const RasterVertex &in, RasterVertex *out) const {
+	// w is replaced by 1/w and the attributes are premultiplied by it for perspective correct interpolation
+	Number invW = 1.0 / in.w;
+	out->x = viewportX + (in.x * invW + 1.0) * 0.5 * viewportW;
+	out->y = viewportY + (in.y * invW + 1.0) * 0.5 * viewportH;
+	out->z = (in.z * invW + 1.0) * 0.5;
+	out->w = invW;
+	out->u = in.u * invW;
+	out->v = in.v * invW;
+	out->r = in.r * invW;
+	out->g = in.g * invW;
+	out->b = in.b * invW;
+	out->a = in.a * invW;
+}
+
+void NullRenderer::rasterizeTriangle(const RasterVertex &v0, const RasterVertex &v1, const RasterVertex &v2) {
+	Number area = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+	if(area == 0.0)
+		return;
+	
+	if(backfaceCulling) {
+		bool frontFacing = area > 0.0;
+		if(frontFacing == cullingFrontFaces)
+			return;
+	}
+	
+	unsigned char *color;
+	Number *depth;
+	int width, height;
+	getTarget(&color, &depth, &width, &height);
+	if(!color)
+		return;
+	
+	int minX = std::max(0, (int)floor(std::min(v0.x, std::min(v1.x, v2.x))));
+	int minY = std::max(0, (int)floor(std::min(v0.y, std::min(v1.y, v2.y))));
+	int maxX = std::min(width - 1, (int)ceil(std::max(v0.x, std::max(v1.x, v2.x))));
+	int maxY = std::min(height - 1, (int)ceil(std::max(v0.y, std::max(v1.y, v2.y))));
+	if(scissorEnabled) {
+		minX = std::max(minX, scissorX);
+		minY = std::max(minY, scissorY);
+		maxX = std::min(maxX, scissorX + scissorW - 1);
+		maxY = std::min(maxY, scissorY + scissorH - 1);
+	}
+	if(minX > maxX || minY > maxY)
+		return;
+	
+	frameStats.trianglesRasterized++;
+	Number invArea = 1.0 / area;
+	
+	for(int y=minY; y <= maxY; y++) {
+		Number py = y + 0.5;
+		for(int x=minX; x <= maxX; x++) {
+			Number px = x + 0.5;
+			Number b0 = ((v1.x - px) * (v2.y - py) - (v2.x - px) * (v1.y - py)) * invArea;
+			Number b1 = ((v2.x - px) * (v0.y - py) - (v0.x - px) * (v2.y - py)) * invArea;
+			Number b2 = 1.0 - b0 - b1;
+			if(b0 < 0.0 || b1 < 0.0 || b2 < 0.0)
+				continue;
+			
+			Number invW = b0 * v0.w + b1 * v1.w + b2 * v2.w;
+			Number w = 1.0 / invW;
+			Number z = b0 * v0.z + b1 * v1.z + b2 * v2.z;
+			shadePixel(color, depth, y * width + x, z,
+				(b0 * v0.u + b1 * v1.u + b2 * v2.u) * w,
+				(b0 * v0.v + b1 * v1.v + b2 * v2.v) * w,
+				(b0 * v0.r + b1 * v1.r + b2 * v2.r) * w,
+				(b0 * v0.g + b1 * v1.g + b2 * v2.g) * w,
+				(b0 * v0.b + b1 * v1.b + b2 * v2.b) * w,
+				(b0 * v0.a + b1 * v1.a + b2 * v2.a) * w);
+		}
+	}
+}
+
+void NullRenderer::rasterizeLine(const RasterVertex &v0, const RasterVertex &v1) {
+	unsigned char *color;
+	Number *depth;
+	int width, height;
+	getTarget(&color, &depth, &width, &height);
+	if(!color)
+		return;
+	
+	Number dx = v1.x - v0.x;
+	Number dy = v1.y - v0.y;
+	int steps = (int)std::max(fabs(dx), fabs(dy)) + 1;
+	
+	for(int i=0; i <= steps; i++) {
+		Number t = ((Number)i) / steps;
+		int x = (int)(v0.x + dx * t);
+		int y = (int)(v0.y + dy * t);
+		if(x < 0 || y < 0 || x >= width || y >= height)
+			continue;
+		if(scissorEnabled && (x < scissorX || y < scissorY || x >= scissorX + scissorW || y >= scissorY + scissorH))
+			continue;
+		
+		Number invW = v0.w + (v1.w - v0.w) * t;
+		Number w = 1.0 / invW;
+		shadePixel(color, depth, y * width + x, v0.z + (v1.z - v0.z) * t,
+			(v0.u + (v1.u - v0.u) * t) * w,
+			(v0.v + (v1.v - v0.v) * t) * w,
+			(v0.r + (v1.r - v0.r) * t) * w,
+			(v0.g + (v1.g - v0.g) * t) * w,
+			(v0.b + (v1.b - v0.b) * t) * w,
+			(v0.a + (v1.a - v0.a) * t) * w);
+	}
+}
+
+void NullRenderer::shadePixel(unsigned char *color, Number *depth, int index, Number z, Number u, Number v, Number r, Number g, Number b, Number a) {
+	if(depthTest) {
+		if(depthFunction == DEPTH_FUNCTION_GREATER) {
+			if(!(z > depth[index]))
+				return;
+		} else {
+			if(!(z <= depth[index]))
+				return;
+		}
+	}
+	
+	if(texturingEnabled && currentTexture) {
+		NullTexture *texture = (NullTexture*)currentTexture;
+		int pixelSize = texture->getPixelSize();
+		if(pixelSize == 3 || pixelSize == 4) {
+			int texWidth = texture->getWidth();
+			int texHeight = texture->getHeight();
+			if(texture->clamp) {
+				u = std::max((Number)0.0, std::min((Number)1.0, u));
+				v = std::max((Number)0.0, std::min((Number)1.0, v));
+			} else {
+				u = u - floor(u);
+				v = v - floor(v);
+			}
+			int tx = std::min(texWidth - 1, (int)(u * texWidth));
+			int ty = std::min(texHeight - 1, (int)(v * texHeight));
+			const unsigned char *texel = (const unsigned char*)texture->getTextureData() + (ty * texWidth + tx) * pixelSize;
+			r *= texel[0] / 255.0;
+			g *= texel[1] / 255.0;
+			b *= texel[2] / 255.0;
+			if(pixelSize == 4)
+				a *= texel[3] / 255.0;
+		}
+	}
+	
+	if(alphaTest && a <= 0.01)
+		return;
+	
+	if(depthWrite) {
+		depth[index] = z;
+	}
+	
+	if(!colorWrite)
+		return;
+	
+	unsigned char *pixel = color + index * 4;
+	Number dr = pixel[0] / 255.0;
+	Number dg = pixel[1] / 255.0;
+	Number db = pixel[2] / 255.0;
+	Number da = pixel[3] / 255.0;
+	
+	switch(blendingMode) {
+		case BLEND_MODE_LIGHTEN:
+			dr += r * a;
+			dg += g * a;
+			db += b * a;
+			if(!premultipliedAlphaTarget)
+				da += a * a;
+		break;
+		case BLEND_MODE_COLOR:
+		{
+			Number f = std::min(a, 1.0 - da);
+			dr += r * f;
+			dg += g * f;
+			db += b * f;
+			da += a;
+		}
+		break;
+		case BLEND_MODE_PREMULTIPLIED:
+			dr = r + dr * (1.0 - a);
+			dg = g + dg * (1.0 - a);
+			db = b + db * (1.0 - a);
+			da = a + da * (1.0 - a);
+		break;
+		default:
+			dr = r * a + dr * (1.0 - a);
+			dg = g * a + dg * (1.0 - a);
+			db = b * a + db * (1.0 - a);
+			if(premultipliedAlphaTarget)
+				da = a + da * (1.0 - a);
+			else
+				da = a * a + da * (1.0 - a);
+		break;
+	}
+	
+	pixel[0] = (unsigned char)(std::max((Number)0.0, std::min((Number)1.0, dr)) * 255.0 + 0.5);
+	pixel[1] = (unsigned char)(std::max((Number)0.0, std::min((Number)1.0, dg)) * 255.0 + 0.5);
+	pixel[2] = (unsigned char)(std::max((Number)0.0, std::min((Number)1.0, db)) * 255.0 + 0.5);
+	pixel[3] = (unsigned char)(std::max((Number)0.0, std::min((Number)1.0, da)) * 255.0 + 0.5);
+}
@@ -0,0 +1,155 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+ 
+
+#include "PolyRectPacker.h"
+
+using namespace Polycode;
+
+RectPacker::RectPacker(unsigned int width, unsigned int height, bool allowRotation) : width(width), height(height), allowRotation(allowRotation) {
+	reset();
+}
+
+void RectPacker::reset() {
+	usedArea = 0;
+	freeRects.clear();
+	PackedRect area;
+	area.width = width;
+	area.height = height;
+	freeRects.push_back(area);
+}
+
+unsigned int RectPacker::getWidth() const {
+	return width;
+}
+
+unsigned int RectPacker::getHeight() const {
+	return height;
+}
+
+Number RectPacker::getOccupancy() const {
+	return ((Number)usedArea) / ((Number)width * (Number)height);
+}
+
+bool RectPacker::findPosition(unsigned int width, unsigned int height, PackedRect *result, unsigned int *bestShortSide, unsigned int *bestLongSide) const {
+	bool found = false;
+	for(int i=0; i < freeRects.size(); i++) {
+		const PackedRect &freeRect = freeRects[i];
+		for(int r=0; r < (allowRotation ? 2 : 1); r++) {
+			unsigned int w = r ? height : width;
+			unsigned int h = r ? width : height;
+			if(w > freeRect.width || h > freeRect.height)
+				continue;
+			
+			unsigned int leftoverX = freeRect.width - w;
+			unsigned int leftoverY = freeRect.height - h;
+			unsigned int shortSide = leftoverX < leftoverY ? leftoverX : leftoverY;
+			unsigned int longSide = leftoverX < leftoverY ? leftoverY : leftoverX;
+			if(!found || shortSide < *bestShortSide || (shortSide == *bestShortSide && longSide < *bestLongSide)) {
+				result->x = freeRect.x;
+				result->y = freeRect.y;
+				result->width = w;
+				result->height = h;
+				result->rotated = (r == 1);
+				*bestShortSide = shortSide;
+				*bestLongSide = longSide;
+				found = true;
+			}
+		}
+	}
+	return found;
+}
+
+bool RectPacker::insert(unsigned int width, unsigned int height, PackedRect *result) {
+	if(width == 0 || height == 0)
+		return false;
+	
+	unsigned int bestShortSide;
+	unsigned int bestLongSide;
+	if(!findPosition(width, height, result, &bestShortSide, &bestLongSide))
+		return false;
+	
+	// every free rectangle overlapping the new one is replaced by its leftovers
+	newFreeRects.clear();
+	for(int i=0; i < freeRects.size(); i++) {
+		if(!splitFreeRect(freeRects[i], *result))
+			newFreeRects.push_back(freeRects[i]);
+	}
+	freeRects.swap(newFreeRects);
+	pruneFreeRects();
+	
+	usedArea += (unsigned long)width * height;
+	return true;
+}
+
+bool RectPacker::splitFreeRect(const PackedRect &freeRect, const PackedRect &usedRect) {
+	if(usedRect.x >= freeRect.x + freeRect.width || usedRect.x + usedRect.width <= freeRect.x ||
+		usedRect.y >= freeRect.y + freeRect.height || usedRect.y + usedRect.height <= freeRect.y)
+		return false;
+	
+	PackedRect rect;
+	if(usedRect.x > freeRect.x) {
+		rect = freeRect;
+		rect.width = usedRect.x - freeRect.x;
+		newFreeRects.push_back(rect);
+	}
+	if(usedRect.x + usedRect.width < freeRect.x + freeRect.width) {
+		rect = freeRect;
+		rect.x = usedRect.x + usedRect.width;
+		rect.width = (freeRect.x + freeRect.width) - rect.x;
+		newFreeRects.push_back(rect);
+	}
+	if(usedRect.y > freeRect.y) {
+		rect = freeRect;
+		rect.height = usedRect.y - freeRect.y;
+		newFreeRects.push_back(rect);
+	}
+	if(usedRect.y + usedRect.height < freeRect.y + freeRect.height) {
+		rect = freeRect;
+		rect.y = usedRect.y + usedRect.height;
+		rect.height = (freeRect.y + freeRect.height) - rect.y;
+		newFreeRects.push_back(rect);
+	}
+	return true;
+}
+
+static bool rectContains(const PackedRect &outer, const PackedRect &inner) {
+	return inner.x >= outer.x && inner.y >= outer.y &&
+		inner.x + inner.width <= outer.x + outer.width &&
+		inner.y + inner.height <= outer.y + outer.height;
+}
+
+void RectPacker::pruneFreeRects() {
+	for(int i=0; i < freeRects.size(); i++) {
+		for(int j=i+1; j < freeRects.size(); j++) {
+			if(rectContains(freeRects[j], freeRects[i])) {
+				freeRects.erase(freeRects.begin() + i);
+				i--;
+				break;
+			}
+			if(rectContains(freeRects[i], freeRects[j])) {
+				freeRects.erase(freeRects.begin() + j);
+				j--;
+			}
+		}
+	}
+}
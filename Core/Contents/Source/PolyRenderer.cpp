@@ -21,7 +21,9 @@
 */
 
 #include "PolyRenderer.h"
+#include "PolyEntity.h"
 #include "PolyMesh.h"
+#include <algorithm>
 
 using namespace Polycode;
 
@@ -40,10 +42,12 @@ Renderer::Renderer() : currentTexture(NULL), xRes(0), yRes(0), renderMode(0), or
 	numSpotLights = 0;	
 	exposureLevel = 1;
 	shadersEnabled = true;
+	premultipliedAlphaTarget = false;
 	currentShaderModule = NULL;
 	currentFrameBufferTexture = NULL;
 	previousFrameBufferTexture = NULL;
 	fov = 45.0;
+	currentObject = NULL;
 	setAmbientColor(0.0,0.0,0.0);
 	cullingFrontFaces = false;
 }
@@ -55,8 +59,17 @@ void Renderer::enableShaders(bool flag) {
 	shadersEnabled = flag;
 }
 
+bool Renderer::getShadersEnabled() const {
+	return shadersEnabled;
+}
+
+void Renderer::setPremultipliedAlphaTarget(bool val) {
+	premultipliedAlphaTarget = val;
+}
+
 void Renderer::setCameraMatrix(const Matrix4& matrix) {
 	cameraMatrix = matrix;
+	viewMatrix = matrix.inverse();
 }
 
 void Renderer::clearLights() {
@@ -128,12 +141,61 @@ void Renderer::addShaderModule(PolycodeShaderModule *module) {
 void Renderer::sortLights(){
 
 	sorter.basePosition = (getModelviewMatrix()).getPosition();
-	sorter.cameraMatrix = getCameraMatrix().inverse();	
+	sorter.cameraMatrix = viewMatrix;	
 	sort (areaLights.begin(), areaLights.end(), sorter);
 	sort (spotLights.begin(), spotLights.end(), sorter);	
 }
 
-void Renderer::addLight(int lightImportance, Vector3 position, Vector3 direction, int type, Color color, Color specularColor, Number constantAttenuation, Number linearAttenuation, Number quadraticAttenuation, Number intensity, Number spotlightCutoff, Number spotlightExponent, bool shadowsEnabled, Matrix4 *textureMatrix,Texture *shadowMapTexture) {
+void Renderer::selectLights(unsigned int maxAreaLights, unsigned int maxSpotLights) {
+	Vector3 objectPosition;
+	Number objectRadius = 0;
+	
+	// light positions are in world space, so the object is placed with its concatenated matrix instead of reading the modelview back
+	if(currentObject) {
+		Matrix4 worldMatrix = currentObject->getConcatenatedMatrix();
+		objectPosition = worldMatrix.getPosition();
+		
+		Number largestScale = 0;
+		for(int i=0; i < 3; i++) {
+			Number axisScale = sqrt(worldMatrix.m[i][0]*worldMatrix.m[i][0] + worldMatrix.m[i][1]*worldMatrix.m[i][1] + worldMatrix.m[i][2]*worldMatrix.m[i][2]);
+			if(axisScale > largestScale)
+				largestScale = axisScale;
+		}
+		objectRadius = currentObject->getBBoxRadius() * largestScale;
+	}
+	
+	selectLightsOfType(areaLights, selectedAreaLights, objectPosition, objectRadius, maxAreaLights);
+	selectLightsOfType(spotLights, selectedSpotLights, objectPosition, objectRadius, maxSpotLights);
+}
+
+void Renderer::selectLightsOfType(const std::vector<LightInfo> &sourceLights, std::vector<LightInfo> &targetLights, const Vector3 &objectPosition, Number objectRadius, unsigned int maxLights) {
+	targetLights.clear();
+	if(maxLights == 0)
+		return;
+	
+	lightCandidates.clear();
+	for(int i=0; i < sourceLights.size(); i++) {
+		LightCandidate candidate;
+		candidate.light = &sourceLights[i];
+		candidate.distance = sourceLights[i].position.distance(objectPosition);
+		if(sourceLights[i].range >= 0 && candidate.distance - objectRadius > sourceLights[i].range)
+			continue;
+		lightCandidates.push_back(candidate);
+	}
+	
+	if(lightCandidates.size() > maxLights) {
+		std::partial_sort(lightCandidates.begin(), lightCandidates.begin() + maxLights, lightCandidates.end());
+		lightCandidates.resize(maxLights);
+	} else {
+		std::sort(lightCandidates.begin(), lightCandidates.end());
+	}
+	
+	for(int i=0; i < lightCandidates.size(); i++) {
+		targetLights.push_back(*lightCandidates[i].light);
+	}
+}
+
+void Renderer::addLight(int lightImportance, Vector3 position, Vector3 direction, int type, Color color, Color specularColor, Number constantAttenuation, Number linearAttenuation, Number quadraticAttenuation, Number intensity, Number spotlightCutoff, Number spotlightExponent, bool shadowsEnabled, Matrix4 *textureMatrix,Texture *shadowMapTexture, Number range, Vector2 shadowMapRectMin, Vector2 shadowMapRectMax) {
 
 	numLights++;
 	
@@ -153,6 +215,9 @@ void Renderer::addLight(int lightImportance, Vector3 position, Vector3 direction
 	info.constantAttenuation = constantAttenuation;
 	info.linearAttenuation = linearAttenuation;
 	info.quadraticAttenuation = quadraticAttenuation;
+	info.range = range;
+	info.shadowMapRectMin = shadowMapRectMin;
+	info.shadowMapRectMax = shadowMapRectMax;
 			
 	info.color.set(color.r, color.g, color.b);
 	info.specularColor = specularColor;
@@ -186,7 +186,7 @@ void ResourceManager::parseTextures(const String& dirPath, bool recursive) {
 	resourceDir = OSBasics::parseFolder(dirPath, false);
 	for(int i=0; i < resourceDir.size(); i++) {	
 		if(resourceDir[i].type == OSFileEntry::TYPE_FILE) {
-			if(resourceDir[i].extension == "png") {
+			if(resourceDir[i].extension == "png" || resourceDir[i].extension == "ptex") {
 				Logger::log("Adding texture %s\n", resourceDir[i].nameWithoutExtension.c_str());
 				Texture *t = CoreServices::getInstance()->getMaterialManager()->createTextureFromFile(resourceDir[i].fullPath);
 				if(t) {
@@ -224,6 +224,9 @@ void ResourceManager::addArchive(const String& zipPath) {
 		Logger::log("Error adding archive to resource manager... %s\n", PHYSFS_getLastError());
 	} else {
 		Logger::log("Added archive: %s\n", zipPath.c_str());
+		if(OSBasics::addMappedArchive(zipPath)) {
+			Logger::log("Using archive index: %s\n", zipPath.c_str());
+		}
 	}
 }
 
@@ -46,6 +46,10 @@ SDLCore::SDLCore(PolycodeView *view, int _xRes, int _yRes, bool fullScreen, bool
 	String *windowTitle = (String*)view->windowData;
 
 	putenv("SDL_VIDEO_CENTERED=1");
+	
+	if(getenv("HOME")) {
+		userHomeDirectory = String(getenv("HOME"));
+	}
 
 	if(SDL_Init(SDL_INIT_VIDEO) < 0) {
 	}
@@ -33,6 +33,7 @@
 #include "PolySceneLight.h"
 #include "PolySceneMesh.h"
 #include "PolySceneManager.h"
+#include "PolyShadowMapAtlas.h"
 
 using std::vector;
 using namespace Polycode;
@@ -40,6 +41,7 @@ using namespace Polycode;
 Scene::Scene() : EventDispatcher() {
 	defaultCamera = new Camera(this);
 	activeCamera = defaultCamera;
+	renderCamera = NULL;
 	fogEnabled = false;
 	lightingEnabled = false;
 	enabled = true;
@@ -52,11 +54,15 @@ Scene::Scene() : EventDispatcher() {
 	clearColor.setColor(0.13f,0.13f,0.13f,1.0f); 
 	ambientColor.setColor(0.0,0.0,0.0,1.0);
 	useClearColor = false;	
+	shadowMapAtlas = NULL;
+	shadowMapAtlasSize = 2048;
+	shadowMapMinTileSize = 128;
 }
 
 Scene::Scene(bool virtualScene) {
 	defaultCamera = new Camera(this);
 	activeCamera = defaultCamera;	
+	renderCamera = NULL;
 	fogEnabled = false;
 	lightingEnabled = false;
 	enabled = true;
@@ -69,6 +75,9 @@ Scene::Scene(bool virtualScene) {
 	hasLightmaps = false;
 	clearColor.setColor(0.13f,0.13f,0.13f,1.0f); 
 	useClearColor = false;	
+	shadowMapAtlas = NULL;
+	shadowMapAtlasSize = 2048;
+	shadowMapMinTileSize = 128;
 }
 
 void Scene::setActiveCamera(Camera *camera) {
@@ -101,6 +110,10 @@ void Scene::Update() {
 
 Scene::~Scene() {
 	Logger::log("Cleaning scene...\n");
+	// lights can outlive the scene, so they give back their atlas tiles while the atlas still exists
+	for(int i=0; i < lights.size(); i++) {
+		lights[i]->detachFromScene();
+	}
 	if (ownsChildren) {
 		for(int i=0; i < entities.size(); i++) {	
 			delete entities[i];
@@ -109,6 +122,23 @@ Scene::~Scene() {
 	CoreServices::getInstance()->getSceneManager()->removeScene(this);
 	if (ownsCamera)
 		delete defaultCamera;
+	delete shadowMapAtlas;
+}
+
+ShadowMapAtlas *Scene::getShadowMapAtlas() {
+	if(!shadowMapAtlas) {
+		shadowMapAtlas = new ShadowMapAtlas(shadowMapAtlasSize, shadowMapMinTileSize);
+	}
+	return shadowMapAtlas;
+}
+
+void Scene::setShadowMapAtlasSize(unsigned int atlasSize, unsigned int minTileSize) {
+	if(shadowMapAtlas) {
+		Logger::log("Shadow map atlas size must be set before shadows are enabled\n");
+		return;
+	}
+	shadowMapAtlasSize = atlasSize;
+	shadowMapMinTileSize = minTileSize;
 }
 
 void Scene::enableLighting(bool enable) {
@@ -155,6 +185,10 @@ void Scene::removeEntity(SceneEntity *entity) {
 	}
 }
 
+Camera *Scene::getRenderCamera() {
+	return renderCamera;
+}
+
 Camera *Scene::getDefaultCamera() {
 	return defaultCamera;
 }
@@ -177,6 +211,7 @@ void Scene::Render(Camera *targetCamera) {
 	
 	Matrix4 textureMatrix;
 	Matrix4 *matrixPtr;
+	Vector3 position;
 	
 	
 	targetCamera->rebuildTransformMatrix();
@@ -188,13 +223,27 @@ void Scene::Render(Camera *targetCamera) {
 	
 	CoreServices::getInstance()->getRenderer()->clearLights();
 	
+	// the camera frustum is needed to cull lights before their shadow maps are rendered
+	CoreServices::getInstance()->getRenderer()->pushMatrix();
+	targetCamera->doCameraTransform();
+	targetCamera->buildFrustrumPlanes();
+	CoreServices::getInstance()->getRenderer()->popMatrix();
+	
 	for(int i=0; i < lights.size(); i++) {
 		SceneLight *light = lights[i];
 		if(!light->enabled)
 			continue;
+		
+		position = light->getPosition();
+		if(light->getParentEntity() != NULL) {
+			position = light->getParentEntity()->getConcatenatedMatrix() * position;			
+		}
+		
+		Number range = light->getRange();
+		if(range >= 0 && !targetCamera->isSphereInFrustrum(position, range))
+			continue;
 			
 		Vector3 direction;
-		Vector3 position;
 		matrixPtr = NULL;				
 		direction.x = 0;		
 		direction.y = 0;
@@ -205,6 +254,8 @@ void Scene::Render(Camera *targetCamera) {
 		direction.Normalize();
 		
 		Texture *shadowMapTexture = NULL;
+		Vector2 shadowMapRectMin(0,0);
+		Vector2 shadowMapRectMax(1,1);
 		if(light->areShadowsEnabled()) {
 			if(light->getType() == SceneLight::SPOT_LIGHT) {
 //				textureMatrix.identity();
@@ -215,23 +266,21 @@ void Scene::Render(Camera *targetCamera) {
 								  0.5f,	0.5f,	0.5f,	1.0f );
 				
 								
-				light->renderDepthMap(this);
-				textureMatrix = light->getLightViewMatrix() * matTexAdj;				
+				light->updateDepthMap(this);
+				textureMatrix = light->getLightViewMatrix() * matTexAdj * getShadowMapAtlas()->getTileTextureMatrix(light->getShadowMapTile());
+				getShadowMapAtlas()->getTileTextureRect(light->getShadowMapTile(), &shadowMapRectMin, &shadowMapRectMax);
 				matrixPtr = &textureMatrix;				
 			//	CoreServices::getInstance()->getRenderer()->addShadowMap(light->getZBufferTexture());
 				shadowMapTexture = light->getZBufferTexture();
 			}
 		}
 		
-		position = light->getPosition();
-		if(light->getParentEntity() != NULL) {
-			position = light->getParentEntity()->getConcatenatedMatrix() * position;			
-		}
-		CoreServices::getInstance()->getRenderer()->addLight(light->getLightImportance(), position, direction, light->getLightType(), light->lightColor, light->specularLightColor, light->getConstantAttenuation(), light->getLinearAttenuation(), light->getQuadraticAttenuation(), light->getIntensity(), light->getSpotlightCutoff(), light->getSpotlightExponent(), light->areShadowsEnabled(), matrixPtr, shadowMapTexture);
+		CoreServices::getInstance()->getRenderer()->addLight(light->getLightImportance(), position, direction, light->getLightType(), light->lightColor, light->specularLightColor, light->getConstantAttenuation(), light->getLinearAttenuation(), light->getQuadraticAttenuation(), light->getIntensity(), light->getSpotlightCutoff(), light->getSpotlightExponent(), light->areShadowsEnabled(), matrixPtr, shadowMapTexture, range, shadowMapRectMin, shadowMapRectMax);
 	}	
 	
 	targetCamera->doCameraTransform();
 	targetCamera->buildFrustrumPlanes();
+	renderCamera = targetCamera;
 	
 	if(targetCamera->getOrthoMode()) {
 		CoreServices::getInstance()->getRenderer()->_setOrthoMode();
@@ -258,6 +307,7 @@ void Scene::Render(Camera *targetCamera) {
 		CoreServices::getInstance()->getRenderer()->setPerspectiveMode();
 	}
 	
+	renderCamera = NULL;
 }
 
 
@@ -273,6 +323,7 @@ void Scene::RenderDepthOnly(Camera *targetCamera) {
 	targetCamera->rebuildTransformMatrix();	
 	targetCamera->doCameraTransform();	
 	targetCamera->buildFrustrumPlanes();
+	renderCamera = targetCamera;
 	
 	CoreServices::getInstance()->getRenderer()->setTexture(NULL);
 	CoreServices::getInstance()->getRenderer()->enableShaders(false);
@@ -288,6 +339,7 @@ void Scene::RenderDepthOnly(Camera *targetCamera) {
 	}	
 	CoreServices::getInstance()->getRenderer()->enableShaders(true);
 	CoreServices::getInstance()->getRenderer()->cullFrontFaces(false);	
+	renderCamera = NULL;
 }
 
 void Scene::addLight(SceneLight *light) {
@@ -297,6 +349,7 @@ void Scene::addLight(SceneLight *light) {
 
 void Scene::removeLight(SceneLight *light) {
 	removeEntity(light);
+	light->detachFromScene();
 	for(int i=0; i < lights.size(); i++) {
 		if(lights[i] == light) {
 			lights.erase(lights.begin()+i);
@@ -22,53 +22,137 @@
 
 #include "PolySceneLabel.h"
 #include "PolyCoreServices.h"
+#include "PolyFont.h"
 #include "PolyFontManager.h"
+#include "PolyGlyphCache.h"
 #include "PolyLabel.h"
+#include "PolyLogger.h"
 #include "PolyMesh.h"
 #include "PolyPolygon.h"
 #include "PolyRenderer.h"
 #include "PolyMaterialManager.h"
+#include "PolyTextureAtlas.h"
 
 using namespace Polycode;
 
 SceneLabel::SceneLabel(const String& fontName, const String& text, int size, Number scale, int amode) : ScenePrimitive(ScenePrimitive::TYPE_PLANE, 1, 1) {
-	label = new Label(CoreServices::getInstance()->getFontManager()->getFontByName(fontName), text, size, amode);
+	distanceFieldMaterial = NULL;
+	if(amode == Label::ANTIALIAS_DISTANCE_FIELD) {
+		setMaterialByName("DistanceFieldText");
+		distanceFieldMaterial = material;
+		if(!distanceFieldMaterial) {
+			Logger::log("DistanceFieldText material not found, using regular anti-aliased text\n");
+			amode = Label::ANTIALIAS_FULL;
+		}
+	}
+	
+	label = new Label(CoreServices::getInstance()->getFontManager()->getFontByName(fontName), "", size, amode);
 	this->scale = scale;
+	labelTexture = NULL;
 	setText(text);
 	mesh->arrayDirtyMap[RenderDataArray::TEXCOORD_DATA_ARRAY] = true;
 }
 
 SceneLabel::~SceneLabel() {
+	if(labelTexture)
+		CoreServices::getInstance()->getMaterialManager()->deleteTexture(labelTexture);
+	delete label;
 }
 
 Label *SceneLabel::getLabel() {
 	return label;
 }
 
-void SceneLabel::setText(const String& newText) {
-	if(texture)
-		CoreServices::getInstance()->getMaterialManager()->deleteTexture(texture);
+bool SceneLabel::buildGlyphMesh(const String& text) {
+	Font *font = label->getFont();
+	if(!font || !font->isValid())
+		return false;
+	
+	GlyphCache *glyphCache;
+	Number glyphScale = 1.0;
+	if(distanceFieldMaterial) {
+		glyphCache = CoreServices::getInstance()->getFontManager()->getDistanceFieldCache(font);
+		glyphScale = (Number)label->getSize() / (Number)glyphCache->getSize();
+	} else {
+		glyphCache = CoreServices::getInstance()->getFontManager()->getGlyphCache(font, label->getSize(), label->getAntiAliasMode());
+	}
+	
+	std::vector<GlyphQuad> quads;
+	glyphCache->layoutText(text, &quads);
+	
+	// a label is drawn with a single texture, so all of its glyphs have to be on one atlas page
+	for(int i=1; i < quads.size(); i++) {
+		if(quads[i].page != quads[0].page)
+			return false;
+	}
+	
+	label->setTextWithoutRendering(text);
+	Number width = Label::getTextWidth(font, text, label->getSize());
+	Number height = label->getSize() + Label::getTextHeight(font, text, label->getSize());
+	
+	mesh = new Mesh(Mesh::QUAD_MESH);
+	for(int i=0; i < quads.size(); i++) {
+		Number left = (quads[i].x * glyphScale - width/2.0f) * scale;
+		Number right = ((quads[i].x + quads[i].width) * glyphScale - width/2.0f) * scale;
+		Number top = (height/2.0f - quads[i].y * glyphScale) * scale;
+		Number bottom = (height/2.0f - (quads[i].y + quads[i].height) * glyphScale) * scale;
 		
-	label->setText(newText);	
-	texture = CoreServices::getInstance()->getMaterialManager()->createTextureFromImage(label);
-
-	if(material) {
-		localShaderOptions->clearTexture("diffuse");
-		localShaderOptions->addTexture("diffuse", texture);	
+		Polygon *polygon = new Polygon();
+		polygon->addVertex(left, bottom, 0, quads[i].u1, quads[i].v2);
+		polygon->addVertex(right, bottom, 0, quads[i].u2, quads[i].v2);
+		polygon->addVertex(right, top, 0, quads[i].u2, quads[i].v1);
+		polygon->addVertex(left, top, 0, quads[i].u1, quads[i].v1);
+		mesh->addPolygon(polygon);
+	}
+	mesh->calculateNormals();
+	mesh->calculateTangents();
+	
+	if(quads.size() > 0) {
+		texture = glyphCache->getAtlas()->getPageTexture(quads[0].page);
 	}
+	bBoxRadius = width*scale;
+	return true;
+}
 
-	delete mesh;
+void SceneLabel::buildImageMesh() {
+	labelTexture = CoreServices::getInstance()->getMaterialManager()->createTextureFromImage(label);
+	texture = labelTexture;
+	
 	mesh = new Mesh(Mesh::QUAD_MESH);
 	mesh->createVPlane(label->getWidth()*scale,label->getHeight()*scale);
 	
 	for(int i=0; i < mesh->getPolygonCount(); i++) {
 		mesh->getPolygon(i)->flipUVY();
 	}
+	bBoxRadius = label->getWidth()*scale;
+}
+
+void SceneLabel::setText(const String& newText) {
+	if(labelTexture) {
+		CoreServices::getInstance()->getMaterialManager()->deleteTexture(labelTexture);
+		labelTexture = NULL;
+	}
+	texture = NULL;
+	
+	delete mesh;
+	bool glyphMesh = buildGlyphMesh(newText);
+	if(!glyphMesh) {
+		label->setText(newText);
+		buildImageMesh();
+	}
+	
+	// the rasterized fallback holds coverage rather than distances
+	if(distanceFieldMaterial)
+		material = glyphMesh ? distanceFieldMaterial : NULL;
+	
+	if(material) {
+		localShaderOptions->clearTexture("diffuse");
+		if(texture)
+			localShaderOptions->addTexture("diffuse", texture);	
+	}
 	
 	if(useVertexBuffer)
 		CoreServices::getInstance()->getRenderer()->createVertexBufferForMesh(mesh);
 	
 	// TODO: resize it here
-	
-	bBoxRadius = label->getWidth()*scale;
 }
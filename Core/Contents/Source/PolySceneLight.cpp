@@ -36,6 +36,7 @@ SceneLight::SceneLight(int type, Scene *parentScene, Number intensity, Number co
 	this->constantAttenuation = constantAttenuation;
 	this->linearAttenuation = linearAttenuation;
 	this->quadraticAttenuation = quadraticAttenuation;
+	rangeCutoff = 1.0/256.0;
 	
 	spotlightCutoff = 40;
 	spotlightExponent = 10;
@@ -48,6 +49,7 @@ SceneLight::SceneLight(int type, Scene *parentScene, Number intensity, Number co
 	shadowMapFOV = 60.0f;
 	zBufferTexture = NULL;
 	spotCamera = NULL;
+	shadowMapDirty = true;
 	this->parentScene = parentScene;
 	shadowsEnabled = false;
 	lightColor.setColor(1.0f,1.0f,1.0f,1.0f);
@@ -92,18 +94,29 @@ void SceneLight::enableDebugDraw(bool val) {
 }
 
 void SceneLight::enableShadows(bool val, Number resolution) {
+	if(!parentScene) {
+		shadowsEnabled = false;
+		return;
+	}
 	if(val) {
-		if(!zBufferTexture) {
-			CoreServices::getInstance()->getRenderer()->createRenderTextures(NULL, &zBufferTexture, resolution, resolution, false);
+		ShadowMapAtlas *atlas = parentScene->getShadowMapAtlas();
+		atlas->freeTile(&shadowMapTile);
+		if(!atlas->allocateTile(resolution, &shadowMapTile)) {
+			shadowsEnabled = false;
+			return;
 		}
+		zBufferTexture = atlas->getTexture();
 		if(!spotCamera) {
 			spotCamera = new Camera(parentScene);
 //			spotCamera->setPitch(-45.0f);
 			addEntity(spotCamera);	
 		}
-		shadowMapRes = resolution;
+		shadowMapRes = shadowMapTile.size;
 		shadowsEnabled = true;
+		shadowMapDirty = true;
 	} else {
+		if(shadowMapTile.isValid())
+			parentScene->getShadowMapAtlas()->freeTile(&shadowMapTile);
 		shadowsEnabled = false;
 	}
 }
@@ -119,16 +132,114 @@ void SceneLight::setAttenuation(Number constantAttenuation, Number linearAttenua
 }			
 
 
+void SceneLight::setRangeCutoff(Number cutoff) {
+	rangeCutoff = cutoff;
+}
+
+Number SceneLight::getRange() const {
+	if(rangeCutoff <= 0)
+		return -1;
+	
+	// solve intensity / (c + l*d + q*d^2) = cutoff for d
+	Number c = constantAttenuation - (intensity / rangeCutoff);
+	if(c >= 0)
+		return 0;
+	if(quadraticAttenuation > 0) {
+		return (-linearAttenuation + sqrt(linearAttenuation*linearAttenuation - 4.0 * quadraticAttenuation * c)) / (2.0 * quadraticAttenuation);
+	}
+	if(linearAttenuation > 0) {
+		return -c / linearAttenuation;
+	}
+	return -1;
+}
+
 void SceneLight::setIntensity(Number newIntensity) {
 	intensity = newIntensity;
 }
 
 void SceneLight::setShadowMapFOV(Number fov) {
 	shadowMapFOV = fov;
+	shadowMapDirty = true;
 }
 
 SceneLight::~SceneLight() {
 	printf("Destroying scene light...\n");
+	detachFromScene();
+}
+
+void SceneLight::detachFromScene() {
+	if(parentScene && shadowMapTile.isValid())
+		parentScene->getShadowMapAtlas()->freeTile(&shadowMapTile);
+	shadowsEnabled = false;
+	zBufferTexture = NULL;
+	parentScene = NULL;
+}
+
+const ShadowMapTile &SceneLight::getShadowMapTile() const {
+	return shadowMapTile;
+}
+
+void SceneLight::invalidateShadowMap() {
+	shadowMapDirty = true;
+}
+
+static bool matricesEqual(const Matrix4 &m1, const Matrix4 &m2) {
+	for(int i=0; i < 16; i++) {
+		if(m1.ml[i] != m2.ml[i])
+			return false;
+	}
+	return true;
+}
+
+void SceneLight::getShadowCasters(Scene *scene, std::vector<ShadowCasterState> &casters) {
+	casters.clear();
+	for(int i=0; i < scene->getNumEntities(); i++) {
+		SceneEntity *entity = scene->getEntity(i);
+		if(!entity->castShadows)
+			continue;
+		Matrix4 transform = entity->getConcatenatedMatrix();
+		if(entity->getBBoxRadius() > 0) {
+			Number largestScale = 0;
+			for(int j=0; j < 3; j++) {
+				Number axisScale = sqrt(transform.m[j][0]*transform.m[j][0] + transform.m[j][1]*transform.m[j][1] + transform.m[j][2]*transform.m[j][2]);
+				if(axisScale > largestScale)
+					largestScale = axisScale;
+			}
+			if(!spotCamera->isSphereInFrustrum(transform.getPosition(), entity->getBBoxRadius() * largestScale))
+				continue;
+		}
+		ShadowCasterState state;
+		state.entity = entity;
+		state.transform = transform;
+		state.visible = entity->visible;
+		casters.push_back(state);
+	}
+}
+
+bool SceneLight::updateDepthMap(Scene *scene) {
+	bool needsUpdate = shadowMapDirty || !matricesEqual(getConcatenatedMatrix(), shadowMapLightMatrix);
+	
+	// the light has not moved, so the light camera frustum from the last render is still valid
+	if(!needsUpdate) {
+		getShadowCasters(scene, currentShadowCasters);
+		if(currentShadowCasters.size() != shadowCasters.size()) {
+			needsUpdate = true;
+		} else {
+			for(int i=0; i < currentShadowCasters.size(); i++) {
+				ShadowCasterState &current = currentShadowCasters[i];
+				ShadowCasterState &previous = shadowCasters[i];
+				if(current.entity != previous.entity || current.visible != previous.visible || current.entity->hasDynamicGeometry() || !matricesEqual(current.transform, previous.transform)) {
+					needsUpdate = true;
+					break;
+				}
+			}
+		}
+	}
+	
+	if(needsUpdate) {
+		renderDepthMap(scene);
+	}
+	return needsUpdate;
 }
 
 void SceneLight::renderDepthMap(Scene *scene) {
@@ -136,10 +247,15 @@ void SceneLight::renderDepthMap(Scene *scene) {
 	CoreServices::getInstance()->getRenderer()->pushMatrix();
 	CoreServices::getInstance()->getRenderer()->loadIdentity();
 
-	CoreServices::getInstance()->getRenderer()->setViewportSizeAndFOV(shadowMapRes, shadowMapRes, shadowMapFOV);	
-	CoreServices::getInstance()->getRenderer()->bindFrameBufferTexture(zBufferTexture);	
+	Number renderedRes = shadowMapRes - scene->getShadowMapAtlas()->getTileBorder() * 2;
+	CoreServices::getInstance()->getRenderer()->setViewportSizeAndFOV(renderedRes, renderedRes, shadowMapFOV);	
+	CoreServices::getInstance()->getRenderer()->bindFrameBufferTextureRegion(zBufferTexture, shadowMapTile.x, shadowMapTile.y, shadowMapTile.size, shadowMapTile.size, scene->getShadowMapAtlas()->getTileBorder());
 
 	scene->RenderDepthOnly(spotCamera);
+	
+	shadowMapLightMatrix = getConcatenatedMatrix();
+	getShadowCasters(scene, shadowCasters);
+	shadowMapDirty = false;
 		
 	lightViewMatrix = CoreServices::getInstance()->getRenderer()->getModelviewMatrix() *  CoreServices::getInstance()->getRenderer()->getProjectionMatrix();
 	CoreServices::getInstance()->getRenderer()->unbindFramebuffers();
@@ -175,6 +175,10 @@ Skeleton *SceneMesh::getSkeleton() {
 	return skeleton;
 }
 
+bool SceneMesh::hasDynamicGeometry() const {
+	return skeleton != NULL;
+}
+
 void SceneMesh::renderMeshLocally() {
 	Renderer *renderer = CoreServices::getInstance()->getRenderer();
 	
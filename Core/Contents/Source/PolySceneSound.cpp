@@ -48,8 +48,8 @@ void SceneSoundListener::Update() {
 }
 
 
-SceneSound::SceneSound(const String& fileName, Number referenceDistance, Number maxDistance) : SceneEntity() {
-	sound = new Sound(fileName);
+SceneSound::SceneSound(const String& fileName, Number referenceDistance, Number maxDistance, bool streamed) : SceneEntity() {
+	sound = new Sound(fileName, streamed);
 	sound->setIsPositional(true);
 	sound->setPositionalProperties(referenceDistance, maxDistance);
 }
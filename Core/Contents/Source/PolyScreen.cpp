@@ -30,11 +30,19 @@
 #include "PolyRenderer.h"
 #include "PolyScreenEntity.h"
 #include "PolyScreenEvent.h"
+#include "PolyScreenSpatialHash.h"
+#include "PolyScreenSpriteBatch.h"
 #include "PolyShader.h"
 #include "PolyTexture.h"
+#include <float.h>
+#include <math.h>
 
 using namespace Polycode;
 
+RetainedScreenLayer::RetainedScreenLayer() {
+	entity = NULL;
+}
+
 Screen::Screen() : EventDispatcher() {
 	offset.x = 0;
 	offset.y = 0;
@@ -49,6 +57,17 @@ Screen::Screen() : EventDispatcher() {
 	rootEntity = new ScreenEntity();
 	addChild(rootEntity);
 	processTouchEventsAsMouse = false;
+	spriteBatch = NULL;
+	retainedRendering = false;
+	retainedInvalid = true;
+	retainedTexture = NULL;
+	retainedDepthTexture = NULL;
+	retainedScreenState = 0;
+	retainedRedrawCount = 0;
+	lastRetainedRedrawArea = 0;
+	spatialHash = NULL;
+	spatialHashDirty = true;
+	spatialHashDeletedCount = 0;
 }
 
 Screen::~Screen() {
@@ -64,6 +83,167 @@ Screen::~Screen() {
 	for(int i=0; i < localShaderOptions.size(); i++)
 		delete localShaderOptions[i];
 	delete originalSceneTexture;
+	delete spriteBatch;
+	delete spatialHash;
+	setRetainedRenderingEnabled(false);
+}
+
+void Screen::setSpatialHashEnabled(bool enabled) {
+	if(enabled && !spatialHash) {
+		spatialHash = new ScreenSpatialHash();
+	} else if(!enabled && spatialHash) {
+		delete spatialHash;
+		spatialHash = NULL;
+	}
+	spatialHashDirty = true;
+	spatialHashStates.clear();
+	hoveredEntities.clear();
+}
+
+void Screen::updateSpatialHash() {
+	if(!spatialHash)
+		return;
+	
+	if(spatialHashStates.size() != children.size()) {
+		spatialHashStates.resize(children.size());
+		spatialHashDirty = true;
+	}
+	
+	for(int i=0; i < children.size(); i++) {
+		unsigned int state = children[i]->hashInputState(2166136261u);
+		if(state != spatialHashStates[i]) {
+			spatialHashStates[i] = state;
+			spatialHashDirty = true;
+		}
+	}
+	
+	if(spatialHashDirty)
+		rebuildSpatialHash();
+}
+
+void Screen::addToSpatialHash(ScreenEntity *entity, unsigned int *order) {
+	if(!entity->enabled)
+		return;
+	
+	if(entity->processInputEvents) {
+		spatialHash->addEntity(entity, *order);
+	} else {
+		spatialHash->addEntityOrder(entity, *order);
+	}
+	(*order)++;
+	
+	for(int i=0; i < entity->getNumChildren(); i++) {
+		addToSpatialHash((ScreenEntity*)entity->getChildAtIndex(i), order);
+	}
+}
+
+void Screen::rebuildSpatialHash() {
+	spatialHash->clear();
+	
+	// same order handleInputEvent() visits entities in
+	unsigned int order = 0;
+	for(int i=children.size()-1; i >= 0; i--) {
+		addToSpatialHash(children[i], &order);
+	}
+	
+	std::vector<ScreenEntity*> stillHovered;
+	for(int i=0; i < hoveredEntities.size(); i++) {
+		if(spatialHash->getEntityOrder(hoveredEntities[i]) >= 0)
+			stillHovered.push_back(hoveredEntities[i]);
+	}
+	hoveredEntities = stillHovered;
+	
+	spatialHashDirty = false;
+	spatialHashDeletedCount = ScreenEntity::getDeletedEntityCount();
+}
+
+bool Screen::isEntityInputActive(ScreenEntity *entity) const {
+	// the entity may have been disabled or removed since the hash was built
+	Entity *current = entity;
+	while(current) {
+		if(!current->enabled)
+			return false;
+		Entity *parent = current->getParentEntity();
+		if(!parent)
+			break;
+		bool attached = false;
+		for(int i=0; i < parent->getNumChildren(); i++) {
+			if(parent->getChildAtIndex(i) == current) {
+				attached = true;
+				break;
+			}
+		}
+		if(!attached)
+			return false;
+		current = parent;
+	}
+	
+	for(int i=0; i < children.size(); i++) {
+		if(children[i] == current)
+			return true;
+	}
+	return false;
+}
+
+void Screen::routeMouseMove(Number x, Number y, int timestamp) {
+	if(spatialHashDirty || spatialHashDeletedCount != ScreenEntity::getDeletedEntityCount())
+		rebuildSpatialHash();
+	
+	std::vector<ScreenSpatialHashEntry> entries;
+	spatialHash->getEntitiesAt(x, y, &entries);
+	
+	// entities the cursor may have just left and entities being dragged need the move as well
+	const std::vector<ScreenEntity*> &draggedEntities = ScreenEntity::getDraggedEntities();
+	std::vector<ScreenEntity*> extraEntities = hoveredEntities;
+	extraEntities.insert(extraEntities.end(), draggedEntities.begin(), draggedEntities.end());
+	for(int i=0; i < extraEntities.size(); i++) {
+		int order = spatialHash->getEntityOrder(extraEntities[i]);
+		if(order < 0)
+			continue;
+		ScreenSpatialHashEntry entry;
+		entry.entity = extraEntities[i];
+		entry.order = order;
+		entries.push_back(entry);
+	}
+	std::sort(entries.begin(), entries.end(), ScreenSpatialHash::cmpOrder);
+	
+	hoveredEntities.clear();
+	for(int i=0; i < entries.size(); i++) {
+		if(i > 0 && entries[i].entity == entries[i-1].entity)
+			continue;
+		if(!isEntityInputActive(entries[i].entity))
+			continue;
+		entries[i].entity->_processMouseMove(x, y, timestamp);
+		if(entries[i].entity->isMouseOver())
+			hoveredEntities.push_back(entries[i].entity);
+	}
+}
+
+void Screen::setRetainedRenderingEnabled(bool enabled) {
+	retainedRendering = enabled;
+	retainedInvalid = true;
+	if(!enabled) {
+		if(retainedTexture)
+			CoreServices::getInstance()->getRenderer()->destroyTexture(retainedTexture);
+		if(retainedDepthTexture)
+			CoreServices::getInstance()->getRenderer()->destroyTexture(retainedDepthTexture);
+		retainedTexture = NULL;
+		retainedDepthTexture = NULL;
+		retainedLayers.clear();
+	}
+}
+
+void Screen::invalidateRetainedRender() {
+	retainedInvalid = true;
+}
+
+void Screen::setSpriteBatchingEnabled(bool enabled) {
+	if(enabled && !spriteBatch) {
+		spriteBatch = new ScreenSpriteBatch();
+	} else if(!enabled && spriteBatch) {
+		delete spriteBatch;
+		spriteBatch = NULL;
+	}
 }
 
 void Screen::setNormalizedCoordinates(bool newVal, Number yCoordinateSize) {
@@ -73,6 +253,11 @@ void Screen::setNormalizedCoordinates(bool newVal, Number yCoordinateSize) {
 
 void Screen::handleInputEvent(InputEvent *inputEvent) {
 	
+	if(spatialHash && inputEvent->getEventCode() == InputEvent::EVENT_MOUSEMOVE) {
+		routeMouseMove(inputEvent->mousePosition.x-offset.x, inputEvent->mousePosition.y-offset.y, inputEvent->timestamp);
+		return;
+	}
+	
 	for(int i=children.size()-1; i >= 0; i--) {
 		switch(inputEvent->getEventCode()) {
 		
@@ -140,6 +325,7 @@ bool Screen::cmpZindex(const ScreenEntity *left, const ScreenEntity *right) {
 
 void Screen::sortChildren() {
 	std::sort(children.begin(), children.end(), Screen::cmpZindex);
+	spatialHashDirty = true;
 	int newz = 1;
 	for(int i=0; i<children.size();i++) {
 		children[i]->zindex = newz;
@@ -287,6 +473,7 @@ ScreenEntity* Screen::removeChild(ScreenEntity *entityToRemove) {
 			children.erase(children.begin()+i);
 		}
 	}
+	spatialHashDirty = true;
 	return entityToRemove;
 }
 
@@ -306,24 +493,184 @@ ScreenEntity *Screen::getEntityAt(Number x, Number y) {
 	return NULL;
 }
 
+void Screen::updateChild(ScreenEntity *child) {
+	if(child->hasFocus && focusChild != child && child->isFocusable()) {
+		if(focusChild != NULL) {
+			focusChild->hasFocus = false;
+			focusChild->onLoseFocus();
+		}
+		focusChild = child;
+		focusChild->onGainFocus();			
+	}
+	child->doUpdates();
+	child->updateEntityMatrix();
+}
+
+static void growBounds(Vector2 *min, Vector2 *max, const Vector2 &boundsMin, const Vector2 &boundsMax) {
+	if(boundsMin.x < min->x) min->x = boundsMin.x;
+	if(boundsMin.y < min->y) min->y = boundsMin.y;
+	if(boundsMax.x > max->x) max->x = boundsMax.x;
+	if(boundsMax.y > max->y) max->y = boundsMax.y;
+}
+
+void Screen::renderRetained() {
+	for(int i=0; i<children.size();i++) {
+		updateChild(children[i]);
+	}
+	
+	int xRes = renderer->getXRes();
+	int yRes = renderer->getYRes();
+	if(retainedTexture && (retainedTexture->getWidth() != xRes || retainedTexture->getHeight() != yRes)) {
+		renderer->destroyTexture(retainedTexture);
+		renderer->destroyTexture(retainedDepthTexture);
+		retainedTexture = NULL;
+		retainedDepthTexture = NULL;
+	}
+	if(!retainedTexture) {
+		renderer->createRenderTextures(&retainedTexture, &retainedDepthTexture, xRes, yRes, false);
+		retainedInvalid = true;
+	}
+	
+	// same transform Render() applies to all children, scaled from screen units to pixels
+	Matrix4 offsetMatrix;
+	offsetMatrix.m[3][0] = offset.x;
+	offsetMatrix.m[3][1] = offset.y;
+	Matrix4 pixelMatrix;
+	if(useNormalizedCoordinates) {
+		pixelMatrix.m[0][0] = ((Number)yRes) / yCoordinateSize;
+		pixelMatrix.m[1][1] = ((Number)yRes) / yCoordinateSize;
+	}
+	Matrix4 screenMatrix = rootEntity->getConcatenatedMatrix() * offsetMatrix * pixelMatrix;
+	
+	unsigned int screenState = ScreenEntity::hashData(2166136261u, screenMatrix.ml, sizeof(Number) * 16);
+	if(screenState != retainedScreenState) {
+		retainedScreenState = screenState;
+		retainedInvalid = true;
+	}
+	
+	if(retainedLayers.size() != children.size()) {
+		retainedLayers.resize(children.size());
+		retainedInvalid = true;
+	}
+	
+	Vector2 dirtyMin(xRes, yRes);
+	Vector2 dirtyMax(0, 0);
+	for(int i=0; i < children.size(); i++) {
+		RetainedScreenLayer &layer = retainedLayers[i];
+		if(layer.entity != children[i]) {
+			layer.entity = children[i];
+			retainedInvalid = true;
+		}
+		
+		retainedNodes.clear();
+		children[i]->addRenderNodes(screenMatrix, &retainedNodes);
+		
+		if(!retainedInvalid) {
+			bool sameEntities = (retainedNodes.size() == layer.nodes.size());
+			for(int j=0; sameEntities && j < retainedNodes.size(); j++) {
+				if(retainedNodes[j].entity != layer.nodes[j].entity)
+					sameEntities = false;
+			}
+			
+			// the region an entity covered before the change has to be redrawn as well
+			for(int j=0; j < layer.nodes.size(); j++) {
+				if(sameEntities && retainedNodes[j].renderState == layer.nodes[j].renderState)
+					continue;
+				growBounds(&dirtyMin, &dirtyMax, layer.nodes[j].boundsMin, layer.nodes[j].boundsMax);
+			}
+			for(int j=0; j < retainedNodes.size(); j++) {
+				if(sameEntities && retainedNodes[j].renderState == layer.nodes[j].renderState)
+					continue;
+				growBounds(&dirtyMin, &dirtyMax, retainedNodes[j].boundsMin, retainedNodes[j].boundsMax);
+			}
+		}
+		
+		layer.nodes.swap(retainedNodes);
+		layer.boundsMin = Vector2(FLT_MAX, FLT_MAX);
+		layer.boundsMax = Vector2(-FLT_MAX, -FLT_MAX);
+		for(int j=0; j < layer.nodes.size(); j++) {
+			growBounds(&layer.boundsMin, &layer.boundsMax, layer.nodes[j].boundsMin, layer.nodes[j].boundsMax);
+		}
+	}
+	
+	if(retainedInvalid) {
+		dirtyMin = Vector2(0, 0);
+		dirtyMax = Vector2(xRes, yRes);
+	}
+	
+	int x1 = floor(dirtyMin.x) > 0 ? floor(dirtyMin.x) : 0;
+	int y1 = floor(dirtyMin.y) > 0 ? floor(dirtyMin.y) : 0;
+	int x2 = ceil(dirtyMax.x) < xRes ? ceil(dirtyMax.x) : xRes;
+	int y2 = ceil(dirtyMax.y) < yRes ? ceil(dirtyMax.y) : yRes;
+	
+	if(x2 > x1 && y2 > y1) {
+		renderer->bindFrameBufferTextureClipped(retainedTexture, x1, y1, x2-x1, y2-y1);
+		renderer->setPremultipliedAlphaTarget(true);
+		
+		renderer->loadIdentity();
+		renderer->translate2D(offset.x, offset.y);
+		renderer->multModelviewMatrix(rootEntity->getConcatenatedMatrix());
+		
+		if(spriteBatch)
+			spriteBatch->begin(getBaseMatrix());
+		
+		for(int i=0; i<children.size();i++) {
+			RetainedScreenLayer &layer = retainedLayers[i];
+			if(!retainedInvalid && (layer.boundsMax.x < x1 || layer.boundsMin.x > x2 || layer.boundsMax.y < y1 || layer.boundsMin.y > y2))
+				continue;
+			children[i]->transformAndRender();
+		}
+		
+		if(spriteBatch)
+			spriteBatch->end();
+		
+		renderer->setPremultipliedAlphaTarget(false);
+		renderer->unbindFramebuffers();
+		
+		retainedInvalid = false;
+		retainedRedrawCount++;
+		lastRetainedRedrawArea = ((Number)((x2-x1) * (y2-y1))) / ((Number)(xRes * yRes));
+	}
+	
+	renderer->loadIdentity();
+	renderer->setTexture(retainedTexture);
+	renderer->setBlendingMode(Renderer::BLEND_MODE_PREMULTIPLIED);
+	renderer->drawScreenQuad(xRes, yRes);
+	renderer->setBlendingMode(Renderer::BLEND_MODE_NORMAL);
+}
+
+Matrix4 Screen::getBaseMatrix() const {
+	// same transform as translate2D(offset) followed by the root entity's matrix
+	Matrix4 offsetMatrix;
+	offsetMatrix.m[3][0] = offset.x;
+	offsetMatrix.m[3][1] = offset.y;
+	return rootEntity->getConcatenatedMatrix() * offsetMatrix;
+}
+
 void Screen::Render() {
 	Update();
+	
+	if(retainedRendering && !_hasFilterShader) {
+		renderRetained();
+		updateSpatialHash();
+		return;
+	}
+	
 	renderer->loadIdentity();
 	renderer->translate2D(offset.x, offset.y);
 	
 	renderer->multModelviewMatrix(rootEntity->getConcatenatedMatrix());
 	
+	if(spriteBatch)
+		spriteBatch->begin(getBaseMatrix());
+	
 	for(int i=0; i<children.size();i++) {
-		if(children[i]->hasFocus && focusChild != children[i] && children[i]->isFocusable()) {
-			if(focusChild != NULL) {
-				focusChild->hasFocus = false;
-				focusChild->onLoseFocus();
-			}
-			focusChild = children[i];
-			focusChild->onGainFocus();			
-		}
-		children[i]->doUpdates();
-		children[i]->updateEntityMatrix();
+		updateChild(children[i]);
 		children[i]->transformAndRender();
 	}
+	
+	if(spriteBatch)
+		spriteBatch->end();
+	
+	updateSpatialHash();
 }
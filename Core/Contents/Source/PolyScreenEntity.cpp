@@ -26,11 +26,16 @@
 #include "PolyPolygon.h"
 #include "PolyVertex.h"
 #include "PolyRenderer.h"
+#include "PolyScreenSpriteBatch.h"
+#include <float.h>
 
 inline double round(double x) { return floor(x + 0.5); }
 
 using namespace Polycode;
 
+std::vector<ScreenEntity*> ScreenEntity::draggedEntities;
+unsigned int ScreenEntity::deletedEntityCount = 0;
+
 ScreenEntity::ScreenEntity() : Entity(), EventDispatcher() {
 	color = Color(1.0f,1.0f,1.0f,1.0f);
 	width = 1;
@@ -108,6 +113,8 @@ bool ScreenEntity::isFocusable() const {
 }
 
 void ScreenEntity::startDrag(Number xOffset, Number yOffset) {
+	if(!isDragged)
+		draggedEntities.push_back(this);
 	isDragged = true;
 	dragOffsetX = xOffset;
 	dragOffsetY = yOffset;
@@ -115,10 +122,18 @@ void ScreenEntity::startDrag(Number xOffset, Number yOffset) {
 
 void ScreenEntity::stopDrag() {
 	isDragged = false;
+	for(int i=0; i < draggedEntities.size(); i++) {
+		if(draggedEntities[i] == this) {
+			draggedEntities.erase(draggedEntities.begin()+i);
+			break;
+		}
+	}
 }
 
 ScreenEntity::~ScreenEntity() {
-
+	if(isDragged)
+		stopDrag();
+	deletedEntityCount++;
 }
 
 void ScreenEntity::setBlendingMode(int newBlendingMode) {
@@ -186,6 +201,125 @@ bool isPointInsidePolygon2D(Polycode::Polygon *poly, const Vector2 &p) {
 		return true;
 }
 
+unsigned int ScreenEntity::hashData(unsigned int hash, const void *data, unsigned int size) {
+	// FNV-1a
+	const unsigned char *bytes = (const unsigned char*)data;
+	for(unsigned int i=0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= 16777619;
+	}
+	return hash;
+}
+
+unsigned int ScreenEntity::hashRenderState(unsigned int hash) {
+	hash = hashData(hash, &enabled, sizeof(bool));
+	if(!enabled)
+		return hash;
+	
+	hash = hashData(hash, &visible, sizeof(bool));
+	hash = hashData(hash, transformMatrix.ml, sizeof(Number) * 16);
+	Number colorValues[4] = {color.r, color.g, color.b, color.a};
+	hash = hashData(hash, colorValues, sizeof(Number) * 4);
+	hash = hashData(hash, &blendingMode, sizeof(int));
+	hash = hashData(hash, &renderWireframe, sizeof(bool));
+	hash = hashData(hash, &width, sizeof(Number));
+	hash = hashData(hash, &height, sizeof(Number));
+	hash = hashData(hash, &positionMode, sizeof(int));
+	return hash;
+}
+
+unsigned int ScreenEntity::hashInputState(unsigned int hash) {
+	hash = hashData(hash, &enabled, sizeof(bool));
+	if(!enabled)
+		return hash;
+	
+	hash = hashData(hash, &processInputEvents, sizeof(bool));
+	hash = hashData(hash, transformMatrix.ml, sizeof(Number) * 16);
+	hash = hashData(hash, &hitwidth, sizeof(Number));
+	hash = hashData(hash, &hitheight, sizeof(Number));
+	
+	unsigned int numChildren = children.size();
+	hash = hashData(hash, &numChildren, sizeof(unsigned int));
+	for(int i=0; i < children.size(); i++) {
+		hash = ((ScreenEntity*)children[i])->hashInputState(hash);
+	}
+	return hash;
+}
+
+void ScreenEntity::getLocalRenderBounds(Vector2 *min, Vector2 *max) {
+	Number w = width > hitwidth ? width : hitwidth;
+	Number h = height > hitheight ? height : hitheight;
+	min->x = -w/2.0;
+	min->y = -h/2.0;
+	max->x = w/2.0;
+	max->y = h/2.0;
+}
+
+void ScreenEntity::addRenderNodes(const Matrix4 &parentMatrix, std::vector<ScreenRenderNode> *nodes) {
+	Matrix4 matrix = transformMatrix * parentMatrix;
+	
+	ScreenRenderNode node;
+	node.entity = this;
+	node.boundsMin = Vector2(FLT_MAX, FLT_MAX);
+	node.boundsMax = Vector2(-FLT_MAX, -FLT_MAX);
+	
+	// the final matrix is hashed so that moving a parent dirties everything under it
+	node.renderState = hashData(2166136261u, matrix.ml, sizeof(Number) * 16);
+	node.renderState = hashData(node.renderState, &enabled, sizeof(bool));
+	node.renderState = hashData(node.renderState, &visible, sizeof(bool));
+	if(enabled && visible) {
+		node.renderState = hashRenderState(node.renderState);
+		
+		Vector2 localMin, localMax;
+		getLocalRenderBounds(&localMin, &localMax);
+		if(localMax.x > localMin.x && localMax.y > localMin.y) {
+			Vector3 corners[4];
+			corners[0] = Vector3(localMin.x, localMin.y, 0);
+			corners[1] = Vector3(localMax.x, localMin.y, 0);
+			corners[2] = Vector3(localMax.x, localMax.y, 0);
+			corners[3] = Vector3(localMin.x, localMax.y, 0);
+			for(int i=0; i < 4; i++) {
+				Vector3 v = matrix * corners[i];
+				if(v.x < node.boundsMin.x) node.boundsMin.x = v.x;
+				if(v.y < node.boundsMin.y) node.boundsMin.y = v.y;
+				if(v.x > node.boundsMax.x) node.boundsMax.x = v.x;
+				if(v.y > node.boundsMax.y) node.boundsMax.y = v.y;
+			}
+		}
+	}
+	nodes->push_back(node);
+	
+	if(!enabled || (!visible && visibilityAffectsChildren))
+		return;
+	
+	// mirrors adjustMatrixForChildren()
+	if(positionMode == POSITION_TOPLEFT) {
+		Matrix4 adjust;
+		adjust.m[3][0] = -floor(width/2.0f);
+		adjust.m[3][1] = -floor(height/2.0f);
+		matrix = adjust * matrix;
+	}
+	for(int i=0; i < children.size(); i++) {
+		((ScreenEntity*)children[i])->addRenderNodes(matrix, nodes);
+	}
+}
+
+void ScreenEntity::getScreenHitBounds(Vector2 *min, Vector2 *max) const {
+	Matrix4 transformMatrix = getConcatenatedMatrix();
+	Vector3 corners[4];
+	corners[0] = Vector3(-hitwidth/2.0, -hitheight/2.0, 0);
+	corners[1] = Vector3(hitwidth/2.0, -hitheight/2.0, 0);
+	corners[2] = Vector3(hitwidth/2.0, hitheight/2.0, 0);
+	corners[3] = Vector3(-hitwidth/2.0, hitheight/2.0, 0);
+	for(int i=0; i < 4; i++) {
+		Vector3 v = transformMatrix * corners[i];
+		if(i == 0 || v.x < min->x) min->x = v.x;
+		if(i == 0 || v.y < min->y) min->y = v.y;
+		if(i == 0 || v.x > max->x) max->x = v.x;
+		if(i == 0 || v.y > max->y) max->y = v.y;
+	}
+}
+
 bool ScreenEntity::hitTest(const Number x, const Number y) const {
 
 	Vector3 v;	
@@ -246,6 +380,16 @@ void ScreenEntity::clearDragLimits() {
 }
 
 void ScreenEntity::_onMouseMove(Number x, Number y, int timestamp) {
+	_processMouseMove(x, y, timestamp);
+	
+	if(enabled) {
+		for(int i=0;i<children.size();i++) {
+			((ScreenEntity*)children[i])->_onMouseMove(x,y, timestamp);
+		}
+	}
+}
+
+void ScreenEntity::_processMouseMove(Number x, Number y, int timestamp) {
 
 	if(isDragged) {
 		setPosition(x-dragOffsetX,y-dragOffsetY);
@@ -279,12 +423,6 @@ void ScreenEntity::_onMouseMove(Number x, Number y, int timestamp) {
 			}
 		}
 	}
-	
-	if(enabled) {
-		for(int i=0;i<children.size();i++) {
-			((ScreenEntity*)children[i])->_onMouseMove(x,y, timestamp);
-		}
-	}
 }
 
 bool ScreenEntity::_onMouseUp(Number x, Number y, int mouseButton, int timestamp) {
@@ -481,7 +619,23 @@ Matrix4 ScreenEntity::buildPositionMatrix() {
 	return posMatrix;
 }
 
+void ScreenEntity::flushSpriteBatch() {
+	if(ScreenSpriteBatch::flushCurrent()) {
+		Color combined = getCombinedColor();
+		renderer->setVertexColor(combined.r,combined.g,combined.b,combined.a);
+		renderer->setBlendingMode(blendingMode);
+	}
+}
+
 void ScreenEntity::adjustMatrixForChildren() {
-	if(positionMode == POSITION_TOPLEFT)
+	if(positionMode == POSITION_TOPLEFT) {
 		renderer->translate2D(-floor(width/2.0f), -floor(height/2.0f));	
+		ScreenSpriteBatch *spriteBatch = ScreenSpriteBatch::getCurrent();
+		if(spriteBatch) {
+			Matrix4 adjust;
+			adjust.m[3][0] = -floor(width/2.0f);
+			adjust.m[3][1] = -floor(height/2.0f);
+			spriteBatch->multMatrix(adjust);
+		}
+	}
 }
\ No newline at end of file
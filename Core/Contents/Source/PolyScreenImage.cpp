@@ -24,6 +24,7 @@
 #include "PolyMesh.h"
 #include "PolyPolygon.h"
 #include "PolyTexture.h"
+#include "PolyTextureAtlas.h"
 #include "PolyVertex.h"
 
 using namespace Polycode;
@@ -54,6 +55,20 @@ ScreenImage::ScreenImage(Image *image) : ScreenShape(ScreenShape::SHAPE_RECT,1,1
 	positionMode = POSITION_TOPLEFT;	
 }
 
+ScreenImage::ScreenImage(TextureAtlas *atlas, TextureAtlasRegion *region) : ScreenShape(ScreenShape::SHAPE_RECT,1,1) {
+	texture = atlas->getPageTexture(region->page);
+	
+	imageWidth = atlas->getPageSize();
+	imageHeight = atlas->getPageSize();
+	
+	width = region->width;
+	height = region->height;
+	setShapeSize(width, height);
+	setImageCoordinates(region->x, imageHeight - region->y - region->height, region->width, region->height);
+	
+	positionMode = POSITION_TOPLEFT;
+}
+
 ScreenImage::~ScreenImage() {
 
 }
@@ -24,28 +24,53 @@
 #include "PolyCoreServices.h"
 #include "PolyFontManager.h"
 #include "PolyFont.h"
+#include "PolyGlyphCache.h"
 #include "PolyLabel.h"
+#include "PolyLogger.h"
+#include "PolyMaterial.h"
 #include "PolyMaterialManager.h"
 #include "PolyMesh.h"
 #include "PolyPolygon.h"
+#include "PolyRenderer.h"
+#include "PolyResourceManager.h"
 #include "PolyScreenImage.h"
+#include "PolyShader.h"
+#include "PolyTextureAtlas.h"
 
 using namespace Polycode;
 
 ScreenLabel::ScreenLabel(const String& text, int size, const String& fontName, int amode) : ScreenShape(ScreenShape::SHAPE_RECT,1,1) {
-	label = new Label(CoreServices::getInstance()->getFontManager()->getFontByName(fontName), text, size, amode);
+	distanceFieldMaterial = NULL;
+	distanceFieldBinding = NULL;
+	distanceFieldMesh = false;
+	if(amode == Label::ANTIALIAS_DISTANCE_FIELD) {
+		distanceFieldMaterial = (Material*)CoreServices::getInstance()->getResourceManager()->getResource(Resource::RESOURCE_MATERIAL, "DistanceFieldText");
+		if(distanceFieldMaterial && distanceFieldMaterial->getShader(0)) {
+			distanceFieldBinding = distanceFieldMaterial->getShader(0)->createBinding();
+		} else {
+			Logger::log("DistanceFieldText material not found, using regular anti-aliased text\n");
+			distanceFieldMaterial = NULL;
+			amode = Label::ANTIALIAS_FULL;
+		}
+	}
+	
+	label = new Label(CoreServices::getInstance()->getFontManager()->getFontByName(fontName), "", size, amode);
 	dropShadowImage = NULL;
 	texture = NULL;
+	labelTexture = NULL;
 	setText(text);		
-	mesh->getPolygon(0)->flipUVY();	
 	positionMode = POSITION_TOPLEFT;	
 	dropShadowImage = NULL;
 	colorAffectsChildren = false;
 }
 
 ScreenLabel::~ScreenLabel() {
+	if(labelTexture) {
+		CoreServices::getInstance()->getMaterialManager()->deleteTexture(labelTexture);
+	}
 	delete label;
 	delete dropShadowImage;
+	delete distanceFieldBinding;
 }
 
 Label *ScreenLabel::getLabel() const {
@@ -54,6 +79,9 @@ Label *ScreenLabel::getLabel() const {
 
 void ScreenLabel::addDropShadow(Color color, Number size, Number offsetX, Number offsetY) {
 	delete dropShadowImage;
+	
+	// glyph labels don't rasterize their text, so the label image has to be drawn first
+	label->setText(label->getText());
 	Image *labelImage = new Image(label);
 	labelImage->fastBlur(size);
 	dropShadowImage = new ScreenImage(labelImage);
@@ -69,21 +97,146 @@ const String& ScreenLabel::getText() const {
 	return label->getText();
 }	
 
-void ScreenLabel::setText(const String& newText) {
-	label->setText(newText);
+bool ScreenLabel::buildGlyphMesh(const String& text) {
+	Font *font = label->getFont();
+	GlyphCache *glyphCache;
+	Number glyphScale = 1.0;
+	if(distanceFieldMaterial) {
+		glyphCache = CoreServices::getInstance()->getFontManager()->getDistanceFieldCache(font);
+		glyphScale = (Number)label->getSize() / (Number)glyphCache->getSize();
+	} else {
+		glyphCache = CoreServices::getInstance()->getFontManager()->getGlyphCache(font, label->getSize(), label->getAntiAliasMode());
+	}
 	
-	if(texture) {
-		CoreServices::getInstance()->getMaterialManager()->deleteTexture(texture);
+	std::vector<GlyphQuad> quads;
+	glyphCache->layoutText(text, &quads);
+	
+	// a label is drawn with a single texture, so all of its glyphs have to be on one atlas page
+	for(int i=1; i < quads.size(); i++) {
+		if(quads[i].page != quads[0].page)
+			return false;
 	}
 	
-	texture = NULL;
-	if(!label->getFont())
-		return;
-	if(!label->getFont()->isValid())
-		return;				
+	label->setTextWithoutRendering(text);
+	width = Label::getTextWidth(font, text, label->getSize());
+	height = label->getSize() + Label::getTextHeight(font, text, label->getSize());
+	
+	Number whalf = floor(width/2.0f);
+	Number hhalf = floor(height/2.0f);
+	
+	mesh->clearMesh();
+	glyphCharacters.resize(quads.size());
+	for(int i=0; i < quads.size(); i++) {
+		Number left = quads[i].x * glyphScale - whalf;
+		Number right = (quads[i].x + quads[i].width) * glyphScale - whalf;
+		Number top = quads[i].y * glyphScale - hhalf;
+		Number bottom = (quads[i].y + quads[i].height) * glyphScale - hhalf;
+		
+		Polygon *polygon = new Polygon();
+		polygon->addVertex(left, top, 0, quads[i].u1, quads[i].v1);
+		polygon->addVertex(right, top, 0, quads[i].u2, quads[i].v1);
+		polygon->addVertex(right, bottom, 0, quads[i].u2, quads[i].v2);
+		polygon->addVertex(left, bottom, 0, quads[i].u1, quads[i].v2);
+		mesh->addPolygon(polygon);
+		glyphCharacters[i] = quads[i].character;
+	}
+	applyCharacterColors();
+	
+	if(quads.size() > 0) {
+		texture = glyphCache->getAtlas()->getPageTexture(quads[0].page);
+	}
 	
-	texture = CoreServices::getInstance()->getMaterialManager()->createTextureFromImage(label, true, false);
+	if(distanceFieldBinding) {
+		distanceFieldBinding->clearTexture("diffuse");
+		if(texture)
+			distanceFieldBinding->addTexture("diffuse", texture);
+	}
+	distanceFieldMesh = (distanceFieldMaterial != NULL);
+	return true;
+}
+
+void ScreenLabel::buildImageMesh() {
+	labelTexture = CoreServices::getInstance()->getMaterialManager()->createTextureFromImage(label, true, false);
+	texture = labelTexture;
 	width = label->getWidth();
 	height = label->getHeight();
-	setShapeSize(width, height);
+	
+	Number whalf = floor(width/2.0f);
+	Number hhalf = floor(height/2.0f);
+	
+	// label images are stored top down
+	mesh->clearMesh();
+	glyphCharacters.clear();
+	mesh->useVertexColors = false;
+	Polygon *polygon = new Polygon();
+	polygon->addVertex(-whalf, -hhalf, 0, 0, 0);
+	polygon->addVertex(-whalf + width, -hhalf, 0, 1, 0);
+	polygon->addVertex(-whalf + width, -hhalf + height, 0, 1, 1);
+	polygon->addVertex(-whalf, -hhalf + height, 0, 0, 1);
+	mesh->addPolygon(polygon);
+}
+
+void ScreenLabel::setText(const String& newText) {
+	if(labelTexture) {
+		CoreServices::getInstance()->getMaterialManager()->deleteTexture(labelTexture);
+		labelTexture = NULL;
+	}
+	
+	texture = NULL;
+	distanceFieldMesh = false;
+	if(!label->getFont() || !label->getFont()->isValid()) {
+		label->setTextWithoutRendering(newText);
+		return;
+	}
+	
+	if(!buildGlyphMesh(newText)) {
+		label->setText(newText);
+		buildImageMesh();
+	}
+	
+	hitwidth = width;
+	hitheight = height;
+	rebuildTransformMatrix();
+	matrixDirty = true;
+}
+
+void ScreenLabel::setCharacterColors(const std::vector<Color>& colors) {
+	characterColors = colors;
+	applyCharacterColors();
+}
+
+void ScreenLabel::applyCharacterColors() {
+	if(characterColors.size() == 0 || glyphCharacters.size() != mesh->getPolygonCount() || distanceFieldMaterial) {
+		mesh->useVertexColors = false;
+		return;
+	}
+	
+	mesh->useVertexColors = true;
+	for(int i=0; i < mesh->getPolygonCount(); i++) {
+		int character = glyphCharacters[i];
+		if(character >= characterColors.size())
+			character = characterColors.size()-1;
+		Polygon *polygon = mesh->getPolygon(i);
+		for(int j=0; j < polygon->getVertexCount(); j++) {
+			polygon->getVertex(j)->vertexColor = characterColors[character];
+		}
+	}
+	mesh->arrayDirtyMap[RenderDataArray::COLOR_DATA_ARRAY] = true;
+}
+
+void ScreenLabel::Render() {
+	Renderer *renderer = CoreServices::getInstance()->getRenderer();
+	if(!distanceFieldMesh || !texture || !renderer->getShadersEnabled()) {
+		ScreenShape::Render();
+		return;
+	}
+	
+	// distance field text needs its shader, so it can't go through the sprite batch
+	flushSpriteBatch();
+	
+	renderer->applyMaterial(distanceFieldMaterial, distanceFieldBinding, 0);
+	renderer->pushDataArrayForMesh(mesh, RenderDataArray::VERTEX_DATA_ARRAY);
+	renderer->pushDataArrayForMesh(mesh, RenderDataArray::TEXCOORD_DATA_ARRAY);
+	renderer->drawArrays(mesh->getMeshType());
+	renderer->clearShader();
 }
@@ -82,6 +82,8 @@ void ScreenLine::Update() {
 
 
 void ScreenLine::Render() {
+	flushSpriteBatch();
+	
 	Renderer *renderer = CoreServices::getInstance()->getRenderer();
 	renderer->setLineSize(lineWidth);
 	renderer->setTexture(texture);
@@ -24,7 +24,10 @@
 #include "PolyCoreServices.h"
 #include "PolyMaterialManager.h"
 #include "PolyMesh.h"
+#include "PolyPolygon.h"
 #include "PolyRenderer.h"
+#include "PolyScreenSpriteBatch.h"
+#include "PolyVertex.h"
 
 using namespace Polycode;
 
@@ -74,7 +77,100 @@ void ScreenMesh::loadTexture(Image *image) {
 	texture = CoreServices::getInstance()->getMaterialManager()->createTextureFromImage(image, true, false);
 }
 
+unsigned int ScreenMesh::hashRenderState(unsigned int hash) {
+	hash = hashData(hash, &texture, sizeof(Texture*));
+	hash = hashData(hash, &mesh, sizeof(Mesh*));
+	hash = hashData(hash, &lineWidth, sizeof(Number));
+	unsigned int polygonCount = mesh->getPolygonCount();
+	hash = hashData(hash, &polygonCount, sizeof(unsigned int));
+	
+	// dirty arrays mean the vertices may have changed. The flags alone can't tell
+	// one change from the next (batched meshes never clear them), so hash the data.
+	bool dirty = false;
+	for(int i=0; i < 16; i++) {
+		if(mesh->arrayDirtyMap[i]) {
+			dirty = true;
+			break;
+		}
+	}
+	if(dirty) {
+		for(int i=0; i < mesh->getPolygonCount(); i++) {
+			Polygon *polygon = mesh->getPolygon(i);
+			for(int j=0; j < polygon->getVertexCount(); j++) {
+				Vertex *vertex = polygon->getVertex(j);
+				Number values[9] = {vertex->x, vertex->y, vertex->z, vertex->texCoord.x, vertex->texCoord.y, vertex->vertexColor.r, vertex->vertexColor.g, vertex->vertexColor.b, vertex->vertexColor.a};
+				hash = hashData(hash, values, sizeof(Number) * 9);
+			}
+		}
+	}
+	return ScreenEntity::hashRenderState(hash);
+}
+
+void ScreenMesh::getLocalRenderBounds(Vector2 *min, Vector2 *max) {
+	ScreenEntity::getLocalRenderBounds(min, max);
+	for(int i=0; i < mesh->getPolygonCount(); i++) {
+		Polygon *polygon = mesh->getPolygon(i);
+		for(int j=0; j < polygon->getVertexCount(); j++) {
+			Vertex *vertex = polygon->getVertex(j);
+			if(vertex->x < min->x) min->x = vertex->x;
+			if(vertex->y < min->y) min->y = vertex->y;
+			if(vertex->x > max->x) max->x = vertex->x;
+			if(vertex->y > max->y) max->y = vertex->y;
+		}
+	}
+	
+	// leave room for lines and strokes drawn around the edges
+	Number margin = lineWidth + 1.0;
+	min->x -= margin;
+	min->y -= margin;
+	max->x += margin;
+	max->y += margin;
+}
+
+bool ScreenMesh::addToSpriteBatch() {
+	ScreenSpriteBatch *batch = ScreenSpriteBatch::getCurrent();
+	if(!batch)
+		return false;
+	
+	Renderer *renderer = CoreServices::getInstance()->getRenderer();
+	// billboards are transformed by the renderer, so the batch can't reproduce their matrix
+	if(mesh->getMeshType() != Mesh::QUAD_MESH || depthOnly || depthTest || depthWrite || alphaTest || hasMask || billboardMode || renderer->getRenderMode() != Renderer::RENDER_MODE_NORMAL)
+		return false;
+	
+	for(int i=0; i < mesh->getPolygonCount(); i++) {
+		if(mesh->getPolygon(i)->getVertexCount() != 4)
+			return false;
+	}
+	
+	const Matrix4 &modelview = batch->getMatrix();
+	Color combined = getCombinedColor();
+	
+	Vector3 positions[4];
+	Vector2 texCoords[4];
+	Color colors[4];
+	for(int i=0; i < mesh->getPolygonCount(); i++) {
+		Polygon *polygon = mesh->getPolygon(i);
+		for(int j=0; j < 4; j++) {
+			Vertex *vertex = polygon->getVertex(j);
+			positions[j] = modelview * (*vertex);
+			texCoords[j] = vertex->getTexCoord();
+			if(mesh->useVertexColors) {
+				colors[j] = vertex->vertexColor;
+			} else {
+				colors[j] = combined;
+			}
+		}
+		batch->addQuad(texture, blendingMode, positions, texCoords, colors);
+	}
+	return true;
+}
+
 void ScreenMesh::Render() {	
+	if(addToSpriteBatch())
+		return;
+	
+	flushSpriteBatch();
+	
 	Renderer *renderer = CoreServices::getInstance()->getRenderer();
 	
 	renderer->setLineSize(lineWidth);
@@ -164,12 +164,23 @@ void ScreenShape::setStrokeColor(Number r, Number g, Number b, Number a) {
 	strokeColor.setColor(r,g,b,a);
 }
 
+unsigned int ScreenShape::hashRenderState(unsigned int hash) {
+	hash = hashData(hash, &strokeEnabled, sizeof(bool));
+	if(strokeEnabled) {
+		Number strokeValues[5] = {strokeColor.r, strokeColor.g, strokeColor.b, strokeColor.a, strokeWidth};
+		hash = hashData(hash, strokeValues, sizeof(Number) * 5);
+	}
+	return ScreenMesh::hashRenderState(hash);
+}
+
 void ScreenShape::Render() {
 	Renderer *renderer = CoreServices::getInstance()->getRenderer();
 
 	ScreenMesh::Render();
 
 	if(strokeEnabled) {
+		flushSpriteBatch();
+		
 		if(lineSmooth) {
 				renderer->setLineSmooth(true);
 		}
@@ -48,8 +48,8 @@ void ScreenSoundListener::Update() {
 }
 
 
-ScreenSound::ScreenSound(const String& fileName, Number referenceDistance, Number maxDistance) : ScreenEntity() {
-	sound = new Sound(fileName);
+ScreenSound::ScreenSound(const String& fileName, Number referenceDistance, Number maxDistance, bool streamed) : ScreenEntity() {
+	sound = new Sound(fileName, streamed);
 	sound->setIsPositional(true);
 	sound->setPositionalProperties(referenceDistance, maxDistance);	
 }
@@ -0,0 +1,114 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+ 
+
+#include "PolyScreenSpatialHash.h"
+#include "PolyScreenEntity.h"
+#include <algorithm>
+#include <math.h>
+
+using namespace Polycode;
+
+ScreenSpatialHash::ScreenSpatialHash(Number cellSize) {
+	this->cellSize = cellSize;
+}
+
+ScreenSpatialHash::~ScreenSpatialHash() {
+
+}
+
+void ScreenSpatialHash::clear() {
+	cells.clear();
+	largeEntities.clear();
+	orders.clear();
+}
+
+long long ScreenSpatialHash::cellKey(int x, int y) const {
+	return (((long long)x) << 32) | ((unsigned int)y);
+}
+
+bool ScreenSpatialHash::cmpOrder(const ScreenSpatialHashEntry &left, const ScreenSpatialHashEntry &right) {
+	return left.order < right.order;
+}
+
+void ScreenSpatialHash::addEntity(ScreenEntity *entity, unsigned int order) {
+	ScreenSpatialHashEntry entry;
+	entry.entity = entity;
+	entry.order = order;
+	entity->getScreenHitBounds(&entry.boundsMin, &entry.boundsMax);
+	orders[entity] = order;
+	
+	int x1 = floor(entry.boundsMin.x / cellSize);
+	int y1 = floor(entry.boundsMin.y / cellSize);
+	int x2 = floor(entry.boundsMax.x / cellSize);
+	int y2 = floor(entry.boundsMax.y / cellSize);
+	
+	if((x2 - x1 + 1) * (y2 - y1 + 1) > MAX_ENTITY_CELLS) {
+		largeEntities.push_back(entry);
+		return;
+	}
+	
+	for(int y=y1; y <= y2; y++) {
+		for(int x=x1; x <= x2; x++) {
+			cells[cellKey(x, y)].push_back(entry);
+		}
+	}
+}
+
+void ScreenSpatialHash::addEntityOrder(ScreenEntity *entity, unsigned int order) {
+	orders[entity] = order;
+}
+
+void ScreenSpatialHash::getEntitiesAt(Number x, Number y, std::vector<ScreenSpatialHashEntry> *entries) const {
+	unsigned int start = entries->size();
+	
+	std::map<long long, std::vector<ScreenSpatialHashEntry> >::const_iterator it = cells.find(cellKey(floor(x / cellSize), floor(y / cellSize)));
+	if(it != cells.end()) {
+		const std::vector<ScreenSpatialHashEntry> &cell = it->second;
+		for(int i=0; i < cell.size(); i++) {
+			if(x >= cell[i].boundsMin.x && x <= cell[i].boundsMax.x && y >= cell[i].boundsMin.y && y <= cell[i].boundsMax.y)
+				entries->push_back(cell[i]);
+		}
+	}
+	
+	for(int i=0; i < largeEntities.size(); i++) {
+		if(x >= largeEntities[i].boundsMin.x && x <= largeEntities[i].boundsMax.x && y >= largeEntities[i].boundsMin.y && y <= largeEntities[i].boundsMax.y)
+			entries->push_back(largeEntities[i]);
+	}
+	
+	std::sort(entries->begin() + start, entries->end(), ScreenSpatialHash::cmpOrder);
+}
+
+int ScreenSpatialHash::getEntityOrder(ScreenEntity *entity) const {
+	std::map<ScreenEntity*, unsigned int>::const_iterator it = orders.find(entity);
+	if(it == orders.end())
+		return -1;
+	return it->second;
+}
+
+unsigned int ScreenSpatialHash::getNumEntities() const {
+	return orders.size();
+}
+
+Number ScreenSpatialHash::getCellSize() const {
+	return cellSize;
+}
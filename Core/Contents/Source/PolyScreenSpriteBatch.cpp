@@ -0,0 +1,174 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+ 
+
+#include "PolyScreenSpriteBatch.h"
+#include "PolyCoreServices.h"
+#include "PolyMesh.h"
+#include "PolyRenderer.h"
+#include <stdlib.h>
+
+using namespace Polycode;
+
+ScreenSpriteBatch *ScreenSpriteBatch::current = NULL;
+
+ScreenSpriteBatch::ScreenSpriteBatch() {
+	renderer = CoreServices::getInstance()->getRenderer();
+	vertexArray = renderer->createRenderDataArray(RenderDataArray::VERTEX_DATA_ARRAY);
+	texCoordArray = renderer->createRenderDataArray(RenderDataArray::TEXCOORD_DATA_ARRAY);
+	colorArray = renderer->createRenderDataArray(RenderDataArray::COLOR_DATA_ARRAY);
+	vertexCapacity = 0;
+	numVertices = 0;
+	batchTexture = NULL;
+	batchBlendingMode = Renderer::BLEND_MODE_NORMAL;
+	numDrawCalls = 0;
+	numQuads = 0;
+	reserve(256);
+}
+
+ScreenSpriteBatch::~ScreenSpriteBatch() {
+	if(current == this)
+		current = NULL;
+	free(vertexArray->arrayPtr);
+	free(texCoordArray->arrayPtr);
+	free(colorArray->arrayPtr);
+	delete vertexArray;
+	delete texCoordArray;
+	delete colorArray;
+}
+
+ScreenSpriteBatch *ScreenSpriteBatch::getCurrent() {
+	return current;
+}
+
+bool ScreenSpriteBatch::flushCurrent() {
+	if(!current)
+		return false;
+	return current->flush();
+}
+
+unsigned int ScreenSpriteBatch::getNumDrawCalls() const {
+	return numDrawCalls;
+}
+
+unsigned int ScreenSpriteBatch::getNumQuads() const {
+	return numQuads;
+}
+
+void ScreenSpriteBatch::reserve(unsigned int numVertices) {
+	if(numVertices <= vertexCapacity)
+		return;
+	
+	unsigned int newCapacity = vertexCapacity > 0 ? vertexCapacity : 4;
+	while(newCapacity < numVertices)
+		newCapacity *= 2;
+	
+	vertexArray->arrayPtr = realloc(vertexArray->arrayPtr, newCapacity * 3 * sizeof(float));
+	texCoordArray->arrayPtr = realloc(texCoordArray->arrayPtr, newCapacity * 2 * sizeof(float));
+	colorArray->arrayPtr = realloc(colorArray->arrayPtr, newCapacity * 4 * sizeof(float));
+	vertexCapacity = newCapacity;
+}
+
+void ScreenSpriteBatch::begin(const Matrix4 &baseMatrix) {
+	current = this;
+	numVertices = 0;
+	numDrawCalls = 0;
+	numQuads = 0;
+	matrixStack.clear();
+	matrixStack.push_back(baseMatrix);
+}
+
+void ScreenSpriteBatch::pushMatrix(const Matrix4 &matrix) {
+	matrixStack.push_back(matrix * matrixStack[matrixStack.size()-1]);
+}
+
+void ScreenSpriteBatch::multMatrix(const Matrix4 &matrix) {
+	matrixStack[matrixStack.size()-1] = matrix * matrixStack[matrixStack.size()-1];
+}
+
+void ScreenSpriteBatch::popMatrix() {
+	if(matrixStack.size() > 1)
+		matrixStack.pop_back();
+}
+
+const Matrix4 &ScreenSpriteBatch::getMatrix() const {
+	return matrixStack[matrixStack.size()-1];
+}
+
+void ScreenSpriteBatch::end() {
+	flush();
+	if(current == this)
+		current = NULL;
+}
+
+void ScreenSpriteBatch::addQuad(Texture *texture, int blendingMode, const Vector3 *positions, const Vector2 *texCoords, const Color *colors) {
+	if(numVertices > 0 && (texture != batchTexture || blendingMode != batchBlendingMode)) {
+		flush();
+	}
+	batchTexture = texture;
+	batchBlendingMode = blendingMode;
+	
+	reserve(numVertices + 4);
+	
+	float *vertexData = ((float*)vertexArray->arrayPtr) + numVertices * 3;
+	float *texCoordData = ((float*)texCoordArray->arrayPtr) + numVertices * 2;
+	float *colorData = ((float*)colorArray->arrayPtr) + numVertices * 4;
+	for(int i=0; i < 4; i++) {
+		vertexData[i*3] = positions[i].x;
+		vertexData[i*3+1] = positions[i].y;
+		vertexData[i*3+2] = positions[i].z;
+		texCoordData[i*2] = texCoords[i].x;
+		texCoordData[i*2+1] = texCoords[i].y;
+		colorData[i*4] = colors[i].r;
+		colorData[i*4+1] = colors[i].g;
+		colorData[i*4+2] = colors[i].b;
+		colorData[i*4+3] = colors[i].a;
+	}
+	numVertices += 4;
+	numQuads++;
+}
+
+bool ScreenSpriteBatch::flush() {
+	if(numVertices == 0)
+		return false;
+	
+	// quads are already in view space
+	renderer->pushMatrix();
+	renderer->loadIdentity();
+	
+	renderer->setTexture(batchTexture);
+	renderer->setBlendingMode(batchBlendingMode);
+	
+	vertexArray->count = numVertices;
+	texCoordArray->count = numVertices;
+	colorArray->count = numVertices;
+	renderer->pushRenderDataArray(colorArray);
+	renderer->pushRenderDataArray(vertexArray);
+	renderer->pushRenderDataArray(texCoordArray);
+	renderer->drawArrays(Mesh::QUAD_MESH);
+	
+	renderer->popMatrix();
+	
+	numVertices = 0;
+	numDrawCalls++;
+	return true;
+}
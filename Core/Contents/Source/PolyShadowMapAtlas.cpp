@@ -0,0 +1,210 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+ 
+
+#include "PolyShadowMapAtlas.h"
+#include "PolyCoreServices.h"
+#include "PolyLogger.h"
+#include "PolyRenderer.h"
+#include "PolyTexture.h"
+
+using namespace Polycode;
+
+ShadowMapTile::ShadowMapTile() {
+	x = 0;
+	y = 0;
+	size = 0;
+	nodeIndex = -1;
+}
+
+static unsigned int floorPowerOfTwo(unsigned int value) {
+	unsigned int result = 1;
+	while(result * 2 <= value)
+		result *= 2;
+	return result;
+}
+
+ShadowMapAtlas::ShadowMapAtlas(unsigned int atlasSize, unsigned int minTileSize, unsigned int tileBorder) {
+	this->atlasSize = floorPowerOfTwo(atlasSize);
+	this->minTileSize = floorPowerOfTwo(minTileSize);
+	if(this->minTileSize > this->atlasSize)
+		this->minTileSize = this->atlasSize;
+	this->tileBorder = tileBorder;
+	if(this->tileBorder * 4 > this->minTileSize)
+		this->tileBorder = this->minTileSize / 4;
+	texture = NULL;
+	
+	AtlasNode root;
+	root.x = 0;
+	root.y = 0;
+	root.size = this->atlasSize;
+	root.parent = -1;
+	root.firstChild = -1;
+	root.state = NODE_FREE;
+	nodes.push_back(root);
+}
+
+ShadowMapAtlas::~ShadowMapAtlas() {
+	if(texture)
+		CoreServices::getInstance()->getRenderer()->destroyTexture(texture);
+}
+
+Texture *ShadowMapAtlas::getTexture() {
+	if(!texture) {
+		CoreServices::getInstance()->getRenderer()->createRenderTextures(NULL, &texture, atlasSize, atlasSize, false);
+	}
+	return texture;
+}
+
+unsigned int ShadowMapAtlas::getAtlasSize() const {
+	return atlasSize;
+}
+
+unsigned int ShadowMapAtlas::getMinTileSize() const {
+	return minTileSize;
+}
+
+unsigned int ShadowMapAtlas::getTileBorder() const {
+	return tileBorder;
+}
+
+void ShadowMapAtlas::splitNode(int nodeIndex) {
+	int firstChild;
+	if(freeChildBlocks.size() > 0) {
+		firstChild = freeChildBlocks[freeChildBlocks.size()-1];
+		freeChildBlocks.pop_back();
+	} else {
+		firstChild = nodes.size();
+		nodes.resize(nodes.size() + 4);
+	}
+	
+	unsigned int childSize = nodes[nodeIndex].size / 2;
+	for(int i=0; i < 4; i++) {
+		AtlasNode &child = nodes[firstChild+i];
+		child.x = nodes[nodeIndex].x + (i % 2) * childSize;
+		child.y = nodes[nodeIndex].y + (i / 2) * childSize;
+		child.size = childSize;
+		child.parent = nodeIndex;
+		child.firstChild = -1;
+		child.state = NODE_FREE;
+	}
+	nodes[nodeIndex].firstChild = firstChild;
+	nodes[nodeIndex].state = NODE_SPLIT;
+}
+
+int ShadowMapAtlas::findNode(int nodeIndex, unsigned int size) {
+	if(nodes[nodeIndex].size < size || nodes[nodeIndex].state == NODE_USED)
+		return -1;
+	
+	if(nodes[nodeIndex].state == NODE_FREE) {
+		if(nodes[nodeIndex].size == size)
+			return nodeIndex;
+		splitNode(nodeIndex);
+		return findNode(nodes[nodeIndex].firstChild, size);
+	}
+	
+	// look inside already split children first so that free blocks stay as large as possible
+	int firstChild = nodes[nodeIndex].firstChild;
+	for(int i=0; i < 4; i++) {
+		if(nodes[firstChild+i].state == NODE_SPLIT) {
+			int found = findNode(firstChild+i, size);
+			if(found != -1)
+				return found;
+		}
+	}
+	for(int i=0; i < 4; i++) {
+		if(nodes[firstChild+i].state == NODE_FREE) {
+			return findNode(firstChild+i, size);
+		}
+	}
+	return -1;
+}
+
+bool ShadowMapAtlas::allocateTile(unsigned int resolution, ShadowMapTile *tile) {
+	unsigned int size = floorPowerOfTwo(resolution);
+	if(size > atlasSize)
+		size = atlasSize;
+	if(size < minTileSize)
+		size = minTileSize;
+	
+	for(; size >= minTileSize; size /= 2) {
+		int nodeIndex = findNode(0, size);
+		if(nodeIndex != -1) {
+			nodes[nodeIndex].state = NODE_USED;
+			tile->x = nodes[nodeIndex].x;
+			tile->y = nodes[nodeIndex].y;
+			tile->size = nodes[nodeIndex].size;
+			tile->nodeIndex = nodeIndex;
+			if(size != floorPowerOfTwo(resolution))
+				Logger::log("Shadow map atlas: requested %d, allocated %d\n", resolution, size);
+			return true;
+		}
+	}
+	
+	Logger::log("Shadow map atlas is full!\n");
+	return false;
+}
+
+void ShadowMapAtlas::freeTile(ShadowMapTile *tile) {
+	if(!tile->isValid())
+		return;
+	
+	int nodeIndex = tile->nodeIndex;
+	nodes[nodeIndex].state = NODE_FREE;
+	
+	// merge blocks whose four children are all free again
+	int parent = nodes[nodeIndex].parent;
+	while(parent != -1) {
+		int firstChild = nodes[parent].firstChild;
+		bool childrenFree = true;
+		for(int i=0; i < 4; i++) {
+			if(nodes[firstChild+i].state != NODE_FREE)
+				childrenFree = false;
+		}
+		if(!childrenFree)
+			break;
+		freeChildBlocks.push_back(firstChild);
+		nodes[parent].firstChild = -1;
+		nodes[parent].state = NODE_FREE;
+		parent = nodes[parent].parent;
+	}
+	
+	*tile = ShadowMapTile();
+}
+
+Matrix4 ShadowMapAtlas::getTileTextureMatrix(const ShadowMapTile &tile) const {
+	Number scale = ((Number)(tile.size - tileBorder * 2)) / ((Number)atlasSize);
+	Number offsetX = ((Number)(tile.x + tileBorder)) / ((Number)atlasSize);
+	Number offsetY = ((Number)(tile.y + tileBorder)) / ((Number)atlasSize);
+	return Matrix4(scale,	0.0,	0.0,	0.0,
+				   0.0,		scale,	0.0,	0.0,
+				   0.0,		0.0,	1.0,	0.0,
+				   offsetX,	offsetY, 0.0,	1.0);
+}
+
+void ShadowMapAtlas::getTileTextureRect(const ShadowMapTile &tile, Vector2 *rectMin, Vector2 *rectMax) const {
+	Number inset = ((Number)tileBorder) + 0.5;
+	rectMin->x = (((Number)tile.x) + inset) / ((Number)atlasSize);
+	rectMin->y = (((Number)tile.y) + inset) / ((Number)atlasSize);
+	rectMax->x = (((Number)(tile.x + tile.size)) - inset) / ((Number)atlasSize);
+	rectMax->y = (((Number)(tile.y + tile.size)) - inset) / ((Number)atlasSize);
+}
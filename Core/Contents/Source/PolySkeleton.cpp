@@ -23,24 +23,35 @@
 #include "PolySkeleton.h"
 #include "PolyBezierCurve.h"
 #include "PolyBone.h"
+#include "PolyCore.h"
+#include "PolyCoreServices.h"
 #include "PolyLabel.h"
+#include "PolyQuaternionCurve.h"
 #include "PolySceneLabel.h"
 #include "PolySceneLine.h"
-#include "PolyTween.h"
 #include "OSBasics.h"
 
 using namespace Polycode;
 
 Skeleton::Skeleton(const String& fileName) : SceneEntity() {
-	loadSkeleton(fileName);
 	currentAnimation = NULL;
+	previousAnimation = NULL;
+	fadeTime = 0;
+	fadeElapsed = 0;
+	loadSkeleton(fileName);
 }
 
 Skeleton::Skeleton() {
 	currentAnimation = NULL;	
+	previousAnimation = NULL;
+	fadeTime = 0;
+	fadeElapsed = 0;
 }
 
 Skeleton::~Skeleton() {
+	for(int i=0; i < animations.size(); i++) {
+		delete animations[i];
+	}
 }
 
 int Skeleton::getNumBones() const {
@@ -73,7 +84,7 @@ void Skeleton::enableBoneLabels(const String& labelFont, Number size, Number sca
 }
 
 void Skeleton::playAnimationByIndex(int index, bool once) {
-	if(index > animations.size()-1)
+	if(index < 0 || index >= animations.size())
 		return;
 		
 	SkeletonAnimation *anim = animations[index];
@@ -83,11 +94,7 @@ void Skeleton::playAnimationByIndex(int index, bool once) {
 	if(anim == currentAnimation && !once)
 		return;
 	
-	if(currentAnimation)
-		currentAnimation->Stop();
-	
-	currentAnimation = anim;
-	anim->Play(once);	
+	setCurrentAnimation(anim, once, 0);
 }
 
 void Skeleton::playAnimation(const String& animName, bool once) {
@@ -98,9 +105,35 @@ void Skeleton::playAnimation(const String& animName, bool once) {
 	if(anim == currentAnimation && !once)
 		return;
 	
-	if(currentAnimation)
+	setCurrentAnimation(anim, once, 0);
+}
+
+void Skeleton::fadeToAnimation(const String& animName, Number fadeTime, bool once) {
+	SkeletonAnimation *anim = getAnimation(animName);
+	if(!anim)
+		return;
+	
+	if(anim == currentAnimation && !once)
+		return;
+	
+	setCurrentAnimation(anim, once, fadeTime);
+}
+
+void Skeleton::setCurrentAnimation(SkeletonAnimation *anim, bool once, Number fadeTime) {
+	if(previousAnimation) {
+		previousAnimation->Stop();
+		previousAnimation = NULL;
+	}
+	
+	if(currentAnimation && currentAnimation != anim && fadeTime > 0) {
+		// the old animation keeps playing underneath until the fade is over
+		previousAnimation = currentAnimation;
+		this->fadeTime = fadeTime;
+		fadeElapsed = 0;
+	} else if(currentAnimation) {
 		currentAnimation->Stop();
-		
+	}
+	
 	currentAnimation = anim;
 	anim->Play(once);
 }
@@ -115,8 +148,51 @@ SkeletonAnimation *Skeleton::getAnimation(const String& name) const {
 
 void Skeleton::Update() {
 
-	if(currentAnimation != NULL) {
-		currentAnimation->Update();
+	if(currentAnimation == NULL) {
+		return;
+	}
+	
+	currentAnimation->Update();
+	if(previousAnimation) {
+		previousAnimation->Update();
+		fadeElapsed += CoreServices::getInstance()->getCore()->getElapsed();
+		if(fadeElapsed >= fadeTime) {
+			previousAnimation->Stop();
+			previousAnimation = NULL;
+		}
+	}
+	
+	resetPose();
+	if(previousAnimation) {
+		previousAnimation->applyToPose(pose);
+		currentAnimation->applyToPose(pose, fadeElapsed / fadeTime);
+	} else {
+		currentAnimation->applyToPose(pose);
+	}
+	applyPose();
+}
+
+std::vector<BonePose> &Skeleton::getPose() {
+	return pose;
+}
+
+void Skeleton::resetPose() {
+	pose = bindPose;
+}
+
+void Skeleton::applyPose() {
+	for(int i=0; i < bones.size() && i < pose.size(); i++) {
+		const BonePose &bonePose = pose[i];
+		Matrix4 boneMatrix = bonePose.rotation.createMatrix();
+		for(int j=0; j < 3; j++) {
+			boneMatrix.m[0][j] *= bonePose.scale.x;
+			boneMatrix.m[1][j] *= bonePose.scale.y;
+			boneMatrix.m[2][j] *= bonePose.scale.z;
+		}
+		boneMatrix.setPosition(bonePose.position.x, bonePose.position.y, bonePose.position.z);
+		
+		bones[i]->setBoneMatrix(boneMatrix);
+		bones[i]->setTransformByMatrixPure(boneMatrix);
 	}
 }
 
@@ -130,10 +206,12 @@ void Skeleton::loadSkeleton(const String& fileName) {
 	bonesEntity->visible = false;
 	addChild(bonesEntity);
 	
-	unsigned int numBones;
-	float t[3],rq[4],s[3];
+	unsigned int numBones = 0;
+	// translation, scale and rotation quaternion
+	float transform[10];
+	float *t = transform, *s = transform + 3, *rq = transform + 6;
 	
-	OSBasics::read(&numBones, sizeof(unsigned int), 1, inFile);
+	OSBasics::readValue(&numBones, inFile);
 	unsigned int namelen;
 	char buffer[1024];
 	
@@ -141,23 +219,21 @@ void Skeleton::loadSkeleton(const String& fileName) {
 	unsigned int hasParent, boneID;
 	for(int i=0; i < numBones; i++) {
 		
-		OSBasics::read(&namelen, sizeof(unsigned int), 1, inFile);
+		OSBasics::readValue(&namelen, inFile);
 		memset(buffer, 0, 1024);
 		OSBasics::read(buffer, 1, namelen, inFile);
 		
 		Bone *newBone = new Bone(String(buffer));
 		
-		OSBasics::read(&hasParent, sizeof(unsigned int), 1, inFile);
+		OSBasics::readValue(&hasParent, inFile);
 		if(hasParent == 1) {
-			OSBasics::read(&boneID, sizeof(unsigned int), 1, inFile);
+			OSBasics::readValue(&boneID, inFile);
 			newBone->parentBoneId = boneID;
 		} else {
 			newBone->parentBoneId = -1;
 		}
 
-		OSBasics::read(t, sizeof(float), 3, inFile);
-		OSBasics::read(s, sizeof(float), 3, inFile);
-		OSBasics::read(rq, sizeof(float), 4, inFile);
+		OSBasics::readArray(transform, 10, inFile);
 		
 		bones.push_back(newBone);
 		
@@ -168,10 +244,10 @@ void Skeleton::loadSkeleton(const String& fileName) {
 		
 		newBone->setBaseMatrix(newBone->getTransformMatrix());
 		newBone->setBoneMatrix(newBone->getTransformMatrix());
+		
+		bindPose.push_back(BonePose(Vector3(t[0], t[1], t[2]), Quaternion(rq[0], rq[1], rq[2], rq[3]), Vector3(s[0], s[1], s[2])));
 
-		OSBasics::read(t, sizeof(float), 3, inFile);
-		OSBasics::read(s, sizeof(float), 3, inFile);
-		OSBasics::read(rq, sizeof(float), 4, inFile);
+		OSBasics::readArray(transform, 10, inFile);
 		
 		Quaternion q;
 		q.set(rq[0], rq[1], rq[2], rq[3]);
@@ -182,6 +258,8 @@ void Skeleton::loadSkeleton(const String& fileName) {
 		
 	}
 
+	pose = bindPose;
+	
 	Bone *parentBone;
 //	SceneEntity *bProxy;
 	
@@ -288,28 +366,32 @@ void Skeleton::addAnimation(const String& name, const String& fileName) {
 	
 		unsigned int activeBones,boneIndex,numPoints,numCurves, curveType;	
 		float length;
-		OSBasics::read(&length, 1, sizeof(float), inFile);
+		OSBasics::readValue(&length, inFile);
 		SkeletonAnimation *newAnimation = new SkeletonAnimation(name, length);
 		
-		OSBasics::read(&activeBones, sizeof(unsigned int), 1, inFile);
+		OSBasics::readValue(&activeBones, inFile);
 		
 		//	Logger::log("activeBones: %d\n", activeBones);		
 		for(int j=0; j < activeBones; j++) {
-			OSBasics::read(&boneIndex, sizeof(unsigned int), 1, inFile);
+			OSBasics::readValue(&boneIndex, inFile);
+			if(boneIndex >= bones.size()) {
+				break;
+			}
 			BoneTrack *newTrack = new BoneTrack(bones[boneIndex], length);
 			
 			BezierCurve *curve;
-			float vec1[2]; //,vec2[2],vec3[2];
+			std::vector<float> points;
 			
-			OSBasics::read(&numCurves, sizeof(unsigned int), 1, inFile);
+			OSBasics::readValue(&numCurves, inFile);
 			//			Logger::log("numCurves: %d\n", numCurves);					
 			for(int l=0; l < numCurves; l++) {
 				curve = new BezierCurve();
-				OSBasics::read(&curveType, sizeof(unsigned int), 1, inFile);
-				OSBasics::read(&numPoints, sizeof(unsigned int), 1, inFile);
+				OSBasics::readValue(&curveType, inFile);
+				OSBasics::readValue(&numPoints, inFile);
+				points.resize(numPoints * 2 + 1);
+				numPoints = OSBasics::readArray(&points[0], numPoints * 2, inFile) / 2;
 				for(int k=0; k < numPoints; k++) {					
-					OSBasics::read(vec1, sizeof(float), 2, inFile);					
-					curve->addControlPoint2d(vec1[1], vec1[0]);
+					curve->addControlPoint2d(points[k*2+1], points[k*2]);
 					//					curve->addControlPoint(vec1[1]-10, vec1[0], 0, vec1[1], vec1[0], 0, vec1[1]+10, vec1[0], 0);
 				}
 				switch(curveType) {
@@ -343,10 +425,13 @@ void Skeleton::addAnimation(const String& name, const String& fileName) {
 					case 9:
 						newTrack->LocZ = curve;					
 						break;
+					default:
+						delete curve;
+						break;
 				}
 			}
 			
-			newAnimation->addBoneTrack(newTrack);
+			newAnimation->addBoneTrack(newTrack, boneIndex);
 		}
 		animations.push_back(newAnimation);
 	
@@ -371,173 +456,125 @@ BoneTrack::BoneTrack(Bone *bone, Number length) {
 	LocX = NULL;			
 	LocY = NULL;
 	LocZ = NULL;
-	initialized = false;
 }
 
 BoneTrack::~BoneTrack() {
+	delete scaleX;
+	delete scaleY;
+	delete scaleZ;
+	delete QuatW;
+	delete QuatX;
+	delete QuatY;
+	delete QuatZ;
+	delete LocX;
+	delete LocY;
+	delete LocZ;
 }
 
-
-void BoneTrack::Stop() {
-	if(initialized) {
-		for(int i=0; i < pathTweens.size(); i++) {
-			pathTweens[i]->Pause(true);
-		}	
-		quatTween->Pause(true);		
-	}
+Bone *BoneTrack::getBone() const {
+	return targetBone;
 }
 
-void BoneTrack::Play(bool once) {
-
-	if(!initialized ) {
-	// TODO: change it so that you can set the tweens to not manually restart so you can calculate the
-	// time per tween
+void BoneTrack::bake(unsigned int numSamples, std::vector<Vector3> &positions, std::vector<Quaternion> &rotations) {
+	positions.resize(numSamples);
+	rotations.resize(numSamples);
 	
-		Number durTime = length; //(LocX->getControlPoint(LocX->getNumControlPoints()-1)->p2.x);//25.0f;
-					
-	BezierPathTween *testTween;		
-	if(LocX) {
-		testTween = new BezierPathTween(&LocXVec, LocX, Tween::EASE_NONE, durTime, !once);
-		pathTweens.push_back(testTween);
-	}
-	if(LocY) {		
-		testTween = new BezierPathTween(&LocYVec, LocY, Tween::EASE_NONE, durTime, !once);
-		pathTweens.push_back(testTween);
-	}
-		
-	if(LocZ) {
-		testTween = new BezierPathTween(&LocZVec, LocZ, Tween::EASE_NONE, durTime, !once);
-		pathTweens.push_back(testTween);
-	}
-	testTween = new BezierPathTween(&ScaleXVec, scaleX, Tween::EASE_NONE, durTime, !once);
-	pathTweens.push_back(testTween);
-	testTween = new BezierPathTween(&ScaleYVec, scaleY, Tween::EASE_NONE, durTime, !once);
-	pathTweens.push_back(testTween);
-	testTween = new BezierPathTween(&ScaleZVec, scaleZ, Tween::EASE_NONE, durTime, !once);
-	pathTweens.push_back(testTween);
-		
-		
-	if(QuatW)
-		quatTween = new QuaternionTween(&boneQuat, QuatW, QuatX, QuatY, QuatZ, Tween::EASE_NONE, durTime, !once);
-
-	initialized = true;
-	} else {
-		for(int i=0; i < pathTweens.size(); i++) {
-			pathTweens[i]->Reset();
-			pathTweens[i]->Pause(false);
-		}	
-		quatTween->Reset();
-		quatTween->Pause(false);
-	}
-/*
-	if(QuatW) {
-		testTween = new BezierPathTween(&QuatWVec, QuatW, Tween::EASE_NONE, durTime, true);
-		pathTweens.push_back(testTween);
+	Vector3 basePosition;
+	if(targetBone) {
+		basePosition = targetBone->getBaseMatrix().getPosition();
 	}
 	
-	if(QuatX) {
-		testTween = new BezierPathTween(&QuatXVec, QuatX, Tween::EASE_NONE, durTime, true);
-		pathTweens.push_back(testTween);
+	QuaternionCurve *quatCurve = NULL;
+	unsigned int numQuatPoints = 0;
+	if(QuatW && QuatX && QuatY && QuatZ && QuatW->getNumControlPoints() > 0) {
+		quatCurve = new QuaternionCurve(QuatW, QuatX, QuatY, QuatZ);
+		numQuatPoints = QuatW->getNumControlPoints();
 	}
 	
-	if(QuatY) {
-		testTween = new BezierPathTween(&QuatYVec, QuatY, Tween::EASE_NONE, durTime, true);
-		pathTweens.push_back(testTween);
-	}
-	
-	if(QuatZ) {
-		testTween = new BezierPathTween(&QuatZVec, QuatZ, Tween::EASE_NONE, durTime, true);
-		pathTweens.push_back(testTween);
+	// Samples the curves the same way the path and quaternion tweens did, with the curve parameter going linearly from 0 to 1 over the track.
+	for(int i=0; i < numSamples; i++) {
+		Number a = numSamples > 1 ? ((Number)i) / ((Number)(numSamples - 1)) : 0.0;
+		
+		positions[i].x = (LocX && LocX->getNumControlPoints() > 0) ? LocX->getPointAt(a).y : basePosition.x;
+		positions[i].y = (LocY && LocY->getNumControlPoints() > 0) ? LocY->getPointAt(a).y : basePosition.y;
+		positions[i].z = (LocZ && LocZ->getNumControlPoints() > 0) ? LocZ->getPointAt(a).y : basePosition.z;
+		
+		if(!quatCurve) {
+			rotations[i] = Quaternion();
+		} else if(i == numSamples - 1 && numQuatPoints > 1) {
+			// the curve can't interpolate past its last point, take it directly
+			rotations[i] = quatCurve->interpolate(numQuatPoints - 2, 1.0, true);
+		} else {
+			rotations[i] = quatCurve->interpolate(a, true);
+		}
 	}
-*/
-}
-
-
-void BoneTrack::Update() {
-
-	if(!targetBone)
-		return;
-
-	Matrix4 newMatrix;
-	newMatrix = boneQuat.createMatrix();
-
 	
-	Matrix4 scaleMatrix;
-	scaleMatrix.m[0][0] *= 1; //ScaleXVec.y;
-	scaleMatrix.m[1][1] *= 1; //ScaleYVec.y;
-	scaleMatrix.m[2][2] *= 1; //ScaleZVec.y;
-	
-
-	Matrix4 posMatrix;
-
-	if(LocX)
-		posMatrix.m[3][0] = LocXVec.y;		
-	else
-		posMatrix.m[3][0] = targetBone->getBaseMatrix()[3][0];
-
-	if(LocY)
-		posMatrix.m[3][1] = LocYVec.y;		
-	else
-		posMatrix.m[3][1] = targetBone->getBaseMatrix()[3][1];
-	
-	if(LocZ)
-		posMatrix.m[3][2] = LocZVec.y;		
-	else
-		posMatrix.m[3][2] = targetBone->getBaseMatrix()[3][2];
-	
-	
-	newMatrix = scaleMatrix*newMatrix*posMatrix;	
-	
-	targetBone->setBoneMatrix(newMatrix);
-	targetBone->setTransformByMatrixPure(newMatrix);		
-
+	delete quatCurve;
 }
 
-void BoneTrack::setSpeed(Number speed) {
-	for(int i=0; i < pathTweens.size(); i++) {
-		pathTweens[i]->setSpeed(speed);
-	}	
-	quatTween->setSpeed(speed);
-}
-
-
 SkeletonAnimation::SkeletonAnimation(const String& name, Number duration) {
 	this->name = name;
 	this->duration = duration;
+	clip = new AnimationClip(name, duration);
+	time = 0;
+	speed = 1.0;
+	once = false;
+	playing = false;
 }
 
 void SkeletonAnimation::setSpeed(Number speed) {
-	for(int i=0; i < boneTracks.size(); i++) {
-		boneTracks[i]->setSpeed(speed);
-	}	
+	this->speed = speed;
 }
 
 void SkeletonAnimation::Update() {
-	for(int i=0; i < boneTracks.size(); i++) {
-		boneTracks[i]->Update();
+	if(!playing) {
+		return;
+	}
+	time += CoreServices::getInstance()->getCore()->getElapsed() * speed;
+	if(once && time >= duration) {
+		time = duration;
+		playing = false;
 	}
 }
 
+void SkeletonAnimation::applyToPose(std::vector<BonePose> &pose, Number weight) const {
+	clip->blendPose(time, !once, weight, pose);
+}
+
 void SkeletonAnimation::Stop() {
-	for(int i=0; i < boneTracks.size(); i++) {
-		boneTracks[i]->Stop();
-	}
+	playing = false;
 }
 
 void SkeletonAnimation::Play(bool once) {
-	for(int i=0; i < boneTracks.size(); i++) {
-		boneTracks[i]->Play(once);
-	}
+	this->once = once;
+	time = 0;
+	playing = true;
 }
 
-SkeletonAnimation::~SkeletonAnimation() {
+Number SkeletonAnimation::getTime() const {
+	return time;
+}
+
+bool SkeletonAnimation::isPlaying() const {
+	return playing;
+}
 
+AnimationClip *SkeletonAnimation::getClip() const {
+	return clip;
+}
+
+SkeletonAnimation::~SkeletonAnimation() {
+	delete clip;
 }
 
 const String& SkeletonAnimation::getName() const {
 	return name;
 }
 
-void SkeletonAnimation::addBoneTrack(BoneTrack *boneTrack) {
-	boneTracks.push_back(boneTrack);
+void SkeletonAnimation::addBoneTrack(BoneTrack *boneTrack, unsigned int boneIndex) {
+	std::vector<Vector3> positions;
+	std::vector<Quaternion> rotations;
+	boneTrack->bake(clip->getNumSamples(), positions, rotations);
+	clip->addTrack(boneIndex, positions, rotations);
+	delete boneTrack;
 }
@@ -21,11 +21,16 @@
 */
 
 #include "PolySound.h"
+#include "PolySoundManager.h"
+#include "PolySoundStream.h"
+#include "PolyCoreServices.h"
 #include <vorbis/vorbisfile.h>
 #include "PolyString.h"
 #include "PolyLogger.h"
 
 #include "OSBasics.h"
+#include <float.h>
+#include <math.h>
 #include <string>
 #include <vector>
 
@@ -52,37 +57,74 @@ long custom_tellfunc(void *datasource) {
 	return OSBasics::tell(file);
 }
 
-Sound::Sound(const String& fileName) : sampleLength(-1) {
-	String extension;
-	size_t found;
-	found=fileName.rfind(".");
-	if (found!=string::npos) {
-		extension = fileName.substr(found+1);
-	} else {
-		extension = "";
-	}
-
-	ALuint buffer;
-	if(extension == "wav" || extension == "WAV") {
-		buffer = loadWAV(fileName);			
-	} else if(extension == "ogg" || extension == "OGG") {
-		buffer = loadOGG(fileName);			
+Sound::Sound(const String& fileName, bool streamed) {
+	initSound();
+	
+	if(streamed) {
+		soundSource = GenSource();
+		stream = new SoundStream(fileName, soundSource);
+		sampleLength = stream->getSampleLength();
+		CoreServices::getInstance()->getSoundManager()->registerStream();
+		setIsPositional(false);
+		return;
 	}
 	
-	soundSource = GenSource(buffer);
-	setIsPositional(false);
+	SoundManager *soundManager = CoreServices::getInstance()->getSoundManager();
+	sample = soundManager->getSample(fileName);
+	if(!sample) {
+		String extension;
+		size_t found;
+		found=fileName.rfind(".");
+		if (found!=string::npos) {
+			extension = fileName.substr(found+1);
+		} else {
+			extension = "";
+		}
+
+		ALuint buffer = AL_NONE;
+		if(extension == "wav" || extension == "WAV") {
+			buffer = loadWAV(fileName);			
+		} else if(extension == "ogg" || extension == "OGG") {
+			buffer = loadOGG(fileName);			
+		}
+		sample = soundManager->addSample(fileName, buffer, sampleLength);
+	}
+	sampleLength = sample->sampleLength;
 }
 
-Sound::Sound(const char *data, int size, int channels, int freq, int bps) : sampleLength(-1) {
+Sound::Sound(const char *data, int size, int channels, int freq, int bps) {
+	initSound();
 	ALuint buffer = loadBytes(data, size, freq, channels, bps);
-	
-	soundSource = GenSource(buffer);
-	setIsPositional(false);
+	sample = CoreServices::getInstance()->getSoundManager()->addSample("", buffer, sampleLength);
 }
 
 Sound::~Sound() {
 	Logger::log("destroying sound...\n");
-	alDeleteSources(1,&soundSource);
+	if(stream) {
+		delete stream;
+		alDeleteSources(1,&soundSource);
+		CoreServices::getInstance()->getSoundManager()->unregisterStream();
+	} else {
+		SoundManager *soundManager = CoreServices::getInstance()->getSoundManager();
+		soundManager->stopSound(this);
+		soundManager->releaseSample(sample);
+	}
+}
+
+void Sound::initSound() {
+	soundSource = 0;
+	sampleLength = -1;
+	stream = NULL;
+	sample = NULL;
+	isPositional = false;
+	volume = 1.0;
+	pitch = 1.0;
+	looping = false;
+	active = false;
+	priority = 0;
+	virtualTime = 0;
+	referenceDistance = 1.0;
+	maxDistance = FLT_MAX;
 }
 
 void Sound::soundCheck(bool result, const String& err) {
@@ -111,98 +153,239 @@ unsigned short Sound::readByte16(const unsigned char buffer[2]) {
 }
 
 void Sound::Play(bool loop) {
-	if(!loop) {
-		alSourcei(soundSource, AL_LOOPING, AL_FALSE);
-	} else {
-		alSourcei(soundSource, AL_LOOPING, AL_TRUE);		
+	if(stream) {
+		stream->Play(loop);
+		return;
 	}
-	alSourcePlay(soundSource);
+	looping = loop;
+	active = true;
+	virtualTime = 0;
+	CoreServices::getInstance()->getSoundManager()->playSound(this);
 }
 
 bool Sound::isPlaying() {
-	ALenum state;
-	alGetSourcei(soundSource, AL_SOURCE_STATE, &state);
-	return (state == AL_PLAYING);
+	if(stream)
+		return stream->isPlaying();
+	if(!active)
+		return false;
+	if(soundSource) {
+		ALenum state;
+		alGetSourcei(soundSource, AL_SOURCE_STATE, &state);
+		return (state == AL_PLAYING);
+	}
+	return true;
 }
 
 
 void Sound::setVolume(Number newVolume) {
-	alSourcef(soundSource, AL_GAIN, newVolume);
+	volume = newVolume;
+	if(soundSource)
+		alSourcef(soundSource, AL_GAIN, newVolume);
 }
 
 void Sound::setPitch(Number newPitch) {
-	alSourcef(soundSource, AL_PITCH, newPitch);
+	pitch = newPitch;
+	if(soundSource)
+		alSourcef(soundSource, AL_PITCH, newPitch);
 }
 
 void Sound::setSoundPosition(Vector3 position) {
-	if(isPositional)
+	if(!isPositional)
+		return;
+	this->position = position;
+	if(soundSource)
 		alSource3f(soundSource,AL_POSITION, position.x, position.y, position.z);
 }
 
 void Sound::setSoundVelocity(Vector3 velocity) {
-	if(isPositional)
+	if(!isPositional)
+		return;
+	this->velocity = velocity;
+	if(soundSource)
 		alSource3f(soundSource,AL_VELOCITY, velocity.x, velocity.y, velocity.z);
 }
 
 void Sound::setSoundDirection(Vector3 direction) {
-	if(isPositional)
+	if(!isPositional)
+		return;
+	this->direction = direction;
+	if(soundSource)
 		alSource3f(soundSource,AL_DIRECTION, direction.x, direction.y, direction.z);
 }
 
 void Sound::setOffset(int off) {
-	alSourcei(soundSource, AL_SAMPLE_OFFSET, off);
+	if(stream) {
+		stream->setOffset(off);
+		return;
+	}
+	if(soundSource) {
+		alSourcei(soundSource, AL_SAMPLE_OFFSET, off);
+	} else if(sampleLength > 0) {
+		virtualTime = getPlaybackDuration() * ((Number)off) / ((Number)sampleLength);
+	}
 }
 
 
 Number Sound::getPlaybackTime() {
+	if(stream)
+		return stream->getPlaybackTime();
+	if(!soundSource)
+		return virtualTime;
 	float result = 0.0;
 	alGetSourcef(soundSource, AL_SEC_OFFSET, &result);
 	return result;
 }
 
 Number Sound::getPlaybackDuration() {
-	ALint sizeInBytes;
-	ALint channels;
-	ALint bits;
-	ALint bufferID;
-	alGetSourcei(soundSource, AL_BUFFER, &bufferID);
-	
-	alGetBufferi(bufferID, AL_SIZE, &sizeInBytes);
-	alGetBufferi(bufferID, AL_CHANNELS, &channels);
-	alGetBufferi(bufferID, AL_BITS, &bits);
-
-	int lengthInSamples = sizeInBytes * 8 / (channels * bits);
-
-	ALint frequency;
-	alGetBufferi(bufferID, AL_FREQUENCY, &frequency);
-	Number durationInSeconds = (float)lengthInSamples / (float)frequency;
-	
-	return durationInSeconds;
+	if(stream)
+		return stream->getPlaybackDuration();
+	return sample->duration;
 }
 		
 int Sound::getOffset() {
+	if(stream)
+		return stream->getOffset();
+	if(!soundSource) {
+		Number duration = getPlaybackDuration();
+		if(duration <= 0 || sampleLength < 0)
+			return -1;
+		return (int)(virtualTime / duration * sampleLength);
+	}
 	ALint off = -1;
 	alGetSourcei(soundSource, AL_SAMPLE_OFFSET, &off);
 	return off;
 }
 
 void Sound::seekTo(Number time) {
+	if(stream) {
+		stream->seekTo(time);
+		return;
+	}
 	if(time > getPlaybackDuration())
 		return;
-	alSourcef(soundSource, AL_SEC_OFFSET, time);
+	if(soundSource) {
+		alSourcef(soundSource, AL_SEC_OFFSET, time);
+	} else {
+		virtualTime = time;
+	}
 }
 
 int Sound::getSampleLength() {
 	return sampleLength;
 }
 
+bool Sound::isStreamed() const {
+	return stream != NULL;
+}
+
+void Sound::setPriority(int priority) {
+	this->priority = priority;
+}
+
+int Sound::getPriority() const {
+	return priority;
+}
+
+bool Sound::isVirtual() const {
+	return active && soundSource == 0;
+}
+
+bool Sound::isActive() const {
+	return active;
+}
+
+void Sound::setInactive() {
+	active = false;
+	virtualTime = 0;
+}
+
+Number Sound::getAudibility() const {
+	if(!isPositional || maxDistance <= referenceDistance)
+		return volume;
+	
+	// Matches the linear clamped distance model set up by SoundManager.
+	Number distance = position.distance(CoreServices::getInstance()->getSoundManager()->getListenerPosition());
+	if(distance <= referenceDistance)
+		return volume;
+	if(distance >= maxDistance)
+		return 0;
+	return volume * (1.0 - (distance - referenceDistance) / (maxDistance - referenceDistance));
+}
+
+void Sound::setVoice(ALuint source, Number offset) {
+	if(soundSource && soundSource != source) {
+		alSourceStop(soundSource);
+		alSourcei(soundSource, AL_BUFFER, AL_NONE);
+	}
+	
+	soundSource = source;
+	virtualTime = offset;
+	if(!soundSource)
+		return;
+	
+	alSourceStop(soundSource);
+	applySourceProperties();
+	alSourcePlay(soundSource);
+	if(offset > 0)
+		alSourcef(soundSource, AL_SEC_OFFSET, offset);
+}
+
+ALuint Sound::getVoice() const {
+	return soundSource;
+}
+
+bool Sound::updateVirtual(Number elapsed) {
+	Number duration = getPlaybackDuration();
+	if(duration <= 0)
+		return false;
+	
+	virtualTime += elapsed;
+	if(virtualTime >= duration) {
+		if(!looping)
+			return false;
+		virtualTime = fmod(virtualTime, duration);
+	}
+	return true;
+}
+
+void Sound::applySourceProperties() {
+	alSourcei(soundSource, AL_BUFFER, sample->buffer);
+	alSourcef(soundSource, AL_GAIN, volume);
+	alSourcef(soundSource, AL_PITCH, pitch);
+	alSourcei(soundSource, AL_LOOPING, looping ? AL_TRUE : AL_FALSE);
+	alSourcef(soundSource, AL_REFERENCE_DISTANCE, referenceDistance);
+	alSourcef(soundSource, AL_MAX_DISTANCE, maxDistance);
+	if(isPositional) {
+		alSourcei(soundSource, AL_SOURCE_RELATIVE, AL_FALSE);
+		alSource3f(soundSource,AL_POSITION, position.x, position.y, position.z);
+		alSource3f(soundSource,AL_VELOCITY, velocity.x, velocity.y, velocity.z);
+		alSource3f(soundSource,AL_DIRECTION, direction.x, direction.y, direction.z);
+	} else {
+		alSourcei(soundSource, AL_SOURCE_RELATIVE, AL_TRUE);	
+		alSource3f(soundSource,AL_POSITION, 0,0,0);
+		alSource3f(soundSource,AL_VELOCITY, 0,0,0);
+		alSource3f(soundSource,AL_DIRECTION, 0,0,0);
+	}
+}
+
 void Sound::setPositionalProperties(Number referenceDistance, Number maxDistance) { 
-	alSourcef(soundSource,AL_REFERENCE_DISTANCE, referenceDistance);
-	alSourcef(soundSource,AL_MAX_DISTANCE, maxDistance);	
+	this->referenceDistance = referenceDistance;
+	this->maxDistance = maxDistance;
+	if(soundSource) {
+		alSourcef(soundSource,AL_REFERENCE_DISTANCE, referenceDistance);
+		alSourcef(soundSource,AL_MAX_DISTANCE, maxDistance);
+	}
 }
 
 void Sound::setIsPositional(bool isPositional) {
 	this->isPositional = isPositional;
+	if(!isPositional) {
+		position = Vector3(0,0,0);
+		velocity = Vector3(0,0,0);
+		direction = Vector3(0,0,0);
+	}
+	if(!soundSource)
+		return;
 	if(isPositional) {
 		alSourcei(soundSource, AL_SOURCE_RELATIVE, AL_FALSE);
 	} else {
@@ -243,7 +426,11 @@ void Sound::checkALError(const String& operation) {
 }
 
 void Sound::Stop() {
-	alSourceStop(soundSource);
+	if(stream) {
+		stream->Stop();
+		return;
+	}
+	CoreServices::getInstance()->getSoundManager()->stopSound(this);
 }
 
 ALuint Sound::GenSource() {
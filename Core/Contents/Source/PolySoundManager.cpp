@@ -21,14 +21,281 @@
 */
 
 #include "PolySoundManager.h"
+#include "PolySound.h"
 #include "PolyLogger.h"
+#include <algorithm>
 
 using namespace Polycode;
 
-SoundManager::SoundManager() {
+SoundSample::SoundSample() : buffer(AL_NONE), sampleLength(-1), duration(0), refCount(1) {
+}
+
+SoundManager::SoundManager() : device(NULL), context(NULL), maxVoices(32), numSamples(0), numStreams(0) {
 	initAL();
 }
 
+bool SoundManager::openDevice(const String& deviceName) {
+	// Every sound holds either a sample or a stream, so this also means nothing is playing.
+	if(numSamples > 0 || numStreams > 0) {
+		Logger::log("SoundManager: Cannot switch to device %s while %d samples and %d streams are loaded\n", deviceName.c_str(), numSamples, numStreams);
+		return false;
+	}
+	closeDevice();
+	
+	device = alcOpenDevice(deviceName == "" ? NULL : deviceName.c_str());
+	if(device == 0) {
+		Logger::log("SoundManager: Cannot open device %s\n", deviceName.c_str());
+		return false;
+	}
+	context = alcCreateContext(device, 0);
+	if(context == 0 || alcMakeContextCurrent(context) != ALC_TRUE) {
+		Logger::log("SoundManager: Cannot create context on device %s\n", deviceName.c_str());
+		closeDevice();
+		return false;
+	}
+	alDistanceModel(AL_LINEAR_DISTANCE_CLAMPED);
+	setListenerPosition(listenerPosition);
+	createVoices();
+	return true;
+}
+
+void SoundManager::closeDevice() {
+	if(voices.size() > 0) {
+		alDeleteSources(voices.size(), &voices[0]);
+	}
+	voices.clear();
+	freeVoices.clear();
+	
+	if (context != 0 ) {
+		alcSuspendContext(context);
+		alcMakeContextCurrent(0);
+		alcDestroyContext(context);
+		context = 0;
+	}
+	if (device != 0) {
+		alcCloseDevice(device);
+		device = 0;
+	}
+}
+
+void SoundManager::createVoices() {
+	alGetError();
+	for(int i=0; i < maxVoices; i++) {
+		ALuint source;
+		alGenSources(1, &source);
+		// Stop at the device's source limit.
+		if(alGetError() != AL_NO_ERROR)
+			break;
+		voices.push_back(source);
+		freeVoices.push_back(source);
+	}
+	Logger::log("SoundManager: created %d voices\n", voices.size());
+}
+
+void SoundManager::setMaxVoices(unsigned int maxVoices) {
+	this->maxVoices = maxVoices;
+}
+
+unsigned int SoundManager::getNumVoices() const {
+	return voices.size();
+}
+
+unsigned int SoundManager::getNumFreeVoices() const {
+	return freeVoices.size();
+}
+
+unsigned int SoundManager::getNumPlayingSounds() const {
+	return playingSounds.size();
+}
+
+unsigned int SoundManager::getNumVirtualSounds() const {
+	unsigned int count = 0;
+	for(int i=0; i < playingSounds.size(); i++) {
+		if(playingSounds[i]->isVirtual())
+			count++;
+	}
+	return count;
+}
+
+unsigned int SoundManager::getNumCachedSamples() const {
+	return samples.size();
+}
+
+Vector3 SoundManager::getListenerPosition() const {
+	return listenerPosition;
+}
+
+SoundSample *SoundManager::getSample(const String& fileName) {
+	std::map<std::string, SoundSample*>::iterator it = samples.find(fileName.getSTLString());
+	if(it == samples.end())
+		return NULL;
+	it->second->refCount++;
+	return it->second;
+}
+
+SoundSample *SoundManager::addSample(const String& fileName, ALuint buffer, int sampleLength) {
+	SoundSample *sample = new SoundSample();
+	sample->fileName = fileName;
+	sample->buffer = buffer;
+	sample->sampleLength = sampleLength;
+	numSamples++;
+	
+	if(buffer != AL_NONE) {
+		ALint sizeInBytes, channels, bits, frequency;
+		alGetBufferi(buffer, AL_SIZE, &sizeInBytes);
+		alGetBufferi(buffer, AL_CHANNELS, &channels);
+		alGetBufferi(buffer, AL_BITS, &bits);
+		alGetBufferi(buffer, AL_FREQUENCY, &frequency);
+		if(channels > 0 && bits > 0 && frequency > 0) {
+			int lengthInSamples = sizeInBytes * 8 / (channels * bits);
+			sample->duration = (Number)lengthInSamples / (Number)frequency;
+		}
+	}
+	
+	if(fileName != "") {
+		samples[fileName.getSTLString()] = sample;
+	}
+	return sample;
+}
+
+void SoundManager::releaseSample(SoundSample *sample) {
+	if(!sample)
+		return;
+	sample->refCount--;
+	if(sample->refCount > 0)
+		return;
+	
+	if(sample->fileName != "") {
+		samples.erase(sample->fileName.getSTLString());
+	}
+	if(sample->buffer != AL_NONE) {
+		alDeleteBuffers(1, &sample->buffer);
+	}
+	delete sample;
+	numSamples--;
+}
+
+void SoundManager::registerStream() {
+	numStreams++;
+}
+
+void SoundManager::unregisterStream() {
+	if(numStreams > 0)
+		numStreams--;
+}
+
+static bool soundMoreImportant(Sound *a, Sound *b) {
+	if(a->getPriority() != b->getPriority())
+		return a->getPriority() > b->getPriority();
+	return a->getAudibility() > b->getAudibility();
+}
+
+bool SoundManager::assignVoice(Sound *sound) {
+	if(freeVoices.size() == 0) {
+		// Steal the voice of the least important voiced sound, if it matters less than this one.
+		Sound *victim = NULL;
+		for(int i=0; i < playingSounds.size(); i++) {
+			Sound *candidate = playingSounds[i];
+			if(candidate == sound || candidate->getVoice() == 0)
+				continue;
+			if(!victim || soundMoreImportant(victim, candidate))
+				victim = candidate;
+		}
+		if(!victim || !soundMoreImportant(sound, victim))
+			return false;
+		virtualizeSound(victim);
+	}
+	
+	ALuint voice = freeVoices.back();
+	freeVoices.pop_back();
+	sound->setVoice(voice, sound->getPlaybackTime());
+	return true;
+}
+
+void SoundManager::freeVoice(Sound *sound) {
+	ALuint voice = sound->getVoice();
+	if(!voice)
+		return;
+	sound->setVoice(0, 0);
+	freeVoices.push_back(voice);
+}
+
+void SoundManager::virtualizeSound(Sound *sound) {
+	ALuint voice = sound->getVoice();
+	if(!voice)
+		return;
+	sound->setVoice(0, sound->getPlaybackTime());
+	freeVoices.push_back(voice);
+}
+
+void SoundManager::removePlayingSound(Sound *sound) {
+	for(int i=0; i < playingSounds.size(); i++) {
+		if(playingSounds[i] == sound) {
+			playingSounds.erase(playingSounds.begin()+i);
+			return;
+		}
+	}
+}
+
+void SoundManager::playSound(Sound *sound) {
+	if(sound->getVoice()) {
+		// Restart on the voice the sound already has.
+		sound->setVoice(sound->getVoice(), 0);
+		return;
+	}
+	
+	removePlayingSound(sound);
+	playingSounds.push_back(sound);
+	if(sound->getAudibility() > 0) {
+		assignVoice(sound);
+	}
+}
+
+void SoundManager::stopSound(Sound *sound) {
+	freeVoice(sound);
+	removePlayingSound(sound);
+	sound->setInactive();
+}
+
+void SoundManager::Update(int elapsed) {
+	Number elapsedSeconds = ((Number)elapsed) / 1000.0;
+	
+	std::vector<Sound*> audibleVirtualSounds;
+	for(int i=0; i < playingSounds.size(); i++) {
+		Sound *sound = playingSounds[i];
+		bool finished = false;
+		
+		if(sound->getVoice()) {
+			ALint state;
+			alGetSourcei(sound->getVoice(), AL_SOURCE_STATE, &state);
+			if(state == AL_STOPPED) {
+				finished = true;
+			} else if(sound->getAudibility() <= 0) {
+				virtualizeSound(sound);
+			}
+		} else {
+			finished = !sound->updateVirtual(elapsedSeconds);
+			if(!finished && sound->getAudibility() > 0) {
+				audibleVirtualSounds.push_back(sound);
+			}
+		}
+		
+		if(finished) {
+			freeVoice(sound);
+			sound->setInactive();
+			playingSounds.erase(playingSounds.begin()+i);
+			i--;
+		}
+	}
+	
+	// Give voices back to the most important virtual sounds that became audible.
+	std::sort(audibleVirtualSounds.begin(), audibleVirtualSounds.end(), soundMoreImportant);
+	for(int i=0; i < audibleVirtualSounds.size(); i++) {
+		if(!assignVoice(audibleVirtualSounds[i]))
+			break;
+	}
+}
+
 void SoundManager::initAL() {
 	alGetError();
 	if(alcGetCurrentContext() == 0) {
@@ -86,6 +353,8 @@ void SoundManager::initAL() {
 	alDistanceModel(AL_LINEAR_DISTANCE_CLAMPED);
 //	alDistanceModel(AL_INVERSE_DISTANCE_CLAMPED);
 	
+	createVoices();
+	
 	Logger::log("OpenAL initialized...\n");
 }
 
@@ -94,6 +363,7 @@ void SoundManager::setGlobalVolume(Number globalVolume) {
 }
 
 void SoundManager::setListenerPosition(Vector3 position) {
+	listenerPosition = position;
 	alListener3f(AL_POSITION, position.x, position.y, position.z);
 }
 
@@ -102,12 +372,17 @@ void SoundManager::setListenerOrientation(Vector3 orientation) {
 }
 
 SoundManager::~SoundManager() {
-	if (context != 0 ) {
-		alcSuspendContext(context);
-		alcMakeContextCurrent(0);
-		alcDestroyContext(context);
+	// Buffers can't be deleted while a source still uses them.
+	for(int i=0; i < voices.size(); i++) {
+		alSourceStop(voices[i]);
+		alSourcei(voices[i], AL_BUFFER, AL_NONE);
 	}
-	if (device != 0) {
-		alcCloseDevice(device);
+	for(std::map<std::string, SoundSample*>::iterator it = samples.begin(); it != samples.end(); it++) {
+		if(it->second->buffer != AL_NONE) {
+			alDeleteBuffers(1, &it->second->buffer);
+		}
+		delete it->second;
 	}
+	samples.clear();
+	closeDevice();
 }
@@ -0,0 +1,471 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+ 
+
+#include "PolySoundStream.h"
+#include "PolySound.h"
+#include "PolyCore.h"
+#include "PolyCoreServices.h"
+#include "PolyLogger.h"
+#include "OSBasics.h"
+#include <math.h>
+
+#ifdef _WINDOWS
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace Polycode;
+
+// OGG file callbacks, defined in PolySound.cpp
+size_t custom_readfunc(void *ptr, size_t size, size_t nmemb, void *datasource);
+int custom_seekfunc(void *datasource, ogg_int64_t offset, int whence);
+int custom_closefunc(void *datasource);
+long custom_tellfunc(void *datasource);
+
+static void soundStreamSleep(unsigned int milliseconds) {
+#ifdef _WINDOWS
+	Sleep(milliseconds);
+#else
+	usleep(milliseconds * 1000);
+#endif
+}
+
+SoundStreamDecoder::SoundStreamDecoder() : channels(0), frequency(0), bitsPerSample(16) {
+}
+
+ALenum SoundStreamDecoder::getFormat() const {
+	if(channels == 1)
+		return (bitsPerSample == 8) ? AL_FORMAT_MONO8 : AL_FORMAT_MONO16;
+	else
+		return (bitsPerSample == 8) ? AL_FORMAT_STEREO8 : AL_FORMAT_STEREO16;
+}
+
+Number SoundStreamDecoder::getDuration() {
+	long samples = getSampleLength();
+	if(samples < 0 || frequency == 0)
+		return 0;
+	return ((Number)samples) / ((Number)frequency);
+}
+
+OGGSoundStreamDecoder::OGGSoundStreamDecoder() : SoundStreamDecoder(), fileOpen(false) {
+}
+
+OGGSoundStreamDecoder::~OGGSoundStreamDecoder() {
+	if(fileOpen)
+		ov_clear(&oggFile);
+}
+
+bool OGGSoundStreamDecoder::open(const String& fileName) {
+	OSFILE *f = OSBasics::open(fileName.c_str(), "rb");
+	if(!f) {
+		return false;
+	}
+	
+	ov_callbacks callbacks;
+	callbacks.read_func = custom_readfunc;
+	callbacks.seek_func = custom_seekfunc;
+	callbacks.close_func = custom_closefunc;
+	callbacks.tell_func = custom_tellfunc;
+	
+	if(ov_open_callbacks((void*)f, &oggFile, NULL, 0, callbacks) != 0) {
+		OSBasics::close(f);
+		return false;
+	}
+	fileOpen = true;
+	
+	vorbis_info *pInfo = ov_info(&oggFile, -1);
+	channels = pInfo->channels;
+	frequency = pInfo->rate;
+	bitsPerSample = 16;
+	return true;
+}
+
+long OGGSoundStreamDecoder::read(char *buffer, long size) {
+	if(!fileOpen)
+		return 0;
+	
+	int bitStream;
+	long total = 0;
+	while(total < size) {
+		long bytes = ov_read(&oggFile, buffer + total, size - total, 0, 2, 1, &bitStream);
+		if(bytes <= 0)
+			break;
+		total += bytes;
+	}
+	return total;
+}
+
+bool OGGSoundStreamDecoder::seek(Number time) {
+	if(!fileOpen)
+		return false;
+	return ov_time_seek(&oggFile, time) == 0;
+}
+
+long OGGSoundStreamDecoder::getSampleLength() {
+	if(!fileOpen)
+		return -1;
+	return (long)ov_pcm_total(&oggFile, -1);
+}
+
+WAVSoundStreamDecoder::WAVSoundStreamDecoder() : SoundStreamDecoder(), file(NULL), dataStart(0), dataSize(0), dataPosition(0), blockAlign(0) {
+}
+
+WAVSoundStreamDecoder::~WAVSoundStreamDecoder() {
+	if(file)
+		OSBasics::close(file);
+}
+
+bool WAVSoundStreamDecoder::open(const String& fileName) {
+	file = OSBasics::open(fileName.c_str(), "rb");
+	if(!file)
+		return false;
+	
+	char magic[5];
+	magic[4] = '\0';
+	unsigned char buffer32[4];
+	unsigned char buffer16[2];
+	
+	if(OSBasics::read(magic,4,1,file) != 1 || String(magic) != "RIFF")
+		return false;
+	OSBasics::seek(file,4,SEEK_CUR);
+	if(OSBasics::read(magic,4,1,file) != 1 || String(magic) != "WAVE")
+		return false;
+	
+	bool haveFormat = false;
+	while(OSBasics::read(magic,4,1,file) == 1 && OSBasics::read(buffer32,4,1,file) == 1) {
+		long chunkSize = Sound::readByte32(buffer32);
+		
+		if(String(magic) == "fmt ") {
+			if(chunkSize < 16)
+				return false;
+			OSBasics::read(buffer16,2,1,file);
+			if(Sound::readByte16(buffer16) != 1)
+				return false;
+			OSBasics::read(buffer16,2,1,file);
+			channels = Sound::readByte16(buffer16);
+			OSBasics::read(buffer32,4,1,file);
+			frequency = Sound::readByte32(buffer32);
+			OSBasics::seek(file,4,SEEK_CUR);
+			OSBasics::read(buffer16,2,1,file);
+			blockAlign = Sound::readByte16(buffer16);
+			OSBasics::read(buffer16,2,1,file);
+			bitsPerSample = Sound::readByte16(buffer16);
+			OSBasics::seek(file,chunkSize - 16 + (chunkSize & 1),SEEK_CUR);
+			haveFormat = true;
+		} else if(String(magic) == "data") {
+			dataStart = OSBasics::tell(file);
+			dataSize = chunkSize;
+			dataPosition = 0;
+			return haveFormat && blockAlign > 0;
+		} else {
+			OSBasics::seek(file,chunkSize + (chunkSize & 1),SEEK_CUR);
+		}
+	}
+	return false;
+}
+
+long WAVSoundStreamDecoder::read(char *buffer, long size) {
+	if(!file)
+		return 0;
+	
+	if(size > dataSize - dataPosition)
+		size = dataSize - dataPosition;
+	if(size <= 0)
+		return 0;
+	
+	long bytes = OSBasics::read(buffer, 1, size, file);
+	if(bytes < 0)
+		return 0;
+	dataPosition += bytes;
+	return bytes;
+}
+
+bool WAVSoundStreamDecoder::seek(Number time) {
+	if(!file)
+		return false;
+	
+	long position = ((long)(time * frequency)) * blockAlign;
+	if(position < 0 || position > dataSize)
+		return false;
+	
+	dataPosition = position;
+	return OSBasics::seek(file, dataStart + dataPosition, SEEK_SET) == 0;
+}
+
+long WAVSoundStreamDecoder::getSampleLength() {
+	if(!file || blockAlign == 0)
+		return -1;
+	return dataSize / blockAlign;
+}
+
+SoundStream::SoundStream(const String& fileName, ALuint source) : Threaded(), source(source), playbackStart(0), startOffset(0), looping(false), playing(false), endOfStream(false), threadFinished(true) {
+	
+	String extension;
+	size_t found = fileName.rfind(".");
+	if(found != std::string::npos) {
+		extension = fileName.substr(found+1);
+	}
+	
+	if(extension == "wav" || extension == "WAV") {
+		decoder = new WAVSoundStreamDecoder();
+	} else {
+		decoder = new OGGSoundStreamDecoder();
+	}
+	
+	valid = decoder->open(fileName);
+	if(!valid) {
+		Logger::log("SOUND ERROR: Could not open %s for streaming\n", fileName.c_str());
+	}
+	
+	alGenBuffers(NUM_BUFFERS, buffers);
+	for(int i=0; i < NUM_BUFFERS; i++) {
+		bufferDurations[i] = 0;
+		bufferQueued[i] = false;
+	}
+	decodeBuffer = new char[STREAM_BUFFER_SIZE];
+	
+	Core *core = CoreServices::getInstance()->getCore();
+	streamMutex = core->createMutex();
+	if(valid) {
+		threadFinished = false;
+		core->createThread(this);
+	}
+}
+
+SoundStream::~SoundStream() {
+	killThread();
+	while(!threadFinished) {
+		soundStreamSleep(1);
+	}
+	
+	alSourceStop(source);
+	clearQueue();
+	alDeleteBuffers(NUM_BUFFERS, buffers);
+	
+	delete [] decodeBuffer;
+	delete decoder;
+	delete streamMutex;
+}
+
+bool SoundStream::isValid() const {
+	return valid;
+}
+
+bool SoundStream::fillBuffer(int index) {
+	long filled = 0;
+	while(filled < STREAM_BUFFER_SIZE) {
+		long bytes = decoder->read(decodeBuffer + filled, STREAM_BUFFER_SIZE - filled);
+		if(bytes > 0) {
+			filled += bytes;
+			continue;
+		}
+		
+		// End of the file. Wrap around if looping, unless the file is empty.
+		if(looping && decoder->getSampleLength() > 0 && decoder->seek(0)) {
+			continue;
+		}
+		endOfStream = true;
+		break;
+	}
+	
+	if(filled == 0)
+		return false;
+	
+	alBufferData(buffers[index], decoder->getFormat(), decodeBuffer, filled, decoder->frequency);
+	
+	Number bytesPerSecond = decoder->frequency * decoder->channels * (decoder->bitsPerSample / 8);
+	bufferDurations[index] = bytesPerSecond > 0 ? ((Number)filled) / bytesPerSecond : 0;
+	return true;
+}
+
+void SoundStream::queueFreeBuffers() {
+	for(int i=0; i < NUM_BUFFERS && !endOfStream; i++) {
+		if(bufferQueued[i])
+			continue;
+		if(!fillBuffer(i))
+			break;
+		alSourceQueueBuffers(source, 1, &buffers[i]);
+		bufferQueued[i] = true;
+	}
+}
+
+void SoundStream::clearQueue() {
+	alSourceStop(source);
+	
+	ALint queued = 0;
+	alGetSourcei(source, AL_BUFFERS_QUEUED, &queued);
+	while(queued > 0) {
+		ALuint buffer;
+		alSourceUnqueueBuffers(source, 1, &buffer);
+		queued--;
+	}
+	alSourcei(source, AL_BUFFER, AL_NONE);
+	
+	for(int i=0; i < NUM_BUFFERS; i++) {
+		bufferQueued[i] = false;
+	}
+}
+
+void SoundStream::startQueue(Number time) {
+	clearQueue();
+	decoder->seek(time);
+	playbackStart = time;
+	endOfStream = false;
+	
+	// Start as soon as the first buffer is ready, the streaming thread queues the rest.
+	if(fillBuffer(0)) {
+		alSourceQueueBuffers(source, 1, &buffers[0]);
+		bufferQueued[0] = true;
+		alSourcePlay(source);
+		playing = true;
+	} else {
+		playing = false;
+	}
+}
+
+void SoundStream::Play(bool loop) {
+	if(!valid)
+		return;
+	
+	Core *core = CoreServices::getInstance()->getCore();
+	core->lockMutex(streamMutex);
+	looping = loop;
+	startQueue(startOffset);
+	startOffset = 0;
+	core->unlockMutex(streamMutex);
+}
+
+void SoundStream::Stop() {
+	Core *core = CoreServices::getInstance()->getCore();
+	core->lockMutex(streamMutex);
+	clearQueue();
+	playing = false;
+	playbackStart = 0;
+	startOffset = 0;
+	core->unlockMutex(streamMutex);
+}
+
+bool SoundStream::isPlaying() {
+	return playing;
+}
+
+void SoundStream::seekTo(Number time) {
+	if(!valid || time < 0 || time > getPlaybackDuration())
+		return;
+	
+	Core *core = CoreServices::getInstance()->getCore();
+	core->lockMutex(streamMutex);
+	if(playing) {
+		startQueue(time);
+	} else {
+		startOffset = time;
+		playbackStart = time;
+	}
+	core->unlockMutex(streamMutex);
+}
+
+Number SoundStream::getPlaybackTime() {
+	Core *core = CoreServices::getInstance()->getCore();
+	core->lockMutex(streamMutex);
+	float offset = 0.0;
+	if(playing) {
+		alGetSourcef(source, AL_SEC_OFFSET, &offset);
+	}
+	Number time = playbackStart + offset;
+	core->unlockMutex(streamMutex);
+	
+	Number duration = getPlaybackDuration();
+	if(looping && duration > 0)
+		time = fmod(time, duration);
+	return time;
+}
+
+Number SoundStream::getPlaybackDuration() {
+	return decoder->getDuration();
+}
+
+void SoundStream::setOffset(int off) {
+	if(decoder->frequency > 0)
+		seekTo(((Number)off) / ((Number)decoder->frequency));
+}
+
+int SoundStream::getOffset() {
+	return (int)(getPlaybackTime() * decoder->frequency);
+}
+
+int SoundStream::getSampleLength() {
+	return decoder->getSampleLength();
+}
+
+void SoundStream::update() {
+	Core *core = CoreServices::getInstance()->getCore();
+	core->lockMutex(streamMutex);
+	if(!playing) {
+		core->unlockMutex(streamMutex);
+		return;
+	}
+	
+	ALint processed = 0;
+	alGetSourcei(source, AL_BUFFERS_PROCESSED, &processed);
+	while(processed > 0) {
+		ALuint buffer;
+		alSourceUnqueueBuffers(source, 1, &buffer);
+		for(int i=0; i < NUM_BUFFERS; i++) {
+			if(buffers[i] == buffer) {
+				bufferQueued[i] = false;
+				playbackStart += bufferDurations[i];
+			}
+		}
+		processed--;
+	}
+	
+	queueFreeBuffers();
+	
+	ALint state;
+	alGetSourcei(source, AL_SOURCE_STATE, &state);
+	if(state != AL_PLAYING) {
+		ALint queued = 0;
+		alGetSourcei(source, AL_BUFFERS_QUEUED, &queued);
+		if(queued > 0) {
+			// The decoder fell behind and the source ran out of buffers.
+			alSourcePlay(source);
+		} else {
+			playing = false;
+			playbackStart = 0;
+		}
+	}
+	core->unlockMutex(streamMutex);
+}
+
+void SoundStream::runThread() {
+	while(threadRunning) {
+		updateThread();
+	}
+	threadFinished = true;
+}
+
+void SoundStream::updateThread() {
+	update();
+	soundStreamSleep(10);
+}
@@ -0,0 +1,200 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+ 
+
+#include "PolyTextureAtlas.h"
+#include "PolyCoreServices.h"
+#include "PolyImage.h"
+#include "PolyLogger.h"
+#include "PolyMaterialManager.h"
+#include "PolyRenderer.h"
+#include "PolyTexture.h"
+#include <string.h>
+
+using namespace Polycode;
+
+TextureAtlas::TextureAtlas(unsigned int pageSize, unsigned int padding) {
+	this->pageSize = pageSize;
+	this->padding = padding;
+}
+
+TextureAtlas::~TextureAtlas() {
+	for(int i=0; i < pages.size(); i++) {
+		if(pages[i].texture) {
+			CoreServices::getInstance()->getMaterialManager()->deleteTexture(pages[i].texture);
+		}
+		delete pages[i].image;
+		delete pages[i].packer;
+	}
+	
+	for(std::map<std::string, TextureAtlasRegion*>::iterator it = regions.begin(); it != regions.end(); it++) {
+		delete it->second;
+	}
+}
+
+unsigned int TextureAtlas::getNumPages() const {
+	return pages.size();
+}
+
+unsigned int TextureAtlas::getPageSize() const {
+	return pageSize;
+}
+
+TextureAtlasRegion *TextureAtlas::getRegion(const String& name) {
+	std::map<std::string, TextureAtlasRegion*>::iterator it = regions.find(name.getSTLString());
+	if(it == regions.end())
+		return NULL;
+	return it->second;
+}
+
+void TextureAtlas::copyImage(Image *image, const PackedRect &rect, AtlasPage *page) {
+	int channels = image->getType() == Image::IMAGE_RGB ? 3 : 4;
+	unsigned int imageWidth = image->getWidth();
+	unsigned int imageHeight = image->getHeight();
+	unsigned char *src = (unsigned char*)image->getPixels();
+	unsigned char *dst = (unsigned char*)page->image->getPixels();
+	
+	for(unsigned int y=0; y < rect.height; y++) {
+		int sourceY = (int)y - (int)padding;
+		if(sourceY < 0) sourceY = 0;
+		if(sourceY >= (int)imageHeight) sourceY = imageHeight - 1;
+		
+		for(unsigned int x=0; x < rect.width; x++) {
+			int sourceX = (int)x - (int)padding;
+			if(sourceX < 0) sourceX = 0;
+			if(sourceX >= (int)imageWidth) sourceX = imageWidth - 1;
+			
+			unsigned char *srcPixel = src + (sourceY * imageWidth + sourceX) * channels;
+			unsigned char *dstPixel = dst + ((rect.y + y) * pageSize + rect.x + x) * 4;
+			dstPixel[0] = srcPixel[0];
+			dstPixel[1] = srcPixel[1];
+			dstPixel[2] = srcPixel[2];
+			dstPixel[3] = channels == 4 ? srcPixel[3] : 255;
+		}
+	}
+	
+	if(!page->dirty) {
+		page->dirtyMinX = rect.x;
+		page->dirtyMinY = rect.y;
+		page->dirtyMaxX = rect.x + rect.width;
+		page->dirtyMaxY = rect.y + rect.height;
+	} else {
+		if(rect.x < page->dirtyMinX) page->dirtyMinX = rect.x;
+		if(rect.y < page->dirtyMinY) page->dirtyMinY = rect.y;
+		if(rect.x + rect.width > page->dirtyMaxX) page->dirtyMaxX = rect.x + rect.width;
+		if(rect.y + rect.height > page->dirtyMaxY) page->dirtyMaxY = rect.y + rect.height;
+	}
+	page->dirty = true;
+}
+
+TextureAtlasRegion *TextureAtlas::addImage(const String& name, Image *image) {
+	if(image->getType() != Image::IMAGE_RGB && image->getType() != Image::IMAGE_RGBA) {
+		Logger::log("Texture atlases can only hold RGB or RGBA images\n");
+		return NULL;
+	}
+	
+	unsigned int paddedWidth = image->getWidth() + padding * 2;
+	unsigned int paddedHeight = image->getHeight() + padding * 2;
+	if(paddedWidth > pageSize || paddedHeight > pageSize) {
+		Logger::log("Image %s is too large for a %dx%d atlas page\n", name.c_str(), pageSize, pageSize);
+		return NULL;
+	}
+	
+	PackedRect rect;
+	bool placed = false;
+	unsigned int pageIndex = 0;
+	for(pageIndex = 0; pageIndex < pages.size(); pageIndex++) {
+		placed = pages[pageIndex].packer->insert(paddedWidth, paddedHeight, &rect);
+		if(placed)
+			break;
+	}
+	
+	if(!placed) {
+		AtlasPage page;
+		page.image = new Image(pageSize, pageSize, Image::IMAGE_RGBA);
+		memset(page.image->getPixels(), 0, pageSize * pageSize * 4);
+		page.texture = NULL;
+		page.packer = new RectPacker(pageSize, pageSize);
+		page.dirty = false;
+		pages.push_back(page);
+		pageIndex = pages.size() - 1;
+		pages[pageIndex].packer->insert(paddedWidth, paddedHeight, &rect);
+	}
+	
+	copyImage(image, rect, &pages[pageIndex]);
+	
+	TextureAtlasRegion *region = getRegion(name);
+	if(!region) {
+		region = new TextureAtlasRegion();
+		regions[name.getSTLString()] = region;
+	}
+	region->page = pageIndex;
+	region->x = rect.x + padding;
+	region->y = rect.y + padding;
+	region->width = image->getWidth();
+	region->height = image->getHeight();
+	
+	// image rows are stored bottom up, so the top of the image has the larger v coordinate
+	region->left = ((Number)region->x) / ((Number)pageSize);
+	region->right = ((Number)(region->x + region->width)) / ((Number)pageSize);
+	region->bottom = ((Number)region->y) / ((Number)pageSize);
+	region->top = ((Number)(region->y + region->height)) / ((Number)pageSize);
+	return region;
+}
+
+TextureAtlasRegion *TextureAtlas::addImageFromFile(const String& fileName) {
+	TextureAtlasRegion *region = getRegion(fileName);
+	if(region)
+		return region;
+	
+	Image *image = new Image(fileName);
+	if(image->isLoaded()) {
+		region = addImage(fileName, image);
+	} else {
+		Logger::log("Error loading image %s for texture atlas\n", fileName.c_str());
+	}
+	delete image;
+	return region;
+}
+
+Texture *TextureAtlas::getPageTexture(unsigned int page) {
+	if(page >= pages.size())
+		return NULL;
+	
+	AtlasPage &atlasPage = pages[page];
+	if(!atlasPage.texture) {
+		atlasPage.texture = CoreServices::getInstance()->getMaterialManager()->createTextureFromImage(atlasPage.image, true, false);
+		atlasPage.dirty = false;
+	} else if(atlasPage.dirty) {
+		// copy and upload only the rows and columns touched since the last upload
+		unsigned int dirtyWidth = atlasPage.dirtyMaxX - atlasPage.dirtyMinX;
+		char *src = atlasPage.image->getPixels();
+		char *dst = atlasPage.texture->getTextureData();
+		for(unsigned int y=atlasPage.dirtyMinY; y < atlasPage.dirtyMaxY; y++) {
+			unsigned int offset = (y * pageSize + atlasPage.dirtyMinX) * 4;
+			memcpy(dst + offset, src + offset, dirtyWidth * 4);
+		}
+		CoreServices::getInstance()->getRenderer()->updateTextureRegion(atlasPage.texture, atlasPage.dirtyMinX, atlasPage.dirtyMinY, dirtyWidth, atlasPage.dirtyMaxY - atlasPage.dirtyMinY);
+		atlasPage.dirty = false;
+	}
+	return atlasPage.texture;
+}
@@ -0,0 +1,557 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+ 
+
+#include "PolyTextureContainer.h"
+#include "PolyImage.h"
+#include "PolyLogger.h"
+#include "OSBasics.h"
+#include <string.h>
+#include <stdlib.h>
+
+using namespace Polycode;
+
+#define TEXTURE_CONTAINER_MAGIC "PTEX"
+#define TEXTURE_CONTAINER_VERSION 1
+
+TextureContainer::TextureContainer() {
+	width = 0;
+	height = 0;
+	format = FORMAT_RGBA;
+	levelDataReleased = false;
+}
+
+TextureContainer::~TextureContainer() {
+	clear();
+}
+
+void TextureContainer::clear() {
+	for(int i=0; i < levels.size(); i++) {
+		free(levels[i].data);
+	}
+	levels.clear();
+	width = 0;
+	height = 0;
+	fileName = "";
+	levelDataReleased = false;
+}
+
+void TextureContainer::releaseLevelData() {
+	for(int i=0; i < levels.size(); i++) {
+		free(levels[i].data);
+		levels[i].data = NULL;
+	}
+	levelDataReleased = true;
+}
+
+bool TextureContainer::reloadLevelData() {
+	if(!levelDataReleased)
+		return true;
+	if(fileName == "")
+		return false;
+	
+	String sourceFileName = fileName;
+	unsigned int numLevels = levels.size();
+	if(!loadFromFile(sourceFileName) || levels.size() != numLevels) {
+		Logger::log("Could not reload texture container %s\n", sourceFileName.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool TextureContainer::hasLevelData() const {
+	return !levelDataReleased;
+}
+
+const String& TextureContainer::getFileName() const {
+	return fileName;
+}
+
+unsigned int TextureContainer::getLevelDataSize(int format, unsigned int width, unsigned int height) {
+	switch(format) {
+		case FORMAT_RGBA:
+			return width * height * 4;
+		case FORMAT_RGB:
+			return width * height * 3;
+		case FORMAT_DXT1:
+			return ((width + 3) / 4) * ((height + 3) / 4) * 8;
+		case FORMAT_DXT5:
+			return ((width + 3) / 4) * ((height + 3) / 4) * 16;
+	}
+	return 0;
+}
+
+unsigned int TextureContainer::getWidth() const {
+	return width;
+}
+
+unsigned int TextureContainer::getHeight() const {
+	return height;
+}
+
+int TextureContainer::getFormat() const {
+	return format;
+}
+
+bool TextureContainer::isCompressed() const {
+	return format == FORMAT_DXT1 || format == FORMAT_DXT5;
+}
+
+unsigned int TextureContainer::getNumLevels() const {
+	return levels.size();
+}
+
+const TextureLevel& TextureContainer::getLevel(unsigned int index) const {
+	return levels[index];
+}
+
+int TextureContainer::formatFromName(const String& name) {
+	String lowerName = name.toLowerCase();
+	if(lowerName == "rgba")
+		return FORMAT_RGBA;
+	if(lowerName == "rgb")
+		return FORMAT_RGB;
+	if(lowerName == "dxt1")
+		return FORMAT_DXT1;
+	if(lowerName == "dxt5")
+		return FORMAT_DXT5;
+	return -1;
+}
+
+Image *TextureContainer::createMipLevel(Image *source) {
+	unsigned int sourceWidth = source->getWidth();
+	unsigned int sourceHeight = source->getHeight();
+	unsigned int mipWidth = sourceWidth > 1 ? sourceWidth / 2 : 1;
+	unsigned int mipHeight = sourceHeight > 1 ? sourceHeight / 2 : 1;
+	int channels = source->getType() == Image::IMAGE_RGB ? 3 : 4;
+	
+	Image *mip = new Image(mipWidth, mipHeight, source->getType());
+	unsigned char *src = (unsigned char*)source->getPixels();
+	unsigned char *dst = (unsigned char*)mip->getPixels();
+	
+	for(unsigned int y=0; y < mipHeight; y++) {
+		unsigned int y0 = y * 2;
+		unsigned int y1 = (y0 + 1 < sourceHeight) ? y0 + 1 : y0;
+		for(unsigned int x=0; x < mipWidth; x++) {
+			unsigned int x0 = x * 2;
+			unsigned int x1 = (x0 + 1 < sourceWidth) ? x0 + 1 : x0;
+			for(int c=0; c < channels; c++) {
+				unsigned int sum = src[(y0 * sourceWidth + x0) * channels + c] + src[(y0 * sourceWidth + x1) * channels + c] + src[(y1 * sourceWidth + x0) * channels + c] + src[(y1 * sourceWidth + x1) * channels + c];
+				dst[(y * mipWidth + x) * channels + c] = (sum + 2) / 4;
+			}
+		}
+	}
+	return mip;
+}
+
+static unsigned short packColor565(const unsigned char *color) {
+	return ((color[0] >> 3) << 11) | ((color[1] >> 2) << 5) | (color[2] >> 3);
+}
+
+static void unpackColor565(unsigned short packed, unsigned char *color) {
+	unsigned char r = (packed >> 11) & 31;
+	unsigned char g = (packed >> 5) & 63;
+	unsigned char b = packed & 31;
+	color[0] = (r << 3) | (r >> 2);
+	color[1] = (g << 2) | (g >> 4);
+	color[2] = (b << 3) | (b >> 2);
+}
+
+void TextureContainer::compressBlock(const unsigned char *rgba, bool compressAlpha, unsigned char *block) {
+	if(compressAlpha) {
+		unsigned char minAlpha = 255;
+		unsigned char maxAlpha = 0;
+		for(int i=0; i < 16; i++) {
+			if(rgba[i*4+3] < minAlpha) minAlpha = rgba[i*4+3];
+			if(rgba[i*4+3] > maxAlpha) maxAlpha = rgba[i*4+3];
+		}
+		
+		int palette[8];
+		palette[0] = maxAlpha;
+		palette[1] = minAlpha;
+		for(int i=2; i < 8; i++) {
+			palette[i] = ((8-i) * maxAlpha + (i-1) * minAlpha) / 7;
+		}
+		
+		// 16 three bit codes packed into 48 bits
+		unsigned int codes[2] = {0, 0};
+		for(int i=0; i < 16; i++) {
+			int best = 0;
+			if(maxAlpha != minAlpha) {
+				int bestError = 256;
+				for(int p=0; p < 8; p++) {
+					int error = abs(palette[p] - rgba[i*4+3]);
+					if(error < bestError) {
+						bestError = error;
+						best = p;
+					}
+				}
+			}
+			codes[i / 8] |= best << (3 * (i % 8));
+		}
+		
+		block[0] = maxAlpha;
+		block[1] = minAlpha;
+		for(int i=0; i < 3; i++) {
+			block[2+i] = (codes[0] >> (8*i)) & 0xff;
+			block[5+i] = (codes[1] >> (8*i)) & 0xff;
+		}
+		block += 8;
+	}
+	
+	// range fit: endpoints are the corners of the block's color bounding box, inset slightly to reduce error
+	unsigned char minColor[3] = {255, 255, 255};
+	unsigned char maxColor[3] = {0, 0, 0};
+	for(int i=0; i < 16; i++) {
+		for(int c=0; c < 3; c++) {
+			if(rgba[i*4+c] < minColor[c]) minColor[c] = rgba[i*4+c];
+			if(rgba[i*4+c] > maxColor[c]) maxColor[c] = rgba[i*4+c];
+		}
+	}
+	for(int c=0; c < 3; c++) {
+		int inset = (maxColor[c] - minColor[c]) >> 4;
+		minColor[c] += inset;
+		maxColor[c] -= inset;
+	}
+	
+	unsigned short color0 = packColor565(maxColor);
+	unsigned short color1 = packColor565(minColor);
+	if(color0 < color1) {
+		unsigned short temp = color0;
+		color0 = color1;
+		color1 = temp;
+	}
+	
+	unsigned char palette[4][3];
+	unpackColor565(color0, palette[0]);
+	unpackColor565(color1, palette[1]);
+	for(int c=0; c < 3; c++) {
+		palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+		palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+	}
+	
+	unsigned int indices = 0;
+	if(color0 != color1) {
+		for(int i=0; i < 16; i++) {
+			int best = 0;
+			int bestError = 0x7fffffff;
+			for(int p=0; p < 4; p++) {
+				int dr = palette[p][0] - rgba[i*4];
+				int dg = palette[p][1] - rgba[i*4+1];
+				int db = palette[p][2] - rgba[i*4+2];
+				int error = dr*dr + dg*dg + db*db;
+				if(error < bestError) {
+					bestError = error;
+					best = p;
+				}
+			}
+			indices |= best << (2 * i);
+		}
+	}
+	
+	block[0] = color0 & 0xff;
+	block[1] = color0 >> 8;
+	block[2] = color1 & 0xff;
+	block[3] = color1 >> 8;
+	for(int i=0; i < 4; i++) {
+		block[4+i] = (indices >> (8*i)) & 0xff;
+	}
+}
+
+void TextureContainer::decompressBlock(const unsigned char *block, bool hasAlpha, unsigned char *rgba) {
+	if(hasAlpha) {
+		int palette[8];
+		palette[0] = block[0];
+		palette[1] = block[1];
+		if(palette[0] > palette[1]) {
+			for(int i=2; i < 8; i++) {
+				palette[i] = ((8-i) * palette[0] + (i-1) * palette[1]) / 7;
+			}
+		} else {
+			for(int i=2; i < 6; i++) {
+				palette[i] = ((6-i) * palette[0] + (i-1) * palette[1]) / 5;
+			}
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+		unsigned int codes[2];
+		codes[0] = block[2] | (block[3] << 8) | (block[4] << 16);
+		codes[1] = block[5] | (block[6] << 8) | (block[7] << 16);
+		for(int i=0; i < 16; i++) {
+			rgba[i*4+3] = palette[(codes[i / 8] >> (3 * (i % 8))) & 7];
+		}
+		block += 8;
+	}
+	
+	unsigned short color0 = block[0] | (block[1] << 8);
+	unsigned short color1 = block[2] | (block[3] << 8);
+	unsigned char palette[4][4];
+	unpackColor565(color0, palette[0]);
+	unpackColor565(color1, palette[1]);
+	palette[0][3] = 255;
+	palette[1][3] = 255;
+	palette[2][3] = 255;
+	palette[3][3] = 255;
+	
+	// DXT5 color blocks always use four colors, DXT1 switches to three colors and transparent black
+	if(hasAlpha || color0 > color1) {
+		for(int c=0; c < 3; c++) {
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+	} else {
+		for(int c=0; c < 3; c++) {
+			palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+			palette[3][c] = 0;
+		}
+		palette[3][3] = 0;
+	}
+	
+	unsigned int indices = block[4] | (block[5] << 8) | (block[6] << 16) | (block[7] << 24);
+	for(int i=0; i < 16; i++) {
+		int index = (indices >> (2 * i)) & 3;
+		rgba[i*4] = palette[index][0];
+		rgba[i*4+1] = palette[index][1];
+		rgba[i*4+2] = palette[index][2];
+		if(!hasAlpha) {
+			rgba[i*4+3] = palette[index][3];
+		}
+	}
+}
+
+void TextureContainer::addLevel(Image *image) {
+	TextureLevel level;
+	level.width = image->getWidth();
+	level.height = image->getHeight();
+	unsigned char *pixels = (unsigned char*)image->getPixels();
+	
+	switch(format) {
+		case FORMAT_RGBA:
+			level.dataSize = level.width * level.height * 4;
+			level.data = (char*)malloc(level.dataSize);
+			memcpy(level.data, pixels, level.dataSize);
+		break;
+		case FORMAT_RGB:
+			level.dataSize = level.width * level.height * 3;
+			level.data = (char*)malloc(level.dataSize);
+			for(unsigned int i=0; i < level.width * level.height; i++) {
+				memcpy(level.data + i * 3, pixels + i * 4, 3);
+			}
+		break;
+		default:
+		{
+			bool compressAlpha = (format == FORMAT_DXT5);
+			unsigned int blockSize = compressAlpha ? 16 : 8;
+			unsigned int blocksX = (level.width + 3) / 4;
+			unsigned int blocksY = (level.height + 3) / 4;
+			level.dataSize = blocksX * blocksY * blockSize;
+			level.data = (char*)malloc(level.dataSize);
+			
+			unsigned char blockPixels[64];
+			for(unsigned int by=0; by < blocksY; by++) {
+				for(unsigned int bx=0; bx < blocksX; bx++) {
+					// blocks hanging over the edge repeat the last row and column
+					for(int i=0; i < 16; i++) {
+						unsigned int x = bx * 4 + (i % 4);
+						unsigned int y = by * 4 + (i / 4);
+						if(x >= level.width) x = level.width - 1;
+						if(y >= level.height) y = level.height - 1;
+						memcpy(blockPixels + i * 4, pixels + (y * level.width + x) * 4, 4);
+					}
+					compressBlock(blockPixels, compressAlpha, (unsigned char*)level.data + (by * blocksX + bx) * blockSize);
+				}
+			}
+		}
+		break;
+	}
+	levels.push_back(level);
+}
+
+bool TextureContainer::createFromImage(Image *image, int format, bool createMipmaps) {
+	if(image->getType() != Image::IMAGE_RGB && image->getType() != Image::IMAGE_RGBA) {
+		Logger::log("Texture containers can only be created from RGB or RGBA images\n");
+		return false;
+	}
+	
+	clear();
+	this->format = format;
+	width = image->getWidth();
+	height = image->getHeight();
+	
+	// all levels are built from RGBA data and converted when they are stored
+	Image *level = new Image(width, height, Image::IMAGE_RGBA);
+	unsigned char *src = (unsigned char*)image->getPixels();
+	unsigned char *dst = (unsigned char*)level->getPixels();
+	if(image->getType() == Image::IMAGE_RGBA) {
+		memcpy(dst, src, width * height * 4);
+	} else {
+		for(unsigned int i=0; i < width * height; i++) {
+			dst[i*4] = src[i*3];
+			dst[i*4+1] = src[i*3+1];
+			dst[i*4+2] = src[i*3+2];
+			dst[i*4+3] = 255;
+		}
+	}
+	
+	addLevel(level);
+	while(createMipmaps && (level->getWidth() > 1 || level->getHeight() > 1)) {
+		Image *nextLevel = createMipLevel(level);
+		delete level;
+		level = nextLevel;
+		addLevel(level);
+	}
+	delete level;
+	return true;
+}
+
+Image *TextureContainer::decodeLevel(unsigned int index) const {
+	const TextureLevel &level = levels[index];
+	
+	if(format == FORMAT_RGBA) {
+		return new Image(level.data, level.width, level.height, Image::IMAGE_RGBA);
+	}
+	if(format == FORMAT_RGB) {
+		return new Image(level.data, level.width, level.height, Image::IMAGE_RGB);
+	}
+	
+	bool hasAlpha = (format == FORMAT_DXT5);
+	unsigned int blockSize = hasAlpha ? 16 : 8;
+	unsigned int blocksX = (level.width + 3) / 4;
+	unsigned int blocksY = (level.height + 3) / 4;
+	
+	Image *image = new Image(level.width, level.height, Image::IMAGE_RGBA);
+	unsigned char *pixels = (unsigned char*)image->getPixels();
+	unsigned char blockPixels[64];
+	for(unsigned int by=0; by < blocksY; by++) {
+		for(unsigned int bx=0; bx < blocksX; bx++) {
+			decompressBlock((unsigned char*)level.data + (by * blocksX + bx) * blockSize, hasAlpha, blockPixels);
+			for(int i=0; i < 16; i++) {
+				unsigned int x = bx * 4 + (i % 4);
+				unsigned int y = by * 4 + (i / 4);
+				if(x < level.width && y < level.height) {
+					memcpy(pixels + (y * level.width + x) * 4, blockPixels + i * 4, 4);
+				}
+			}
+		}
+	}
+	return image;
+}
+
+bool TextureContainer::loadFromFile(const String& fileName) {
+	OSFILE *file = OSBasics::open(fileName, "rb");
+	if(!file) {
+		Logger::log("Error opening texture container %s\n", fileName.c_str());
+		return false;
+	}
+	
+	clear();
+	
+	char magic[4];
+	unsigned int header[5];
+	if(OSBasics::read(magic, 4, 1, file) != 1 || memcmp(magic, TEXTURE_CONTAINER_MAGIC, 4) != 0 || OSBasics::read(header, sizeof(unsigned int), 5, file) != 5 || header[0] != TEXTURE_CONTAINER_VERSION) {
+		Logger::log("%s is not a valid texture container\n", fileName.c_str());
+		OSBasics::close(file);
+		return false;
+	}
+	
+	unsigned int maxLevels = 1;
+	bool validSize = header[2] > 0 && header[3] > 0 && header[2] <= MAX_SIZE && header[3] <= MAX_SIZE;
+	while(validSize && ((header[2] >> maxLevels) > 0 || (header[3] >> maxLevels) > 0))
+		maxLevels++;
+	
+	if(getLevelDataSize(header[1], 1, 1) == 0 || !validSize || header[4] == 0 || header[4] > maxLevels) {
+		Logger::log("Texture container %s has an invalid header\n", fileName.c_str());
+		OSBasics::close(file);
+		return false;
+	}
+	
+	format = header[1];
+	width = header[2];
+	height = header[3];
+	unsigned int numLevels = header[4];
+	
+	bool valid = true;
+	for(unsigned int i=0; i < numLevels; i++) {
+		unsigned int levelHeader[3];
+		if(OSBasics::read(levelHeader, sizeof(unsigned int), 3, file) != 3) {
+			valid = false;
+			break;
+		}
+		
+		// every level has to be exactly the next step of the mip chain
+		unsigned int levelWidth = (width >> i) > 0 ? (width >> i) : 1;
+		unsigned int levelHeight = (height >> i) > 0 ? (height >> i) : 1;
+		if(levelHeader[0] != levelWidth || levelHeader[1] != levelHeight || levelHeader[2] != getLevelDataSize(format, levelWidth, levelHeight)) {
+			valid = false;
+			break;
+		}
+		
+		TextureLevel level;
+		level.width = levelHeader[0];
+		level.height = levelHeader[1];
+		level.dataSize = levelHeader[2];
+		level.data = (char*)malloc(level.dataSize);
+		if(OSBasics::read(level.data, 1, level.dataSize, file) != level.dataSize) {
+			free(level.data);
+			valid = false;
+			break;
+		}
+		levels.push_back(level);
+	}
+	OSBasics::close(file);
+	
+	if(!valid) {
+		Logger::log("Texture container %s is truncated or malformed\n", fileName.c_str());
+		clear();
+		return false;
+	}
+	this->fileName = fileName;
+	return true;
+}
+
+bool TextureContainer::saveToFile(const String& fileName) {
+	OSFILE *file = OSBasics::open(fileName, "wb");
+	if(!file) {
+		Logger::log("Error opening %s for writing\n", fileName.c_str());
+		return false;
+	}
+	
+	unsigned int header[5];
+	header[0] = TEXTURE_CONTAINER_VERSION;
+	header[1] = format;
+	header[2] = width;
+	header[3] = height;
+	header[4] = levels.size();
+	OSBasics::write(TEXTURE_CONTAINER_MAGIC, 4, 1, file);
+	OSBasics::write(header, sizeof(unsigned int), 5, file);
+	
+	for(int i=0; i < levels.size(); i++) {
+		unsigned int levelHeader[3];
+		levelHeader[0] = levels[i].width;
+		levelHeader[1] = levels[i].height;
+		levelHeader[2] = levels[i].dataSize;
+		OSBasics::write(levelHeader, sizeof(unsigned int), 3, file);
+		OSBasics::write(levels[i].data, levels[i].dataSize, 1, file);
+	}
+	OSBasics::close(file);
+	return true;
+}
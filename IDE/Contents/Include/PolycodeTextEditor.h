@@ -28,6 +28,28 @@
 
 using namespace Polycode;
 
+class PolycodeLuaColorizer : public UITextColorizer {
+public:
+	PolycodeLuaColorizer();
+	virtual ~PolycodeLuaColorizer();
+	
+	int colorLine(const String &line, int startState, std::vector<Color> *colors);
+	
+	static const int STATE_CODE = 0;
+	static const int STATE_BLOCK_COMMENT = 1;
+	static const int STATE_LONG_STRING = 2;
+	
+protected:
+	
+	bool isKeyword(const std::string &word);
+	
+	Color codeColor;
+	Color commentColor;
+	Color stringColor;
+	Color keywordColor;
+	Color numberColor;
+};
+
 class PolycodeTextEditor : public PolycodeEditor {
 public:
 	PolycodeTextEditor();
@@ -40,6 +62,7 @@ public:
 protected:
 
 	UITextInput *textInput;
+	UITextColorizer *colorizer;
 };
 
 class PolycodeTextEditorFactory : public PolycodeEditorFactory {
@@ -22,11 +22,105 @@
 
 #include "PolycodeTextEditor.h"
 
+static const char *luaKeywords[] = {"and", "break", "do", "else", "elseif", "end", "false", "for", "function", "if", "in", "local", "nil", "not", "or", "repeat", "return", "then", "true", "until", "while", NULL};
+
+static bool isIdentifierCharacter(char c) {
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+PolycodeLuaColorizer::PolycodeLuaColorizer() : UITextColorizer() {
+	codeColor.setColor(0.0f, 0.0f, 0.0f, 1.0f);
+	commentColor.setColor(0.0f, 0.5f, 0.0f, 1.0f);
+	stringColor.setColor(0.7f, 0.1f, 0.1f, 1.0f);
+	keywordColor.setColor(0.1f, 0.2f, 0.8f, 1.0f);
+	numberColor.setColor(0.5f, 0.2f, 0.6f, 1.0f);
+}
+
+PolycodeLuaColorizer::~PolycodeLuaColorizer() {
+
+}
+
+bool PolycodeLuaColorizer::isKeyword(const std::string &word) {
+	for(int i=0; luaKeywords[i]; i++) {
+		if(word == luaKeywords[i])
+			return true;
+	}
+	return false;
+}
+
+int PolycodeLuaColorizer::colorLine(const String &line, int startState, std::vector<Color> *colors) {
+	const std::string &text = line.contents;
+	int length = text.length();
+	int state = startState;
+	
+	if(colors)
+		colors->assign(length, codeColor);
+	
+	int i = 0;
+	while(i < length) {
+		int start = i;
+		Color color = codeColor;
+		
+		if(state == STATE_BLOCK_COMMENT || state == STATE_LONG_STRING) {
+			color = (state == STATE_BLOCK_COMMENT) ? commentColor : stringColor;
+			size_t end = text.find("]]", i);
+			if(end == std::string::npos) {
+				i = length;
+			} else {
+				i = end + 2;
+				state = STATE_CODE;
+			}
+		} else if(text.compare(i, 4, "--[[") == 0) {
+			state = STATE_BLOCK_COMMENT;
+			color = commentColor;
+			i += 4;
+		} else if(text.compare(i, 2, "--") == 0) {
+			color = commentColor;
+			i = length;
+		} else if(text.compare(i, 2, "[[") == 0) {
+			state = STATE_LONG_STRING;
+			color = stringColor;
+			i += 2;
+		} else if(text[i] == '"' || text[i] == '\'') {
+			char quote = text[i];
+			color = stringColor;
+			i++;
+			while(i < length && text[i] != quote) {
+				if(text[i] == '\\')
+					i++;
+				i++;
+			}
+			i++;
+		} else if(text[i] >= '0' && text[i] <= '9') {
+			color = numberColor;
+			while(i < length && (isIdentifierCharacter(text[i]) || text[i] == '.'))
+				i++;
+		} else if(isIdentifierCharacter(text[i])) {
+			while(i < length && isIdentifierCharacter(text[i]))
+				i++;
+			if(isKeyword(text.substr(start, i-start)))
+				color = keywordColor;
+		} else {
+			i++;
+		}
+		
+		if(i > length)
+			i = length;
+		if(colors) {
+			for(int j=start; j < i; j++)
+				(*colors)[j] = color;
+		}
+	}
+	return state;
+}
+
 PolycodeTextEditor::PolycodeTextEditor() : PolycodeEditor(true){
+	textInput = NULL;
+	colorizer = NULL;
 }
 
 PolycodeTextEditor::~PolycodeTextEditor() {
-	
+	delete colorizer;
 }
 
 bool PolycodeTextEditor::openFile(String filePath) {
@@ -34,9 +128,14 @@ bool PolycodeTextEditor::openFile(String filePath) {
 	textInput = new UITextInput(true, 100, 100);
 	addChild(textInput);	
 	
+	if(filePath.length() > 4 && filePath.substr(filePath.length()-4, 4).toLowerCase() == ".lua") {
+		colorizer = new PolycodeLuaColorizer();
+		textInput->setColorizer(colorizer);
+	}
+	
 	Data *data = new Data();
 	data->loadFromFile(filePath);	
-	textInput->insertText(data->getAsString(String::ENCODING_UTF8));
+	textInput->setText(data->getAsString(String::ENCODING_UTF8));
 	delete data;
 	
 	PolycodeEditor::openFile(filePath);
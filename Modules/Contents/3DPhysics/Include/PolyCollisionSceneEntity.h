@@ -106,6 +106,11 @@ namespace Polycode {
 		* Cylinder shape
 		*/												
 		static const int SHAPE_CYLINDER = 8;
+
+		/**
+		* Concave triangle mesh shape. Only usable for static geometry.
+		*/
+		static const int SHAPE_TRIANGLE_MESH = 9;
 						
 			bool enabled;
 			btCollisionShape *shape;
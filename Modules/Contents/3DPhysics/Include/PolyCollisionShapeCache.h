@@ -0,0 +1,149 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#pragma once
+#include "PolyGlobals.h"
+#include "PolyString.h"
+#include "PolyVector3.h"
+#include <map>
+#include <vector>
+
+class btCollisionShape;
+class btTriangleMesh;
+
+namespace Polycode {
+
+	class SceneEntity;
+	class Mesh;
+
+	/**
+	* Key identifying a shared collision shape. Two entities with the same shape type, mesh, bounding box and scale share one shape.
+	*/
+	class _PolyExport CollisionShapeKey {
+		public:
+			CollisionShapeKey();
+
+			bool operator<(const CollisionShapeKey &other) const;
+
+			int type;
+			Mesh *mesh;
+			Vector3 bBox;
+			Vector3 scale;
+	};
+
+	/**
+	* A cached shape and the data it needs to stay alive.
+	*/
+	class _PolyExport CollisionShapeEntry {
+		public:
+			CollisionShapeEntry();
+
+			btCollisionShape *shape;
+			btTriangleMesh *triangleMesh;
+			void *bvhBuffer;
+			unsigned int refCount;
+	};
+
+	/**
+	* Header written in front of a cached BVH. The counts and bounds describe the triangle mesh the BVH was built for and are checked against the mesh before the cached BVH is used.
+	*/
+	class _PolyExport BVHCacheHeader {
+		public:
+			BVHCacheHeader();
+
+			bool matches(const BVHCacheHeader &other) const;
+
+			unsigned int magic;
+			unsigned int version;
+			unsigned int bulletVersion;
+			unsigned int bufferSize;
+			unsigned int triangleCount;
+			unsigned int vertexCount;
+			float aabbMin[3];
+			float aabbMax[3];
+	};
+
+	/**
+	* Shares Bullet collision shapes between collision entities. Shapes are reference counted and keyed by shape type, mesh and scale, so hundreds of entities using the same mesh only build one shape. Convex hulls are built from deduplicated (and optionally decimated) mesh points and static triangle mesh shapes can load their BVH from a cache directory on disk instead of rebuilding it.
+	*/
+	class _PolyExport CollisionShapeCache {
+		public:
+			CollisionShapeCache();
+			virtual ~CollisionShapeCache();
+
+			/**
+			* Returns the shared shape cache used by collision entities.
+			*/
+			static CollisionShapeCache *getInstance();
+
+			/**
+			* Returns a shape for the entity, building it if no matching shape is cached. Every call must be balanced by a call to releaseShape().
+			* @param entity Entity to build the shape for.
+			* @param type Shape type. See CollisionSceneEntity for the possible types.
+			*/
+			btCollisionShape *acquireShape(SceneEntity *entity, int type);
+
+			/**
+			* Releases a shape returned by acquireShape(). The shape is deleted when its last user releases it.
+			*/
+			void releaseShape(btCollisionShape *shape);
+
+			/**
+			* Sets the distance under which two mesh points are considered the same point when building convex hulls. Defaults to 0.0001.
+			*/
+			void setHullWeldTolerance(Number tolerance);
+
+			/**
+			* If set to a non-zero value, convex hulls with more points than this are simplified before being cached. Defaults to 0 (no simplification).
+			*/
+			void setMaxHullPoints(unsigned int maxPoints);
+
+			/**
+			* Sets the folder that triangle mesh BVHs are saved to and loaded from. If empty (the default), BVHs are always built at load time.
+			*/
+			void setBVHCacheDirectory(const String &path);
+
+			/**
+			* Returns the number of distinct shapes currently cached.
+			*/
+			unsigned int getNumCachedShapes() const;
+
+		protected:
+
+			CollisionShapeKey createKey(SceneEntity *entity, int type) const;
+			void createShape(SceneEntity *entity, const CollisionShapeKey &key, CollisionShapeEntry *entry);
+			btCollisionShape *createHullShape(Mesh *mesh);
+			btCollisionShape *createTriangleMeshShape(Mesh *mesh, const Vector3 &scale, CollisionShapeEntry *entry);
+
+			void *loadBVH(const String &fileName, const BVHCacheHeader &expectedHeader, unsigned int *size);
+			void saveBVH(const String &fileName, const BVHCacheHeader &header, void *buffer);
+
+			Number hullWeldTolerance;
+			unsigned int maxHullPoints;
+			String bvhCacheDirectory;
+
+			std::map<CollisionShapeKey, CollisionShapeEntry> shapes;
+			std::map<btCollisionShape*, CollisionShapeKey> shapeKeys;
+
+			static CollisionShapeCache *instance;
+	};
+}
@@ -27,5 +27,6 @@ THE SOFTWARE.
 
 #include "PolyCollisionScene.h"
 #include "PolyCollisionSceneEntity.h"
+#include "PolyCollisionShapeCache.h"
 #include "PolyPhysicsScene.h"
 #include "PolyPhysicsSceneEntity.h"
\ No newline at end of file
@@ -214,9 +214,9 @@ void CollisionScene::removeCollision(SceneEntity *entity) {
 				std::vector<CollisionSceneEntity*>::iterator target = collisionChildren.begin()+i;
 				delete *target;
 				collisionChildren.erase(target);
+				break;
 			}
 		}			
-		delete cEnt;
 	}
 
 }
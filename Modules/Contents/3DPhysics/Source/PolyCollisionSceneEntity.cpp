@@ -21,11 +21,8 @@ THE SOFTWARE.
 */
 
 #include "PolyCollisionSceneEntity.h"
-#include "PolyLogger.h"
-#include "PolyMesh.h"
-#include "PolyPolygon.h"
+#include "PolyCollisionShapeCache.h"
 #include "PolySceneEntity.h"
-#include "PolySceneMesh.h"
 #include "btBulletCollisionCommon.h"
 
 using namespace Polycode;
@@ -51,73 +48,12 @@ CollisionSceneEntity::CollisionSceneEntity(SceneEntity *entity, int type) {
 		collisionObject->setCollisionShape(shape);
 	}	
 	
-//	if(type == SHAPE_MESH) {		
-//		concaveShape = dynamic_cast<btConcaveShape*>(shape);
-//	} else {
-		convexShape	= dynamic_cast<btConvexShape*>(shape);		
-//	}		
+	concaveShape = dynamic_cast<btConcaveShape*>(shape);
+	convexShape	= dynamic_cast<btConvexShape*>(shape);
 }
 
 btCollisionShape *CollisionSceneEntity::createCollisionShape(SceneEntity *entity, int type) {
-	
-	btCollisionShape *collisionShape = NULL;	
-	
-	Vector3 entityScale = entity->getScale();
-	Number largestScale = entityScale.x;
-	if(entityScale.y > largestScale)
-		largestScale = entityScale.y;
-	if(entityScale.z > largestScale)
-		largestScale = entityScale.z;
-
-	
-	switch(type) {
-		case SHAPE_CAPSULE:
-		case CHARACTER_CONTROLLER:
-			collisionShape = new btCapsuleShape(entity->bBox.x/2.0f, entity->bBox.y/2.0f);			
-		break;
-		case SHAPE_CONE: {
-			Number largest = entity->bBox.x;
-			if(entity->bBox.z > largest) {
-				largest = entity->bBox.z;
-			}
-			collisionShape = new btConeShape(largest/2.0f, entity->bBox.y);					
-			}
-		break;
-		case SHAPE_CYLINDER:
-		{
-			collisionShape = new btCylinderShape(btVector3(entity->bBox.x/2.0, entity->bBox.y/2.0f,entity->bBox.z/2.0));
-		}
-		break;
-		case SHAPE_PLANE:
-			collisionShape = new btBoxShape(btVector3(entity->bBox.x/2.0f, 0.05,entity->bBox.z/2.0f));			
-			break;
-		case SHAPE_BOX:
-			collisionShape = new btBoxShape(btVector3(entity->bBox.x/2.0f*entityScale.x, entity->bBox.y/2.0f*entityScale.y,entity->bBox.z/2.0f*entityScale.z));			
-			break;
-		case SHAPE_SPHERE:
-			collisionShape = new btSphereShape(entity->bBox.x/2.0f*largestScale);
-			break;
-		case SHAPE_MESH:
-		{
-			SceneMesh* sceneMesh = dynamic_cast<SceneMesh*>(entity);
-			if(sceneMesh != NULL) {
-				btConvexHullShape *hullShape = new btConvexHullShape();
-				for(int i=0; i < sceneMesh->getMesh()->getPolygonCount(); i++) {
-					Polygon *poly = sceneMesh->getMesh()->getPolygon(i);
-					for(int j=0; j < poly->getVertexCount(); j++) {					
-						hullShape->addPoint(btVector3((btScalar)poly->getVertex(j)->x, (btScalar)poly->getVertex(j)->y,(btScalar)poly->getVertex(j)->z));
-					}
-				}				
-				collisionShape = hullShape;
-				
-			} else {
-				Logger::log("Tried to make a mesh collision object from a non-mesh\n");
-				collisionShape = new btBoxShape(btVector3(entity->bBox.x/2.0f, entity->bBox.y/2.0f,entity->bBox.z/2.0f));			
-			}
-		}
-		break;
-	}	
-	return collisionShape; 
+	return CollisionShapeCache::getInstance()->acquireShape(entity, type);
 }
 
 void CollisionSceneEntity::Update() {	
@@ -138,6 +74,7 @@ SceneEntity *CollisionSceneEntity::getSceneEntity() {
 }
 
 CollisionSceneEntity::~CollisionSceneEntity() {
-	delete shape; // Do not delete convexShape or concaveShape; these are aliases for shape
+	// Shapes are shared between entities. Do not delete convexShape or concaveShape; these are aliases for shape
+	CollisionShapeCache::getInstance()->releaseShape(shape);
 	delete collisionObject;
 }
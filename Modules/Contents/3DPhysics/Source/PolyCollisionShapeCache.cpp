@@ -0,0 +1,412 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "PolyCollisionShapeCache.h"
+#include "PolyCollisionSceneEntity.h"
+#include "PolyLogger.h"
+#include "PolyMesh.h"
+#include "PolyPolygon.h"
+#include "PolySceneEntity.h"
+#include "PolySceneMesh.h"
+#include "OSBasics.h"
+#include "btBulletCollisionCommon.h"
+#include "BulletCollision/CollisionShapes/btShapeHull.h"
+#include <set>
+
+using namespace Polycode;
+
+#define BVH_CACHE_MAGIC 0x48564250
+#define BVH_CACHE_VERSION 2
+
+CollisionShapeCache *CollisionShapeCache::instance = NULL;
+
+CollisionShapeKey::CollisionShapeKey() : type(0), mesh(NULL) {
+}
+
+static int compareVectors(const Vector3 &a, const Vector3 &b) {
+	if(a.x != b.x) return a.x < b.x ? -1 : 1;
+	if(a.y != b.y) return a.y < b.y ? -1 : 1;
+	if(a.z != b.z) return a.z < b.z ? -1 : 1;
+	return 0;
+}
+
+BVHCacheHeader::BVHCacheHeader() : magic(BVH_CACHE_MAGIC), version(BVH_CACHE_VERSION), bulletVersion(BT_BULLET_VERSION), bufferSize(0), triangleCount(0), vertexCount(0) {
+	for(int i=0; i < 3; i++) {
+		aabbMin[i] = 0;
+		aabbMax[i] = 0;
+	}
+}
+
+bool BVHCacheHeader::matches(const BVHCacheHeader &other) const {
+	if(magic != other.magic || version != other.version || bulletVersion != other.bulletVersion)
+		return false;
+	if(triangleCount != other.triangleCount || vertexCount != other.vertexCount)
+		return false;
+	for(int i=0; i < 3; i++) {
+		if(aabbMin[i] != other.aabbMin[i] || aabbMax[i] != other.aabbMax[i])
+			return false;
+	}
+	return true;
+}
+
+bool CollisionShapeKey::operator<(const CollisionShapeKey &other) const {
+	if(type != other.type)
+		return type < other.type;
+	if(mesh != other.mesh)
+		return mesh < other.mesh;
+	int bBoxCompare = compareVectors(bBox, other.bBox);
+	if(bBoxCompare != 0)
+		return bBoxCompare < 0;
+	return compareVectors(scale, other.scale) < 0;
+}
+
+CollisionShapeEntry::CollisionShapeEntry() : shape(NULL), triangleMesh(NULL), bvhBuffer(NULL), refCount(0) {
+}
+
+CollisionShapeCache::CollisionShapeCache() {
+	hullWeldTolerance = 0.0001;
+	maxHullPoints = 0;
+}
+
+CollisionShapeCache *CollisionShapeCache::getInstance() {
+	if(!instance) {
+		instance = new CollisionShapeCache();
+	}
+	return instance;
+}
+
+void CollisionShapeCache::setHullWeldTolerance(Number tolerance) {
+	hullWeldTolerance = tolerance;
+}
+
+void CollisionShapeCache::setMaxHullPoints(unsigned int maxPoints) {
+	maxHullPoints = maxPoints;
+}
+
+void CollisionShapeCache::setBVHCacheDirectory(const String &path) {
+	bvhCacheDirectory = path;
+}
+
+unsigned int CollisionShapeCache::getNumCachedShapes() const {
+	return shapes.size();
+}
+
+CollisionShapeKey CollisionShapeCache::createKey(SceneEntity *entity, int type) const {
+	CollisionShapeKey key;
+	key.type = type;
+	key.scale = Vector3(1.0, 1.0, 1.0);
+
+	switch(type) {
+		case CollisionSceneEntity::SHAPE_MESH:
+		case CollisionSceneEntity::SHAPE_TRIANGLE_MESH:
+		{
+			SceneMesh *sceneMesh = dynamic_cast<SceneMesh*>(entity);
+			if(sceneMesh) {
+				key.mesh = sceneMesh->getMesh();
+				// hulls are built in mesh space, triangle meshes are baked at the entity scale
+				if(type == CollisionSceneEntity::SHAPE_TRIANGLE_MESH) {
+					key.scale = entity->getScale();
+				}
+			} else {
+				key.bBox = entity->bBox;
+			}
+		}
+		break;
+		case CollisionSceneEntity::SHAPE_BOX:
+		case CollisionSceneEntity::SHAPE_SPHERE:
+			key.bBox = entity->bBox;
+			key.scale = entity->getScale();
+		break;
+		default:
+			key.bBox = entity->bBox;
+		break;
+	}
+	return key;
+}
+
+btCollisionShape *CollisionShapeCache::acquireShape(SceneEntity *entity, int type) {
+	CollisionShapeKey key = createKey(entity, type);
+
+	std::map<CollisionShapeKey, CollisionShapeEntry>::iterator it = shapes.find(key);
+	if(it != shapes.end()) {
+		it->second.refCount++;
+		return it->second.shape;
+	}
+
+	CollisionShapeEntry entry;
+	createShape(entity, key, &entry);
+	if(!entry.shape) {
+		return NULL;
+	}
+	entry.refCount = 1;
+	shapes[key] = entry;
+	shapeKeys[entry.shape] = key;
+	return entry.shape;
+}
+
+void CollisionShapeCache::releaseShape(btCollisionShape *shape) {
+	if(!shape)
+		return;
+
+	std::map<btCollisionShape*, CollisionShapeKey>::iterator keyIt = shapeKeys.find(shape);
+	if(keyIt == shapeKeys.end()) {
+		Logger::log("Tried to release a collision shape that is not in the shape cache\n");
+		return;
+	}
+
+	std::map<CollisionShapeKey, CollisionShapeEntry>::iterator it = shapes.find(keyIt->second);
+	CollisionShapeEntry &entry = it->second;
+	entry.refCount--;
+	if(entry.refCount > 0)
+		return;
+
+	// the shape has to go before the mesh data and BVH buffer it references
+	delete entry.shape;
+	delete entry.triangleMesh;
+	if(entry.bvhBuffer) {
+		btAlignedFree(entry.bvhBuffer);
+	}
+	shapes.erase(it);
+	shapeKeys.erase(keyIt);
+}
+
+void CollisionShapeCache::createShape(SceneEntity *entity, const CollisionShapeKey &key, CollisionShapeEntry *entry) {
+
+	Vector3 entityScale = key.scale;
+	Number largestScale = entityScale.x;
+	if(entityScale.y > largestScale)
+		largestScale = entityScale.y;
+	if(entityScale.z > largestScale)
+		largestScale = entityScale.z;
+
+	switch(key.type) {
+		case CollisionSceneEntity::SHAPE_CAPSULE:
+		case CollisionSceneEntity::CHARACTER_CONTROLLER:
+			entry->shape = new btCapsuleShape(entity->bBox.x/2.0f, entity->bBox.y/2.0f);
+		break;
+		case CollisionSceneEntity::SHAPE_CONE: {
+			Number largest = entity->bBox.x;
+			if(entity->bBox.z > largest) {
+				largest = entity->bBox.z;
+			}
+			entry->shape = new btConeShape(largest/2.0f, entity->bBox.y);
+			}
+		break;
+		case CollisionSceneEntity::SHAPE_CYLINDER:
+			entry->shape = new btCylinderShape(btVector3(entity->bBox.x/2.0, entity->bBox.y/2.0f,entity->bBox.z/2.0));
+		break;
+		case CollisionSceneEntity::SHAPE_PLANE:
+			entry->shape = new btBoxShape(btVector3(entity->bBox.x/2.0f, 0.05,entity->bBox.z/2.0f));
+		break;
+		case CollisionSceneEntity::SHAPE_BOX:
+			entry->shape = new btBoxShape(btVector3(entity->bBox.x/2.0f*entityScale.x, entity->bBox.y/2.0f*entityScale.y,entity->bBox.z/2.0f*entityScale.z));
+		break;
+		case CollisionSceneEntity::SHAPE_SPHERE:
+			entry->shape = new btSphereShape(entity->bBox.x/2.0f*largestScale);
+		break;
+		case CollisionSceneEntity::SHAPE_MESH:
+		case CollisionSceneEntity::SHAPE_TRIANGLE_MESH:
+			if(key.mesh) {
+				if(key.type == CollisionSceneEntity::SHAPE_MESH) {
+					entry->shape = createHullShape(key.mesh);
+				} else {
+					entry->shape = createTriangleMeshShape(key.mesh, key.scale, entry);
+				}
+			} else {
+				Logger::log("Tried to make a mesh collision object from a non-mesh\n");
+				entry->shape = new btBoxShape(btVector3(entity->bBox.x/2.0f, entity->bBox.y/2.0f,entity->bBox.z/2.0f));
+			}
+		break;
+	}
+}
+
+btCollisionShape *CollisionShapeCache::createHullShape(Mesh *mesh) {
+	btConvexHullShape *hullShape = new btConvexHullShape();
+
+	// weld points that fall into the same tolerance cell so shared vertices are only added once
+	std::set<std::vector<long long> > addedPoints;
+	std::vector<long long> cell(3);
+	for(int i=0; i < mesh->getPolygonCount(); i++) {
+		Polygon *poly = mesh->getPolygon(i);
+		for(int j=0; j < poly->getVertexCount(); j++) {
+			Vertex *vertex = poly->getVertex(j);
+			if(hullWeldTolerance > 0.0) {
+				cell[0] = (long long)floor(vertex->x / hullWeldTolerance);
+				cell[1] = (long long)floor(vertex->y / hullWeldTolerance);
+				cell[2] = (long long)floor(vertex->z / hullWeldTolerance);
+				if(!addedPoints.insert(cell).second)
+					continue;
+			}
+			hullShape->addPoint(btVector3((btScalar)vertex->x, (btScalar)vertex->y, (btScalar)vertex->z));
+		}
+	}
+
+	if(maxHullPoints == 0 || hullShape->getNumPoints() <= maxHullPoints)
+		return hullShape;
+
+	// btShapeHull keeps only the points that define the hull along a fixed set of directions
+	btShapeHull *shapeHull = new btShapeHull(hullShape);
+	if(!shapeHull->buildHull(hullShape->getMargin())) {
+		delete shapeHull;
+		return hullShape;
+	}
+
+	btConvexHullShape *simplifiedShape = new btConvexHullShape();
+	for(int i=0; i < shapeHull->numVertices(); i++) {
+		simplifiedShape->addPoint(shapeHull->getVertexPointer()[i]);
+	}
+	delete shapeHull;
+	delete hullShape;
+	return simplifiedShape;
+}
+
+btCollisionShape *CollisionShapeCache::createTriangleMeshShape(Mesh *mesh, const Vector3 &scale, CollisionShapeEntry *entry) {
+	btTriangleMesh *triangleMesh = new btTriangleMesh();
+
+	// FNV-1a over the baked triangles, used to name the BVH cache file
+	unsigned int hash = 2166136261U;
+	unsigned int numTriangles = 0;
+
+	for(int i=0; i < mesh->getPolygonCount(); i++) {
+		Polygon *poly = mesh->getPolygon(i);
+		if(poly->getVertexCount() < 3)
+			continue;
+
+		btVector3 points[3];
+		Vertex *first = poly->getVertex(0);
+		points[0] = btVector3(first->x * scale.x, first->y * scale.y, first->z * scale.z);
+		for(int j=1; j < poly->getVertexCount()-1; j++) {
+			Vertex *v1 = poly->getVertex(j);
+			Vertex *v2 = poly->getVertex(j+1);
+			points[1] = btVector3(v1->x * scale.x, v1->y * scale.y, v1->z * scale.z);
+			points[2] = btVector3(v2->x * scale.x, v2->y * scale.y, v2->z * scale.z);
+			triangleMesh->addTriangle(points[0], points[1], points[2]);
+			numTriangles++;
+
+			for(int k=0; k < 3; k++) {
+				float coords[3] = {(float)points[k].x(), (float)points[k].y(), (float)points[k].z()};
+				const unsigned char *bytes = (const unsigned char*)coords;
+				for(int b=0; b < sizeof(coords); b++) {
+					hash ^= bytes[b];
+					hash *= 16777619U;
+				}
+			}
+		}
+	}
+
+	entry->triangleMesh = triangleMesh;
+
+	String bvhFileName;
+	BVHCacheHeader bvhHeader;
+	if(bvhCacheDirectory != "") {
+		char hashString[16];
+		sprintf(hashString, "%08x", hash);
+		bvhFileName = bvhCacheDirectory + "/" + String(hashString) + ".bvh";
+
+		// the shape computes the mesh bounds the BVH is quantized against, so a cached BVH is only valid for the same bounds
+		btBvhTriangleMeshShape *shape = new btBvhTriangleMeshShape(triangleMesh, true, false);
+		bvhHeader.triangleCount = numTriangles;
+		bvhHeader.vertexCount = numTriangles * 3;
+		for(int i=0; i < 3; i++) {
+			bvhHeader.aabbMin[i] = (float)shape->getLocalAabbMin()[i];
+			bvhHeader.aabbMax[i] = (float)shape->getLocalAabbMax()[i];
+		}
+
+		unsigned int bvhSize = 0;
+		void *bvhBuffer = loadBVH(bvhFileName, bvhHeader, &bvhSize);
+		if(bvhBuffer) {
+			btOptimizedBvh *bvh = (btOptimizedBvh*) btOptimizedBvh::deSerializeInPlace(bvhBuffer, bvhSize, false);
+			// a quantized tree over n triangles always has 2n-1 nodes
+			if(bvh && bvh->isQuantized() && numTriangles > 0 && bvh->getQuantizedNodeArray().size() == (int)(numTriangles * 2 - 1)) {
+				shape->setOptimizedBvh(bvh);
+				entry->bvhBuffer = bvhBuffer;
+				return shape;
+			}
+			Logger::log("Rebuilding mismatched BVH cache file %s\n", bvhFileName.c_str());
+			btAlignedFree(bvhBuffer);
+		}
+		delete shape;
+	}
+
+	btBvhTriangleMeshShape *shape = new btBvhTriangleMeshShape(triangleMesh, true, true);
+
+	if(bvhFileName != "") {
+		btOptimizedBvh *bvh = shape->getOptimizedBvh();
+		unsigned int bvhSize = bvh->calculateSerializeBufferSize();
+		void *bvhBuffer = btAlignedAlloc(bvhSize, 16);
+		if(bvh->serialize(bvhBuffer, bvhSize, false)) {
+			bvhHeader.bufferSize = bvhSize;
+			saveBVH(bvhFileName, bvhHeader, bvhBuffer);
+		}
+		btAlignedFree(bvhBuffer);
+	}
+
+	return shape;
+}
+
+void *CollisionShapeCache::loadBVH(const String &fileName, const BVHCacheHeader &expectedHeader, unsigned int *size) {
+	OSFILE *inFile = OSBasics::open(fileName, "rb");
+	if(!inFile)
+		return NULL;
+
+	BVHCacheHeader header;
+	if(OSBasics::read(&header, sizeof(BVHCacheHeader), 1, inFile) != 1 || !header.matches(expectedHeader) || header.bufferSize == 0) {
+		Logger::log("Ignoring stale BVH cache file %s\n", fileName.c_str());
+		OSBasics::close(inFile);
+		return NULL;
+	}
+
+	// the BVH is deserialized in place, so the buffer has to be aligned and outlive the shape
+	void *buffer = btAlignedAlloc(header.bufferSize, 16);
+	if(OSBasics::read(buffer, 1, header.bufferSize, inFile) != header.bufferSize) {
+		Logger::log("Ignoring truncated BVH cache file %s\n", fileName.c_str());
+		btAlignedFree(buffer);
+		OSBasics::close(inFile);
+		return NULL;
+	}
+
+	OSBasics::close(inFile);
+	*size = header.bufferSize;
+	return buffer;
+}
+
+void CollisionShapeCache::saveBVH(const String &fileName, const BVHCacheHeader &header, void *buffer) {
+	OSFILE *outFile = OSBasics::open(fileName, "wb");
+	if(!outFile) {
+		Logger::log("Could not write BVH cache file %s\n", fileName.c_str());
+		return;
+	}
+
+	OSBasics::write(&header, sizeof(BVHCacheHeader), 1, outFile);
+	OSBasics::write(buffer, 1, header.bufferSize, outFile);
+	OSBasics::close(outFile);
+}
+
+CollisionShapeCache::~CollisionShapeCache() {
+	for(std::map<CollisionShapeKey, CollisionShapeEntry>::iterator it = shapes.begin(); it != shapes.end(); it++) {
+		delete it->second.shape;
+		delete it->second.triangleMesh;
+		if(it->second.bvhBuffer) {
+			btAlignedFree(it->second.bvhBuffer);
+		}
+	}
+}
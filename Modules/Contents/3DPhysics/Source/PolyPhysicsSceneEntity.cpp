@@ -23,6 +23,7 @@ THE SOFTWARE.
 #include "PolyPhysicsSceneEntity.h"
 #include "BulletDynamics/Character/btKinematicCharacterController.h"
 #include "BulletCollision/CollisionDispatch/btGhostObject.h"
+#include "PolyLogger.h"
 #include "PolyMatrix4.h"
 #include "PolySceneEntity.h"
 
@@ -201,6 +202,12 @@ PhysicsSceneEntity::PhysicsSceneEntity(SceneEntity *entity, int type, Number mas
 	}	
 	transform.setFromOpenGLMatrix(mat);	
 	
+	if(type == SHAPE_TRIANGLE_MESH && mass != 0.0f) {
+		Logger::log("Triangle mesh shapes can only be used for static bodies, ignoring mass\n");
+		mass = 0.0f;
+		this->mass = mass;
+	}
+	
 	if(mass != 0.0f) {
 		shape->calculateLocalInertia(mass,localInertia);
 	}	
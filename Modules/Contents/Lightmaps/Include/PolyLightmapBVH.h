@@ -0,0 +1,143 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+ 
+
+#pragma once
+#include "PolyGlobals.h"
+#include "PolyVector3.h"
+#include <vector>
+
+namespace Polycode {
+
+	struct LightmapFace;
+	struct LightmapMesh;
+	
+	/**
+	* A bundle of rays traced through the BVH together. Ray data is stored per component so the per-ray loops in the traversal can be vectorized by the compiler.
+	*/
+	class _PolyExport LightmapRayPacket {
+		public:
+			LightmapRayPacket();
+			
+			/**
+			* Sets one ray of the packet.
+			* @param index Ray index, below PACKET_SIZE.
+			* @param origin Ray origin.
+			* @param direction Normalized ray direction.
+			* @param maxDistance Length of the ray.
+			*/
+			void setRay(int index, const Vector3 &origin, const Vector3 &direction, Number maxDistance);
+			
+			static const int PACKET_SIZE = 4;
+			
+			float originX[PACKET_SIZE];
+			float originY[PACKET_SIZE];
+			float originZ[PACKET_SIZE];
+			float directionX[PACKET_SIZE];
+			float directionY[PACKET_SIZE];
+			float directionZ[PACKET_SIZE];
+			float inverseX[PACKET_SIZE];
+			float inverseY[PACKET_SIZE];
+			float inverseZ[PACKET_SIZE];
+			float maxDistance[PACKET_SIZE];
+			
+			/**
+			* Number of rays in use, starting from the first.
+			*/
+			int numRays;
+	};
+	
+	/**
+	* Closest hit of a ray.
+	*/
+	class _PolyExport LightmapRayHit {
+		public:
+			LightmapRayHit() : face(NULL), distance(0) {}
+			
+			/**
+			* Face that was hit, or NULL if the ray hit nothing.
+			*/
+			LightmapFace *face;
+			Number distance;
+	};
+	
+	/**
+	* Bounding volume hierarchy over the world space triangles of the lightmapped meshes, built with a binned surface area heuristic.
+	*/
+	class _PolyExport LightmapBVH {
+		public:
+			LightmapBVH();
+			virtual ~LightmapBVH();
+			
+			/**
+			* Rebuilds the hierarchy from the faces of the meshes. Faces that were not packed into a lightmap are left out.
+			*/
+			void build(const std::vector<LightmapMesh*> &meshes);
+			
+			/**
+			* Tests a packet of rays for any hit closer than each ray's maximum distance.
+			* @param packet Rays to test.
+			* @param occluded Receives true for every ray that hits something.
+			*/
+			void occludedPacket(const LightmapRayPacket &packet, bool *occluded) const;
+			
+			/**
+			* Finds the closest hit of every ray in a packet.
+			*/
+			void intersectPacket(const LightmapRayPacket &packet, LightmapRayHit *hits) const;
+			
+			unsigned int getNumTriangles() const;
+			unsigned int getNumNodes() const;
+			
+		protected:
+		
+			class Node {
+				public:
+					float bMin[3];
+					float bMax[3];
+					
+					// first triangle for leaves, first of the two children otherwise
+					unsigned int first;
+					unsigned int count;
+			};
+			
+			class Triangle {
+				public:
+					float v0[3];
+					float edge1[3];
+					float edge2[3];
+					float centroid[3];
+					float bMin[3];
+					float bMax[3];
+					LightmapFace *face;
+			};
+			
+			void subdivide(unsigned int nodeIndex);
+			void updateBounds(unsigned int nodeIndex);
+			bool findSplit(const Node &node, int *axis, float *position);
+			int intersectBox(const Node &node, const LightmapRayPacket &packet, const bool *active, const float *maxDistance) const;
+			void traverse(const LightmapRayPacket &packet, bool anyHit, float *distance, LightmapFace **faces) const;
+			
+			std::vector<Node> nodes;
+			std::vector<Triangle> triangles;
+	};
+}
@@ -1,18 +1,34 @@
 /*
- *  PolyLightmapPacker.h
- *  Poly
- *
- *  Created by Ivan Safrin on 9/24/08.
- *  Copyright 2008 __MyCompanyName__. All rights reserved.
- *
- */
+Copyright (C) 2011 by Ivan Safrin
 
-// @package Scene
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+ 
 
 #pragma once
 
 #include "PolyGlobals.h"
-#include "PolyGenericScene.h"
+#include "PolyScene.h"
+#include "PolySceneMesh.h"
+#include "PolyPolygon.h"
+#include "PolyRectPacker.h"
+#include "PolyVector2.h"
 #include <vector>
 #include <string>
 #include <sstream>
@@ -22,7 +38,10 @@ using std::string;
 
 namespace Polycode {
 	
-	class GenericScene;
+	class Image;
+	class Scene;
+	class Texture;
+	struct LightmapChart;
 	struct LightmapFace;
 	
 	struct Lumel {
@@ -37,12 +56,11 @@ namespace Polycode {
 
 	struct LightmapFace {
 		Polygon *meshPolygon;
-		Polygon *flatPolygon;
-		Polygon *flatUnscaledPolygon;
-		Rectangle area;
-		Rectangle actualArea;
-		Rectangle pixelArea;
+		LightmapChart *chart;
+		Vector3 normal;
+		Number planeDistance;
 		vector<Lumel*> lumels;
+		vector<Vector2> lightmapCoords;
 		int numLumels;
 		int imageID;
 		int projectionAxis;
@@ -51,38 +69,70 @@ namespace Polycode {
 		static const int Z_PROJECTION = 2;		
 	};
 	
+	/**
+	* A group of connected coplanar faces that are packed into the lightmap as one rectangle.
+	*/
+	struct LightmapChart {
+		vector<LightmapFace*> faces;
+		int projectionAxis;
+		
+		// bounds of the faces projected on the chart's axis, in mesh units
+		Number minU;
+		Number minV;
+		Number maxU;
+		Number maxV;
+		
+		// lightmap pixels per mesh unit
+		Number scale;
+		
+		// size in pixels including padding, before rotation
+		unsigned int pixelWidth;
+		unsigned int pixelHeight;
+		
+		PackedRect placement;
+		int imageID;
+	};
+	
 	struct LightmapMesh {
 		SceneMesh *mesh;
 		int imageID;
 		bool processed;
 		vector<LightmapFace*> faces;
+		vector<LightmapChart*> charts;
 	};
 	
-	class _PolyExport PackNode {
-	public:
-		PackNode() { child[0] = NULL; child[1] = NULL; face = NULL;}
-		~PackNode(){}
-		
-		PackNode *clone();
-		int rootRes;
-		PackNode *Insert(LightmapFace *img);
-		void createRoot(int res);
-		PackNode* child[2];
-		Rectangle rc;
-		LightmapFace *face;
-	};
-	
+	/**
+	* Unwraps the static geometry of a scene into lightmaps. Connected coplanar faces are grouped into charts, and the charts of each mesh are packed with the shared MaxRects RectPacker, largest first. Every mesh is kept on a single lightmap page, and new pages are only started when a mesh fits on none of the existing ones.
+	*/
 	class _PolyExport LightmapPacker {
 	public:
-		LightmapPacker(GenericScene *targetScene);
+		LightmapPacker(Scene *targetScene);
 		~LightmapPacker();
 		
+		/**
+		* Unwraps and packs the scene.
+		* @param resolution Width and height of each lightmap page.
+		* @param quality Lightmap pixels per mesh unit.
+		*/
 		void generateTextures(int resolution, int quality);
 		void unwrapScene();
 		void bindTextures();
 		void buildTextures();
 		
-		Vector3 getLumelPos(Lumel *lumel, LightmapFace *face);
+		/**
+		* Sets the number of pixels kept free around each chart. Defaults to 2.
+		*/
+		void setPadding(unsigned int padding);
+		
+		/**
+		* If true (the default), charts may be turned by 90 degrees to pack better.
+		*/
+		void setAllowRotation(bool allowRotation);
+		
+		/**
+		* Returns the fraction of the lightmap pages covered by charts.
+		*/
+		Number getUtilization() const;
 		
 		void saveLightmaps(string folder);
 
@@ -97,15 +147,22 @@ namespace Polycode {
 		
 	private:
 		
-		void packMesh(LightmapMesh *mesh);
-		void generateNewImage();
-		bool hasRoomForMesh(LightmapMesh *mesh);
+		void buildCharts(LightmapMesh *mesh);
+		void updateChartSize(LightmapChart *chart, Number scale);
+		bool packCharts(LightmapMesh *mesh, RectPacker *packer);
+		void placeMesh(LightmapMesh *mesh, int imageID);
+		void createLumels(LightmapMesh *mesh, LightmapChart *chart);
+		void chartToPage(LightmapChart *chart, Number x, Number y, Number *pageX, Number *pageY) const;
+		void rasterizeFaces(LightmapChart *chart, std::vector<int> *faceIndices) const;
+		
+		static void projectPoint(const Vector3 &point, int axis, Number *u, Number *v);
+		static Vector3 unprojectPoint(LightmapFace *face, Number u, Number v);
 		
-		PackNode *cNode;
-		Image *currentImage;
-		int currentImageID;
+		vector<RectPacker*> pagePackers;
+		unsigned int padding;
+		bool allowRotation;
 		
-		GenericScene *targetScene;
+		Scene *targetScene;
 	};
 	
-}
\ No newline at end of file
+}
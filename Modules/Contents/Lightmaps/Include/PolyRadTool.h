@@ -1,47 +1,192 @@
 /*
- *  PolyRadTool.h
- *  Poly
- *
- *  Created by Ivan Safrin on 9/25/08.
- *  Copyright 2008 __MyCompanyName__. All rights reserved.
- *
- */
+Copyright (C) 2011 by Ivan Safrin
 
-// @package Scene
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+ 
 
 #pragma once
 #include "PolyGlobals.h"
-#include "PolyGenericScene.h"
-#include "PolyLightmapPacker.h"
-#include "PolyPolygon.h"
+#include "PolyEventDispatcher.h"
+#include "PolyString.h"
+#include "PolyThreaded.h"
+#include "PolyVector3.h"
+#include <map>
+#include <vector>
 
 namespace Polycode {
 
-	class GenericScene;
+	class CoreMutex;
+	class LightmapBVH;
 	class LightmapPacker;
-	class LightmapFace;
+	class RadTool;
+	class Scene;
+	struct LightmapFace;
+	struct LightmapMesh;
 	struct Lumel;
-	class Polygon;
 	
-	class _PolyExport RadTool {
+	/**
+	* Worker thread of the lightmap baker.
+	*/
+	class _PolyExport RadToolWorker : public Threaded {
+		public:
+			RadToolWorker(RadTool *tool);
+			
+			void runThread();
+			void updateThread();
+			
+			volatile bool threadFinished;
+			
+		protected:
+			RadTool *tool;
+	};
+	
+	/**
+	* Bakes direct light and diffuse bounces into the lumels of a LightmapPacker. Shadow and bounce rays are traced in packets through a BVH of the scene's static geometry, and lumels are split across a pool of worker threads.
+	*
+	* Baked lumels are cached per mesh, keyed by the mesh's lumel layout, the world space geometry of every occluding mesh, the scene's lights and the bake settings. Meshes whose key is unchanged keep their cached result on the next bake. Since any mesh can shadow or reflect light onto the others, moving geometry rebakes every mesh. The cache can be saved to and loaded from a file to carry it over between runs.
+	*
+	* The tool dispatches Event::CHANGE_EVENT as baking progresses (see getProgress()) and Event::COMPLETE_EVENT when it is done.
+	*/
+	class _PolyExport RadTool : public EventDispatcher {
 		public:
-			RadTool(GenericScene *scene, LightmapPacker *packer);
-			~RadTool();
+			RadTool(Scene *scene, LightmapPacker *packer);
+			virtual ~RadTool();
 			
+			/**
+			* Bakes the lightmaps and writes them into the packer's images.
+			* @param radPasses Number of light bounces.
+			*/
 			void fiatLux(int radPasses);
 			
-		private:
-		
-			void applyLight(SceneLight *light);
-			void lightLumel(SceneLight *light,Image *image, Lumel *lumel);
-			
-			void doRadiosityPass();
-			void radLumel(Lumel *lumel,Image *image);
-					
-			bool worldRayTest(Vector3 origin, Vector3 destination, Polygon *hitPolygon);
-			static bool rayTriangleIntersect(Vector3 ray_origin, Vector3 ray_direction, Vector3 vert0, Vector3 vert1, Vector3 vert2, Vector3 *hitPoint);
+			/**
+			* Sets the number of threads used for baking, including the calling thread. Defaults to 4.
+			*/
+			void setNumThreads(int numThreads);
+			
+			/**
+			* Sets the number of rays traced per lumel for every bounce. Defaults to 64.
+			*/
+			void setNumBounceSamples(int numSamples);
+			
+			/**
+			* Sets the fraction of incoming light that surfaces reflect in a bounce. Defaults to 0.5.
+			*/
+			void setBounceReflectance(Number reflectance);
+			
+			/**
+			* Sets the light every lumel receives regardless of visibility. Defaults to 0.033 on every channel.
+			*/
+			void setAmbientColor(Number r, Number g, Number b);
+			
+			/**
+			* Sets the distance ray origins are moved along the surface normal to avoid hitting their own surface. Defaults to 0.01.
+			*/
+			void setRayBias(Number bias);
+			
+			/**
+			* Returns the progress of the current bake, from 0 to 1.
+			*/
+			Number getProgress() const;
+			
+			/**
+			* Returns the number of meshes baked by the last call to fiatLux(). Meshes taken from the cache are not counted.
+			*/
+			unsigned int getNumBakedMeshes() const;
+			
+			bool loadBakeCache(const String& fileName);
+			bool saveBakeCache(const String& fileName);
+			void clearBakeCache();
+			
+			/**
+			* Processes one batch of the current pass. Returns false if there was no work left. Called by the worker threads.
+			*/
+			bool processBatch();
+			
+			static const int BATCH_SIZE = 64;
+			
+		protected:
 		
-			GenericScene *scene;
+			class BakeLight {
+				public:
+					Vector3 position;
+					Vector3 direction;
+					Vector3 color;
+					Number intensity;
+					Number constantAttenuation;
+					Number linearAttenuation;
+					Number quadraticAttenuation;
+					bool spot;
+					Number spotCosCutoff;
+			};
+			
+			class CacheEntry {
+				public:
+					std::vector<Vector3> directEnergy;
+					std::vector<Vector3> energy;
+			};
+			
+			void collectLights();
+			void collectLumels(int radPasses);
+			unsigned int getMeshKey(LightmapMesh *mesh, unsigned int sceneKey, int radPasses);
+			void runPass(int pass);
+			void updateFaceExitance();
+			void bakeDirect(unsigned int start, unsigned int end);
+			void bakeBounce(unsigned int start, unsigned int end);
+			void writeLumels();
+			
+			Scene *scene;
 			LightmapPacker *packer;
+			LightmapBVH *bvh;
+			
+			int numThreads;
+			int numBounceSamples;
+			Number bounceReflectance;
+			Vector3 ambientColor;
+			Number rayBias;
+			
+			std::vector<BakeLight> lights;
+			std::vector<Lumel*> lumels;
+			std::vector<Vector3> lumelNormals;
+			std::vector<int> lumelFaces;
+			std::vector<Vector3> directEnergy;
+			std::vector<Vector3> energy;
+			std::vector<unsigned int> pendingLumels;
+			
+			std::map<LightmapFace*, int> faceIndices;
+			std::vector<unsigned int> faceFirstLumel;
+			std::vector<unsigned int> faceNumLumels;
+			std::vector<Vector3> faceExitance;
+			
+			std::vector<unsigned int> meshKeys;
+			std::vector<unsigned int> meshFirstLumel;
+			std::vector<unsigned int> meshNumLumels;
+			std::vector<bool> meshBaked;
+			unsigned int numBakedMeshes;
+			
+			std::map<unsigned int, CacheEntry> bakeCache;
+			
+			CoreMutex *workMutex;
+			int currentPass;
+			unsigned int nextPending;
+			volatile unsigned int finishedPending;
+			int totalPasses;
+			Number progress;
 	};
-}
\ No newline at end of file
+}
@@ -0,0 +1,389 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+ 
+
+#include "PolyLightmapBVH.h"
+#include "PolyLightmapPacker.h"
+#include "PolyLogger.h"
+#include "PolyPolygon.h"
+#include "PolySceneMesh.h"
+#include "PolyVertex.h"
+#include <float.h>
+#include <math.h>
+
+using namespace Polycode;
+
+#define BVH_NUM_BINS 12
+#define BVH_MAX_LEAF_SIZE 4
+#define BVH_STACK_SIZE 128
+#define BVH_EPSILON 0.0001f
+
+LightmapRayPacket::LightmapRayPacket() : numRays(0) {
+	for(int i=0; i < PACKET_SIZE; i++) {
+		setRay(i, Vector3(0,0,0), Vector3(0,0,1), 0);
+	}
+}
+
+void LightmapRayPacket::setRay(int index, const Vector3 &origin, const Vector3 &direction, Number maxDistance) {
+	originX[index] = origin.x;
+	originY[index] = origin.y;
+	originZ[index] = origin.z;
+	directionX[index] = direction.x;
+	directionY[index] = direction.y;
+	directionZ[index] = direction.z;
+	
+	// a zero component gives an infinite inverse, which the slab test handles
+	inverseX[index] = 1.0f / directionX[index];
+	inverseY[index] = 1.0f / directionY[index];
+	inverseZ[index] = 1.0f / directionZ[index];
+	this->maxDistance[index] = maxDistance;
+}
+
+LightmapBVH::LightmapBVH() {
+}
+
+LightmapBVH::~LightmapBVH() {
+}
+
+unsigned int LightmapBVH::getNumTriangles() const {
+	return triangles.size();
+}
+
+unsigned int LightmapBVH::getNumNodes() const {
+	return nodes.size();
+}
+
+void LightmapBVH::build(const std::vector<LightmapMesh*> &meshes) {
+	nodes.clear();
+	triangles.clear();
+	
+	for(int m=0; m < meshes.size(); m++) {
+		Matrix4 meshMatrix = meshes[m]->mesh->getConcatenatedMatrix();
+		for(int f=0; f < meshes[m]->faces.size(); f++) {
+			LightmapFace *face = meshes[m]->faces[f];
+			if(face->imageID < 0)
+				continue;
+			
+			Polygon *poly = face->meshPolygon;
+			Vector3 v0 = meshMatrix * (*poly->getVertex(0));
+			for(int k=1; k+1 < poly->getVertexCount(); k++) {
+				Vector3 v1 = meshMatrix * (*poly->getVertex(k));
+				Vector3 v2 = meshMatrix * (*poly->getVertex(k+1));
+				
+				Triangle triangle;
+				float points[3][3] = {{(float)v0.x, (float)v0.y, (float)v0.z}, {(float)v1.x, (float)v1.y, (float)v1.z}, {(float)v2.x, (float)v2.y, (float)v2.z}};
+				for(int a=0; a < 3; a++) {
+					triangle.v0[a] = points[0][a];
+					triangle.edge1[a] = points[1][a] - points[0][a];
+					triangle.edge2[a] = points[2][a] - points[0][a];
+					triangle.bMin[a] = FLT_MAX;
+					triangle.bMax[a] = -FLT_MAX;
+					for(int p=0; p < 3; p++) {
+						if(points[p][a] < triangle.bMin[a]) triangle.bMin[a] = points[p][a];
+						if(points[p][a] > triangle.bMax[a]) triangle.bMax[a] = points[p][a];
+					}
+					triangle.centroid[a] = (points[0][a] + points[1][a] + points[2][a]) / 3.0f;
+				}
+				triangle.face = face;
+				triangles.push_back(triangle);
+			}
+		}
+	}
+	
+	if(triangles.size() == 0)
+		return;
+	
+	nodes.reserve(triangles.size() * 2);
+	Node root;
+	root.first = 0;
+	root.count = triangles.size();
+	nodes.push_back(root);
+	updateBounds(0);
+	subdivide(0);
+	
+	Logger::log("Lightmap BVH: %d triangles, %d nodes\n", triangles.size(), nodes.size());
+}
+
+void LightmapBVH::updateBounds(unsigned int nodeIndex) {
+	Node &node = nodes[nodeIndex];
+	for(int a=0; a < 3; a++) {
+		node.bMin[a] = FLT_MAX;
+		node.bMax[a] = -FLT_MAX;
+	}
+	for(unsigned int i=node.first; i < node.first + node.count; i++) {
+		for(int a=0; a < 3; a++) {
+			if(triangles[i].bMin[a] < node.bMin[a]) node.bMin[a] = triangles[i].bMin[a];
+			if(triangles[i].bMax[a] > node.bMax[a]) node.bMax[a] = triangles[i].bMax[a];
+		}
+	}
+}
+
+static float boxArea(const float *bMin, const float *bMax) {
+	float x = bMax[0] - bMin[0];
+	float y = bMax[1] - bMin[1];
+	float z = bMax[2] - bMin[2];
+	return (x*y) + (y*z) + (z*x);
+}
+
+bool LightmapBVH::findSplit(const Node &node, int *axis, float *position) {
+	float centroidMin[3];
+	float centroidMax[3];
+	for(int a=0; a < 3; a++) {
+		centroidMin[a] = FLT_MAX;
+		centroidMax[a] = -FLT_MAX;
+	}
+	for(unsigned int i=node.first; i < node.first + node.count; i++) {
+		for(int a=0; a < 3; a++) {
+			if(triangles[i].centroid[a] < centroidMin[a]) centroidMin[a] = triangles[i].centroid[a];
+			if(triangles[i].centroid[a] > centroidMax[a]) centroidMax[a] = triangles[i].centroid[a];
+		}
+	}
+	
+	float bestCost = node.count * boxArea(node.bMin, node.bMax);
+	bool found = false;
+	
+	for(int a=0; a < 3; a++) {
+		float extent = centroidMax[a] - centroidMin[a];
+		if(extent <= 0)
+			continue;
+		
+		unsigned int binCounts[BVH_NUM_BINS];
+		float binMin[BVH_NUM_BINS][3];
+		float binMax[BVH_NUM_BINS][3];
+		for(int b=0; b < BVH_NUM_BINS; b++) {
+			binCounts[b] = 0;
+			for(int c=0; c < 3; c++) {
+				binMin[b][c] = FLT_MAX;
+				binMax[b][c] = -FLT_MAX;
+			}
+		}
+		
+		float scale = BVH_NUM_BINS / extent;
+		for(unsigned int i=node.first; i < node.first + node.count; i++) {
+			int b = (int)((triangles[i].centroid[a] - centroidMin[a]) * scale);
+			if(b >= BVH_NUM_BINS) b = BVH_NUM_BINS-1;
+			binCounts[b]++;
+			for(int c=0; c < 3; c++) {
+				if(triangles[i].bMin[c] < binMin[b][c]) binMin[b][c] = triangles[i].bMin[c];
+				if(triangles[i].bMax[c] > binMax[b][c]) binMax[b][c] = triangles[i].bMax[c];
+			}
+		}
+		
+		// sweep from the left, then evaluate every split while sweeping from the right
+		float leftArea[BVH_NUM_BINS-1];
+		unsigned int leftCount[BVH_NUM_BINS-1];
+		float boundsMin[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+		float boundsMax[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+		unsigned int count = 0;
+		for(int b=0; b < BVH_NUM_BINS-1; b++) {
+			count += binCounts[b];
+			for(int c=0; c < 3; c++) {
+				if(binMin[b][c] < boundsMin[c]) boundsMin[c] = binMin[b][c];
+				if(binMax[b][c] > boundsMax[c]) boundsMax[c] = binMax[b][c];
+			}
+			leftCount[b] = count;
+			leftArea[b] = count ? boxArea(boundsMin, boundsMax) : 0;
+		}
+		
+		for(int c=0; c < 3; c++) {
+			boundsMin[c] = FLT_MAX;
+			boundsMax[c] = -FLT_MAX;
+		}
+		count = 0;
+		for(int b=BVH_NUM_BINS-1; b > 0; b--) {
+			count += binCounts[b];
+			for(int c=0; c < 3; c++) {
+				if(binMin[b][c] < boundsMin[c]) boundsMin[c] = binMin[b][c];
+				if(binMax[b][c] > boundsMax[c]) boundsMax[c] = binMax[b][c];
+			}
+			if(count == 0 || leftCount[b-1] == 0)
+				continue;
+			float cost = (leftCount[b-1] * leftArea[b-1]) + (count * boxArea(boundsMin, boundsMax));
+			if(cost < bestCost) {
+				bestCost = cost;
+				*axis = a;
+				*position = centroidMin[a] + (b / scale);
+				found = true;
+			}
+		}
+	}
+	return found;
+}
+
+void LightmapBVH::subdivide(unsigned int nodeIndex) {
+	if(nodes[nodeIndex].count <= BVH_MAX_LEAF_SIZE)
+		return;
+	
+	int axis;
+	float position;
+	if(!findSplit(nodes[nodeIndex], &axis, &position))
+		return;
+	
+	unsigned int first = nodes[nodeIndex].first;
+	unsigned int count = nodes[nodeIndex].count;
+	int i = first;
+	int j = first + count - 1;
+	while(i <= j) {
+		if(triangles[i].centroid[axis] < position) {
+			i++;
+		} else {
+			Triangle tmp = triangles[i];
+			triangles[i] = triangles[j];
+			triangles[j] = tmp;
+			j--;
+		}
+	}
+	
+	unsigned int leftCount = i - first;
+	if(leftCount == 0 || leftCount == count)
+		return;
+	
+	unsigned int leftIndex = nodes.size();
+	Node left;
+	left.first = first;
+	left.count = leftCount;
+	nodes.push_back(left);
+	Node right;
+	right.first = i;
+	right.count = count - leftCount;
+	nodes.push_back(right);
+	
+	nodes[nodeIndex].first = leftIndex;
+	nodes[nodeIndex].count = 0;
+	
+	updateBounds(leftIndex);
+	updateBounds(leftIndex+1);
+	subdivide(leftIndex);
+	subdivide(leftIndex+1);
+}
+
+int LightmapBVH::intersectBox(const Node &node, const LightmapRayPacket &packet, const bool *active, const float *maxDistance) const {
+	int hits = 0;
+	for(int i=0; i < LightmapRayPacket::PACKET_SIZE; i++) {
+		float tx1 = (node.bMin[0] - packet.originX[i]) * packet.inverseX[i];
+		float tx2 = (node.bMax[0] - packet.originX[i]) * packet.inverseX[i];
+		float ty1 = (node.bMin[1] - packet.originY[i]) * packet.inverseY[i];
+		float ty2 = (node.bMax[1] - packet.originY[i]) * packet.inverseY[i];
+		float tz1 = (node.bMin[2] - packet.originZ[i]) * packet.inverseZ[i];
+		float tz2 = (node.bMax[2] - packet.originZ[i]) * packet.inverseZ[i];
+		float tNear = fmaxf(fmaxf(fminf(tx1, tx2), fminf(ty1, ty2)), fminf(tz1, tz2));
+		float tFar = fminf(fminf(fmaxf(tx1, tx2), fmaxf(ty1, ty2)), fmaxf(tz1, tz2));
+		hits += (active[i] && tFar >= fmaxf(tNear, 0.0f) && tNear < maxDistance[i]) ? 1 : 0;
+	}
+	return hits;
+}
+
+void LightmapBVH::traverse(const LightmapRayPacket &packet, bool anyHit, float *distance, LightmapFace **faces) const {
+	bool active[LightmapRayPacket::PACKET_SIZE];
+	int numActive = 0;
+	for(int i=0; i < LightmapRayPacket::PACKET_SIZE; i++) {
+		active[i] = (i < packet.numRays);
+		distance[i] = packet.maxDistance[i];
+		faces[i] = NULL;
+		if(active[i])
+			numActive++;
+	}
+	
+	if(nodes.size() == 0 || numActive == 0)
+		return;
+	
+	unsigned int stack[BVH_STACK_SIZE];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+	
+	while(stackSize > 0) {
+		const Node &node = nodes[stack[--stackSize]];
+		if(!intersectBox(node, packet, active, distance))
+			continue;
+		
+		if(node.count == 0) {
+			if(stackSize + 2 > BVH_STACK_SIZE) {
+				Logger::log("Lightmap BVH: traversal stack overflow\n");
+				continue;
+			}
+			stack[stackSize++] = node.first + 1;
+			stack[stackSize++] = node.first;
+			continue;
+		}
+		
+		for(unsigned int t=node.first; t < node.first + node.count; t++) {
+			const Triangle &tri = triangles[t];
+			for(int i=0; i < LightmapRayPacket::PACKET_SIZE; i++) {
+				if(!active[i])
+					continue;
+				
+				float px = (packet.directionY[i] * tri.edge2[2]) - (packet.directionZ[i] * tri.edge2[1]);
+				float py = (packet.directionZ[i] * tri.edge2[0]) - (packet.directionX[i] * tri.edge2[2]);
+				float pz = (packet.directionX[i] * tri.edge2[1]) - (packet.directionY[i] * tri.edge2[0]);
+				float det = (tri.edge1[0] * px) + (tri.edge1[1] * py) + (tri.edge1[2] * pz);
+				if(fabsf(det) < 0.00000001f)
+					continue;
+				float invDet = 1.0f / det;
+				
+				float sx = packet.originX[i] - tri.v0[0];
+				float sy = packet.originY[i] - tri.v0[1];
+				float sz = packet.originZ[i] - tri.v0[2];
+				float u = ((sx * px) + (sy * py) + (sz * pz)) * invDet;
+				if(u < 0.0f || u > 1.0f)
+					continue;
+				
+				float qx = (sy * tri.edge1[2]) - (sz * tri.edge1[1]);
+				float qy = (sz * tri.edge1[0]) - (sx * tri.edge1[2]);
+				float qz = (sx * tri.edge1[1]) - (sy * tri.edge1[0]);
+				float v = ((packet.directionX[i] * qx) + (packet.directionY[i] * qy) + (packet.directionZ[i] * qz)) * invDet;
+				if(v < 0.0f || u + v > 1.0f)
+					continue;
+				
+				float hitDistance = ((tri.edge2[0] * qx) + (tri.edge2[1] * qy) + (tri.edge2[2] * qz)) * invDet;
+				if(hitDistance > BVH_EPSILON && hitDistance < distance[i]) {
+					distance[i] = hitDistance;
+					faces[i] = tri.face;
+					if(anyHit) {
+						active[i] = false;
+						numActive--;
+					}
+				}
+			}
+			if(numActive == 0)
+				return;
+		}
+	}
+}
+
+void LightmapBVH::occludedPacket(const LightmapRayPacket &packet, bool *occluded) const {
+	float distance[LightmapRayPacket::PACKET_SIZE];
+	LightmapFace *faces[LightmapRayPacket::PACKET_SIZE];
+	traverse(packet, true, distance, faces);
+	for(int i=0; i < packet.numRays; i++) {
+		occluded[i] = (faces[i] != NULL);
+	}
+}
+
+void LightmapBVH::intersectPacket(const LightmapRayPacket &packet, LightmapRayHit *hits) const {
+	float distance[LightmapRayPacket::PACKET_SIZE];
+	LightmapFace *faces[LightmapRayPacket::PACKET_SIZE];
+	traverse(packet, false, distance, faces);
+	for(int i=0; i < packet.numRays; i++) {
+		hits[i].face = faces[i];
+		hits[i].distance = distance[i];
+	}
+}
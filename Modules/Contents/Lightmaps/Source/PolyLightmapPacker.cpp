@@ -1,322 +1,448 @@
 /*
- *  LightmapPacker.cpp
- *  Poly
- *
- *  Created by Ivan Safrin on 9/24/08.
- *  Copyright 2008 __MyCompanyName__. All rights reserved.
- *
- */
+Copyright (C) 2011 by Ivan Safrin
 
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+ 
 
 #include "PolyLightmapPacker.h"
+#include "PolyCoreServices.h"
+#include "PolyImage.h"
+#include "PolyLogger.h"
+#include "PolyMaterial.h"
+#include "PolyMaterialManager.h"
+#include "PolyMesh.h"
+#include "PolyShader.h"
+#include "PolyVertex.h"
+#include <algorithm>
+#include <map>
+#include <math.h>
+#include <stdio.h>
 
 using namespace Polycode;
 
-LightmapPacker::LightmapPacker(GenericScene *targetScene) {
+static bool compareChartArea(LightmapChart *a, LightmapChart *b) {
+	return (a->pixelWidth * a->pixelHeight) > (b->pixelWidth * b->pixelHeight);
+}
+
+static int findChartRoot(vector<int> &parents, int index) {
+	while(parents[index] != index) {
+		parents[index] = parents[parents[index]];
+		index = parents[index];
+	}
+	return index;
+}
+
+LightmapPacker::LightmapPacker(Scene *targetScene) {
 	this->targetScene = targetScene;
-	currentImageID = -1;
+	padding = 2;
+	allowRotation = true;
+	lightMapRes = 512;
+	lightMapQuality = 1;
 }
 
 LightmapPacker::~LightmapPacker() {
-	
+	for(int i=0; i < lightmapMeshes.size(); i++) {
+		for(int j=0; j < lightmapMeshes[i]->faces.size(); j++) {
+			delete lightmapMeshes[i]->faces[j];
+		}
+		for(int j=0; j < lightmapMeshes[i]->charts.size(); j++) {
+			delete lightmapMeshes[i]->charts[j];
+		}
+		delete lightmapMeshes[i];
+	}
+	for(int i=0; i < lumels.size(); i++) {
+		delete lumels[i];
+	}
+	for(int i=0; i < pagePackers.size(); i++) {
+		delete pagePackers[i];
+	}
+	for(int i=0; i < images.size(); i++) {
+		delete images[i];
+	}
+}
+
+void LightmapPacker::setPadding(unsigned int padding) {
+	this->padding = padding;
+}
+
+void LightmapPacker::setAllowRotation(bool allowRotation) {
+	this->allowRotation = allowRotation;
+}
+
+Number LightmapPacker::getUtilization() const {
+	if(pagePackers.size() == 0)
+		return 0;
+	Number total = 0;
+	for(int i=0; i < pagePackers.size(); i++) {
+		total += pagePackers[i]->getOccupancy();
+	}
+	return total / pagePackers.size();
+}
+
+void LightmapPacker::projectPoint(const Vector3 &point, int axis, Number *u, Number *v) {
+	switch(axis) {
+		case LightmapFace::X_PROJECTION:
+			*u = point.y;
+			*v = point.z;
+		break;
+		case LightmapFace::Y_PROJECTION:
+			*u = point.x;
+			*v = point.z;
+		break;
+		default:
+			*u = point.x;
+			*v = point.y;
+		break;
+	}
+}
+
+Vector3 LightmapPacker::unprojectPoint(LightmapFace *face, Number u, Number v) {
+	// solve the face plane for the axis the face was projected along
+	Vector3 n = face->normal;
+	switch(face->projectionAxis) {
+		case LightmapFace::X_PROJECTION:
+			return Vector3(-((n.y * u) + (n.z * v) + face->planeDistance) / n.x, u, v);
+		case LightmapFace::Y_PROJECTION:
+			return Vector3(u, -((n.x * u) + (n.z * v) + face->planeDistance) / n.y, v);
+		default:
+			return Vector3(u, v, -((n.x * u) + (n.y * v) + face->planeDistance) / n.z);
+	}
 }
 
 void LightmapPacker::unwrapScene() {
 	for(int i=0; i < targetScene->getNumStaticGeometry(); i++) {
 		LightmapMesh *newLMesh = new LightmapMesh;
 		newLMesh->processed = false;
+		newLMesh->imageID = -1;
 		newLMesh->mesh = targetScene->getStaticGeometry(i);
 		lightmapMeshes.push_back(newLMesh);
 		
-		for(int j=0; j < targetScene->getStaticGeometry(i)->getMesh()->getPolygonCount(); j++) {
-			Polygon *poly = targetScene->getStaticGeometry(i)->getMesh()->getPolygon(j);
-			Vector3 fnormal = poly->getFaceNormal();
-			Polygon *flatPoly = new Polygon();
-			Polygon *flatUnscaled = new Polygon();
-			LightmapFace *newFace = new LightmapFace;
-			fnormal.x = fabsf(fnormal.x);
-			fnormal.y = fabsf(fnormal.y);
-			fnormal.z = fabsf(fnormal.z);
-			//			Logger::log("fnormal: %f %f %f\n", fnormal.x, fnormal.y, fnormal.z);
-			if(fnormal.x > fnormal.y && fnormal.x > fnormal.z) {
-				for(int k=0; k < poly->getVertexCount(); k++) {
-					flatPoly->addVertex((poly->getVertex(k)->y*lightMapQuality)/lightMapRes, (poly->getVertex(k)->z*lightMapQuality)/lightMapRes, 0);
-					flatUnscaled->addVertex(poly->getVertex(k)->y, poly->getVertex(k)->z, 0);
-				}
-				newFace->projectionAxis = LightmapFace::X_PROJECTION;
-			} else if (fnormal.y > fnormal.x && fnormal.y > fnormal.z) {
-				for(int k=0; k < poly->getVertexCount(); k++) {
-					flatPoly->addVertex((poly->getVertex(k)->x*lightMapQuality)/lightMapRes, (poly->getVertex(k)->z*lightMapQuality)/lightMapRes, 0);
-					flatUnscaled->addVertex(poly->getVertex(k)->x, poly->getVertex(k)->z, 0);
-				}	
-				newFace->projectionAxis = LightmapFace::Y_PROJECTION;						
-			} else {
-				for(int k=0; k < poly->getVertexCount(); k++) {
-					flatPoly->addVertex((poly->getVertex(k)->x*lightMapQuality)/lightMapRes, (poly->getVertex(k)->y*lightMapQuality)/lightMapRes, 0);
-					flatUnscaled->addVertex(poly->getVertex(k)->x, poly->getVertex(k)->y, 0);
-				}
-				newFace->projectionAxis = LightmapFace::Z_PROJECTION;							
-			}
-			
-			newFace->area = flatPoly->getBounds2D();
-			float offx = newFace->area.x;
-			float offy = newFace->area.y;
-			newFace->area.x = 0;
-			newFace->area.y = 0;
-			
-			// now align the flat face to 0,0
-			for(int k=0; k < flatPoly->getVertexCount(); k++) {
-				flatPoly->getVertex(k)->x -= offx;
-				flatPoly->getVertex(k)->y -= offy;
-//				flatPoly->getVertex(k)->x *= 1.1;
-//				flatPoly->getVertex(k)->y *= 1.2;
-			}
-			
+		Mesh *mesh = newLMesh->mesh->getMesh();
+		for(int j=0; j < mesh->getPolygonCount(); j++) {
+			Polygon *poly = mesh->getPolygon(j);
+			if(poly->getVertexCount() < 3)
+				continue;
 			
+			LightmapFace *newFace = new LightmapFace;
 			newFace->meshPolygon = poly;
-			newFace->flatPolygon = flatPoly;
-			newFace->flatUnscaledPolygon = flatUnscaled;
-			
-			newFace->actualArea.w = (newFace->area.w * lightMapRes) / lightMapQuality;
-			newFace->actualArea.h = (newFace->area.h * lightMapRes) / lightMapQuality;
-			
-			float lumelScale = 1.0f;
-			float maxSize = 0.4f;
+			newFace->chart = NULL;
+			newFace->numLumels = 0;
+			newFace->imageID = -1;
+			newFace->normal = poly->getFaceNormal();
+			newFace->normal.Normalize();
+			newFace->planeDistance = -newFace->normal.dot(*poly->getVertex(0));
 			
-			if(newFace->area.w > maxSize || newFace->area.h > maxSize) {
-				//		Logger::log("WARNING, NORMALIZING FACE AREA (%f %f)\n", newFace->area.w, newFace->area.h);
-				float tmp;
-				if(newFace->area.w > newFace->area.h) {
-					tmp = newFace->area.w;
-					newFace->area.w = maxSize;
-					newFace->area.h = newFace->area.h * (maxSize/tmp);
-				} else {
-					tmp = newFace->area.h;
-					newFace->area.h = maxSize;
-					newFace->area.w = newFace->area.w * (maxSize/tmp);			
-				}
-				lumelScale = (1.0f / (maxSize/tmp)) * 100;
-				for(int v=0; v < newFace->flatPolygon->getVertexCount(); v++) {
-					newFace->flatPolygon->getVertex(v)->x = newFace->flatPolygon->getVertex(v)->x * (maxSize/tmp);
-					newFace->flatPolygon->getVertex(v)->y = newFace->flatPolygon->getVertex(v)->y * (maxSize/tmp);
-				}
+			Number nx = fabs(newFace->normal.x);
+			Number ny = fabs(newFace->normal.y);
+			Number nz = fabs(newFace->normal.z);
+			if(nx > ny && nx > nz) {
+				newFace->projectionAxis = LightmapFace::X_PROJECTION;
+			} else if (ny > nx && ny > nz) {
+				newFace->projectionAxis = LightmapFace::Y_PROJECTION;
+			} else {
+				newFace->projectionAxis = LightmapFace::Z_PROJECTION;
 			}
+			newLMesh->faces.push_back(newFace);
+		}
+		
+		buildCharts(newLMesh);
+	}
+}
 
-
-//			newFace->area.w += (4.0f/lightMapRes);
-//			newFace->area.h += (4.0f/lightMapRes);
+void LightmapPacker::buildCharts(LightmapMesh *mesh) {
+	vector<int> parents;
+	for(int i=0; i < mesh->faces.size(); i++) {
+		parents.push_back(i);
+	}
+	
+	// join coplanar faces that share a vertex
+	std::map<std::string, vector<int> > vertexFaces;
+	for(int i=0; i < mesh->faces.size(); i++) {
+		LightmapFace *face = mesh->faces[i];
+		for(int k=0; k < face->meshPolygon->getVertexCount(); k++) {
+			Vertex *vertex = face->meshPolygon->getVertex(k);
+			char key[96];
+			snprintf(key, sizeof(key), "%ld_%ld_%ld", (long)floor(vertex->x * 10000.0 + 0.5), (long)floor(vertex->y * 10000.0 + 0.5), (long)floor(vertex->z * 10000.0 + 0.5));
 			
-			newFace->pixelArea.w = (newFace->area.w * lightMapRes)+2;
-			newFace->pixelArea.h = (newFace->area.h * lightMapRes)+2;
-
-//			newFace->area.w = newFace->pixelArea.w / lightMapRes;
-//			newFace->area.h = newFace->pixelArea.h / lightMapRes;
-						
-			newFace->numLumels = 0;
-			for(float pw =-2 ;pw < newFace->pixelArea.w+3; pw++) {
-				for(float ph =-2 ;ph < newFace->pixelArea.h+3; ph++) {
-					Lumel *newLumel = new Lumel;
-					newLumel->face = newFace;
-					newLumel->lumelScale = lumelScale;
-					newLumel->u = pw/lightMapRes;
-					newLumel->v = ph/lightMapRes;
-					newLumel->normal = newFace->meshPolygon->getFaceNormal();
-					newFace->lumels.push_back(newLumel);
-					lumels.push_back(newLumel);
-					newFace->numLumels++;
+			vector<int> &others = vertexFaces[key];
+			for(int o=0; o < others.size(); o++) {
+				LightmapFace *other = mesh->faces[others[o]];
+				if(other->projectionAxis == face->projectionAxis && other->normal.dot(face->normal) > 0.999 && fabs(other->planeDistance - face->planeDistance) < 0.0001 * (1.0 + fabs(face->planeDistance))) {
+					parents[findChartRoot(parents, i)] = findChartRoot(parents, others[o]);
 				}
 			}
-			
-			newLMesh->faces.push_back(newFace);
+			others.push_back(i);
+		}
+	}
+	
+	std::map<int, LightmapChart*> charts;
+	for(int i=0; i < mesh->faces.size(); i++) {
+		int root = findChartRoot(parents, i);
+		LightmapChart *chart;
+		if(charts.find(root) == charts.end()) {
+			chart = new LightmapChart;
+			chart->projectionAxis = mesh->faces[i]->projectionAxis;
+			chart->minU = chart->minV = 1e30;
+			chart->maxU = chart->maxV = -1e30;
+			chart->imageID = -1;
+			charts[root] = chart;
+			mesh->charts.push_back(chart);
+		} else {
+			chart = charts[root];
+		}
+		
+		LightmapFace *face = mesh->faces[i];
+		face->chart = chart;
+		chart->faces.push_back(face);
+		for(int k=0; k < face->meshPolygon->getVertexCount(); k++) {
+			Number u, v;
+			projectPoint(*face->meshPolygon->getVertex(k), chart->projectionAxis, &u, &v);
+			if(u < chart->minU) chart->minU = u;
+			if(v < chart->minV) chart->minV = v;
+			if(u > chart->maxU) chart->maxU = u;
+			if(v > chart->maxV) chart->maxV = v;
 		}
 	}
 }
 
-Vector3 LightmapPacker::getLumelPos(Lumel *lumel, LightmapFace *face) {
-	
-	Vector3 poly_normal = face->meshPolygon->getFaceNormal();
-	
-	Vector3 pointonplane = *face->meshPolygon->getVertex(0) ;
-//	Vector3 pointonplane = (*face->meshPolygon->getVertex(0) + *face->meshPolygon->getVertex(1) + *face->meshPolygon->getVertex(2)) / 3.0f;		
-	
-	float Distance = -(poly_normal.x * pointonplane.x + poly_normal.y * pointonplane.y + poly_normal.z * pointonplane.z);
-	
-	float X,Y,Z;
-	Vector3 UVVector, Vect1, Vect2;
-	
-	float	Min_U = face->flatUnscaledPolygon->getVertex(0)->x;
-	float   Min_V = face->flatUnscaledPolygon->getVertex(0)->y;
-	float   Max_U = face->flatUnscaledPolygon->getVertex(0)->x;
-	float   Max_V = face->flatUnscaledPolygon->getVertex(0)->y;
+void LightmapPacker::updateChartSize(LightmapChart *chart, Number scale) {
+	chart->scale = scale;
+	chart->pixelWidth = (unsigned int)ceil((chart->maxU - chart->minU) * scale) + 1 + (padding * 2);
+	chart->pixelHeight = (unsigned int)ceil((chart->maxV - chart->minV) * scale) + 1 + (padding * 2);
+}
 
-        for (int i = 0; i < 3; i++)
-        {
-            if (face->flatUnscaledPolygon->getVertex(i)->x < Min_U )
-                Min_U = face->flatUnscaledPolygon->getVertex(i)->x;
-            if (face->flatUnscaledPolygon->getVertex(i)->y < Min_V )
-                Min_V = face->flatUnscaledPolygon->getVertex(i)->y;
-            if (face->flatUnscaledPolygon->getVertex(i)->x > Max_U )
-                Max_U = face->flatUnscaledPolygon->getVertex(i)->x;
-            if (face->flatUnscaledPolygon->getVertex(i)->y > Max_V )
-                Max_V = face->flatUnscaledPolygon->getVertex(i)->y;
-        }	
+bool LightmapPacker::packCharts(LightmapMesh *mesh, RectPacker *packer) {
+	for(int i=0; i < mesh->charts.size(); i++) {
+		LightmapChart *chart = mesh->charts[i];
+		if(!packer->insert(chart->pixelWidth, chart->pixelHeight, &chart->placement))
+			return false;
+	}
+	return true;
+}
 
-	switch(face->projectionAxis) {
-		case LightmapFace::X_PROJECTION:
-			X = - ( (poly_normal.y * Min_U) + (poly_normal.z * Min_V) + Distance )
-			/ poly_normal.x;
-			UVVector.x = X;
-			UVVector.y = Min_U;
-			UVVector.z = Min_V;
-			X = - ( (poly_normal.y * Max_U) + (poly_normal.z) * Min_V + Distance )
-			/ poly_normal.x;
-			Vect1.x = X;
-			Vect1.y = Max_U;
-			Vect1.z = Min_V;
-			X = - ( (poly_normal.y * Min_U) + (poly_normal.z * Max_V) + Distance )
-			/ poly_normal.x;
-			Vect2.x = X;
-			Vect2.y = Min_U;
-			Vect2.z = Max_V;
-			break;
-		case LightmapFace::Y_PROJECTION:
-			Y = - ( poly_normal.x * Min_U + poly_normal.z * Min_V + Distance )
-			/ poly_normal.y;
-			UVVector.x = Min_U;
-			UVVector.y = Y;
-			UVVector.z = Min_V;
-			Y = - ( poly_normal.x * Max_U + poly_normal.z * Min_V + Distance )
-			/ poly_normal.y;
-			Vect1.x = Max_U;
-			Vect1.y = Y;
-			Vect1.z = Min_V;
-			Y = - ( poly_normal.x * Min_U + poly_normal.z * Max_V + Distance )
-			/ poly_normal.y;
-			Vect2.x = Min_U;
-			Vect2.y = Y;
-			Vect2.z = Max_V;		
-			break;
-		case LightmapFace::Z_PROJECTION:
-			Z = - ( poly_normal.x * Min_U + poly_normal.y * Min_V + Distance )
-			/ poly_normal.z;
-			UVVector.x = Min_U;
-			UVVector.y = Min_V;
-			UVVector.z = Z;
-			Z = - ( poly_normal.x * Max_U + poly_normal.y * Min_V + Distance )
-			/ poly_normal.z;
-			Vect1.x = Max_U;
-			Vect1.y = Min_V;
-			Vect1.z = Z;
-			Z = - ( poly_normal.x * Min_U + poly_normal.y * Max_V + Distance )
-			/ poly_normal.z;
-			Vect2.x = Min_U;
-			Vect2.y = Max_V;
-			Vect2.z = Z;
-			break;
+void LightmapPacker::chartToPage(LightmapChart *chart, Number x, Number y, Number *pageX, Number *pageY) const {
+	if(chart->placement.rotated) {
+		*pageX = chart->placement.x + y;
+		*pageY = chart->placement.y + (chart->pixelWidth - x);
+	} else {
+		*pageX = chart->placement.x + x;
+		*pageY = chart->placement.y + y;
 	}
-	
-	Vector3 edge1,edge2,newedge1,newedge2;
-	
-	edge1.x = Vect1.x - UVVector.x;
-    edge1.y = Vect1.y - UVVector.y;
-    edge1.z = Vect1.z - UVVector.z;
-    edge2.x = Vect2.x - UVVector.x;
-    edge2.y = Vect2.y - UVVector.y;
-    edge2.z = Vect2.z - UVVector.z;
-	
-	float ufactor = lumel->u/(face->area.w+(0.0f/lightMapRes));
-	float vfactor = lumel->v/(face->area.h+(0.0f/lightMapRes));
+}
 
-//	Logger::log("edge1: %f %f %f", edge1.x, edge1.y,edge1.z);
+void LightmapPacker::rasterizeFaces(LightmapChart *chart, std::vector<int> *faceIndices) const {
+	int width = chart->pixelWidth;
+	int height = chart->pixelHeight;
+	faceIndices->assign(width * height, -1);
 	
-	newedge1.x = edge1.x * ufactor;
-	newedge1.y = edge1.y * ufactor;
-	newedge1.z = edge1.z * ufactor;
-	newedge2.x = edge2.x * vfactor;
-	newedge2.y = edge2.y * vfactor;
-	newedge2.z = edge2.z * vfactor;
+	std::vector<int> filled;
+	for(int f=0; f < chart->faces.size(); f++) {
+		Polygon *poly = chart->faces[f]->meshPolygon;
 		
-	Vector3 retVec(UVVector.x + newedge2.x + newedge1.x,
-				   UVVector.y + newedge2.y + newedge1.y,
-				   UVVector.z + newedge2.z + newedge1.z);
+		Number u0, v0;
+		projectPoint(*poly->getVertex(0), chart->projectionAxis, &u0, &v0);
+		for(int k=1; k+1 < poly->getVertexCount(); k++) {
+			Number u1, v1, u2, v2;
+			projectPoint(*poly->getVertex(k), chart->projectionAxis, &u1, &v1);
+			projectPoint(*poly->getVertex(k+1), chart->projectionAxis, &u2, &v2);
+			
+			// only visit the pixels under the triangle's bounds
+			int x1 = (int)floor(((std::min(u0, std::min(u1, u2)) - chart->minU) * chart->scale) + padding);
+			int x2 = (int)ceil(((std::max(u0, std::max(u1, u2)) - chart->minU) * chart->scale) + padding);
+			int y1 = (int)floor(((std::min(v0, std::min(v1, v2)) - chart->minV) * chart->scale) + padding);
+			int y2 = (int)ceil(((std::max(v0, std::max(v1, v2)) - chart->minV) * chart->scale) + padding);
+			if(x1 < 0) x1 = 0;
+			if(y1 < 0) y1 = 0;
+			if(x2 > width - 1) x2 = width - 1;
+			if(y2 > height - 1) y2 = height - 1;
+			
+			for(int y=y1; y <= y2; y++) {
+				for(int x=x1; x <= x2; x++) {
+					// earlier faces win where faces overlap
+					if((*faceIndices)[(y * width) + x] != -1)
+						continue;
+					Number u = chart->minU + ((((Number)x) - padding) / chart->scale);
+					Number v = chart->minV + ((((Number)y) - padding) / chart->scale);
+					Number d1 = ((u1 - u0) * (v - v0)) - ((v1 - v0) * (u - u0));
+					Number d2 = ((u2 - u1) * (v - v1)) - ((v2 - v1) * (u - u1));
+					Number d3 = ((u0 - u2) * (v - v2)) - ((v0 - v2) * (u - u2));
+					if((d1 >= 0 && d2 >= 0 && d3 >= 0) || (d1 <= 0 && d2 <= 0 && d3 <= 0)) {
+						(*faceIndices)[(y * width) + x] = f;
+						filled.push_back((y * width) + x);
+					}
+				}
+			}
+		}
+	}
+	
+	// faces smaller than a lumel may not cover any pixel center, so seed them at their centers
+	for(int f=0; f < chart->faces.size(); f++) {
+		Polygon *poly = chart->faces[f]->meshPolygon;
+		Number cu = 0, cv = 0;
+		for(int k=0; k < poly->getVertexCount(); k++) {
+			Number pu, pv;
+			projectPoint(*poly->getVertex(k), chart->projectionAxis, &pu, &pv);
+			cu += pu;
+			cv += pv;
+		}
+		int x = (int)floor((((cu / poly->getVertexCount()) - chart->minU) * chart->scale) + padding + 0.5);
+		int y = (int)floor((((cv / poly->getVertexCount()) - chart->minV) * chart->scale) + padding + 0.5);
+		x = std::max(0, std::min(width - 1, x));
+		y = std::max(0, std::min(height - 1, y));
+		if((*faceIndices)[(y * width) + x] == -1) {
+			(*faceIndices)[(y * width) + x] = f;
+			filled.push_back((y * width) + x);
+		}
+	}
 	
-	return retVec;
+	// padding lumels take the face of the nearest covered lumel
+	for(int i=0; i < filled.size(); i++) {
+		int x = filled[i] % width;
+		int y = filled[i] / width;
+		int face = (*faceIndices)[filled[i]];
+		int neighbours[4][2] = {{x-1, y}, {x+1, y}, {x, y-1}, {x, y+1}};
+		for(int n=0; n < 4; n++) {
+			int nx = neighbours[n][0];
+			int ny = neighbours[n][1];
+			if(nx < 0 || ny < 0 || nx >= width || ny >= height || (*faceIndices)[(ny * width) + nx] != -1)
+				continue;
+			(*faceIndices)[(ny * width) + nx] = face;
+			filled.push_back((ny * width) + nx);
+		}
+	}
 }
 
-void LightmapPacker::packMesh(LightmapMesh *mesh) {
-	Color col;
-	mesh->imageID = currentImageID;
-	mesh->mesh->lightmapIndex = currentImageID;
-	for(int n=0; n < mesh->faces.size(); n++) {
-		PackNode *pNode = cNode->Insert(mesh->faces[n]);
-		if(pNode != NULL) {
-			col.Random();
-			currentImage->drawRect(pNode->rc.x-1, pNode->rc.y-1, pNode->rc.w+2, pNode->rc.h+2, col);
-			pNode->face = mesh->faces[n];
-			for(int i=0; i < mesh->faces[n]->flatPolygon->getVertexCount(); i++) {
-				Vertex *vert = mesh->faces[n]->flatPolygon->getVertex(i);				
-				vert->x += (pNode->rc.x/lightMapRes);//-(1.0f/lightMapRes);
-				vert->y += (pNode->rc.y/lightMapRes);//-(1.0f/lightMapRes);
-				mesh->faces[n]->meshPolygon->addTexCoord2(vert->x,vert->y);
-				mesh->mesh->getMesh()->numUVs = 2;
-			}
+void LightmapPacker::createLumels(LightmapMesh *mesh, LightmapChart *chart) {
+	Matrix4 meshMatrix = mesh->mesh->getConcatenatedMatrix();
+	
+	for(int f=0; f < chart->faces.size(); f++) {
+		LightmapFace *face = chart->faces[f];
+		face->imageID = chart->imageID;
+		face->lightmapCoords.clear();
+		for(int k=0; k < face->meshPolygon->getVertexCount(); k++) {
+			Number u, v, pageX, pageY;
+			projectPoint(*face->meshPolygon->getVertex(k), chart->projectionAxis, &u, &v);
+			chartToPage(chart, ((u - chart->minU) * chart->scale) + padding + 0.5, ((v - chart->minV) * chart->scale) + padding + 0.5, &pageX, &pageY);
+			face->lightmapCoords.push_back(Vector2(pageX / lightMapRes, pageY / lightMapRes));
+		}
+	}
+	
+	std::vector<int> faceIndices;
+	rasterizeFaces(chart, &faceIndices);
+	
+	for(unsigned int x=0; x < chart->pixelWidth; x++) {
+		for(unsigned int y=0; y < chart->pixelHeight; y++) {
+			Number u = chart->minU + ((((Number)x) - padding) / chart->scale);
+			Number v = chart->minV + ((((Number)y) - padding) / chart->scale);
+			LightmapFace *face = chart->faces[faceIndices[(y * chart->pixelWidth) + x]];
 			
-			for(int nl = 0; nl < mesh->faces[n]->numLumels; nl++) {
-				mesh->faces[n]->lumels[nl]->worldPos = mesh->mesh->getConcatenatedMatrix() * getLumelPos(mesh->faces[n]->lumels[nl], mesh->faces[n]);
-				mesh->faces[n]->lumels[nl]->u += (pNode->rc.x/lightMapRes);
-				mesh->faces[n]->lumels[nl]->v += (pNode->rc.y/lightMapRes);				
-			}
+			Number pageX, pageY;
+			chartToPage(chart, x + 0.5, y + 0.5, &pageX, &pageY);
 			
-			mesh->faces[n]->imageID = currentImageID;
-			mesh->faces[n]->pixelArea.x = pNode->rc.x;
-			mesh->faces[n]->pixelArea.y = pNode->rc.y;
-		} else {
-			Logger::log("WARNING MESH DOES NOT FIT! %d of %d completed \n", n, mesh->faces.size());
-			return;
-			//generateNewImage();
+			Lumel *newLumel = new Lumel;
+			newLumel->face = face;
+			newLumel->lumelScale = 1.0f;
+			newLumel->u = pageX / lightMapRes;
+			newLumel->v = pageY / lightMapRes;
+			newLumel->normal = face->normal;
+			newLumel->worldPos = meshMatrix * unprojectPoint(face, u, v);
+			face->lumels.push_back(newLumel);
+			face->numLumels++;
+			lumels.push_back(newLumel);
 		}
-	}	
+	}
 }
 
-void LightmapPacker::generateNewImage() {
-	cNode = new PackNode();
-	cNode->createRoot(lightMapRes);
-	currentImage = new Image(lightMapRes,lightMapRes);
-	currentImage->fill(0,0,0,1);
-	images.push_back(currentImage);
-	currentImageID++;
+void LightmapPacker::placeMesh(LightmapMesh *mesh, int imageID) {
+	mesh->imageID = imageID;
+	mesh->mesh->lightmapIndex = imageID;
+	for(int i=0; i < mesh->charts.size(); i++) {
+		mesh->charts[i]->imageID = imageID;
+		createLumels(mesh, mesh->charts[i]);
+	}
 }
 
-bool LightmapPacker::hasRoomForMesh(LightmapMesh *mesh) {
-	PackNode *copyNode = cNode->clone();
-	for(int n=0; n < mesh->faces.size(); n++) {
-		PackNode *pNode = copyNode->Insert(mesh->faces[n]);
-		if(pNode != NULL) {
-			pNode->face = mesh->faces[n];
-		} else {
-			delete copyNode;
-			return false;
-		} 
-	}	
-	delete copyNode;
-	return true;
+static Number getMeshChartArea(LightmapMesh *mesh) {
+	Number area = 0;
+	for(int i=0; i < mesh->charts.size(); i++) {
+		area += (mesh->charts[i]->maxU - mesh->charts[i]->minU) * (mesh->charts[i]->maxV - mesh->charts[i]->minV);
+	}
+	return area;
+}
+
+static bool compareMeshArea(LightmapMesh *a, LightmapMesh *b) {
+	return getMeshChartArea(a) > getMeshChartArea(b);
 }
 
 void LightmapPacker::buildTextures() {
-	generateNewImage();
-	
-	// TODO: sort meshes by size
+	vector<LightmapMesh*> sortedMeshes = lightmapMeshes;
+	std::stable_sort(sortedMeshes.begin(), sortedMeshes.end(), compareMeshArea);
 	
-	for(int m=0; m < lightmapMeshes.size(); m++) {
-		if(hasRoomForMesh(lightmapMeshes[m])) {
-			Logger::log("packing mesh %d\n", m);
-			packMesh(lightmapMeshes[m]);
-		} else {
-			Logger::log("mesh %d doesnt fit, generating new image and packing\n", m);
-			generateNewImage();
-			packMesh(lightmapMeshes[m]);
+	for(int m=0; m < sortedMeshes.size(); m++) {
+		LightmapMesh *mesh = sortedMeshes[m];
+		if(mesh->charts.size() == 0)
+			continue;
+		
+		Number scale = lightMapQuality;
+		int imageID = -1;
+		while(imageID < 0) {
+			for(int i=0; i < mesh->charts.size(); i++) {
+				updateChartSize(mesh->charts[i], scale);
+			}
+			std::stable_sort(mesh->charts.begin(), mesh->charts.end(), compareChartArea);
+			
+			// first page the whole mesh fits on
+			for(int p=0; p < pagePackers.size(); p++) {
+				RectPacker packer = *pagePackers[p];
+				if(packCharts(mesh, &packer)) {
+					*pagePackers[p] = packer;
+					imageID = p;
+					break;
+				}
+			}
+			
+			if(imageID < 0) {
+				RectPacker *packer = new RectPacker(lightMapRes, lightMapRes, allowRotation);
+				if(packCharts(mesh, packer)) {
+					pagePackers.push_back(packer);
+					Image *newImage = new Image(lightMapRes,lightMapRes);
+					newImage->fill(0,0,0,1);
+					images.push_back(newImage);
+					imageID = pagePackers.size() - 1;
+				} else {
+					delete packer;
+					if(scale < 0.0001) {
+						Logger::log("mesh %d does not fit on a lightmap page\n", m);
+						break;
+					}
+					scale *= 0.9;
+					Logger::log("mesh %d does not fit on a lightmap page, reducing its lightmap scale to %f\n", m, scale);
+				}
+			}
 		}
+		
+		if(imageID >= 0)
+			placeMesh(mesh, imageID);
 	}
+	
+	Logger::log("packed %d meshes into %d lightmap pages, %d%% used\n", lightmapMeshes.size(), images.size(), (int)(getUtilization() * 100));
 }
 
 void LightmapPacker::generateTextures(int resolution, int quality) {
@@ -340,17 +466,6 @@ void LightmapPacker::bindTextures() {
 			targetScene->getStaticGeometry(i)->getLocalShaderOptions()->addTexture("diffuse2", textures[targetScene->getStaticGeometry(i)->lightmapIndex]);
 		}
 	}
-	
-
-/* old way
-	for(int i=0; i < lightmapMeshes.size(); i++) {
-		Material *meshMaterial = lightmapMeshes[i]->mesh->getMaterial();
-		if(meshMaterial) {
-			lightmapMeshes[i]->mesh->getLocalShaderOptions()->addTexture("diffuse2", textures[lightmapMeshes[i]->imageID]);
-		}
-	}
-*/
-
 }
 
 void LightmapPacker::saveLightmaps(string folder) {
@@ -360,64 +475,3 @@ void LightmapPacker::saveLightmaps(string folder) {
 		images[i]->writeBMP(fileName.str());
 	}
 }
-
-void PackNode::createRoot(int res) {
-	rc.w = res-4;
-	rc.h = res-4;
-	rootRes = res-4;
-	rc.x = 1;
-	rc.y = 1;
-	
-}
-
-PackNode *PackNode::clone() {
-	PackNode *cloneNode = new PackNode();
-	cloneNode->rc.x = rc.x;
-	cloneNode->rc.y  = rc.y;
-	cloneNode->rc.w = rc.w;
-	cloneNode->rc.h  = rc.h;
-	
-	cloneNode->face = face;
-	if(child[0]) {
-		cloneNode->child[0] = child[0]->clone();
-	}
-	if(child[1]) {
-		cloneNode->child[1] = child[1]->clone();
-	}	
-	return cloneNode;
-}
-
-PackNode *PackNode::Insert(LightmapFace *img) {
-	PackNode *newNode;	
-	if(child[0]) {
-		newNode = child[0]->Insert(img);
-        if(newNode != NULL)
-			return newNode;
-        return child[1]->Insert(img);
-	} else {
-		if(face != NULL)
-			return NULL;
-		
-        //(if we're too small, return)
-		if(img->pixelArea.w > rc.w || img->pixelArea.h > rc.h)
-            return NULL;
-		
-        if(img->pixelArea.w == rc.w && img->pixelArea.h == rc.h)
-            return this;
-        
-        child[0] = new PackNode();
-        child[1] = new PackNode();
-        
-		float dw = rc.w - img->pixelArea.w;
-		float dh = rc.h - img->pixelArea.h;
-        
-        if(dw > dh) {
-            child[0]->rc = Rectangle(rc.x, rc.y, img->pixelArea.w, rc.h);
-            child[1]->rc = Rectangle(rc.x+img->pixelArea.w+4, rc.y, rc.w-img->pixelArea.w-3, rc.h);
-        } else {
-            child[0]->rc = Rectangle(rc.x, rc.y, rc.w, img->pixelArea.h);
-            child[1]->rc = Rectangle(rc.x, rc.y+img->pixelArea.h+4, rc.w, rc.h-img->pixelArea.h-3);
-        }
-        return child[0]->Insert(img);	
-	}
-}
\ No newline at end of file
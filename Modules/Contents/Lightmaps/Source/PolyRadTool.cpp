@@ -1,228 +1,577 @@
 /*
- *  PolyRadTool.cpp
- *  Poly
- *
- *  Created by Ivan Safrin on 9/25/08.
- *  Copyright 2008 __MyCompanyName__. All rights reserved.
- *
- */
+Copyright (C) 2011 by Ivan Safrin
 
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+ 
 
 #include "PolyRadTool.h"
+#include "PolyLightmapBVH.h"
+#include "PolyLightmapPacker.h"
+#include "PolyCore.h"
+#include "PolyCoreServices.h"
+#include "PolyEvent.h"
+#include "PolyImage.h"
+#include "PolyLogger.h"
+#include "PolyPolygon.h"
+#include "PolyScene.h"
+#include "PolySceneLight.h"
+#include "PolySceneMesh.h"
+#include "PolyVertex.h"
+#include "OSBasics.h"
+#include <math.h>
+
+#ifdef _WINDOWS
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
 
 using namespace Polycode;
 
-RadTool::RadTool(GenericScene *scene, LightmapPacker *packer) {
-	this->scene = scene;
-	this->packer = packer;
+static void radToolSleep(unsigned int milliseconds) {
+#ifdef _WINDOWS
+	Sleep(milliseconds);
+#else
+	usleep(milliseconds * 1000);
+#endif
 }
 
-void RadTool::fiatLux(int radPasses) {
-
-	Vector3 baseAmbient(0.033f, 0.033f, 0.033f);
-	
-	Color col;	
-	for(int i=0; i < packer->lumels.size(); i++) {
-		packer->lumels[i]->rEnergy.set(baseAmbient.x, baseAmbient.y, baseAmbient.z);
-		packer->images[packer->lumels[i]->face->imageID]->setPixel(packer->lumels[i]->u*packer->lightMapRes, packer->lumels[i]->v*packer->lightMapRes, Color(baseAmbient.x, baseAmbient.y, baseAmbient.z, 1.0f));		
+static void hashBytes(unsigned int *hash, const void *data, unsigned int size) {
+	const unsigned char *bytes = (const unsigned char*)data;
+	for(unsigned int i=0; i < size; i++) {
+		*hash ^= bytes[i];
+		*hash *= 16777619;
 	}
+}
 
-//	applyLight(scene->getLight(1));
-	for(int i =0; i < scene->getNumLights(); i++) {
-		applyLight(scene->getLight(i));
-	}
+static void hashNumber(unsigned int *hash, Number value) {
+	float f = value;
+	hashBytes(hash, &f, sizeof(float));
+}
 
-	for(int i=0; i < radPasses; i++) {
-		Logger::log("doing radiosity pass %d\n", i);
-		doRadiosityPass();
-	}
-	
+static void hashVector(unsigned int *hash, const Vector3 &v) {
+	hashNumber(hash, v.x);
+	hashNumber(hash, v.y);
+	hashNumber(hash, v.z);
 }
 
-void RadTool::doRadiosityPass() {
-	for(int i=0; i < packer->lumels.size(); i+=1) {
-		radLumel(packer->lumels[i], packer->images[packer->lumels[i]->face->imageID]);
-	}
+static Number randomNumber(unsigned int *state) {
+	*state ^= *state << 13;
+	*state ^= *state >> 17;
+	*state ^= *state << 5;
+	return (*state & 0xFFFFFF) / (Number)0x1000000;
+}
+
+RadToolWorker::RadToolWorker(RadTool *tool) : Threaded(), threadFinished(false), tool(tool) {
 }
 
-void RadTool::applyLight(SceneLight *light) {
-	for(int i=0; i < packer->lumels.size(); i++) {
-		lightLumel(light, packer->images[packer->lumels[i]->face->imageID], packer->lumels[i]);
+void RadToolWorker::runThread() {
+	while(threadRunning) {
+		updateThread();
 	}
+	threadFinished = true;
 }
 
-bool RadTool::rayTriangleIntersect(Vector3 ray_origin, Vector3 ray_direction, Vector3 vert0, Vector3 vert1, Vector3 vert2, Vector3 *hitPoint)
-{
-	float t,u,v;
-	 t = 0; u = 0; v = 0;
-	 
-	 Vector3 edge1 = vert1 - vert0;
-	 Vector3 edge2 = vert2 - vert0;
-	 
-	 Vector3 tvec, pvec, qvec;
-	 float det, inv_det;
-	 
-	 
-	 pvec = ray_direction.crossProduct(edge2);
-	 det = edge1.dot(pvec);
-	 
-	 if (det > -0.00001f)
-		return false;
-	 
-	 inv_det = 1.0f / det;
-	 
-	 tvec = ray_origin - vert0;
-
-//	 hitPoint = tvec;
-	 
-	 u = tvec.dot(pvec) * inv_det;
-	 if (u < -0.001f || u > 1.001f)
-		return false;
-	 
-	 qvec = tvec.crossProduct(edge1);
-	 
-	 v = ray_direction.dot(qvec) * inv_det;
-	 if (v < -0.001f || u + v > 1.001f)
-		return false;
-	 
-	 t = edge2.dot(qvec) * inv_det;
-	 
-	 if (t <= 0)
-		return false;
+void RadToolWorker::updateThread() {
+	if(!tool->processBatch())
+		radToolSleep(1);
+}
+
+RadTool::RadTool(Scene *scene, LightmapPacker *packer) : EventDispatcher() {
+	this->scene = scene;
+	this->packer = packer;
+	bvh = new LightmapBVH();
+	numThreads = 4;
+	numBounceSamples = 64;
+	bounceReflectance = 0.5;
+	ambientColor = Vector3(0.033, 0.033, 0.033);
+	rayBias = 0.01;
+	numBakedMeshes = 0;
+	currentPass = 0;
+	nextPending = 0;
+	finishedPending = 0;
+	totalPasses = 1;
+	progress = 0;
+	workMutex = CoreServices::getInstance()->getCore()->createMutex();
+}
 
-	hitPoint->x = ray_origin.x+t*ray_direction.x;
-	hitPoint->y = ray_origin.y+t*ray_direction.y;
-	hitPoint->z = ray_origin.z+t*ray_direction.z;	
+RadTool::~RadTool() {
+	delete bvh;
+	delete workMutex;
+}
 
-	 
-	 return true;
+void RadTool::setNumThreads(int numThreads) {
+	this->numThreads = numThreads;
+}
 
+void RadTool::setNumBounceSamples(int numSamples) {
+	numBounceSamples = numSamples;
 }
 
+void RadTool::setBounceReflectance(Number reflectance) {
+	bounceReflectance = reflectance;
+}
 
-bool RadTool::worldRayTest(Vector3 origin, Vector3 destination,Poly::Polygon *hitPolygon) {
-	Vector3 hitPoint,dirVec;
-	dirVec = destination-origin;
-	
-	for(int i= 0; i < packer->lightmapMeshes.size(); i++) {
-		Matrix4 meshMatrix = packer->lightmapMeshes[i]->mesh->getConcatenatedMatrix();
-		for(int j=0; j < packer->lightmapMeshes[i]->faces.size(); j++) {
-			if(rayTriangleIntersect(origin, dirVec,
-				meshMatrix*(*packer->lightmapMeshes[i]->faces[j]->meshPolygon->getVertex(0)),
-				meshMatrix*(*packer->lightmapMeshes[i]->faces[j]->meshPolygon->getVertex(1)),
-				meshMatrix*(*packer->lightmapMeshes[i]->faces[j]->meshPolygon->getVertex(2)),
-				&hitPoint)) {
-					float dist =  hitPoint.distance(origin);
-					if(dist < destination.distance(origin) && dist > 1.3f) {
-						hitPolygon = packer->lightmapMeshes[i]->faces[j]->meshPolygon;
-						return true;
-					}
-			}
-		}
+void RadTool::setAmbientColor(Number r, Number g, Number b) {
+	ambientColor = Vector3(r, g, b);
+}
+
+void RadTool::setRayBias(Number bias) {
+	rayBias = bias;
+}
+
+Number RadTool::getProgress() const {
+	return progress;
+}
+
+unsigned int RadTool::getNumBakedMeshes() const {
+	return numBakedMeshes;
+}
+
+void RadTool::clearBakeCache() {
+	bakeCache.clear();
+}
+
+void RadTool::collectLights() {
+	lights.clear();
+	for(int i=0; i < scene->getNumLights(); i++) {
+		SceneLight *light = scene->getLight(i);
+		Matrix4 lightMatrix = light->getConcatenatedMatrix();
 		
+		BakeLight bakeLight;
+		bakeLight.position = lightMatrix.getPosition();
+		bakeLight.direction = lightMatrix.rotateVector(Vector3(0,0,-1));
+		bakeLight.direction.Normalize();
+		bakeLight.color = Vector3(light->lightColor.r, light->lightColor.g, light->lightColor.b);
+		bakeLight.intensity = light->getIntensity();
+		bakeLight.constantAttenuation = light->getConstantAttenuation();
+		bakeLight.linearAttenuation = light->getLinearAttenuation();
+		bakeLight.quadraticAttenuation = light->getQuadraticAttenuation();
+		bakeLight.spot = (light->getType() == SceneLight::SPOT_LIGHT);
+		bakeLight.spotCosCutoff = cos(light->getSpotlightCutoff() * (PI/180.0));
+		lights.push_back(bakeLight);
 	}
-	return false;
 }
 
+unsigned int RadTool::getMeshKey(LightmapMesh *mesh, unsigned int sceneKey, int radPasses) {
+	unsigned int hash = sceneKey;
+	hashBytes(&hash, &radPasses, sizeof(int));
+	
+	Matrix4 meshMatrix = mesh->mesh->getConcatenatedMatrix();
+	for(int f=0; f < mesh->faces.size(); f++) {
+		LightmapFace *face = mesh->faces[f];
+		hashBytes(&hash, &face->numLumels, sizeof(int));
+		for(int v=0; v < face->meshPolygon->getVertexCount(); v++) {
+			hashVector(&hash, meshMatrix * (*face->meshPolygon->getVertex(v)));
+		}
+	}
+	return hash;
+}
 
-void RadTool::radLumel(Lumel *lumel, Image *image) {
-	Lumel *lumel2;
-	float numSeen = 0;
-	float totalVal_r = 0;
-	float totalVal_g = 0;
-	float totalVal_b = 0;
+void RadTool::collectLumels(int radPasses) {
+	lumels.clear();
+	lumelNormals.clear();
+	lumelFaces.clear();
+	directEnergy.clear();
+	energy.clear();
+	pendingLumels.clear();
+	faceIndices.clear();
+	faceFirstLumel.clear();
+	faceNumLumels.clear();
+	meshKeys.clear();
+	meshFirstLumel.clear();
+	meshNumLumels.clear();
+	meshBaked.clear();
+	numBakedMeshes = 0;
+	
+	unsigned int sceneKey = 2166136261u;
+	for(int i=0; i < lights.size(); i++) {
+		hashVector(&sceneKey, lights[i].position);
+		hashVector(&sceneKey, lights[i].direction);
+		hashVector(&sceneKey, lights[i].color);
+		hashNumber(&sceneKey, lights[i].intensity);
+		hashNumber(&sceneKey, lights[i].constantAttenuation);
+		hashNumber(&sceneKey, lights[i].linearAttenuation);
+		hashNumber(&sceneKey, lights[i].quadraticAttenuation);
+		hashNumber(&sceneKey, lights[i].spot ? lights[i].spotCosCutoff : 2.0);
+	}
+	hashVector(&sceneKey, ambientColor);
+	hashNumber(&sceneKey, bounceReflectance);
+	hashNumber(&sceneKey, rayBias);
+	hashBytes(&sceneKey, &numBounceSamples, sizeof(int));
 	
-	for(int i=0; i < packer->lumels.size(); i+=1000) {
-		lumel2 = packer->lumels[i];
-	//	if(!worldRayTest(lumel->worldPos, lumel2->worldPos, hitPoly)) {		
-			float dist = lumel2->worldPos.distance(lumel->worldPos);
-			Vector3 lightVector = lumel2->worldPos-lumel->worldPos;
-			lightVector.Normalize();
-			float diffuse = lumel->normal.dot(lightVector);
-			float pwr = 1.3f; 
-			float val = 1.0f - (dist/45.0f);
-			val = val * pwr * diffuse * lumel2->lumelScale;
-			totalVal_r += lumel2->rEnergy.x * val;
-			totalVal_g += lumel2->rEnergy.y * val;
-			totalVal_b += lumel2->rEnergy.z * val;			
-			numSeen++;
-	//	}
+	// every mesh can shadow or reflect light onto every other one, so the occluding
+	// geometry is part of each mesh's key and moving any of it rebakes them all
+	for(int m=0; m < packer->lightmapMeshes.size(); m++) {
+		LightmapMesh *mesh = packer->lightmapMeshes[m];
+		Matrix4 meshMatrix = mesh->mesh->getConcatenatedMatrix();
+		for(int f=0; f < mesh->faces.size(); f++) {
+			LightmapFace *face = mesh->faces[f];
+			if(face->imageID < 0)
+				continue;
+			for(int v=0; v < face->meshPolygon->getVertexCount(); v++) {
+				hashVector(&sceneKey, meshMatrix * (*face->meshPolygon->getVertex(v)));
+			}
+		}
 	}
 	
-	totalVal_r = totalVal_r / numSeen;
-	totalVal_g = totalVal_g / numSeen;
-	totalVal_b = totalVal_b / numSeen;
+	for(int m=0; m < packer->lightmapMeshes.size(); m++) {
+		LightmapMesh *mesh = packer->lightmapMeshes[m];
+		Matrix4 meshMatrix = mesh->mesh->getConcatenatedMatrix();
 		
-	if(totalVal_r < 0)
-		totalVal_r = 0;
-	if(totalVal_g < 0)
-		totalVal_g = 0;
-	if(totalVal_b < 0)
-		totalVal_b = 0;
+		meshFirstLumel.push_back(lumels.size());
+		for(int f=0; f < mesh->faces.size(); f++) {
+			LightmapFace *face = mesh->faces[f];
+			if(face->imageID < 0)
+				continue;
+			
+			int faceIndex = faceFirstLumel.size();
+			faceIndices[face] = faceIndex;
+			faceFirstLumel.push_back(lumels.size());
+			faceNumLumels.push_back(face->lumels.size());
+			
+			Vector3 normal = meshMatrix.rotateVector(face->meshPolygon->getFaceNormal());
+			normal.Normalize();
+			for(int l=0; l < face->lumels.size(); l++) {
+				lumels.push_back(face->lumels[l]);
+				lumelNormals.push_back(normal);
+				lumelFaces.push_back(faceIndex);
+			}
+		}
+		meshNumLumels.push_back(lumels.size() - meshFirstLumel[m]);
+		meshKeys.push_back(getMeshKey(mesh, sceneKey, radPasses));
+	}
+	
+	directEnergy.resize(lumels.size(), ambientColor);
+	energy.resize(lumels.size(), ambientColor);
 	
-	Color col;
-	lumel->rEnergy.x += totalVal_r;
-	lumel->rEnergy.y += totalVal_g;
-	lumel->rEnergy.z += totalVal_b;
+	for(int m=0; m < meshKeys.size(); m++) {
+		std::map<unsigned int, CacheEntry>::iterator it = bakeCache.find(meshKeys[m]);
+		if(it != bakeCache.end() && it->second.energy.size() == meshNumLumels[m]) {
+			for(unsigned int i=0; i < meshNumLumels[m]; i++) {
+				directEnergy[meshFirstLumel[m] + i] = it->second.directEnergy[i];
+				energy[meshFirstLumel[m] + i] = it->second.energy[i];
+			}
+			meshBaked.push_back(false);
+		} else {
+			for(unsigned int i=0; i < meshNumLumels[m]; i++) {
+				pendingLumels.push_back(meshFirstLumel[m] + i);
+			}
+			meshBaked.push_back(true);
+			numBakedMeshes++;
+		}
+	}
+}
+
+bool RadTool::processBatch() {
+	Core *core = CoreServices::getInstance()->getCore();
 	
-	if(lumel->rEnergy.x > 1.0f)
-		lumel->rEnergy.x = 1.0f;
-	if(lumel->rEnergy.y > 1.0f)
-		lumel->rEnergy.y = 1.0f;
-	if(lumel->rEnergy.z > 1.0f)
-		lumel->rEnergy.z = 1.0f;
+	core->lockMutex(workMutex);
+	if(nextPending >= pendingLumels.size()) {
+		core->unlockMutex(workMutex);
+		return false;
+	}
+	unsigned int start = nextPending;
+	unsigned int end = start + BATCH_SIZE;
+	if(end > pendingLumels.size())
+		end = pendingLumels.size();
+	nextPending = end;
+	int pass = currentPass;
+	core->unlockMutex(workMutex);
 	
+	if(pass == 0)
+		bakeDirect(start, end);
+	else
+		bakeBounce(start, end);
 	
-	col.setColor(lumel->rEnergy.x,lumel->rEnergy.y,lumel->rEnergy.z,1.0f);
-	image->setPixel(lumel->u*packer->lightMapRes, lumel->v*packer->lightMapRes, col);
-				
+	core->lockMutex(workMutex);
+	finishedPending += end - start;
+	core->unlockMutex(workMutex);
+	return true;
 }
 
-void RadTool::lightLumel(SceneLight *light, Image *image, Lumel *lumel) {
-	
-	float dist = light->getPosition()->distance(lumel->worldPos);
+void RadTool::bakeDirect(unsigned int start, unsigned int end) {
+	LightmapRayPacket packet;
+	Vector3 contribution[LightmapRayPacket::PACKET_SIZE];
+	bool occluded[LightmapRayPacket::PACKET_SIZE];
 	
-	Vector3 lightVector = (*light->getPosition())-lumel->worldPos;
-	lightVector.Normalize();
-	float diffuse = lumel->normal.dot(lightVector);
-	//float diffuse = 1;
-	Polygon *hitPoly;
+	for(unsigned int p=start; p < end; p += LightmapRayPacket::PACKET_SIZE) {
+		packet.numRays = end - p;
+		if(packet.numRays > LightmapRayPacket::PACKET_SIZE)
+			packet.numRays = LightmapRayPacket::PACKET_SIZE;
+		
+		Vector3 total[LightmapRayPacket::PACKET_SIZE];
+		for(int i=0; i < packet.numRays; i++) {
+			total[i] = ambientColor;
+		}
+		
+		for(int l=0; l < lights.size(); l++) {
+			const BakeLight &light = lights[l];
+			for(int i=0; i < packet.numRays; i++) {
+				unsigned int index = pendingLumels[p + i];
+				Vector3 origin = lumels[index]->worldPos + (lumelNormals[index] * rayBias);
+				Vector3 lightVector = light.position - origin;
+				Number distance = lightVector.length();
+				if(distance > 0)
+					lightVector = lightVector / distance;
+				
+				contribution[i] = Vector3(0,0,0);
+				Number diffuse = lumelNormals[index].dot(lightVector);
+				if(diffuse > 0 && (!light.spot || light.direction.dot(lightVector * -1) >= light.spotCosCutoff)) {
+					Number attenuation = light.constantAttenuation + (light.linearAttenuation * distance) + (light.quadraticAttenuation * distance * distance);
+					Number val = light.intensity * diffuse;
+					if(attenuation > 0)
+						val = val / attenuation;
+					contribution[i] = light.color * val;
+				}
+				
+				// rays of lumels facing away are kept in the packet but cut short
+				packet.setRay(i, origin, lightVector, (diffuse > 0) ? distance : 0);
+			}
+			
+			bvh->occludedPacket(packet, occluded);
+			for(int i=0; i < packet.numRays; i++) {
+				if(!occluded[i])
+					total[i] = total[i] + contribution[i];
+			}
+		}
+		
+		for(int i=0; i < packet.numRays; i++) {
+			unsigned int index = pendingLumels[p + i];
+			directEnergy[index] = total[i];
+			energy[index] = total[i];
+		}
+	}
+}
 
+void RadTool::bakeBounce(unsigned int start, unsigned int end) {
+	LightmapRayPacket packet;
+	LightmapRayHit hits[LightmapRayPacket::PACKET_SIZE];
+	
+	for(unsigned int p=start; p < end; p++) {
+		unsigned int index = pendingLumels[p];
+		Vector3 normal = lumelNormals[index];
+		Vector3 origin = lumels[index]->worldPos + (normal * rayBias);
+		
+		Vector3 tangent;
+		if(fabs(normal.x) > 0.9)
+			tangent = Vector3(0,1,0).crossProduct(normal);
+		else
+			tangent = Vector3(1,0,0).crossProduct(normal);
+		tangent.Normalize();
+		Vector3 bitangent = normal.crossProduct(tangent);
+		
+		// seeded per lumel and pass so the result does not depend on thread scheduling
+		unsigned int seed = (index * 9781) + (currentPass * 6271) + 1;
+		
+		Vector3 gathered(0,0,0);
+		int numSamples = 0;
+		while(numSamples < numBounceSamples) {
+			packet.numRays = numBounceSamples - numSamples;
+			if(packet.numRays > LightmapRayPacket::PACKET_SIZE)
+				packet.numRays = LightmapRayPacket::PACKET_SIZE;
+			
+			for(int i=0; i < packet.numRays; i++) {
+				// cosine weighted direction on the hemisphere
+				Number phi = 2.0 * PI * randomNumber(&seed);
+				Number r2 = randomNumber(&seed);
+				Number r = sqrt(r2);
+				Vector3 direction = (tangent * (r * cos(phi))) + (bitangent * (r * sin(phi))) + (normal * sqrt(1.0 - r2));
+				packet.setRay(i, origin, direction, 1e30);
+			}
+			
+			bvh->intersectPacket(packet, hits);
+			for(int i=0; i < packet.numRays; i++) {
+				if(hits[i].face) {
+					std::map<LightmapFace*, int>::const_iterator it = faceIndices.find(hits[i].face);
+					if(it != faceIndices.end())
+						gathered = gathered + faceExitance[it->second];
+				}
+			}
+			numSamples += packet.numRays;
+		}
+		
+		if(numSamples > 0)
+			gathered = gathered * (bounceReflectance / numSamples);
+		energy[index] = directEnergy[index] + gathered;
+	}
+}
 
-	if(worldRayTest(lumel->worldPos, *light->getPosition(), hitPoly))
-		return;
+void RadTool::updateFaceExitance() {
+	faceExitance.resize(faceFirstLumel.size());
+	for(int f=0; f < faceFirstLumel.size(); f++) {
+		Vector3 total(0,0,0);
+		for(unsigned int l=0; l < faceNumLumels[f]; l++) {
+			total = total + energy[faceFirstLumel[f] + l];
+		}
+		if(faceNumLumels[f] > 0)
+			total = total / (Number)faceNumLumels[f];
+		faceExitance[f] = total;
+	}
+}
 
-	float val = ((light->getDistance()) /(dist*dist));
-	if(val > 1.0f)
-		val = 1.0f;
+void RadTool::runPass(int pass) {
+	Core *core = CoreServices::getInstance()->getCore();
+	
+	if(pass > 0)
+		updateFaceExitance();
+	
+	core->lockMutex(workMutex);
+	currentPass = pass;
+	nextPending = 0;
+	finishedPending = 0;
+	core->unlockMutex(workMutex);
+	
+	// the calling thread works on batches too and reports progress in between
+	Number lastReported = progress;
+	while(finishedPending < pendingLumels.size()) {
+		if(!processBatch())
+			radToolSleep(1);
 		
-	float pwr = light->getIntensity();
+		progress = (pass + ((Number)finishedPending / pendingLumels.size())) / totalPasses;
+		if(progress - lastReported >= 0.01) {
+			if((int)(progress * 10) != (int)(lastReported * 10))
+				Logger::log("Baking lightmaps: %d%%\n", (int)(progress * 100));
+			lastReported = progress;
+			dispatchEvent(new Event(), Event::CHANGE_EVENT);
+		}
+	}
+}
 
-	val = val * pwr * diffuse;
-	if(val < 0)
-		val = 0;
+void RadTool::writeLumels() {
+	for(unsigned int i=0; i < lumels.size(); i++) {
+		Vector3 e = energy[i];
+		if(e.x > 1.0) e.x = 1.0;
+		if(e.y > 1.0) e.y = 1.0;
+		if(e.z > 1.0) e.z = 1.0;
+		lumels[i]->rEnergy = e;
 		
-	Color col;
-	
-	lumel->rEnergy.x += light->lightColor.r*val;
-	lumel->rEnergy.y += light->lightColor.g*val;
-	lumel->rEnergy.z += light->lightColor.b*val;
-	
-	if(lumel->rEnergy.x > 1.0f)
-		lumel->rEnergy.x = 1.0f;
-	if(lumel->rEnergy.y > 1.0f)
-		lumel->rEnergy.y = 1.0f;
-	if(lumel->rEnergy.z > 1.0f)
-		lumel->rEnergy.z = 1.0f;
+		Image *image = packer->images[lumels[i]->face->imageID];
+		image->setPixel(lumels[i]->u*packer->lightMapRes, lumels[i]->v*packer->lightMapRes, Color(e.x, e.y, e.z, 1.0));
+	}
+}
 
+void RadTool::fiatLux(int radPasses) {
+	progress = 0;
+	collectLights();
+	collectLumels(radPasses);
+	bvh->build(packer->lightmapMeshes);
 	
-	//lumel->rEnergy.Normalize();
+	Logger::log("Baking lightmaps: %d of %d meshes, %d lumels\n", numBakedMeshes, meshKeys.size(), pendingLumels.size());
 	
-	col.setColor(lumel->rEnergy.x,lumel->rEnergy.y,lumel->rEnergy.z,1.0f);
+	if(pendingLumels.size() > 0) {
+		Core *core = CoreServices::getInstance()->getCore();
+		
+		// no batches are handed out until the first pass starts
+		core->lockMutex(workMutex);
+		nextPending = pendingLumels.size();
+		core->unlockMutex(workMutex);
+		
+		std::vector<RadToolWorker*> workers;
+		for(int i=1; i < numThreads; i++) {
+			RadToolWorker *worker = new RadToolWorker(this);
+			workers.push_back(worker);
+			core->createThread(worker);
+		}
+		
+		totalPasses = radPasses + 1;
+		for(int pass=0; pass < totalPasses; pass++) {
+			runPass(pass);
+		}
+		
+		for(int i=0; i < workers.size(); i++) {
+			workers[i]->killThread();
+		}
+		for(int i=0; i < workers.size(); i++) {
+			while(!workers[i]->threadFinished) {
+				radToolSleep(1);
+			}
+			delete workers[i];
+		}
 		
-	image->setPixel(lumel->u*packer->lightMapRes, lumel->v*packer->lightMapRes, col);
+		for(int m=0; m < meshKeys.size(); m++) {
+			if(!meshBaked[m])
+				continue;
+			CacheEntry &entry = bakeCache[meshKeys[m]];
+			entry.directEnergy.assign(directEnergy.begin() + meshFirstLumel[m], directEnergy.begin() + meshFirstLumel[m] + meshNumLumels[m]);
+			entry.energy.assign(energy.begin() + meshFirstLumel[m], energy.begin() + meshFirstLumel[m] + meshNumLumels[m]);
+		}
+	}
+	
+	writeLumels();
+	progress = 1;
+	dispatchEvent(new Event(), Event::COMPLETE_EVENT);
 }
 
-RadTool::~RadTool() {
+bool RadTool::saveBakeCache(const String& fileName) {
+	OSFILE *file = OSBasics::open(fileName, "wb");
+	if(!file) {
+		Logger::log("Error writing lightmap cache %s\n", fileName.c_str());
+		return false;
+	}
+	
+	unsigned int header[3] = {0x434D4C50, 1, (unsigned int)bakeCache.size()};
+	OSBasics::write(header, sizeof(unsigned int), 3, file);
+	for(std::map<unsigned int, CacheEntry>::iterator it = bakeCache.begin(); it != bakeCache.end(); it++) {
+		unsigned int entryHeader[2] = {it->first, (unsigned int)it->second.energy.size()};
+		OSBasics::write(entryHeader, sizeof(unsigned int), 2, file);
+		for(unsigned int i=0; i < it->second.energy.size(); i++) {
+			float values[6] = {(float)it->second.directEnergy[i].x, (float)it->second.directEnergy[i].y, (float)it->second.directEnergy[i].z, (float)it->second.energy[i].x, (float)it->second.energy[i].y, (float)it->second.energy[i].z};
+			OSBasics::write(values, sizeof(float), 6, file);
+		}
+	}
+	OSBasics::close(file);
+	return true;
+}
+
+bool RadTool::loadBakeCache(const String& fileName) {
+	OSFILE *file = OSBasics::open(fileName, "rb");
+	if(!file)
+		return false;
+	
+	unsigned int header[3];
+	if(OSBasics::read(header, sizeof(unsigned int), 3, file) != 3 || header[0] != 0x434D4C50 || header[1] != 1) {
+		Logger::log("Invalid lightmap cache %s\n", fileName.c_str());
+		OSBasics::close(file);
+		return false;
+	}
 	
+	for(unsigned int e=0; e < header[2]; e++) {
+		unsigned int entryHeader[2];
+		if(OSBasics::read(entryHeader, sizeof(unsigned int), 2, file) != 2)
+			break;
+		
+		CacheEntry &entry = bakeCache[entryHeader[0]];
+		entry.directEnergy.resize(entryHeader[1]);
+		entry.energy.resize(entryHeader[1]);
+		for(unsigned int i=0; i < entryHeader[1]; i++) {
+			float values[6];
+			if(OSBasics::read(values, sizeof(float), 6, file) != 6) {
+				bakeCache.erase(entryHeader[0]);
+				OSBasics::close(file);
+				return false;
+			}
+			entry.directEnergy[i] = Vector3(values[0], values[1], values[2]);
+			entry.energy[i] = Vector3(values[3], values[4], values[5]);
+		}
+	}
+	OSBasics::close(file);
+	return true;
 }
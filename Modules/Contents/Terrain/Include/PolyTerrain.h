@@ -1,40 +1,155 @@
 /*
- *  PolyTerrain.h
- *  Poly
- *
- *  Created by Ivan Safrin on 2/20/09.
- *  Copyright 2009 __MyCompanyName__. All rights reserved.
- *
- */
+Copyright (C) 2011 by Ivan Safrin
 
-// @package Scene
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+ 
 
 #pragma once
 #include "PolyGlobals.h"
-#include "PolySceneMesh.h"
-#include "PolyCoreServices.h"
-
-#include <string>
-using std::string;
+#include "PolySceneEntity.h"
+#include "PolyTerrainChunk.h"
+#include "PolyTerrainTile.h"
+#include <map>
 
 namespace Polycode {
+
+	class Camera;
+	class Material;
+	class Scene;
+	class ShaderBinding;
+	class Texture;
 	
-	class _PolyExport Terrain : public SceneMesh {
-	public:
-		
-		Terrain(int type, string heightmapFile, bool smooth, float tileAmt, float xDensity, float zDensity, float sx, float sz, float height);
-		~Terrain();
-		Vector3 getTerrainDataScale() { return terrainDataScale; }		
-		
-		static const int BASIC = 0;
-		
-		
-	private:
-		
-		void createBasic(string heightmapFile, bool smooth, float tileAmt, float xDensity, float zDensity, float sx, float sz, float height);
-		
-		Vector3 terrainDataScale;
+	/**
+	* Large heightmap terrain made of streamed tiles. Tiles are loaded from a TerrainTileSource on a background thread as the camera moves and unloaded again once they are out of range. Every tile is split into chunks that pick a level of detail from their distance to the camera each frame. All chunks share one set of index lists, and edges towards coarser neighbours are stitched so no cracks appear. Chunks are frustum culled individually against the camera the scene is rendering with.
+	*
+	* The terrain lies in its local XZ plane. Tile (x,z) covers x*tileSize to (x+1)*tileSize on both axes, so the terrain extends from the entity's position in positive and negative directions as tiles are found.
+	*/
+	class _PolyExport Terrain : public SceneEntity {
+		public:
+			/**
+			* Constructor.
+			* @param source Source to load tiles from. The terrain does not take ownership of it.
+			* @param scene Scene the terrain will be added to. Its active camera drives streaming and level of detail unless setLODCamera() is used.
+			* @param tileResolution Number of quads along a tile side. Must be a multiple of chunkResolution.
+			* @param chunkResolution Number of quads along a chunk side. Must be a power of two.
+			* @param tileSize Size of a tile in world units.
+			* @param height Height of the highest heightmap value.
+			*/
+			Terrain(TerrainTileSource *source, Scene *scene, int tileResolution = 256, int chunkResolution = 32, Number tileSize = 256, Number height = 32);
+			virtual ~Terrain();
+			
+			void Update();
+			void Render();
+			
+			/**
+			* Sets the material the terrain is rendered with.
+			*/
+			void setMaterial(Material *material);
+			
+			/**
+			* Sets the material by name from the resource manager.
+			*/
+			void setMaterialByName(const String& materialName);
+			
+			/**
+			* Sets the diffuse texture of the terrain.
+			*/
+			void setTexture(Texture *texture);
+			
+			/**
+			* Loads the diffuse texture from a file.
+			*/
+			void loadTexture(const String& fileName);
+			
+			Texture *getTexture();
+			
+			/**
+			* Sets the camera used for streaming and level of detail. If NULL (the default), the scene's active camera is used.
+			*/
+			void setLODCamera(Camera *camera);
+			
+			/**
+			* Sets how many tiles around the camera's tile are kept loaded in each direction. Defaults to 1 (a 3x3 area).
+			*/
+			void setStreamingRadius(int tiles);
+			
+			/**
+			* Sets the distance at which chunks switch to the first coarser level of detail. Every further level starts at twice the distance of the previous one. Defaults to the size of two chunks.
+			*/
+			void setLODDistance(Number distance);
+			
+			/**
+			* Sets how many times the texture repeats across a tile. Defaults to 1.
+			*/
+			void setTextureRepeat(Number repeat);
+			
+			/**
+			* If true (the default), tiles are loaded on a background thread. Otherwise tiles are loaded during Update().
+			*/
+			void setAsyncLoading(bool async);
+			
+			/**
+			* Returns the terrain height at a position in the terrain's local space, or 0 if the tile at that position is not loaded.
+			*/
+			Number getHeightAt(Number x, Number z);
+			
+			unsigned int getNumLoadedTiles() const;
+			unsigned int getNumChunks() const;
+			
+			/**
+			* Returns the number of chunks drawn in the last frame.
+			*/
+			unsigned int getNumVisibleChunks() const;
+			
+		protected:
+			static long long getKey(int x, int z);
+			
+			void streamTiles(int centerX, int centerZ);
+			void addTile(TerrainTile *tile);
+			void removeTile(TerrainTile *tile);
+			void buildChunks(TerrainTile *tile);
+			void removeChunks(TerrainTile *tile);
+			void updateLOD(const Vector3 &cameraPosition);
+			void updateBounds();
+			
+			TerrainTileSource *source;
+			TerrainTileLoader *loader;
+			TerrainIndexCache *indexCache;
+			Scene *scene;
+			Camera *lodCamera;
+			
+			int tileResolution;
+			int chunkResolution;
+			Number tileSize;
+			Number height;
+			Number lodDistance;
+			Number textureRepeat;
+			int streamingRadius;
+			unsigned int numVisibleChunks;
+			
+			Material *material;
+			ShaderBinding *localShaderOptions;
+			Texture *texture;
+			
+			std::map<long long, TerrainTile*> tiles;
+			std::map<long long, bool> pendingTiles;
+			std::map<long long, TerrainChunk*> chunks;
 	};
-	
-	
-}
\ No newline at end of file
+}
@@ -0,0 +1,126 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+ 
+
+#pragma once
+#include "PolyGlobals.h"
+#include "PolyVector3.h"
+#include <map>
+#include <vector>
+
+namespace Polycode {
+
+	class Renderer;
+	class RenderDataArray;
+	class TerrainTile;
+	
+	/**
+	* Index lists shared by every terrain chunk. A chunk draws its full resolution vertex grid through the index list for its level of detail. Edges that border a coarser chunk are stitched to the coarser chunk's vertices so no cracks appear between them. Lists are built on first use and kept for every combination of chunk level and edge levels.
+	*/
+	class _PolyExport TerrainIndexCache {
+		public:
+			/**
+			* Constructor.
+			* @param chunkResolution Number of quads along a chunk side. Must be a power of two.
+			*/
+			TerrainIndexCache(int chunkResolution);
+			virtual ~TerrainIndexCache();
+			
+			/**
+			* Returns the triangle list for a chunk.
+			* @param level Level of detail of the chunk. Level L uses every 2^L-th vertex.
+			* @param edgeLevels Levels of the north (-z), east (+x), south (+z) and west (-x) edges.
+			*/
+			const std::vector<unsigned int>& getIndices(int level, const int edgeLevels[4]);
+			
+			/**
+			* Returns the coarsest level of detail, at which a chunk is drawn as two triangles.
+			*/
+			int getMaxLevel() const;
+			
+			int getChunkResolution() const;
+			
+			static const int EDGE_NORTH = 0;
+			static const int EDGE_EAST = 1;
+			static const int EDGE_SOUTH = 2;
+			static const int EDGE_WEST = 3;
+			
+		protected:
+			void buildIndices(std::vector<unsigned int> &indices, int level, const int edgeLevels[4]);
+			void addEdge(std::vector<unsigned int> &indices, int edge, int step, int edgeStep);
+			void edgeToGrid(int edge, int along, int depth, int *x, int *z) const;
+			void addTriangle(std::vector<unsigned int> &indices, int x0, int z0, int x1, int z1, int x2, int z2);
+			
+			int chunkResolution;
+			int maxLevel;
+			std::map<unsigned int, std::vector<unsigned int>*> indexLists;
+	};
+	
+	/**
+	* A square piece of a terrain tile with its own vertex arrays.
+	*/
+	class _PolyExport TerrainChunk {
+		public:
+			/**
+			* Builds the chunk's vertices from a tile.
+			* @param tile Tile the chunk is part of.
+			* @param chunkX Chunk column within the tile.
+			* @param chunkZ Chunk row within the tile.
+			* @param resolution Number of quads along the chunk side.
+			* @param tileOrigin Position of the tile's corner in terrain space.
+			* @param spacing Distance between samples.
+			* @param height Height of a sample with the value 1.
+			* @param uvScale Texture coordinates per sample.
+			*/
+			TerrainChunk(TerrainTile *tile, int chunkX, int chunkZ, int resolution, const Vector3 &tileOrigin, Number spacing, Number height, Number uvScale);
+			virtual ~TerrainChunk();
+			
+			/**
+			* Draws the chunk with the index list for its current level and edge levels.
+			*/
+			void render(Renderer *renderer, TerrainIndexCache *indexCache);
+			
+			/**
+			* Returns the distance from a point to the chunk's bounding box.
+			*/
+			Number getDistance(const Vector3 &point) const;
+			
+			/**
+			* Chunk coordinates across the whole terrain.
+			*/
+			int globalX;
+			int globalZ;
+			
+			int level;
+			int edgeLevels[4];
+			
+			Vector3 bBoxMin;
+			Vector3 bBoxMax;
+			Vector3 center;
+			Number radius;
+			
+		protected:
+			RenderDataArray *vertexArray;
+			RenderDataArray *normalArray;
+			RenderDataArray *texCoordArray;
+	};
+}
@@ -0,0 +1,131 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+ 
+
+#pragma once
+#include "PolyGlobals.h"
+#include "PolyString.h"
+#include "PolyThreaded.h"
+#include <vector>
+
+namespace Polycode {
+
+	class CoreMutex;
+	class Image;
+	
+	/**
+	* A square tile of heightmap samples. A tile with a resolution of N has (N+1) x (N+1) samples, so neighbouring tiles share their edge samples. Heights are stored in the 0-1 range and scaled by the terrain.
+	*/
+	class _PolyExport TerrainTile {
+		public:
+			TerrainTile(int tileX, int tileZ, int resolution);
+			
+			/**
+			* Returns the height sample at a grid position. Positions outside the tile are clamped to its edge.
+			*/
+			Number getHeight(int x, int z) const;
+			void setHeight(int x, int z, Number height);
+			
+			int tileX;
+			int tileZ;
+			int resolution;
+			
+			/**
+			* False if the tile source had no data for this tile.
+			*/
+			bool valid;
+			
+			std::vector<float> heights;
+	};
+	
+	/**
+	* Provides heightmap tiles to a Terrain. Tiles are loaded on the terrain's streaming thread, so loadTile() must not touch the renderer or scene.
+	*/
+	class _PolyExport TerrainTileSource {
+		public:
+			virtual ~TerrainTileSource() {}
+			
+			/**
+			* Fills in the heights of a tile. Returns false if there is no tile at the tile's position.
+			*/
+			virtual bool loadTile(TerrainTile *tile) = 0;
+			
+		protected:
+			void copyImageToTile(Image *image, int offsetX, int offsetY, Number scale, TerrainTile *tile);
+	};
+	
+	/**
+	* Loads each tile from its own image file. The file name is made from a printf style pattern with two %d placeholders for the tile x and z coordinates, for example "terrain/tile_%d_%d.png". Images are resampled to the tile resolution.
+	*/
+	class _PolyExport ImageTerrainTileSource : public TerrainTileSource {
+		public:
+			ImageTerrainTileSource(const String& pathPattern);
+			
+			bool loadTile(TerrainTile *tile);
+			
+		protected:
+			String pathPattern;
+	};
+	
+	/**
+	* Cuts tiles out of a single heightmap image, one pixel per sample. Tile (0,0) starts at the top left corner of the image.
+	*/
+	class _PolyExport HeightmapTerrainTileSource : public TerrainTileSource {
+		public:
+			HeightmapTerrainTileSource(const String& heightmapFile);
+			virtual ~HeightmapTerrainTileSource();
+			
+			bool loadTile(TerrainTile *tile);
+			
+		protected:
+			Image *heightmap;
+	};
+	
+	/**
+	* Loads requested tiles from a tile source on a background thread.
+	*/
+	class _PolyExport TerrainTileLoader : public Threaded {
+		public:
+			TerrainTileLoader(TerrainTileSource *source);
+			virtual ~TerrainTileLoader();
+			
+			/**
+			* Queues a tile for loading.
+			*/
+			void requestTile(int tileX, int tileZ, int resolution);
+			
+			/**
+			* Returns a tile that finished loading, or NULL if there is none. The caller takes ownership of the tile.
+			*/
+			TerrainTile *getLoadedTile();
+			
+			void runThread();
+			void updateThread();
+			
+		protected:
+			TerrainTileSource *source;
+			CoreMutex *queueMutex;
+			std::vector<TerrainTile*> requestedTiles;
+			std::vector<TerrainTile*> loadedTiles;
+			volatile bool threadFinished;
+	};
+}
@@ -1,87 +1,345 @@
 /*
- *  PolyTerrain.cpp
- *  Poly
- *
- *  Created by Ivan Safrin on 2/20/09.
- *  Copyright 2009 __MyCompanyName__. All rights reserved.
- *
- */
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+ 
 
 #include "PolyTerrain.h"
+#include "PolyCamera.h"
+#include "PolyCoreServices.h"
+#include "PolyMaterial.h"
+#include "PolyMaterialManager.h"
+#include "PolyRenderer.h"
+#include "PolyResourceManager.h"
+#include "PolyScene.h"
+#include "PolyShader.h"
+#include <math.h>
 
 using namespace Polycode;
 
-Terrain::Terrain(int type, string heightmapFile, bool smooth, float tileAmt, float xDensity, float zDensity, float sx, float sz, float height) : SceneMesh(Mesh::TRI_MESH) {
+Terrain::Terrain(TerrainTileSource *source, Scene *scene, int tileResolution, int chunkResolution, Number tileSize, Number height) : SceneEntity(), source(source), scene(scene), tileResolution(tileResolution), chunkResolution(chunkResolution), tileSize(tileSize), height(height) {
+	
+	if(chunkResolution > tileResolution)
+		this->chunkResolution = tileResolution;
+	
+	indexCache = new TerrainIndexCache(this->chunkResolution);
+	loader = new TerrainTileLoader(source);
+	lodCamera = NULL;
+	lodDistance = (tileSize / (tileResolution / this->chunkResolution)) * 2.0;
+	textureRepeat = 1.0;
+	streamingRadius = 1;
+	numVisibleChunks = 0;
+	
+	material = NULL;
+	localShaderOptions = NULL;
+	texture = NULL;
+}
 
-	switch(type) {
-		case BASIC:
-			createBasic(heightmapFile, smooth, tileAmt,xDensity,zDensity,sx,sz,height);
-			break;
+Terrain::~Terrain() {
+	delete loader;
+	
+	for(std::map<long long, TerrainChunk*>::iterator it = chunks.begin(); it != chunks.end(); it++) {
+		delete it->second;
+	}
+	for(std::map<long long, TerrainTile*>::iterator it = tiles.begin(); it != tiles.end(); it++) {
+		delete it->second;
 	}
+	delete indexCache;
+	delete localShaderOptions;
 }
 
-void Terrain::createBasic(string heightmapFile, bool smooth, float tileAmt, float xDensity, float zDensity, float sx, float sz, float height) {
+long long Terrain::getKey(int x, int z) {
+	return (((long long)x) << 32) | (unsigned int)z;
+}
+
+void Terrain::setMaterial(Material *material) {
+	this->material = material;
+	localShaderOptions = material->getShader(0)->createBinding();
+	if(texture) {
+		localShaderOptions->clearTexture("diffuse");
+		localShaderOptions->addTexture("diffuse", texture);
+	}
+}
+
+void Terrain::setMaterialByName(const String& materialName) {
+	Material *material =  (Material*)CoreServices::getInstance()->getResourceManager()->getResource(Resource::RESOURCE_MATERIAL, materialName);
+	if(!material)
+		return;
+	setMaterial(material);
+}
+
+void Terrain::setTexture(Texture *texture) {
+	this->texture = texture;
+	if(localShaderOptions) {
+		localShaderOptions->clearTexture("diffuse");
+		localShaderOptions->addTexture("diffuse", texture);
+	}
+}
+
+void Terrain::loadTexture(const String& fileName) {
+	setTexture(CoreServices::getInstance()->getMaterialManager()->createTextureFromFile(fileName, false));
+}
+
+Texture *Terrain::getTexture() {
+	return texture;
+}
+
+void Terrain::setLODCamera(Camera *camera) {
+	lodCamera = camera;
+}
+
+void Terrain::setStreamingRadius(int tiles) {
+	streamingRadius = tiles;
+}
+
+void Terrain::setLODDistance(Number distance) {
+	lodDistance = distance;
+}
+
+void Terrain::setTextureRepeat(Number repeat) {
+	textureRepeat = repeat;
+	for(std::map<long long, TerrainTile*>::iterator it = tiles.begin(); it != tiles.end(); it++) {
+		if(it->second->valid) {
+			removeChunks(it->second);
+			buildChunks(it->second);
+		}
+	}
+}
+
+void Terrain::setAsyncLoading(bool async) {
+	if(async == (loader != NULL))
+		return;
 	
-	float xStep = sx/xDensity;
-	float zStep = sz/zDensity;
+	if(async) {
+		loader = new TerrainTileLoader(source);
+	} else {
+		delete loader;
+		loader = NULL;
+	}
+	// requests queued on the old loader are gone, ask again on the next update
+	pendingTiles.clear();
+}
+
+unsigned int Terrain::getNumLoadedTiles() const {
+	return tiles.size();
+}
+
+unsigned int Terrain::getNumChunks() const {
+	return chunks.size();
+}
+
+unsigned int Terrain::getNumVisibleChunks() const {
+	return numVisibleChunks;
+}
+
+Number Terrain::getHeightAt(Number x, Number z) {
+	int tileX = (int)floor(x / tileSize);
+	int tileZ = (int)floor(z / tileSize);
+	std::map<long long, TerrainTile*>::iterator it = tiles.find(getKey(tileX, tileZ));
+	if(it == tiles.end() || !it->second->valid)
+		return 0.0;
 	
-	float uStep = 1.0f / xDensity * tileAmt;
-	float vStep = 1.0f / zDensity * tileAmt;
+	TerrainTile *tile = it->second;
+	Number spacing = tileSize / tileResolution;
+	Number fx = (x - (tileX * tileSize)) / spacing;
+	Number fz = (z - (tileZ * tileSize)) / spacing;
+	int sx = (int)floor(fx);
+	int sz = (int)floor(fz);
+	fx -= sx;
+	fz -= sz;
 	
+	Number h0 = tile->getHeight(sx, sz) + ((tile->getHeight(sx+1, sz) - tile->getHeight(sx, sz)) * fx);
+	Number h1 = tile->getHeight(sx, sz+1) + ((tile->getHeight(sx+1, sz+1) - tile->getHeight(sx, sz+1)) * fx);
+	return (h0 + ((h1 - h0) * fz)) * height;
+}
+
+void Terrain::buildChunks(TerrainTile *tile) {
+	Number spacing = tileSize / tileResolution;
+	Number uvScale = textureRepeat / tileResolution;
+	Vector3 tileOrigin(tile->tileX * tileSize, 0, tile->tileZ * tileSize);
 	
-	float xOffset = -sx/2.0f;
-	float zOffset = -sz/2.0f;
+	int chunksPerTile = tileResolution / chunkResolution;
+	for(int z=0; z < chunksPerTile; z++) {
+		for(int x=0; x < chunksPerTile; x++) {
+			TerrainChunk *chunk = new TerrainChunk(tile, x, z, chunkResolution, tileOrigin, spacing, height, uvScale);
+			chunks[getKey(chunk->globalX, chunk->globalZ)] = chunk;
+		}
+	}
+}
+
+void Terrain::removeChunks(TerrainTile *tile) {
+	int chunksPerTile = tileResolution / chunkResolution;
+	for(int z=0; z < chunksPerTile; z++) {
+		for(int x=0; x < chunksPerTile; x++) {
+			long long key = getKey((tile->tileX * chunksPerTile) + x, (tile->tileZ * chunksPerTile) + z);
+			std::map<long long, TerrainChunk*>::iterator it = chunks.find(key);
+			if(it != chunks.end()) {
+				delete it->second;
+				chunks.erase(it);
+			}
+		}
+	}
+}
+
+void Terrain::addTile(TerrainTile *tile) {
+	long long key = getKey(tile->tileX, tile->tileZ);
+	pendingTiles.erase(key);
 	
-	Image *heightImage = new Image(heightmapFile);
+	// tiles without data are kept as markers so they are not requested again
+	tiles[key] = tile;
+	if(tile->valid)
+		buildChunks(tile);
+}
+
+void Terrain::removeTile(TerrainTile *tile) {
+	if(tile->valid)
+		removeChunks(tile);
+	tiles.erase(getKey(tile->tileX, tile->tileZ));
+	delete tile;
+}
+
+void Terrain::streamTiles(int centerX, int centerZ) {
+	if(loader) {
+		TerrainTile *tile = loader->getLoadedTile();
+		while(tile) {
+			addTile(tile);
+			tile = loader->getLoadedTile();
+		}
+	}
 	
-	terrainDataScale.x = sx / (float)heightImage->getWidth();
-	terrainDataScale.z = sz / (float)heightImage->getHeight();
+	for(int z=centerZ-streamingRadius; z <= centerZ+streamingRadius; z++) {
+		for(int x=centerX-streamingRadius; x <= centerX+streamingRadius; x++) {
+			long long key = getKey(x, z);
+			if(tiles.find(key) != tiles.end() || pendingTiles.find(key) != pendingTiles.end())
+				continue;
+			
+			if(loader) {
+				loader->requestTile(x, z, tileResolution);
+				pendingTiles[key] = true;
+			} else {
+				TerrainTile *tile = new TerrainTile(x, z, tileResolution);
+				tile->valid = source->loadTile(tile);
+				addTile(tile);
+			}
+		}
+	}
 	
-	Polygon *poly;
-	float hpos;
+	// unload one tile further out than we load, so tiles on the border
+	// do not get reloaded every time the camera crosses it
+	std::vector<TerrainTile*> farTiles;
+	for(std::map<long long, TerrainTile*>::iterator it = tiles.begin(); it != tiles.end(); it++) {
+		TerrainTile *tile = it->second;
+		if(abs(tile->tileX - centerX) > streamingRadius+1 || abs(tile->tileZ - centerZ) > streamingRadius+1)
+			farTiles.push_back(tile);
+	}
+	for(int i=0; i < farTiles.size(); i++) {
+		removeTile(farTiles[i]);
+	}
+}
+
+void Terrain::updateLOD(const Vector3 &cameraPosition) {
+	int maxLevel = indexCache->getMaxLevel();
 	
-	float imageStepX = floor( (float)heightImage->getWidth()/xDensity);
-	float imageStepY = floor((float)heightImage->getHeight()/zDensity);
+	for(std::map<long long, TerrainChunk*>::iterator it = chunks.begin(); it != chunks.end(); it++) {
+		TerrainChunk *chunk = it->second;
+		Number distance = chunk->getDistance(cameraPosition);
+		Number threshold = lodDistance;
+		int level = 0;
+		while(level < maxLevel && distance > threshold) {
+			level++;
+			threshold *= 2.0;
+		}
+		chunk->level = level;
+	}
 	
-	for(float i=0; i < xDensity; i+=1) {
-		for(float j=0; j < zDensity; j+=1) {
-			poly = new Polygon();
-			
-			hpos = height * heightImage->getPixel((imageStepX*i)+imageStepX, imageStepY*j).getBrightness();
-			poly->addVertex((xStep*i)+xStep+xOffset, hpos, (zStep * j)+zOffset, (uStep*i) + uStep, vStep*j)->setNormal(0,1,0);
-			
-			hpos = height * heightImage->getPixel((imageStepX*i), (imageStepY*j)).getBrightness();
-			poly->addVertex((xStep*i)+xOffset, hpos, (zStep * j)+zOffset, uStep*i, vStep*j)->setNormal(0,1,0);
-			
-			hpos = height * heightImage->getPixel(imageStepX*i, (imageStepY*j)+imageStepY).getBrightness();			
-			poly->addVertex((xStep*i)+xOffset, hpos, ((zStep*j)+zStep)+zOffset, uStep*i, (vStep*j)+vStep)->setNormal(0,1,0);								
-			
-			mesh->addPolygon(poly);
-			if(!smooth) {
-				poly->calculateNormal();
-				poly->useVertexNormals = true;
-			}
-			
-			poly = new Polygon();			
-			
-			hpos = height * heightImage->getPixel(imageStepX*i, (imageStepY*j)+imageStepY).getBrightness();			
-			poly->addVertex((xStep*i)+xOffset, hpos, (zStep*j)+zStep+zOffset, uStep*i, (vStep*j)+vStep)->setNormal(0,1,0);
-			
-			hpos = height * heightImage->getPixel((imageStepX*i)+imageStepX, (imageStepY*j)+imageStepY).getBrightness();						
-			poly->addVertex((xStep*i)+xStep+xOffset, hpos, (zStep*j)+zStep+zOffset, (uStep*i) + uStep, (vStep*j)+vStep)->setNormal(0,1,0);			
-			
-			hpos = height * heightImage->getPixel((imageStepX*i)+imageStepX, (imageStepY*j)).getBrightness();			
-			poly->addVertex((xStep*i)+xStep+xOffset, hpos, (zStep * j)+zOffset, (uStep*i) + uStep, vStep*j)->setNormal(0,1,0);
-			
-			mesh->addPolygon(poly);
-			if(!smooth) {
-				poly->calculateNormal();
-				poly->useVertexNormals = true;
-			}
+	const int neighbourX[4] = {0, 1, 0, -1};
+	const int neighbourZ[4] = {-1, 0, 1, 0};
+	for(std::map<long long, TerrainChunk*>::iterator it = chunks.begin(); it != chunks.end(); it++) {
+		TerrainChunk *chunk = it->second;
+		for(int i=0; i < 4; i++) {
+			std::map<long long, TerrainChunk*>::iterator neighbour = chunks.find(getKey(chunk->globalX + neighbourX[i], chunk->globalZ + neighbourZ[i]));
+			if(neighbour != chunks.end())
+				chunk->edgeLevels[i] = neighbour->second->level;
+			else
+				chunk->edgeLevels[i] = chunk->level;
 		}
-	}	
+	}
 }
 
-Terrain::~Terrain() {
+void Terrain::updateBounds() {
+	Number radius = 0;
+	for(std::map<long long, TerrainChunk*>::iterator it = chunks.begin(); it != chunks.end(); it++) {
+		TerrainChunk *chunk = it->second;
+		Number chunkRadius = chunk->center.length() + chunk->radius;
+		if(chunkRadius > radius)
+			radius = chunkRadius;
+	}
+	bBoxRadius = radius;
+}
+
+void Terrain::Update() {
+	Camera *camera = lodCamera;
+	if(!camera)
+		camera = scene->getActiveCamera();
+	if(!camera)
+		return;
+	
+	Vector3 cameraPosition = getConcatenatedMatrix().inverse() * camera->getConcatenatedMatrix().getPosition();
+	
+	streamTiles((int)floor(cameraPosition.x / tileSize), (int)floor(cameraPosition.z / tileSize));
+	updateLOD(cameraPosition);
+	updateBounds();
+}
+
+void Terrain::Render() {
+	Renderer *renderer = CoreServices::getInstance()->getRenderer();
+	
+	if(material) {
+		renderer->applyMaterial(material, localShaderOptions,0);
+	} else {
+		if(texture)
+			renderer->setTexture(texture);
+		else
+			renderer->setTexture(NULL);
+	}
+	
+	Camera *camera = scene->getRenderCamera();
+	Matrix4 matrix = getConcatenatedMatrix();
+	
+	// chunk radii are in local space, so grow them by the largest axis scale
+	Number largestScale = 0;
+	for(int i=0; i < 3; i++) {
+		Number axisScale = sqrt(matrix.m[i][0]*matrix.m[i][0] + matrix.m[i][1]*matrix.m[i][1] + matrix.m[i][2]*matrix.m[i][2]);
+		if(axisScale > largestScale)
+			largestScale = axisScale;
+	}
+	
+	numVisibleChunks = 0;
+	for(std::map<long long, TerrainChunk*>::iterator it = chunks.begin(); it != chunks.end(); it++) {
+		TerrainChunk *chunk = it->second;
+		if(camera && !camera->isSphereInFrustrum(matrix * chunk->center, chunk->radius * largestScale))
+			continue;
+		chunk->render(renderer, indexCache);
+		numVisibleChunks++;
+	}
 	
+	if(material) 
+		renderer->clearShader();
 }
@@ -0,0 +1,275 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+ 
+
+#include "PolyTerrainChunk.h"
+#include "PolyTerrainTile.h"
+#include "PolyCoreServices.h"
+#include "PolyMesh.h"
+#include "PolyRenderer.h"
+#include <math.h>
+#include <stdlib.h>
+
+using namespace Polycode;
+
+TerrainIndexCache::TerrainIndexCache(int chunkResolution) : chunkResolution(chunkResolution) {
+	maxLevel = 0;
+	while((1 << maxLevel) < chunkResolution) {
+		maxLevel++;
+	}
+}
+
+TerrainIndexCache::~TerrainIndexCache() {
+	for(std::map<unsigned int, std::vector<unsigned int>*>::iterator it = indexLists.begin(); it != indexLists.end(); it++) {
+		delete it->second;
+	}
+}
+
+int TerrainIndexCache::getMaxLevel() const {
+	return maxLevel;
+}
+
+int TerrainIndexCache::getChunkResolution() const {
+	return chunkResolution;
+}
+
+const std::vector<unsigned int>& TerrainIndexCache::getIndices(int level, const int edgeLevels[4]) {
+	// edges only need stitching towards coarser neighbours
+	int edges[4];
+	for(int i=0; i < 4; i++) {
+		edges[i] = edgeLevels[i];
+		if(edges[i] < level) edges[i] = level;
+		if(edges[i] > maxLevel) edges[i] = maxLevel;
+	}
+	
+	unsigned int key = level | (edges[EDGE_NORTH] << 4) | (edges[EDGE_EAST] << 8) | (edges[EDGE_SOUTH] << 12) | (edges[EDGE_WEST] << 16);
+	std::map<unsigned int, std::vector<unsigned int>*>::iterator it = indexLists.find(key);
+	if(it != indexLists.end())
+		return *it->second;
+	
+	std::vector<unsigned int> *indices = new std::vector<unsigned int>();
+	buildIndices(*indices, level, edges);
+	indexLists[key] = indices;
+	return *indices;
+}
+
+void TerrainIndexCache::buildIndices(std::vector<unsigned int> &indices, int level, const int edgeLevels[4]) {
+	int step = 1 << level;
+	int N = chunkResolution;
+	
+	if(step >= N) {
+		addTriangle(indices, 0, 0, N, 0, 0, N);
+		addTriangle(indices, N, 0, N, N, 0, N);
+		return;
+	}
+	
+	// interior quads, one cell in from every edge
+	for(int z=step; z < N-step; z += step) {
+		for(int x=step; x < N-step; x += step) {
+			addTriangle(indices, x, z, x+step, z, x, z+step);
+			addTriangle(indices, x+step, z, x+step, z+step, x, z+step);
+		}
+	}
+	
+	for(int i=0; i < 4; i++) {
+		int edgeStep = 1 << edgeLevels[i];
+		if(edgeStep > N) edgeStep = N;
+		addEdge(indices, i, step, edgeStep);
+	}
+}
+
+void TerrainIndexCache::edgeToGrid(int edge, int along, int depth, int *x, int *z) const {
+	switch(edge) {
+		case EDGE_NORTH:
+			*x = along;
+			*z = depth;
+		break;
+		case EDGE_SOUTH:
+			*x = along;
+			*z = chunkResolution - depth;
+		break;
+		case EDGE_WEST:
+			*x = depth;
+			*z = along;
+		break;
+		case EDGE_EAST:
+			*x = chunkResolution - depth;
+			*z = along;
+		break;
+	}
+}
+
+void TerrainIndexCache::addEdge(std::vector<unsigned int> &indices, int edge, int step, int edgeStep) {
+	int N = chunkResolution;
+	
+	// Zip the border vertices (spaced by the coarser of the two levels) to the
+	// first inner row of this chunk. The corner diagonals are shared with the
+	// neighbouring edges, so the four edges close the ring around the interior.
+	std::vector<int> outer;
+	for(int p=0; p <= N; p += edgeStep) {
+		outer.push_back(p);
+	}
+	std::vector<int> inner;
+	for(int p=step; p <= N-step; p += step) {
+		inner.push_back(p);
+	}
+	
+	int o = 0;
+	int i = 0;
+	int ox0, oz0, ox1, oz1, ix0, iz0, ix1, iz1;
+	while(o < outer.size()-1 || i < inner.size()-1) {
+		bool advanceOuter;
+		if(i == inner.size()-1) {
+			advanceOuter = true;
+		} else if(o == outer.size()-1) {
+			advanceOuter = false;
+		} else {
+			advanceOuter = (outer[o+1] <= inner[i+1]);
+		}
+		
+		edgeToGrid(edge, outer[o], 0, &ox0, &oz0);
+		edgeToGrid(edge, inner[i], step, &ix0, &iz0);
+		if(advanceOuter) {
+			edgeToGrid(edge, outer[o+1], 0, &ox1, &oz1);
+			addTriangle(indices, ox0, oz0, ox1, oz1, ix0, iz0);
+			o++;
+		} else {
+			edgeToGrid(edge, inner[i+1], step, &ix1, &iz1);
+			addTriangle(indices, ox0, oz0, ix1, iz1, ix0, iz0);
+			i++;
+		}
+	}
+}
+
+void TerrainIndexCache::addTriangle(std::vector<unsigned int> &indices, int x0, int z0, int x1, int z1, int x2, int z2) {
+	// y component of (p1-p0) x (p2-p0); keep every triangle facing up
+	int cross = ((z1-z0) * (x2-x0)) - ((x1-x0) * (z2-z0));
+	if(cross == 0)
+		return;
+	
+	if(cross < 0) {
+		int tx = x1;
+		int tz = z1;
+		x1 = x2;
+		z1 = z2;
+		x2 = tx;
+		z2 = tz;
+	}
+	
+	unsigned int row = chunkResolution + 1;
+	indices.push_back((z0 * row) + x0);
+	indices.push_back((z1 * row) + x1);
+	indices.push_back((z2 * row) + x2);
+}
+
+TerrainChunk::TerrainChunk(TerrainTile *tile, int chunkX, int chunkZ, int resolution, const Vector3 &tileOrigin, Number spacing, Number height, Number uvScale) : level(0), radius(0) {
+	
+	int chunksPerTile = tile->resolution / resolution;
+	globalX = (tile->tileX * chunksPerTile) + chunkX;
+	globalZ = (tile->tileZ * chunksPerTile) + chunkZ;
+	for(int i=0; i < 4; i++) {
+		edgeLevels[i] = 0;
+	}
+	
+	Renderer *renderer = CoreServices::getInstance()->getRenderer();
+	vertexArray = renderer->createRenderDataArray(RenderDataArray::VERTEX_DATA_ARRAY);
+	normalArray = renderer->createRenderDataArray(RenderDataArray::NORMAL_DATA_ARRAY);
+	texCoordArray = renderer->createRenderDataArray(RenderDataArray::TEXCOORD_DATA_ARRAY);
+	
+	int numVertices = (resolution+1) * (resolution+1);
+	vertexArray->arrayPtr = realloc(vertexArray->arrayPtr, numVertices * 3 * sizeof(float));
+	normalArray->arrayPtr = realloc(normalArray->arrayPtr, numVertices * 3 * sizeof(float));
+	texCoordArray->arrayPtr = realloc(texCoordArray->arrayPtr, numVertices * 2 * sizeof(float));
+	vertexArray->count = numVertices;
+	normalArray->count = numVertices;
+	texCoordArray->count = numVertices;
+	
+	float *vertexData = (float*)vertexArray->arrayPtr;
+	float *normalData = (float*)normalArray->arrayPtr;
+	float *texCoordData = (float*)texCoordArray->arrayPtr;
+	
+	int startX = chunkX * resolution;
+	int startZ = chunkZ * resolution;
+	Number minY = height;
+	Number maxY = 0;
+	
+	for(int z=0; z <= resolution; z++) {
+		for(int x=0; x <= resolution; x++) {
+			int sx = startX + x;
+			int sz = startZ + z;
+			Number y = tile->getHeight(sx, sz) * height;
+			if(y < minY) minY = y;
+			if(y > maxY) maxY = y;
+			
+			*(vertexData++) = tileOrigin.x + (sx * spacing);
+			*(vertexData++) = y;
+			*(vertexData++) = tileOrigin.z + (sz * spacing);
+			
+			Vector3 normal((tile->getHeight(sx-1, sz) - tile->getHeight(sx+1, sz)) * height, 2.0 * spacing, (tile->getHeight(sx, sz-1) - tile->getHeight(sx, sz+1)) * height);
+			normal.Normalize();
+			*(normalData++) = normal.x;
+			*(normalData++) = normal.y;
+			*(normalData++) = normal.z;
+			
+			*(texCoordData++) = ((tile->tileX * tile->resolution) + sx) * uvScale;
+			*(texCoordData++) = ((tile->tileZ * tile->resolution) + sz) * uvScale;
+		}
+	}
+	
+	bBoxMin = Vector3(tileOrigin.x + (startX * spacing), minY, tileOrigin.z + (startZ * spacing));
+	bBoxMax = Vector3(tileOrigin.x + ((startX + resolution) * spacing), maxY, tileOrigin.z + ((startZ + resolution) * spacing));
+	center = (bBoxMin + bBoxMax) * 0.5;
+	radius = (bBoxMax - center).length();
+}
+
+TerrainChunk::~TerrainChunk() {
+	free(vertexArray->arrayPtr);
+	free(normalArray->arrayPtr);
+	free(texCoordArray->arrayPtr);
+	delete vertexArray;
+	delete normalArray;
+	delete texCoordArray;
+}
+
+Number TerrainChunk::getDistance(const Vector3 &point) const {
+	Number dx = 0;
+	Number dy = 0;
+	Number dz = 0;
+	if(point.x < bBoxMin.x) dx = bBoxMin.x - point.x;
+	else if(point.x > bBoxMax.x) dx = point.x - bBoxMax.x;
+	if(point.y < bBoxMin.y) dy = bBoxMin.y - point.y;
+	else if(point.y > bBoxMax.y) dy = point.y - bBoxMax.y;
+	if(point.z < bBoxMin.z) dz = bBoxMin.z - point.z;
+	else if(point.z > bBoxMax.z) dz = point.z - bBoxMax.z;
+	return sqrt((dx*dx) + (dy*dy) + (dz*dz));
+}
+
+void TerrainChunk::render(Renderer *renderer, TerrainIndexCache *indexCache) {
+	const std::vector<unsigned int> &indices = indexCache->getIndices(level, edgeLevels);
+	if(indices.size() == 0)
+		return;
+	
+	renderer->pushRenderDataArray(vertexArray);
+	renderer->pushRenderDataArray(normalArray);
+	renderer->pushRenderDataArray(texCoordArray);
+	renderer->drawIndexedArrays(Mesh::TRI_MESH, &indices[0], indices.size());
+}
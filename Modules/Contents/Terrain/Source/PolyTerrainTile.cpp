@@ -0,0 +1,207 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+ 
+
+#include "PolyTerrainTile.h"
+#include "PolyCore.h"
+#include "PolyCoreServices.h"
+#include "PolyImage.h"
+#include "PolyLogger.h"
+#include <stdio.h>
+
+#ifdef _WINDOWS
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace Polycode;
+
+static void terrainLoaderSleep(unsigned int milliseconds) {
+#ifdef _WINDOWS
+	Sleep(milliseconds);
+#else
+	usleep(milliseconds * 1000);
+#endif
+}
+
+TerrainTile::TerrainTile(int tileX, int tileZ, int resolution) : tileX(tileX), tileZ(tileZ), resolution(resolution), valid(false) {
+	heights.resize((resolution+1) * (resolution+1), 0.0f);
+}
+
+Number TerrainTile::getHeight(int x, int z) const {
+	if(x < 0) x = 0;
+	if(z < 0) z = 0;
+	if(x > resolution) x = resolution;
+	if(z > resolution) z = resolution;
+	return heights[(z * (resolution+1)) + x];
+}
+
+void TerrainTile::setHeight(int x, int z, Number height) {
+	heights[(z * (resolution+1)) + x] = height;
+}
+
+void TerrainTileSource::copyImageToTile(Image *image, int offsetX, int offsetY, Number scale, TerrainTile *tile) {
+	int pixelSize;
+	switch(image->getType()) {
+		case Image::IMAGE_RGB:
+			pixelSize = 3;
+		break;
+		case Image::IMAGE_RGBA:
+			pixelSize = 4;
+		break;
+		default:
+			Logger::log("Terrain: unsupported heightmap image type\n");
+			return;
+		break;
+	}
+	
+	unsigned char *pixels = (unsigned char*)image->getPixels();
+	int width = image->getWidth();
+	int height = image->getHeight();
+	
+	for(int z=0; z <= tile->resolution; z++) {
+		int py = offsetY + (int)(z * scale);
+		if(py >= height) py = height-1;
+		for(int x=0; x <= tile->resolution; x++) {
+			int px = offsetX + (int)(x * scale);
+			if(px >= width) px = width-1;
+			unsigned char *pixel = pixels + ((py * width) + px) * pixelSize;
+			tile->setHeight(x, z, ((Number)pixel[0] + (Number)pixel[1] + (Number)pixel[2]) / (3.0 * 255.0));
+		}
+	}
+}
+
+ImageTerrainTileSource::ImageTerrainTileSource(const String& pathPattern) : TerrainTileSource(), pathPattern(pathPattern) {
+}
+
+bool ImageTerrainTileSource::loadTile(TerrainTile *tile) {
+	char fileName[1024];
+	snprintf(fileName, sizeof(fileName), pathPattern.c_str(), tile->tileX, tile->tileZ);
+	
+	Image *image = new Image();
+	if(!image->loadImage(fileName)) {
+		delete image;
+		return false;
+	}
+	
+	Number scale = ((Number)image->getWidth()-1) / (Number)tile->resolution;
+	copyImageToTile(image, 0, 0, scale, tile);
+	delete image;
+	return true;
+}
+
+HeightmapTerrainTileSource::HeightmapTerrainTileSource(const String& heightmapFile) : TerrainTileSource() {
+	heightmap = new Image();
+	if(!heightmap->loadImage(heightmapFile)) {
+		Logger::log("Terrain: error loading heightmap %s\n", heightmapFile.c_str());
+		delete heightmap;
+		heightmap = NULL;
+	}
+}
+
+HeightmapTerrainTileSource::~HeightmapTerrainTileSource() {
+	delete heightmap;
+}
+
+bool HeightmapTerrainTileSource::loadTile(TerrainTile *tile) {
+	if(!heightmap)
+		return false;
+	
+	int offsetX = tile->tileX * tile->resolution;
+	int offsetY = tile->tileZ * tile->resolution;
+	if(offsetX < 0 || offsetY < 0 || offsetX >= (int)heightmap->getWidth()-1 || offsetY >= (int)heightmap->getHeight()-1)
+		return false;
+	
+	copyImageToTile(heightmap, offsetX, offsetY, 1.0, tile);
+	return true;
+}
+
+TerrainTileLoader::TerrainTileLoader(TerrainTileSource *source) : Threaded(), source(source), threadFinished(false) {
+	Core *core = CoreServices::getInstance()->getCore();
+	queueMutex = core->createMutex();
+	core->createThread(this);
+}
+
+TerrainTileLoader::~TerrainTileLoader() {
+	killThread();
+	while(!threadFinished) {
+		terrainLoaderSleep(1);
+	}
+	
+	for(int i=0; i < requestedTiles.size(); i++) {
+		delete requestedTiles[i];
+	}
+	for(int i=0; i < loadedTiles.size(); i++) {
+		delete loadedTiles[i];
+	}
+	delete queueMutex;
+}
+
+void TerrainTileLoader::requestTile(int tileX, int tileZ, int resolution) {
+	Core *core = CoreServices::getInstance()->getCore();
+	core->lockMutex(queueMutex);
+	requestedTiles.push_back(new TerrainTile(tileX, tileZ, resolution));
+	core->unlockMutex(queueMutex);
+}
+
+TerrainTile *TerrainTileLoader::getLoadedTile() {
+	TerrainTile *tile = NULL;
+	Core *core = CoreServices::getInstance()->getCore();
+	core->lockMutex(queueMutex);
+	if(loadedTiles.size() > 0) {
+		tile = loadedTiles[0];
+		loadedTiles.erase(loadedTiles.begin());
+	}
+	core->unlockMutex(queueMutex);
+	return tile;
+}
+
+void TerrainTileLoader::runThread() {
+	while(threadRunning) {
+		updateThread();
+	}
+	threadFinished = true;
+}
+
+void TerrainTileLoader::updateThread() {
+	Core *core = CoreServices::getInstance()->getCore();
+	
+	TerrainTile *tile = NULL;
+	core->lockMutex(queueMutex);
+	if(requestedTiles.size() > 0) {
+		tile = requestedTiles[0];
+		requestedTiles.erase(requestedTiles.begin());
+	}
+	core->unlockMutex(queueMutex);
+	
+	if(!tile) {
+		terrainLoaderSleep(5);
+		return;
+	}
+	
+	tile->valid = source->loadTile(tile);
+	
+	core->lockMutex(queueMutex);
+	loadedTiles.push_back(tile);
+	core->unlockMutex(queueMutex);
+}
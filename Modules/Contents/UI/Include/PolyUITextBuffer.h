@@ -0,0 +1,135 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+ 
+
+#pragma once
+#include "PolyGlobals.h"
+#include "PolyString.h"
+#include <string>
+#include <vector>
+
+namespace Polycode {
+
+	/**
+	* A span of one of a UITextBuffer's two backing buffers.
+	*/
+	class _PolyExport UITextPiece {
+		public:
+			UITextPiece();
+			
+			int buffer;
+			unsigned int start;
+			unsigned int length;
+			unsigned int lineBreaks;
+	};
+
+	/**
+	* Piece table text storage with a line index. The original text and everything inserted afterwards are kept in two append-only buffers and the document is a list of pieces referencing them, so inserting or removing text never moves the rest of the document. Line breaks in both buffers are indexed when they are added, so finding the start of a line is a binary search instead of a scan through the text.
+	*/
+	class _PolyExport UITextBuffer {
+		public:
+			UITextBuffer();
+			virtual ~UITextBuffer();
+			
+			/**
+			* Replaces the whole text.
+			*/
+			void setText(const String &text);
+			
+			/**
+			* Returns the whole text.
+			*/
+			String getText() const;
+			
+			/**
+			* Returns part of the text.
+			* @param offset Offset of the first character.
+			* @param length Number of characters to return.
+			*/
+			String getText(unsigned int offset, unsigned int length) const;
+			
+			/**
+			* Inserts text at an offset.
+			*/
+			void insertText(unsigned int offset, const String &text);
+			
+			/**
+			* Removes text starting at an offset.
+			*/
+			void removeText(unsigned int offset, unsigned int length);
+			
+			/**
+			* Returns the length of the text.
+			*/
+			unsigned int getLength() const;
+			
+			/**
+			* Returns the number of lines. An empty buffer has one line and so does a line break at the end of the text.
+			*/
+			int getNumLines() const;
+			
+			/**
+			* Returns the offset of the first character of a line.
+			*/
+			unsigned int getLineOffset(int line) const;
+			
+			/**
+			* Returns the length of a line, not including its line break.
+			*/
+			unsigned int getLineLength(int line) const;
+			
+			/**
+			* Returns a line, not including its line break.
+			*/
+			String getLine(int line) const;
+			
+			/**
+			* Returns the line containing an offset.
+			*/
+			int getLineAtOffset(unsigned int offset) const;
+			
+			/**
+			* Returns the number of pieces the text is currently split into.
+			*/
+			int getNumPieces() const;
+			
+		protected:
+		
+			int findPiece(unsigned int offset) const;
+			int splitPiece(unsigned int offset);
+			unsigned int countLineBreaks(int buffer, unsigned int start, unsigned int length) const;
+			void updatePieceIndex();
+			
+			std::string buffers[2];
+			std::vector<unsigned int> lineBreaks[2];
+			
+			std::vector<UITextPiece> pieces;
+			std::vector<unsigned int> pieceOffsets;
+			std::vector<unsigned int> pieceLines;
+			
+			unsigned int length;
+			unsigned int numLineBreaks;
+			
+			static const int ORIGINAL_BUFFER = 0;
+			static const int ADDED_BUFFER = 1;
+	};
+}
@@ -0,0 +1,49 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+ 
+
+#pragma once
+#include "PolyGlobals.h"
+#include "PolyString.h"
+#include "PolyColor.h"
+#include <vector>
+
+namespace Polycode {
+
+	/**
+	* Syntax colorizer for UITextInput. Lines are colored one at a time, with a state carried from the end of each line to the start of the next (for example "inside a block comment"), so after an edit the text input only recolors lines until the state at the start of a line matches what it was before.
+	*/
+	class _PolyExport UITextColorizer {
+		public:
+			UITextColorizer() {}
+			virtual ~UITextColorizer() {}
+			
+			/**
+			* Colors one line of text.
+			* @param line Text of the line, without its line break.
+			* @param startState State at the start of the line, as returned for the previous line. The first line starts in state 0.
+			* @param colors If not NULL, filled with one color per character of the line.
+			* @return State at the end of the line.
+			*/
+			virtual int colorLine(const String &line, int startState, std::vector<Color> *colors) = 0;
+	};
+}
@@ -29,6 +29,9 @@
 #include "PolyScreenEntity.h"
 #include "PolyUIEvent.h"
 #include "PolyUIBox.h"
+#include "PolyUIVScrollBar.h"
+#include "PolyUITextBuffer.h"
+#include "PolyUITextColorizer.h"
 #include "PolyTimer.h"
 #include "PolyCoreInput.h"
 #include "PolyCore.h"
@@ -38,6 +41,23 @@ using namespace std;
 
 namespace Polycode {
 
+	class GlyphCache;
+
+	/**
+	* Coloring state of one line of a UITextInput.
+	*/
+	class _PolyExport UITextLineState {
+		public:
+			UITextLineState();
+			
+			int startState;
+			int endState;
+			bool changed;
+	};
+
+	/**
+	* Single or multi-line text input. The text is stored in a UITextBuffer and only the lines inside the input are drawn, each by a recycled ScreenLabel, so editing and scrolling cost the same regardless of the length of the text.
+	*/
 	class _PolyExport UITextInput : public ScreenEntity {
 		public:
 			UITextInput(bool multiLine, Number width, Number height);
@@ -66,7 +86,40 @@ namespace Polycode {
 			void setNumberOnly(bool val);
 		
 			String getSelectionText();
+			
+			/**
+			* Inserts text at the caret, replacing the selection.
+			*/
 			void insertText(String text);
+			
+			/**
+			* Returns the number of lines of text.
+			*/
+			int getNumLines();
+			
+			/**
+			* Returns a line of text, without its line break.
+			*/
+			String getLineText(int line);
+			
+			/**
+			* Returns the buffer holding the text.
+			*/
+			UITextBuffer *getTextBuffer();
+			
+			/**
+			* Sets the syntax colorizer used to color the text. Pass NULL (the default) to draw all text in black. The input does not take ownership of the colorizer.
+			*/
+			void setColorizer(UITextColorizer *colorizer);
+			
+			/**
+			* Scrolls so a line is the first visible line.
+			*/
+			void setScrollLine(int line);
+			int getScrollLine();
+			
+			void onMouseWheelUp(Number x, Number y);
+			void onMouseWheelDown(Number x, Number y);
 		
 		protected:
 		
@@ -75,20 +128,33 @@ namespace Polycode {
 			int caretSkipWordBack(int caretLine, int caretPosition);
 			int caretSkipWordForward(int caretLine, int caretPosition);
 		
-			void selectLineFromOffset();
 			void updateCaretPosition();
 			void setCaretToMouse(Number x, Number y);
 			void dragSelectionTo(Number x, Number y);		
 		
 			void selectWordAtCaret();
-		
-			void restructLines();
-			void removeLine(ScreenLabel *line);
+			
+			void insertTextAt(int line, int column, const String &text);
+			void removeText(int lineStart, int columnStart, int lineEnd, int columnEnd);
+			void textChanged(int line, int removedLines, int addedLines);
+			unsigned int getTextOffset(int line, int column);
+			
+			int getLineAtPosition(Number y);
+			int getColumnAtPosition(int line, Number x);
+			Number getColumnPosition(int line, int column);
+			Number getLinePosition(int line);
+			int getNumVisibleLines();
+			
+			ScreenLabel *createLineLabel();
+			void updateLines();
+			void updateSelectionRects();
+			void updateScrollBar();
+			void scrollToCaret();
+			void updateLineStates(int lastLine);
 		
 			ScreenShape *selectorRectTop;
 			ScreenShape *selectorRectMiddle;
 			ScreenShape *selectorRectBottom;		
-			int numLines;
 			
 			Number padding;
 			Number lineSpacing;
@@ -121,8 +187,21 @@ namespace Polycode {
 			Number lineHeight;
 		
 			int lineOffset;
-			ScreenLabel *currentLine;		
-			vector<ScreenLabel*> lines;
+			int scrollLine;
+			bool linesDirty;
+			
+			UITextBuffer *buffer;
+			GlyphCache *glyphCache;
+			vector<ScreenLabel*> lineLabels;
+			vector<int> lineLabelStates;
+			
+			UITextColorizer *colorizer;
+			vector<UITextLineState> lineStates;
+			int firstChangedLine;
+			int lastChangedLine;
+			
+			UIVScrollBar *vScrollBar;
+			Number scrollBarSize;
 			
 	};
 }
\ No newline at end of file
@@ -0,0 +1,71 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+ 
+
+#pragma once
+#include "PolyGlobals.h"
+#include "PolyString.h"
+
+namespace Polycode {
+
+	/**
+	* Supplies the nodes shown by a UIVirtualTree. Nodes are opaque pointers owned by the data source. Children are only requested when their parent is expanded, so large or expensive hierarchies can be loaded lazily.
+	*/
+	class _PolyExport UITreeDataSource {
+		public:
+			UITreeDataSource() {}
+			virtual ~UITreeDataSource() {}
+			
+			/**
+			* Returns the number of children of a node.
+			* @param node Node to return the number of children of, or NULL for the top level nodes.
+			*/
+			virtual int getNumChildren(void *node) = 0;
+			
+			/**
+			* Returns a child of a node.
+			* @param node Parent node, or NULL for the top level nodes.
+			* @param index Index of the child.
+			*/
+			virtual void *getChild(void *node, int index) = 0;
+			
+			/**
+			* Returns the text shown for a node.
+			*/
+			virtual String getLabel(void *node) = 0;
+			
+			/**
+			* Returns the icon image file shown for a node. Defaults to the tree's default icon.
+			*/
+			virtual String getIcon(void *node) { return ""; }
+			
+			/**
+			* Returns true if the node can be expanded. Override this if counting the children of a node is expensive, so that getNumChildren() is only called when the node is expanded.
+			*/
+			virtual bool hasChildren(void *node) { return getNumChildren(node) > 0; }
+			
+			/**
+			* Returns the height of the node's row. Return 0 (the default) to use the theme's cell height.
+			*/
+			virtual Number getRowHeight(void *node) { return 0; }
+	};
+}
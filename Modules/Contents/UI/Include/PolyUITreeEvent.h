@@ -40,6 +40,11 @@ namespace Polycode {
 			static const int DRAG_START_EVENT = 2003;
 			
 			UITree *selection;
+			
+			/**
+			* Data source node the event refers to. Only set for events dispatched by UIVirtualTree.
+			*/
+			void *node;
 
 		protected:
 		
@@ -33,6 +33,11 @@ namespace Polycode {
 		
 		void Update();
 		Number getScrollValue();
+		
+		/**
+		* Moves the handle to a scroll value between 0 and 1. The change event is dispatched on the next update.
+		*/
+		void setScrollValue(Number newValue);
 		void handleEvent(Event *event);
 		
 		void Resize(int newHeight);
@@ -0,0 +1,236 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+ 
+
+#pragma once
+#include "PolyGlobals.h"
+#include "PolyScreenLabel.h"
+#include "PolyScreenImage.h"
+#include "PolyScreenShape.h"
+#include "PolyScreenEntity.h"
+#include "PolyUITreeEvent.h"
+#include "PolyUITreeDataSource.h"
+#include "PolyUIVScrollBar.h"
+#include "PolyUIBox.h"
+#include <vector>
+
+using std::vector;
+
+namespace Polycode {
+
+	/**
+	* Maps between row indices and vertical offsets for rows of varying height. Offset and row lookups are O(log n).
+	*/
+	class _PolyExport UIRowOffsetIndex {
+		public:
+			UIRowOffsetIndex();
+			~UIRowOffsetIndex();
+			
+			/**
+			* Rebuilds the index from a list of row heights.
+			*/
+			void build(const vector<Number> &rowHeights);
+			
+			/**
+			* Changes the height of a single row.
+			*/
+			void setRowHeight(int row, Number height);
+			
+			/**
+			* Returns the height of a row.
+			*/
+			Number getRowHeight(int row) const;
+			
+			/**
+			* Returns the vertical offset of the top of a row.
+			*/
+			Number getRowOffset(int row) const;
+			
+			/**
+			* Returns the row at a vertical offset. Offsets past the last row return the last row.
+			*/
+			int getRowAt(Number offset) const;
+			
+			Number getTotalHeight() const;
+			int getNumRows() const;
+			
+		protected:
+			vector<Number> heights;
+			vector<Number> tree;
+			int highestStep;
+	};
+	
+	/**
+	* A row of a UIVirtualTree, as stored in the flattened list of visible nodes.
+	*/
+	class _PolyExport UIVirtualTreeItem {
+		public:
+			UIVirtualTreeItem();
+			
+			void *node;
+			int depth;
+			bool expanded;
+			bool hasChildren;
+	};
+	
+	/**
+	* Row widget used by UIVirtualTree. Row widgets are recycled as the tree scrolls, so only enough of them to fill the view are ever created.
+	*/
+	class _PolyExport UIVirtualTreeRow : public ScreenEntity {
+		public:
+			UIVirtualTreeRow(const String &icon, Number rowWidth, Number rowHeight);
+			virtual ~UIVirtualTreeRow();
+			
+			void setRowSize(Number rowWidth, Number rowHeight);
+			void setContent(const String &text, const String &icon, Number indent, bool expandable, bool expanded, bool selected);
+			
+			ScreenShape *bgBox;
+			ScreenImage *arrowIconImage;
+			
+			int row;
+			void *node;
+			
+		protected:
+		
+			void layout();
+		
+			UIBox *selection;
+			ScreenImage *iconImage;
+			ScreenLabel *textLabel;
+			
+			String labelText;
+			String iconFile;
+			Number indent;
+			Number rowWidth;
+			Number rowHeight;
+			Number cellPadding;
+			Number selectionPadding;
+	};
+
+	/**
+	* A tree view for very large trees. Unlike UITree, nodes are not entities: they are supplied by a UITreeDataSource and only the rows inside the view get a (recycled) row widget, so the cost of the tree depends on the size of the view rather than the number of nodes. Children are requested from the data source the first time their parent is expanded. A data source without children makes this a virtualized list.
+	*
+	* The tree dispatches UITreeEvent::SELECTED_EVENT, UITreeEvent::EXECUTED_EVENT and UITreeEvent::DRAG_START_EVENT with the event's node set to the data source node.
+	*/
+	class _PolyExport UIVirtualTree : public ScreenEntity {
+		public:
+			/**
+			* Constructor.
+			* @param dataSource Data source supplying the nodes. The tree does not take ownership of it.
+			* @param defaultIcon Icon shown for nodes the data source does not return an icon for.
+			* @param treeWidth Width of the tree, including the scroll bar.
+			* @param treeHeight Height of the tree.
+			*/
+			UIVirtualTree(UITreeDataSource *dataSource, String defaultIcon, Number treeWidth, Number treeHeight);
+			virtual ~UIVirtualTree();
+			
+			/**
+			* Discards all rows and requests the top level nodes from the data source again. Call this when the data source changes.
+			*/
+			void reloadData();
+			
+			/**
+			* Requests the children of an expanded row from the data source again.
+			*/
+			void reloadRow(int row);
+			
+			void expandRow(int row);
+			void collapseRow(int row);
+			void toggleRow(int row);
+			bool isRowExpanded(int row);
+			
+			/**
+			* Returns the number of rows, which is the number of top level nodes plus the children of all expanded nodes.
+			*/
+			int getNumRows();
+			void *getRowNode(int row);
+			int getRowDepth(int row);
+			
+			/**
+			* Returns the row showing a node or -1 if the node is not in an expanded part of the tree. This is a linear search.
+			*/
+			int getRowForNode(void *node);
+			
+			void setSelectedNode(void *node);
+			void *getSelectedNode();
+			
+			/**
+			* Scrolls so the row is inside the view.
+			*/
+			void scrollToRow(int row);
+			Number getScrollOffset();
+			
+			/**
+			* Returns the number of row widgets created so far.
+			*/
+			int getNumRowWidgets();
+			
+			void Resize(int x, int y);
+			
+			void Update();
+			void handleEvent(Event *event);
+			
+			void onMouseWheelUp(Number x, Number y);
+			void onMouseWheelDown(Number x, Number y);
+			
+			/**
+			* Horizontal offset of each tree level.
+			*/
+			Number indentSize;
+			
+		protected:
+		
+			void insertChildren(int row);
+			void removeChildren(int row);
+			void rebuildOffsets();
+			void refreshContent();
+			void updateRows();
+			UIVirtualTreeRow *createRowWidget();
+			void bindRow(UIVirtualTreeRow *widget, int row);
+		
+			UITreeDataSource *dataSource;
+			String defaultIcon;
+			
+			vector<UIVirtualTreeItem> items;
+			vector<UIVirtualTreeRow*> rowWidgets;
+			UIRowOffsetIndex offsets;
+			
+			void *selectedNode;
+			UIVirtualTreeRow *pressedRow;
+			bool willDrag;
+			bool isDragging;
+			bool rowsDirty;
+			
+			Number cellHeight;
+			Number scrollOffset;
+			Number contentHeight;
+			Number viewWidth;
+			Number viewHeight;
+			Number scrollBarPadding;
+			Number scrollBarSize;
+			
+			UIBox *bgBox;
+			ScreenShape *maskShape;
+			ScreenEntity *rowContainer;
+			UIVScrollBar *vScrollBar;
+	};
+}
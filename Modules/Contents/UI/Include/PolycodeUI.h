@@ -30,9 +30,13 @@
 #include "PolyUIHSlider.h"
 #include "PolyUIImageButton.h"
 #include "PolyUIScrollContainer.h"
+#include "PolyUITextBuffer.h"
+#include "PolyUITextColorizer.h"
 #include "PolyUITextInput.h"
 #include "PolyUITree.h"
 #include "PolyUITreeContainer.h"
+#include "PolyUITreeDataSource.h"
 #include "PolyUITreeEvent.h"
+#include "PolyUIVirtualTree.h"
 #include "PolyUIVScrollBar.h"
 #include "PolyUIWindow.h"
\ No newline at end of file
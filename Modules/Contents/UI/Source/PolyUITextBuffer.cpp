@@ -0,0 +1,238 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+ 
+
+#include "PolyUITextBuffer.h"
+#include <algorithm>
+
+using namespace Polycode;
+
+UITextPiece::UITextPiece() {
+	buffer = 0;
+	start = 0;
+	length = 0;
+	lineBreaks = 0;
+}
+
+UITextBuffer::UITextBuffer() {
+	length = 0;
+	numLineBreaks = 0;
+}
+
+UITextBuffer::~UITextBuffer() {
+
+}
+
+void UITextBuffer::setText(const String &text) {
+	buffers[ORIGINAL_BUFFER] = text.contents;
+	buffers[ADDED_BUFFER].clear();
+	lineBreaks[ORIGINAL_BUFFER].clear();
+	lineBreaks[ADDED_BUFFER].clear();
+	pieces.clear();
+	
+	const std::string &original = buffers[ORIGINAL_BUFFER];
+	for(unsigned int i=0; i < original.length(); i++) {
+		if(original[i] == '\n')
+			lineBreaks[ORIGINAL_BUFFER].push_back(i);
+	}
+	
+	if(original.length() > 0) {
+		UITextPiece piece;
+		piece.buffer = ORIGINAL_BUFFER;
+		piece.start = 0;
+		piece.length = original.length();
+		piece.lineBreaks = lineBreaks[ORIGINAL_BUFFER].size();
+		pieces.push_back(piece);
+	}
+	updatePieceIndex();
+}
+
+String UITextBuffer::getText() const {
+	return getText(0, length);
+}
+
+String UITextBuffer::getText(unsigned int offset, unsigned int length) const {
+	if(offset >= this->length)
+		return String();
+	if(length > this->length - offset)
+		length = this->length - offset;
+	
+	std::string text;
+	text.reserve(length);
+	for(int i=findPiece(offset); i < pieces.size() && length > 0; i++) {
+		unsigned int pieceOffset = offset - pieceOffsets[i];
+		unsigned int count = pieces[i].length - pieceOffset;
+		if(count > length)
+			count = length;
+		text.append(buffers[pieces[i].buffer], pieces[i].start + pieceOffset, count);
+		offset += count;
+		length -= count;
+	}
+	return String(text);
+}
+
+void UITextBuffer::insertText(unsigned int offset, const String &text) {
+	if(text.length() == 0)
+		return;
+	if(offset > length)
+		offset = length;
+	
+	std::string &added = buffers[ADDED_BUFFER];
+	unsigned int addedStart = added.length();
+	added.append(text.contents);
+	
+	unsigned int newLineBreaks = 0;
+	for(unsigned int i=0; i < text.contents.length(); i++) {
+		if(text.contents[i] == '\n') {
+			lineBreaks[ADDED_BUFFER].push_back(addedStart + i);
+			newLineBreaks++;
+		}
+	}
+	
+	// Typing appends to the piece that was just inserted, so extend it instead of adding a piece per keystroke.
+	if(offset > 0) {
+		int previous = findPiece(offset-1);
+		UITextPiece &piece = pieces[previous];
+		if(pieceOffsets[previous] + piece.length == offset && piece.buffer == ADDED_BUFFER && piece.start + piece.length == addedStart) {
+			piece.length += text.length();
+			piece.lineBreaks += newLineBreaks;
+			updatePieceIndex();
+			return;
+		}
+	}
+	
+	UITextPiece piece;
+	piece.buffer = ADDED_BUFFER;
+	piece.start = addedStart;
+	piece.length = text.length();
+	piece.lineBreaks = newLineBreaks;
+	
+	int index = splitPiece(offset);
+	pieces.insert(pieces.begin()+index, piece);
+	updatePieceIndex();
+}
+
+void UITextBuffer::removeText(unsigned int offset, unsigned int length) {
+	if(offset >= this->length || length == 0)
+		return;
+	if(length > this->length - offset)
+		length = this->length - offset;
+	
+	int first = splitPiece(offset);
+	int last = splitPiece(offset + length);
+	pieces.erase(pieces.begin()+first, pieces.begin()+last);
+	updatePieceIndex();
+}
+
+unsigned int UITextBuffer::getLength() const {
+	return length;
+}
+
+int UITextBuffer::getNumLines() const {
+	return numLineBreaks + 1;
+}
+
+unsigned int UITextBuffer::getLineOffset(int line) const {
+	if(line <= 0)
+		return 0;
+	if(line > numLineBreaks)
+		return length;
+	
+	// The last piece whose preceding line breaks don't reach the line holds the line break that starts it.
+	int index = std::lower_bound(pieceLines.begin(), pieceLines.end(), (unsigned int)line) - pieceLines.begin() - 1;
+	const UITextPiece &piece = pieces[index];
+	const std::vector<unsigned int> &breaks = lineBreaks[piece.buffer];
+	std::vector<unsigned int>::const_iterator first = std::lower_bound(breaks.begin(), breaks.end(), piece.start);
+	unsigned int breakPosition = *(first + (line - pieceLines[index] - 1));
+	return pieceOffsets[index] + (breakPosition - piece.start) + 1;
+}
+
+unsigned int UITextBuffer::getLineLength(int line) const {
+	unsigned int start = getLineOffset(line);
+	unsigned int end = length;
+	if(line >= 0 && line < numLineBreaks)
+		end = getLineOffset(line+1) - 1;
+	return end - start;
+}
+
+String UITextBuffer::getLine(int line) const {
+	return getText(getLineOffset(line), getLineLength(line));
+}
+
+int UITextBuffer::getLineAtOffset(unsigned int offset) const {
+	int index = findPiece(offset);
+	if(index >= pieces.size())
+		return numLineBreaks;
+	return pieceLines[index] + countLineBreaks(pieces[index].buffer, pieces[index].start, offset - pieceOffsets[index]);
+}
+
+int UITextBuffer::getNumPieces() const {
+	return pieces.size();
+}
+
+int UITextBuffer::findPiece(unsigned int offset) const {
+	if(offset >= length)
+		return pieces.size();
+	return std::upper_bound(pieceOffsets.begin(), pieceOffsets.end(), offset) - pieceOffsets.begin() - 1;
+}
+
+int UITextBuffer::splitPiece(unsigned int offset) {
+	int index = findPiece(offset);
+	if(index >= pieces.size() || pieceOffsets[index] == offset)
+		return index;
+	
+	UITextPiece &left = pieces[index];
+	unsigned int leftLength = offset - pieceOffsets[index];
+	
+	UITextPiece right;
+	right.buffer = left.buffer;
+	right.start = left.start + leftLength;
+	right.length = left.length - leftLength;
+	right.lineBreaks = countLineBreaks(right.buffer, right.start, right.length);
+	
+	left.length = leftLength;
+	left.lineBreaks -= right.lineBreaks;
+	
+	pieces.insert(pieces.begin()+index+1, right);
+	updatePieceIndex();
+	return index+1;
+}
+
+unsigned int UITextBuffer::countLineBreaks(int buffer, unsigned int start, unsigned int length) const {
+	const std::vector<unsigned int> &breaks = lineBreaks[buffer];
+	std::vector<unsigned int>::const_iterator first = std::lower_bound(breaks.begin(), breaks.end(), start);
+	std::vector<unsigned int>::const_iterator last = std::lower_bound(first, breaks.end(), start + length);
+	return last - first;
+}
+
+void UITextBuffer::updatePieceIndex() {
+	pieceOffsets.resize(pieces.size());
+	pieceLines.resize(pieces.size());
+	length = 0;
+	numLineBreaks = 0;
+	for(int i=0; i < pieces.size(); i++) {
+		pieceOffsets[i] = length;
+		pieceLines[i] = numLineBreaks;
+		length += pieces[i].length;
+		numLineBreaks += pieces[i].lineBreaks;
+	}
+}
@@ -27,9 +27,30 @@
 #include "PolyLabel.h"
 #include "PolyCoreServices.h"
 #include "PolyEventHandler.h"
+#include "PolyGlyphCache.h"
+#include <math.h>
 
 using namespace Polycode;
 
+static bool isWordSeparator(wchar_t chr) {
+	return (chr > 0 && chr < 48) || (chr > 57 && chr < 65) || (chr > 90 && chr < 97) || (chr > 122 && chr < 127);
+}
+
+static int countLineBreaks(const String &text) {
+	int count = 0;
+	for(int i=0; i < text.length(); i++) {
+		if(text[i] == '\n')
+			count++;
+	}
+	return count;
+}
+
+UITextLineState::UITextLineState() {
+	startState = 0;
+	endState = 0;
+	changed = true;
+}
+
 UITextInput::UITextInput(bool multiLine, Number width, Number height) : ScreenEntity() {
 	this->multiLine = multiLine;
 	
@@ -42,11 +63,15 @@ UITextInput::UITextInput(bool multiLine, Number width, Number height) : ScreenEn
 	caretPosition = 0;
 	caretImagePosition = 0;
 	
-	currentLine = NULL;
+	lineOffset = 0;
+	scrollLine = 0;
+	linesDirty = true;
 	
+	colorizer = NULL;
+	firstChangedLine = -1;
+	lastChangedLine = -1;
 	
-	lineOffset = -1;
-	numLines = 0;
+	buffer = new UITextBuffer();
 	
 	this->positionMode = ScreenEntity::POSITION_TOPLEFT;
 	Config *conf = CoreServices::getInstance()->getConfig();	
@@ -61,6 +86,8 @@ UITextInput::UITextInput(bool multiLine, Number width, Number height) : ScreenEn
 	else
 		fontSize = conf->getNumericValue("Polycode", "uiTextInputFontSize");
 	
+	glyphCache = CoreServices::getInstance()->getFontManager()->getGlyphCache(CoreServices::getInstance()->getFontManager()->getFontByName(fontName), fontSize, Label::ANTIALIAS_FULL);
+	
 	Number rectHeight = height;
 	if(!multiLine) {
 		rectHeight = fontSize+12;
@@ -107,8 +134,9 @@ UITextInput::UITextInput(bool multiLine, Number width, Number height) : ScreenEn
 	selectorRectBottom->setColor(181.0f/255.0f, 213.0f/255.0f, 255.0f/255.0f, 1);
 	selectorRectBottom->visible = false;
 	addChild(selectorRectBottom);
-		
-	insertLine(true);	
+	
+	// the first line label also gives the line height
+	lineHeight = createLineLabel()->getHeight();
 	
 	blinkerRect = new ScreenShape(ScreenShape::SHAPE_RECT, 1, fontSize,0,0);
 	blinkerRect->setPositionMode(ScreenEntity::POSITION_TOPLEFT);
@@ -126,6 +154,16 @@ UITextInput::UITextInput(bool multiLine, Number width, Number height) : ScreenEn
 	hitwidth = width;
 	hitheight = rectHeight;
 	
+	vScrollBar = NULL;
+	scrollBarSize = conf->getNumericValue("Polycode", "uiScrollDefaultSize");
+	if(multiLine) {
+		vScrollBar = new UIVScrollBar(scrollBarSize, height+(padding*2), 1);
+		vScrollBar->setPosition(width+(padding*2)-scrollBarSize, 0);
+		vScrollBar->addEventListener(this, Event::CHANGE_EVENT);
+		addChild(vScrollBar);
+		updateScrollBar();
+	}
+	
 	updateCaretPosition();
 }
 
@@ -176,109 +214,83 @@ void UITextInput::setSelection(int lineStart, int lineEnd, int colStart, int col
 	
 	clearSelection();
 	
-	if(lineStart > lines.size()-1)
-		return;	
+	if(lineStart < 0 || lineEnd > buffer->getNumLines()-1)
+		return;
 	
-	ScreenLabel *topLine = lines[lineStart];	
+	if(colStart < 0)
+		colStart = 0;
+	if(colStart > buffer->getLineLength(lineStart))
+		colStart = buffer->getLineLength(lineStart);
+	if(colEnd > buffer->getLineLength(lineEnd))
+		colEnd = buffer->getLineLength(lineEnd);
 	
-	if(colStart+1 > topLine->getText().length())
-		return;
+	hasSelection = true;
 	
-	Number fColEnd  = colEnd;
+	selectionTop = lineStart;
+	selectionBottom = lineEnd;
+	selectionL = colStart;
+	selectionR = colEnd;
 	
-	if(colEnd > topLine->getText().length() || lineStart != lineEnd)
-		fColEnd = topLine->getText().length();
+	updateSelectionRects();
+}
 
-	Number topSize, topHeight, topX;
+void UITextInput::updateSelectionRects() {
+	selectorRectTop->visible = false;	
+	selectorRectMiddle->visible = false;	
+	selectorRectBottom->visible = false;
 	
-	selectorRectTop->visible = true;	
-	topSize = topLine->getLabel()->getTextWidth(CoreServices::getInstance()->getFontManager()->getFontByName(fontName), topLine->getText().substr(colStart,fColEnd-colStart), fontSize) - 4; 
-	topHeight = lineHeight+lineSpacing;
-	if(colStart > 0) {
-		topX = topLine->getLabel()->getTextWidth(CoreServices::getInstance()->getFontManager()->getFontByName(fontName), topLine->getText().substr(0,colStart-1), fontSize); ;
-	} else {
-		topX = 0;
+	if(!hasSelection)
+		return;
+	
+	int firstVisible = scrollLine;
+	int lastVisible = scrollLine + getNumVisibleLines() - 1;
+	Number selectionHeight = lineHeight+lineSpacing;
+	
+	if(selectionTop >= firstVisible && selectionTop <= lastVisible) {
+		Number topX = getColumnPosition(selectionTop, selectionL);
+		Number topEnd;
+		if(selectionTop == selectionBottom) {
+			topEnd = getColumnPosition(selectionTop, selectionR);
+		} else {
+			topEnd = getColumnPosition(selectionTop, buffer->getLineLength(selectionTop));
+		}
+		Number topSize = topEnd - topX;
+		if(topSize > 0) {
+			selectorRectTop->visible = true;
+			selectorRectTop->setScale(topSize, selectionHeight);
+			selectorRectTop->setPosition(topX + (topSize/2.0), getLinePosition(selectionTop) + (selectionHeight/2.0));
+		}
 	}
-
-	selectorRectTop->setScale(topSize, topHeight);
-	selectorRectTop->setPosition(topX + padding + (topSize/2.0)+ 1, padding + (lineStart * (lineHeight+lineSpacing)) + (topHeight/2.0));
 	
-	if(lineEnd > lineStart && lineEnd < lines.size()) {
-		ScreenLabel *bottomLine = lines[lineEnd];	
-		selectorRectBottom->visible = true;		
-		Number bottomSize = bottomLine->getLabel()->getTextWidth(CoreServices::getInstance()->getFontManager()->getFontByName(fontName), bottomLine->getText().substr(0,colEnd), fontSize) - 4; 
-		Number bottomHeight = lineHeight+lineSpacing;
-		selectorRectBottom->setScale(bottomSize, bottomHeight);
-		selectorRectBottom->setPosition(padding + (bottomSize/2.0) + 1, padding + (lineEnd * (lineHeight+lineSpacing)) + (bottomHeight/2.0));
-		
-		if(lineEnd != lineStart+1) {
-			// need filler
-			selectorRectMiddle->visible = true;		
-			Number midSize = this->width-padding;
-			Number midHeight = 0;			
-			for(int i=lineStart+1; i < lineEnd;i++) {
-				midHeight += lineHeight+lineSpacing;
-			}
-			selectorRectMiddle->setScale(midSize, midHeight);
-			selectorRectMiddle->setPosition(padding + (midSize/2.0), padding + ((lineStart+1) * (lineHeight+lineSpacing)) + (midHeight/2.0));										
-			
+	if(selectionBottom > selectionTop && selectionBottom >= firstVisible && selectionBottom <= lastVisible) {
+		Number bottomSize = getColumnPosition(selectionBottom, selectionR) - padding;
+		if(bottomSize > 0) {
+			selectorRectBottom->visible = true;
+			selectorRectBottom->setScale(bottomSize, selectionHeight);
+			selectorRectBottom->setPosition(padding + (bottomSize/2.0), getLinePosition(selectionBottom) + (selectionHeight/2.0));
 		}
-		
 	}
-	hasSelection = true;
 	
-	selectionTop = lineStart;
-	selectionBottom = lineEnd;
-	selectionL = colStart;
-	selectionR = colEnd;	 		
+	// whole lines in between, clipped to the visible lines
+	int middleTop = selectionTop+1;
+	int middleBottom = selectionBottom-1;
+	if(middleTop < firstVisible)
+		middleTop = firstVisible;
+	if(middleBottom > lastVisible)
+		middleBottom = lastVisible;
+	if(middleBottom >= middleTop) {
+		selectorRectMiddle->visible = true;		
+		Number midSize = this->width-padding;
+		Number midHeight = (middleBottom-middleTop+1) * selectionHeight;
+		selectorRectMiddle->setScale(midSize, midHeight);
+		selectorRectMiddle->setPosition(padding + (midSize/2.0), getLinePosition(middleTop) + (midHeight/2.0));
+	}
 }
 
 void UITextInput::deleteSelection() {
-	if(selectionTop == selectionBottom) {
-		String ctext = lines[selectionTop]->getText();
-		String newText = ctext.substr(0, selectionL);
-		int rside = selectionR;
-		if(rside > ctext.length()-1)
-			rside = ctext.length() - 1;
-		newText += ctext.substr(rside,ctext.length() - selectionR); 
-		lines[selectionTop]->setText(newText);
-	} else {
-		
-		String ctext = lines[selectionTop]->getText();
-		String newText = ctext.substr(0, selectionL);
-		lines[selectionTop]->setText(newText);
-
-		ScreenLabel *bottomLine = lines[selectionBottom];
-		
-		// if whole lines to remove, do it
-		vector<ScreenLabel*> linesToRemove;
-		if(selectionBottom > selectionTop + 1) {
-			for(int i=selectionTop+1; i < selectionBottom; i++) {
-				linesToRemove.push_back(lines[i]);
-			}
-			for(int i=0; i < linesToRemove.size(); i++) {
-				removeLine(linesToRemove[i]);
-			}
-		}
-		
-		ctext = bottomLine->getText();
-		
-		int rside = selectionR;
-		if(rside > ctext.length()-1)
-			rside = ctext.length() - 1;
-		newText = ctext.substr(rside,ctext.length() - selectionR); 
-		
-				
-		lineOffset = selectionTop;
-		selectLineFromOffset();
-		caretPosition = currentLine->getText().length();
-		updateCaretPosition();
-		currentLine->setText(currentLine->getText() + newText);	
-		removeLine(bottomLine);				
-		
-		
-	}
+	removeText(selectionTop, selectionL, selectionBottom, selectionR);
 	clearSelection();
+	lineOffset = selectionTop;
 	caretPosition = selectionL;
 	updateCaretPosition();
 	dispatchEvent(new UIEvent(), UIEvent::CHANGE_EVENT);	
@@ -286,41 +298,22 @@ void UITextInput::deleteSelection() {
 
 void UITextInput::Resize(int x, int y) {
 	inputRect->resizeBox(x, y);
+	if(multiLine) {
+		height = y-(padding*2);
+		hitheight = height;
+		vScrollBar->Resize(y);
+		vScrollBar->setPosition(x-scrollBarSize, 0);
+		updateScrollBar();
+		setScrollLine(scrollLine);
+		linesDirty = true;
+	}
 }
 
 int UITextInput::insertLine(bool after) {
-	
-	numLines++;	
-	
-	ScreenLabel *newLine = new ScreenLabel(L"", fontSize, fontName, Label::ANTIALIAS_FULL);
-	newLine->setColor(0,0,0,1);
-	lineHeight = newLine->getHeight();
-	addChild(newLine);
-	
 	if(after) {	
-		
-		if(currentLine) {
-			String ctext = currentLine->getText();
-			String text2 = ctext.substr(caretPosition, ctext.length()-caretPosition);
-			ctext = ctext.substr(0,caretPosition);
-			currentLine->setText(ctext);
-			newLine->setText(text2);
-			caretPosition=0;
-		}
-		
-		currentLine = newLine;		
-		
-		vector<ScreenLabel*>::iterator it;
-		it = lines.begin();
-		
-		for(int i=0; i < lineOffset+1; i++) {
-			it++;
-		}
-		
-		lineOffset = lineOffset + 1;	
-		lines.insert(it,newLine);
-		
-		restructLines();
+		insertTextAt(lineOffset, caretPosition, "\n");
+		lineOffset++;
+		caretPosition = 0;
 	} else {	
 		// do we even need that? I don't think so.
 	}	
@@ -329,23 +322,74 @@ int UITextInput::insertLine(bool after) {
 	return 1;	
 }
 
-void UITextInput::restructLines() {
-	for(int i=0; i < lines.size(); i++) {
-		lines[i]->setPosition(padding,padding + (i*(lineHeight+lineSpacing)) ,0.0f);		
+void UITextInput::insertTextAt(int line, int column, const String &text) {
+	buffer->insertText(getTextOffset(line, column), text);
+	textChanged(line, 0, countLineBreaks(text));
+}
+
+void UITextInput::removeText(int lineStart, int columnStart, int lineEnd, int columnEnd) {
+	unsigned int start = getTextOffset(lineStart, columnStart);
+	unsigned int end = getTextOffset(lineEnd, columnEnd);
+	if(end <= start)
+		return;
+	buffer->removeText(start, end-start);
+	textChanged(lineStart, lineEnd-lineStart, 0);
+}
+
+void UITextInput::textChanged(int line, int removedLines, int addedLines) {
+	linesDirty = true;
+	
+	if(colorizer) {
+		// keep the states of the lines after the edit, they are checked again when the edit is recolored
+		lineStates.erase(lineStates.begin()+line+1, lineStates.begin()+line+1+removedLines);
+		lineStates.insert(lineStates.begin()+line+1, addedLines, UITextLineState());
+		lineStates[line].changed = true;
+		
+		if(lastChangedLine > line) {
+			lastChangedLine += addedLines - removedLines;
+			if(lastChangedLine < line)
+				lastChangedLine = line;
+		}
+		if(lastChangedLine < line + addedLines)
+			lastChangedLine = line + addedLines;
+		if(firstChangedLine == -1 || firstChangedLine > line)
+			firstChangedLine = line;
+	}
+	
+	if(removedLines != addedLines) {
+		updateScrollBar();
+		setScrollLine(scrollLine);
 	}
+	if(hasSelection)
+		updateSelectionRects();
+}
+
+unsigned int UITextInput::getTextOffset(int line, int column) {
+	if(line < 0)
+		return 0;
+	if(line > buffer->getNumLines()-1)
+		return buffer->getLength();
+	if(column < 0)
+		column = 0;
+	if(column > buffer->getLineLength(line))
+		column = buffer->getLineLength(line);
+	return buffer->getLineOffset(line) + column;
 }
 
 void UITextInput::setText(String text) {
+	buffer->setText(text);
+	setColorizer(colorizer);
+	clearSelection();
+	lineOffset = 0;
 	if(!multiLine) {
-		currentLine->setText(text);
 		caretPosition = text.length();
-		clearSelection();				
-		updateCaretPosition();		
 	} else {
+		caretPosition = 0;
+		updateScrollBar();
+		setScrollLine(0);
 	}
-		
-//	this->text = text;
-//	currentLine->setText(text);	
+	linesDirty = true;
+	updateCaretPosition();
 }
 
 void UITextInput::onLoseFocus() {
@@ -353,85 +397,253 @@ void UITextInput::onLoseFocus() {
 }
 
 String UITextInput::getText() {
+	return buffer->getText();
+}
+
+int UITextInput::getNumLines() {
+	return buffer->getNumLines();
+}
+
+String UITextInput::getLineText(int line) {
+	return buffer->getLine(line);
+}
+
+UITextBuffer *UITextInput::getTextBuffer() {
+	return buffer;
+}
+
+void UITextInput::setColorizer(UITextColorizer *colorizer) {
+	this->colorizer = colorizer;
+	lineStates.clear();
+	firstChangedLine = -1;
+	lastChangedLine = -1;
+	if(colorizer) {
+		lineStates.resize(buffer->getNumLines());
+		firstChangedLine = 0;
+		lastChangedLine = buffer->getNumLines()-1;
+	}
 	
-	if(!multiLine) {
-		return currentLine->getText();
-	} else {
-		String totalText = L"";
-		for(int i=0; i < lines.size(); i++) {
-				totalText += lines[i]->getText();					
-				totalText += L"\n";
-		}	
-		return totalText;
+	// force every label to be recolored
+	for(int i=0; i < lineLabels.size(); i++) {
+		lineLabelStates[i] = -1;
+		lineLabels[i]->setText("");
+		lineLabels[i]->setCharacterColors(vector<Color>());
 	}
+	linesDirty = true;
 }
 
-void UITextInput::updateCaretPosition() {
-	caretImagePosition = padding;
-	if(caretPosition == 0) {
-		caretImagePosition = padding;
-	} else if(caretPosition > currentLine->getText().length()) {
-		caretPosition = currentLine->getText().length();
-		String caretSubString = currentLine->getText().substr(0,caretPosition);
-		caretImagePosition = currentLine->getLabel()->getTextWidth(CoreServices::getInstance()->getFontManager()->getFontByName(fontName), caretSubString, fontSize);		
-		caretImagePosition = caretImagePosition - 4.0f + padding;		
+void UITextInput::updateLineStates(int lastLine) {
+	if(!colorizer || firstChangedLine == -1 || firstChangedLine > lastLine)
+		return;
+	
+	int line = firstChangedLine;
+	int state = 0;
+	if(line > 0)
+		state = lineStates[line-1].endState;
+	
+	for(; line < lineStates.size() && line <= lastLine; line++) {
+		UITextLineState &lineState = lineStates[line];
+		if(!lineState.changed && lineState.startState == state && line > lastChangedLine) {
+			// past the last edit and back in the state this line was colored with, so the rest is unchanged
+			firstChangedLine = -1;
+			lastChangedLine = -1;
+			return;
+		}
+		lineState.startState = state;
+		lineState.endState = colorizer->colorLine(buffer->getLine(line), state, NULL);
+		lineState.changed = false;
+		state = lineState.endState;
+	}
+	
+	if(line >= lineStates.size()) {
+		firstChangedLine = -1;
+		lastChangedLine = -1;
 	} else {
-		String caretSubString = currentLine->getText().substr(0,caretPosition);
-		caretImagePosition = currentLine->getLabel()->getTextWidth(CoreServices::getInstance()->getFontManager()->getFontByName(fontName), caretSubString, fontSize);
-		caretImagePosition = caretImagePosition - 4.0f + padding;		
+		firstChangedLine = line;
 	}
-	blinkerRect->visible  = true;
-	blinkTimer->Reset();
+}
+
+ScreenLabel *UITextInput::createLineLabel() {
+	ScreenLabel *newLine = new ScreenLabel(L"", fontSize, fontName, Label::ANTIALIAS_FULL);
+	newLine->setColor(0,0,0,1);
+	addChild(newLine);
+	lineLabels.push_back(newLine);
+	lineLabelStates.push_back(-1);
+	return newLine;
+}
+
+void UITextInput::updateLines() {
+	linesDirty = false;
 	
-	if(doSelectToCaret) {
-		doSelectToCaret = false;
+	int numVisible = getNumVisibleLines();
+	int lastLine = scrollLine + numVisible - 1;
+	if(lastLine > buffer->getNumLines()-1)
+		lastLine = buffer->getNumLines()-1;
+	
+	updateLineStates(lastLine);
+	
+	int labelIndex = 0;
+	for(int line = scrollLine; line <= lastLine; line++) {
+		if(labelIndex >= lineLabels.size())
+			createLineLabel();
+		ScreenLabel *label = lineLabels[labelIndex];
+		
+		// labels are only rebuilt when the line they show changed
+		String text = buffer->getLine(line);
+		bool textChanged = (text != label->getText());
+		if(textChanged)
+			label->setText(text);
+		
+		if(colorizer) {
+			int startState = lineStates[line].startState;
+			if(textChanged || lineLabelStates[labelIndex] != startState) {
+				vector<Color> colors;
+				colorizer->colorLine(text, startState, &colors);
+				label->setCharacterColors(colors);
+				lineLabelStates[labelIndex] = startState;
+			}
+		}
 		
+		label->setPosition(padding, getLinePosition(line), 0.0f);
+		label->visible = true;
+		labelIndex++;
 	}
 	
+	for(; labelIndex < lineLabels.size(); labelIndex++) {
+		lineLabels[labelIndex]->visible = false;
+	}
 }
 
-void UITextInput::selectLineFromOffset() {
-	for(int i=0; i < lines.size(); i++) {
-		if(i == lineOffset) {
-			currentLine = lines[i];					
-			return;
-		}
-	}
+int UITextInput::getNumVisibleLines() {
+	if(!multiLine)
+		return 1;
+	int numVisible = floor(height / (lineHeight+lineSpacing));
+	if(numVisible < 1)
+		numVisible = 1;
+	return numVisible;
 }
 
-void UITextInput::dragSelectionTo(Number x, Number y) {
+Number UITextInput::getLinePosition(int line) {
+	return padding + ((line-scrollLine) * (lineHeight+lineSpacing));
+}
+
+int UITextInput::getLineAtPosition(Number y) {
+	int line = scrollLine + (int)floor((y - padding) / (lineHeight+lineSpacing));
+	if(line > buffer->getNumLines()-1)
+		line = buffer->getNumLines()-1;
+	if(line < 0)
+		line = 0;
+	return line;
+}
+
+Number UITextInput::getColumnPosition(int line, int column) {
+	String text = buffer->getLine(line);
+	if(column > text.length())
+		column = text.length();
+	if(column <= 0)
+		return padding;
+	return padding + glyphCache->getTextWidth(text.substr(0, column));
+}
+
+int UITextInput::getColumnAtPosition(int line, Number x) {
+	String text = buffer->getLine(line);
+	vector<int> offsets;
+	glyphCache->getCharacterOffsets(text, &offsets);
+	
 	x -= padding;
-	y -= padding;
-	int lineOffset = y  / (lineHeight+lineSpacing);
-	if(lineOffset > lines.size()-1)
-		lineOffset = lines.size()-1;
-
-	ScreenLabel *selectToLine = lines[lineOffset];
-	
-	int len = selectToLine->getText().length();
-	Number slen;
-	int caretPosition = selectToLine->getLabel()->getTextWidth(CoreServices::getInstance()->getFontManager()->getFontByName(fontName), selectToLine->getText().substr(0,len), fontSize);
-	for(int i=0; i < len; i++) {
-		slen = selectToLine->getLabel()->getTextWidth(CoreServices::getInstance()->getFontManager()->getFontByName(fontName), selectToLine->getText().substr(0,i), fontSize);
-		if(slen > x) {
-			caretPosition = i;
-			break;
+	for(int i=1; i < offsets.size(); i++) {
+		if(offsets[i] > x) {
+			// snap to the nearer edge of the character under the mouse
+			if(x - offsets[i-1] < offsets[i] - x)
+				return i-1;
+			return i;
 		}
 	}
-	if(x > slen)
-		caretPosition = len;
+	return text.length();
+}
+
+void UITextInput::updateScrollBar() {
+	if(!vScrollBar)
+		return;
+	int numVisible = getNumVisibleLines();
+	int numLines = buffer->getNumLines();
+	if(numLines > numVisible) {
+		vScrollBar->setHandleRatio((Number)numVisible / (Number)numLines);
+		vScrollBar->enabled = true;
+	} else {
+		vScrollBar->enabled = false;
+	}
+}
+
+void UITextInput::setScrollLine(int line) {
+	int maxScrollLine = buffer->getNumLines() - getNumVisibleLines();
+	if(line > maxScrollLine)
+		line = maxScrollLine;
+	if(line < 0)
+		line = 0;
+	
+	if(line != scrollLine) {
+		scrollLine = line;
+		linesDirty = true;
+		updateSelectionRects();
+	}
+	if(vScrollBar && maxScrollLine > 0)
+		vScrollBar->setScrollValue((Number)scrollLine / (Number)maxScrollLine);
+}
+
+int UITextInput::getScrollLine() {
+	return scrollLine;
+}
+
+void UITextInput::scrollToCaret() {
+	int numVisible = getNumVisibleLines();
+	if(lineOffset < scrollLine) {
+		setScrollLine(lineOffset);
+	} else if(lineOffset > scrollLine + numVisible - 1) {
+		setScrollLine(lineOffset - numVisible + 1);
+	}
+}
+
+void UITextInput::onMouseWheelUp(Number x, Number y) {
+	if(multiLine)
+		setScrollLine(scrollLine - 3);
+}
+
+void UITextInput::onMouseWheelDown(Number x, Number y) {
+	if(multiLine)
+		setScrollLine(scrollLine + 3);
+}
+
+void UITextInput::updateCaretPosition() {
+	if(lineOffset > buffer->getNumLines()-1)
+		lineOffset = buffer->getNumLines()-1;
+	if(caretPosition > buffer->getLineLength(lineOffset))
+		caretPosition = buffer->getLineLength(lineOffset);
 	
-	if(caretPosition < 0)
-		caretPosition = 0;
+	caretImagePosition = getColumnPosition(lineOffset, caretPosition);
+	blinkerRect->visible  = true;
+	blinkTimer->Reset();
+	
+	if(doSelectToCaret) {
+		doSelectToCaret = false;
+		
+	}
+	
+	scrollToCaret();
+}
 
+void UITextInput::dragSelectionTo(Number x, Number y) {
+	int lineOffset = getLineAtPosition(y);
+	int caretPosition = getColumnAtPosition(lineOffset, x);
 	setSelection(this->lineOffset, lineOffset, this->caretPosition, caretPosition);
 }
 
 int UITextInput::caretSkipWordBack(int caretLine, int caretPosition) {
+	String text = buffer->getLine(caretLine);
+	if(caretPosition > text.length())
+		caretPosition = text.length();
 	for(int i=caretPosition; i > 0; i--) {
-		String bit = lines[caretLine]->getText().substr(i,1);
-		wchar_t chr = ((wchar_t*)bit.c_str())[0]; 
-		if(((chr > 0 && chr < 48) || (chr > 57 && chr < 65) || (chr > 90 && chr < 97) || (chr > 122 && chr < 127)) && i < caretPosition-1) {
+		if(i < text.length() && isWordSeparator(text[i]) && i < caretPosition-1) {
 			return i+1;
 		}
 	}	
@@ -439,36 +651,31 @@ int UITextInput::caretSkipWordBack(int caretLine, int caretPosition) {
 }
 
 int UITextInput::caretSkipWordForward(int caretLine, int caretPosition) {
-	int len = lines[caretLine]->getText().length();
+	String text = buffer->getLine(caretLine);
+	int len = text.length();
 	for(int i=caretPosition; i < len; i++) {
-		String bit = lines[caretLine]->getText().substr(i,1);
-		wchar_t chr = ((wchar_t*)bit.c_str())[0]; 
-		if(((chr > 0 && chr < 48) || (chr > 57 && chr < 65) || (chr > 90 && chr < 97) || (chr > 122 && chr < 127)) && i > caretPosition) {
+		if(isWordSeparator(text[i]) && i > caretPosition) {
 			return i;
 		}
 	}
-	return lines[caretLine]->getText().length();	
+	return len;	
 }
 
 void UITextInput::selectWordAtCaret() {
-	
+	String text = buffer->getLine(lineOffset);
 	int selectStart = 0;
-	int len  = currentLine->getText().length();
+	int len  = text.length();
 	int selectEnd = len;
 	
 	for(int i=this->caretPosition; i > 0; i--) {
-		String bit = currentLine->getText().substr(i,1);
-		wchar_t chr = ((wchar_t*)bit.c_str())[0]; 
-		if( (chr > 0 && chr < 48) || (chr > 57 && chr < 65) || (chr > 90 && chr < 97) || (chr > 122 && chr < 127)) {
+		if(i < len && isWordSeparator(text[i])) {
 			selectStart = i+1;
 			break;
 		}
 	}	
 
 	for(int i=this->caretPosition; i < len; i++) {
-		String bit = currentLine->getText().substr(i,1);
-		wchar_t chr = ((wchar_t*)bit.c_str())[0]; 
-		if( (chr > 0 && chr < 48) || (chr > 57 && chr < 65) || (chr > 90 && chr < 97) || (chr > 122 && chr < 127)) {
+		if(isWordSeparator(text[i])) {
 			selectEnd = i;
 			break;			
 		}
@@ -480,82 +687,48 @@ void UITextInput::selectWordAtCaret() {
 
 void UITextInput::setCaretToMouse(Number x, Number y) {
 	clearSelection();
-	x -= padding;
-	y -= padding;
-	//if(lines.size() > 1) {
-		lineOffset = y  / (lineHeight+lineSpacing);
-		if(lineOffset > lines.size()-1)
-			lineOffset = lines.size()-1;
-		selectLineFromOffset();	
-	//}
-	
-	int len = currentLine->getText().length();
-	Number slen;
-	for(int i=0; i < len; i++) {
-		slen = currentLine->getLabel()->getTextWidth(CoreServices::getInstance()->getFontManager()->getFontByName(fontName), currentLine->getText().substr(0,i), fontSize);
-		if(slen > x) {
-			caretPosition = i;
-			break;
-		}
-	}
-	if(x > slen)
-		caretPosition = len;
+	lineOffset = getLineAtPosition(y);
+	caretPosition = getColumnAtPosition(lineOffset, x);
 	updateCaretPosition();	
 }
 
-void UITextInput::removeLine(ScreenLabel *line) {
-	for(int i=0;i<lines.size();i++) {
-		if(lines[i] == line) {
-			lines.erase(lines.begin()+i);
-		}
-	}
-	removeChild(line);
-	delete line;
-	restructLines();
-}
-
 void UITextInput::selectAll() {
-	setSelection(0, lines.size()-1, 0, lines[lines.size()-1]->getText().length());
+	int lastLine = buffer->getNumLines()-1;
+	setSelection(0, lastLine, 0, buffer->getLineLength(lastLine));
 }
 
 void UITextInput::insertText(String text) {
-	vector<String> strings = text.split("\n");
-	int numLines = lines.size();
-	for(int i=0; i < strings.size(); i++) {
-		if(i < numLines) {
-			lines[i]->setText(strings[i]);
-		} else {
-			numLines++;		
-			ScreenLabel *newLine = new ScreenLabel(L"", fontSize, fontName, Label::ANTIALIAS_FULL);
-			newLine->setColor(0,0,0,1);
-			addChild(newLine);			
-			lines.push_back(newLine);
-			newLine->setText(strings[i]);
-		}
-	}
-	restructLines();	
-}
-
-String UITextInput::getSelectionText() {
-	String totalText = L"";
-	if(selectionTop == selectionBottom) {
-		totalText = lines[selectionTop]->getText().substr(selectionL, selectionR-selectionL);	
-		return totalText;
-	} else {
-		totalText += lines[selectionTop]->getText().substr(selectionL, lines[selectionTop]->getText().length()-selectionL);
-		totalText += L"\n";		
+	if(!multiLine) {
+		vector<String> strings = text.split("\n");
+		if(strings.size() == 0)
+			return;
+		text = strings[0];
 	}
 	
-	if(selectionBottom > selectionTop+1) {
-		for(int i=selectionTop+1; i <= selectionBottom; i++) {
-			totalText += lines[i]->getText();			
-			totalText += L"\n";
-		}
-	}
+	if(hasSelection)
+		deleteSelection();
 	
-	totalText += lines[selectionBottom]->getText().substr(0, selectionL);
+	insertTextAt(lineOffset, caretPosition, text);
 	
-	return totalText;
+	size_t lastBreak = text.rfind("\n");
+	if(lastBreak == std::wstring::npos) {
+		caretPosition += text.length();
+	} else {
+		lineOffset += countLineBreaks(text);
+		caretPosition = text.length() - lastBreak - 1;
+	}
+	updateCaretPosition();
+	dispatchEvent(new UIEvent(), UIEvent::CHANGE_EVENT);
+}
+
+String UITextInput::getSelectionText() {
+	if(!hasSelection)
+		return String();
+	unsigned int start = getTextOffset(selectionTop, selectionL);
+	unsigned int end = getTextOffset(selectionBottom, selectionR);
+	if(end <= start)
+		return String();
+	return buffer->getText(start, end-start);
 }
 
 void UITextInput::onKeyDown(PolyKEY key, wchar_t charCode) {
@@ -587,6 +760,7 @@ void UITextInput::onKeyDown(PolyKEY key, wchar_t charCode) {
 		return;
 	}	
 	
+	int lineLength = buffer->getLineLength(lineOffset);
 	
 	if(key == KEY_LEFT) {
 		if(input->getKeyState(KEY_LSUPER) || input->getKeyState(KEY_RSUPER)) {
@@ -633,16 +807,16 @@ void UITextInput::onKeyDown(PolyKEY key, wchar_t charCode) {
 	}
 	
 	if(key == KEY_RIGHT) {
-		if(caretPosition < currentLine->getText().length()) {			
+		if(caretPosition < lineLength) {			
 			if(input->getKeyState(KEY_LSUPER) || input->getKeyState(KEY_RSUPER)) {
 				if(input->getKeyState(KEY_LSHIFT) || input->getKeyState(KEY_RSHIFT)) {
 					if(hasSelection) {
-						setSelection(this->lineOffset, selectionLine, this->caretPosition, lines[selectionLine]->getText().length());					
+						setSelection(this->lineOffset, selectionLine, this->caretPosition, buffer->getLineLength(selectionLine));					
 					} else {
-						setSelection(this->lineOffset, this->lineOffset, this->caretPosition, currentLine->getText().length());
+						setSelection(this->lineOffset, this->lineOffset, this->caretPosition, lineLength);
 					}
 				} else {
-					caretPosition = currentLine->getText().length();
+					caretPosition = lineLength;
 					clearSelection();
 				}				
 			} else if (input->getKeyState(KEY_LALT) || input->getKeyState(KEY_RALT)) {
@@ -687,7 +861,6 @@ void UITextInput::onKeyDown(PolyKEY key, wchar_t charCode) {
 				clearSelection();				
 				if(lineOffset > 0) {
 					lineOffset--;
-					selectLineFromOffset();
 					updateCaretPosition();							
 				}
 			}
@@ -700,17 +873,16 @@ void UITextInput::onKeyDown(PolyKEY key, wchar_t charCode) {
 		if(multiLine) {
 			if(input->getKeyState(KEY_LSHIFT) || input->getKeyState(KEY_RSHIFT)) {			
 				if(hasSelection) {
-					if(selectionLine < lines.size()-1)
+					if(selectionLine < buffer->getNumLines()-1)
 						setSelection(this->lineOffset, selectionLine+1, this->caretPosition, selectionCaretPosition);
 				} else {
-					if(this->lineOffset < lines.size()-1)					
+					if(this->lineOffset < buffer->getNumLines()-1)					
 						setSelection(this->lineOffset, this->lineOffset+1, this->caretPosition, caretPosition);					
 				}				
 			} else {				
 				clearSelection();
-				if(lineOffset < lines.size()-1) {
+				if(lineOffset < buffer->getNumLines()-1) {
 					lineOffset++;
-					selectLineFromOffset();
 					updateCaretPosition();										
 				}
 			}
@@ -730,18 +902,12 @@ void UITextInput::onKeyDown(PolyKEY key, wchar_t charCode) {
 		return;
 	}	
 	
-	String ctext = currentLine->getText();
-	
-	
 //	if(1) {
 	if((charCode > 31 && charCode < 127) || charCode > 127) {	
 		if(!isNumberOnly || (isNumberOnly && (charCode > 47 && charCode < 58))) {
 			if(hasSelection)
 				deleteSelection();
-			ctext = currentLine->getText();		
-			String text2 = ctext.substr(caretPosition, ctext.length()-caretPosition);
-			ctext = ctext.substr(0,caretPosition);
-			ctext += charCode + text2;
+			insertTextAt(lineOffset, caretPosition, String(charCode));
 			caretPosition++;
 		}
 	}
@@ -749,10 +915,7 @@ void UITextInput::onKeyDown(PolyKEY key, wchar_t charCode) {
 	if(key == KEY_TAB && multiLine) {
 		if(hasSelection)
 			deleteSelection();		
-		ctext = currentLine->getText();				
-		String text2 = ctext.substr(caretPosition, ctext.length()-caretPosition);
-		ctext = ctext.substr(0,caretPosition);
-		ctext += (wchar_t)'\t' + text2;
+		insertTextAt(lineOffset, caretPosition, String((wchar_t)'\t'));
 		caretPosition++;		
 	}
 	
@@ -761,39 +924,33 @@ void UITextInput::onKeyDown(PolyKEY key, wchar_t charCode) {
 			deleteSelection();
 			return;
 		} else {
-		ctext = currentLine->getText();					
 		if(caretPosition > 0) {
-			if(ctext.length() > 0) {
-				String text2 = ctext.substr(caretPosition, ctext.length()-caretPosition);
-				ctext = ctext.substr(0,caretPosition-1);
-				ctext += text2;
-				caretPosition--;
-			}
+			removeText(lineOffset, caretPosition-1, lineOffset, caretPosition);
+			caretPosition--;
 		} else {
 			if(lineOffset > 0) {
-				ScreenLabel *lineToRemove = currentLine;
+				// join with the previous line
+				int previousLength = buffer->getLineLength(lineOffset-1);
+				removeText(lineOffset-1, previousLength, lineOffset, 0);
 				lineOffset--;
-				selectLineFromOffset();
-				caretPosition = currentLine->getText().length();
-				updateCaretPosition();
-				currentLine->setText(currentLine->getText() + ctext);	
-				removeLine(lineToRemove);				
-				return;
+				caretPosition = previousLength;
 			}
 		}
 		}
 	}
 	
-	currentLine->setText(ctext);	
 	dispatchEvent(new UIEvent(), UIEvent::CHANGE_EVENT);	
 	updateCaretPosition();
 }
 
 void UITextInput::Update() {
+	if(linesDirty)
+		updateLines();
+	
 	if(hasSelection) {
 		blinkerRect->visible = false;
 	}
-	blinkerRect->setPosition(caretImagePosition,currentLine->getPosition2D().y);
+	blinkerRect->setPosition(caretImagePosition, getLinePosition(lineOffset));
 	if(hasFocus) {
 //		inputRect->setStrokeColor(1.0f, 1.0f, 1.0f, 0.25f);	
 	} else {
@@ -801,10 +958,13 @@ void UITextInput::Update() {
 //		inputRect->setStrokeColor(1.0f, 1.0f, 1.0f, 0.1f);
 	}
 	
+	if(lineOffset < scrollLine || lineOffset > scrollLine + getNumVisibleLines() - 1) {
+		blinkerRect->visible = false;
+	}
 }
 
 UITextInput::~UITextInput() {
-
+	delete buffer;
 }
 		
 void UITextInput::handleEvent(Event *event) {
@@ -839,6 +999,20 @@ void UITextInput::handleEvent(Event *event) {
 		}
 	}
 	
+	if(event->getDispatcher() == vScrollBar) {
+		if(event->getEventCode() == Event::CHANGE_EVENT) {
+			int maxScrollLine = buffer->getNumLines() - getNumVisibleLines();
+			if(maxScrollLine > 0) {
+				int newScrollLine = (int)floor((vScrollBar->getScrollValue() * maxScrollLine) + 0.5);
+				if(newScrollLine != scrollLine) {
+					scrollLine = newScrollLine;
+					linesDirty = true;
+					updateSelectionRects();
+				}
+			}
+		}
+	}
+	
 	if(event->getDispatcher() == blinkTimer) {
 		if(hasSelection || draggingSelection) {
 				blinkerRect->visible  = false;
@@ -850,4 +1024,4 @@ void UITextInput::handleEvent(Event *event) {
 		}
 	}
 	
-}
\ No newline at end of file
+}
@@ -27,10 +27,14 @@ using namespace Polycode;
 
 UITreeEvent::UITreeEvent(UITree *selection) {
 	this->selection = selection;
+	node = NULL;
 	eventType = "UITreeEvent";
 }
 
 UITreeEvent::UITreeEvent() {
+	selection = NULL;
+	node = NULL;
+	eventType = "UITreeEvent";
 
 }
 
@@ -149,6 +149,12 @@ Number UIVScrollBar::getScrollValue() {
 	return scrollValue;
 }
 
+void UIVScrollBar::setScrollValue(Number newValue) {
+	if(newValue < 0) newValue = 0;
+	if(newValue > 1) newValue = 1;
+	handleBox->setPositionY(padding + (newValue * dragRectHeight));
+}
+
 void UIVScrollBar::handleEvent(Event *event) {
 	if(event->getDispatcher() == bgBox) {
 		InputEvent *inputEvent = (InputEvent*)event;
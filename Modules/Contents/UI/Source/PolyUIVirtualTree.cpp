@@ -0,0 +1,626 @@
+/*
+Copyright (C) 2011 by Ivan Safrin
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+ 
+
+#include "PolyUIVirtualTree.h"
+#include "PolyConfig.h"
+#include "PolyInputEvent.h"
+#include "PolyLabel.h"
+#include "PolyCoreServices.h"
+#include "PolyMaterialManager.h"
+#include <math.h>
+
+using namespace Polycode;
+
+UIRowOffsetIndex::UIRowOffsetIndex() {
+	highestStep = 0;
+}
+
+UIRowOffsetIndex::~UIRowOffsetIndex() {
+
+}
+
+void UIRowOffsetIndex::build(const vector<Number> &rowHeights) {
+	heights = rowHeights;
+	int numRows = heights.size();
+	
+	// Fenwick tree: node i holds the sum of the (i & -i) rows ending at row i-1.
+	tree.assign(numRows+1, 0);
+	for(int i=1; i <= numRows; i++) {
+		tree[i] += heights[i-1];
+		int next = i + (i & -i);
+		if(next <= numRows)
+			tree[next] += tree[i];
+	}
+	
+	highestStep = 1;
+	while(highestStep * 2 <= numRows)
+		highestStep *= 2;
+}
+
+void UIRowOffsetIndex::setRowHeight(int row, Number height) {
+	if(row < 0 || row >= heights.size())
+		return;
+	Number delta = height - heights[row];
+	heights[row] = height;
+	for(int i=row+1; i < tree.size(); i += (i & -i)) {
+		tree[i] += delta;
+	}
+}
+
+Number UIRowOffsetIndex::getRowHeight(int row) const {
+	if(row < 0 || row >= heights.size())
+		return 0;
+	return heights[row];
+}
+
+Number UIRowOffsetIndex::getRowOffset(int row) const {
+	if(row > (int)heights.size())
+		row = heights.size();
+	Number offset = 0;
+	for(int i=row; i > 0; i -= (i & -i)) {
+		offset += tree[i];
+	}
+	return offset;
+}
+
+int UIRowOffsetIndex::getRowAt(Number offset) const {
+	int numRows = heights.size();
+	if(numRows == 0)
+		return -1;
+	
+	// Find the number of rows that end at or before the offset by walking down the tree.
+	int row = 0;
+	Number remaining = offset;
+	for(int step = highestStep; step > 0; step /= 2) {
+		if(row + step <= numRows && tree[row+step] <= remaining) {
+			row += step;
+			remaining -= tree[row];
+		}
+	}
+	if(row >= numRows)
+		row = numRows-1;
+	return row;
+}
+
+Number UIRowOffsetIndex::getTotalHeight() const {
+	return getRowOffset(heights.size());
+}
+
+int UIRowOffsetIndex::getNumRows() const {
+	return heights.size();
+}
+
+UIVirtualTreeItem::UIVirtualTreeItem() {
+	node = NULL;
+	depth = 0;
+	expanded = false;
+	hasChildren = false;
+}
+
+UIVirtualTreeRow::UIVirtualTreeRow(const String &icon, Number rowWidth, Number rowHeight) : ScreenEntity() {
+	Config *conf = CoreServices::getInstance()->getConfig();
+	
+	row = -1;
+	node = NULL;
+	indent = 0;
+	iconFile = icon;
+	this->rowWidth = rowWidth;
+	this->rowHeight = rowHeight;
+	cellPadding = conf->getNumericValue("Polycode", "uiTreeCellPadding");
+	
+	bgBox = new ScreenShape(ScreenShape::SHAPE_RECT, rowWidth, rowHeight);
+	bgBox->setPositionMode(ScreenEntity::POSITION_TOPLEFT);
+	bgBox->setColor(1, 1, 1, 0);
+	bgBox->processInputEvents = true;
+	addChild(bgBox);
+	
+	Number st = conf->getNumericValue("Polycode", "uiTreeCellSelectorSkinT");
+	Number sr = conf->getNumericValue("Polycode", "uiTreeCellSelectorSkinR");
+	Number sb = conf->getNumericValue("Polycode", "uiTreeCellSelectorSkinB");
+	Number sl = conf->getNumericValue("Polycode", "uiTreeCellSelectorSkinL");
+	selectionPadding = conf->getNumericValue("Polycode", "uiTreeCellSelectorSkinPadding");
+	
+	selection = new UIBox(conf->getStringValue("Polycode", "uiTreeCellSelectorSkin"),
+						  st,sr,sb,sl,
+						  rowWidth+(selectionPadding*2), rowHeight+(selectionPadding*2));
+	selection->setPositionMode(ScreenEntity::POSITION_TOPLEFT);
+	selection->visible = false;
+	addChild(selection);
+	
+	arrowIconImage = new ScreenImage(conf->getStringValue("Polycode", "uiTreeArrowIconImage"));
+	arrowIconImage->processInputEvents = true;
+	addChild(arrowIconImage);
+	
+	iconImage = new ScreenImage(icon);
+	addChild(iconImage);
+	
+	textLabel = new ScreenLabel("",
+								conf->getNumericValue("Polycode", "uiDefaultFontSize"),
+								conf->getStringValue("Polycode", "uiDefaultFontName"),
+								Label::ANTIALIAS_FULL);
+	addChild(textLabel);
+	
+	layout();
+}
+
+UIVirtualTreeRow::~UIVirtualTreeRow() {
+	removeChild(bgBox);
+	removeChild(selection);
+	removeChild(arrowIconImage);
+	removeChild(iconImage);
+	removeChild(textLabel);
+	delete bgBox;
+	delete selection;
+	delete arrowIconImage;
+	delete iconImage;
+	delete textLabel;
+}
+
+void UIVirtualTreeRow::setRowSize(Number rowWidth, Number rowHeight) {
+	if(rowWidth == this->rowWidth && rowHeight == this->rowHeight)
+		return;
+	this->rowWidth = rowWidth;
+	this->rowHeight = rowHeight;
+	bgBox->setShapeSize(rowWidth, rowHeight);
+	selection->resizeBox(rowWidth+(selectionPadding*2), rowHeight+(selectionPadding*2));
+	layout();
+}
+
+void UIVirtualTreeRow::setContent(const String &text, const String &icon, Number indent, bool expandable, bool expanded, bool selected) {
+	// Recycled rows usually show the same node again, so only touch what changed.
+	if(text != labelText) {
+		labelText = text;
+		textLabel->setText(text);
+	}
+	if(icon != iconFile) {
+		iconFile = icon;
+		iconImage->setTexture(CoreServices::getInstance()->getMaterialManager()->createTextureFromFile(icon));
+	}
+	
+	arrowIconImage->visible = expandable;
+	arrowIconImage->enabled = expandable;
+	arrowIconImage->setRotation(expanded ? 90 : 0);
+	selection->visible = selected;
+	
+	if(indent != this->indent) {
+		this->indent = indent;
+		layout();
+	}
+}
+
+void UIVirtualTreeRow::layout() {
+	selection->setPosition(-selectionPadding, -selectionPadding);
+	arrowIconImage->setPosition(indent+cellPadding, (rowHeight-arrowIconImage->getHeight())/2.0f);
+	iconImage->setPosition(indent+arrowIconImage->getWidth()+(cellPadding*2), (rowHeight-iconImage->getHeight())/2.0f);
+	textLabel->setPosition(indent+arrowIconImage->getWidth()+iconImage->getWidth()+(cellPadding*3), (int)((rowHeight-(textLabel->getHeight()-6))/2.0f));
+	
+	width = rowWidth;
+	height = rowHeight;
+	hitwidth = rowWidth;
+	hitheight = rowHeight;
+}
+
+UIVirtualTree::UIVirtualTree(UITreeDataSource *dataSource, String defaultIcon, Number treeWidth, Number treeHeight) : ScreenEntity() {
+	Config *conf = CoreServices::getInstance()->getConfig();
+	
+	this->dataSource = dataSource;
+	this->defaultIcon = defaultIcon;
+	
+	selectedNode = NULL;
+	pressedRow = NULL;
+	willDrag = false;
+	isDragging = false;
+	rowsDirty = true;
+	
+	indentSize = 11;
+	scrollOffset = 0;
+	contentHeight = 0;
+	
+	cellHeight = conf->getNumericValue("Polycode", "uiTreeCellHeight");
+	scrollBarSize = conf->getNumericValue("Polycode", "uiScrollDefaultSize");
+	scrollBarPadding = conf->getNumericValue("Polycode", "uiScrollPanePadding");
+	
+	Number st = conf->getNumericValue("Polycode", "uiTreeContainerSkinT");
+	Number sr = conf->getNumericValue("Polycode", "uiTreeContainerSkinR");
+	Number sb = conf->getNumericValue("Polycode", "uiTreeContainerSkinB");
+	Number sl = conf->getNumericValue("Polycode", "uiTreeContainerSkinL");
+	
+	bgBox = new UIBox(conf->getStringValue("Polycode", "uiTreeContainerSkin"),
+						  st,sr,sb,sl,
+						  treeWidth, treeHeight);
+	addChild(bgBox);
+	
+	viewWidth = treeWidth - scrollBarSize;
+	viewHeight = treeHeight;
+	
+	maskShape = new ScreenShape(ScreenShape::SHAPE_RECT, viewWidth, viewHeight);
+	maskShape->setPositionMode(ScreenEntity::POSITION_TOPLEFT);
+	addChild(maskShape);
+	
+	rowContainer = new ScreenEntity();
+	rowContainer->setPositionMode(ScreenEntity::POSITION_TOPLEFT);
+	addChild(rowContainer);
+	rowContainer->setMask(maskShape);
+	
+	vScrollBar = new UIVScrollBar(scrollBarSize, viewHeight, 1);
+	addChild(vScrollBar);
+	vScrollBar->setPosition(viewWidth+scrollBarPadding, 0);
+	vScrollBar->addEventListener(this, Event::CHANGE_EVENT);
+	vScrollBar->enabled = false;
+	
+	width = treeWidth;
+	height = treeHeight;
+	hitwidth = width;
+	hitheight = height;
+	
+	reloadData();
+}
+
+UIVirtualTree::~UIVirtualTree() {
+	for(int i=0; i < rowWidgets.size(); i++) {
+		rowContainer->removeChild(rowWidgets[i]);
+		delete rowWidgets[i];
+	}
+}
+
+void UIVirtualTree::reloadData() {
+	items.clear();
+	pressedRow = NULL;
+	int numChildren = dataSource->getNumChildren(NULL);
+	for(int i=0; i < numChildren; i++) {
+		UIVirtualTreeItem item;
+		item.node = dataSource->getChild(NULL, i);
+		item.hasChildren = dataSource->hasChildren(item.node);
+		items.push_back(item);
+	}
+	rebuildOffsets();
+}
+
+void UIVirtualTree::reloadRow(int row) {
+	if(row < 0 || row >= items.size())
+		return;
+	removeChildren(row);
+	items[row].hasChildren = dataSource->hasChildren(items[row].node);
+	if(items[row].expanded && items[row].hasChildren) {
+		insertChildren(row);
+	} else {
+		items[row].expanded = false;
+	}
+	rebuildOffsets();
+}
+
+void UIVirtualTree::insertChildren(int row) {
+	void *node = items[row].node;
+	int numChildren = dataSource->getNumChildren(node);
+	
+	vector<UIVirtualTreeItem> children;
+	for(int i=0; i < numChildren; i++) {
+		UIVirtualTreeItem item;
+		item.node = dataSource->getChild(node, i);
+		item.depth = items[row].depth + 1;
+		item.hasChildren = dataSource->hasChildren(item.node);
+		children.push_back(item);
+	}
+	items.insert(items.begin()+row+1, children.begin(), children.end());
+}
+
+void UIVirtualTree::removeChildren(int row) {
+	int end = row+1;
+	while(end < items.size() && items[end].depth > items[row].depth) {
+		end++;
+	}
+	items.erase(items.begin()+row+1, items.begin()+end);
+}
+
+void UIVirtualTree::expandRow(int row) {
+	if(row < 0 || row >= items.size())
+		return;
+	if(items[row].expanded || !items[row].hasChildren)
+		return;
+	items[row].expanded = true;
+	insertChildren(row);
+	rebuildOffsets();
+}
+
+void UIVirtualTree::collapseRow(int row) {
+	if(row < 0 || row >= items.size())
+		return;
+	if(!items[row].expanded)
+		return;
+	items[row].expanded = false;
+	removeChildren(row);
+	rebuildOffsets();
+}
+
+void UIVirtualTree::toggleRow(int row) {
+	if(isRowExpanded(row))
+		collapseRow(row);
+	else
+		expandRow(row);
+}
+
+bool UIVirtualTree::isRowExpanded(int row) {
+	if(row < 0 || row >= items.size())
+		return false;
+	return items[row].expanded;
+}
+
+int UIVirtualTree::getNumRows() {
+	return items.size();
+}
+
+void *UIVirtualTree::getRowNode(int row) {
+	if(row < 0 || row >= items.size())
+		return NULL;
+	return items[row].node;
+}
+
+int UIVirtualTree::getRowDepth(int row) {
+	if(row < 0 || row >= items.size())
+		return 0;
+	return items[row].depth;
+}
+
+int UIVirtualTree::getRowForNode(void *node) {
+	for(int i=0; i < items.size(); i++) {
+		if(items[i].node == node)
+			return i;
+	}
+	return -1;
+}
+
+void UIVirtualTree::setSelectedNode(void *node) {
+	selectedNode = node;
+	rowsDirty = true;
+}
+
+void *UIVirtualTree::getSelectedNode() {
+	return selectedNode;
+}
+
+void UIVirtualTree::scrollToRow(int row) {
+	if(row < 0 || row >= items.size() || contentHeight <= viewHeight)
+		return;
+	
+	Number top = offsets.getRowOffset(row);
+	Number bottom = top + offsets.getRowHeight(row);
+	Number newOffset = scrollOffset;
+	if(top < scrollOffset)
+		newOffset = top;
+	else if(bottom > scrollOffset + viewHeight)
+		newOffset = bottom - viewHeight;
+	
+	if(newOffset != scrollOffset) {
+		scrollOffset = newOffset;
+		vScrollBar->setScrollValue(scrollOffset / (contentHeight - viewHeight));
+		rowsDirty = true;
+	}
+}
+
+Number UIVirtualTree::getScrollOffset() {
+	return scrollOffset;
+}
+
+int UIVirtualTree::getNumRowWidgets() {
+	return rowWidgets.size();
+}
+
+void UIVirtualTree::rebuildOffsets() {
+	vector<Number> rowHeights;
+	rowHeights.reserve(items.size());
+	for(int i=0; i < items.size(); i++) {
+		Number rowHeight = dataSource->getRowHeight(items[i].node);
+		if(rowHeight <= 0)
+			rowHeight = cellHeight;
+		rowHeights.push_back(rowHeight);
+	}
+	offsets.build(rowHeights);
+	refreshContent();
+}
+
+void UIVirtualTree::refreshContent() {
+	contentHeight = offsets.getTotalHeight();
+	
+	if(contentHeight > viewHeight) {
+		vScrollBar->setHandleRatio(viewHeight / contentHeight);
+		vScrollBar->enabled = true;
+		scrollOffset = floor((contentHeight - viewHeight) * vScrollBar->getScrollValue());
+	} else {
+		vScrollBar->setHandleRatio(1);
+		vScrollBar->enabled = false;
+		scrollOffset = 0;
+	}
+	
+	// Rebind right away so row widgets never refer to rows that no longer exist.
+	updateRows();
+}
+
+void UIVirtualTree::Resize(int x, int y) {
+	width = x;
+	height = y;
+	hitwidth = width;
+	hitheight = height;
+	
+	viewWidth = x - scrollBarSize;
+	viewHeight = y;
+	
+	bgBox->resizeBox(x, y);
+	maskShape->setShapeSize(viewWidth, viewHeight);
+	vScrollBar->Resize(y);
+	vScrollBar->setPosition(viewWidth+scrollBarPadding, 0);
+	refreshContent();
+}
+
+UIVirtualTreeRow *UIVirtualTree::createRowWidget() {
+	UIVirtualTreeRow *widget = new UIVirtualTreeRow(defaultIcon, viewWidth, cellHeight);
+	widget->bgBox->addEventListener(this, InputEvent::EVENT_MOUSEUP);
+	widget->bgBox->addEventListener(this, InputEvent::EVENT_MOUSEUP_OUTSIDE);
+	widget->bgBox->addEventListener(this, InputEvent::EVENT_MOUSEMOVE);
+	widget->bgBox->addEventListener(this, InputEvent::EVENT_MOUSEDOWN);
+	widget->bgBox->addEventListener(this, InputEvent::EVENT_DOUBLECLICK);
+	widget->arrowIconImage->addEventListener(this, InputEvent::EVENT_MOUSEDOWN);
+	rowContainer->addChild(widget);
+	rowWidgets.push_back(widget);
+	return widget;
+}
+
+void UIVirtualTree::bindRow(UIVirtualTreeRow *widget, int row) {
+	UIVirtualTreeItem &item = items[row];
+	
+	String icon = dataSource->getIcon(item.node);
+	if(icon == "")
+		icon = defaultIcon;
+	
+	widget->row = row;
+	widget->node = item.node;
+	widget->visible = true;
+	widget->enabled = true;
+	widget->setRowSize(viewWidth, offsets.getRowHeight(row));
+	widget->setContent(dataSource->getLabel(item.node), icon, item.depth * indentSize, item.hasChildren, item.expanded, item.node == selectedNode);
+	widget->setPosition(0, offsets.getRowOffset(row) - scrollOffset);
+}
+
+void UIVirtualTree::updateRows() {
+	rowsDirty = false;
+	
+	int firstRow = offsets.getRowAt(scrollOffset);
+	int lastRow = offsets.getRowAt(scrollOffset + viewHeight);
+	if(firstRow < 0) {
+		firstRow = 0;
+		lastRow = -1;
+	}
+	
+	// Rows that stay in view keep their widget so their labels are not rendered again.
+	vector<bool> widgetUsed(rowWidgets.size(), false);
+	vector<bool> rowBound(lastRow - firstRow + 1, false);
+	for(int i=0; i < rowWidgets.size(); i++) {
+		UIVirtualTreeRow *widget = rowWidgets[i];
+		if(widget->row >= firstRow && widget->row <= lastRow && items[widget->row].node == widget->node && !rowBound[widget->row - firstRow]) {
+			bindRow(widget, widget->row);
+			widgetUsed[i] = true;
+			rowBound[widget->row - firstRow] = true;
+		}
+	}
+	
+	int nextWidget = 0;
+	for(int row = firstRow; row <= lastRow; row++) {
+		if(rowBound[row - firstRow])
+			continue;
+		while(nextWidget < widgetUsed.size() && widgetUsed[nextWidget])
+			nextWidget++;
+		if(nextWidget < widgetUsed.size()) {
+			widgetUsed[nextWidget] = true;
+			bindRow(rowWidgets[nextWidget], row);
+		} else {
+			bindRow(createRowWidget(), row);
+		}
+	}
+	
+	for(int i=0; i < widgetUsed.size(); i++) {
+		if(!widgetUsed[i]) {
+			rowWidgets[i]->row = -1;
+			rowWidgets[i]->visible = false;
+			rowWidgets[i]->enabled = false;
+		}
+	}
+}
+
+void UIVirtualTree::Update() {
+	if(rowsDirty)
+		updateRows();
+}
+
+void UIVirtualTree::onMouseWheelUp(Number x, Number y) {
+	if(vScrollBar->enabled)
+		vScrollBar->scrollUpOneTick();
+}
+
+void UIVirtualTree::onMouseWheelDown(Number x, Number y) {
+	if(vScrollBar->enabled)
+		vScrollBar->scrollDownOneTick();
+}
+
+void UIVirtualTree::handleEvent(Event *event) {
+	if(event->getDispatcher() == vScrollBar) {
+		if(event->getEventCode() == Event::CHANGE_EVENT && contentHeight > viewHeight) {
+			scrollOffset = floor((contentHeight - viewHeight) * vScrollBar->getScrollValue());
+			rowsDirty = true;
+		}
+		return;
+	}
+	
+	for(int i=0; i < rowWidgets.size(); i++) {
+		UIVirtualTreeRow *widget = rowWidgets[i];
+		if(widget->row < 0)
+			continue;
+		
+		if(event->getDispatcher() == widget->arrowIconImage) {
+			toggleRow(widget->row);
+			return;
+		}
+		
+		if(event->getDispatcher() == widget->bgBox) {
+			UITreeEvent *treeEvent;
+			switch(event->getEventCode()) {
+				case InputEvent::EVENT_MOUSEUP:
+					if(pressedRow == widget && !isDragging) {
+						setSelectedNode(widget->node);
+						treeEvent = new UITreeEvent();
+						treeEvent->node = widget->node;
+						dispatchEvent(treeEvent, UITreeEvent::SELECTED_EVENT);
+					}
+					pressedRow = NULL;
+					willDrag = false;
+					isDragging = false;
+				break;
+				case InputEvent::EVENT_MOUSEUP_OUTSIDE:
+					if(pressedRow == widget) {
+						pressedRow = NULL;
+						willDrag = false;
+						isDragging = false;
+					}
+				break;
+				case InputEvent::EVENT_MOUSEDOWN:
+					pressedRow = widget;
+					willDrag = true;
+				break;
+				case InputEvent::EVENT_MOUSEMOVE:
+					if(pressedRow == widget && willDrag && !isDragging) {
+						isDragging = true;
+						treeEvent = new UITreeEvent();
+						treeEvent->node = widget->node;
+						dispatchEvent(treeEvent, UITreeEvent::DRAG_START_EVENT);
+					}
+				break;
+				case InputEvent::EVENT_DOUBLECLICK:
+					treeEvent = new UITreeEvent();
+					treeEvent->node = widget->node;
+					dispatchEvent(treeEvent, UITreeEvent::EXECUTED_EVENT);
+				break;
+				default:
+				break;
+			}
+			return;
+		}
+	}
+}
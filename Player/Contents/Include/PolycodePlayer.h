@@ -24,6 +24,7 @@ THE SOFTWARE.
 
 #include <iostream>
 #include <fstream>
+#include <map>
 
 #include "Polycode.h"
 #include "PolycodeLUA.h"
@@ -68,6 +69,16 @@ public:
 	
 	void loadFile(const char *fileName);
 	void runFile(String fileName);
+	
+	/**
+	* Returns the file a required module is loaded from, or an empty string if it can't be found. Modules listed in the app's script index resolve without touching the filesystem and every other lookup is cached, so each module is only probed for once.
+	*/
+	String getModulePath(const String &module);
+	
+	/**
+	* Loads a Lua source or precompiled bytecode file and pushes the compiled chunk, or an error message, onto the stack. Returns the luaL_loadbuffer status.
+	*/
+	int loadScript(lua_State *L, const String &fileName, const String &chunkName);
 		
 	int report (lua_State *L, int status);
 	
@@ -95,6 +106,7 @@ protected:
 	lua_State *L;		
 	
 	std::vector<String> loadedModules;
+	std::map<std::string, String> modulePaths;
 	
 	bool _knownArchive;
 	String fileToRun;
@@ -22,6 +22,7 @@ THE SOFTWARE.
 
 #include "PolycodePlayer.h"
 #include <string>
+#include <string.h>
 
 extern "C" {	
 //	extern int luaopen_Tau(lua_State* L); // declare the wrapped module
@@ -29,35 +30,18 @@ extern "C" {
 	
 	int MyLoader(lua_State* pState)
 	{		
-		std::string module = lua_tostring(pState, 1);
-		module += ".lua";
+		PolycodePlayer *player = (PolycodePlayer*)lua_touserdata(pState, lua_upvalueindex(1));
+		String module = lua_tostring(pState, 1);
 		
-		std::string defaultPath = "API/";
-		defaultPath.append(module);
-		
-		const char* fullPath = module.c_str();		
-		Logger::log("Loading custom class: %s\n", module.c_str());
-		OSFILE *inFile = OSBasics::open(module, "r");	
-		
-		if(!inFile) {
-			inFile =  OSBasics::open(defaultPath, "r");	
+		String fullPath = player->getModulePath(module);
+		if(fullPath == "") {
+			String err = "\n\tError - Could could not find " + module + ".lua.";
+			lua_pushstring(pState, err.c_str());
+			return 1;
 		}
 		
-		if(inFile) {
-			OSBasics::seek(inFile, 0, SEEK_END);	
-			long progsize = OSBasics::tell(inFile);
-			OSBasics::seek(inFile, 0, SEEK_SET);
-			char *buffer = (char*)malloc(progsize+1);
-			memset(buffer, 0, progsize+1);
-			OSBasics::read(buffer, progsize, 1, inFile);
-			luaL_loadbuffer(pState, (const char*)buffer, progsize, fullPath);		
-			//free(buffer);
-			OSBasics::close(inFile);	
-		} else {
-			std::string err = "\n\tError - Could could not find ";
-			err += module;
-			err += ".";			
-			lua_pushstring(pState, err.c_str());			
+		if(player->loadScript(pState, fullPath, "@" + fullPath) != 0) {
+			return luaL_error(pState, "error loading module %s:\n\t%s", module.c_str(), lua_tostring(pState, -1));
 		}
 		return 1;
 	}
@@ -103,6 +87,70 @@ extern "C" {
 		return status;
 	}	
 	
+	String PolycodePlayer::getModulePath(const String &module) {
+		std::map<std::string, String>::iterator it = modulePaths.find(module.getSTLString());
+		if(it != modulePaths.end()) {
+			return it->second;
+		}
+		
+		String fullPath = "";
+		String candidates[2] = { module + ".lua", "API/" + module + ".lua" };
+		for(int i=0; i < 2; i++) {
+			OSFILE *inFile = OSBasics::open(candidates[i], "rb");
+			if(inFile) {
+				OSBasics::close(inFile);
+				fullPath = candidates[i];
+				break;
+			}
+		}
+		
+		// misses are cached as well, require() falls through to the next loader for those
+		modulePaths[module.getSTLString()] = fullPath;
+		return fullPath;
+	}
+	
+	static int writeLuaChunk(lua_State *L, const void *data, size_t size, void *userData) {
+		std::vector<char> *output = (std::vector<char>*)userData;
+		output->insert(output->end(), (const char*)data, (const char*)data + size);
+		return 0;
+	}
+	
+	// Compares the header of a precompiled chunk (version, format, endianness and type sizes) with what this Lua build writes.
+	static bool isNativeBytecode(lua_State *L, const std::vector<char> &chunk) {
+		static std::vector<char> header;
+		if(header.size() == 0) {
+			luaL_loadstring(L, "");
+			lua_dump(L, writeLuaChunk, &header);
+			lua_pop(L, 1);
+		}
+		return chunk.size() >= 12 && header.size() >= 12 && memcmp(&chunk[0], &header[0], 12) == 0;
+	}
+	
+	int PolycodePlayer::loadScript(lua_State *L, const String &fileName, const String &chunkName) {
+		OSFILE *inFile = OSBasics::open(fileName, "rb");
+		if(!inFile) {
+			String err = "could not open " + fileName;
+			lua_pushstring(L, err.c_str());
+			return LUA_ERRFILE;
+		}
+		
+		OSBasics::seek(inFile, 0, SEEK_END);	
+		long progsize = OSBasics::tell(inFile);
+		OSBasics::seek(inFile, 0, SEEK_SET);
+		
+		// luaL_loadbuffer tells precompiled chunks from source by their signature
+		std::vector<char> buffer(progsize > 0 ? progsize : 1);
+		OSBasics::read(&buffer[0], progsize, 1, inFile);
+		OSBasics::close(inFile);
+		
+		// polybuild compiles scripts for its own platform and packs their source next to them for every other one
+		if(progsize >= 4 && memcmp(&buffer[0], LUA_SIGNATURE, 4) == 0 && !isNativeBytecode(L, buffer)) {
+			return loadScript(L, fileName + ".src", chunkName);
+		}
+		
+		return luaL_loadbuffer(L, &buffer[0], progsize, chunkName.c_str());
+	}
+	
 	void PolycodePlayer::runFile(String fileName) {
 		
 		Logger::log("Running %s\n", fileName.c_str());
@@ -137,7 +185,8 @@ extern "C" {
 		}
 		
 		lua_pushinteger(L, numLoaders + 1);
-		lua_pushcfunction(L, MyLoader);
+		lua_pushlightuserdata(L, this);
+		lua_pushcclosure(L, MyLoader, 1);
 		lua_rawset(L, -3);
 		
 		// Table is still on the stack.  Get rid of it now.
@@ -202,31 +251,8 @@ extern "C" {
 					
 		}
 
-		String fileData = "";
-
-		OSFILE *inFile = OSBasics::open(fileName, "r");	
-		if(inFile) {
-			Logger::log("Opened entrypoint file...");
-			OSBasics::seek(inFile, 0, SEEK_END);	
-			long progsize = OSBasics::tell(inFile);
-			OSBasics::seek(inFile, 0, SEEK_SET);
-			char *buffer = (char*)malloc(progsize+1);
-			memset(buffer, 0, progsize+1);
-			OSBasics::read(buffer, progsize, 1, inFile);
-			fileData = String(buffer);		
-			free(buffer);
-			OSBasics::close(inFile);	
-		} else {
-			Logger::log("Error opening entrypoint file (%s)\n", fileName.c_str());
-		}
-		
-		
 		String postpend = ""; //" \nif update == nil then\nfunction update(e)\nend\nend\nwhile CORE:Update() do\nupdate(CORE:getElapsed())\nend";
 		
-		//String fullScript = prepend + prepend2 + prepend3 + fileData;// + postpend;
-		String fullScript = fileData;
-		//String fullScript = fileData;// + postpend;
-		
 		doneLoading = true;
 		
 		//lua_gc(L, LUA_GCSTOP, 0);
@@ -241,7 +267,13 @@ extern "C" {
 */				
 		
 		//CoreServices::getInstance()->getCore()->lockMutex(CoreServices::getRenderMutex());			
-		if (report(L, luaL_loadstring(L, fullScript.c_str()) || lua_pcall(L, 0,0,0))) {
+		// The entry point can be precompiled by polybuild, so it is loaded as a buffer rather than a string. Only the file name is used as the chunk name so error messages keep the "name:line: message" form report() expects.
+		String chunkName = "@" + fileName;
+		std::vector<String> pathBits = fileName.replace("\\", "/").split("/");
+		if(pathBits.size() > 0) {
+			chunkName = "@" + pathBits[pathBits.size()-1];
+		}
+		if (report(L, loadScript(L, fileName, chunkName) || lua_pcall(L, 0,0,0))) {
 			
 			//CoreServices::getInstance()->getCore()->unlockMutex(CoreServices::getRenderMutex());			
 			Logger::log("CRASH LOADING SCRIPT FILE\n");
@@ -357,6 +389,13 @@ void PolycodePlayer::loadFile(const char *fileName) {
 				
 			}			
 		}
+		ObjectEntry *scriptIndex = configFile.root["scriptIndex"];
+		if(scriptIndex) {
+			for(int i=0; i < scriptIndex->length; i++) {
+				String scriptPath = (*scriptIndex)[i]->stringVal;
+				modulePaths[scriptPath.substr(0, scriptPath.length() - 4).getSTLString()] = scriptPath;
+			}
+		}
 		ObjectEntry *modules = configFile.root["modules"];			
 		if(modules) {
 			for(int i=0; i < modules->length; i++) {			
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "PolyString.h"
+#include <vector>
+
+using namespace Polycode;
+
+class PolyappWriterEntry {
+public:
+	String name;
+	std::vector<char> data;
+	unsigned int size;
+	unsigned int crc;
+	unsigned int method;
+	unsigned int dosDate;
+	unsigned int headerOffset;
+	unsigned int dataOffset;
+	unsigned int padding;
+};
+
+/**
+* Writes .polyapp archives. The output is a regular zip file, so PhysFS and zip tools can still read it, but its first entry is an index that MappedArchive uses to find files with one hash lookup. Files that are already compressed (images, sounds, video) and files that don't shrink are stored uncompressed, and every file's data is aligned so stored files can be used straight from a memory mapping.
+*/
+class PolyappWriter {
+public:
+	PolyappWriter();
+	
+	/**
+	* Adds a file to the archive, replacing any earlier file with the same name.
+	* @param name Path of the file inside the archive.
+	* @param data File contents.
+	* @param size Size of the contents in bytes.
+	* @param dosDate Modification time in zip (MS-DOS) format.
+	*/
+	void addFile(const String& name, const char *data, unsigned int size, unsigned int dosDate);
+	
+	/**
+	* Writes the archive. Returns false if the file can't be written.
+	*/
+	bool write(const String& fileName);
+	
+	/**
+	* Returns true if files with this name should never be deflated.
+	*/
+	static bool isCompressedFormat(const String& name);
+	
+	/** Alignment of every file's data from the start of the archive. */
+	static const unsigned int DATA_ALIGNMENT = 16;
+	
+	/** Files are only deflated if that saves at least this fraction of their size. */
+	static const Number MIN_COMPRESSION_SAVING;
+	
+protected:
+	bool deflateData(const char *data, unsigned int size, std::vector<char> &output);
+	void layoutEntry(PolyappWriterEntry &entry, unsigned int offset);
+	void buildIndex(std::vector<char> &index);
+	void appendLocalHeader(const PolyappWriterEntry &entry, std::vector<char> &output);
+	void appendCentralHeader(const PolyappWriterEntry &entry, std::vector<char> &output);
+	
+	static void appendUInt(unsigned int value, std::vector<char> &output);
+	static void appendUShort(unsigned int value, std::vector<char> &output);
+	
+	std::vector<PolyappWriterEntry> entries;
+};
@@ -5,6 +5,12 @@
 #include "PolyString.h"
 #include "PolyObject.h"
 #include "OSBasics.h"
+#include <vector>
+
+extern "C" {
+#include "lua.h"
+#include "lauxlib.h"
+}
 
 #ifdef _WINDOWS
 #include <time.h>
@@ -18,3 +24,34 @@ public:
 	String name;
 	String value;
 };
+
+/**
+* Reads a Lua 5.1 bytecode dump and writes it back without debug information (source names, line info, local and upvalue names), the same as luac -s.
+*/
+class LuaBytecodeStripper {
+public:
+	LuaBytecodeStripper(const std::vector<char> &input);
+	
+	/**
+	* Returns false if the input is not a Lua 5.1 dump or is truncated, in which case output is left incomplete.
+	*/
+	bool strip(std::vector<char> &output);
+	
+protected:
+	bool copy(unsigned int size, std::vector<char> *output);
+	bool readInt(int *value);
+	bool readSize(size_t *value);
+	bool copyInt(std::vector<char> *output, int *value);
+	bool skipString();
+	void writeInt(int value, std::vector<char> &output);
+	void writeSize(size_t value, std::vector<char> &output);
+	bool stripFunction(std::vector<char> &output);
+
+	const std::vector<char> &input;
+	unsigned int offset;
+	unsigned int intSize;
+	unsigned int sizeTSize;
+	unsigned int instructionSize;
+	unsigned int numberSize;
+};
+
@@ -0,0 +1,248 @@
+#include "PolyappWriter.h"
+#include "PolyMappedArchive.h"
+#include "zlib.h"
+#include <stdio.h>
+#include <string.h>
+
+const Number PolyappWriter::MIN_COMPRESSION_SAVING = 0.1;
+
+// Android's zipalign uses the same extra field id for its padding
+#define ALIGNMENT_EXTRA_ID 0xD935
+
+PolyappWriter::PolyappWriter() {
+}
+
+bool PolyappWriter::isCompressedFormat(const String& name) {
+	static const char *extensions[] = {"png", "jpg", "jpeg", "ogg", "ogv", "mp3", "zip", "pak", "polyapp", NULL};
+	size_t found = name.rfind(".");
+	if(found == std::string::npos) {
+		return false;
+	}
+	String extension = name.substr(found + 1).toLowerCase();
+	for(int i=0; extensions[i]; i++) {
+		if(extension == extensions[i]) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool PolyappWriter::deflateData(const char *data, unsigned int size, std::vector<char> &output) {
+	z_stream stream;
+	memset(&stream, 0, sizeof(z_stream));
+	if(deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+		return false;
+	}
+	output.resize(deflateBound(&stream, size) + 1);
+	stream.next_in = (Bytef*)data;
+	stream.avail_in = size;
+	stream.next_out = (Bytef*)&output[0];
+	stream.avail_out = output.size();
+	int result = deflate(&stream, Z_FINISH);
+	output.resize(stream.total_out);
+	deflateEnd(&stream);
+	return result == Z_STREAM_END;
+}
+
+void PolyappWriter::addFile(const String& name, const char *data, unsigned int size, unsigned int dosDate) {
+	PolyappWriterEntry entry;
+	entry.name = name;
+	entry.size = size;
+	entry.dosDate = dosDate;
+	entry.crc = crc32(crc32(0, Z_NULL, 0), (const Bytef*)data, size);
+	entry.method = MappedArchive::METHOD_STORED;
+	entry.headerOffset = 0;
+	entry.dataOffset = 0;
+	entry.padding = 0;
+	
+	if(size > 0 && !isCompressedFormat(name)) {
+		std::vector<char> compressed;
+		if(deflateData(data, size, compressed) && compressed.size() < size * (1.0 - MIN_COMPRESSION_SAVING)) {
+			entry.method = MappedArchive::METHOD_DEFLATED;
+			entry.data.swap(compressed);
+		}
+	}
+	if(entry.method == MappedArchive::METHOD_STORED) {
+		entry.data.assign(data, data + size);
+	}
+	
+	for(int i=0; i < entries.size(); i++) {
+		if(entries[i].name == name) {
+			entries[i] = entry;
+			return;
+		}
+	}
+	entries.push_back(entry);
+}
+
+void PolyappWriter::layoutEntry(PolyappWriterEntry &entry, unsigned int offset) {
+	entry.headerOffset = offset;
+	unsigned int dataOffset = offset + 30 + entry.name.length();
+	entry.padding = (DATA_ALIGNMENT - dataOffset % DATA_ALIGNMENT) % DATA_ALIGNMENT;
+	// the padding is a proper extra field, so it needs room for its 4 byte header
+	if(entry.padding > 0 && entry.padding < 4) {
+		entry.padding += DATA_ALIGNMENT;
+	}
+	entry.dataOffset = dataOffset + entry.padding;
+}
+
+void PolyappWriter::buildIndex(std::vector<char> &index) {
+	unsigned int entryCount = entries.size();
+	unsigned int bucketCount = 1;
+	while(bucketCount < entryCount * 2) {
+		bucketCount *= 2;
+	}
+	
+	unsigned int emptyBucket = MappedArchive::EMPTY_BUCKET;
+	std::vector<unsigned int> buckets(bucketCount, emptyBucket);
+	std::vector<unsigned int> hashes(entryCount);
+	std::vector<char> names;
+	for(unsigned int i=0; i < entryCount; i++) {
+		hashes[i] = MappedArchive::hashPath(entries[i].name.c_str());
+		unsigned int bucket = hashes[i] & (bucketCount - 1);
+		while(buckets[bucket] != emptyBucket) {
+			bucket = (bucket + 1) & (bucketCount - 1);
+		}
+		buckets[bucket] = i;
+	}
+	
+	index.clear();
+	appendUInt(MappedArchive::INDEX_MAGIC, index);
+	appendUInt(MappedArchive::INDEX_VERSION, index);
+	appendUInt(entryCount, index);
+	appendUInt(bucketCount, index);
+	for(unsigned int i=0; i < bucketCount; i++) {
+		appendUInt(buckets[i], index);
+	}
+	for(unsigned int i=0; i < entryCount; i++) {
+		const PolyappWriterEntry &entry = entries[i];
+		appendUInt(hashes[i], index);
+		appendUInt(names.size(), index);
+		appendUInt(entry.name.length(), index);
+		appendUInt(entry.dataOffset, index);
+		appendUInt(entry.size, index);
+		appendUInt(entry.data.size(), index);
+		appendUInt(entry.method, index);
+		appendUInt(entry.crc, index);
+		names.insert(names.end(), entry.name.c_str(), entry.name.c_str() + entry.name.length());
+	}
+	index.insert(index.end(), names.begin(), names.end());
+}
+
+void PolyappWriter::appendUInt(unsigned int value, std::vector<char> &output) {
+	char bytes[4];
+	MappedArchive::writeUInt(value, bytes);
+	output.insert(output.end(), bytes, bytes + 4);
+}
+
+void PolyappWriter::appendUShort(unsigned int value, std::vector<char> &output) {
+	output.push_back(value & 0xFF);
+	output.push_back((value >> 8) & 0xFF);
+}
+
+void PolyappWriter::appendLocalHeader(const PolyappWriterEntry &entry, std::vector<char> &output) {
+	output.clear();
+	appendUInt(0x04034b50, output);
+	appendUShort(20, output);
+	appendUShort(0, output);
+	appendUShort(entry.method, output);
+	appendUInt(entry.dosDate, output);
+	appendUInt(entry.crc, output);
+	appendUInt(entry.data.size(), output);
+	appendUInt(entry.size, output);
+	appendUShort(entry.name.length(), output);
+	appendUShort(entry.padding, output);
+	output.insert(output.end(), entry.name.c_str(), entry.name.c_str() + entry.name.length());
+	if(entry.padding > 0) {
+		appendUShort(ALIGNMENT_EXTRA_ID, output);
+		appendUShort(entry.padding - 4, output);
+		output.resize(output.size() + entry.padding - 4, 0);
+	}
+}
+
+void PolyappWriter::appendCentralHeader(const PolyappWriterEntry &entry, std::vector<char> &output) {
+	appendUInt(0x02014b50, output);
+	appendUShort(20, output);
+	appendUShort(20, output);
+	appendUShort(0, output);
+	appendUShort(entry.method, output);
+	appendUInt(entry.dosDate, output);
+	appendUInt(entry.crc, output);
+	appendUInt(entry.data.size(), output);
+	appendUInt(entry.size, output);
+	appendUShort(entry.name.length(), output);
+	appendUShort(0, output);
+	appendUShort(0, output);
+	appendUShort(0, output);
+	appendUShort(0, output);
+	appendUInt(0, output);
+	appendUInt(entry.headerOffset, output);
+	output.insert(output.end(), entry.name.c_str(), entry.name.c_str() + entry.name.length());
+}
+
+bool PolyappWriter::write(const String& fileName) {
+	if(entries.size() + 1 > 0xFFFF) {
+		printf("Error writing %s: too many files in archive\n", fileName.c_str());
+		return false;
+	}
+	
+	// The index has to come first but records where every other file ends up. Its size only depends on the names, so lay it out with a placeholder first.
+	PolyappWriterEntry indexEntry;
+	indexEntry.name = MappedArchive::INDEX_NAME;
+	indexEntry.method = MappedArchive::METHOD_STORED;
+	indexEntry.dosDate = entries.size() > 0 ? entries[0].dosDate : 0;
+	buildIndex(indexEntry.data);
+	layoutEntry(indexEntry, 0);
+	
+	unsigned int offset = indexEntry.dataOffset + indexEntry.data.size();
+	for(int i=0; i < entries.size(); i++) {
+		layoutEntry(entries[i], offset);
+		offset = entries[i].dataOffset + entries[i].data.size();
+	}
+	
+	buildIndex(indexEntry.data);
+	indexEntry.size = indexEntry.data.size();
+	indexEntry.crc = crc32(crc32(0, Z_NULL, 0), (const Bytef*)&indexEntry.data[0], indexEntry.data.size());
+	
+	FILE *file = fopen(fileName.c_str(), "wb");
+	if(!file) {
+		printf("Error writing %s\n", fileName.c_str());
+		return false;
+	}
+	
+	std::vector<char> header;
+	std::vector<char> centralDirectory;
+	appendLocalHeader(indexEntry, header);
+	fwrite(&header[0], 1, header.size(), file);
+	fwrite(&indexEntry.data[0], 1, indexEntry.data.size(), file);
+	appendCentralHeader(indexEntry, centralDirectory);
+	
+	for(int i=0; i < entries.size(); i++) {
+		appendLocalHeader(entries[i], header);
+		fwrite(&header[0], 1, header.size(), file);
+		if(entries[i].data.size() > 0) {
+			fwrite(&entries[i].data[0], 1, entries[i].data.size(), file);
+		}
+		appendCentralHeader(entries[i], centralDirectory);
+	}
+	
+	std::vector<char> endRecord;
+	appendUInt(0x06054b50, endRecord);
+	appendUShort(0, endRecord);
+	appendUShort(0, endRecord);
+	appendUShort(entries.size() + 1, endRecord);
+	appendUShort(entries.size() + 1, endRecord);
+	appendUInt(centralDirectory.size(), endRecord);
+	appendUInt(offset, endRecord);
+	appendUShort(0, endRecord);
+	
+	fwrite(&centralDirectory[0], 1, centralDirectory.size(), file);
+	fwrite(&endRecord[0], 1, endRecord.size(), file);
+	
+	bool ok = ferror(file) == 0;
+	fclose(file);
+	if(!ok) {
+		printf("Error writing %s\n", fileName.c_str());
+	}
+	return ok;
+}
@@ -1,7 +1,9 @@
 
 #include "polybuild.h"
 #include "string.h"
-#include "zip.h"
+#include "PolyappWriter.h"
+#include "zlib.h"
+#include <time.h>
 
 #ifdef _WINDOWS
 	#include <windows.h>
@@ -22,6 +24,13 @@ using std::vector;
 vector<BuildArg> args;
 #define MAXFILENAME (256)
 
+// Set by the "compileScripts" config option. Every .lua file packed into the archive is then stored as stripped bytecode.
+// Bytecode only loads on a Lua build with the same version, endianness and type sizes as this tool, so the
+// source is packed next to it as "<script>.src" and the player falls back to that on other platforms.
+bool compileScripts = false;
+// Archive paths of every packed .lua file, written to runinfo.polyrun as the script index.
+vector<String> packedScripts;
+
 String getArg(String argName) {
 	/*
 	if(argName == "--config")
@@ -42,7 +51,6 @@ String getArg(String argName) {
 
 uLong filetime(
     const char *f,
-    tm_zip *tmzip,
     uLong *dt)
 {
   int ret=0;
@@ -77,45 +85,251 @@ uLong filetime(
   }
   filedate = localtime(&tm_t);
 
-  tmzip->tm_sec  = filedate->tm_sec;
-  tmzip->tm_min  = filedate->tm_min;
-  tmzip->tm_hour = filedate->tm_hour;
-  tmzip->tm_mday = filedate->tm_mday;
-  tmzip->tm_mon  = filedate->tm_mon ;
-  tmzip->tm_year = filedate->tm_year;
+  /* MS-DOS date and time as stored in zip headers, years before 1980 can't be represented */
+  uLong year = filedate->tm_year > 80 ? filedate->tm_year - 80 : 0;
+  *dt = (year << 25) | ((uLong)(filedate->tm_mon + 1) << 21) | ((uLong)filedate->tm_mday << 16) |
+        ((uLong)filedate->tm_hour << 11) | ((uLong)filedate->tm_min << 5) | ((uLong)filedate->tm_sec / 2);
 
   return ret;
 }
 
-void addFileToZip(zipFile z, String filePath, String pathInZip, bool silent) {
+LuaBytecodeStripper::LuaBytecodeStripper(const std::vector<char> &input) : input(input) {
+	offset = 0;
+	intSize = sizeof(int);
+	sizeTSize = sizeof(size_t);
+	instructionSize = 4;
+	numberSize = sizeof(lua_Number);
+}
+
+bool LuaBytecodeStripper::copy(unsigned int size, std::vector<char> *output) {
+	if(offset + size > input.size()) {
+		return false;
+	}
+	if(output) {
+		output->insert(output->end(), input.begin() + offset, input.begin() + offset + size);
+	}
+	offset += size;
+	return true;
+}
+
+bool LuaBytecodeStripper::readInt(int *value) {
+	if(offset + sizeof(int) > input.size()) {
+		return false;
+	}
+	memcpy(value, &input[offset], sizeof(int));
+	offset += sizeof(int);
+	return *value >= 0;
+}
+
+bool LuaBytecodeStripper::readSize(size_t *value) {
+	if(offset + sizeof(size_t) > input.size()) {
+		return false;
+	}
+	memcpy(value, &input[offset], sizeof(size_t));
+	offset += sizeof(size_t);
+	return true;
+}
+
+bool LuaBytecodeStripper::copyInt(std::vector<char> *output, int *value) {
+	if(!readInt(value)) {
+		return false;
+	}
+	writeInt(*value, *output);
+	return true;
+}
+
+bool LuaBytecodeStripper::skipString() {
+	size_t size;
+	if(!readSize(&size)) {
+		return false;
+	}
+	return copy(size, NULL);
+}
+
+void LuaBytecodeStripper::writeInt(int value, std::vector<char> &output) {
+	const char *bytes = (const char*)&value;
+	output.insert(output.end(), bytes, bytes + sizeof(int));
+}
+
+void LuaBytecodeStripper::writeSize(size_t value, std::vector<char> &output) {
+	const char *bytes = (const char*)&value;
+	output.insert(output.end(), bytes, bytes + sizeof(size_t));
+}
+
+bool LuaBytecodeStripper::stripFunction(std::vector<char> &output) {
+	int count;
+	
+	// source name
+	if(!skipString()) {
+		return false;
+	}
+	writeSize(0, output);
+	
+	// line defined, last line defined, upvalue count, parameter count, vararg flag and stack size
+	if(!copy(intSize * 2 + 4, &output)) {
+		return false;
+	}
+	
+	// code
+	if(!copyInt(&output, &count) || !copy(count * instructionSize, &output)) {
+		return false;
+	}
+	
+	// constants
+	if(!copyInt(&output, &count)) {
+		return false;
+	}
+	for(int i=0; i < count; i++) {
+		if(offset >= input.size()) {
+			return false;
+		}
+		char type = input[offset];
+		copy(1, &output);
+		bool ok = true;
+		switch(type) {
+			case LUA_TNIL:
+			break;
+			case LUA_TBOOLEAN:
+				ok = copy(1, &output);
+			break;
+			case LUA_TNUMBER:
+				ok = copy(numberSize, &output);
+			break;
+			case LUA_TSTRING: {
+				size_t size;
+				ok = readSize(&size);
+				if(ok) {
+					writeSize(size, output);
+					ok = copy(size, &output);
+				}
+			}
+			break;
+			default:
+				ok = false;
+			break;
+		}
+		if(!ok) {
+			return false;
+		}
+	}
+	
+	// nested functions
+	if(!copyInt(&output, &count)) {
+		return false;
+	}
+	for(int i=0; i < count; i++) {
+		if(!stripFunction(output)) {
+			return false;
+		}
+	}
+	
+	// debug information: line info, local variables and upvalue names
+	if(!readInt(&count) || !copy(count * intSize, NULL)) {
+		return false;
+	}
+	writeInt(0, output);
+	
+	if(!readInt(&count)) {
+		return false;
+	}
+	for(int i=0; i < count; i++) {
+		if(!skipString() || !copy(intSize * 2, NULL)) {
+			return false;
+		}
+	}
+	writeInt(0, output);
+	
+	if(!readInt(&count)) {
+		return false;
+	}
+	for(int i=0; i < count; i++) {
+		if(!skipString()) {
+			return false;
+		}
+	}
+	writeInt(0, output);
+	
+	return true;
+}
+
+bool LuaBytecodeStripper::strip(std::vector<char> &output) {
+	// signature, version, format, endianness and the sizes of int, size_t, Instruction and lua_Number
+	if(input.size() < 12 || memcmp(&input[0], LUA_SIGNATURE, 4) != 0 || input[4] != 0x51) {
+		return false;
+	}
+	if((unsigned char)input[7] != sizeof(int) || (unsigned char)input[8] != sizeof(size_t) || (unsigned char)input[9] != instructionSize || (unsigned char)input[10] != sizeof(lua_Number)) {
+		return false;
+	}
+	offset = 0;
+	output.clear();
+	copy(12, &output);
+	return stripFunction(output);
+}
+
+static int writeLuaChunk(lua_State *L, const void *data, size_t size, void *userData) {
+	std::vector<char> *output = (std::vector<char>*)userData;
+	output->insert(output->end(), (const char*)data, (const char*)data + size);
+	return 0;
+}
+
+bool compileLuaScript(const char *source, long size, String pathInZip, std::vector<char> &bytecode) {
+	lua_State *L = lua_open();
+	String chunkName = "@" + pathInZip;
+	if(luaL_loadbuffer(L, source, size, chunkName.c_str()) != 0) {
+		printf("Error compiling %s: %s\n", pathInZip.c_str(), lua_tostring(L, -1));
+		lua_close(L);
+		return false;
+	}
+	
+	std::vector<char> dump;
+	lua_dump(L, writeLuaChunk, &dump);
+	lua_close(L);
+	
+	LuaBytecodeStripper stripper(dump);
+	if(!stripper.strip(bytecode)) {
+		// not a format we know how to strip, keep the debug information
+		bytecode = dump;
+	}
+	return true;
+}
+
+void addFileToZip(PolyappWriter *z, String filePath, String pathInZip, bool silent) {
 			if(!silent)
 				printf("Packaging %s as %s\n", filePath.c_str(), pathInZip.c_str());
 
-                	zip_fileinfo zi;
-                	zi.tmz_date.tm_sec = zi.tmz_date.tm_min = zi.tmz_date.tm_hour =
-			zi.tmz_date.tm_mday = zi.tmz_date.tm_mon = zi.tmz_date.tm_year = 0;
-			 zi.dosDate = 0;
-              	 	 zi.internal_fa = 0;
-             		   zi.external_fa = 0;
-             		   filetime(filePath.c_str(),&zi.tmz_date,&zi.dosDate);
-	
-			zipOpenNewFileInZip(z, pathInZip.c_str(), &zi, NULL, 0, NULL, 0, NULL, Z_DEFLATED, 2);
+			uLong dosDate = 0;
+			filetime(filePath.c_str(), &dosDate);
 
 			FILE *f = fopen(filePath.c_str(), "rb");
+			if(!f) {
+				printf("Error opening %s\n", filePath.c_str());
+				return;
+			}
 			fseek(f, 0, SEEK_END);
 			long fileSize = ftell(f);
 			fseek(f, 0, SEEK_SET);
-			char *buf = (char*) malloc(fileSize);
+			char *buf = (char*) malloc(fileSize > 0 ? fileSize : 1);
 			fread(buf, fileSize, 1, f);
-			zipWriteInFileInZip(z, buf, fileSize);
+			
+			bool isScript = pathInZip.length() > 4 && pathInZip.substr(pathInZip.length() - 4, 4) == ".lua";
+			std::vector<char> bytecode;
+			if(isScript) {
+				packedScripts.push_back(pathInZip);
+			}
+			if(isScript && compileScripts && compileLuaScript(buf, fileSize, pathInZip, bytecode)) {
+				if(!silent)
+					printf("Compiled %s (%ld bytes of source, %d bytes of bytecode)\n", pathInZip.c_str(), fileSize, (int)bytecode.size());
+				z->addFile(pathInZip, &bytecode[0], bytecode.size(), dosDate);
+				z->addFile(pathInZip + ".src", buf, fileSize, dosDate);
+			} else {
+				z->addFile(pathInZip, buf, fileSize, dosDate);
+			}
 			free(buf);
 			fclose(f);
 
-			zipCloseFileInZip(z);
-
 }
 
-void addFolderToZip(zipFile z, String folderPath, String parentFolder, bool silent) {
+void addFolderToZip(PolyappWriter *z, String folderPath, String parentFolder, bool silent) {
 	std::vector<OSFileEntry> files = OSBasics::parseFolder(folderPath, false);
 	for(int i=0; i < files.size(); i++) {
 		if(files[i].type == OSFileEntry::TYPE_FILE) {
@@ -306,6 +520,15 @@ int main(int argc, char **argv) {
 		}
 	}
 
+	if(configFile.root["compileScripts"]) {
+		compileScripts = configFile.root["compileScripts"]->boolVal;
+		if(compileScripts) {
+			printf("Compile scripts: true\n");
+		} else {
+			printf("Compile scripts: false\n");
+		}
+	}
+
 	if(configFile.root["backgroundColor"]) {
 		ObjectEntry *color = configFile.root["backgroundColor"];
 		if((*color)["red"] && (*color)["green"] && (*color)["blue"]) {
@@ -319,7 +542,8 @@ int main(int argc, char **argv) {
 		}
 	}
 
-	zipFile z = zipOpen(getArg("--out").c_str(), 0);
+	PolyappWriter writer;
+	PolyappWriter *z = &writer;
 	
 
 	Object runInfo;
@@ -393,14 +617,22 @@ int main(int argc, char **argv) {
 	}
 
 
+	// Lets the player resolve require() against the archive without probing for files.
+	if(packedScripts.size() > 0) {
+		ObjectEntry *scriptIndex = runInfo.root.addChild("scriptIndex");
+		for(int i=0; i < packedScripts.size(); i++) {
+			scriptIndex->addChild("script", packedScripts[i]);
+		}
+	}
+
 	runInfo.saveToXML("runinfo_tmp_zzzz.polyrun");
 	addFileToZip(z, "runinfo_tmp_zzzz.polyrun", "runinfo.polyrun", true);
 
 	//addFolderToZip(z, getArg("--project"), "");
 	
-	zipClose(z, "");	
+	bool written = writer.write(getArg("--out"));
 
 	OSBasics::removeItem("runinfo_tmp_zzzz.polyrun");
 
-	return 0;
+	return written ? 0 : 1;
 }
@@ -0,0 +1,9 @@
+#pragma once
+
+#include "stdio.h"
+#include "PolyString.h"
+#include "PolyImage.h"
+#include "PolyTextureContainer.h"
+#include "OSBasics.h"
+
+using namespace Polycode;
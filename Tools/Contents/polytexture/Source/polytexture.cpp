@@ -0,0 +1,112 @@
+#include "polytexture.h"
+#include <math.h>
+#include <string.h>
+
+#include "physfs.h"
+
+void compareImages(Image *reference, Image *decoded, unsigned int level) {
+	int referenceChannels = reference->getType() == Image::IMAGE_RGB ? 3 : 4;
+	int decodedChannels = decoded->getType() == Image::IMAGE_RGB ? 3 : 4;
+	int channels = referenceChannels < decodedChannels ? referenceChannels : decodedChannels;
+	
+	unsigned char *referencePixels = (unsigned char*)reference->getPixels();
+	unsigned char *decodedPixels = (unsigned char*)decoded->getPixels();
+	unsigned int numPixels = reference->getWidth() * reference->getHeight();
+	
+	int maxError = 0;
+	double squaredError = 0;
+	for(unsigned int i=0; i < numPixels; i++) {
+		for(int c=0; c < channels; c++) {
+			int error = abs(referencePixels[i * referenceChannels + c] - decodedPixels[i * decodedChannels + c]);
+			if(error > maxError)
+				maxError = error;
+			squaredError += error * error;
+		}
+	}
+	
+	double meanSquaredError = squaredError / (numPixels * channels);
+	if(meanSquaredError > 0) {
+		printf("Level %d (%dx%d): max error %d, PSNR %.2f dB\n", level, reference->getWidth(), reference->getHeight(), maxError, 10.0 * log10(255.0 * 255.0 / meanSquaredError));
+	} else {
+		printf("Level %d (%dx%d): exact match\n", level, reference->getWidth(), reference->getHeight());
+	}
+}
+
+bool verifyContainer(Image *source, const char *fileName, bool createMipmaps) {
+	TextureContainer baked;
+	if(!baked.loadFromFile(fileName)) {
+		printf("Error reloading %s\n", fileName);
+		return false;
+	}
+	
+	TextureContainer reference;
+	reference.createFromImage(source, TextureContainer::FORMAT_RGBA, createMipmaps);
+	if(reference.getNumLevels() != baked.getNumLevels()) {
+		printf("Level count mismatch: expected %d, got %d\n", reference.getNumLevels(), baked.getNumLevels());
+		return false;
+	}
+	
+	for(unsigned int i=0; i < baked.getNumLevels(); i++) {
+		Image *referenceLevel = reference.decodeLevel(i);
+		Image *decodedLevel = baked.decodeLevel(i);
+		compareImages(referenceLevel, decodedLevel, i);
+		delete referenceLevel;
+		delete decodedLevel;
+	}
+	return true;
+}
+
+int main(int argc, char **argv) {
+
+	printf("Polycode texture tool v0.8.2\n");
+
+	if(argc < 4) {
+		printf("\n\nInvalid arguments!\n");
+		printf("usage: polytexture <source_file> <output_file> <rgba|rgb|dxt1|dxt5> [nomips] [verify]\n\n");
+		return 0;
+	}
+	
+	int format = TextureContainer::formatFromName(argv[3]);
+	if(format == -1) {
+		printf("Unknown format %s\n", argv[3]);
+		return 0;
+	}
+	
+	bool createMipmaps = true;
+	bool verify = false;
+	for(int i=4; i < argc; i++) {
+		if(strcmp(argv[i], "nomips") == 0)
+			createMipmaps = false;
+		if(strcmp(argv[i], "verify") == 0)
+			verify = true;
+	}
+	
+	PHYSFS_init(argv[0]);
+	
+	printf("Loading %s...\n", argv[1]);
+	Image *image = new Image(argv[1]);
+	if(!image->isLoaded()) {
+		printf("Error loading %s\n", argv[1]);
+		delete image;
+		return 0;
+	}
+	
+	TextureContainer container;
+	if(!container.createFromImage(image, format, createMipmaps)) {
+		delete image;
+		return 0;
+	}
+	
+	printf("Writing %s (%d levels)...\n", argv[2], container.getNumLevels());
+	if(!container.saveToFile(argv[2])) {
+		delete image;
+		return 0;
+	}
+	
+	if(verify) {
+		verifyContainer(image, argv[2], createMipmaps);
+	}
+	
+	delete image;
+	return 1;
+}